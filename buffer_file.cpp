@@ -0,0 +1,111 @@
+// buffer_file.cpp - 暫放文字檔分段讀寫實作
+#include "buffer_file.h"
+#include "file_io.h"
+#include "utf8_codec.h"
+#include <cstring>
+#include <vector>
+
+namespace BufferFile {
+
+static const char UTF8_BOM[3] = {(char)0xEF, (char)0xBB, (char)0xBF};
+
+Status load(const std::string& path, std::wstring& text, const Progress& progress, const ByteVisitor& onBytes) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return OPEN_FAILED;
+
+    std::vector<char> block(BLOCK_SIZE);
+    std::fseek(file, 0, SEEK_END);
+    long end = std::ftell(file);
+    uint64_t total = end > 0 ? (uint64_t)end : 0;
+    std::rewind(file);
+
+    // 第一遍：只計算解碼後的長度（不解碼），讓第二遍只配置一次
+    size_t length = 0;
+    bool first = true;
+    size_t n;
+    while ((n = std::fread(block.data(), 1, block.size(), file)) > 0) {
+        size_t skip = (first && n >= 3 && std::memcmp(block.data(), UTF8_BOM, 3) == 0) ? 3 : 0;
+        first = false;
+        length += Utf8Codec::decodedLength(block.data() + skip, n - skip);
+    }
+    if (std::ferror(file)) {
+        std::fclose(file);
+        return IO_FAILED;
+    }
+    std::rewind(file);
+
+    std::wstring decoded;
+    decoded.reserve(length);
+    Utf8Codec::StreamDecoder decoder;
+    uint64_t done = 0;
+    first = true;
+    while ((n = std::fread(block.data(), 1, block.size(), file)) > 0) {
+        if (onBytes) onBytes(block.data(), n);
+        size_t skip = (first && n >= 3 && std::memcmp(block.data(), UTF8_BOM, 3) == 0) ? 3 : 0;
+        first = false;
+        decoder.feed(decoded, block.data() + skip, n - skip);
+        done += n;
+        if (progress && !progress(done, total)) {
+            std::fclose(file);
+            return CANCELLED;
+        }
+    }
+    bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed) return IO_FAILED;
+
+    decoder.finish(decoded);
+    text.swap(decoded);
+    return OK;
+}
+
+Status write(FILE* file, const TextModel& text, bool bom, const Progress& progress, const ByteVisitor& onBytes) {
+    bool ok = true;
+    bool cancelled = false;
+    std::string encoded;
+    encoded.reserve(BLOCK_SIZE * 2);
+    auto emit = [&]() {
+        if (encoded.empty()) return;
+        if (std::fwrite(encoded.data(), 1, encoded.size(), file) != encoded.size()) ok = false;
+        if (onBytes) onBytes(encoded.data(), encoded.size());
+        encoded.clear();
+    };
+
+    if (bom) encoded.append(UTF8_BOM, 3);
+
+    // 每次最多編碼 BLOCK_SIZE/6 個字元（每字元最多 4 位元組），緩衝區不會超過兩個區塊
+    const size_t step = BLOCK_SIZE / 6;
+    uint64_t total = text.length();
+    uint64_t done = 0;
+    Utf8Codec::StreamEncoder encoder;
+    text.forEachChunk([&](const wchar_t* data, size_t count) {
+        while (count > 0 && ok && !cancelled) {
+            size_t take = count < step ? count : step;
+            encoder.feed(encoded, data, take);
+            data += take;
+            count -= take;
+            done += take;
+            if (encoded.size() >= BLOCK_SIZE) {
+                emit();
+                if (progress && !progress(done, total)) cancelled = true;
+            }
+        }
+    });
+    if (cancelled) return CANCELLED;
+    encoder.finish(encoded);
+    emit();
+    if (progress && ok) progress(total, total);
+    return ok ? OK : IO_FAILED;
+}
+
+Status save(const std::string& path, const TextModel& text, const Progress& progress) {
+    std::string tempPath = path + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return OPEN_FAILED;
+    Status status = write(file, text, true, progress);
+    // 確保資料已寫到磁碟，並以原子方式取代檔案
+    if (!FileIO::commitFile(file, tempPath, path, status == OK) && status == OK) status = IO_FAILED;
+    return status;
+}
+
+}
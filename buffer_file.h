@@ -0,0 +1,39 @@
+// buffer_file.h - 暫放文字檔的分段讀寫（可攜式，不依賴 Windows API）
+#ifndef BUFFER_FILE_H
+#define BUFFER_FILE_H
+
+#include "text_model.h"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+// 檔案格式與原本的 text_buffer.txt 相同：UTF-8，開頭可有 BOM
+// 讀寫都以固定大小的區塊進行，不先把整份檔案或整份 UTF-8 字串放在記憶體中：
+// - 寫入：依片段表的片段編碼，每累積一個區塊就寫出
+// - 讀取：先掃描一次計算解碼後的長度並一次配置，再逐區塊解碼；
+//   峰值記憶體約為文字本身加一個區塊，不會因字串成長而重新配置
+// 進度回呼可用來更新狀態列；在背景執行緒呼叫時回呼也在該執行緒執行
+namespace BufferFile {
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    // done/total：已處理與全部的量（讀取為位元組，寫入為字元）；回傳 false 取消
+    typedef std::function<bool(uint64_t done, uint64_t total)> Progress;
+    // 實際讀出或寫入的原始位元組（例如計算檔案雜湊）
+    typedef std::function<void(const char* data, size_t size)> ByteVisitor;
+
+    enum Status { OK = 0, OPEN_FAILED, IO_FAILED, CANCELLED };
+
+    // 讀取整個檔案（略過 BOM）到 text
+    Status load(const std::string& path, std::wstring& text,
+                const Progress& progress = Progress(), const ByteVisitor& onBytes = ByteVisitor());
+
+    // 以 UTF-8 寫出 text 到已開啟的檔案
+    Status write(FILE* file, const TextModel& text, bool bom,
+                 const Progress& progress = Progress(), const ByteVisitor& onBytes = ByteVisitor());
+    // 寫出 text 到 path（含 BOM）：先寫到 path.tmp，完整寫入後才取代 path
+    // 取消或失敗時 path 維持原本的內容
+    Status save(const std::string& path, const TextModel& text, const Progress& progress = Progress());
+}
+
+#endif // BUFFER_FILE_H
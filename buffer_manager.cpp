@@ -2,12 +2,191 @@
 #include "buffer_manager.h"
 #include "input_handler.h"
 #include "window_manager.h"
-#include <fstream>
+#include "trace_recorder.h"
+#include "utf8_codec.h"
+#include "clipboard_sync.h"
+#include "edit_journal.h"
+#include "buffer_file.h"
+#include "text_search.h"
+#include <cstring>
+#include <memory>
 #include <ctime>
 #include <iomanip>
 #include <windows.h>
 namespace BufferManager {
 
+// 暫放檔超過此大小時，載入中在狀態列顯示進度
+static const uint64_t LOAD_PROGRESS_MIN_BYTES = 4 * 1024 * 1024;
+// 背景另存的進度與結果（WM_USER+104 的 wParam）
+enum ExportMessage { EXPORT_PROGRESS = 0, EXPORT_DONE = 1, EXPORT_FAILED = 2 };
+
+// 以 GDI 量測暫放視窗字型的字元寬度：記憶體 DC 與字型只在字型設定改變時重建
+// 繪製也使用同一個字型（字型可同時選入多個 DC），不在每次 WM_PAINT 建立
+class GdiTextMetrics : public TextMetrics {
+public:
+    GdiTextMetrics() : hdc_(NULL), hFont_(NULL), hOldFont_(NULL), fontSize_(0) {}
+    ~GdiTextMetrics() { release(); }
+    
+    // 字型改變時回傳 true（呼叫端需清除寬度快取）
+    bool select(const std::wstring& fontName, int fontSize) {
+        if (hdc_ && fontName == fontName_ && fontSize == fontSize_) return false;
+        release();
+        hdc_ = CreateCompatibleDC(NULL);
+        hFont_ = CreateFontW(fontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+            DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+            DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, fontName.c_str());
+        if (hdc_ && hFont_) hOldFont_ = (HFONT)SelectObject(hdc_, hFont_);
+        fontName_ = fontName;
+        fontSize_ = fontSize;
+        return true;
+    }
+    
+    int advance(wchar_t ch) {
+        SIZE charSize;
+        if (!hdc_ || !GetTextExtentPoint32W(hdc_, &ch, 1, &charSize)) return 0;
+        return charSize.cx;
+    }
+    
+    int lineHeight() { return fontSize_ + 2; }
+    
+    HFONT font() const { return hFont_; }
+    
+private:
+    void release() {
+        if (hdc_ && hOldFont_) SelectObject(hdc_, hOldFont_);
+        if (hFont_) DeleteObject(hFont_);
+        if (hdc_) DeleteDC(hdc_);
+        hdc_ = NULL;
+        hFont_ = NULL;
+        hOldFont_ = NULL;
+    }
+    
+    HDC hdc_;
+    HFONT hFont_;
+    HFONT hOldFont_;
+    std::wstring fontName_;
+    int fontSize_;
+};
+
+static GdiTextMetrics g_bufferMetrics;
+
+// 剪貼簿模式的同步計時器（暫放視窗的 WM_TIMER）
+static const UINT_PTR CLIPBOARD_SYNC_TIMER_ID = 2;
+
+// 將文字複製到可放上剪貼簿的全域記憶體（直接由片段複製）
+static HGLOBAL copyToGlobal(const TextModel& text) {
+    size_t length = text.length();
+    HGLOBAL hData = GlobalAlloc(GMEM_MOVEABLE, (length + 1) * sizeof(wchar_t));
+    if (!hData) return NULL;
+    
+    wchar_t* pchData = (wchar_t*)GlobalLock(hData);
+    if (!pchData) {
+        GlobalFree(hData);
+        return NULL;
+    }
+    wchar_t* dest = pchData;
+    text.forEachChunk([&dest](const wchar_t* data, size_t count) {
+        memcpy(dest, data, count * sizeof(wchar_t));
+        dest += count;
+    });
+    pchData[length] = L'\0';
+    GlobalUnlock(hData);
+    return hData;
+}
+
+// 剪貼簿同步的 Windows 環境：以暫放視窗作為剪貼簿擁有者並接收計時器
+class WindowClipboardEnvironment : public ClipboardSync::ClipboardEnvironment {
+public:
+    uint32_t now() override { return GetTickCount(); }
+    
+    bool announce() override {
+        HWND owner = g_state.hBufferWnd;
+        if (!owner || !OpenClipboard(owner)) return false;
+        EmptyClipboard();
+        SetClipboardData(CF_UNICODETEXT, NULL);   // 延遲產生：貼上時才收到 WM_RENDERFORMAT
+        CloseClipboard();
+        return true;
+    }
+    
+    bool publish(const TextModel& text) override {
+        if (!OpenClipboard(g_state.hBufferWnd)) return false;
+        EmptyClipboard();
+        bool ok = false;
+        HGLOBAL hData = copyToGlobal(text);
+        if (hData) {
+            ok = SetClipboardData(CF_UNICODETEXT, hData) != NULL;
+            if (!ok) GlobalFree(hData);
+        }
+        CloseClipboard();
+        return ok;
+    }
+    
+    bool render(const TextModel& text) override {
+        HGLOBAL hData = copyToGlobal(text);
+        if (!hData) return false;
+        if (!SetClipboardData(CF_UNICODETEXT, hData)) {
+            GlobalFree(hData);
+            return false;
+        }
+        return true;
+    }
+    
+    void scheduleFlush(unsigned ms) override {
+        if (g_state.hBufferWnd) SetTimer(g_state.hBufferWnd, CLIPBOARD_SYNC_TIMER_ID, ms, NULL);
+    }
+    
+    void cancelFlush() override {
+        if (g_state.hBufferWnd) KillTimer(g_state.hBufferWnd, CLIPBOARD_SYNC_TIMER_ID);
+    }
+};
+
+static WindowClipboardEnvironment g_clipboardEnv;
+static ClipboardSync::ClipboardSyncer g_clipboardSync(g_clipboardEnv);
+
+// 暫放文字的編輯日誌：每次編輯附加到日誌，由背景執行緒定期寫出 text_buffer.txt 檢查點
+static EditJournal g_bufferJournal("text_buffer.txt", "text_buffer.journal");
+// 背景另存中的檔名（只在介面執行緒存取）
+static std::wstring g_exportName;
+// text_buffer.txt 存在但讀取失敗：不可改寫，以免覆蓋原本的內容
+static bool g_bufferFileUnreadable = false;
+
+// 取得暫放區排版，並確保字型與文字區寬度為目前設定
+// 文字區與繪製時相同：左右各留 10 像素
+TextLayout& getBufferLayout(const GlobalState& state) {
+    TextLayout& layout = state.bufferLayout;
+    if (g_bufferMetrics.select(state.bufferFontName, state.bufferFontSize) ||
+        layout.metrics() != &g_bufferMetrics) {
+        layout.setMetrics(&g_bufferMetrics);
+    }
+    
+    int width = FIXED_WIDTH - 20;
+    RECT rc;
+    if (state.hBufferWnd && GetClientRect(state.hBufferWnd, &rc) && rc.right > 20) {
+        width = rc.right - 20;
+    }
+    layout.setWidth(width);
+    return layout;
+}
+
+HFONT getBufferFont(const GlobalState& state) {
+    getBufferLayout(state);
+    return g_bufferMetrics.font();
+}
+
+// 清空暫放文字；清空也記入復原歷史，可用 Ctrl+Z 找回
+static void clearBufferText(GlobalState& state) {
+    // 剪貼簿仍在延遲產生或有未同步的編輯時，先放入清空前的文字
+    finalizeClipboard(state);
+    if (!state.bufferText.empty()) {
+        state.editHistory.breakGroup();
+        state.editHistory.recordErase(0, state.bufferText.str(), state.bufferCursorPos, 0);
+        state.editHistory.breakGroup();
+    }
+    state.bufferText.clear();
+    state.bufferCursorPos = 0;
+    state.bufferLayout.invalidate();
+}
+
 int calculateBufferWindowHeight(const GlobalState& state) {
     // 确保最小高度足够容纳控制列和按钮
     int minRequiredHeight = 60 + CONTROL_BAR_HEIGHT; // 60px文字区域 + 控制列
@@ -16,10 +195,16 @@ int calculateBufferWindowHeight(const GlobalState& state) {
         return std::max(MIN_HEIGHT, minRequiredHeight);
     }
     
-    int lineCount = (state.bufferText.length() + CHARS_PER_LINE - 1) / CHARS_PER_LINE;
-    lineCount = std::max(1, lineCount);
+    // 行數取自換行排版（與繪製相同的換行規則）；達到最大高度所需行數即可停止排版
+    TextLayout& layout = getBufferLayout(state);
+    int lineHeight = std::max(1, layout.lineHeight());
+    size_t maxLines = (size_t)((MAX_HEIGHT - CONTROL_BAR_HEIGHT - 30 + lineHeight - 1) / lineHeight);
+    if (layout.hasLines(state.bufferText, maxLines + 1)) {
+        return MAX_HEIGHT;
+    }
+    int lineCount = std::max(1, (int)layout.lineCount(state.bufferText));
     
-    int contentHeight = lineCount * LINE_HEIGHT + 30; // 从20增加到30
+    int contentHeight = lineCount * lineHeight + 30; // 从20增加到30
     int totalHeight = contentHeight + CONTROL_BAR_HEIGHT;
     
     // 强制确保最小高度
@@ -29,42 +214,64 @@ int calculateBufferWindowHeight(const GlobalState& state) {
 }
 
 void saveBufferToFile(const GlobalState& state) {
+    // 軌跡重播使用暫存狀態，不可覆寫實際的暫放檔
+    if (TraceRecorder::isReplaying()) return;
+    // 編輯已由日誌記錄（見 loadBufferFromFile），不需整份改寫；日誌無法使用時才改寫整個檔案
+    if (g_bufferJournal.running() && state.bufferText.observer() == &g_bufferJournal) return;
+    if (g_bufferFileUnreadable) return;
     try {
-        std::ofstream file("text_buffer.txt", std::ios::out | std::ios::binary);
-        if (file.is_open()) {
-            const char bom[] = {static_cast<char>(0xEF), 
-                               static_cast<char>(0xBB), 
-                               static_cast<char>(0xBF)};
-            file.write(bom, 3);
-            
-            std::string utf8_text = Utils::wstrToUtf8(state.bufferText);
-            file.write(utf8_text.c_str(), utf8_text.length());
-            file.close();
-        }
+        BufferFile::save("text_buffer.txt", state.bufferText);
     } catch (...) {}
 }
 
 void loadBufferFromFile(GlobalState& state) {
     try {
-        std::ifstream file("text_buffer.txt", std::ios::binary);
-        if (file.is_open()) {
-            std::string content((std::istreambuf_iterator<char>(file)),
-                              std::istreambuf_iterator<char>());
-            file.close();
-            
-            if (content.length() >= 3 && 
-                content[0] == static_cast<char>(0xEF) &&
-                content[1] == static_cast<char>(0xBB) &&
-                content[2] == static_cast<char>(0xBF)) {
-                content = content.substr(3);
+        // 先寫完目前的日誌，再由檢查點加日誌恢復（上次當機時可恢復到最後一次按鍵）
+        g_bufferJournal.stop();
+        state.bufferText.setObserver(nullptr);
+        
+        // 大檔分段讀取時在狀態列顯示進度（介面執行緒上同步載入，直接重繪狀態列）
+        DWORD lastProgress = GetTickCount();
+        BufferFile::Progress progress = [&state, &lastProgress](uint64_t done, uint64_t total) {
+            DWORD now = GetTickCount();
+            if (total >= LOAD_PROGRESS_MIN_BYTES && now - lastProgress >= 100) {
+                lastProgress = now;
+                Utils::updateStatus(state, L"載入暫放內容… " + std::to_wstring(done * 100 / total) + L"%");
+                if (state.hWnd) UpdateWindow(state.hWnd);
             }
-            
-            state.bufferText = Utils::utf8ToWstr(content);
+            return true;
+        };
+        
+        EditJournal::Recovery recovery;
+        g_bufferJournal.recover(recovery, progress);
+        g_bufferFileUnreadable = recovery.unreadable;
+        if (recovery.unreadable) {
+            // 檢查點讀取失敗：不啟動日誌，以免以空白內容覆寫檔案
+            Utils::updateStatus(state, L"無法讀取 text_buffer.txt");
+            return;
+        }
+        if (recovery.found) {
+            state.bufferText.swap(recovery.text);
             state.bufferCursorPos = state.bufferText.length();
+            state.bufferLayout.invalidate();
+            clearHistory(state);
+            if (recovery.replayed > 0) {
+                Utils::updateStatus(state, L"已從編輯日誌恢復 " + std::to_wstring(recovery.replayed) + L" 筆編輯");
+            }
+        }
+        
+        // 套用過日誌或日誌不可用時先寫出新檢查點，之後的編輯附加到新日誌
+        if (g_bufferJournal.start(state.bufferText, !recovery.clean)) {
+            state.bufferText.setObserver(&g_bufferJournal);
         }
     } catch (...) {}
 }
 
+void shutdownJournal(GlobalState& state) {
+    state.bufferText.setObserver(nullptr);
+    g_bufferJournal.stop();
+}
+
 void saveBufferToTimestampedFile(const GlobalState& state) {
     try {
         time_t now = time(nullptr);
@@ -80,44 +287,67 @@ void saveBufferToTimestampedFile(const GlobalState& state) {
                    timeinfo->tm_sec);
         
         std::string filenameStr = Utils::wstrToUtf8(std::wstring(filename));
-        std::ofstream file(filenameStr, std::ios::out | std::ios::binary);
-        if (file.is_open()) {
-            const char bom[] = {static_cast<char>(0xEF), 
-                               static_cast<char>(0xBB), 
-                               static_cast<char>(0xBF)};
-            file.write(bom, 3);
-            
-            std::string content = Utils::wstrToUtf8(state.bufferText);
-            file.write(content.c_str(), content.length());
-            file.close();
-            
+        
+        // 日誌執行中：由日誌的背景執行緒以影子文字寫出，介面不等待；進度與結果以 WM_USER+104 回報
+        if (state.hWnd && g_bufferJournal.running() && state.bufferText.observer() == &g_bufferJournal) {
+            HWND hWnd = state.hWnd;
+            std::shared_ptr<int> lastPercent = std::make_shared<int>(-1);
+            BufferFile::Progress progress = [hWnd, lastPercent](uint64_t done, uint64_t total) {
+                int percent = total > 0 ? (int)(done * 100 / total) : 100;
+                if (percent / 10 != *lastPercent / 10) {
+                    *lastPercent = percent;
+                    PostMessage(hWnd, WM_USER+104, EXPORT_PROGRESS, percent);
+                }
+                return true;
+            };
+            g_exportName = filename;
+            bool queued = g_bufferJournal.exportCopy(filenameStr, progress, [hWnd](BufferFile::Status status) {
+                PostMessage(hWnd, WM_USER+104, status == BufferFile::OK ? EXPORT_DONE : EXPORT_FAILED, 0);
+            });
+            if (queued) return;
+        }
+        
+        if (BufferFile::save(filenameStr, state.bufferText) == BufferFile::OK) {
             std::wstring successMsg = L"已儲存到檔案: " + std::wstring(filename);
             Utils::updateStatus(const_cast<GlobalState&>(state), successMsg);
+        } else {
+            Utils::updateStatus(const_cast<GlobalState&>(state), L"儲存失敗：無法建立檔案");
         }
     } catch (...) {
         Utils::updateStatus(const_cast<GlobalState&>(state), L"儲存失敗：無法建立檔案");
     }
 }
 
+void onExportProgress(GlobalState& state, WPARAM kind, LPARAM percent) {
+    switch (kind) {
+        case EXPORT_PROGRESS:
+            Utils::updateStatus(state, L"儲存中… " + std::to_wstring((int)percent) + L"%");
+            break;
+        case EXPORT_DONE:
+            Utils::updateStatus(state, L"已儲存到檔案: " + g_exportName);
+            break;
+        default:
+            Utils::updateStatus(state, L"儲存失敗：無法建立檔案");
+            break;
+    }
+}
+
 void sendBufferContent(GlobalState& state) {
     if (!state.bufferText.empty()) {
         bool wasBufferVisible = state.bufferMode && IsWindowVisible(state.hBufferWnd);
-        RECT bufferRect;
-        if (wasBufferVisible) {
-            GetWindowRect(state.hBufferWnd, &bufferRect);
-        }
         
         // 發送文字
-        InputHandler::sendTextDirectUnicode(state.bufferText);
+        InputHandler::sendTextDirectUnicode(state.bufferText.str());
         Utils::updateStatus(state, L"已發送暫放文字：" + std::to_wstring(state.bufferText.length()) + L"字");
         
         // 清空暫放區
-        state.bufferText.clear();
-        state.bufferCursorPos = 0;
+        clearBufferText(state);
         saveBufferToFile(state);
+        InputHandler::recordTraceSync(state);
         
         // 更新暫放視窗
-        if (state.hBufferWnd) {
+        // 可見時暫放視窗在背景送出期間保持隱藏，送完後由 InputHandler::handleOutputProgress 恢復
+        if (state.hBufferWnd && !wasBufferVisible) {
             int newHeight = calculateBufferWindowHeight(state);
             if (state.useOptimizedUI) {
                 // OptimizedUI模式下更新位置
@@ -127,12 +357,6 @@ void sendBufferContent(GlobalState& state) {
                             SWP_NOMOVE | SWP_NOZORDER);
             }
             
-            if (wasBufferVisible && state.bufferMode) {
-                ShowWindow(state.hBufferWnd, SW_SHOWNOACTIVATE);
-                state.bufferHasFocus = true;
-                SetTimer(state.hBufferWnd, 1, 500, NULL);
-            }
-            
             InvalidateRect(state.hBufferWnd, nullptr, TRUE);
         }
     } else {
@@ -144,9 +368,9 @@ void sendBufferContent(GlobalState& state) {
 void clearBufferWithConfirm(GlobalState& state) {
     if (!state.bufferText.empty()) {
         if (state.bufferMode) {
-            state.bufferText.clear();
-            state.bufferCursorPos = 0;
+            clearBufferText(state);
             saveBufferToFile(state);
+            InputHandler::recordTraceSync(state);
             Utils::updateStatus(state, L"暫放文字已清空");
             
             if (state.hBufferWnd) {
@@ -161,9 +385,9 @@ void clearBufferWithConfirm(GlobalState& state) {
                 MB_YESNO | MB_ICONQUESTION);
             
             if (result == IDYES) {
-                state.bufferText.clear();
-                state.bufferCursorPos = 0;
+                clearBufferText(state);
                 saveBufferToFile(state);
+                InputHandler::recordTraceSync(state);
                 Utils::updateStatus(state, L"暫放文字已清空");
                 
                 if (state.hBufferWnd) {
@@ -194,6 +418,8 @@ void toggleBufferMode(GlobalState& state) {
         Utils::updateStatus(state, L"已進入暫放模式（支持中英文直接編輯）");
     } else {
         state.bufferHasFocus = false;
+        state.findActive = false;
+        state.findReplaceMode = false;
         if (state.hBufferWnd) {
             KillTimer(state.hBufferWnd, 1);
             ShowWindow(state.hBufferWnd, SW_HIDE);
@@ -207,16 +433,28 @@ void toggleBufferMode(GlobalState& state) {
     if (state.useOptimizedUI && state.hWnd) {
         InvalidateRect(state.hWnd, nullptr, TRUE);
     }
+    
+    InputHandler::recordTraceSync(state);
 }
 
+static void findInputText(GlobalState& state, const std::wstring& text);
+static void findBackspace(GlobalState& state);
+
 void insertTextAtCursor(GlobalState& state, const std::wstring& text) {
-	saveSnapshot(state);
+    if (state.findActive) {
+        findInputText(state, text);
+        return;
+    }
+    TraceRecorder::Scope trace(TraceRecorder::EVT_BUFFER_INSERT, 0, 0, text);
     if (state.bufferCursorPos < 0) state.bufferCursorPos = 0;
     if (state.bufferCursorPos > (int)state.bufferText.length()) 
         state.bufferCursorPos = state.bufferText.length();
     
-    state.bufferText.insert(state.bufferCursorPos, text);
+    int insertPos = state.bufferCursorPos;
+    state.bufferText.insert(insertPos, text);
     state.bufferCursorPos += text.length();
+    state.bufferLayout.onEdit(state.bufferText, insertPos, 0, text.length());
+    state.editHistory.recordInsert(insertPos, text, insertPos, state.bufferCursorPos);
     
     saveBufferToFile(state);
     
@@ -226,11 +464,8 @@ void insertTextAtCursor(GlobalState& state, const std::wstring& text) {
         state.clipboardCopied = false;
         state.clipboardLastInputTime = GetTickCount();
         
-        // 只有在暫放視窗沒有焦點時才立即更新剪貼簿（用戶在其他位置操作時）
-        // 如果有焦點，會在失去焦點時更新剪貼簿（見WM_KILLFOCUS處理）
-        if (!state.bufferHasFocus) {
-            updateClipboardInMode(state);
-        }
+        // 連續編輯合併後才寫入剪貼簿；失去焦點或輸入結束時立即同步（見WM_KILLFOCUS處理）
+        notifyClipboardEdit(state);
         
         // 確保窗口重繪以顯示狀態指示器變化
         if (state.hBufferWnd) {
@@ -262,9 +497,11 @@ void insertTextAtCursor(GlobalState& state, const std::wstring& text) {
 }
 
 void deleteCharAtCursor(GlobalState& state, bool forward) {
+    if (state.findActive) {
+        if (!forward) findBackspace(state);
+        return;
+    }
     if (state.bufferText.empty()) return;
-	
-	saveSnapshot(state);
     
 	    //如果有選取文字，優先刪除選取的內容
     if (state.hasSelection) {
@@ -275,10 +512,8 @@ void deleteCharAtCursor(GlobalState& state, bool forward) {
             state.clipboardCopied = false;
             state.clipboardLastInputTime = GetTickCount();
             
-            // 只有在暫放視窗沒有焦點時才立即更新剪貼簿
-            if (!state.bufferHasFocus) {
-                updateClipboardInMode(state);
-            }
+            // 連續編輯合併後才寫入剪貼簿
+            notifyClipboardEdit(state);
             
             if (state.hBufferWnd) {
                 InvalidateRect(state.hBufferWnd, nullptr, TRUE);
@@ -288,14 +523,23 @@ void deleteCharAtCursor(GlobalState& state, bool forward) {
         return;
     }
 	
+    // 有選取時由 deleteSelection 自行記錄
+    TraceRecorder::Scope trace(TraceRecorder::EVT_BUFFER_DELETE, forward ? 1 : 0);
+    int cursorBefore = state.bufferCursorPos;
     if (forward) {
         if (state.bufferCursorPos < (int)state.bufferText.length()) {
+            std::wstring removed(1, state.bufferText[state.bufferCursorPos]);
             state.bufferText.erase(state.bufferCursorPos, 1);
+            state.bufferLayout.onEdit(state.bufferText, state.bufferCursorPos, 1, 0);
+            state.editHistory.recordErase(state.bufferCursorPos, removed, cursorBefore, state.bufferCursorPos);
         }
     } else {
         if (state.bufferCursorPos > 0) {
+            std::wstring removed(1, state.bufferText[state.bufferCursorPos - 1]);
             state.bufferText.erase(state.bufferCursorPos - 1, 1);
             state.bufferCursorPos--;
+            state.bufferLayout.onEdit(state.bufferText, state.bufferCursorPos, 1, 0);
+            state.editHistory.recordErase(state.bufferCursorPos, removed, cursorBefore, state.bufferCursorPos);
         }
     }
     
@@ -307,10 +551,8 @@ void deleteCharAtCursor(GlobalState& state, bool forward) {
         state.clipboardCopied = false;
         state.clipboardLastInputTime = GetTickCount();
         
-        // 只有在暫放視窗沒有焦點時才立即更新剪貼簿
-        if (!state.bufferHasFocus) {
-            updateClipboardInMode(state);
-        }
+        // 連續編輯合併後才寫入剪貼簿
+        notifyClipboardEdit(state);
         
         // 確保窗口重繪以顯示狀態指示器變化
         if (state.hBufferWnd) {
@@ -341,6 +583,8 @@ void deleteCharAtCursor(GlobalState& state, bool forward) {
 }
 
 void moveCursor(GlobalState& state, int direction) {
+    TraceRecorder::Scope trace(TraceRecorder::EVT_BUFFER_MOVE, direction);
+    state.editHistory.breakGroup();
     int newPos = state.bufferCursorPos + direction;
     if (newPos < 0) newPos = 0;
     if (newPos > (int)state.bufferText.length()) newPos = state.bufferText.length();
@@ -355,52 +599,14 @@ void moveCursor(GlobalState& state, int direction) {
 void setCursorPosition(GlobalState& state, int x, int y) {
     if (!state.hBufferWnd) return;
     
-    HDC hdc = GetDC(state.hBufferWnd);
-    if (!hdc) return;
-    
-    HFONT hFont = CreateFontW(state.bufferFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-        DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, state.bufferFontName.c_str());
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
-    
-    int clickX = x - 10;
-    int clickY = y - 10;
-    
-    if (clickX < 0) clickX = 0;
-    if (clickY < 0) clickY = 0;
-    
-    int bestPos = 0;
-    int minDistance = INT_MAX;
-    
-    int currentX = 0;
-    int currentY = 0;
-    
-    for (int i = 0; i <= (int)state.bufferText.length(); i++) {
-        int distance = abs(currentX - clickX) + abs(currentY - clickY) * 2;
-        if (distance < minDistance) {
-            minDistance = distance;
-            bestPos = i;
-        }
-        
-        if (i < (int)state.bufferText.length()) {
-            wchar_t ch = state.bufferText[i];
-            SIZE charSize;
-            GetTextExtentPoint32W(hdc, &ch, 1, &charSize);
-            
-            currentX += charSize.cx;
-            
-            if (currentX > (FIXED_WIDTH - 30)) {
-                currentX = charSize.cx;
-                currentY += state.bufferFontSize + 2;
-            }
-        }
-    }
+    // 先依 y 找行，再在行內二分搜尋（字元寬度已快取，不需每次建立字型逐字量測）
+    int clickX = std::max(0, x - 10);
+    int clickY = std::max(0, y - 10);
+    int bestPos = (int)getBufferLayout(state).positionFromPoint(state.bufferText, clickX, clickY);
     
     state.bufferCursorPos = bestPos;
-    
-    SelectObject(hdc, hOldFont);
-    DeleteObject(hFont);
-    ReleaseDC(state.hBufferWnd, hdc);
+    state.editHistory.breakGroup();
+    TraceRecorder::record(TraceRecorder::EVT_BUFFER_CURSOR, bestPos);
     
     InvalidateRect(state.hBufferWnd, nullptr, TRUE);
 }
@@ -515,14 +721,21 @@ void cutSelection(GlobalState& state) {
 
 void deleteSelection(GlobalState& state) {
     if (!state.hasSelection) return;
-	saveSnapshot(state);
+    TraceRecorder::Scope trace(TraceRecorder::EVT_BUFFER_DELETE_SELECTION, state.selectionStart, state.selectionEnd);
     
     int start = std::min(state.selectionStart, state.selectionEnd);
     int end = std::max(state.selectionStart, state.selectionEnd);
     
     if (start >= 0 && end <= (int)state.bufferText.length()) {
+        // 刪除選取範圍自成一組，不與前後的輸入合併
+        std::wstring removed = state.bufferText.substr(start, end - start);
+        int cursorBefore = state.bufferCursorPos;
         state.bufferText.erase(start, end - start);
         state.bufferCursorPos = start;
+        state.bufferLayout.onEdit(state.bufferText, start, end - start, 0);
+        state.editHistory.breakGroup();
+        state.editHistory.recordErase(start, removed, cursorBefore, start);
+        state.editHistory.breakGroup();
         
         clearSelection(state);
         saveBufferToFile(state);
@@ -533,10 +746,8 @@ void deleteSelection(GlobalState& state) {
             state.clipboardCopied = false;
             state.clipboardLastInputTime = GetTickCount();
             
-            // 只有在暫放視窗沒有焦點時才立即更新剪貼簿
-            if (!state.bufferHasFocus) {
-                updateClipboardInMode(state);
-            }
+            // 連續編輯合併後才寫入剪貼簿
+            notifyClipboardEdit(state);
             
             if (state.hBufferWnd) {
                 InvalidateRect(state.hBufferWnd, nullptr, TRUE);
@@ -556,9 +767,6 @@ void deleteSelection(GlobalState& state) {
 void pasteFromClipboard(GlobalState& state) {
     if (!state.hBufferWnd) return;
     
-    // 保存快照以便撤銷
-    saveSnapshot(state);
-    
     // 從剪貼簿讀取內容
     std::wstring clipboardText = L"";
     if (OpenClipboard(state.hBufferWnd)) {
@@ -578,8 +786,10 @@ void pasteFromClipboard(GlobalState& state) {
         return;
     }
     
-    // 插入到當前游標位置
+    // 插入到當前游標位置（貼上的內容自成一組復原步驟）
+    state.editHistory.breakGroup();
     insertTextAtCursor(state, clipboardText);
+    state.editHistory.breakGroup();
     saveBufferToFile(state);
     
     // 更新暫放視窗
@@ -598,26 +808,33 @@ void pasteFromClipboard(GlobalState& state) {
 }
 
 void updateClipboardInMode(GlobalState& state) {
-    if (!state.clipboardMode || state.bufferText.empty()) return;
+    if (!state.clipboardMode) return;
     
-    // 將暫放文字複製到剪貼簿
-    if (OpenClipboard(state.hBufferWnd ? state.hBufferWnd : NULL)) {
-        EmptyClipboard();
-        
-        size_t size = (state.bufferText.length() + 1) * sizeof(wchar_t);
-        HGLOBAL hClipboardData = GlobalAlloc(GMEM_MOVEABLE, size);
-        
-        if (hClipboardData) {
-            wchar_t* pchData = (wchar_t*)GlobalLock(hClipboardData);
-            if (pchData) {
-                wcscpy_s(pchData, state.bufferText.length() + 1, state.bufferText.c_str());
-                GlobalUnlock(hClipboardData);
-                SetClipboardData(CF_UNICODETEXT, hClipboardData);
-            }
-        }
-        
-        CloseClipboard();
-    }
+    // 內容與剪貼簿上相同時略過；啟用延遲產生時只登記格式，貼上時才複製文字
+    g_clipboardSync.flush(state.bufferText);
+}
+
+void notifyClipboardEdit(GlobalState& state) {
+    if (!state.clipboardMode) return;
+    g_clipboardSync.onEdit();
+}
+
+void onClipboardSyncTimer(GlobalState& state) {
+    if (state.hBufferWnd) KillTimer(state.hBufferWnd, CLIPBOARD_SYNC_TIMER_ID);
+    if (!state.clipboardMode) return;
+    g_clipboardSync.onTimer(state.bufferText);
+}
+
+void renderClipboard(const GlobalState& state) {
+    g_clipboardSync.onRenderRequest(state.bufferText);
+}
+
+void onClipboardDestroyed(GlobalState& state) {
+    g_clipboardSync.onOwnershipLost();
+}
+
+void finalizeClipboard(GlobalState& state) {
+    g_clipboardSync.materialize(state.bufferText);
 }
 
 void checkInputEnd(GlobalState& state) {
@@ -651,10 +868,10 @@ void handleClipboardPaste(GlobalState& state) {
     if (!state.clipboardMode) return;
     
     // 清空暫放視窗
-    state.bufferText.clear();
-    state.bufferCursorPos = 0;
+    clearBufferText(state);
     clearSelection(state);
     saveBufferToFile(state);
+    InputHandler::recordTraceSync(state);
     
     // 重置狀態
     state.clipboardInputting = false;
@@ -691,53 +908,9 @@ std::wstring getSelectedText(const GlobalState& state) {
 int getTextPositionFromPoint(const GlobalState& state, int x, int y) {
     if (!state.hBufferWnd || state.bufferText.empty()) return -1;
     
-    HDC hdc = GetDC(state.hBufferWnd);
-    if (!hdc) return -1;
-    
-    HFONT hFont = CreateFontW(state.bufferFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-        DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, state.bufferFontName.c_str());
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
-    
-    int clickX = x - 10;
-    int clickY = y - 10;
-    
-    if (clickX < 0) clickX = 0;
-    if (clickY < 0) clickY = 0;
-    
-    int bestPos = 0;
-    int minDistance = INT_MAX;
-    
-    int currentX = 0;
-    int currentY = 0;
-    int lineHeight = state.bufferFontSize + 2;
-    
-    for (int i = 0; i <= (int)state.bufferText.length(); i++) {
-        int distance = abs(currentX - clickX) + abs(currentY - clickY);
-        if (distance < minDistance) {
-            minDistance = distance;
-            bestPos = i;
-        }
-        
-        if (i < (int)state.bufferText.length()) {
-            wchar_t ch = state.bufferText[i];
-            SIZE charSize;
-            GetTextExtentPoint32W(hdc, &ch, 1, &charSize);
-            
-            currentX += charSize.cx;
-            
-            if (currentX > (FIXED_WIDTH - 30)) {
-                currentX = charSize.cx;
-                currentY += lineHeight;
-            }
-        }
-    }
-    
-    SelectObject(hdc, hOldFont);
-    DeleteObject(hFont);
-    ReleaseDC(state.hBufferWnd, hdc);
-    
-    return bestPos;
+    int clickX = std::max(0, x - 10);
+    int clickY = std::max(0, y - 10);
+    return (int)getBufferLayout(state).positionFromPoint(state.bufferText, clickX, clickY);
 }
 
 POINT getPointFromTextPosition(const GlobalState& state, int position) {
@@ -747,77 +920,271 @@ POINT getPointFromTextPosition(const GlobalState& state, int position) {
         return pt;
     }
     
-    HDC hdc = GetDC(state.hBufferWnd);
-    if (!hdc) return pt;
-    
-    HFONT hFont = CreateFontW(state.bufferFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-        DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, state.bufferFontName.c_str());
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
-    
-    int currentX = 10;
-    int currentY = 10;
-    int lineHeight = state.bufferFontSize + 2;
-    
-    for (int i = 0; i < position && i < (int)state.bufferText.length(); i++) {
-        wchar_t ch = state.bufferText[i];
-        SIZE charSize;
-        GetTextExtentPoint32W(hdc, &ch, 1, &charSize);
-        
-        currentX += charSize.cx;
-        
-        if (currentX > (FIXED_WIDTH - 30)) {
-            currentX = 10 + charSize.cx;
-            currentY += lineHeight;
+    LayoutPoint layoutPt = getBufferLayout(state).pointFromPosition(state.bufferText, position);
+    pt.x = 10 + layoutPt.x;
+    pt.y = 10 + layoutPt.y;
+    return pt;
+}
+
+RECT getCursorRect(const GlobalState& state) {
+    POINT pt = getPointFromTextPosition(state, state.bufferCursorPos);
+    RECT rc = {pt.x - 1, pt.y, pt.x + 2, pt.y + state.bufferFontSize + 1};
+    return rc;
+}
+
+// ========== 搜尋與取代 ==========
+
+// 取代後調整視窗高度並同步剪貼簿、存檔
+static void afterBulkEdit(GlobalState& state) {
+    saveBufferToFile(state);
+    if (state.clipboardMode) {
+        state.clipboardInputting = true;
+        state.clipboardCopied = false;
+        state.clipboardLastInputTime = GetTickCount();
+        notifyClipboardEdit(state);
+    }
+    if (state.hBufferWnd) {
+        int windowHeight = calculateBufferWindowHeight(state);
+        if (state.useOptimizedUI) {
+            RECT currentBufferRect;
+            GetWindowRect(state.hBufferWnd, &currentBufferRect);
+            SetWindowPos(state.hBufferWnd, NULL,
+                        currentBufferRect.left, currentBufferRect.top,
+                        FIXED_WIDTH, windowHeight,
+                        SWP_NOZORDER);
+        } else {
+            SetWindowPos(state.hBufferWnd, NULL, 0, 0, FIXED_WIDTH, windowHeight,
+                        SWP_NOMOVE | SWP_NOZORDER);
         }
+        InvalidateRect(state.hBufferWnd, nullptr, TRUE);
     }
-    
-    pt.x = currentX;
-    pt.y = currentY;
-    
-    SelectObject(hdc, hOldFont);
-    DeleteObject(hFont);
-    ReleaseDC(state.hBufferWnd, hdc);
-    
-    return pt;
+    InputHandler::recordTraceSync(state);
 }
 
-//歷史記錄管理函數
+// 把 pos 的相符設為選取範圍，游標放在結尾；同時算出它是第幾個
+static void selectMatch(GlobalState& state, size_t pos) {
+    size_t m = state.findQuery.length();
+    state.selectionStart = (int)pos;
+    state.selectionEnd = (int)(pos + m);
+    state.hasSelection = true;
+    state.isSelecting = false;
+    state.bufferCursorPos = (int)(pos + m);
+    state.editHistory.breakGroup();
 
-void saveSnapshot(GlobalState& state) {
-    GlobalState::TextSnapshot snapshot;
-    snapshot.text = state.bufferText;
-    snapshot.cursorPos = state.bufferCursorPos;
-    
-    state.undoHistory.push_back(snapshot);
-    
-    // 限制歷史記錄大小
-    if (state.undoHistory.size() > (size_t)state.maxHistorySize) {
-        state.undoHistory.erase(state.undoHistory.begin());
+    // 目前相符之前有幾個（不重疊計算，與 countMatches 一致）
+    // 索引只在文字或搜尋字串改變後重建；連按 F3 時只搜尋最近記錄之後的一小段
+    TextSearch::Pattern pattern(state.findQuery);
+    if (!state.findIndex.current(state.bufferText, pattern)) state.findIndex.build(state.bufferText, pattern);
+    state.findMatchCount = (int)state.findIndex.count();
+    state.findMatchIndex = (int)state.findIndex.countBefore(state.bufferText, pattern, pos + m);
+}
+
+// 重新計算相符數，並從 from 往後選取第一個相符（找不到時從頭找）
+static void refreshFind(GlobalState& state, size_t from) {
+    state.findMatchCount = 0;
+    state.findMatchIndex = 0;
+    if (state.findQuery.empty()) {
+        clearSelection(state);
+        return;
     }
-    
-    // 新操作會清空 redo 歷史
-    state.redoHistory.clear();
+    TextSearch::Pattern pattern(state.findQuery);
+    if (!state.findIndex.current(state.bufferText, pattern)) state.findIndex.build(state.bufferText, pattern);
+    state.findMatchCount = (int)state.findIndex.count();
+    if (state.findMatchCount == 0) {
+        state.hasSelection = false;
+        state.selectionStart = -1;
+        state.selectionEnd = -1;
+        return;
+    }
+    size_t pos = TextSearch::findNext(state.bufferText, pattern, from);
+    if (pos == TextModel::npos) pos = TextSearch::findNext(state.bufferText, pattern, 0);
+    if (pos != TextModel::npos) selectMatch(state, pos);
 }
 
+static bool currentSelectionMatches(const GlobalState& state) {
+    if (!state.hasSelection || state.findQuery.empty()) return false;
+    int start = std::min(state.selectionStart, state.selectionEnd);
+    int end = std::max(state.selectionStart, state.selectionEnd);
+    if (end - start != (int)state.findQuery.length() || end > (int)state.bufferText.length()) return false;
+    return state.bufferText.substr(start, end - start) == state.findQuery;
+}
+
+static void findStep(GlobalState& state, bool forward) {
+    if (state.findQuery.empty()) return;
+    TextSearch::Pattern pattern(state.findQuery);
+    size_t len = state.bufferText.length();
+    size_t pos;
+    if (forward) {
+        // 從目前相符的下一個字元開始，避免停在原處
+        size_t from = currentSelectionMatches(state)
+            ? (size_t)std::min(state.selectionStart, state.selectionEnd) + 1
+            : (size_t)state.bufferCursorPos;
+        pos = TextSearch::findNext(state.bufferText, pattern, std::min(from, len));
+        if (pos == TextModel::npos) pos = TextSearch::findNext(state.bufferText, pattern, 0);
+    } else {
+        size_t before = currentSelectionMatches(state)
+            ? (size_t)std::min(state.selectionStart, state.selectionEnd)
+            : (size_t)state.bufferCursorPos;
+        pos = TextSearch::findPrev(state.bufferText, pattern, before);
+        if (pos == TextModel::npos) pos = TextSearch::findPrev(state.bufferText, pattern, len);
+    }
+    if (pos == TextModel::npos) {
+        state.findMatchCount = 0;
+        state.findMatchIndex = 0;
+        return;
+    }
+    selectMatch(state, pos);
+}
+
+static void replaceCurrent(GlobalState& state) {
+    if (!currentSelectionMatches(state)) {
+        // 尚未停在相符上：先找到下一個，再按一次才取代
+        findStep(state, true);
+        return;
+    }
+    int start = std::min(state.selectionStart, state.selectionEnd);
+    size_t m = state.findQuery.length();
+    int cursorBefore = state.bufferCursorPos;
+
+    state.editHistory.beginGroup();
+    state.bufferText.erase(start, m);
+    state.editHistory.recordErase(start, state.findQuery, cursorBefore, start);
+    state.bufferText.insert(start, state.findReplaceText);
+    int cursorAfter = start + (int)state.findReplaceText.length();
+    state.editHistory.recordInsert(start, state.findReplaceText, start, cursorAfter);
+    state.editHistory.endGroup();
+    state.bufferLayout.onEdit(state.bufferText, start, m, state.findReplaceText.length());
+    state.bufferCursorPos = cursorAfter;
+
+    afterBulkEdit(state);
+    refreshFind(state, cursorAfter);
+}
+
+static void replaceAll(GlobalState& state) {
+    if (state.findQuery.empty()) return;
+    TextSearch::Pattern pattern(state.findQuery);
+    std::vector<size_t> matches;
+    TextSearch::findAll(state.bufferText, pattern, 0, state.bufferText.length(), matches);
+    if (matches.empty()) {
+        Utils::updateStatus(state, L"找不到「" + state.findQuery + L"」");
+        return;
+    }
+    // 由後往前取代，前面相符的位置不受影響；整批為一個復原步驟
+    size_t m = state.findQuery.length();
+    size_t r = state.findReplaceText.length();
+    int cursor = state.bufferCursorPos;
+    state.editHistory.beginGroup();
+    for (size_t i = matches.size(); i-- > 0; ) {
+        size_t pos = matches[i];
+        state.bufferText.erase(pos, m);
+        state.editHistory.recordErase(pos, state.findQuery, cursor, (int)pos);
+        state.bufferText.insert(pos, state.findReplaceText);
+        state.editHistory.recordInsert(pos, state.findReplaceText, (int)pos, (int)(pos + r));
+        cursor = (int)(pos + r);
+        if ((size_t)state.bufferCursorPos > pos) {
+            // 游標在此相符之後：隨長度差移動；在相符內部則移到取代結果結尾
+            state.bufferCursorPos = (size_t)state.bufferCursorPos >= pos + m
+                ? (int)(state.bufferCursorPos - m + r)
+                : (int)(pos + r);
+        }
+    }
+    state.editHistory.endGroup();
+    state.bufferLayout.invalidate();
+    clearSelection(state);
+
+    afterBulkEdit(state);
+    state.findMatchCount = (int)TextSearch::countMatches(state.bufferText, pattern);
+    state.findMatchIndex = 0;
+    Utils::updateStatus(state, L"已取代 " + std::to_wstring(matches.size()) + L" 處");
+}
+
+static void openFind(GlobalState& state, bool replace) {
+    state.findReplaceMode = state.findReplaceMode || replace;
+    state.findField = (replace && !state.findQuery.empty()) ? 1 : 0;
+    // 搜尋列已開啟：只切換欄位，停留在目前相符
+    if (state.findActive) return;
+
+    state.findActive = true;
+    state.findAnchor = state.bufferCursorPos;
+    // 有選取時以選取文字作為搜尋字串（多行選取除外）
+    std::wstring selected = getSelectedText(state);
+    if (!selected.empty() && selected.find(L'\n') == std::wstring::npos) {
+        state.findQuery = selected;
+        state.findAnchor = std::min(state.selectionStart, state.selectionEnd);
+        if (replace) state.findField = 1;
+    }
+    refreshFind(state, state.findAnchor);
+}
+
+static void closeFind(GlobalState& state) {
+    state.findActive = false;
+    state.findReplaceMode = false;
+    state.findField = 0;
+    state.findMatchCount = 0;
+    state.findMatchIndex = 0;
+    state.findIndex.clear();
+}
+
+void handleFindCommand(GlobalState& state, FindCommand command) {
+    if (!state.bufferMode) return;
+    if (!state.findActive && command != FIND_OPEN && command != FIND_OPEN_REPLACE) return;
+
+    switch (command) {
+    case FIND_OPEN:         openFind(state, false); break;
+    case FIND_OPEN_REPLACE: openFind(state, true); break;
+    case FIND_NEXT:         findStep(state, true); break;
+    case FIND_PREV:         findStep(state, false); break;
+    case FIND_SWITCH_FIELD:
+        if (state.findReplaceMode) state.findField = 1 - state.findField;
+        break;
+    case FIND_REPLACE:      replaceCurrent(state); break;
+    case FIND_REPLACE_ALL:  replaceAll(state); break;
+    case FIND_CLOSE:        closeFind(state); break;
+    }
+
+    if (state.hBufferWnd) {
+        InvalidateRect(state.hBufferWnd, nullptr, TRUE);
+    }
+}
+
+// 搜尋列開啟時，輸入法送出的文字進入目前欄位；搜尋字串改變時重新增量搜尋
+static void findInputText(GlobalState& state, const std::wstring& text) {
+    if (state.findField == 1) {
+        state.findReplaceText += text;
+    } else {
+        state.findQuery += text;
+        refreshFind(state, state.findAnchor);
+    }
+    if (state.hBufferWnd) {
+        InvalidateRect(state.hBufferWnd, nullptr, TRUE);
+    }
+}
+
+static void findBackspace(GlobalState& state) {
+    std::wstring& field = state.findField == 1 ? state.findReplaceText : state.findQuery;
+    if (field.empty()) return;
+    field.erase(field.length() - 1);
+    if (state.findField == 0) refreshFind(state, state.findAnchor);
+    if (state.hBufferWnd) {
+        InvalidateRect(state.hBufferWnd, nullptr, TRUE);
+    }
+}
+
+//歷史記錄管理函數
+
 void undo(GlobalState& state) {
-    if (state.undoHistory.empty()) {
+    if (!state.editHistory.canUndo()) {
         Utils::updateStatus(state, L"沒有可復原的操作");
         return;
     }
     
-    // 保存當前狀態到 redo 歷史
-    GlobalState::TextSnapshot currentSnapshot;
-    currentSnapshot.text = state.bufferText;
-    currentSnapshot.cursorPos = state.bufferCursorPos;
-    state.redoHistory.push_back(currentSnapshot);
-    
-    // 恢復上一個狀態
-    GlobalState::TextSnapshot snapshot = state.undoHistory.back();
-    state.undoHistory.pop_back();
-    
-    state.bufferText = snapshot.text;
-    state.bufferCursorPos = snapshot.cursorPos;
+    // 套用反向操作（只處理被編輯的文字，與暫放內容長度無關）
+    state.bufferLayout.invalidate();
+    if (!state.editHistory.undo(state.bufferText, state.bufferCursorPos)) {
+        Utils::updateStatus(state, L"復原歷史與內容不一致，已清除歷史");
+        return;
+    }
+    clearSelection(state);
     
     // 更新視窗
     if (state.hBufferWnd) {
@@ -839,27 +1206,22 @@ void undo(GlobalState& state) {
     }
     
     saveBufferToFile(state);
+    InputHandler::recordTraceSync(state);
     Utils::updateStatus(state, L"已復原");
 }
 
 void redo(GlobalState& state) {
-    if (state.redoHistory.empty()) {
+    if (!state.editHistory.canRedo()) {
         Utils::updateStatus(state, L"沒有可重做的操作");
         return;
     }
     
-    // 保存當前狀態到 undo 歷史
-    GlobalState::TextSnapshot currentSnapshot;
-    currentSnapshot.text = state.bufferText;
-    currentSnapshot.cursorPos = state.bufferCursorPos;
-    state.undoHistory.push_back(currentSnapshot);
-    
-    // 恢復下一個狀態
-    GlobalState::TextSnapshot snapshot = state.redoHistory.back();
-    state.redoHistory.pop_back();
-    
-    state.bufferText = snapshot.text;
-    state.bufferCursorPos = snapshot.cursorPos;
+    state.bufferLayout.invalidate();
+    if (!state.editHistory.redo(state.bufferText, state.bufferCursorPos)) {
+        Utils::updateStatus(state, L"復原歷史與內容不一致，已清除歷史");
+        return;
+    }
+    clearSelection(state);
     
     // 更新視窗
     if (state.hBufferWnd) {
@@ -881,12 +1243,12 @@ void redo(GlobalState& state) {
     }
     
     saveBufferToFile(state);
+    InputHandler::recordTraceSync(state);
     Utils::updateStatus(state, L"已重做");
 }
 
 void clearHistory(GlobalState& state) {
-    state.undoHistory.clear();
-    state.redoHistory.clear();
+    state.editHistory.clear();
 }
 
 } // namespace BufferManager
@@ -12,7 +12,12 @@ namespace BufferManager {
     int calculateBufferWindowHeight(const GlobalState& state);
     void saveBufferToFile(const GlobalState& state);
     void loadBufferFromFile(GlobalState& state);
+    // 程式結束前寫完編輯日誌並更新 text_buffer.txt
+    void shutdownJournal(GlobalState& state);
+    // 另存到 stroke_日期_時間.txt；編輯日誌執行中時在背景寫出，完成後以 WM_USER+104 通知
     void saveBufferToTimestampedFile(const GlobalState& state);
+    // WM_USER+104：背景另存的進度與結果
+    void onExportProgress(GlobalState& state, WPARAM kind, LPARAM percent);
     
     // 暫放內容操作
     void sendBufferContent(GlobalState& state);
@@ -38,8 +43,18 @@ namespace BufferManager {
     // 剪貼簿模式：從剪貼簿貼上文字（貼上後清空剪貼簿）
     void pasteFromClipboard(GlobalState& state);
     
-    // 剪貼簿模式：更新剪貼簿（實時複製暫放文字）
+    // 剪貼簿模式：立即同步剪貼簿（內容未變時略過）
     void updateClipboardInMode(GlobalState& state);
+    // 剪貼簿模式：暫放文字已改變，合併連續編輯後再同步
+    void notifyClipboardEdit(GlobalState& state);
+    // 剪貼簿同步計時器到期（暫放視窗 WM_TIMER）
+    void onClipboardSyncTimer(GlobalState& state);
+    // 其他程式貼上時產生剪貼簿資料（WM_RENDERFORMAT / WM_RENDERALLFORMATS）
+    void renderClipboard(const GlobalState& state);
+    // 剪貼簿已被清空（WM_DESTROYCLIPBOARD）
+    void onClipboardDestroyed(GlobalState& state);
+    // 文字即將清空或關閉剪貼簿模式：把仍在延遲狀態的內容實際放上剪貼簿
+    void finalizeClipboard(GlobalState& state);
     
     // 剪貼簿模式：檢查輸入結束並更新狀態
     void checkInputEnd(GlobalState& state);
@@ -50,12 +65,31 @@ namespace BufferManager {
     // 座標轉換
     int getTextPositionFromPoint(const GlobalState& state, int x, int y);
     POINT getPointFromTextPosition(const GlobalState& state, int position);
+    // 游標所佔的矩形（游標閃爍時只重繪此區域）
+    RECT getCursorRect(const GlobalState& state);
+    
+    // 暫放區換行排版（命中測試、視窗高度與繪製共用）
+    TextLayout& getBufferLayout(const GlobalState& state);
+    // 暫放區的字型：與排版的字寬量測共用，字型名稱或大小改變時才重建（呼叫端不可刪除）
+    HFONT getBufferFont(const GlobalState& state);
     
     // 獲取選取的文字
     std::wstring getSelectedText(const GlobalState& state);
 	
-	// 歷史記錄管理
-    void saveSnapshot(GlobalState& state);
+    // 搜尋與取代（搜尋列開啟時 insertTextAtCursor/deleteCharAtCursor 改為編輯搜尋列）
+    enum FindCommand {
+        FIND_OPEN,            // Ctrl+F
+        FIND_OPEN_REPLACE,    // Ctrl+H
+        FIND_NEXT,            // Enter / F3
+        FIND_PREV,            // Shift+Enter / Shift+F3
+        FIND_SWITCH_FIELD,    // Tab：搜尋/取代欄位切換
+        FIND_REPLACE,         // 取代欄位中按 Enter
+        FIND_REPLACE_ALL,     // Ctrl+Enter
+        FIND_CLOSE            // Esc
+    };
+    void handleFindCommand(GlobalState& state, FindCommand command);
+	
+	// 歷史記錄管理（記錄編輯操作，見 edit_history.h）
     void undo(GlobalState& state);
     void redo(GlobalState& state);
     void clearHistory(GlobalState& state);
@@ -0,0 +1,141 @@
+// clipboard_sync.cpp - 剪貼簿模式同步實作
+#include "clipboard_sync.h"
+#include "file_io.h"
+
+namespace ClipboardSync {
+
+const unsigned ClipboardSyncer::DEFAULT_DEBOUNCE_MS;
+const unsigned ClipboardSyncer::DEFAULT_MAX_DELAY_MS;
+
+ClipboardSyncer::ClipboardSyncer(ClipboardEnvironment& env, unsigned debounceMs, unsigned maxDelayMs)
+    : env_(env), debounceMs_(debounceMs), maxDelayMs_(maxDelayMs), delayedRendering_(true),
+      dirty_(false), firstEdit_(0), timerArmed_(false),
+      owned_(false), rendered_(false), hash_(0), frozen_(false),
+      writes_(0), skips_(0), renders_(0) {}
+
+uint64_t ClipboardSyncer::contentHash(const TextModel& text) {
+    uint64_t hash = FileIO::FNV64_OFFSET;
+    text.forEachChunk([&hash](const wchar_t* data, size_t count) {
+        hash = FileIO::fnv64(data, count * sizeof(wchar_t), hash);
+    });
+    return hash;
+}
+
+void ClipboardSyncer::disarm() {
+    if (timerArmed_) {
+        timerArmed_ = false;
+        env_.cancelFlush();
+    }
+}
+
+void ClipboardSyncer::onEdit() {
+    // 已登記延遲產生且尚未被貼上：貼上時會直接取目前文字，不需重寫
+    if (owned_ && !rendered_ && !frozen_) return;
+
+    uint32_t now = env_.now();
+    if (!dirty_) {
+        dirty_ = true;
+        firstEdit_ = now;
+    }
+
+    // 每次編輯重新計時，但從這一批第一次編輯起最多延遲 maxDelayMs_
+    uint32_t elapsed = now - firstEdit_;
+    unsigned delay = 0;
+    if (elapsed < maxDelayMs_) {
+        delay = maxDelayMs_ - elapsed;
+        if (delay > debounceMs_) delay = debounceMs_;
+    }
+    timerArmed_ = true;
+    env_.scheduleFlush(delay);
+}
+
+void ClipboardSyncer::onTimer(const TextModel& text) {
+    timerArmed_ = false;
+    if (dirty_) flush(text);
+}
+
+void ClipboardSyncer::flush(const TextModel& text) {
+    disarm();
+    dirty_ = false;
+    // 與原本行為相同：暫放區為空時不清除剪貼簿
+    if (text.empty()) return;
+
+    if (owned_ && !rendered_ && !frozen_) {
+        skips_++;
+        return;
+    }
+    uint64_t hash = contentHash(text);
+    if (owned_ && (rendered_ || frozen_) && hash == hash_) {
+        skips_++;
+        return;
+    }
+
+    if (delayedRendering_ && env_.announce()) {
+        owned_ = true;
+        rendered_ = false;
+        frozen_ = false;
+        frozenText_.clear();
+        writes_++;
+        return;
+    }
+    if (env_.publish(text)) {
+        owned_ = true;
+        rendered_ = true;
+        hash_ = hash;
+        frozen_ = false;
+        frozenText_.clear();
+        writes_++;
+    }
+}
+
+void ClipboardSyncer::onRenderRequest(const TextModel& text) {
+    bool live = !frozen_;
+    const TextModel& source = frozen_ ? frozenText_ : text;
+    if (!env_.render(source)) return;
+
+    renders_++;
+    rendered_ = true;
+    hash_ = contentHash(source);
+    frozen_ = false;
+    frozenText_.clear();
+
+    // 以目前文字產生時，尚未同步的編輯也已包含在內
+    if (live && dirty_) {
+        dirty_ = false;
+        disarm();
+    }
+}
+
+void ClipboardSyncer::onOwnershipLost() {
+    owned_ = false;
+    rendered_ = false;
+    frozen_ = false;
+    frozenText_.clear();
+}
+
+void ClipboardSyncer::materialize(const TextModel& text) {
+    bool lazy = owned_ && !rendered_ && !frozen_;
+    if (!lazy && !dirty_) return;
+    disarm();
+
+    if (!text.empty() && env_.publish(text)) {
+        owned_ = true;
+        rendered_ = true;
+        hash_ = contentHash(text);
+        frozen_ = false;
+        frozenText_.clear();
+        dirty_ = false;
+        writes_++;
+        return;
+    }
+
+    // 剪貼簿暫時無法開啟（例如其他程式正在讀取）：保留目前文字，待貼上要求時使用
+    if (owned_ && !rendered_) {
+        frozenText_ = text.str();
+        frozen_ = true;
+        hash_ = contentHash(frozenText_);
+    }
+    dirty_ = false;
+}
+
+}
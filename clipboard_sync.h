@@ -0,0 +1,102 @@
+// clipboard_sync.h - 剪貼簿模式的同步：合併連續編輯、內容未變不重寫、延遲產生資料（可攜式，不依賴 Windows API）
+#ifndef CLIPBOARD_SYNC_H
+#define CLIPBOARD_SYNC_H
+
+#include "text_model.h"
+#include <cstdint>
+
+namespace ClipboardSync {
+    // 剪貼簿與計時器：Windows 上以剪貼簿 API 與 SetTimer 實作，測試時可替換成假剪貼簿
+    class ClipboardEnvironment {
+    public:
+        virtual ~ClipboardEnvironment() {}
+
+        virtual uint32_t now() = 0;                         // 目前時間（毫秒，可回繞）
+
+        // 取得剪貼簿擁有權並只登記文字格式，資料待其他程式貼上時才由 render 產生
+        // 無法延遲產生（例如沒有擁有者視窗）時回傳 false
+        virtual bool announce() = 0;
+        // 清空剪貼簿並立即寫入完整文字
+        virtual bool publish(const TextModel& text) = 0;
+        // 回應貼上要求：剪貼簿已由要求方開啟，只需放入資料
+        virtual bool render(const TextModel& text) = 0;
+
+        // 請求在 ms 毫秒後呼叫 onTimer（重複呼叫會覆蓋前一次）
+        virtual void scheduleFlush(unsigned ms) = 0;
+        virtual void cancelFlush() = 0;
+    };
+
+    // 同步規則：
+    // - 編輯只記錄時間並重設計時器；停止輸入 debounceMs 後才寫入，
+    //   持續輸入時最多延遲 maxDelayMs
+    // - 寫入前比對內容雜湊，與剪貼簿上已有的相同時略過
+    // - 啟用延遲產生時只登記格式；在被貼上前繼續編輯也不需重寫，貼上時直接取目前文字
+    // - 文字即將被清空或不再同步時先產生資料，剪貼簿保留原本的內容
+    class ClipboardSyncer {
+    public:
+        static const unsigned DEFAULT_DEBOUNCE_MS = 150;
+        static const unsigned DEFAULT_MAX_DELAY_MS = 1000;
+
+        explicit ClipboardSyncer(ClipboardEnvironment& env,
+                                 unsigned debounceMs = DEFAULT_DEBOUNCE_MS,
+                                 unsigned maxDelayMs = DEFAULT_MAX_DELAY_MS);
+
+        void setDelayedRendering(bool enabled) { delayedRendering_ = enabled; }
+        bool delayedRendering() const { return delayedRendering_; }
+
+        // 暫放文字已改變
+        void onEdit();
+        // 計時器到期
+        void onTimer(const TextModel& text);
+        // 立即同步（失去焦點、輸入結束、開啟剪貼簿模式時）
+        void flush(const TextModel& text);
+
+        // 其他程式要求資料（WM_RENDERFORMAT / WM_RENDERALLFORMATS）
+        void onRenderRequest(const TextModel& text);
+        // 剪貼簿已被其他程式（或自己）清空（WM_DESTROYCLIPBOARD）
+        void onOwnershipLost();
+
+        // 文字即將被清空或剪貼簿模式關閉：仍在延遲狀態時先把目前文字放到剪貼簿
+        void materialize(const TextModel& text);
+
+        bool pending() const { return dirty_; }
+        bool owned() const { return owned_; }
+        bool rendered() const { return rendered_; }
+
+        // 統計用
+        unsigned writeCount() const { return writes_; }
+        unsigned skipCount() const { return skips_; }
+        unsigned renderCount() const { return renders_; }
+
+        // 內容雜湊（FNV-1a 64 位元，依片段計算不需組成完整字串）
+        static uint64_t contentHash(const TextModel& text);
+
+    private:
+        ClipboardSyncer(const ClipboardSyncer&);
+        ClipboardSyncer& operator=(const ClipboardSyncer&);
+
+        void disarm();
+
+        ClipboardEnvironment& env_;
+        unsigned debounceMs_;
+        unsigned maxDelayMs_;
+        bool delayedRendering_;
+
+        bool dirty_;            // 有尚未同步的編輯
+        uint32_t firstEdit_;    // 這一批編輯中第一次編輯的時間
+        bool timerArmed_;
+
+        bool owned_;            // 剪貼簿目前是否為我們寫入的內容
+        bool rendered_;         // 已放入實際資料（否則仍在延遲產生狀態）
+        uint64_t hash_;         // 已放入資料的雜湊（rendered_ 時有效）
+
+        bool frozen_;           // 產生資料失敗時保留當時的文字，待貼上時使用
+        TextModel frozenText_;
+
+        unsigned writes_;
+        unsigned skips_;
+        unsigned renders_;
+    };
+}
+
+#endif // CLIPBOARD_SYNC_H
@@ -1,7 +1,10 @@
 // config_loader.cpp - 設定檔載入實作
 #include "config_loader.h"
+#include "config_schema.h"
+#include "buffer_manager.h"
 #include "dictionary.h"
 #include "window_manager.h"
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -97,246 +100,309 @@ void createDefaultConfigFile() {
     fout << "transparency_alpha=100" << std::endl;
     fout << "; 聯想字功能開關（0=關閉，1=開啟）" << std::endl;
     fout << "enable_word_prediction=0" << std::endl;
+    fout << "; 文字輸出每批字元數（1-1024）" << std::endl;
+    fout << "output_max_chunk=64" << std::endl;
+    fout << "; 文字輸出批次間延遲（毫秒，0-200）" << std::endl;
+    fout << "output_chunk_delay=4" << std::endl;
+    fout << "; 暫放區復原歷史上限（KB，64-65536）" << std::endl;
+    fout << "undo_history_kb=4096" << std::endl;
     
     fout.close();
 }
 
+// ========== 設定鍵表 ==========
+
+// 值改變後（熱重新載入時）需要的處理
+enum ConfigEffect {
+    EFFECT_NONE = 0,
+    EFFECT_REDRAW = 1,          // 重繪所有視窗
+    EFFECT_TRANSPARENCY = 2,    // 重新套用半透明
+    EFFECT_TOPMOST = 4,         // 重設前置維護計時器
+    EFFECT_CLIPBOARD = 8        // 剪貼簿模式切換
+};
+
+// 一個設定鍵：描述（區段、型別、範圍）加上對應的 GlobalState 欄位
+// 四種欄位指標只會有一個非空；都為空時由 apply 處理
+struct ConfigBinding {
+    ConfigSchema::KeyDef def;
+    COLORREF GlobalState::* colorField;
+    int GlobalState::* intField;
+    bool GlobalState::* boolField;
+    std::wstring GlobalState::* textField;
+    void (*apply)(GlobalState& state, const ConfigSchema::Value& value);
+    unsigned effects;
+};
+
+static ConfigBinding makeBinding(const char* section, const char* key, ConfigSchema::ValueType type,
+                                 int minValue, int maxValue, unsigned effects) {
+    ConfigBinding binding = {{section, key, type, minValue, maxValue},
+                             nullptr, nullptr, nullptr, nullptr, nullptr, effects};
+    return binding;
+}
+
+static ConfigBinding colorKey(const char* key, COLORREF GlobalState::* field) {
+    ConfigBinding binding = makeBinding("Colors", key, ConfigSchema::TYPE_COLOR, 0, 0, EFFECT_REDRAW);
+    binding.colorField = field;
+    return binding;
+}
+
+static ConfigBinding intKey(const char* section, const char* key, int GlobalState::* field,
+                            int minValue, int maxValue, unsigned effects) {
+    ConfigBinding binding = makeBinding(section, key, ConfigSchema::TYPE_INT, minValue, maxValue, effects);
+    binding.intField = field;
+    return binding;
+}
+
+static ConfigBinding boolKey(const char* section, const char* key, bool GlobalState::* field, unsigned effects) {
+    ConfigBinding binding = makeBinding(section, key, ConfigSchema::TYPE_BOOL, 0, 1, effects);
+    binding.boolField = field;
+    return binding;
+}
+
+static ConfigBinding fontNameKey(const char* key, std::wstring GlobalState::* field) {
+    ConfigBinding binding = makeBinding("Font", key, ConfigSchema::TYPE_STRING, 0, 0, EFFECT_REDRAW);
+    binding.textField = field;
+    return binding;
+}
+
+static ConfigBinding customKey(const char* section, const char* key, ConfigSchema::ValueType type,
+                               int minValue, int maxValue,
+                               void (*apply)(GlobalState&, const ConfigSchema::Value&), unsigned effects) {
+    ConfigBinding binding = makeBinding(section, key, type, minValue, maxValue, effects);
+    binding.apply = apply;
+    return binding;
+}
+
+static void applyUndoHistoryKb(GlobalState& state, const ConfigSchema::Value& value) {
+    state.editHistory.setBudget((size_t)value.number * 1024);
+}
+
+static const ConfigBinding CONFIG_KEYS[] = {
+    // 主視窗顏色
+    colorKey("background_color", &GlobalState::bgColor),
+    colorKey("text_color", &GlobalState::textColor),
+    colorKey("selection_color", &GlobalState::selColor),
+    colorKey("selection_bg_color", &GlobalState::selBgColor),
+    colorKey("error_color", &GlobalState::errorColor),
+    colorKey("close_button_color", &GlobalState::closeButtonColor),
+    colorKey("close_button_hover_color", &GlobalState::closeButtonHoverColor),
+    colorKey("mode_button_color", &GlobalState::modeButtonColor),
+    colorKey("mode_button_hover_color", &GlobalState::modeButtonHoverColor),
+    colorKey("credits_button_color", &GlobalState::creditsButtonColor),
+    colorKey("credits_button_hover_color", &GlobalState::creditsButtonHoverColor),
+    colorKey("refresh_button_color", &GlobalState::refreshButtonColor),
+    colorKey("refresh_button_hover_color", &GlobalState::refreshButtonHoverColor),
+    // 候選字視窗顏色
+    colorKey("candidate_background_color", &GlobalState::candidateBackgroundColor),
+    colorKey("candidate_text_color", &GlobalState::candidateTextColor),
+    colorKey("selected_candidate_bg_color", &GlobalState::selectedCandidateBackgroundColor),
+    colorKey("selected_candidate_text_color", &GlobalState::selectedCandidateTextColor),
+    // 字碼輸入視窗顏色
+    colorKey("input_background_color", &GlobalState::inputBackgroundColor),
+    colorKey("input_text_color", &GlobalState::inputTextColor),
+    colorKey("input_error_text_color", &GlobalState::inputErrorTextColor),
+    colorKey("input_hint_text_color", &GlobalState::inputHintTextColor),
+    colorKey("input_border_color", &GlobalState::inputBorderColor),
+    // 暫放視窗顏色
+    colorKey("buffer_background_color", &GlobalState::bufferBackgroundColor),
+    colorKey("buffer_text_color", &GlobalState::bufferTextColor),
+    colorKey("buffer_cursor_color", &GlobalState::bufferCursorColor),
+
+    // 字型
+    intKey("Font", "font_size", &GlobalState::fontSize, 8, 72, EFFECT_REDRAW),
+    fontNameKey("font_name", &GlobalState::fontName),
+    intKey("Font", "candidate_font_size", &GlobalState::candidateFontSize, 8, 72, EFFECT_REDRAW),
+    fontNameKey("candidate_font_name", &GlobalState::candidateFontName),
+    intKey("Font", "input_font_size", &GlobalState::inputFontSize, 8, 72, EFFECT_REDRAW),
+    fontNameKey("input_font_name", &GlobalState::inputFontName),
+    intKey("Font", "buffer_font_size", &GlobalState::bufferFontSize, 8, 72, EFFECT_REDRAW),
+    fontNameKey("buffer_font_name", &GlobalState::bufferFontName),
+
+    // 視窗大小（下次建立或重新定位視窗時生效）
+    intKey("Window", "window_width", &GlobalState::windowWidth, 300, 1000, EFFECT_NONE),
+    intKey("Window", "window_height", &GlobalState::windowHeight, 50, 200, EFFECT_NONE),
+    intKey("Window", "candidate_window_width", &GlobalState::candidateWidth, 200, 1000, EFFECT_NONE),
+    intKey("Window", "candidate_window_height", &GlobalState::candidateHeight, 100, 600, EFFECT_NONE),
+    intKey("Window", "input_window_width", &GlobalState::inputWindowWidth, 200, 800, EFFECT_NONE),
+    intKey("Window", "input_window_height", &GlobalState::inputWindowHeight, 20, 100, EFFECT_NONE),
+
+    // 視窗行為
+    intKey("WindowBehavior", "topmost_check_interval", &GlobalState::topmostCheckInterval, 1000, 60000, EFFECT_TOPMOST),
+    boolKey("WindowBehavior", "force_stay_on_top", &GlobalState::forceStayOnTop, EFFECT_TOPMOST),
+    intKey("WindowBehavior", "refocus_delay", &GlobalState::refocusDelay, 0, 1000, EFFECT_NONE),
+    boolKey("WindowBehavior", "clipboard_mode", &GlobalState::clipboardMode, EFFECT_CLIPBOARD | EFFECT_REDRAW),
+    boolKey("WindowBehavior", "enable_transparency", &GlobalState::enableTransparency, EFFECT_TRANSPARENCY),
+    intKey("WindowBehavior", "transparency_alpha", &GlobalState::transparencyAlpha, 0, 255, EFFECT_TRANSPARENCY),
+    boolKey("WindowBehavior", "enable_word_prediction", &GlobalState::enableWordPrediction, EFFECT_NONE),
+    intKey("WindowBehavior", "output_max_chunk", &GlobalState::outputMaxChunk, 1, 1024, EFFECT_NONE),
+    intKey("WindowBehavior", "output_chunk_delay", &GlobalState::outputChunkDelay, 0, 200, EFFECT_NONE),
+    customKey("WindowBehavior", "undo_history_kb", ConfigSchema::TYPE_INT, 64, 65536, applyUndoHistoryKb, EFFECT_NONE),
+};
+
+static const size_t CONFIG_KEY_COUNT = sizeof(CONFIG_KEYS) / sizeof(CONFIG_KEYS[0]);
+
+static const ConfigSchema::Schema& configSchema() {
+    static ConfigSchema::Schema* schema = nullptr;
+    if (!schema) {
+        std::vector<ConfigSchema::KeyDef> defs;
+        for (size_t i = 0; i < CONFIG_KEY_COUNT; i++) defs.push_back(CONFIG_KEYS[i].def);
+        schema = new ConfigSchema::Schema(defs.data(), defs.size());
+    }
+    return *schema;
+}
+
+static void applyBinding(GlobalState& state, const ConfigBinding& binding, const ConfigSchema::Value& value) {
+    if (binding.colorField) state.*binding.colorField = (COLORREF)value.number;
+    else if (binding.intField) state.*binding.intField = value.number;
+    else if (binding.boolField) state.*binding.boolField = value.number != 0;
+    else if (binding.textField) state.*binding.textField = Utils::utf8ToWstr(value.text);
+    else if (binding.apply) binding.apply(state, value);
+}
+
+// 目前狀態中某鍵的值（儲存設定時與檔案內容比較）
+static ConfigSchema::Value currentValue(const GlobalState& state, const ConfigBinding& binding) {
+    ConfigSchema::Value value;
+    value.present = true;
+    if (binding.colorField) value.number = (int)(state.*binding.colorField);
+    else if (binding.intField) value.number = state.*binding.intField;
+    else if (binding.boolField) value.number = (state.*binding.boolField) ? 1 : 0;
+    else if (binding.textField) value.text = Utils::wstrToUtf8(state.*binding.textField);
+    return value;
+}
+
+// ========== 設定檔快取與監看 ==========
+
+static const char CONFIG_PATH[] = "interface_config.ini";
+
+// 檔案的修改時間與大小；相同時不需重新讀取
+struct FileStamp {
+    bool exists;
+    uint64_t writeTime;
+    uint64_t size;
+};
+
+static FileStamp readStamp() {
+    FileStamp stamp = {false, 0, 0};
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (GetFileAttributesExA(CONFIG_PATH, GetFileExInfoStandard, &data)) {
+        stamp.exists = true;
+        stamp.writeTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        stamp.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    }
+    return stamp;
+}
+
+static bool sameStamp(const FileStamp& a, const FileStamp& b) {
+    return a.exists == b.exists && a.writeTime == b.writeTime && a.size == b.size;
+}
+
+static bool readConfigText(std::string& text) {
+    std::ifstream fin(CONFIG_PATH, std::ios::in | std::ios::binary);
+    if (!fin.is_open()) return false;
+    std::ostringstream content;
+    content << fin.rdbuf();
+    text = content.str();
+    return true;
+}
+
+static ConfigSchema::Values g_appliedValues;   // 已套用到狀態的值
+static FileStamp g_appliedStamp = {false, 0, 0};
+static std::string g_configText;               // 最近讀取或寫出的檔案內容（儲存時在其上修改）
+static FileStamp g_textStamp = {false, 0, 0};
+
+// 套用熱重新載入後需要的處理
+static void applyEffects(GlobalState& state, unsigned effects) {
+    if (effects & EFFECT_CLIPBOARD) {
+        if (state.clipboardMode) {
+            if (!state.bufferText.empty()) BufferManager::updateClipboardInMode(state);
+            state.clipboardInputting = false;
+            state.clipboardCopied = true;
+        } else {
+            BufferManager::finalizeClipboard(state);
+            state.clipboardInputting = false;
+            state.clipboardCopied = false;
+        }
+    }
+    if (effects & EFFECT_TRANSPARENCY) {
+        WindowManager::applyTransparency(state);
+    }
+    if ((effects & EFFECT_TOPMOST) && state.hWnd) {
+        KillTimer(state.hWnd, 999);
+        if (state.forceStayOnTop) SetTimer(state.hWnd, 999, state.topmostCheckInterval, NULL);
+    }
+    if (effects & EFFECT_REDRAW) {
+        if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
+        if (state.hCandWnd) InvalidateRect(state.hCandWnd, nullptr, TRUE);
+        if (state.hInputWnd) InvalidateRect(state.hInputWnd, nullptr, TRUE);
+        if (state.hBufferWnd && state.bufferMode) {
+            // 字型改變時暫放視窗高度也會改變
+            WindowManager::updateBufferWindowPosition(state);
+            InvalidateRect(state.hBufferWnd, nullptr, TRUE);
+        }
+    }
+}
+
 void loadInterfaceConfig(GlobalState& state) {
-    std::ifstream fin("interface_config.ini");
-    if (!fin.is_open()) {
+    FileStamp stamp = readStamp();
+    if (!stamp.exists) {
         // 配置文件不存在，自动生成默认配置
         createDefaultConfigFile();
         Utils::updateStatus(state, L"已自動生成預設配置文件");
-        // 重新尝试打开（如果创建成功）
-        fin.open("interface_config.ini");
-        if (!fin.is_open()) {
-            Utils::updateStatus(state, L"無法創建配置文件，使用預設設定");
-            return;
-        }
+        stamp = readStamp();
     }
     
-    std::string line;
-    std::string currentSection = "";
+    std::string text;
+    if (!stamp.exists || !readConfigText(text)) {
+        Utils::updateStatus(state, L"無法創建配置文件，使用預設設定");
+        return;
+    }
     
-    while (std::getline(fin, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        
-        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
-        
-        if (line[0] == '[' && line.back() == ']') {
-            currentSection = line.substr(1, line.length() - 2);
-            continue;
-        }
-        
-        size_t eq = line.find('=');
-        if (eq != std::string::npos) {
-            std::string key = line.substr(0, eq);
-            std::string value = line.substr(eq + 1);
-            
-            key.erase(0, key.find_first_not_of(" \t"));
-            key.erase(key.find_last_not_of(" \t") + 1);
-            value.erase(0, value.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t") + 1);
-            
-            if (currentSection == "Colors") {
-                if (key == "background_color") {
-                    state.bgColor = Utils::parseColorFromString(value);
-                } else if (key == "text_color") {
-                    state.textColor = Utils::parseColorFromString(value);
-                } else if (key == "selection_color") {
-                    state.selColor = Utils::parseColorFromString(value);
-                } else if (key == "selection_bg_color") {
-                    state.selBgColor = Utils::parseColorFromString(value);
-                } else if (key == "error_color") {
-                    state.errorColor = Utils::parseColorFromString(value);
-                } else if (key == "close_button_color") {
-                    state.closeButtonColor = Utils::parseColorFromString(value);
-                } else if (key == "close_button_hover_color") {
-                    state.closeButtonHoverColor = Utils::parseColorFromString(value);
-                } else if (key == "mode_button_color") {
-                    state.modeButtonColor = Utils::parseColorFromString(value);
-                } else if (key == "mode_button_hover_color") {
-                    state.modeButtonHoverColor = Utils::parseColorFromString(value);
-                } else if (key == "credits_button_color") {
-                    state.creditsButtonColor = Utils::parseColorFromString(value);
-                } else if (key == "credits_button_hover_color") {
-                    state.creditsButtonHoverColor = Utils::parseColorFromString(value);
-                } else if (key == "refresh_button_color") {
-                    state.refreshButtonColor = Utils::parseColorFromString(value);
-                } else if (key == "refresh_button_hover_color") {
-                    state.refreshButtonHoverColor = Utils::parseColorFromString(value);
-                } else if (key == "candidate_background_color") {
-                    state.candidateBackgroundColor = Utils::parseColorFromString(value);
-                } else if (key == "candidate_text_color") {
-                    state.candidateTextColor = Utils::parseColorFromString(value);
-                } else if (key == "selected_candidate_bg_color") {
-                    state.selectedCandidateBackgroundColor = Utils::parseColorFromString(value);
-                } else if (key == "selected_candidate_text_color") {
-                    state.selectedCandidateTextColor = Utils::parseColorFromString(value);
-                // 字碼輸入視窗顏色（新增）
-                } else if (key == "input_background_color") {
-                    state.inputBackgroundColor = Utils::parseColorFromString(value);
-                } else if (key == "input_text_color") {
-                    state.inputTextColor = Utils::parseColorFromString(value);
-                } else if (key == "input_error_text_color") {
-                    state.inputErrorTextColor = Utils::parseColorFromString(value);
-                } else if (key == "input_hint_text_color") {
-                    state.inputHintTextColor = Utils::parseColorFromString(value);
-                } else if (key == "input_border_color") {
-                    state.inputBorderColor = Utils::parseColorFromString(value);
-                // 暫放視窗顏色
-                } else if (key == "buffer_background_color") {
-                    state.bufferBackgroundColor = Utils::parseColorFromString(value);
-                } else if (key == "buffer_text_color") {
-                    state.bufferTextColor = Utils::parseColorFromString(value);
-                } else if (key == "buffer_cursor_color") {
-                    state.bufferCursorColor = Utils::parseColorFromString(value);
-                }
-            } else if (currentSection == "Font") {
-                if (key == "font_size") {
-                    try {
-                        int fontSize = std::stoi(value);
-                        if (fontSize >= 8 && fontSize <= 72) {
-                            state.fontSize = fontSize;
-                        }
-                    } catch (...) {}
-                } else if (key == "font_name") {
-                    state.fontName = Utils::utf8ToWstr(value);
-                } else if (key == "candidate_font_size") {
-                    try {
-                        int candidateFontSize = std::stoi(value);
-                        if (candidateFontSize >= 8 && candidateFontSize <= 72) {
-                            state.candidateFontSize = candidateFontSize;
-                        }
-                    } catch (...) {}
-                } else if (key == "candidate_font_name") {
-                    state.candidateFontName = Utils::utf8ToWstr(value);
-                // 字碼輸入視窗字型（新增）
-                } else if (key == "input_font_size") {
-                    try {
-                        int inputFontSize = std::stoi(value);
-                        if (inputFontSize >= 8 && inputFontSize <= 72) {
-                            state.inputFontSize = inputFontSize;
-                        }
-                    } catch (...) {}
-                } else if (key == "input_font_name") {
-                    state.inputFontName = Utils::utf8ToWstr(value);
-                // 暫放視窗字型
-                } else if (key == "buffer_font_size") {
-                    try {
-                        int bufferFontSize = std::stoi(value);
-                        if (bufferFontSize >= 8 && bufferFontSize <= 72) {
-                            state.bufferFontSize = bufferFontSize;
-                        }
-                    } catch (...) {}
-                } else if (key == "buffer_font_name") {
-                    state.bufferFontName = Utils::utf8ToWstr(value);
-                }
-            } else if (currentSection == "Window") {
-                if (key == "window_width") {
-                    try {
-                        int windowWidth = std::stoi(value);
-                        if (windowWidth >= 300 && windowWidth <= 1000) {
-                            state.windowWidth = windowWidth;
-                        }
-                    } catch (...) {}
-                } else if (key == "window_height") {
-                    try {
-                        int windowHeight = std::stoi(value);
-                        if (windowHeight >= 50 && windowHeight <= 200) {
-                            state.windowHeight = windowHeight;
-                        }
-                    } catch (...) {}
-                } else if (key == "candidate_window_width") {
-                    try {
-                        int candidateWidth = std::stoi(value);
-                        if (candidateWidth >= 200 && candidateWidth <= 1000) {
-                            state.candidateWidth = candidateWidth;
-                        }
-                    } catch (...) {}
-                } else if (key == "candidate_window_height") {
-                    try {
-                        int candidateHeight = std::stoi(value);
-                        if (candidateHeight >= 100 && candidateHeight <= 600) {
-                            state.candidateHeight = candidateHeight;
-                        }
-                    } catch (...) {}
-                // 字碼輸入視窗尺寸（新增）
-                } else if (key == "input_window_width") {
-                    try {
-                        int inputWidth = std::stoi(value);
-                        if (inputWidth >= 200 && inputWidth <= 800) {
-                            state.inputWindowWidth = inputWidth;
-                        }
-                    } catch (...) {}
-                } else if (key == "input_window_height") {
-                    try {
-                        int inputHeight = std::stoi(value);
-                        if (inputHeight >= 20 && inputHeight <= 100) {
-                            state.inputWindowHeight = inputHeight;
-                        }
-                    } catch (...) {}
-                }
-            } else if (currentSection == "WindowBehavior") {
-                if (key == "topmost_check_interval") {
-                    try {
-                        int interval = std::stoi(value);
-                        if (interval >= 1000 && interval <= 60000) {  // 1秒到60秒
-                            state.topmostCheckInterval = interval;
-                        }
-                    } catch (...) {}
-                } else if (key == "force_stay_on_top") {
-                    state.forceStayOnTop = (value == "1" || value == "true");
-                } else if (key == "refocus_delay") {
-                    try {
-                        int delay = std::stoi(value);
-                        if (delay >= 0 && delay <= 1000) {  // 0到1秒
-                            state.refocusDelay = delay;
-                        }
-                    } catch (...) {}
-                } else if (key == "clipboard_mode") {
-                    state.clipboardMode = (value == "1" || value == "true");
-                } else if (key == "enable_transparency") {
-                    state.enableTransparency = (value == "1" || value == "true");
-                } else if (key == "transparency_alpha") {
-                    try {
-                        int alpha = std::stoi(value);
-                        if (alpha >= 0 && alpha <= 255) {
-                            state.transparencyAlpha = alpha;
-                        }
-                    } catch (...) {}
-                } else if (key == "enable_word_prediction") {
-                    state.enableWordPrediction = (value == "1" || value == "true");
-                }
-            } else if (currentSection == "InputSettings") {
-                if (key == "auto_wildcard_length") {
-                    try {
-                        int length = std::stoi(value);
-                        if (length >= 6 && length <= 20) {
-                            // 可以添加到 GlobalState 中使用
-                        }
-                    } catch (...) {}
-                } else if (key == "suggest_3plus3_length") {
-                    try {
-                        int length = std::stoi(value);
-                        if (length >= 6 && length <= 15) {
-                            // 可以添加到 GlobalState 中使用
-                        }
-                    } catch (...) {}
-                }
-            } else if (currentSection == "MultiScreenSettings") {
-                if (key == "show_screen_change_notification") {
-                    // 處理螢幕變更通知設定
-                    // state.showScreenChangeNotification = (value == "1" || value == "true");
-                }
-            }
-        }
+    // 一次掃描解析，所有有效的值都套用
+    const ConfigSchema::Schema& schema = configSchema();
+    ConfigSchema::Values values;
+    schema.parse(text, values);
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i].present) applyBinding(state, CONFIG_KEYS[i], values[i]);
     }
-    fin.close();
+    
+    g_appliedValues.swap(values);
+    g_appliedStamp = stamp;
+    g_configText.swap(text);
+    g_textStamp = stamp;
     Utils::updateStatus(state, L"重新載入介面配置（含字碼視窗配色）");
 }
 
+int reloadChangedConfig(GlobalState& state) {
+    FileStamp stamp = readStamp();
+    if (!stamp.exists || sameStamp(stamp, g_appliedStamp)) return 0;
+    
+    std::string text;
+    if (!readConfigText(text)) return 0;
+    
+    const ConfigSchema::Schema& schema = configSchema();
+    ConfigSchema::Values values;
+    schema.parse(text, values);
+    
+    // 只套用有變更的鍵；檔案中移除或無效的鍵維持原本的設定
+    std::vector<size_t> changed;
+    schema.reload(g_appliedValues, values, changed);
+    unsigned effects = 0;
+    for (size_t i = 0; i < changed.size(); i++) {
+        applyBinding(state, CONFIG_KEYS[changed[i]], g_appliedValues[changed[i]]);
+        effects |= CONFIG_KEYS[changed[i]].effects;
+    }
+    
+    g_appliedStamp = stamp;
+    g_configText.swap(text);
+    g_textStamp = stamp;
+    
+    applyEffects(state, effects);
+    if (!changed.empty()) {
+        Utils::updateStatus(state, L"已套用 " + std::to_wstring(changed.size()) + L" 項設定變更");
+    }
+    return (int)changed.size();
+}
+
 void loadAllConfigs(GlobalState& state) {
     loadInterfaceConfig(state);
     Dictionary::loadPunctMenu(state);
@@ -344,254 +410,78 @@ void loadAllConfigs(GlobalState& state) {
 }
 
 void refreshConfigs(GlobalState& state) {
-    // 載入界面配置
-    loadInterfaceConfig(state);
-    
-    // 載入所有字典和數據文件
-    Dictionary::loadMainDict("Zi-Ma-Biao.txt", state);
-    Dictionary::loadPunctuator(state);  // 載入標點符號表
-    Dictionary::loadPunctMenu(state);    // 載入標點選單
-    Dictionary::loadUserDict(state);     // 載入用戶字典
-    Dictionary::loadWordPhrases(state);   // 載入詞語庫（用於聯想字功能）
-    
-    // 更新候選字
-    Dictionary::updateCandidates(state);
+    // 介面配置：只套用有變更的設定（檔案不存在時重新生成預設配置）
+    if (readStamp().exists) {
+        reloadChangedConfig(state);
+    } else {
+        loadInterfaceConfig(state);
+        WindowManager::applyTransparency(state);
+    }
     
-    // 應用透明度設置
-    WindowManager::applyTransparency(state);
+    // 字典和數據文件：在背景比對檔案，只重建有變更的部分，完成後以 WM_USER+105 換上
+    // （標點符號表為內建資料，不需重新載入）
+    Dictionary::refreshChangedResources(state);
     
     // 刷新所有視窗
     if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
     if (state.hCandWnd) InvalidateRect(state.hCandWnd, nullptr, TRUE);
     if (state.hInputWnd) InvalidateRect(state.hInputWnd, nullptr, TRUE);
     if (state.hBufferWnd && state.bufferMode) InvalidateRect(state.hBufferWnd, nullptr, TRUE);
-    
-    Utils::updateStatus(state, L"已重新載入所有配置和字典");
 }
 
 void saveInterfaceConfig(const GlobalState& state) {
-    // 读取现有配置文件内容，同时提取transparency_alpha的值（如果存在）
-    std::ifstream fin("interface_config.ini");
-    std::vector<std::string> lines;
-    std::string line;
-    bool foundClipboardMode = false;
-    bool foundEnableTransparency = false;
-    bool foundTransparencyAlpha = false;
-    bool foundEnableWordPrediction = false;
-    std::string currentSection = "";
-    int configFileAlpha = state.transparencyAlpha;  // 默认使用state中的值
-    
-    if (fin.is_open()) {
-        while (std::getline(fin, line)) {
-            std::string trimmedLine = line;
-            trimmedLine.erase(0, trimmedLine.find_first_not_of(" \t\r\n"));
-            trimmedLine.erase(trimmedLine.find_last_not_of(" \t\r\n") + 1);
-            
-            // 检查是否是节标记
-            if (trimmedLine.length() > 0 && trimmedLine[0] == '[' && trimmedLine.back() == ']') {
-                currentSection = trimmedLine.substr(1, trimmedLine.length() - 2);
-                lines.push_back(line);
-                continue;
-            }
-            
-            // 检查是否是WindowBehavior节的配置项
-            size_t eqPos = trimmedLine.find('=');
-            if (eqPos != std::string::npos) {
-                std::string key = trimmedLine.substr(0, eqPos);
-                key.erase(0, key.find_first_not_of(" \t"));
-                key.erase(key.find_last_not_of(" \t") + 1);
-                std::string value = trimmedLine.substr(eqPos + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-                
-                if (currentSection == "WindowBehavior") {
-                    if (key == "clipboard_mode") {
-                        // 更新这一行
-                        lines.push_back("clipboard_mode=" + (state.clipboardMode ? std::string("1") : std::string("0")));
-                        foundClipboardMode = true;
-                        continue;
-                    } else if (key == "enable_transparency") {
-                        lines.push_back("enable_transparency=" + (state.enableTransparency ? std::string("1") : std::string("0")));
-                        foundEnableTransparency = true;
-                        continue;
-                    } else if (key == "transparency_alpha") {
-                        // 先尝试读取配置文件中的值
-                        if (!value.empty()) {
-                            try {
-                                int alpha = std::stoi(value);
-                                if (alpha >= 0 && alpha <= 255) {
-                                    configFileAlpha = alpha;  // 使用配置文件中的值
-                                }
-                            } catch (...) {}
-                        }
-                        // 如果配置文件中已有有效值，使用配置文件中的值；否则使用state中的值
-                        lines.push_back("transparency_alpha=" + std::to_string(configFileAlpha));
-                        foundTransparencyAlpha = true;
-                        continue;
-                    } else if (key == "enable_word_prediction") {
-                        lines.push_back("enable_word_prediction=" + (state.enableWordPrediction ? std::string("1") : std::string("0")));
-                        foundEnableWordPrediction = true;
-                        continue;
-                    }
-                }
-            }
-            
-            lines.push_back(line);
-        }
-        fin.close();
+    // 只有檔案在上次讀取後被修改過才重新讀取；讀取失敗時不寫入，以免覆蓋使用者的設定
+    FileStamp stamp = readStamp();
+    if (!stamp.exists) {
+        g_configText.clear();
+    } else if (!sameStamp(stamp, g_textStamp)) {
+        if (!readConfigText(g_configText)) return;
     }
+    g_textStamp = stamp;
     
-    // 如果没找到配置项，需要添加到WindowBehavior节
-    bool foundWindowBehavior = false;
-    size_t windowBehaviorEnd = 0;
+    const ConfigSchema::Schema& schema = configSchema();
+    ConfigSchema::Values fileValues;
+    schema.parse(g_configText, fileValues);
     
-    for (size_t i = 0; i < lines.size(); ++i) {
-        std::string trimmedLine = lines[i];
-        trimmedLine.erase(0, trimmedLine.find_first_not_of(" \t\r\n"));
-        trimmedLine.erase(trimmedLine.find_last_not_of(" \t\r\n") + 1);
-        
-        if (trimmedLine.length() > 0 && trimmedLine[0] == '[' && trimmedLine.back() == ']') {
-            std::string section = trimmedLine.substr(1, trimmedLine.length() - 2);
-            if (section == "WindowBehavior") {
-                foundWindowBehavior = true;
-                windowBehaviorEnd = i + 1;
-            } else if (foundWindowBehavior) {
-                // 在WindowBehavior节的末尾添加缺失的配置项
-                std::vector<std::string> toInsert;
-                if (!foundClipboardMode) {
-                    toInsert.push_back("clipboard_mode=" + (state.clipboardMode ? std::string("1") : std::string("0")));
-                }
-                if (!foundEnableTransparency) {
-                    toInsert.push_back("enable_transparency=" + (state.enableTransparency ? std::string("1") : std::string("0")));
-                }
-                if (!foundTransparencyAlpha) {
-                    toInsert.push_back("transparency_alpha=" + std::to_string(configFileAlpha));
-                }
-                if (!foundEnableWordPrediction) {
-                    toInsert.push_back("enable_word_prediction=" + (state.enableWordPrediction ? std::string("1") : std::string("0")));
-                }
-                if (!toInsert.empty()) {
-                    lines.insert(lines.begin() + i, toInsert.begin(), toInsert.end());
-                }
-                break;
-            }
-        } else if (foundWindowBehavior) {
-            // 检查是否到了WindowBehavior节的末尾（空行或注释前）
-            if (trimmedLine.empty() || trimmedLine[0] == ';' || trimmedLine[0] == '#') {
-                // 在最后一个非注释行后插入
-                size_t insertPos = i;
-                while (insertPos > windowBehaviorEnd && 
-                       (lines[insertPos-1].empty() || 
-                        (lines[insertPos-1].find_first_not_of(" \t\r\n") != std::string::npos && 
-                         (lines[insertPos-1][lines[insertPos-1].find_first_not_of(" \t\r\n")] == ';' || 
-                          lines[insertPos-1][lines[insertPos-1].find_first_not_of(" \t\r\n")] == '#')))) {
-                    insertPos--;
-                }
-                std::vector<std::string> toInsert;
-                if (!foundClipboardMode) {
-                    toInsert.push_back("clipboard_mode=" + (state.clipboardMode ? std::string("1") : std::string("0")));
-                }
-                if (!foundEnableTransparency) {
-                    toInsert.push_back("enable_transparency=" + (state.enableTransparency ? std::string("1") : std::string("0")));
-                }
-                if (!foundTransparencyAlpha) {
-                    toInsert.push_back("transparency_alpha=" + std::to_string(configFileAlpha));
-                }
-                if (!foundEnableWordPrediction) {
-                    toInsert.push_back("enable_word_prediction=" + (state.enableWordPrediction ? std::string("1") : std::string("0")));
-                }
-                if (!toInsert.empty()) {
-                    lines.insert(lines.begin() + insertPos, toInsert.begin(), toInsert.end());
-                }
-                break;
-            }
-        }
+    // 介面上可切換的設定：與檔案不同時才改寫那一行
+    static const char* const SAVED_KEYS[] = {"clipboard_mode", "enable_transparency", "enable_word_prediction"};
+    std::vector<size_t> written;
+    for (size_t k = 0; k < sizeof(SAVED_KEYS) / sizeof(SAVED_KEYS[0]); k++) {
+        int index = schema.find(SAVED_KEYS[k]);
+        if (index < 0) continue;
+        ConfigSchema::Value value = currentValue(state, CONFIG_KEYS[index]);
+        if (fileValues[index] == value) continue;
+        schema.update(g_configText, index, schema.format(index, value));
+        written.push_back(index);
     }
-    
-    // 如果WindowBehavior节存在但后面没有其他节，在文件末尾添加
-    if (foundWindowBehavior) {
-        std::vector<std::string> toInsert;
-        if (!foundClipboardMode) {
-            toInsert.push_back("clipboard_mode=" + (state.clipboardMode ? std::string("1") : std::string("0")));
-        }
-        if (!foundEnableTransparency) {
-            toInsert.push_back("enable_transparency=" + (state.enableTransparency ? std::string("1") : std::string("0")));
-        }
-        if (!foundTransparencyAlpha) {
-            toInsert.push_back("transparency_alpha=" + std::to_string(state.transparencyAlpha));
-        }
-        if (!toInsert.empty()) {
-            lines.insert(lines.end(), toInsert.begin(), toInsert.end());
-        }
+    // transparency_alpha 以檔案中的值為準（使用者可能手動修改），只在缺少或無效時補上
+    int alphaIndex = schema.find("transparency_alpha");
+    if (alphaIndex >= 0 && !fileValues[alphaIndex].present) {
+        schema.update(g_configText, alphaIndex, std::to_string(state.transparencyAlpha));
+        written.push_back(alphaIndex);
     }
+    if (written.empty()) return;
     
-    // 如果WindowBehavior节不存在，创建一个
-    if (!foundWindowBehavior) {
-        if (!lines.empty() && !lines.back().empty()) {
-            lines.push_back("");
-        }
-        lines.push_back("[WindowBehavior]");
-        lines.push_back("clipboard_mode=" + (state.clipboardMode ? std::string("1") : std::string("0")));
-        lines.push_back("enable_transparency=" + (state.enableTransparency ? std::string("1") : std::string("0")));
-        lines.push_back("transparency_alpha=" + std::to_string(configFileAlpha));
-        lines.push_back("enable_word_prediction=" + (state.enableWordPrediction ? std::string("1") : std::string("0")));
-    }
+    // 以二進位寫出，保留原本的換行格式
+    std::ofstream fout(CONFIG_PATH, std::ios::out | std::ios::binary);
+    if (!fout.is_open()) return;
+    fout.write(g_configText.data(), g_configText.size());
+    fout.close();
     
-    // 写回文件
-    std::ofstream fout("interface_config.ini");
-    if (fout.is_open()) {
-        for (const auto& l : lines) {
-            fout << l << std::endl;
+    // 寫入的值與目前狀態相同，監看時不需重新套用；若檔案之前另有未套用的修改，
+    // g_appliedStamp 仍是舊的，下次檢查時照樣會套用
+    g_textStamp = readStamp();
+    if (g_appliedValues.size() == schema.size()) {
+        for (size_t i = 0; i < written.size(); i++) {
+            g_appliedValues[written[i]] = currentValue(state, CONFIG_KEYS[written[i]]);
         }
-        fout.close();
     }
+    if (sameStamp(stamp, g_appliedStamp)) g_appliedStamp = g_textStamp;
 }
 
 void updateTransparencyAlphaFromConfig(GlobalState& state) {
-    // 只讀取配置文件中的transparency_alpha值，不修改其他配置
-    std::ifstream fin("interface_config.ini");
-    if (!fin.is_open()) {
-        return;
-    }
-    
-    std::string line;
-    std::string currentSection = "";
-    
-    while (std::getline(fin, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        
-        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
-        
-        if (line[0] == '[' && line.back() == ']') {
-            currentSection = line.substr(1, line.length() - 2);
-            continue;
-        }
-        
-        if (currentSection == "WindowBehavior") {
-            size_t eq = line.find('=');
-            if (eq != std::string::npos) {
-                std::string key = line.substr(0, eq);
-                std::string value = line.substr(eq + 1);
-                
-                key.erase(0, key.find_first_not_of(" \t"));
-                key.erase(key.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-                
-                if (key == "transparency_alpha" && !value.empty()) {
-                    try {
-                        int alpha = std::stoi(value);
-                        if (alpha >= 0 && alpha <= 255) {
-                            state.transparencyAlpha = alpha;
-                        }
-                    } catch (...) {}
-                    break;  // 找到後就可以退出
-                }
-            }
-        }
-    }
-    fin.close();
+    // 檔案有修改時套用變更的設定（包含 transparency_alpha）；未修改時目前的值已與檔案一致
+    reloadChangedConfig(state);
 }
 
 } // namespace ConfigLoader
\ No newline at end of file
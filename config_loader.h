@@ -17,7 +17,11 @@ namespace ConfigLoader {
     // 重新載入設定
     void refreshConfigs(GlobalState& state);
     
-    // 從配置文件讀取transparency_alpha值（不修改其他配置）
+    // 設定檔修改後只套用有變更的設定（不重新載入字典）；回傳套用的項數
+    // 以檔案修改時間與大小判斷，未修改時不讀取檔案
+    int reloadChangedConfig(GlobalState& state);
+    
+    // 從配置文件讀取transparency_alpha值（檔案有修改時套用所有變更的設定）
     void updateTransparencyAlphaFromConfig(GlobalState& state);
 }
 
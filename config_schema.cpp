@@ -0,0 +1,275 @@
+// config_schema.cpp - 設定檔結構描述實作
+#include "config_schema.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace ConfigSchema {
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool isHexDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+// 去掉 [begin, end) 前後的空白
+static void trim(const char*& begin, const char*& end) {
+    while (begin < end && isSpace(*begin)) begin++;
+    while (end > begin && isSpace(end[-1])) end--;
+}
+
+static bool sameText(const char* a, size_t length, const char* b) {
+    return std::strlen(b) == length && std::memcmp(a, b, length) == 0;
+}
+
+// 逐行掃描：回呼每一行的範圍（不含換行字元）
+struct Line {
+    const char* begin;      // 整行
+    const char* end;
+    const char* next;       // 下一行的開頭
+};
+
+static bool nextLine(const char*& cursor, const char* limit, Line& line) {
+    if (cursor >= limit) return false;
+    line.begin = cursor;
+    const char* newline = (const char*)std::memchr(cursor, '\n', limit - cursor);
+    line.end = newline ? newline : limit;
+    line.next = newline ? newline + 1 : limit;
+    cursor = line.next;
+    return true;
+}
+
+// 一行的內容：區段標頭或 key=value（鍵與值都已去掉前後空白）
+struct Entry {
+    bool isSection;
+    bool isPair;
+    const char* nameBegin;  // 區段名或鍵名
+    const char* nameEnd;
+    const char* valueBegin;
+    const char* valueEnd;
+};
+
+static Entry classify(const Line& line) {
+    Entry entry = {false, false, nullptr, nullptr, nullptr, nullptr};
+    const char* begin = line.begin;
+    const char* end = line.end;
+    trim(begin, end);
+    if (begin == end || *begin == '#' || *begin == ';') return entry;
+
+    if (*begin == '[' && end[-1] == ']' && end - begin >= 2) {
+        entry.isSection = true;
+        entry.nameBegin = begin + 1;
+        entry.nameEnd = end - 1;
+        return entry;
+    }
+
+    const char* eq = (const char*)std::memchr(begin, '=', end - begin);
+    if (!eq) return entry;
+    entry.isPair = true;
+    entry.nameBegin = begin;
+    entry.nameEnd = eq;
+    trim(entry.nameBegin, entry.nameEnd);
+    entry.valueBegin = eq + 1;
+    entry.valueEnd = end;
+    trim(entry.valueBegin, entry.valueEnd);
+    return entry;
+}
+
+Schema::Schema(const KeyDef* defs, size_t count)
+    : defs_(defs, defs + count), seed_(0), mask_(0) {
+    for (size_t i = 0; i < count; i++) keyLengths_.push_back(std::strlen(defs[i].key));
+
+    // 找一個讓所有鍵落在不同格的種子；表大小為鍵數兩倍以上的 2 的冪，通常幾十次內就能找到
+    size_t tableSize = 8;
+    while (tableSize < count * 2) tableSize *= 2;
+    while (!build(tableSize)) tableSize *= 2;
+}
+
+uint32_t Schema::hash(const char* key, size_t length) const {
+    uint32_t h = 2166136261u ^ seed_;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (uint8_t)key[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    return h;
+}
+
+bool Schema::build(size_t tableSize) {
+    mask_ = (uint32_t)(tableSize - 1);
+    for (uint32_t seed = 1; seed <= 4096; seed++) {
+        seed_ = seed;
+        slots_.assign(tableSize, -1);
+        bool collision = false;
+        for (size_t i = 0; i < defs_.size() && !collision; i++) {
+            int16_t& slot = slots_[hash(defs_[i].key, keyLengths_[i]) & mask_];
+            if (slot >= 0) collision = true;
+            else slot = (int16_t)i;
+        }
+        if (!collision) return true;
+    }
+    return false;
+}
+
+int Schema::find(const char* key, size_t length) const {
+    if (slots_.empty()) return -1;
+    int index = slots_[hash(key, length) & mask_];
+    if (index < 0 || keyLengths_[index] != length || std::memcmp(defs_[index].key, key, length) != 0) return -1;
+    return index;
+}
+
+bool Schema::convert(size_t index, const std::string& raw, Value& value) const {
+    const KeyDef& def = defs_[index];
+    value = Value();
+    switch (def.type) {
+        case TYPE_INT: {
+            // 與 std::stoi 相同：允許前導空白與尾端多餘字元，必須至少有一個數字
+            const char* start = raw.c_str();
+            char* stop = nullptr;
+            errno = 0;
+            long number = std::strtol(start, &stop, 10);
+            if (stop == start || errno == ERANGE || number < INT_MIN || number > INT_MAX) return false;
+            if (number < def.minValue || number > def.maxValue) return false;
+            value.number = (int)number;
+            break;
+        }
+        case TYPE_BOOL:
+            value.number = (raw == "1" || raw == "true") ? 1 : 0;
+            break;
+        case TYPE_COLOR: {
+            std::string hex;
+            if (raw.size() == 7 && raw[0] == '#') {
+                hex = raw.substr(1);
+            } else if (raw.size() == 6) {
+                bool valid = true;
+                for (size_t i = 0; i < raw.size(); i++) valid = valid && isHexDigit(raw[i]);
+                if (valid) hex = raw;
+            }
+            unsigned long rgb = hex.empty() ? 0 : std::strtoul(hex.c_str(), nullptr, 16);
+            value.number = (int)(((rgb >> 16) & 0xFF) | (rgb & 0xFF00) | ((rgb & 0xFF) << 16));
+            break;
+        }
+        case TYPE_STRING:
+            value.text = raw;
+            break;
+    }
+    value.present = true;
+    return true;
+}
+
+std::string Schema::format(size_t index, const Value& value) const {
+    switch (defs_[index].type) {
+        case TYPE_BOOL:
+            return value.number ? "1" : "0";
+        case TYPE_COLOR: {
+            static const char digits[] = "0123456789ABCDEF";
+            unsigned int bgr = (unsigned int)value.number;
+            unsigned int channels[3] = {bgr & 0xFF, (bgr >> 8) & 0xFF, (bgr >> 16) & 0xFF};
+            std::string text = "#";
+            for (int i = 0; i < 3; i++) {
+                text += digits[channels[i] >> 4];
+                text += digits[channels[i] & 0xF];
+            }
+            return text;
+        }
+        case TYPE_STRING:
+            return value.text;
+        default:
+            return std::to_string(value.number);
+    }
+}
+
+void Schema::parse(const std::string& text, Values& values) const {
+    values.assign(defs_.size(), Value());
+    const char* cursor = text.data();
+    const char* limit = cursor + text.size();
+    const char* sectionBegin = cursor;
+    size_t sectionLength = 0;
+    std::string raw;
+    Value value;
+
+    Line line;
+    while (nextLine(cursor, limit, line)) {
+        Entry entry = classify(line);
+        if (entry.isSection) {
+            sectionBegin = entry.nameBegin;
+            sectionLength = entry.nameEnd - entry.nameBegin;
+            continue;
+        }
+        if (!entry.isPair) continue;
+
+        int index = find(entry.nameBegin, entry.nameEnd - entry.nameBegin);
+        if (index < 0 || !sameText(sectionBegin, sectionLength, defs_[index].section)) continue;
+        raw.assign(entry.valueBegin, entry.valueEnd);
+        if (convert(index, raw, value)) values[index] = value;
+    }
+}
+
+void Schema::diff(const Values& before, const Values& after, std::vector<size_t>& changed) const {
+    changed.clear();
+    for (size_t i = 0; i < defs_.size() && i < after.size(); i++) {
+        if (!after[i].present) continue;
+        if (i >= before.size() || before[i] != after[i]) changed.push_back(i);
+    }
+}
+
+void Schema::reload(Values& applied, const Values& loaded, std::vector<size_t>& changed) const {
+    diff(applied, loaded, changed);
+    if (applied.size() < defs_.size()) applied.resize(defs_.size());
+    for (size_t i = 0; i < changed.size(); i++) applied[changed[i]] = loaded[changed[i]];
+}
+
+bool Schema::update(std::string& text, size_t index, const std::string& value) const {
+    const KeyDef& def = defs_[index];
+    std::string newline = text.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+
+    // 先記下位移再修改，避免修改時指標失效
+    std::vector<std::pair<size_t, size_t>> valueRanges;
+    bool inSection = false;
+    bool sectionFound = false;
+    size_t insertAt = std::string::npos;    // 區段內最後一個設定（或區段標頭）的下一行
+
+    const char* base = text.data();
+    const char* cursor = base;
+    const char* limit = base + text.size();
+    Line line;
+    while (nextLine(cursor, limit, line)) {
+        Entry entry = classify(line);
+        if (entry.isSection) {
+            inSection = sameText(entry.nameBegin, entry.nameEnd - entry.nameBegin, def.section);
+            if (inSection) {
+                sectionFound = true;
+                insertAt = line.next - base;
+            }
+            continue;
+        }
+        if (!inSection || !entry.isPair) continue;
+        insertAt = line.next - base;
+        if (sameText(entry.nameBegin, entry.nameEnd - entry.nameBegin, def.key)) {
+            valueRanges.push_back(std::make_pair((size_t)(entry.valueBegin - base), (size_t)(entry.valueEnd - base)));
+        }
+    }
+
+    std::string original = text;
+    if (!valueRanges.empty()) {
+        for (size_t i = valueRanges.size(); i-- > 0; ) {
+            text.replace(valueRanges[i].first, valueRanges[i].second - valueRanges[i].first, value);
+        }
+    } else if (sectionFound) {
+        // 區段最後一行沒有換行時先補上
+        std::string lineText = std::string(def.key) + "=" + value + newline;
+        if (insertAt == text.size() && !text.empty() && text[text.size() - 1] != '\n') lineText = newline + lineText;
+        text.insert(insertAt, lineText);
+    } else {
+        if (!text.empty() && text[text.size() - 1] != '\n') text += newline;
+        if (!text.empty()) text += newline;
+        text += "[" + std::string(def.section) + "]" + newline;
+        text += std::string(def.key) + "=" + value + newline;
+    }
+    return text != original;
+}
+
+}
@@ -0,0 +1,86 @@
+// config_schema.h - 設定檔結構描述：一次掃描解析 INI、完美雜湊查鍵、比對變更（可攜式，不依賴 Windows API）
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ConfigSchema {
+    enum ValueType {
+        TYPE_INT,       // 整數，超出 [minValue, maxValue] 時忽略
+        TYPE_BOOL,      // "1" 或 "true" 為真，其餘為假
+        TYPE_COLOR,     // #RRGGBB 或 RRGGBB，存成 0x00BBGGRR（與 COLORREF 相同）；格式錯誤時為黑色
+        TYPE_STRING     // 原始 UTF-8 字串
+    };
+
+    // 一個設定鍵的描述；鍵名在所有區段中必須唯一
+    struct KeyDef {
+        const char* section;
+        const char* key;
+        ValueType type;
+        int minValue;
+        int maxValue;
+    };
+
+    // 解析後的值；present 為 false 表示檔案中沒有此鍵或值無效（維持目前設定）
+    struct Value {
+        bool present;
+        int number;         // TYPE_INT / TYPE_BOOL / TYPE_COLOR
+        std::string text;   // TYPE_STRING
+        Value() : present(false), number(0) {}
+        bool operator==(const Value& other) const {
+            return present == other.present && number == other.number && text == other.text;
+        }
+        bool operator!=(const Value& other) const { return !(*this == other); }
+    };
+
+    // 與 KeyDef 陣列同序的值表
+    typedef std::vector<Value> Values;
+
+    class Schema {
+    public:
+        Schema(const KeyDef* defs, size_t count);
+
+        size_t size() const { return defs_.size(); }
+        const KeyDef& def(size_t index) const { return defs_[index]; }
+
+        // 鍵名對應的索引；找不到回傳 -1（完美雜湊：一次雜湊加一次字串比對）
+        int find(const char* key, size_t length) const;
+        int find(const std::string& key) const { return find(key.data(), key.size()); }
+
+        // 一次掃描解析整份 INI；同一鍵出現多次時以最後一個有效值為準，區段不符的鍵忽略
+        void parse(const std::string& text, Values& values) const;
+
+        // 依型別與範圍轉換單一值；無效時回傳 false
+        bool convert(size_t index, const std::string& raw, Value& value) const;
+        // 值轉回設定檔中的文字
+        std::string format(size_t index, const Value& value) const;
+
+        // after 中有值且與 before 不同的鍵（需要套用的設定）
+        void diff(const Values& before, const Values& after, std::vector<size_t>& changed) const;
+        // 熱重新載入：changed 為 loaded 中與 applied 不同的鍵，並把這些值併入 applied；
+        // 檔案中移除或無效的鍵維持 applied 原本的值
+        void reload(Values& applied, const Values& loaded, std::vector<size_t>& changed) const;
+
+        // 在設定檔內容中把某鍵改為 value：保留其他行、註解與換行格式；
+        // 鍵不存在時加在該區段最後一個設定之後，區段不存在時加在檔尾；回傳內容是否改變
+        bool update(std::string& text, size_t index, const std::string& value) const;
+
+        // 完美雜湊表大小（統計與測試用）
+        size_t tableSize() const { return slots_.size(); }
+
+    private:
+        uint32_t hash(const char* key, size_t length) const;
+        bool build(size_t tableSize);
+
+        std::vector<KeyDef> defs_;
+        std::vector<size_t> keyLengths_;
+        std::vector<int16_t> slots_;
+        uint32_t seed_;
+        uint32_t mask_;
+    };
+}
+
+#endif // CONFIG_SCHEMA_H
@@ -0,0 +1,303 @@
+// dict_delta.cpp - 字碼表差異更新實作
+#include "dict_delta.h"
+#include "utf8_codec.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace DictDelta {
+
+static const char DELTA_HEADER[] = "# ZMB-DELTA 1";
+static const char VERSION_PREFIX[] = "# version:";
+
+// 逐行回呼 [begin, end, next)：略過 UTF-8 BOM，end 不含行尾的 \r\n，next 為下一行的開頭
+template <typename Visitor>
+static void forEachLine(const std::string& content, Visitor visit) {
+    size_t pos = 0;
+    if (content.compare(0, 3, "\xEF\xBB\xBF") == 0) pos = 3;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        size_t next = end == std::string::npos ? content.size() : end + 1;
+        if (end == std::string::npos) end = content.size();
+        if (end > pos && content[end - 1] == '\r') end--;
+        if (!visit(pos, end, next)) return;
+        pos = next;
+    }
+}
+
+static bool startsWith(const std::string& content, size_t begin, size_t end, const char* prefix) {
+    size_t length = strlen(prefix);
+    return end - begin >= length && content.compare(begin, length, prefix) == 0;
+}
+
+// 開頭註解中的版本行；找到時傳回該行的範圍
+static bool findVersionLine(const std::string& content, size_t& lineBegin, size_t& lineEnd, uint32_t& version) {
+    bool found = false;
+    forEachLine(content, [&](size_t begin, size_t end, size_t) {
+        if (begin < end && content[begin] != '#') return false;   // 資料開始，不再是開頭註解
+        if (startsWith(content, begin, end, VERSION_PREFIX)) {
+            lineBegin = begin;
+            lineEnd = end;
+            version = (uint32_t)strtoul(content.c_str() + begin + strlen(VERSION_PREFIX), nullptr, 10);
+            found = true;
+            return false;
+        }
+        return true;
+    });
+    return found;
+}
+
+uint32_t readVersion(const std::string& content) {
+    size_t begin, end;
+    uint32_t version = 0;
+    return findVersionLine(content, begin, end, version) ? version : 0;
+}
+
+// 以 tab 分割 [begin, end)
+static std::vector<std::wstring> splitFields(const std::string& content, size_t begin, size_t end) {
+    std::vector<std::wstring> fields;
+    for (;;) {
+        size_t tab = content.find('\t', begin);
+        if (tab == std::string::npos || tab > end) tab = end;
+        fields.push_back(Utf8Codec::decode(content.substr(begin, tab - begin)));
+        if (tab == end) break;
+        begin = tab + 1;
+    }
+    return fields;
+}
+
+bool parseDelta(const std::string& content, std::vector<Step>& steps) {
+    steps.clear();
+    bool headerSeen = false;
+    bool ok = true;
+    forEachLine(content, [&](size_t begin, size_t end, size_t) {
+        if (begin == end) return true;
+        if (!headerSeen) {
+            headerSeen = content.compare(begin, end - begin, DELTA_HEADER) == 0;
+            ok = headerSeen;
+            return ok;
+        }
+        char kind = content[begin];
+        if (kind == '#') return true;
+
+        if (kind == '@') {
+            char* p = nullptr;
+            Step step;
+            step.from = (uint32_t)strtoul(content.c_str() + begin + 1, &p, 10);
+            step.to = (uint32_t)strtoul(p, &p, 10);
+            step.entryCount = (int)strtol(p, &p, 10);
+            // 每一步都要比前一步新，且接在前一步之後
+            ok = step.to > step.from && (steps.empty() || steps.back().to == step.from);
+            if (ok) steps.push_back(step);
+            return ok;
+        }
+
+        ok = (kind == '=' || kind == '-') && !steps.empty() && end - begin > 2 && content[begin + 1] == ' ';
+        if (!ok) return false;
+        std::vector<std::wstring> fields = splitFields(content, begin + 2, end);
+        Change change;
+        change.remove = kind == '-';
+        change.words.assign(fields.begin() + 1, fields.end());
+        ok = !fields[0].empty() && (change.remove ? change.words.empty() : !change.words.empty()) &&
+             steps.back().changes.insert(std::make_pair(fields[0], change)).second;
+        return ok;
+    });
+    return ok && headerSeen;
+}
+
+std::string formatDelta(const std::vector<Step>& steps) {
+    std::string out = DELTA_HEADER;
+    out += '\n';
+    for (size_t i = 0; i < steps.size(); i++) {
+        const Step& step = steps[i];
+        out += "@ " + std::to_string(step.from) + " " + std::to_string(step.to) + " " +
+               std::to_string(step.entryCount) + "\n";
+        for (Changes::const_iterator it = step.changes.begin(); it != step.changes.end(); ++it) {
+            out += it->second.remove ? "- " : "= ";
+            out += Utf8Codec::encode(it->first);
+            for (size_t w = 0; w < it->second.words.size(); w++) {
+                out += '\t';
+                out += Utf8Codec::encode(it->second.words[w]);
+            }
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+Step diff(const DictFiles::CodeTable& from, const DictFiles::CodeTable& to,
+          uint32_t fromVersion, uint32_t toVersion) {
+    Step step;
+    step.from = fromVersion;
+    step.to = toVersion;
+    DictFiles::CodeTable::const_iterator a = from.begin();
+    DictFiles::CodeTable::const_iterator b = to.begin();
+    // 兩邊都依字碼排序，同時走訪
+    while (a != from.end() || b != to.end()) {
+        if (b == to.end() || (a != from.end() && a->first < b->first)) {
+            step.changes[a->first].remove = true;
+            ++a;
+            continue;
+        }
+        if (a == from.end() || b->first < a->first || a->second != b->second) {
+            step.changes[b->first].words = b->second;
+        }
+        step.entryCount += (int)b->second.size();
+        if (a != from.end() && !(b->first < a->first)) ++a;
+        ++b;
+    }
+    return step;
+}
+
+Plan plan(const std::vector<Step>& steps, uint32_t version, Step& merged, size_t maxSteps) {
+    merged = Step();
+    // 差異檔是空的或本機版本比差異檔還新：無法判斷，交給完整下載（條件式請求）決定
+    if (steps.empty() || version > steps.back().to) return PLAN_TOO_FAR;
+    if (version == steps.back().to) return PLAN_UP_TO_DATE;
+
+    size_t first = 0;
+    while (first < steps.size() && steps[first].from != version) first++;
+    if (first == steps.size() || steps.size() - first > maxSteps) return PLAN_TOO_FAR;
+
+    // 每個變更都是整組替換或刪除，後面的步驟直接覆蓋前面的
+    merged.from = version;
+    merged.to = steps.back().to;
+    merged.entryCount = steps.back().entryCount;
+    for (size_t i = first; i < steps.size(); i++) {
+        for (Changes::const_iterator it = steps[i].changes.begin(); it != steps[i].changes.end(); ++it) {
+            merged.changes[it->first] = it->second;
+        }
+    }
+    return PLAN_APPLY;
+}
+
+int countAfter(const DictFiles::CodeTable& dict, int count, const Step& patch) {
+    for (Changes::const_iterator it = patch.changes.begin(); it != patch.changes.end(); ++it) {
+        DictFiles::CodeTable::const_iterator current = dict.find(it->first);
+        if (current != dict.end()) count -= (int)current->second.size();
+        if (!it->second.remove) count += (int)it->second.words.size();
+    }
+    return count;
+}
+
+void applyToTable(DictFiles::CodeTable& dict, const Step& patch) {
+    for (Changes::const_iterator it = patch.changes.begin(); it != patch.changes.end(); ++it) {
+        if (it->second.remove) {
+            dict.erase(it->first);
+        } else {
+            dict[it->first] = it->second.words;
+        }
+    }
+}
+
+std::string applyToFile(const std::string& content, const Step& patch, int& entryCount) {
+    // 以 UTF-8 字碼比對，不必解碼每一行
+    struct Pending {
+        const std::wstring* code;
+        const Change* change;
+        bool written;
+    };
+    std::unordered_map<std::string, Pending> pending;
+    pending.reserve(patch.changes.size());
+    for (Changes::const_iterator it = patch.changes.begin(); it != patch.changes.end(); ++it) {
+        Pending entry = { &it->first, &it->second, false };
+        pending[Utf8Codec::encode(it->first)] = entry;
+    }
+
+    const char* newline = content.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+    std::string versionLine = VERSION_PREFIX;
+    versionLine += " " + std::to_string(patch.to);
+
+    std::string out;
+    out.reserve(content.size() + content.size() / 16);
+    bool bom = content.compare(0, 3, "\xEF\xBB\xBF") == 0;
+    if (bom) out.append(content, 0, 3);
+
+    size_t versionBegin = std::string::npos, versionEnd = 0;
+    uint32_t oldVersion = 0;
+    if (!findVersionLine(content, versionBegin, versionEnd, oldVersion)) {
+        out += versionLine + newline;
+    }
+
+    std::string word;
+    auto writeEntries = [&](Pending& entry, const std::string& code) {
+        entry.written = true;
+        if (entry.change->remove) return;
+        for (size_t i = 0; i < entry.change->words.size(); i++) {
+            word.clear();
+            Utf8Codec::appendEncoded(word, entry.change->words[i].data(), entry.change->words[i].size());
+            out += word;
+            out += '\t';
+            out += code;
+            out += newline;
+        }
+        entryCount += (int)entry.change->words.size();
+    };
+
+    entryCount = 0;
+    std::string code;
+    forEachLine(content, [&](size_t begin, size_t end, size_t next) {
+        if (begin == versionBegin) {
+            out += versionLine;
+            out.append(content, end, next - end);
+            return true;
+        }
+        size_t tab = content.find('\t', begin);
+        bool entryLine = begin < end && content[begin] != '#' && tab != std::string::npos && tab < end &&
+                         tab > begin && tab + 1 < end;
+        if (entryLine) {
+            code.assign(content, tab + 1, end - tab - 1);
+            std::unordered_map<std::string, Pending>::iterator found = pending.find(code);
+            if (found == pending.end()) {
+                entryCount++;
+            } else {
+                // 受影響的字碼：第一次出現時寫入新的候選字，之後的行略過
+                if (!found->second.written) writeEntries(found->second, found->first);
+                return true;
+            }
+        }
+        out.append(content, begin, next - begin);
+        return true;
+    });
+
+    // 檔案中原本沒有的字碼
+    std::vector<std::pair<const std::wstring*, Pending*>> added;
+    for (std::unordered_map<std::string, Pending>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        if (!it->second.written && !it->second.change->remove) added.push_back(std::make_pair(it->second.code, &it->second));
+    }
+    if (!added.empty() && !out.empty() && out[out.size() - 1] != '\n') out += newline;
+    // 依字碼排序，輸出與 unordered_map 的走訪順序無關
+    std::sort(added.begin(), added.end(), [](const std::pair<const std::wstring*, Pending*>& a,
+                                              const std::pair<const std::wstring*, Pending*>& b) {
+        return *a.first < *b.first;
+    });
+    for (size_t i = 0; i < added.size(); i++) {
+        writeEntries(*added[i].second, Utf8Codec::encode(*added[i].first));
+    }
+    return out;
+}
+
+Update update(const std::string& content, const std::string& delta, std::string& patched, Step& applied,
+              size_t maxSteps) {
+    patched.clear();
+    applied = Step();
+    std::vector<Step> steps;
+    if (!parseDelta(delta, steps)) return UPDATE_BAD_DELTA;
+
+    Step patch;
+    switch (plan(steps, readVersion(content), patch, maxSteps)) {
+        case PLAN_UP_TO_DATE: return UPDATE_UP_TO_DATE;
+        case PLAN_TOO_FAR: return UPDATE_TOO_FAR;
+        case PLAN_APPLY: break;
+    }
+
+    int entryCount = 0;
+    std::string result = applyToFile(content, patch, entryCount);
+    if (entryCount != patch.entryCount) return UPDATE_MISMATCH;
+    patched.swap(result);
+    applied = patch;
+    return UPDATE_APPLIED;
+}
+
+}
@@ -0,0 +1,83 @@
+// dict_delta.h - 字碼表的差異更新（可攜式，不依賴 Windows API）
+#ifndef DICT_DELTA_H
+#define DICT_DELTA_H
+
+#include "dict_files.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// 字碼表只改了少數字碼時，下載差異檔而不是整個檔案：
+// 直接修改本機檔案中受影響的行，並就地更新記憶體中的字典，不必重新載入
+//
+// 字碼表的版本記在檔案開頭的註解行「# version: N」（沒有時視為第 0 版）
+//
+// 差異檔（UTF-8）由連續的步驟組成，每個步驟把字典從一個版本更新到下一個版本：
+//   # ZMB-DELTA 1
+//   @ 41 42 15234              從第 41 版到第 42 版，更新後共 15234 筆
+//   = 字碼<TAB>字1<TAB>字2      字碼的候選字整組換成這些（新增或調整順序）
+//   - 字碼                      刪除字碼
+// 每個步驟中同一個字碼只出現一次
+namespace DictDelta {
+    struct Change {
+        bool remove;
+        std::vector<std::wstring> words;    // 新的候選字（依順序）
+        Change() : remove(false) {}
+    };
+    typedef std::map<std::wstring, Change> Changes;
+
+    struct Step {
+        uint32_t from;
+        uint32_t to;
+        int entryCount;         // 更新後的筆數（與 parseMainDict 的回傳值相同），用來確認套用結果
+        Changes changes;
+        Step() : from(0), to(0), entryCount(0) {}
+    };
+
+    // 超過這麼多個步驟時改為下載完整字碼表
+    static const size_t MAX_STEPS = 64;
+
+    // 檔案開頭註解中的版本；沒有時回傳 0
+    uint32_t readVersion(const std::string& content);
+
+    // 格式錯誤或步驟不連續時回傳 false
+    bool parseDelta(const std::string& content, std::vector<Step>& steps);
+    std::string formatDelta(const std::vector<Step>& steps);
+
+    // 比較兩個版本的字典，產生一個步驟（發佈差異檔用）
+    Step diff(const DictFiles::CodeTable& from, const DictFiles::CodeTable& to,
+              uint32_t fromVersion, uint32_t toVersion);
+
+    enum Plan {
+        PLAN_UP_TO_DATE,    // 已是最新版本
+        PLAN_APPLY,         // 可以套用 merged
+        PLAN_TOO_FAR        // 差異檔不涵蓋目前的版本或步驟太多，需下載完整字碼表
+    };
+    // 選出從 version 到最新版本的步驟並合併成一個
+    Plan plan(const std::vector<Step>& steps, uint32_t version, Step& merged,
+              size_t maxSteps = MAX_STEPS);
+
+    // 套用後的筆數（不修改字典）；count 為目前的筆數
+    int countAfter(const DictFiles::CodeTable& dict, int count, const Step& patch);
+    // 就地更新記憶體中的字典（只動到有變更的字碼）
+    void applyToTable(DictFiles::CodeTable& dict, const Step& patch);
+    // 更新檔案內容：受影響的字碼在第一次出現的位置換成新的候選字，其餘的行不變，
+    // 新的字碼附加在最後，版本行改成 patch.to；entryCount 傳回更新後的筆數
+    std::string applyToFile(const std::string& content, const Step& patch, int& entryCount);
+
+    enum Update {
+        UPDATE_UP_TO_DATE,      // 已是最新版本
+        UPDATE_APPLIED,         // patched 為更新後的檔案內容，applied 為合併後的步驟
+        UPDATE_BAD_DELTA,       // 差異檔格式無效
+        UPDATE_TOO_FAR,         // 見 PLAN_TOO_FAR
+        UPDATE_MISMATCH         // 套用後的筆數不符：本機檔案與差異檔的基準版本不同
+    };
+    // 以差異檔 delta 更新字碼表內容 content（parseDelta、plan、applyToFile 與筆數檢查）；
+    // 除了 UPDATE_UP_TO_DATE 與 UPDATE_APPLIED 之外都需要下載完整字碼表
+    Update update(const std::string& content, const std::string& delta, std::string& patched, Step& applied,
+                  size_t maxSteps = MAX_STEPS);
+}
+
+#endif // DICT_DELTA_H
@@ -0,0 +1,185 @@
+// dict_files.cpp - 字典檔案解析實作
+#include "dict_files.h"
+#include "utf8_codec.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace DictFiles {
+
+bool readFile(const std::string& path, std::string& content) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    content.clear();
+    char block[65536];
+    size_t got;
+    while ((got = fread(block, 1, sizeof(block), file)) > 0) {
+        content.append(block, got);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// 逐行回呼 [begin, end)：略過 UTF-8 BOM，去掉行尾的 \r
+template <typename Visitor>
+static void forEachLine(const std::string& content, Visitor visit) {
+    size_t pos = 0;
+    if (content.compare(0, 3, "\xEF\xBB\xBF") == 0) pos = 3;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) end = content.size();
+        size_t next = end + 1;
+        if (end > pos && content[end - 1] == '\r') end--;
+        visit(pos, end);
+        pos = next;
+    }
+}
+
+// 去掉前後的空白與 tab
+static void trim(const std::string& content, size_t& begin, size_t& end) {
+    while (begin < end && (content[begin] == ' ' || content[begin] == '\t')) begin++;
+    while (end > begin && (content[end - 1] == ' ' || content[end - 1] == '\t')) end--;
+}
+
+int parseMainDict(const std::string& content, CodeTable& dict) {
+    dict.clear();
+    MainDictParser parser(dict);
+    parser.feed(content.data(), content.size());
+    parser.finish();
+    return parser.entryCount();
+}
+
+MainDictParser::MainDictParser(CodeTable& dict)
+    : dict_(dict), firstLine_(true), entries_(0), malformed_(0) {}
+
+void MainDictParser::feed(const char* data, size_t size) {
+    const char* end = data + size;
+    while (data < end) {
+        const char* newline = (const char*)memchr(data, '\n', end - data);
+        if (!newline) {
+            pending_.append(data, end);
+            return;
+        }
+        if (pending_.empty()) {
+            parseLine(data, newline);
+        } else {
+            // 跨段的行先接起來
+            pending_.append(data, newline);
+            parseLine(pending_.data(), pending_.data() + pending_.size());
+            pending_.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+void MainDictParser::reset() {
+    dict_.clear();
+    pending_.clear();
+    firstLine_ = true;
+    entries_ = 0;
+    malformed_ = 0;
+}
+
+void MainDictParser::finish() {
+    if (!pending_.empty()) parseLine(pending_.data(), pending_.data() + pending_.size());
+    pending_.clear();
+}
+
+static bool containsReplacement(const std::wstring& text) {
+    return text.find(L'\xFFFD') != std::wstring::npos;
+}
+
+void MainDictParser::parseLine(const char* begin, const char* end) {
+    if (firstLine_) {
+        firstLine_ = false;
+        if (end - begin >= 3 && memcmp(begin, "\xEF\xBB\xBF", 3) == 0) begin += 3;
+    }
+    if (end > begin && end[-1] == '\r') end--;
+    if (begin == end || *begin == '#') return;
+
+    const char* tab = (const char*)memchr(begin, '\t', end - begin);
+    if (!tab) {
+        malformed_++;
+        return;
+    }
+    code_.clear();
+    word_.clear();
+    Utf8Codec::appendDecoded(code_, tab + 1, end - tab - 1);
+    Utf8Codec::appendDecoded(word_, begin, tab - begin);
+    if (code_.empty() || word_.empty()) {
+        malformed_++;
+        return;
+    }
+    dict_[code_].push_back(word_);
+    entries_++;
+    if (memchr(begin, '\0', end - begin) || containsReplacement(code_) || containsReplacement(word_)) malformed_++;
+}
+
+int parsePunctMenu(const std::string& content, std::vector<std::wstring>& items) {
+    items.clear();
+    forEachLine(content, [&](size_t begin, size_t end) {
+        trim(content, begin, end);
+        if (begin == end || content[begin] == '#') return;
+        std::wstring punct = Utf8Codec::decode(content.substr(begin, end - begin));
+        if (!punct.empty()) items.push_back(punct);
+    });
+    return (int)items.size();
+}
+
+int parseUserDict(const std::string& content, UserEntries& entries) {
+    entries.clear();
+    forEachLine(content, [&](size_t begin, size_t end) {
+        if (begin == end || content[begin] == '#') return;
+        std::string line = content.substr(begin, end - begin);
+        std::vector<std::string> parts;
+        size_t start = 0;
+        for (;;) {
+            size_t tab = line.find('\t', start);
+            parts.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos) break;
+            start = tab + 1;
+        }
+        // 結尾的空欄位不算（與 getline 分割的結果相同）
+        if (!parts.empty() && parts.back().empty()) parts.pop_back();
+        if (parts.size() < 2) return;
+
+        UserEntry entry;
+        entry.word = Utf8Codec::decode(parts[0]);
+        entry.frequency = 1;
+        if (parts.size() >= 3) {
+            // 頻率不是數字的行略過
+            const char* text = parts[2].c_str();
+            char* stop = nullptr;
+            long value = strtol(text, &stop, 10);
+            if (stop == text) return;
+            entry.frequency = (int)value;
+        }
+        if (!entry.word.empty()) entries.push_back(entry);
+    });
+    return (int)entries.size();
+}
+
+int parseWordPhrases(const std::string& content, CodeTable& phrases) {
+    phrases.clear();
+    int count = 0;
+    forEachLine(content, [&](size_t begin, size_t end) {
+        trim(content, begin, end);
+        if (begin == end || content[begin] == '#' || content[begin] == ';') return;
+        std::wstring phrase = Utf8Codec::decode(content.substr(begin, end - begin));
+        if (phrase.length() < 2 || phrase.length() > 10) return;
+        // 每個字（除了最後一個）對應到下一個字，支援連續聯想：電→腦→系→統
+        for (size_t i = 0; i + 1 < phrase.length(); i++) {
+            std::vector<std::wstring>& next = phrases[phrase.substr(i, 1)];
+            std::wstring nextChar = phrase.substr(i + 1, 1);
+            if (std::find(next.begin(), next.end(), nextChar) == next.end()) {
+                next.push_back(nextChar);
+                count++;
+            }
+        }
+    });
+    return count;
+}
+
+}
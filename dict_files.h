@@ -0,0 +1,61 @@
+// dict_files.h - 字典檔案的讀取與解析（可攜式，不依賴 Windows API）
+#ifndef DICT_FILES_H
+#define DICT_FILES_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// 解析只產生資料，不碰 GlobalState，因此可以在背景執行緒重建後再交給介面執行緒換上
+// 檔案皆為 UTF-8（可含 BOM），行尾 CRLF 或 LF 皆可
+namespace DictFiles {
+    // 字碼 → 候選字（字碼表與詞語庫的解析結果，由 DictModel 編譯成映像）
+    typedef std::map<std::wstring, std::vector<std::wstring>> CodeTable;
+
+    // user_dict.txt 的一筆記錄
+    struct UserEntry {
+        std::wstring word;
+        int frequency;
+    };
+    typedef std::vector<UserEntry> UserEntries;
+
+    // 以二進位讀入整個檔案；無法開啟時回傳 false
+    bool readFile(const std::string& path, std::string& content);
+
+    // Zi-Ma-Biao.txt：每行「字<TAB>字碼」，# 開頭為註解；回傳字數
+    int parseMainDict(const std::string& content, CodeTable& dict);
+
+    // 分段解析 Zi-Ma-Biao.txt（例如下載時邊收邊解析）；任意切段的結果都與 parseMainDict 相同
+    class MainDictParser {
+    public:
+        explicit MainDictParser(CodeTable& dict);
+        void feed(const char* data, size_t size);
+        // 輸入結束：處理最後一行（沒有換行時）
+        void finish();
+        // 清除字典與統計，從頭開始
+        void reset();
+
+        int entryCount() const { return entries_; }
+        // 不是註解也不是有效記錄的行，或含有無效 UTF-8、NUL 的記錄（仍會加入字典）
+        int malformedLines() const { return malformed_; }
+
+    private:
+        void parseLine(const char* begin, const char* end);
+
+        CodeTable& dict_;
+        std::string pending_;       // 尚未遇到換行的部分
+        bool firstLine_;
+        int entries_;
+        int malformed_;
+        std::wstring code_;
+        std::wstring word_;
+    };
+    // punct_menu.txt：每行一個符號，# 開頭為註解；回傳符號數
+    int parsePunctMenu(const std::string& content, std::vector<std::wstring>& items);
+    // user_dict.txt：「詞語<TAB><TAB>頻率<TAB>狀態」，頻率省略時為 1；回傳記錄數
+    int parseUserDict(const std::string& content, UserEntries& entries);
+    // word_phrases.txt：每行一個 2 到 10 字的詞語，建立每個字到下一個字的聯想；回傳聯想組合數
+    int parseWordPhrases(const std::string& content, CodeTable& phrases);
+}
+
+#endif // DICT_FILES_H
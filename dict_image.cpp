@@ -0,0 +1,433 @@
+// dict_image.cpp - 字碼表與詞語庫的編譯映像實作
+#include "dict_image.h"
+#include "file_io.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DictImage {
+
+// 檔頭之後依序為：鍵記錄、值（字串位移）、反查記錄、字串池（wchar_t）；各段都是 4 位元組對齊
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t wcharSize;
+    uint32_t byteOrder;
+    uint32_t kind;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t checksum;      // 檔頭之後所有位元組的 FNV-1a
+    int32_t entryCount;
+    uint32_t keyCount;
+    uint32_t valueCount;
+    uint32_t reverseCount;
+    uint32_t poolSize;      // 以 wchar_t 計
+    uint32_t reserved;
+};
+static_assert(sizeof(Header) == 72, "DictImage::Header 的大小是映像檔格式的一部分");
+
+static const char IMAGE_MAGIC[8] = {'S', 'T', 'K', 'I', 'M', 'G', '0', '1'};
+static const uint32_t IMAGE_VERSION = 1;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+int Text::compare(const std::wstring& other) const {
+    return compare(Text(other.data(), other.size()));
+}
+
+int Text::compare(const Text& other) const {
+    size_t common = std::min(size, other.size);
+    int result = std::char_traits<wchar_t>::compare(data, other.data, common);
+    if (result != 0) return result;
+    return size < other.size ? -1 : (size > other.size ? 1 : 0);
+}
+
+bool Text::startsWith(const std::wstring& prefix) const {
+    return size >= prefix.size() && std::char_traits<wchar_t>::compare(data, prefix.data(), prefix.size()) == 0;
+}
+
+Source identify(const std::string& content) {
+    Source source;
+    source.size = content.size();
+    source.hash = FileIO::fnv64(content);
+    return source;
+}
+
+// 記憶體中的映像：以 uint64_t 配置，確保各段對齊
+class MemoryImage : public Image {
+public:
+    explicit MemoryImage(size_t size) : words_((size + 7) / 8), size_(size) {}
+    const char* data() const override { return (const char*)words_.data(); }
+    char* data() { return (char*)words_.data(); }
+    size_t size() const override { return size_; }
+    bool mapped() const override { return false; }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t size_;
+};
+
+size_t Table::imageSize(uint64_t keys, uint64_t values, uint64_t reverse, uint64_t pool) {
+    uint64_t size = sizeof(Header) + keys * sizeof(KeyRecord) + values * sizeof(Ref) +
+                    reverse * sizeof(ReverseRecord) + pool * sizeof(wchar_t);
+    // 4 位元組對齊（wchar_t 為 2 位元組時字串池的長度可能不是 4 的倍數）
+    size = (size + 3) & ~(uint64_t)3;
+    return size > (uint64_t)SIZE_MAX ? 0 : (size_t)size;
+}
+
+// 字串池：相同的字串只存一次
+class PoolBuilder {
+public:
+    uint32_t add(const std::wstring& text) {
+        std::unordered_map<std::wstring, uint32_t>::iterator it = offsets_.find(text);
+        if (it != offsets_.end()) return it->second;
+        uint32_t offset = (uint32_t)pool_.size();
+        pool_.append(text);
+        offsets_.insert(std::make_pair(text, offset));
+        return offset;
+    }
+    const std::wstring& pool() const { return pool_; }
+
+private:
+    std::wstring pool_;
+    std::unordered_map<std::wstring, uint32_t> offsets_;
+};
+
+ImagePtr build(const DictFiles::CodeTable& table, int entryCount, Kind kind, const Source& source) {
+    typedef Table::Ref Ref;
+    typedef Table::KeyRecord KeyRecord;
+    typedef Table::ReverseRecord ReverseRecord;
+    std::vector<KeyRecord> keys;
+    std::vector<Ref> values;
+    std::vector<std::pair<std::wstring, uint32_t>> firstKeys;
+    std::unordered_map<std::wstring, bool> seen;
+    PoolBuilder pool;
+    keys.reserve(table.size());
+
+    for (DictFiles::CodeTable::const_iterator it = table.begin(); it != table.end(); ++it) {
+        KeyRecord record;
+        record.key.offset = pool.add(it->first);
+        record.key.size = (uint32_t)it->first.size();
+        record.first = (uint32_t)values.size();
+        record.count = (uint32_t)it->second.size();
+        for (size_t i = 0; i < it->second.size(); i++) {
+            const std::wstring& value = it->second[i];
+            Ref ref = {pool.add(value), (uint32_t)value.size()};
+            values.push_back(ref);
+            // 依鍵的順序走訪，只記第一次出現的鍵（與逐一掃描字典找到的第一個相同）
+            if (kind == KIND_MAIN_DICT && seen.insert(std::make_pair(value, true)).second) {
+                firstKeys.push_back(std::make_pair(value, (uint32_t)keys.size()));
+            }
+        }
+        keys.push_back(record);
+    }
+    std::sort(firstKeys.begin(), firstKeys.end());
+
+    std::vector<ReverseRecord> reverse(firstKeys.size());
+    for (size_t i = 0; i < firstKeys.size(); i++) {
+        reverse[i].word.offset = pool.add(firstKeys[i].first);
+        reverse[i].word.size = (uint32_t)firstKeys[i].first.size();
+        reverse[i].key = firstKeys[i].second;
+    }
+
+    const std::wstring& chars = pool.pool();
+    size_t size = Table::imageSize(keys.size(), values.size(), reverse.size(), chars.size());
+    std::shared_ptr<MemoryImage> image = std::make_shared<MemoryImage>(size);
+    char* out = image->data();
+    Header header = {};
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.wcharSize = sizeof(wchar_t);
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.kind = kind;
+    header.sourceSize = source.size;
+    header.sourceHash = source.hash;
+    header.entryCount = entryCount;
+    header.keyCount = (uint32_t)keys.size();
+    header.valueCount = (uint32_t)values.size();
+    header.reverseCount = (uint32_t)reverse.size();
+    header.poolSize = (uint32_t)chars.size();
+
+    size_t pos = sizeof(Header);
+    if (!keys.empty()) memcpy(out + pos, keys.data(), keys.size() * sizeof(KeyRecord));
+    pos += keys.size() * sizeof(KeyRecord);
+    if (!values.empty()) memcpy(out + pos, values.data(), values.size() * sizeof(Ref));
+    pos += values.size() * sizeof(Ref);
+    if (!reverse.empty()) memcpy(out + pos, reverse.data(), reverse.size() * sizeof(ReverseRecord));
+    pos += reverse.size() * sizeof(ReverseRecord);
+    if (!chars.empty()) memcpy(out + pos, chars.data(), chars.size() * sizeof(wchar_t));
+    header.checksum = FileIO::fnv64(out + sizeof(Header), size - sizeof(Header));
+    memcpy(out, &header, sizeof(header));
+    return image;
+}
+
+bool validate(const char* data, size_t size, Kind kind, const Source& source) {
+    typedef Table::Ref Ref;
+    if (size < sizeof(Header)) return false;
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 || header.version != IMAGE_VERSION ||
+        header.wcharSize != sizeof(wchar_t) || header.byteOrder != BYTE_ORDER_MARK ||
+        header.kind != (uint32_t)kind || header.sourceSize != source.size || header.sourceHash != source.hash) {
+        return false;
+    }
+    if (Table::imageSize(header.keyCount, header.valueCount, header.reverseCount, header.poolSize) != size) return false;
+    if (FileIO::fnv64(data + sizeof(Header), size - sizeof(Header)) != header.checksum) return false;
+
+    // 校驗碼只能發現損毀；位移仍逐一檢查，格式錯誤的檔案也不會讀到映像之外
+    const Table::KeyRecord* keys = (const Table::KeyRecord*)(data + sizeof(Header));
+    const Ref* values = (const Ref*)(keys + header.keyCount);
+    const Table::ReverseRecord* reverse = (const Table::ReverseRecord*)(values + header.valueCount);
+    uint64_t pool = header.poolSize;
+    auto inPool = [pool](const Ref& ref) { return (uint64_t)ref.offset + ref.size <= pool; };
+    for (uint32_t i = 0; i < header.keyCount; i++) {
+        if (!inPool(keys[i].key) || (uint64_t)keys[i].first + keys[i].count > header.valueCount) return false;
+    }
+    for (uint32_t i = 0; i < header.valueCount; i++) {
+        if (!inPool(values[i])) return false;
+    }
+    for (uint32_t i = 0; i < header.reverseCount; i++) {
+        if (!inPool(reverse[i].word) || reverse[i].key >= header.keyCount) return false;
+    }
+
+    // 查詢以二分搜尋進行：鍵與反查索引都必須嚴格遞增，否則會找不到存在的鍵
+    const wchar_t* chars = (const wchar_t*)(reverse + header.reverseCount);
+    auto less = [chars](const Ref& a, const Ref& b) {
+        return Text(chars + a.offset, a.size).compare(Text(chars + b.offset, b.size)) < 0;
+    };
+    for (uint32_t i = 1; i < header.keyCount; i++) {
+        if (!less(keys[i - 1].key, keys[i].key)) return false;
+    }
+    for (uint32_t i = 1; i < header.reverseCount; i++) {
+        if (!less(reverse[i - 1].word, reverse[i].word)) return false;
+    }
+    return true;
+}
+
+#ifdef _WIN32
+
+class MappedImage : public Image {
+public:
+    MappedImage(HANDLE mapping, const char* data, size_t size) : mapping_(mapping), data_(data), size_(size) {}
+    ~MappedImage() override {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+    }
+    const char* data() const override { return data_; }
+    size_t size() const override { return size_; }
+    bool mapped() const override { return true; }
+
+private:
+    HANDLE mapping_;
+    const char* data_;
+    size_t size_;
+};
+
+ImagePtr map(const std::string& path, Kind kind, const Source& source) {
+    // FILE_SHARE_DELETE：對映中的映像檔仍可被改名或刪除
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return ImagePtr();
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(Header)) {
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(file);
+    if (!mapping) return ImagePtr();
+    const char* data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        return ImagePtr();
+    }
+    ImagePtr image = std::make_shared<MappedImage>(mapping, data, (size_t)fileSize.QuadPart);
+    return validate(image->data(), image->size(), kind, source) ? image : ImagePtr();
+}
+
+static unsigned long processId() {
+    return GetCurrentProcessId();
+}
+
+// dir 中以 prefix 開頭的檔名
+static std::vector<std::string> listFiles(const std::string& dir, const std::string& prefix) {
+    std::vector<std::string> names;
+    WIN32_FIND_DATAA found;
+    HANDLE find = FindFirstFileA((dir + "\\" + prefix + "*").c_str(), &found);
+    if (find == INVALID_HANDLE_VALUE) return names;
+    do {
+        names.push_back(found.cFileName);
+    } while (FindNextFileA(find, &found));
+    FindClose(find);
+    return names;
+}
+
+#else
+
+class MappedImage : public Image {
+public:
+    MappedImage(void* data, size_t size) : data_(data), size_(size) {}
+    ~MappedImage() override { munmap(data_, size_); }
+    const char* data() const override { return (const char*)data_; }
+    size_t size() const override { return size_; }
+    bool mapped() const override { return true; }
+
+private:
+    void* data_;
+    size_t size_;
+};
+
+ImagePtr map(const std::string& path, Kind kind, const Source& source) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return ImagePtr();
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header)) {
+        data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // 對映建立後不需要保留檔案描述元
+    close(fd);
+    if (data == MAP_FAILED) return ImagePtr();
+    ImagePtr image = std::make_shared<MappedImage>(data, (size_t)st.st_size);
+    return validate(image->data(), image->size(), kind, source) ? image : ImagePtr();
+}
+
+static unsigned long processId() {
+    return (unsigned long)getpid();
+}
+
+static std::vector<std::string> listFiles(const std::string& dir, const std::string& prefix) {
+    std::vector<std::string> names;
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) return names;
+    while (struct dirent* entry = readdir(handle)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) names.push_back(entry->d_name);
+    }
+    closedir(handle);
+    return names;
+}
+
+#endif
+
+bool write(const std::string& path, const Image& image) {
+    // 暫存檔名含程序編號與序號：多個程序（或同一程序的多個執行緒）同時建立同一個映像檔時不互相覆寫
+    static std::atomic<unsigned> serial(0);
+    std::string temp = path + "." + std::to_string(processId()) + "-" + std::to_string(serial++) + ".tmp";
+    FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    return FileIO::commitFile(file, temp, path, ok);
+}
+
+std::string imagePath(const std::string& path, const Source& source) {
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)source.hash);
+    return path + "." + hash + ".img";
+}
+
+// name 是否為 base 的映像檔名：base.img（舊版）或 base.<16 位十六進位>.img
+static bool isImageName(const std::string& name, const std::string& base) {
+    static const size_t HASH_DIGITS = 16;
+    if (name == base + ".img") return true;
+    if (name.size() != base.size() + 1 + HASH_DIGITS + 4) return false;
+    if (name.compare(0, base.size() + 1, base + ".") != 0) return false;
+    if (name.compare(name.size() - 4, 4, ".img") != 0) return false;
+    for (size_t i = base.size() + 1; i < base.size() + 1 + HASH_DIGITS; i++) {
+        if (!isxdigit((unsigned char)name[i])) return false;
+    }
+    return true;
+}
+
+int removeStale(const std::string& path, const Source& source) {
+    size_t slash = path.find_last_of("/\\");
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string base = slash == std::string::npos ? path : path.substr(slash + 1);
+    std::string keep = imagePath(base, source);
+    std::vector<std::string> names = listFiles(dir, base + ".");
+    int removed = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == keep || !isImageName(names[i], base)) continue;
+        // POSIX 上已對映的程序繼續使用原本的頁面；Windows 上對映中的檔案刪除失敗，留到下次
+        if (std::remove((dir + "/" + names[i]).c_str()) == 0) removed++;
+    }
+    return removed;
+}
+
+Table::Table()
+    : keys_(nullptr), values_(nullptr), reverse_(nullptr), pool_(nullptr),
+      keyCount_(0), reverseCount_(0), entryCount_(0) {}
+
+Table::Table(const Image& image) {
+    Header header;
+    memcpy(&header, image.data(), sizeof(header));
+    keys_ = (const KeyRecord*)(image.data() + sizeof(Header));
+    values_ = (const Ref*)(keys_ + header.keyCount);
+    reverse_ = (const ReverseRecord*)(values_ + header.valueCount);
+    pool_ = (const wchar_t*)(reverse_ + header.reverseCount);
+    keyCount_ = header.keyCount;
+    reverseCount_ = header.reverseCount;
+    entryCount_ = header.entryCount;
+}
+
+Text Table::key(size_t index) const {
+    return text(keys_[index].key);
+}
+
+size_t Table::valueCount(size_t index) const {
+    return keys_[index].count;
+}
+
+Text Table::value(size_t index, size_t i) const {
+    return text(values_[keys_[index].first + i]);
+}
+
+size_t Table::find(const std::wstring& key) const {
+    size_t index = upperBound(key);
+    if (index == 0 || text(keys_[index - 1].key).compare(key) != 0) return NOT_FOUND;
+    return index - 1;
+}
+
+size_t Table::upperBound(const std::wstring& key) const {
+    size_t low = 0, high = keyCount_;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (text(keys_[mid].key).compare(key) <= 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+size_t Table::firstKeyOf(const std::wstring& word) const {
+    size_t low = 0, high = reverseCount_;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (text(reverse_[mid].word).compare(word) < 0) low = mid + 1;
+        else high = mid;
+    }
+    if (low == reverseCount_ || text(reverse_[low].word).compare(word) != 0) return NOT_FOUND;
+    return reverse_[low].key;
+}
+
+void Table::copyTo(DictFiles::CodeTable& table) const {
+    table.clear();
+    for (size_t i = 0; i < keyCount_; i++) {
+        std::vector<std::wstring>& list = table[key(i).str()];
+        list.reserve(keys_[i].count);
+        for (size_t j = 0; j < keys_[i].count; j++) list.push_back(value(i, j).str());
+    }
+}
+
+}
@@ -0,0 +1,130 @@
+// dict_image.h - 字碼表與詞語庫的編譯映像：以位移存放、可由多個程序唯讀對映共用（可攜式介面）
+#ifndef DICT_IMAGE_H
+#define DICT_IMAGE_H
+
+#include "dict_files.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// 映像是一段連續的位元組：檔頭、依鍵排序的索引與字串池，位置都以位移表示（沒有指標），
+// 同一個映像檔可以對映在每個程序的任何位址，實體頁面由作業系統在程序間共用
+// 映像檔只在同一台電腦上使用：wchar_t 大小與位元組順序記錄在檔頭，不同時視為不對應而重建
+namespace DictImage {
+    const size_t NOT_FOUND = (size_t)-1;
+
+    // 映像中的字串（不以 NUL 結尾）
+    struct Text {
+        const wchar_t* data;
+        size_t size;
+        Text() : data(nullptr), size(0) {}
+        Text(const wchar_t* d, size_t n) : data(d), size(n) {}
+        std::wstring str() const { return std::wstring(data, size); }
+        // 與 std::wstring::compare 相同的順序
+        int compare(const std::wstring& other) const;
+        int compare(const Text& other) const;
+        bool startsWith(const std::wstring& prefix) const;
+    };
+
+    enum Kind {
+        KIND_MAIN_DICT = 1,     // 字碼 → 字，含字 → 第一個字碼的反查索引
+        KIND_PHRASES = 2        // 字 → 後續的字
+    };
+
+    // 來源文字檔的識別：映像檔記錄編譯時的內容大小與雜湊，內容不同時不使用
+    struct Source {
+        uint64_t size;
+        uint64_t hash;
+        Source() : size(0), hash(0) {}
+    };
+    Source identify(const std::string& content);
+
+    // 映像的位元組：在記憶體中建立，或唯讀對映的映像檔
+    class Image {
+    public:
+        virtual ~Image() {}
+        virtual const char* data() const = 0;
+        virtual size_t size() const = 0;
+        // 由映像檔對映（頁面與其他程序共用）
+        virtual bool mapped() const = 0;
+    };
+    typedef std::shared_ptr<const Image> ImagePtr;
+
+    // 在記憶體中由 table 建立映像；entryCount 為解析時的記錄數
+    ImagePtr build(const DictFiles::CodeTable& table, int entryCount, Kind kind, const Source& source);
+    // 唯讀對映映像檔；不存在、損毀、種類或來源不符時回傳空指標
+    ImagePtr map(const std::string& path, Kind kind, const Source& source);
+    // 寫出映像檔：先寫暫存檔再取代，其他程序不會對映到寫到一半的檔案
+    // 取代失敗（例如 Windows 上舊檔仍被對映中）時回傳 false
+    bool write(const std::string& path, const Image& image);
+
+    // 文字檔 path 的內容 source 的映像檔名：path.<內容雜湊 16 位十六進位>.img
+    // 內容改變後的映像是另一個檔案，不必取代仍被其他程序對映的舊映像（Windows 上無法取代）
+    std::string imagePath(const std::string& path, const Source& source);
+    // 刪除 path 其他內容的映像檔（與舊版的 path.img），保留 source 的映像；回傳刪除的數量
+    // 仍被對映而無法刪除的（Windows）留在原處，之後載入時再刪
+    int removeStale(const std::string& path, const Source& source);
+
+    // 映像的內容：依鍵排序的 鍵 → 值列表（CodeTable 的唯讀扁平版本）
+    // 只保存指向映像的位址，複製很便宜；使用期間映像必須存在
+    class Table {
+    public:
+        Table();                            // 空表
+        explicit Table(const Image& image); // image 必須是 build 或 map 的結果
+
+        int entryCount() const { return entryCount_; }
+        size_t size() const { return keyCount_; }
+        Text key(size_t index) const;
+        size_t valueCount(size_t index) const;
+        Text value(size_t index, size_t i) const;
+
+        // 鍵的位置；沒有時回傳 NOT_FOUND
+        size_t find(const std::wstring& key) const;
+        // 第一個大於 key 的鍵的位置（沒有時為 size()）
+        size_t upperBound(const std::wstring& key) const;
+        // 值 word 第一次出現（依鍵的順序）的鍵的位置；沒有反查索引或找不到時回傳 NOT_FOUND
+        size_t firstKeyOf(const std::wstring& word) const;
+
+        // 還原成 CodeTable（套用差異更新等需要修改時）
+        void copyTo(DictFiles::CodeTable& table) const;
+
+    private:
+        struct Ref {
+            uint32_t offset;    // 字串池中的位置（以 wchar_t 計）
+            uint32_t size;
+        };
+        struct KeyRecord {
+            Ref key;
+            uint32_t first;     // 第一個值在值陣列中的位置
+            uint32_t count;
+        };
+        struct ReverseRecord {
+            Ref word;
+            uint32_t key;
+        };
+        // 記錄直接寫入映像檔：大小（沒有填充）是檔案格式的一部分，改變時須更新 IMAGE_VERSION
+        static_assert(sizeof(Ref) == 8, "DictImage::Table::Ref 須為 8 位元組");
+        static_assert(sizeof(KeyRecord) == 16, "DictImage::Table::KeyRecord 須為 16 位元組");
+        static_assert(sizeof(ReverseRecord) == 12, "DictImage::Table::ReverseRecord 須為 12 位元組");
+        // 各段記錄數與字串池長度對應的映像大小；溢位時回傳 0
+        static size_t imageSize(uint64_t keys, uint64_t values, uint64_t reverse, uint64_t pool);
+        friend ImagePtr build(const DictFiles::CodeTable&, int, Kind, const Source&);
+        friend bool validate(const char* data, size_t size, Kind kind, const Source& source);
+
+        Text text(const Ref& ref) const { return Text(pool_ + ref.offset, ref.size); }
+
+        const KeyRecord* keys_;
+        const Ref* values_;
+        const ReverseRecord* reverse_;
+        const wchar_t* pool_;
+        size_t keyCount_;
+        size_t reverseCount_;
+        int entryCount_;
+    };
+
+    // 檢查映像的檔頭、各段範圍、所有位移與校驗碼
+    bool validate(const char* data, size_t size, Kind kind, const Source& source);
+}
+
+#endif // DICT_IMAGE_H
@@ -0,0 +1,100 @@
+// dict_model.cpp - 字碼表快照與原子換上實作
+#include "dict_model.h"
+
+namespace DictModel {
+
+// 映像檔放在文字檔旁邊，以文字檔內容的雜湊命名（見 DictImage::imagePath）：文字檔變更後寫出另一個映像檔，
+// 已對映舊映像的程序繼續使用舊的內容；對映到目前內容的映像後刪除其他內容的舊映像檔
+static DictImage::ImagePtr mapImage(const std::string& path, DictImage::Kind kind,
+                                    const DictImage::Source& source) {
+    DictImage::ImagePtr image = DictImage::map(DictImage::imagePath(path, source), kind, source);
+    if (image) DictImage::removeStale(path, source);
+    return image;
+}
+
+// 寫出映像檔並改為對映；無法寫出或對映（例如目錄不可寫入）時沿用記憶體中的映像
+static DictImage::ImagePtr publishImage(const std::string& path, const DictImage::ImagePtr& image,
+                                        DictImage::Kind kind, const DictImage::Source& source) {
+    if (!DictImage::write(DictImage::imagePath(path, source), *image)) return image;
+    DictImage::ImagePtr mapped = mapImage(path, kind, source);
+    return mapped ? mapped : image;
+}
+
+Snapshot::Snapshot(const DictImage::ImagePtr& image) : image_(image), table_(*image) {}
+
+DictImage::Text Snapshot::codeOf(const std::wstring& word) const {
+    size_t index = table_.firstKeyOf(word);
+    return index == DictImage::NOT_FOUND ? DictImage::Text() : table_.key(index);
+}
+
+SnapshotPtr build(DictFiles::CodeTable& table, int entryCount) {
+    DictImage::ImagePtr image = DictImage::build(table, entryCount, DictImage::KIND_MAIN_DICT, DictImage::Source());
+    table.clear();
+    return std::make_shared<const Snapshot>(image);
+}
+
+SnapshotPtr loadShared(const std::string& path, const std::string& content) {
+    DictImage::Source source = DictImage::identify(content);
+    DictImage::ImagePtr image = mapImage(path, DictImage::KIND_MAIN_DICT, source);
+    if (image) return std::make_shared<const Snapshot>(image);
+    DictFiles::CodeTable table;
+    int count = DictFiles::parseMainDict(content, table);
+    return share(path, content, table, count);
+}
+
+SnapshotPtr share(const std::string& path, const std::string& content, DictFiles::CodeTable& table, int entryCount) {
+    return share(path, DictImage::identify(content), table, entryCount);
+}
+
+SnapshotPtr share(const std::string& path, const DictImage::Source& source, DictFiles::CodeTable& table,
+                  int entryCount) {
+    DictImage::ImagePtr image = DictImage::build(table, entryCount, DictImage::KIND_MAIN_DICT, source);
+    table.clear();
+    return std::make_shared<const Snapshot>(publishImage(path, image, DictImage::KIND_MAIN_DICT, source));
+}
+
+Phrases::Phrases(const DictImage::ImagePtr& image) : image_(image), table_(*image) {}
+
+Phrases buildPhrases(DictFiles::CodeTable& table, int entryCount) {
+    DictImage::ImagePtr image = DictImage::build(table, entryCount, DictImage::KIND_PHRASES, DictImage::Source());
+    table.clear();
+    return Phrases(image);
+}
+
+Phrases loadSharedPhrases(const std::string& path, const std::string& content) {
+    DictImage::Source source = DictImage::identify(content);
+    DictImage::ImagePtr image = mapImage(path, DictImage::KIND_PHRASES, source);
+    if (image) return Phrases(image);
+    DictFiles::CodeTable table;
+    int count = DictFiles::parseWordPhrases(content, table);
+    image = DictImage::build(table, count, DictImage::KIND_PHRASES, source);
+    return Phrases(publishImage(path, image, DictImage::KIND_PHRASES, source));
+}
+
+Model::Model() {
+    DictFiles::CodeTable empty;
+    current_ = build(empty, 0);
+}
+
+Model::Model(const Model& other) : current_(other.pin()) {}
+
+Model& Model::operator=(const Model& other) {
+    if (this != &other) std::atomic_store(&current_, other.pin());
+    return *this;
+}
+
+SnapshotPtr Model::pin() const {
+    return std::atomic_load(&current_);
+}
+
+SnapshotPtr Model::publish(const SnapshotPtr& next) {
+    if (!next) return SnapshotPtr();
+    return std::atomic_exchange(&current_, next);
+}
+
+bool Model::publishIf(SnapshotPtr& expected, const SnapshotPtr& next) {
+    if (!next) return false;
+    return std::atomic_compare_exchange_strong(&current_, &expected, next);
+}
+
+}
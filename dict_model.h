@@ -0,0 +1,101 @@
+// dict_model.h - 字碼表的不可變快照與原子換上（可攜式，不依賴 Windows API）
+#ifndef DICT_MODEL_H
+#define DICT_MODEL_H
+
+#include "dict_files.h"
+#include "dict_image.h"
+#include <memory>
+#include <string>
+#include <utility>
+
+// 字碼表與它的索引一起建立成一個不可變的快照，建好後才以一次原子交換發佈：
+// - 讀者以 pin() 取得目前的快照（引用計數），查詢期間即使字典被重新載入也只會看到完整的舊版或新版
+// - 重新載入在背景建好新快照，介面執行緒只交換指標，與字典大小無關
+// - 舊快照在最後一個讀者放開時才釋放（RCU 式回收：發佈者不必等待讀者）
+// 快照的內容是編譯好的映像（見 dict_image.h）：由文字檔載入時同時寫出映像檔，
+// 之後每個程序直接唯讀對映同一個檔案，字典只佔一份實體記憶體，也不必再解析
+namespace DictModel {
+    class Snapshot {
+    public:
+        explicit Snapshot(const DictImage::ImagePtr& image);
+
+        const DictImage::Table& table() const { return table_; }
+        int entryCount() const { return table_.entryCount(); }
+        size_t codeCount() const { return table_.size(); }
+        // 映像由映像檔對映（與其他程序共用）
+        bool shared() const { return image_->mapped(); }
+
+        // 字碼在 table() 中的位置；沒有時回傳 DictImage::NOT_FOUND
+        size_t find(const std::wstring& code) const { return table_.find(code); }
+        // 字（或詞）依字碼排序的第一個字碼；不在字典中時回傳 data 為空指標的 Text
+        DictImage::Text codeOf(const std::wstring& word) const;
+
+    private:
+        Snapshot(const Snapshot&);
+        Snapshot& operator=(const Snapshot&);
+
+        DictImage::ImagePtr image_;
+        DictImage::Table table_;    // 指向 image_ 的內容
+    };
+
+    typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+    // 由 table 建立只在這個程序使用的快照（table 會被清空）
+    SnapshotPtr build(DictFiles::CodeTable& table, int entryCount);
+    // 字碼表檔案 path 的內容 content 的快照：對映符合內容的映像檔；
+    // 沒有或不符時解析 content、寫出映像檔後對映，無法寫出時使用只在這個程序的快照
+    SnapshotPtr loadShared(const std::string& path, const std::string& content);
+    // 已解析好的 table（例如下載時驗證過的）寫出映像檔後建立快照（table 會被清空）
+    SnapshotPtr share(const std::string& path, const std::string& content, DictFiles::CodeTable& table, int entryCount);
+    // 同上，來源識別由呼叫端提供（例如差異更新時由寫出的檔案內容計算）
+    SnapshotPtr share(const std::string& path, const DictImage::Source& source, DictFiles::CodeTable& table,
+                      int entryCount);
+
+    // 詞語庫：字 → 後續的字，與快照一樣以映像存放；建好後不修改，複製只共用同一個映像
+    class Phrases {
+    public:
+        Phrases() {}
+        explicit Phrases(const DictImage::ImagePtr& image);
+
+        const DictImage::Table& table() const { return table_; }
+        // 詞語組合數（與 parseWordPhrases 的回傳值相同）；沒有詞語庫時為 0
+        int entryCount() const { return table_.entryCount(); }
+        bool shared() const { return image_ && image_->mapped(); }
+
+        void clear() { Phrases().swap(*this); }
+        void swap(Phrases& other) {
+            image_.swap(other.image_);
+            std::swap(table_, other.table_);
+        }
+
+    private:
+        DictImage::ImagePtr image_;
+        DictImage::Table table_;
+    };
+
+    // 與 build、loadShared 相同，用於詞語庫檔案
+    Phrases buildPhrases(DictFiles::CodeTable& table, int entryCount);
+    Phrases loadSharedPhrases(const std::string& path, const std::string& content);
+
+    // 目前發佈的字典；可在任何執行緒讀取與發佈
+    // 複製 Model 只共用同一個快照，不複製字典
+    class Model {
+    public:
+        Model();
+        Model(const Model& other);
+        Model& operator=(const Model& other);
+
+        // 取得目前的快照（不會是空指標）；持有期間快照不會被釋放
+        SnapshotPtr pin() const;
+        // 換上新的快照並傳回舊的（呼叫端決定在哪個執行緒放開舊快照）
+        SnapshotPtr publish(const SnapshotPtr& next);
+        // 目前的快照仍是 expected 時才換上（成功時 expected 即為舊快照）；
+        // 已被換過時不變並把 expected 改為目前的快照，回傳 false
+        bool publishIf(SnapshotPtr& expected, const SnapshotPtr& next);
+
+    private:
+        SnapshotPtr current_;   // 只以 std::atomic_load / atomic_store 等存取
+    };
+}
+
+#endif // DICT_MODEL_H
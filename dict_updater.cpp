@@ -1,13 +1,19 @@
 // dict_updater.cpp - 字典更新器实现（使用WinINet API）
 #include "dict_updater.h"
+#include "http_transfer.h"
+#include "dict_files.h"
+#include "dict_verifier.h"
 #include <windows.h>
 #include <wininet.h>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <ctime>
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <mutex>
 
 // 注意：wininet.lib 已在 Makefile 中通过 -lwininet 链接
 
@@ -33,47 +39,67 @@ std::string wstringToUtf8(const std::wstring& wstr) {
     return std::string(buffer.data());
 }
 
-// 下载文件主函数
-DownloadResult downloadFromGitHub(const char* downloadUrl, const char* savePath, int timeoutSeconds) {
-    DownloadResult result;
+// ========== WinINet 傳輸 ==========
+
+// 一個請求的 WinINet 控制代碼；解構時關閉
+class WinInetResponse : public HttpTransfer::Response {
+public:
+    WinInetResponse() : hInternet_(NULL), hConnect_(NULL), hRequest_(NULL), status_(0) {}
+    ~WinInetResponse() {
+        if (hRequest_) InternetCloseHandle(hRequest_);
+        if (hConnect_) InternetCloseHandle(hConnect_);
+        if (hInternet_) InternetCloseHandle(hInternet_);
+    }
     
-    // 使用默认值
-    std::string url = downloadUrl ? downloadUrl : GITHUB_RAW_URL;
-    std::string path = savePath ? savePath : TEMP_DICT_FILE;
+    int status() const override { return status_; }
     
-    HINTERNET hInternet = NULL;
-    HINTERNET hConnect = NULL;
-    HINTERNET hRequest = NULL;
+    std::string header(const std::string& name) const override {
+        // HTTP_QUERY_CUSTOM：緩衝區傳入標頭名稱，傳回標頭值
+        char buffer[1024];
+        if (name.size() >= sizeof(buffer)) return std::string();
+        memcpy(buffer, name.c_str(), name.size() + 1);
+        DWORD length = sizeof(buffer);
+        if (!HttpQueryInfoA(hRequest_, HTTP_QUERY_CUSTOM, buffer, &length, NULL)) return std::string();
+        return std::string(buffer, length);
+    }
     
-    try {
-        // 初始化WinINet
-        hInternet = InternetOpenA(
-            "ChineseStrokeIME",
-            INTERNET_OPEN_TYPE_PRECONFIG,
-            NULL,
-            NULL,
-            0
-        );
+    long read(char* buffer, size_t size) override {
+        DWORD bytesRead = 0;
+        if (!InternetReadFile(hRequest_, buffer, (DWORD)size, &bytesRead)) return -1;
+        return (long)bytesRead;
+    }
+    
+    HINTERNET hInternet_;
+    HINTERNET hConnect_;
+    HINTERNET hRequest_;
+    int status_;
+};
+
+class WinInetTransport : public HttpTransfer::Transport {
+public:
+    explicit WinInetTransport(int timeoutSeconds) : timeoutSeconds_(timeoutSeconds) {}
+    
+    std::unique_ptr<HttpTransfer::Response> get(const std::string& url, const HttpTransfer::Headers& headers,
+                                                std::wstring& error) override {
+        std::unique_ptr<WinInetResponse> response(new WinInetResponse());
         
-        if (!hInternet) {
-            result.status = DownloadStatus::NetworkError;
-            result.message = L"無法初始化網路連線";
-            return result;
+        // 初始化WinINet
+        response->hInternet_ = InternetOpenA("ChineseStrokeIME", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0);
+        if (!response->hInternet_) {
+            error = L"無法初始化網路連線";
+            return nullptr;
         }
         
         // 设置超时
-        DWORD timeout = timeoutSeconds * 1000;
-        InternetSetOptionA(hInternet, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
-        InternetSetOptionA(hInternet, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
-        InternetSetOptionA(hInternet, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
+        DWORD timeout = timeoutSeconds_ * 1000;
+        InternetSetOptionA(response->hInternet_, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
+        InternetSetOptionA(response->hInternet_, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
+        InternetSetOptionA(response->hInternet_, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
         
         // 解析URL
         URL_COMPONENTSA urlComp;
         ZeroMemory(&urlComp, sizeof(urlComp));
         urlComp.dwStructSize = sizeof(urlComp);
-        urlComp.dwHostNameLength = 1;
-        urlComp.dwUrlPathLength = 1;
-        urlComp.dwSchemeLength = 1;
         
         char hostName[256] = {0};
         char urlPath[2048] = {0};
@@ -87,9 +113,8 @@ DownloadResult downloadFromGitHub(const char* downloadUrl, const char* savePath,
         urlComp.dwSchemeLength = sizeof(scheme);
         
         if (!InternetCrackUrlA(url.c_str(), url.length(), 0, &urlComp)) {
-            result.status = DownloadStatus::NetworkError;
-            result.message = L"無效的URL格式";
-            goto cleanup;
+            error = L"無效的URL格式";
+            return nullptr;
         }
         
         // 连接到服务器
@@ -97,135 +122,171 @@ DownloadResult downloadFromGitHub(const char* downloadUrl, const char* savePath,
         if (port == 0) {
             port = (urlComp.nScheme == INTERNET_SCHEME_HTTPS) ? INTERNET_DEFAULT_HTTPS_PORT : INTERNET_DEFAULT_HTTP_PORT;
         }
-        
-        hConnect = InternetConnectA(
-            hInternet,
-            hostName,
-            port,
-            NULL,
-            NULL,
-            (urlComp.nScheme == INTERNET_SCHEME_HTTPS) ? INTERNET_SERVICE_HTTP : INTERNET_SERVICE_HTTP,
-            0,
-            0
-        );
-        
-        if (!hConnect) {
-            result.status = DownloadStatus::NetworkError;
-            result.message = L"無法連接到伺服器";
-            goto cleanup;
+        response->hConnect_ = InternetConnectA(response->hInternet_, hostName, port, NULL, NULL,
+                                               INTERNET_SERVICE_HTTP, 0, 0);
+        if (!response->hConnect_) {
+            error = L"無法連接到伺服器";
+            return nullptr;
         }
         
-        // 创建HTTP请求
+        // 不使用 WinINet 快取：條件式請求的標頭由呼叫端自行加上，304 直接交給呼叫端處理
+        // 也不開啟 INTERNET_OPTION_HTTP_DECODING：gzip 內容原樣交給呼叫端邊收邊解壓縮
         DWORD flags = INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE;
         if (urlComp.nScheme == INTERNET_SCHEME_HTTPS) {
             flags |= INTERNET_FLAG_SECURE;
         }
-        
-        hRequest = HttpOpenRequestA(
-            hConnect,
-            "GET",
-            urlPath,
-            "HTTP/1.1",
-            NULL,
-            NULL,
-            flags,
-            0
-        );
-        
-        if (!hRequest) {
-            result.status = DownloadStatus::NetworkError;
-            result.message = L"無法建立HTTP請求";
-            goto cleanup;
+        response->hRequest_ = HttpOpenRequestA(response->hConnect_, "GET", urlPath, "HTTP/1.1", NULL, NULL, flags, 0);
+        if (!response->hRequest_) {
+            error = L"無法建立HTTP請求";
+            return nullptr;
         }
         
-        // 发送请求
-        if (!HttpSendRequestA(hRequest, NULL, 0, NULL, 0)) {
-            result.status = DownloadStatus::NetworkError;
-            result.message = L"無法發送HTTP請求";
-            goto cleanup;
+        std::string extra;
+        for (size_t i = 0; i < headers.size(); i++) {
+            extra += headers[i].first + ": " + headers[i].second + "\r\n";
+        }
+        if (!HttpSendRequestA(response->hRequest_, extra.empty() ? NULL : extra.c_str(), (DWORD)extra.size(), NULL, 0)) {
+            error = L"無法發送HTTP請求";
+            return nullptr;
         }
         
         // 获取HTTP状态码
         DWORD statusCode = 0;
         DWORD statusCodeSize = sizeof(statusCode);
-        HttpQueryInfoA(hRequest, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
-                      &statusCode, &statusCodeSize, NULL);
-        result.httpCode = statusCode;
-        
-        if (statusCode != HTTP_STATUS_OK) {
+        HttpQueryInfoA(response->hRequest_, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER,
+                       &statusCode, &statusCodeSize, NULL);
+        response->status_ = (int)statusCode;
+        return std::unique_ptr<HttpTransfer::Response>(response.release());
+    }
+    
+private:
+    int timeoutSeconds_;
+};
+
+// 下載 url 到 target 的暫存檔（依狀態檔送出條件式請求或續傳）
+static DownloadResult fetchToTemp(const std::string& url, const HttpTransfer::Target& target, int timeoutSeconds,
+                                  HttpTransfer::FetchResult& fetched, HttpTransfer::BodySink* sink = nullptr,
+                                  HttpTransfer::Monitor* monitor = nullptr) {
+    DownloadResult result;
+    WinInetTransport transport(timeoutSeconds);
+    fetched = HttpTransfer::fetch(transport, url, target, sink, monitor);
+    result.httpCode = fetched.httpCode;
+    result.fileSize = (size_t)fetched.fileSize;
+    result.message = fetched.error;
+    
+    switch (fetched.outcome) {
+        case HttpTransfer::FETCH_COMPLETE:
+            result.status = DownloadStatus::Success;
+            result.message = fetched.resumed ? L"下載成功（續傳）" : L"下載成功";
+            if (fetched.compressed) {
+                result.message += L"（壓縮傳輸 " + std::to_wstring(fetched.received) + L" 字節）";
+            }
+            break;
+        case HttpTransfer::FETCH_NOT_MODIFIED:
+            result.status = DownloadStatus::NotModified;
+            result.message = L"伺服器上的檔案沒有變更";
+            break;
+        case HttpTransfer::FETCH_INCOMPLETE:
+        case HttpTransfer::FETCH_NETWORK_ERROR:
+            result.status = DownloadStatus::NetworkError;
+            break;
+        case HttpTransfer::FETCH_CANCELLED:
+            result.status = DownloadStatus::Cancelled;
+            break;
+        case HttpTransfer::FETCH_HTTP_ERROR:
             result.status = DownloadStatus::HttpError;
-            std::wstringstream ss;
-            ss << L"HTTP錯誤：" << statusCode;
-            result.message = ss.str();
-            goto cleanup;
-        }
-        
-        // 打开文件准备写入
-        std::ofstream outFile(path, std::ios::binary);
-        if (!outFile.is_open()) {
-            result.status = DownloadStatus::FileError;
-            result.message = L"無法建立臨時文件";
-            goto cleanup;
-        }
-        
-        // 读取数据并写入文件
-        const size_t BUFFER_SIZE = 8192;
-        std::vector<char> buffer(BUFFER_SIZE);
-        DWORD bytesRead = 0;
-        size_t totalBytes = 0;
-        
-        while (InternetReadFile(hRequest, buffer.data(), BUFFER_SIZE, &bytesRead)) {
-            if (bytesRead == 0) break;
-            outFile.write(buffer.data(), bytesRead);
-            totalBytes += bytesRead;
-        }
-        
-        outFile.close();
-        
-        if (!outFile.good() && totalBytes == 0) {
+            break;
+        case HttpTransfer::FETCH_FILE_ERROR:
             result.status = DownloadStatus::FileError;
-            result.message = L"文件寫入失敗";
-            DeleteFileA(path.c_str());  // 删除失败的文件
-            goto cleanup;
-        }
-        
-        result.fileSize = totalBytes;
-        result.status = DownloadStatus::Success;
-        result.message = L"下載成功";
-        
-    } catch (...) {
-        result.status = DownloadStatus::NetworkError;
-        result.message = L"下載過程中發生異常";
+            break;
     }
+    return result;
+}
+
+static HttpTransfer::Target targetFor(const std::string& path, const std::string& tempPath) {
+    HttpTransfer::Target target;
+    target.path = path;
+    target.tempPath = tempPath;
+    target.metaPath = path + ".meta";
+    return target;
+}
+
+// 下载文件主函数
+DownloadResult downloadFromGitHub(const char* downloadUrl, const char* savePath, int timeoutSeconds,
+                                  HttpTransfer::Monitor* monitor) {
+    // 使用默认值
+    std::string url = downloadUrl ? downloadUrl : GITHUB_RAW_URL;
+    std::string path = savePath ? savePath : TEMP_DICT_FILE;
+    HttpTransfer::Target target = targetFor(path, path + ".tmp");
     
-cleanup:
-    if (hRequest) InternetCloseHandle(hRequest);
-    if (hConnect) InternetCloseHandle(hConnect);
-    if (hInternet) InternetCloseHandle(hInternet);
+    HttpTransfer::FetchResult fetched;
+    DownloadResult result = fetchToTemp(url, target, timeoutSeconds, fetched, nullptr, monitor);
+    if (result.status != DownloadStatus::Success) return result;
     
+    // 下載完整後才取代目標檔案，中斷時不會留下不完整的檔案
+    if (!MoveFileExA(target.tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        result.status = DownloadStatus::FileError;
+        result.message = L"無法替換原文件";
+        HttpTransfer::discardPartial(target);
+        return result;
+    }
+    HttpTransfer::markComplete(target, url, fetched.validators);
     return result;
 }
 
 
-// 安全更新字典
-DownloadResult updateDictionarySafely(const char* downloadUrl, const char* localFile) {
-    DownloadResult result;
+// 取得校驗清單中 url 所指檔案的 SHA-256
+// 伺服器沒有發佈校驗清單（404）或清單中沒有這個檔案時 sha256 為空，只檢查格式
+static bool fetchManifest(const std::string& url, const std::string& dictFile, std::string& sha256,
+                          DownloadResult& failure, HttpTransfer::Monitor* monitor) {
+    sha256.clear();
+    std::string manifestUrl = url + MANIFEST_SUFFIX;
+    std::string manifestFile = dictFile + MANIFEST_SUFFIX;
+    DownloadResult result = downloadFromGitHub(manifestUrl.c_str(), manifestFile.c_str(), 30, monitor);
+    if (result.status == DownloadStatus::HttpError && result.httpCode == 404) return true;
+    if (result.status != DownloadStatus::Success && result.status != DownloadStatus::NotModified) {
+        failure = result;
+        failure.message = L"無法取得校驗清單：" + result.message;
+        return false;
+    }
     
+    std::string content;
+    if (DictFiles::readFile(manifestFile, content)) {
+        std::string fileName = url.substr(url.rfind('/') + 1);
+        DictVerifier::parseManifest(content, fileName, sha256);
+    }
+    return true;
+}
+
+// 安全更新字典
+DownloadResult updateDictionarySafely(const char* downloadUrl, const char* localFile, DictFiles::CodeTable* compiled,
+                                      HttpTransfer::Monitor* monitor) {
+    std::string url = downloadUrl ? downloadUrl : GITHUB_RAW_URL;
     std::string dictFile = localFile ? localFile : LOCAL_DICT_FILE;
     std::string tempFile = TEMP_DICT_FILE;
+    HttpTransfer::Target target = targetFor(dictFile, tempFile);
     
-    // 下载到临时文件
-    result = downloadFromGitHub(downloadUrl, tempFile.c_str());
+    // 下载到临时文件（本機檔案未變更時只詢問一次；上次中斷時從中斷處繼續）
+    // 收到的內容同時計算雜湊並解析，驗證不必再讀一次檔案
+    DictVerifier::StreamVerifier verifier;
+    HttpTransfer::FetchResult fetched;
+    DownloadResult result = fetchToTemp(url, target, 30, fetched, &verifier, monitor);
     
     if (result.status != DownloadStatus::Success) {
         return result;
     }
     
+    std::string expectedSha256;
+    if (!fetchManifest(url, dictFile, expectedSha256, result, monitor)) {
+        return result;
+    }
+    
     // 验证下载的文件
-    if (!validateDictFile(tempFile.c_str())) {
+    DictVerifier::Report report = verifier.finish(expectedSha256);
+    if (!report.ok) {
         result.status = DownloadStatus::FileError;
-        result.message = L"下載的文件格式無效";
-        DeleteFileA(tempFile.c_str());
+        result.message = L"下載的文件驗證失敗：" + report.error;
+        HttpTransfer::discardPartial(target);
         return result;
     }
     
@@ -239,45 +300,101 @@ DownloadResult updateDictionarySafely(const char* downloadUrl, const char* local
         result.status = DownloadStatus::FileError;
         result.message = L"無法替換原文件";
         CopyFileA(backupFile.c_str(), dictFile.c_str(), FALSE);
-        DeleteFileA(tempFile.c_str());
+        HttpTransfer::discardPartial(target);
         return result;
     }
     
     // 删除备份文件
     DeleteFileA(backupFile.c_str());
     
-    // 注意：不再保存 SHA（避免使用 GitHub API，防止访问次数限制）
+    // 記錄版本（ETag / Last-Modified），下次以條件式請求檢查
+    HttpTransfer::markComplete(target, url, fetched.validators);
     
-    result.message = L"字典更新成功";
+    result.entryCount = report.entryCount;
+    if (compiled) compiled->swap(verifier.table());
+    result.message = report.hashChecked ? L"字典更新成功（SHA-256 已驗證）" : L"字典更新成功";
     return result;
 }
 
-// 验证字典文件格式
-bool validateDictFile(const char* filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        return false;
+// 以差異檔更新字典
+DownloadResult updateDictionaryByDelta(DictDelta::Step& applied, const char* deltaUrl, const char* localFile,
+                                       HttpTransfer::Monitor* monitor, DictImage::Source* patchedSource) {
+    std::string dictFile = localFile ? localFile : LOCAL_DICT_FILE;
+    applied = DictDelta::Step();
+    
+    std::string content;
+    if (!DictFiles::readFile(dictFile, content)) {
+        DownloadResult result;
+        result.status = DownloadStatus::DeltaUnavailable;
+        result.message = L"無法讀取本機字碼表";
+        return result;
     }
     
-    std::string line;
-    int validLines = 0;
-    int maxCheckLines = 100;  // 检查前100行
+    // 差異檔同樣記住版本：伺服器沒有新的差異時只花一次往返
+    DownloadResult result = downloadFromGitHub(deltaUrl ? deltaUrl : GITHUB_DELTA_URL, DELTA_FILE, 30, monitor);
+    if (result.status != DownloadStatus::Success && result.status != DownloadStatus::NotModified) {
+        return result;
+    }
     
-    while (std::getline(file, line) && validLines < maxCheckLines) {
-        // 跳过空行和注释
-        if (line.empty() || line[0] == '#') continue;
-        
-        // 检查是否包含制表符分隔符
-        size_t tabPos = line.find('\t');
-        if (tabPos != std::string::npos && tabPos > 0 && tabPos < line.length() - 1) {
-            validLines++;
-        }
+    std::string deltaText;
+    std::string patched;
+    DictDelta::Step patch;
+    DictDelta::Update update = DictFiles::readFile(DELTA_FILE, deltaText) ?
+                               DictDelta::update(content, deltaText, patched, patch) : DictDelta::UPDATE_BAD_DELTA;
+    switch (update) {
+        case DictDelta::UPDATE_UP_TO_DATE:
+            result.status = DownloadStatus::NotModified;
+            result.message = L"字碼表已是最新版本";
+            return result;
+        case DictDelta::UPDATE_BAD_DELTA:
+            result.status = DownloadStatus::DeltaUnavailable;
+            result.message = L"差異檔格式無效";
+            return result;
+        case DictDelta::UPDATE_TOO_FAR:
+            result.status = DownloadStatus::DeltaUnavailable;
+            result.message = L"本機字碼表版本太舊，需要下載完整字碼表";
+            return result;
+        case DictDelta::UPDATE_MISMATCH:
+            // 本機檔案被修改過，與差異檔的基準版本不同
+            result.status = DownloadStatus::DeltaUnavailable;
+            result.message = L"套用差異後的字數不符";
+            return result;
+        case DictDelta::UPDATE_APPLIED:
+            break;
+    }
+    
+    // 先寫到暫存檔再取代，中途失敗不會留下改到一半的字碼表
+    std::string patchFile = dictFile + ".patch";
+    std::ofstream outFile(patchFile.c_str(), std::ios::binary);
+    if (!outFile.is_open() || !outFile.write(patched.data(), patched.size())) {
+        result.status = DownloadStatus::FileError;
+        result.message = L"無法寫入臨時文件";
+        outFile.close();
+        DeleteFileA(patchFile.c_str());
+        return result;
     }
+    outFile.close();
     
-    file.close();
+    if (!MoveFileExA(patchFile.c_str(), dictFile.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        result.status = DownloadStatus::FileError;
+        result.message = L"無法替換原文件";
+        DeleteFileA(patchFile.c_str());
+        return result;
+    }
     
-    // 如果至少有一行有效数据，认为文件有效
-    return validLines > 0;
+    result.status = DownloadStatus::Patched;
+    result.fileSize = patched.size();
+    result.message = L"已更新到第 " + std::to_wstring(patch.to) + L" 版（" +
+                     std::to_wstring(patch.changes.size()) + L" 個字碼有變更）";
+    applied = patch;
+    if (patchedSource) *patchedSource = DictImage::identify(patched);
+    return result;
+}
+
+// 验证字典文件格式
+bool validateDictFile(const char* filePath) {
+    // 解析每一行（不只是开头几行），错误页面或截断后大多是乱码的文件都无法通过
+    return DictVerifier::verifyFile(filePath, std::string()).ok;
 }
 
 // 获取状态消息
@@ -289,6 +406,15 @@ std::wstring getStatusMessage(const DownloadResult& result) {
             ss << L"下載成功：";
             ss << result.fileSize << L" 字節";
             break;
+        case DownloadStatus::NotModified:
+            ss << L"字碼表已是最新版本";
+            break;
+        case DownloadStatus::Patched:
+            ss << L"差異更新：" << result.message;
+            break;
+        case DownloadStatus::DeltaUnavailable:
+            ss << L"無法差異更新：" << result.message;
+            break;
         case DownloadStatus::NetworkError:
             ss << L"網路錯誤：" << result.message;
             break;
@@ -484,5 +610,236 @@ cleanup:
     return version;
 }
 
+// ========== 背景更新 ==========
+
+// 更新執行緒在第一次加入工作時建立；進度與完成以訊息通知主視窗
+static UpdateService::Service* g_updateService = nullptr;
+static bool g_updateServiceShutdown = false;
+static std::atomic<HWND> g_updateNotifyWnd(nullptr);
+
+// 只保留最新的進度：介面執行緒來不及處理時不會累積訊息
+static std::mutex g_progressMutex;
+static std::wstring g_progressText;
+static bool g_progressPending = false;
+
+static const wchar_t* jobName(UpdateService::JobKind kind) {
+    switch (kind) {
+        case UpdateService::JOB_MAIN_DICT: return L"字碼表";
+        case UpdateService::JOB_WORD_PHRASES: return L"詞語庫";
+        case UpdateService::JOB_VERSION: return L"版本資訊";
+        default: return L"資料";
+    }
+}
+
+static std::wstring describeProgress(const UpdateService::Progress& progress) {
+    std::wstring text = L"背景更新" + std::wstring(jobName(progress.kind)) + L"：";
+    if (progress.retryDelayMs > 0) {
+        text += progress.message + L"，" + std::to_wstring((progress.retryDelayMs + 999) / 1000) +
+                L" 秒後重試（第 " + std::to_wstring(progress.attempt + 1) + L" 次）";
+    } else if (progress.total > 0) {
+        text += L"已下載 " + std::to_wstring(progress.done / 1024) + L" / " +
+                std::to_wstring(progress.total / 1024) + L" KB（" +
+                std::to_wstring(progress.done * 100 / (uint64_t)progress.total) + L"%）";
+    } else if (progress.done > 0) {
+        text += L"已下載 " + std::to_wstring(progress.done / 1024) + L" KB";
+    } else {
+        text += progress.message;
+    }
+    return text;
+}
+
+static void onUpdateProgress(const UpdateService::Progress& progress) {
+    // 版本檢查不顯示進度，啟動時的自動檢查不打擾使用者
+    if (progress.kind == UpdateService::JOB_VERSION) return;
+    std::wstring text = describeProgress(progress);
+    bool post;
+    {
+        std::lock_guard<std::mutex> lock(g_progressMutex);
+        g_progressText.swap(text);
+        post = !g_progressPending;
+        g_progressPending = true;
+    }
+    HWND hWnd = g_updateNotifyWnd;
+    if (post && hWnd) PostMessage(hWnd, WM_USER+106, 0, 0);
+}
+
+static UpdateService::Service* updateService() {
+    if (!g_updateService && !g_updateServiceShutdown) {
+        g_updateService = new UpdateService::Service(onUpdateProgress, [] {
+            HWND hWnd = g_updateNotifyWnd;
+            if (hWnd) PostMessage(hWnd, WM_USER+107, 0, 0);
+        });
+    }
+    return g_updateService;
+}
+
+// 把工作的傳輸進度接到下載流程，並讓取消在下一段資料時生效
+class JobMonitor : public HttpTransfer::Monitor {
+public:
+    explicit JobMonitor(UpdateService::Context& context) : context_(context) {}
+    
+    bool progress(uint64_t done, long long total) override {
+        context_.progress(done, total);
+        return !context_.cancelled();
+    }
+    
+private:
+    UpdateService::Context& context_;
+};
+
+// 暫時性的錯誤才重試：網路中斷、逾時、伺服器忙碌；其餘（例如 404、驗證失敗）重試也不會成功
+static UpdateService::Attempt attemptFor(const DownloadResult& result) {
+    switch (result.status) {
+        case DownloadStatus::Success:
+        case DownloadStatus::NotModified:
+        case DownloadStatus::Patched:
+            return UpdateService::ATTEMPT_DONE;
+        case DownloadStatus::NetworkError:
+        case DownloadStatus::Timeout:
+            return UpdateService::ATTEMPT_RETRY;
+        case DownloadStatus::HttpError:
+            return result.httpCode >= 500 || result.httpCode == 429 || result.httpCode == 408 ?
+                   UpdateService::ATTEMPT_RETRY : UpdateService::ATTEMPT_FAILED;
+        default:
+            return UpdateService::ATTEMPT_FAILED;
+    }
+}
+
+static void recordResult(UpdateService::Result& out, const DownloadResult& result) {
+    out.detail = (int)result.status;
+    out.httpCode = result.httpCode;
+    out.size = result.fileSize;
+    out.entryCount = result.entryCount;
+    out.message = result.message;
+}
+
+void setUpdateNotifyWindow(HWND hWnd) {
+    g_updateNotifyWnd = hWnd;
+    if (!hWnd) return;
+    // 視窗建立前就完成的進度與結果：補送通知
+    bool progress;
+    {
+        std::lock_guard<std::mutex> lock(g_progressMutex);
+        progress = g_progressPending;
+    }
+    if (progress) PostMessage(hWnd, WM_USER+106, 0, 0);
+    if (g_updateService) PostMessage(hWnd, WM_USER+107, 0, 0);
+}
+
+int queueMainDictUpdate(const char* localFile, bool deltaFirst, const DictModel::Model* current) {
+    UpdateService::Service* service = updateService();
+    if (!service) return 0;
+    std::string file = localFile ? localFile : LOCAL_DICT_FILE;
+    return service->submit(UpdateService::JOB_MAIN_DICT,
+                           [file, deltaFirst, current](UpdateService::Context& context) -> UpdateService::Attempt {
+        JobMonitor monitor(context);
+        UpdateService::Result& out = context.result();
+        DownloadResult result;
+        if (deltaFirst) {
+            // 先嘗試差異更新；差異檔不可用或版本相差太多時下載完整字碼表
+            context.stage(L"正在檢查字碼表差異...");
+            DictImage::Source patchedSource;
+            result = updateDictionaryByDelta(out.patch, nullptr, file.c_str(), &monitor, &patchedSource);
+            if (result.status == DownloadStatus::Patched && current) {
+                // 把變更套用在目前的字典上建立新快照並寫出映像檔，介面執行緒只需發佈（不重新解析檔案）
+                // 套用後的筆數與差異檔不符時，記憶體中的字典與檔案的基準版本不同：
+                // 不建立快照，由介面執行緒重新載入更新後的檔案
+                out.base = current->pin();
+                DictFiles::CodeTable table;
+                out.base->table().copyTo(table);
+                int count = DictDelta::countAfter(table, out.base->entryCount(), out.patch);
+                if (count == out.patch.entryCount) {
+                    DictDelta::applyToTable(table, out.patch);
+                    out.snapshot = DictModel::share(file, patchedSource, table, count);
+                }
+            }
+            if (result.status == DownloadStatus::Patched || result.status == DownloadStatus::NotModified ||
+                result.status == DownloadStatus::Cancelled) {
+                recordResult(out, result);
+                return attemptFor(result);
+            }
+        }
+        context.stage(L"正在下載字碼表...");
+        result = updateDictionarySafely(nullptr, file.c_str(), &out.table, &monitor);
+        recordResult(out, result);
+        if (result.status == DownloadStatus::Success) {
+            // 同時寫出映像檔，其他輸入法程序載入新字碼表時直接對映
+            std::string content;
+            out.snapshot = DictFiles::readFile(file, content) ?
+                           DictModel::share(file, content, out.table, result.entryCount) :
+                           DictModel::build(out.table, result.entryCount);
+        }
+        return attemptFor(result);
+    });
+}
+
+int queueWordPhrasesDownload(const char* localFile) {
+    UpdateService::Service* service = updateService();
+    if (!service) return 0;
+    std::string file = localFile;
+    return service->submit(UpdateService::JOB_WORD_PHRASES,
+                           [file](UpdateService::Context& context) -> UpdateService::Attempt {
+        JobMonitor monitor(context);
+        UpdateService::Result& out = context.result();
+        context.stage(L"正在下載詞語庫...");
+        DownloadResult result = downloadFromGitHub(GITHUB_WORD_PHRASES_URL, file.c_str(), 30, &monitor);
+        recordResult(out, result);
+        if (result.status != DownloadStatus::Success) return attemptFor(result);
+        
+        // 在更新執行緒解析，介面執行緒只需換上
+        std::string content;
+        if (!DictFiles::readFile(file, content)) {
+            out.message = L"無法讀取詞語庫";
+            return UpdateService::ATTEMPT_FAILED;
+        }
+        out.phrases = DictModel::loadSharedPhrases(file, content);
+        out.entryCount = out.phrases.entryCount();
+        return UpdateService::ATTEMPT_DONE;
+    });
+}
+
+int queueVersionCheck(bool forceCheck) {
+    UpdateService::Service* service = updateService();
+    if (!service) return 0;
+    UpdateService::RetryPolicy policy;
+    policy.maxAttempts = 3;
+    return service->submit(UpdateService::JOB_VERSION,
+                           [forceCheck](UpdateService::Context& context) -> UpdateService::Attempt {
+        UpdateService::Result& out = context.result();
+        out.version = getRemoteVersion(nullptr, forceCheck);
+        if (!out.version.empty()) return UpdateService::ATTEMPT_DONE;
+        out.message = L"無法取得遠端版本";
+        return UpdateService::ATTEMPT_RETRY;
+    }, policy);
+}
+
+bool isUpdatePending(UpdateService::JobKind kind) {
+    return g_updateService && g_updateService->pendingJob(kind) != 0;
+}
+
+void cancelUpdate(UpdateService::JobKind kind) {
+    if (g_updateService) g_updateService->cancel(g_updateService->pendingJob(kind));
+}
+
+bool takeUpdateProgress(std::wstring& status) {
+    std::lock_guard<std::mutex> lock(g_progressMutex);
+    if (!g_progressPending) return false;
+    status.swap(g_progressText);
+    g_progressPending = false;
+    return true;
+}
+
+bool takeUpdateResult(UpdateService::Result& result) {
+    return g_updateService && g_updateService->take(result);
+}
+
+void shutdownUpdateService() {
+    g_updateNotifyWnd = nullptr;
+    g_updateServiceShutdown = true;
+    // 取消執行中的工作並等待結束（下載在下一段資料時停止，已下載的部分下次續傳）
+    delete g_updateService;
+    g_updateService = nullptr;
+}
+
 } // namespace DictUpdater
 
@@ -3,6 +3,11 @@
 #define DICT_UPDATER_H
 
 #include "ime_core.h"
+#include "dict_delta.h"
+#include "dict_files.h"
+#include "dict_image.h"
+#include "http_transfer.h"
+#include "update_service.h"
 #include <string>
 
 namespace DictUpdater {
@@ -13,7 +18,10 @@ namespace DictUpdater {
         FileError,         // 文件错误
         HttpError,         // HTTP错误
         Cancelled,         // 已取消
-        Timeout            // 超时
+        Timeout,           // 超时
+        NotModified,       // 伺服器回 304：本機檔案已是最新（沒有下載內容）
+        Patched,           // 已以差異檔更新字碼表檔案
+        DeltaUnavailable   // 無法以差異檔更新（版本相差太多、差異檔無效或本機檔案不符），需下載完整字碼表
     };
     
     // 下载结果结构
@@ -22,13 +30,18 @@ namespace DictUpdater {
         std::wstring message;
         int httpCode;
         size_t fileSize;
+        int entryCount;    // 下載時驗證並解析的字數
         
-        DownloadResult() : status(DownloadStatus::NetworkError), httpCode(0), fileSize(0) {}
+        DownloadResult() : status(DownloadStatus::NetworkError), httpCode(0), fileSize(0), entryCount(0) {}
     };
     
     // GitHub URLs 常量
     const char* const GITHUB_RAW_URL = 
         "https://raw.githubusercontent.com/Yamazaki427858/ChineseStrokeIME/ChineseStrokeIME/SourceCode/%E5%AD%97%E7%A2%BC/Zi-Ma-Biao.txt";
+    const char* const GITHUB_DELTA_URL = 
+        "https://raw.githubusercontent.com/Yamazaki427858/ChineseStrokeIME/ChineseStrokeIME/SourceCode/%E5%AD%97%E7%A2%BC/Zi-Ma-Biao.delta.txt";
+    const char* const GITHUB_WORD_PHRASES_URL = 
+        "https://raw.githubusercontent.com/Yamazaki427858/ChineseStrokeIME/ChineseStrokeIME/SourceCode/%E8%81%AF%E6%83%B3%E8%A9%9E%E5%BA%AB/word_phrases.txt";
     const char* const GITHUB_UPDATE_MD_URL = 
         "https://raw.githubusercontent.com/Yamazaki427858/ChineseStrokeIME/refs/heads/ChineseStrokeIME/Update.md";
     const char* const GITHUB_REPO_URL = 
@@ -37,24 +50,47 @@ namespace DictUpdater {
     // 本地文件名
     const char* const LOCAL_DICT_FILE = "Zi-Ma-Biao.txt";
     const char* const TEMP_DICT_FILE = "Zi-Ma-Biao.txt.tmp";
+    const char* const DELTA_FILE = "Zi-Ma-Biao.delta.txt";
+    const char* const MANIFEST_SUFFIX = ".sha256";  // 校驗清單：與字碼表同目錄的 <檔名>.sha256（sha256sum 格式）
     const char* const VERSION_CACHE_FILE = "version_cache.txt";  // 版本检查缓存文件
     
     // 从GitHub下载字码表
+    // 先寫到 savePath.tmp，完整後才取代 savePath；版本與續傳資訊存在 savePath.meta
+    // 中斷時保留已下載的部分，下次以 HTTP Range 繼續；伺服器支援時以 gzip 傳輸並邊收邊解壓縮
     // downloadUrl: 下载URL（如果为空则使用默认GitHub URL）
     // savePath: 保存路径（如果为空则使用默认文件名）
     // timeoutSeconds: 超时时间（秒），默认30秒
+    // monitor: 不為空時回報傳輸進度，並可中途取消（回傳 Cancelled，已下載的部分下次續傳）
     DownloadResult downloadFromGitHub(const char* downloadUrl = nullptr, 
                                       const char* savePath = nullptr,
-                                      int timeoutSeconds = 30);
+                                      int timeoutSeconds = 30,
+                                      HttpTransfer::Monitor* monitor = nullptr);
     
     
     // 安全更新字典：下载到临时文件，验证后替换原文件
+    // 記住 ETag / Last-Modified，本機檔案未變更時只送條件式請求，回傳 NotModified
+    // 下載時同時計算 SHA-256 並解析每一行：有校驗清單時比對雜湊，沒有時檢查格式
     // downloadUrl: 下载URL（如果为空则使用默认GitHub URL）
     // localFile: 本地文件路径（如果为空则使用默认文件名）
+    // compiled: 不為空時取得驗證時解析好的字典（可直接換上，不必再讀一次檔案）
     DownloadResult updateDictionarySafely(const char* downloadUrl = nullptr,
-                                         const char* localFile = nullptr);
+                                         const char* localFile = nullptr,
+                                         DictFiles::CodeTable* compiled = nullptr,
+                                         HttpTransfer::Monitor* monitor = nullptr);
     
-    // 验证下载的文件是否有效（检查格式和内容）
+    // 以差異檔更新字典：只改寫檔案中有變更的字碼，不下載整個字碼表
+    // 成功時回傳 Patched，applied 為套用的變更（呼叫端以它就地更新記憶體中的字典）；
+    // 已是最新版本時回傳 NotModified；其他狀態表示應改為下載完整字碼表
+    // deltaUrl: 差異檔URL（如果为空则使用默认GitHub URL）
+    // localFile: 本地文件路径（如果为空则使用默认文件名）
+    // patchedSource: 成功時設為更新後檔案內容的識別（寫出映像檔用，不必再讀一次檔案）
+    DownloadResult updateDictionaryByDelta(DictDelta::Step& applied,
+                                           const char* deltaUrl = nullptr,
+                                           const char* localFile = nullptr,
+                                           HttpTransfer::Monitor* monitor = nullptr,
+                                           DictImage::Source* patchedSource = nullptr);
+    
+    // 验证下载的文件是否有效（完整解析每一行，检查格式和内容）
     bool validateDictFile(const char* filePath);
     
     // 获取错误消息字符串
@@ -73,6 +109,33 @@ namespace DictUpdater {
     // 加载版本检查缓存（内部使用）
     // 返回缓存的版本号，如果缓存过期或不存在返回空字符串
     std::string loadVersionCache(time_t& checkTime, int cacheHours = 24);
+    
+    // ========== 背景更新 ==========
+    // 下載與版本檢查在更新執行緒依序進行，不阻塞啟動與訊息迴圈
+    // 網路中斷、逾時與伺服器忙碌（5xx、429）依指數退避重試；下載中斷後的重試從中斷處續傳
+    // 進度以 WM_USER+106、完成以 WM_USER+107 通知主視窗（尚未設定視窗時結果先保留）
+    void setUpdateNotifyWindow(HWND hWnd);
+    
+    // 加入工作並回傳編號；同種類的工作尚未完成時回傳既有的編號
+    // 字碼表：deltaFirst 時先嘗試差異更新；結果的 detail 為 DownloadStatus，
+    //         成功時 snapshot 帶回建好的新字典（差異更新依 current 的快照套用，base 為套用時的快照；
+    //         套用後字數不符時 snapshot 為空，需重新載入檔案）
+    int queueMainDictUpdate(const char* localFile, bool deltaFirst, const DictModel::Model* current = nullptr);
+    // 詞語庫：下載後在更新執行緒解析，table 帶回聯想表
+    int queueWordPhrasesDownload(const char* localFile);
+    // 版本檢查：version 帶回遠端版本號
+    int queueVersionCheck(bool forceCheck);
+    
+    bool isUpdatePending(UpdateService::JobKind kind);
+    void cancelUpdate(UpdateService::JobKind kind);
+    
+    // 取走最新的進度說明（多次進度只保留最後一次）；沒有新的進度時回傳 false
+    bool takeUpdateProgress(std::wstring& status);
+    // 取走一個完成的結果；沒有時回傳 false
+    bool takeUpdateResult(UpdateService::Result& result);
+    
+    // 取消所有工作並結束更新執行緒（程式結束前呼叫）
+    void shutdownUpdateService();
 }
 
 #endif // DICT_UPDATER_H
@@ -0,0 +1,100 @@
+// dict_verifier.cpp - 字碼表完整性驗證實作
+#include "dict_verifier.h"
+#include <cctype>
+#include <cstdio>
+#include <vector>
+
+namespace DictVerifier {
+
+bool parseManifest(const std::string& content, const std::string& fileName, std::string& sha256) {
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) end = content.size();
+        std::string line = content.substr(pos, end - pos);
+        pos = end + 1;
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+
+        size_t space = line.find(' ');
+        if (space != Sha256::DIGEST_SIZE * 2) continue;
+        size_t name = line.find_first_not_of(' ', space);
+        if (name == std::string::npos) continue;
+        if (line[name] == '*') name++;
+        if (line.compare(name, std::string::npos, fileName) != 0) continue;
+
+        std::string hex = line.substr(0, space);
+        for (size_t i = 0; i < hex.size(); i++) {
+            if (!isxdigit((unsigned char)hex[i])) return false;
+            hex[i] = (char)tolower((unsigned char)hex[i]);
+        }
+        sha256 = hex;
+        return true;
+    }
+    return false;
+}
+
+StreamVerifier::StreamVerifier() : parser_(table_), size_(0) {}
+
+void StreamVerifier::restart() {
+    hasher_.reset();
+    parser_.reset();
+    size_ = 0;
+}
+
+void StreamVerifier::append(const char* data, size_t size) {
+    hasher_.update(data, size);
+    parser_.feed(data, size);
+    size_ += size;
+}
+
+Report StreamVerifier::finish(const std::string& expectedSha256) {
+    parser_.finish();
+    Report report;
+    report.sha256 = hasher_.finishHex();
+    report.size = size_;
+    report.entryCount = parser_.entryCount();
+    report.malformedLines = parser_.malformedLines();
+
+    if (report.entryCount == 0) {
+        report.error = L"檔案中沒有任何字碼（可能是錯誤頁面或空白檔案）";
+        return report;
+    }
+    if (!expectedSha256.empty()) {
+        // 與發佈的雜湊相同就是發佈的檔案，不再以格式判斷
+        report.hashChecked = true;
+        report.ok = report.sha256 == expectedSha256;
+        if (!report.ok) report.error = L"SHA-256 與校驗清單不符（檔案不完整或已損壞）";
+        return report;
+    }
+    if ((int64_t)report.malformedLines * 100 > (int64_t)report.entryCount + report.malformedLines) {
+        report.error = L"格式錯誤的行太多：" + std::to_wstring(report.malformedLines) + L" 行";
+        return report;
+    }
+    report.ok = true;
+    return report;
+}
+
+Report verifyFile(const std::string& path, const std::string& expectedSha256, DictFiles::CodeTable* table) {
+    StreamVerifier verifier;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        Report report;
+        report.error = L"無法開啟檔案";
+        return report;
+    }
+    std::vector<char> buffer(HttpTransfer::BLOCK_SIZE);
+    size_t got;
+    while ((got = fread(buffer.data(), 1, buffer.size(), file)) > 0) verifier.append(buffer.data(), got);
+    bool readFailed = ferror(file) != 0;
+    fclose(file);
+
+    Report report = verifier.finish(expectedSha256);
+    if (readFailed) {
+        report.ok = false;
+        report.error = L"讀取檔案失敗";
+    }
+    if (report.ok && table) table->swap(verifier.table());
+    return report;
+}
+
+}
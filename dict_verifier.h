@@ -0,0 +1,60 @@
+// dict_verifier.h - 下載字碼表的完整性驗證（可攜式，不依賴 Windows API）
+#ifndef DICT_VERIFIER_H
+#define DICT_VERIFIER_H
+
+#include "dict_files.h"
+#include "http_transfer.h"
+#include "sha256.h"
+#include <cstdint>
+#include <string>
+
+// 下載時逐區塊計算 SHA-256 並完整解析每一行，驗證不必再讀一次檔案，
+// 解析的結果就是驗證通過後要換上的字典
+//
+// 有發佈校驗清單（sha256sum 格式）時以雜湊為準；沒有時檢查格式：
+// 必須有記錄，且格式錯誤的行不超過 1%（錯誤頁面、二進位檔案都過不了）
+namespace DictVerifier {
+    // 「<64 位十六進位>  檔名」（檔名前可有 * 表示二進位模式）；
+    // 找到 fileName 時回傳 true，sha256 為小寫十六進位
+    bool parseManifest(const std::string& content, const std::string& fileName, std::string& sha256);
+
+    struct Report {
+        bool ok;
+        std::wstring error;
+        std::string sha256;     // 實際內容的雜湊
+        bool hashChecked;       // 有與校驗清單比對
+        uint64_t size;
+        int entryCount;
+        int malformedLines;
+        Report() : ok(false), hashChecked(false), size(0), entryCount(0), malformedLines(0) {}
+    };
+
+    class StreamVerifier : public HttpTransfer::BodySink {
+    public:
+        StreamVerifier();
+
+        void restart() override;
+        void append(const char* data, size_t size) override;
+
+        // 輸入結束；expectedSha256 為空表示沒有校驗清單，只檢查格式
+        Report finish(const std::string& expectedSha256);
+
+        // 解析的結果（finish 之後，驗證通過時可直接換上）
+        DictFiles::CodeTable& table() { return table_; }
+
+    private:
+        StreamVerifier(const StreamVerifier&);
+        StreamVerifier& operator=(const StreamVerifier&);
+
+        Sha256::Hasher hasher_;
+        DictFiles::CodeTable table_;
+        DictFiles::MainDictParser parser_;
+        uint64_t size_;
+    };
+
+    // 驗證已在磁碟上的檔案（讀一次）；table 不為空時取得解析結果
+    Report verifyFile(const std::string& path, const std::string& expectedSha256,
+                      DictFiles::CodeTable* table = nullptr);
+}
+
+#endif // DICT_VERIFIER_H
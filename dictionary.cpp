@@ -1,41 +1,80 @@
 // dictionary.cpp - 字典管理實作（修正字碼表持續顯示和3+3提示）
 #include "dictionary.h"
+#include "dict_files.h"
+#include "dict_delta.h"
 #include "dict_updater.h"
 #include "buffer_manager.h"
 #include "input_handler.h"
 #include "window_manager.h"
 #include "ime_manager.h"
+#include "latency_stats.h"
+#include "trace_recorder.h"
+#include "resource_refresh.h"
+#include "query_client.h"
 #include <fstream>
-#include <sstream>
 #include <algorithm>
 #include <ctime>
 
 namespace Dictionary {
 
-// 新增：增強型輸入驗證（參考OptimizedChineseStrokeIME.cpp）
-bool enhancedValidateInput(const std::wstring& input) {
-    if (input.empty()) return true;
-    if (input.length() > 30) return false;  // 防止過長輸入
-    
-    int validCharCount = 0;
-    for (wchar_t ch : input) {
-        if (ch == L'u' || ch == L'i' || ch == L'o' || ch == L'j' || ch == L'k' || ch == L'*') {
-            validCharCount++;
-        }
+// 字典檔案的變更偵測：載入與寫出時記錄檔案狀態，重新載入時只在背景重建有變更的檔案
+// 完成後以 WM_USER+105 通知主視窗換上
+static ResourceRefresh::Refresher* g_refresher = nullptr;
+static bool g_refresherShutdown = false;
+static HWND g_refreshNotifyWnd = nullptr;
+
+static ResourceRefresh::Refresher* resourceRefresher() {
+    if (!g_refresher && !g_refresherShutdown) {
+        ResourceRefresh::Paths paths;
+        paths.mainDict = "Zi-Ma-Biao.txt";
+        paths.punctMenu = "punct_menu.txt";
+        paths.userDict = "user_dict.txt";
+        paths.wordPhrases = "word_phrases.txt";
+        g_refresher = new ResourceRefresh::Refresher(paths, [] {
+            HWND hWnd = g_refreshNotifyWnd;
+            if (hWnd) PostMessage(hWnd, WM_USER+105, 0, 0);
+        });
     }
-    
-    return validCharCount > 0;
+    return g_refresher;
+}
+
+static void trackResource(unsigned resources) {
+    ResourceRefresh::Refresher* refresher = resourceRefresher();
+    if (refresher) refresher->track(resources);
+}
+
+// 換下來的字碼表快照交給背景執行緒放開（沒有讀者持有時在那裡釋放整個字典）
+static void retireSnapshot(DictModel::SnapshotPtr& old) {
+    ResourceRefresh::Refresher* refresher = resourceRefresher();
+    if (!refresher || !old) return;
+    ResourceRefresh::Result retired;
+    retired.mainDict.swap(old);
+    refresher->retire(retired);
+}
+
+// 共用字典服務：連線時查詢與聯想由服務完成，本機不載入字碼表與詞語庫；
+// 學習仍在本機進行（保存用戶字典），同時送給服務，讓服務的排序與本機相同
+static QueryClient::Client g_queryClient;
+
+// 服務中斷（查詢失敗時已斷線）而本機還沒有字典時，改為載入本機字典
+static void ensureLocalDicts(GlobalState& state) {
+    if (state.dict.pin()->codeCount() > 0) return;
+    loadMainDict("Zi-Ma-Biao.txt", state);
+    loadWordPhrases(state);
+    Utils::updateStatus(state, L"共用字典服務已中斷，改用本機字典");
+}
+
+// 背景下載字碼表的狀態：缺檔時以內建字碼表啟動；手動更新時失敗要顯示對話框
+static bool g_mainDictPending = false;
+static bool g_reportUpdateErrors = false;
+
+// 輸入驗證與排序由引擎核心實作
+bool enhancedValidateInput(const std::wstring& input) {
+    return EngineCore::enhancedValidateInput(input);
 }
 
-// 新增：過濾有效字符（參考OptimizedChineseStrokeIME.cpp）
 std::wstring filterValidChars(const std::wstring& input) {
-    std::wstring filtered;
-    for (wchar_t ch : input) {
-        if (ch == L'u' || ch == L'i' || ch == L'o' || ch == L'j' || ch == L'k' || ch == L'*') {
-            filtered += ch;
-        }
-    }
-    return filtered;
+    return EngineCore::filterValidChars(input);
 }
 
 // 新增：獲取輸入顯示內容（包含3+3提示）
@@ -68,157 +107,79 @@ std::wstring getInputDisplay(const GlobalState& state) {
 }
 
 double calculateTimeWeight(time_t lastUsed) {
-    time_t now = time(nullptr);
-    double daysDiff = difftime(now, lastUsed) / (24 * 3600);
-    if (daysDiff <= 1) return 1.0;
-    if (daysDiff <= 7) return 0.8;
-    if (daysDiff <= 30) return 0.6;
-    if (daysDiff <= 90) return 0.4;
-    return 0.2;
+    return EngineCore::timeWeight(lastUsed, time(nullptr));
 }
 
 double getWordScore(const GlobalState& state, const std::wstring& word, const std::wstring& code) {
-    double score = (10.0 - code.length()) * 2.0;
-    if (state.wordFreq.find(word) != state.wordFreq.end()) {
-        const WordInfo& info = state.wordFreq.at(word);
-        double freqScore = info.frequency * 1.0;
-        double timeWeight = calculateTimeWeight(info.lastUsed);
-        double permanentBonus = info.isPermanent ? 5.0 : 0.0;
-        score += (freqScore * timeWeight) + permanentBonus;
-    }
-    if (!state.lastSelected.empty() && state.contextLearning.find(state.lastSelected) != state.contextLearning.end()) {
-        const auto& context = state.contextLearning.at(state.lastSelected);
-        if (std::find(context.begin(), context.end(), word) != context.end()) {
-            score += 3.0;
-        }
-    }
-    return score;
+    return EngineCore::wordScore(state, word, code, time(nullptr));
 }
 
 void learnWord(GlobalState& state, const std::wstring& word) {
-    if (Utils::isPunctuation(word)) return;
-    if (word.empty()) return;
-    
-    time_t now = time(nullptr);
-    if (state.wordFreq.find(word) == state.wordFreq.end()) {
-        state.wordFreq[word] = {1, now, 1, false};
-        Utils::updateStatus(state, L"學習新詞：" + word + L"（暫存）");
-    } else {
-        WordInfo& info = state.wordFreq[word];
-        info.frequency++;
-        info.lastUsed = now;
-        if (!info.isPermanent) {
-            info.tempCount++;
-            if (info.tempCount >= 3) {
-                info.isPermanent = true;
-                Utils::updateStatus(state, L"詞語加入永久詞庫：" + word);
-            } else {
-                Utils::updateStatus(state, L"詞語學習中：" + word + L"（" + std::to_wstring(info.tempCount) + L"/3）");
-            }
-        }
+    EngineCore::LearnOutcome outcome = EngineCore::learn(state, word, time(nullptr));
+    // 共用字典服務的學習與下一次查詢一起送出
+    if (outcome != EngineCore::LEARN_IGNORED) g_queryClient.learn(word);
+    switch (outcome) {
+        case EngineCore::LEARN_NEW:
+            Utils::updateStatus(state, L"學習新詞：" + word + L"（暫存）");
+            break;
+        case EngineCore::LEARN_PROGRESS:
+            Utils::updateStatus(state, L"詞語學習中：" + word + L"（" +
+                                std::to_wstring(state.wordFreq[word].tempCount) + L"/3）");
+            break;
+        case EngineCore::LEARN_PERMANENT:
+            Utils::updateStatus(state, L"詞語加入永久詞庫：" + word);
+            break;
+        default:
+            break;
     }
-    
-    if (!state.lastSelected.empty() && state.lastSelected != word) {
-        state.contextLearning[state.lastSelected].push_back(word);
-        if (state.contextLearning[state.lastSelected].size() > 10) {
-            state.contextLearning[state.lastSelected].erase(state.contextLearning[state.lastSelected].begin());
-        }
-    }
-    state.lastSelected = word;
+}
+
+// 內建的基本筆劃（字碼表缺失且尚未下載完成時使用）
+static void useBuiltinMainDict(GlobalState& state) {
+    DictFiles::CodeTable table;
+    table[L"u"] = {L"一"};
+    table[L"i"] = {L"丨"};
+    table[L"o"] = {L"丿"};
+    table[L"j"] = {L"丶"};
+    table[L"k"] = {L"乙"};
+    DictModel::SnapshotPtr old = state.dict.publish(DictModel::build(table, 5));
+    retireSnapshot(old);
 }
 
 void loadMainDict(const char* filename, GlobalState& state) {
-    state.dict.clear();
-    std::ifstream fin(filename);
-    if (!fin.is_open()) {
-        // 文件不存在，尝试从GitHub自动下载
-        Utils::updateStatus(state, L"字碼表檔案不存在，嘗試從GitHub下載...");
-        if (state.hWnd) {
-            InvalidateRect(state.hWnd, nullptr, TRUE);
-            UpdateWindow(state.hWnd);
-        }
-        
-        DictUpdater::DownloadResult result = DictUpdater::updateDictionarySafely();
-        
-        if (result.status == DictUpdater::DownloadStatus::Success) {
-            // 下载成功，重新尝试加载
-            fin.close();
-            fin.open(filename);
-            if (fin.is_open()) {
-                Utils::updateStatus(state, L"✓ 成功從GitHub下載字碼表，正在載入...");
-                if (state.hWnd) {
-                    InvalidateRect(state.hWnd, nullptr, TRUE);
-                    UpdateWindow(state.hWnd);
-                }
-                // 继续下面的加载逻辑
-            } else {
-                // 下载成功但无法打开文件（不应该发生）
-                std::wstring errorMsg = L"下載成功但無法打開檔案";
-                Utils::updateStatus(state, L"✗ " + errorMsg);
-                if (state.hWnd) {
-                    MessageBoxW(state.hWnd, 
-                        (L"警告：字碼表檔案異常\n\n" + errorMsg + 
-                         L"\n\n建議手動下載 Zi-Ma-Biao.txt 文件。").c_str(),
-                        L"字碼表載入失敗", MB_OK | MB_ICONWARNING);
-                    InvalidateRect(state.hWnd, nullptr, TRUE);
-                    UpdateWindow(state.hWnd);
-                }
-                state.dict[L"u"] = {L"一"};
-                state.dict[L"i"] = {L"丨"};
-                state.dict[L"o"] = {L"丿"};
-                state.dict[L"j"] = {L"丶"};
-                state.dict[L"k"] = {L"乙"};
-                state.dictSize = 5;
-                return;
-            }
+    trackResource(ResourceRefresh::RES_MAIN_DICT);
+    if (g_queryClient.connected()) {
+        // 字碼表由共用字典服務提供：請服務重新載入（所有連線的輸入法都換上新字典）
+        if (g_queryClient.reloadMainDict()) {
+            Utils::updateStatus(state, L"共用字典服務已重新載入字碼表");
+        } else if (g_queryClient.connected()) {
+            Utils::updateStatus(state, L"共用字典服務無法重新載入字碼表（沿用目前的字碼表）");
         } else {
-            // 下载失败
-            std::wstring errorMsg = DictUpdater::getStatusMessage(result);
-            std::wstring fullErrorMsg = L"✗ 無法下載字碼表：" + errorMsg;
-            Utils::updateStatus(state, fullErrorMsg);
-            
-            // 显示弹窗警告
-            if (state.hWnd) {
-                std::wstring msgBoxText = L"警告：字碼表檔案缺失且下載失敗\n\n";
-                msgBoxText += L"錯誤原因：" + errorMsg + L"\n\n";
-                msgBoxText += L"建議：\n";
-                msgBoxText += L"1. 檢查網路連接\n";
-                msgBoxText += L"2. 手動從GitHub下載 Zi-Ma-Biao.txt\n";
-                msgBoxText += L"3. 將文件放在程序目錄下\n\n";
-                msgBoxText += L"GitHub地址：\n";
-                msgBoxText += L"https://github.com/Yamazaki427858/ChineseStrokeIME";
-                
-                MessageBoxW(state.hWnd, msgBoxText.c_str(), 
-                    L"字碼表缺失警告", MB_OK | MB_ICONWARNING);
-                InvalidateRect(state.hWnd, nullptr, TRUE);
-                UpdateWindow(state.hWnd);
-            }
-            
-            state.dict[L"u"] = {L"一"};
-            state.dict[L"i"] = {L"丨"};
-            state.dict[L"o"] = {L"丿"};
-            state.dict[L"j"] = {L"丶"};
-            state.dict[L"k"] = {L"乙"};
-            state.dictSize = 5;
-            return;
+            ensureLocalDicts(state);
         }
+        return;
     }
-    
-    std::string line;
-    int count = 0;
-    while (std::getline(fin, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        size_t tab = line.find('\t');
-        if (tab == std::string::npos) continue;
-        std::wstring key = Utils::utf8ToWstr(line.substr(tab+1));
-        std::wstring val = Utils::utf8ToWstr(line.substr(0, tab));
-        if (!key.empty() && !val.empty()) {
-            state.dict[key].push_back(val);
-            count++;
-        }
+    std::string content;
+    if (!DictFiles::readFile(filename, content)) {
+        // 文件不存在：先以內建的基本筆劃啟動，字碼表在背景下載，完成後由 onUpdateFinished 換上
+        useBuiltinMainDict(state);
+        g_mainDictPending = true;
+        DictUpdater::queueMainDictUpdate(filename, false, &state.dict);
+        Utils::updateStatus(state, L"字碼表檔案不存在，正在背景從GitHub下載（暫用基本筆劃）...");
+        return;
     }
-    fin.close();
-    state.dictSize = count;
+    if (g_mainDictPending) {
+        // 缺檔時開始的背景下載已不需要（檔案已由其他方式補上），不覆蓋這個檔案
+        g_mainDictPending = false;
+        DictUpdater::cancelUpdate(UpdateService::JOB_MAIN_DICT);
+    }
+    
+    // 建好新的快照後才換上：查詢中的讀者繼續使用舊字典
+    // 其他輸入法程序已寫出相同內容的映像檔時直接對映，不必解析
+    DictModel::SnapshotPtr snapshot = DictModel::loadShared(filename, content);
+    int count = snapshot->entryCount();
+    DictModel::SnapshotPtr old = state.dict.publish(snapshot);
+    retireSnapshot(old);
     Utils::updateStatus(state, L"重新載入中文字典：" + std::to_wstring(count) + L" 個字");
 }
 
@@ -260,65 +221,8 @@ void loadPunctuator(GlobalState& state) {
 	
 }
 
-void loadPunctMenu(GlobalState& state) {
-    state.punctCandidates.clear();
-    
-    // 首先嘗試載入檔案
-    std::ifstream fin("punct_menu.txt", std::ios::in | std::ios::binary);
-    if (!fin.is_open()) {
-        Utils::updateStatus(state, L"無法開啟 punct_menu.txt，使用內建標點選單");
-    } else {
-        std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-        fin.close();
-        
-        // 處理 UTF-8 BOM
-        if (content.length() >= 3 && 
-            content[0] == static_cast<char>(0xEF) &&
-            content[1] == static_cast<char>(0xBB) &&
-            content[2] == static_cast<char>(0xBF)) {
-            content = content.substr(3);
-        }
-        
-        // 按行分割處理
-        std::stringstream ss(content);
-        std::string line;
-        int count = 0;
-        
-        while (std::getline(ss, line)) {
-            // 移除行尾的 \r（Windows 換行符）
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
-            }
-            
-            // 移除前後空格
-            line.erase(0, line.find_first_not_of(" \t"));
-            line.erase(line.find_last_not_of(" \t") + 1);
-            
-            // 跳過空行和註解行
-            if (line.empty() || line[0] == '#') continue;
-            
-            // 轉換為寬字符
-            try {
-                std::wstring punct = Utils::utf8ToWstr(line);
-                if (!punct.empty()) {
-                    state.punctCandidates.push_back(punct);
-                    count++;
-                }
-            } catch (...) {
-                // 轉換失敗，跳過這行
-                continue;
-            }
-        }
-        
-        if (count >= 5) {
-            Utils::updateStatus(state, L"載入標點符號選單：" + std::to_wstring(count) + L" 個符號");
-            return; // 成功載入檔案，直接返回
-        } else {
-            Utils::updateStatus(state, L"標點選單檔案內容過少，使用內建選單");
-        }
-    }
-    
-    // 如果檔案載入失敗或內容不足，使用內建選單
+// 內建標點選單（punct_menu.txt 不存在或內容過少時使用）
+static void useBuiltinPunctMenu(GlobalState& state) {
     state.punctCandidates = { 
         // 特殊符號
         L"※", L"✓", L"★", L"☆", L"●", L"○",
@@ -342,38 +246,72 @@ void loadPunctMenu(GlobalState& state) {
     Utils::updateStatus(state, L"使用內建標點符號選單：" + std::to_wstring(state.punctCandidates.size()) + L" 個符號");
 }
 
+// 換上由檔案解析的標點選單；少於 5 個符號時改用內建選單
+static void applyPunctMenu(GlobalState& state, std::vector<std::wstring>& items) {
+    if (items.size() >= 5) {
+        state.punctCandidates.swap(items);
+        Utils::updateStatus(state, L"載入標點符號選單：" + std::to_wstring(state.punctCandidates.size()) + L" 個符號");
+        return;
+    }
+    Utils::updateStatus(state, L"標點選單檔案內容過少，使用內建選單");
+    useBuiltinPunctMenu(state);
+}
+
+void loadPunctMenu(GlobalState& state) {
+    trackResource(ResourceRefresh::RES_PUNCT_MENU);
+    std::string content;
+    if (!DictFiles::readFile("punct_menu.txt", content)) {
+        Utils::updateStatus(state, L"無法開啟 punct_menu.txt，使用內建標點選單");
+        useBuiltinPunctMenu(state);
+        return;
+    }
+    std::vector<std::wstring> items;
+    DictFiles::parsePunctMenu(content, items);
+    applyPunctMenu(state, items);
+}
+
 void loadUserDict(GlobalState& state) {
-    state.wordFreq.clear();
-    std::ifstream fin("user_dict.txt");
-    if (!fin.is_open()) {
+    trackResource(ResourceRefresh::RES_USER_DICT);
+    std::string content;
+    DictFiles::UserEntries entries;
+    if (!DictFiles::readFile("user_dict.txt", content)) {
+        EngineCore::loadLearning(state, entries, time(nullptr));
+        g_queryClient.syncLearning(state);
         Utils::updateStatus(state, L"首次使用，將建立用戶字典");
         return;
     }
     
-    std::string line;
-    int count = 0;
+    int count = DictFiles::parseUserDict(content, entries);
+    EngineCore::loadLearning(state, entries, time(nullptr));
+    g_queryClient.syncLearning(state);
+    Utils::updateStatus(state, L"重新載入用戶字典：" + std::to_wstring(count) + L" 個記錄");
+}
+
+// 用戶字典檔案被修改後的合併：以檔案內容為準，
+// 但上次載入後學習過的詞保留記憶體中的記錄（頻率較高時），尚未寫出的學習不會遺失
+static void mergeUserDict(GlobalState& state, const DictFiles::UserEntries& entries) {
+    std::map<std::wstring, WordInfo> merged;
     time_t now = time(nullptr);
-    try {
-        while (std::getline(fin, line)) {
-            if (line.empty() || line[0] == '#') continue;
-            std::vector<std::string> parts;
-            std::stringstream ss(line);
-            std::string part;
-            while (std::getline(ss, part, '\t')) {
-                parts.push_back(part);
-            }
-            if (parts.size() >= 2) {
-                std::wstring character = Utils::utf8ToWstr(parts[0]);
-                int freq = (parts.size() >= 3) ? std::stoi(parts[2]) : 1;
-                if (!character.empty()) {
-                    state.wordFreq[character] = {freq, now, std::max(3, freq), freq >= 3};
-                    count++;
-                }
-            }
+    for (size_t i = 0; i < entries.size(); i++) {
+        int freq = entries[i].frequency;
+        auto current = state.wordFreq.find(entries[i].word);
+        if (current != state.wordFreq.end() && current->second.frequency == freq) {
+            merged[entries[i].word] = current->second;    // 未變更的詞保留使用時間與學習進度
+        } else {
+            merged[entries[i].word] = {freq, now, std::max(3, freq), freq >= 3};
         }
-    } catch (...) {}
-    fin.close();
-    Utils::updateStatus(state, L"重新載入用戶字典：" + std::to_wstring(count) + L" 個記錄");
+    }
+    for (const auto& word : state.learnedWords) {
+        auto current = state.wordFreq.find(word);
+        if (current == state.wordFreq.end()) continue;
+        auto fromFile = merged.find(word);
+        if (fromFile == merged.end() || current->second.frequency > fromFile->second.frequency) {
+            merged[word] = current->second;
+        }
+    }
+    state.wordFreq.swap(merged);
+    state.learnedWords.clear();
+    g_queryClient.syncLearning(state);
 }
 
 void saveUserDict(const GlobalState& state) {
@@ -403,79 +341,35 @@ void saveUserDict(const GlobalState& state) {
             fout << Utils::wstrToUtf8(item.first) << "\t\t" << item.second.frequency << "\t" << status << std::endl;
         }
         fout.close();
+        // 自己寫出的內容不需在重新載入時重建
+        trackResource(ResourceRefresh::RES_USER_DICT);
     } catch (...) {}
 }
 
 bool validateInput(const std::wstring& input) {
-    if (input.empty()) return true;
-    for (wchar_t ch : input) {
-        if (ch != L'u' && ch != L'i' && ch != L'o' && ch != L'j' && ch != L'k' && ch != L'*') {
-            return false;
-        }
-    }
-    return true;
+    return EngineCore::validateInput(input);
 }
 
 bool wildcardMatch(const std::wstring& pattern, const std::wstring& text) {
-    int pLen = pattern.length();
-    int tLen = text.length();
-    
-    std::vector<std::vector<bool>> dp(tLen + 1, std::vector<bool>(pLen + 1, false));
-    
-    dp[0][0] = true;
-    
-    for (int j = 1; j <= pLen; j++) {
-        if (pattern[j-1] == L'*') {
-            dp[0][j] = dp[0][j-1];
-        }
-    }
-    
-    for (int i = 1; i <= tLen; i++) {
-        for (int j = 1; j <= pLen; j++) {
-            if (pattern[j-1] == L'*') {
-                dp[i][j] = dp[i-1][j] || dp[i][j-1];
-            } else if (pattern[j-1] == text[i-1]) {
-                dp[i][j] = dp[i-1][j-1];
-            }
-        }
-    }
-    
-    return dp[tLen][pLen];
+    return EngineCore::wildcardMatch(pattern, text);
 }
 
 void sortCandidatesBySmartScore(GlobalState& state) {
-    std::vector<std::pair<std::wstring, std::wstring>> candidatePairs;
-    for (size_t i = 0; i < state.candidates.size(); i++) {
-        candidatePairs.push_back(std::make_pair(state.candidates[i], state.candidateCodes[i]));
-    }
-    
-    std::sort(candidatePairs.begin(), candidatePairs.end(), 
-        [&state](const std::pair<std::wstring, std::wstring>& a, const std::pair<std::wstring, std::wstring>& b) {
-        double scoreA = getWordScore(state, a.first, a.second);
-        double scoreB = getWordScore(state, b.first, b.second);
-        return scoreA > scoreB;
-    });
-    
-    state.candidates.clear();
-    state.candidateCodes.clear();
-    for (const auto& pair : candidatePairs) {
-        state.candidates.push_back(pair.first);
-        state.candidateCodes.push_back(pair.second);
-    }
+    EngineCore::rankCandidates(state, state, time(nullptr));
 }
 
 
 // 改進的候選字更新函數
 void updateCandidates(GlobalState& state) {
-    state.candidates.clear();
-    state.candidateCodes.clear();
-    state.selected = 0;
-    state.currentPage = 0;
-    state.inputError = false;
+    LatencyStats::ScopedTimer timer(LatencyStats::STAGE_UPDATE_CANDIDATES);
+    // 查詢與排序由引擎核心（或共用字典服務）完成，這裡只負責視窗與狀態列
+    EngineCore::Lookup lookup;
+    if (!g_queryClient.lookup(state, lookup)) {
+        ensureLocalDicts(state);
+        lookup = EngineCore::lookup(state, state, state);
+    }
     
-    if (state.input.empty()) { 
-        state.showCand = false;
-        state.isInputting = false;
+    if (lookup.status == EngineCore::LOOKUP_EMPTY) { 
         if (state.hCandWnd) ShowWindow(state.hCandWnd, SW_HIDE);
         if (state.hInputWnd) ShowWindow(state.hInputWnd, SW_HIDE);
         std::wstring modeText = state.chineseMode ? L"中文筆劃+全形" : L"英文直接+半形";
@@ -485,14 +379,8 @@ void updateCandidates(GlobalState& state) {
         return; 
     }
     
-    // 使用增強型驗證
-    if (!enhancedValidateInput(state.input)) {
-        state.inputError = true;
-        state.showCand = false;
-        // ★ 關鍵修改：保持輸入狀態，不設為false
-        state.isInputting = true;  
-        
-        // 保持字碼輸入視窗顯示
+    if (lookup.status != EngineCore::LOOKUP_OK) {
+        // ★ 關鍵修改：保持輸入狀態與字碼輸入視窗顯示
         if (state.hInputWnd) {
             ShowWindow(state.hInputWnd, SW_SHOW);
             InvalidateRect(state.hInputWnd, nullptr, TRUE);
@@ -502,103 +390,17 @@ void updateCandidates(GlobalState& state) {
         if (state.hCandWnd) {
             ShowWindow(state.hCandWnd, SW_HIDE);
         }
-        
-        // ★ 新增：強制重新定位字碼視窗
         WindowManager::positionInputWindow(state);
         
-        Utils::updateStatus(state, L"字碼過長：建議使用(3+3)搜尋或清除重新輸入");
+        Utils::updateStatus(state, lookup.status == EngineCore::LOOKUP_INVALID
+                                       ? L"字碼過長：建議使用(3+3)搜尋或清除重新輸入"
+                                       : L"請輸入有效字碼：uiojk或*");
         if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
         return;
     }
     
-    std::wstring filteredInput = filterValidChars(state.input);
-    
-    if (filteredInput.empty()) {
-        state.inputError = true;
-        state.showCand = false;
-        // ★ 關鍵修改：保持輸入狀態
-        state.isInputting = true;
-        
-        if (state.hInputWnd) {
-            ShowWindow(state.hInputWnd, SW_SHOW);
-            InvalidateRect(state.hInputWnd, nullptr, TRUE);
-        }
-        
-        if (state.hCandWnd) {
-            ShowWindow(state.hCandWnd, SW_HIDE);
-        }
-        
-        // ★ 新增：強制重新定位字碼視窗
-        WindowManager::positionInputWindow(state);
-        
-        Utils::updateStatus(state, L"請輸入有效字碼：uiojk或*");
-        if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
-        return;
-    }
-    
-    // 候選字查找邏輯（保持原有）
-    bool hasWildcard = filteredInput.find(L'*') != std::wstring::npos;
-    if (hasWildcard) {
-        for (const auto& pair : state.dict) {
-            if (wildcardMatch(filteredInput, pair.first)) {
-                for (const auto& character : pair.second) {
-                    state.candidates.push_back(character);
-                    state.candidateCodes.push_back(pair.first);
-                }
-            }
-        }
-    } else {
-        if (state.dict.count(filteredInput)) {
-            for (const auto& character : state.dict[filteredInput]) {
-                state.candidates.push_back(character);
-                state.candidateCodes.push_back(filteredInput);
-            }
-        }
-        
-        // 前綴匹配
-        int prefixMatchCount = 0;
-        const int MAX_PREFIX_MATCHES = 50;
-        for (const auto& pair : state.dict) {
-            if (prefixMatchCount >= MAX_PREFIX_MATCHES) break;
-            if (pair.first.length() > filteredInput.length() && 
-                pair.first.substr(0, filteredInput.length()) == filteredInput) {
-                for (const auto& character : pair.second) {
-                    if (std::find(state.candidates.begin(), state.candidates.end(), character) == state.candidates.end()) {
-                        state.candidates.push_back(character);
-                        state.candidateCodes.push_back(pair.first);
-                        prefixMatchCount++;
-                        if (prefixMatchCount >= MAX_PREFIX_MATCHES) break;
-                    }
-                }
-            }
-        }
-        
-        // 自動(3+3)搜尋
-        if (filteredInput.length() > 8 && state.candidates.empty()) {
-            std::wstring first3 = filteredInput.substr(0, std::min(3, (int)filteredInput.length()));
-            std::wstring last3;
-            if (filteredInput.length() >= 6) {
-                last3 = filteredInput.substr(filteredInput.length() - 3);
-            } else if (filteredInput.length() > 3) {
-                last3 = filteredInput.substr(3);
-            }
-            std::wstring searchPattern = first3 + L"*" + last3;
-            for (const auto& pair : state.dict) {
-                if (wildcardMatch(searchPattern, pair.first)) {
-                    for (const auto& character : pair.second) {
-                        state.candidates.push_back(character);
-                        state.candidateCodes.push_back(pair.first);
-                    }
-                }
-            }
-        }
-    }
-    
-    sortCandidatesBySmartScore(state);
-    state.totalPages = (state.candidates.size() + CANDIDATES_PER_PAGE - 1) / CANDIDATES_PER_PAGE;
-    state.showCand = !state.candidates.empty();
-    // ★ 關鍵修改：無論是否有候選字都保持輸入狀態
-    state.isInputting = true;
+    const std::wstring& filteredInput = lookup.code;
+    bool hasWildcard = lookup.wildcard;
     
     // ★ 修改：統一使用 WindowManager 來處理視窗定位
     if (state.showCand) {
@@ -621,15 +423,8 @@ void updateCandidates(GlobalState& state) {
     // 3+3模式建議
     if (filteredInput.length() > 6 && !hasWildcard && state.candidates.empty()) {
         std::wstring first3 = filteredInput.substr(0, 3);
-        std::wstring last3;
-        if (filteredInput.length() >= 6) {
-            last3 = filteredInput.substr(filteredInput.length() - 3);
-        } else if (filteredInput.length() > 3) {
-            last3 = filteredInput.substr(3);
-        }
-        if (!last3.empty()) {
-            statusMsg += L" | 建議(3+3)：" + first3 + L"*" + last3;
-        }
+        std::wstring last3 = filteredInput.substr(filteredInput.length() - 3);
+        statusMsg += L" | 建議(3+3)：" + first3 + L"*" + last3;
     }
     
     if (state.bufferMode) {
@@ -642,10 +437,10 @@ void updateCandidates(GlobalState& state) {
     if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
 }
 
-
 void selectCandidate(GlobalState& state, int idx) {
     int actualIndex = state.currentPage * CANDIDATES_PER_PAGE + idx;
     if (actualIndex < 0 || actualIndex >= (int)state.candidates.size()) return;
+    TraceRecorder::Scope trace(TraceRecorder::EVT_SELECT, idx);
     std::wstring selected = state.candidates[actualIndex];
     
     // 判斷是否為聯想字模式（候選字碼為"聯想"、"常用"或"詞語"）
@@ -685,13 +480,7 @@ void selectCandidate(GlobalState& state, int idx) {
     
     // 如果是標點符號選單，直接結束
     if (state.showPunctMenu) {
-        state.input.clear();
-        state.candidates.clear();
-        state.candidateCodes.clear();
-        state.showCand = false;
-        state.isInputting = false;
-        state.inputError = false;
-        state.showPunctMenu = false;
+        EngineCore::endInput(state);
         if (state.hCandWnd) ShowWindow(state.hCandWnd, SW_HIDE);
         if (state.hInputWnd) ShowWindow(state.hInputWnd, SW_HIDE);
         IMEManager::restoreWindowsIME();
@@ -722,13 +511,7 @@ void selectCandidate(GlobalState& state, int idx) {
     }
     
     // 不啟用聯想字或選擇標點符號：正常結束輸入
-    state.input.clear();
-    state.candidates.clear();
-    state.candidateCodes.clear();
-    state.showCand = false;
-    state.isInputting = false;
-    state.inputError = false;
-    state.showPunctMenu = false;
+    EngineCore::endInput(state);
 
     // 同時隱藏候選字視窗和字碼視窗
     if (state.hCandWnd) ShowWindow(state.hCandWnd, SW_HIDE);
@@ -743,13 +526,8 @@ void selectCandidate(GlobalState& state, int idx) {
 
 void changePage(GlobalState& state, int direction) {
     if (!state.showCand || state.totalPages <= 1) return;
-    if (direction > 0 && state.currentPage < state.totalPages - 1) {
-        state.currentPage++;
-        state.selected = 0;
-    } else if (direction < 0 && state.currentPage > 0) {
-        state.currentPage--;
-        state.selected = 0;
-    }
+    TraceRecorder::Scope trace(TraceRecorder::EVT_PAGE, direction);
+    EngineCore::changePage(state, direction);
     Utils::updateStatus(state, L"第" + std::to_wstring(state.currentPage + 1) + L"/" + 
                         std::to_wstring(state.totalPages) + L"頁 共" + 
                         std::to_wstring(state.candidates.size()) + L"個候選字");
@@ -778,163 +556,145 @@ void suggest3Plus3Mode(const GlobalState& state) {
     }  
 }
 
-// 從GitHub手動更新字典（直接下載，不檢查更新）
+// 從GitHub手動更新字典（先嘗試差異更新，不行時直接下載完整字碼表）
 bool updateDictFromGitHub(GlobalState& state, bool showProgress) {
-    if (showProgress) {
-        Utils::updateStatus(state, L"正在從GitHub下載字碼表...");
-        if (state.hWnd) {
-            InvalidateRect(state.hWnd, nullptr, TRUE);
-            UpdateWindow(state.hWnd);
+    if (DictUpdater::isUpdatePending(UpdateService::JOB_MAIN_DICT)) {
+        // 已在下載中：可以取消（已下載的部分保留，下次從中斷處繼續）
+        if (showProgress && state.hWnd &&
+            MessageBoxW(state.hWnd, L"字碼表正在背景下載中。\n\n是否取消這次下載？",
+                        L"下載字碼表", MB_YESNO | MB_ICONQUESTION) == IDYES) {
+            DictUpdater::cancelUpdate(UpdateService::JOB_MAIN_DICT);
         }
+        return false;
     }
     
-    // 直接下載，不使用 GitHub API 檢查（避免 API 訪問次數限制）
-    DictUpdater::DownloadResult downloadResult = DictUpdater::updateDictionarySafely();
+    g_reportUpdateErrors = showProgress;
+    // 共用字典服務時本機沒有字典：差異更新只改檔案，完成後請服務重新載入
+    DictUpdater::queueMainDictUpdate(nullptr, true, g_queryClient.connected() ? nullptr : &state.dict);
+    if (showProgress) {
+        Utils::updateStatus(state, L"正在從GitHub下載字碼表...（可繼續輸入）");
+    }
+    return true;
+}
+
+// 字碼表下載完成：差異更新就地修改字典，完整下載換上已解析好的字典
+static void applyMainDictUpdate(GlobalState& state, UpdateService::Result& result) {
+    bool fromFallback = g_mainDictPending;
+    bool reportErrors = g_reportUpdateErrors || fromFallback;
+    g_mainDictPending = false;
+    g_reportUpdateErrors = false;
+    
+    DictUpdater::DownloadResult download;
+    download.status = (DictUpdater::DownloadStatus)result.detail;
+    download.message = result.message;
+    download.httpCode = result.httpCode;
+    download.fileSize = (size_t)result.size;
+    download.entryCount = result.entryCount;
+    
+    if (result.status == UpdateService::STATUS_CANCELLED) {
+        Utils::updateStatus(state, fromFallback ? L"已取消字碼表下載（暫用基本筆劃）" : L"已取消下載字碼表");
+        return;
+    }
     
-    if (downloadResult.status == DictUpdater::DownloadStatus::Success) {
-        // 下載成功，重新載入字典
-        std::ifstream testFile("Zi-Ma-Biao.txt");
-        if (testFile.is_open()) {
-            testFile.close();
-            loadMainDict("Zi-Ma-Biao.txt", state);
-            Utils::updateStatus(state, L"✓ 字碼表已更新：" + 
-                              std::to_wstring(downloadResult.fileSize) + L" 字節");
-            if (state.hWnd) {
-                InvalidateRect(state.hWnd, nullptr, TRUE);
-                UpdateWindow(state.hWnd);
+    if (result.status == UpdateService::STATUS_SUCCEEDED) {
+        if (download.status == DictUpdater::DownloadStatus::Patched) {
+            // 更新執行緒已依套用時的快照建好新字典；這段期間字典沒有被換過才直接發佈
+            if (result.snapshot && state.dict.publishIf(result.base, result.snapshot)) {
+                retireSnapshot(result.base);
+                trackResource(ResourceRefresh::RES_MAIN_DICT);
+            } else {
+                // 記憶體中的字典與檔案不一致（檔案在載入後被修改過或字典已被換過）：重新載入更新後的檔案
+                loadMainDict("Zi-Ma-Biao.txt", state);
             }
-            return true;
+            Utils::updateStatus(state, L"✓ 字碼表" + download.message);
+        } else if (download.status == DictUpdater::DownloadStatus::NotModified) {
+            // 伺服器上的字碼表沒有變更：只花一次往返，不需要重新載入
+            Utils::updateStatus(state, L"✓ 字碼表已是最新版本（伺服器未變更）");
+        } else if (g_queryClient.connected()) {
+            // 字碼表由共用字典服務提供：請服務重新載入下載好的檔案
+            loadMainDict("Zi-Ma-Biao.txt", state);
         } else {
-            // 文件不存在（不应该发生，因为下载成功了）
-            Utils::updateStatus(state, L"✗ 更新成功但檔案未找到");
-            if (state.hWnd) {
-                MessageBoxW(state.hWnd, 
-                    L"錯誤：字碼表更新成功但檔案未找到。\n請重新啟動程序或手動檢查。", 
-                    L"更新異常", MB_OK | MB_ICONWARNING);
-                InvalidateRect(state.hWnd, nullptr, TRUE);
-                UpdateWindow(state.hWnd);
+            // 下載時已驗證並建好快照：只交換指標，不必重新讀取檔案
+            DictModel::SnapshotPtr old = state.dict.publish(result.snapshot);
+            retireSnapshot(old);
+            trackResource(ResourceRefresh::RES_MAIN_DICT);
+            int entries = state.dict.pin()->entryCount();
+            if (fromFallback) {
+                Utils::updateStatus(state, L"✓ 成功從GitHub下載字碼表：" + std::to_wstring(entries) + L" 個字");
+            } else {
+                Utils::updateStatus(state, L"✓ 字碼表已更新：" + std::to_wstring(entries) + L" 個字、" +
+                                  std::to_wstring(download.fileSize) + L" 字節");
             }
-            return false;
         }
+        // 輸入到一半時以新字典重新查詢候選字
+        if (!state.input.empty()) updateCandidates(state);
+        if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
+        return;
+    }
+    
+    // 下載失敗（已重試過暫時性錯誤），顯示詳細錯誤信息
+    std::wstring errorMsg = DictUpdater::getStatusMessage(download);
+    if (result.attempts > 1) errorMsg += L"（已嘗試 " + std::to_wstring(result.attempts) + L" 次）";
+    Utils::updateStatus(state, (fromFallback ? L"✗ 無法下載字碼表：" : L"✗ 下載失敗：") + errorMsg);
+    if (!reportErrors || !state.hWnd) return;
+    
+    std::wstring msgBoxText;
+    if (fromFallback) {
+        msgBoxText = L"警告：字碼表檔案缺失且下載失敗\n\n";
+        msgBoxText += L"錯誤原因：" + errorMsg + L"\n\n";
+        msgBoxText += L"建議：\n";
+        msgBoxText += L"1. 檢查網路連接\n";
+        msgBoxText += L"2. 手動從GitHub下載 Zi-Ma-Biao.txt\n";
+        msgBoxText += L"3. 將文件放在程序目錄下\n\n";
+        msgBoxText += L"GitHub地址：\n";
+        msgBoxText += L"https://github.com/Yamazaki427858/ChineseStrokeIME";
+        MessageBoxW(state.hWnd, msgBoxText.c_str(), L"字碼表缺失警告", MB_OK | MB_ICONWARNING);
     } else {
-        // 下載失败，显示详细错误信息
-        std::wstring errorMsg = DictUpdater::getStatusMessage(downloadResult);
-        Utils::updateStatus(state, L"✗ 下載失敗：" + errorMsg);
-        
-        if (showProgress && state.hWnd) {
-            std::wstring msgBoxText = L"字碼表下載失敗\n\n";
-            msgBoxText += L"錯誤原因：" + errorMsg + L"\n\n";
-            msgBoxText += L"建議：\n";
-            msgBoxText += L"1. 檢查網路連接\n";
-            msgBoxText += L"2. 稍後重試\n";
-            
-            MessageBoxW(state.hWnd, msgBoxText.c_str(), 
-                L"下載失敗", MB_OK | MB_ICONWARNING);
-            InvalidateRect(state.hWnd, nullptr, TRUE);
-            UpdateWindow(state.hWnd);
+        msgBoxText = L"字碼表下載失敗\n\n";
+        msgBoxText += L"錯誤原因：" + errorMsg + L"\n\n";
+        msgBoxText += L"建議：\n";
+        msgBoxText += L"1. 檢查網路連接\n";
+        msgBoxText += L"2. 稍後重試\n";
+        MessageBoxW(state.hWnd, msgBoxText.c_str(), L"下載失敗", MB_OK | MB_ICONWARNING);
+    }
+    InvalidateRect(state.hWnd, nullptr, TRUE);
+}
+
+void onUpdateFinished(GlobalState& state, UpdateService::Result& result) {
+    if (result.kind == UpdateService::JOB_MAIN_DICT) {
+        applyMainDictUpdate(state, result);
+    } else if (result.kind == UpdateService::JOB_WORD_PHRASES) {
+        // 詞語庫是可選的：下載失敗時靜默略過
+        if (result.status != UpdateService::STATUS_SUCCEEDED ||
+            (DictUpdater::DownloadStatus)result.detail != DictUpdater::DownloadStatus::Success) return;
+        state.wordPhrases.swap(result.phrases);
+        trackResource(ResourceRefresh::RES_WORD_PHRASES);
+        if (result.entryCount > 0) {
+            Utils::updateStatus(state, L"載入詞語庫：" + std::to_wstring(result.entryCount) + L" 個詞語組合");
         }
-        return false;
     }
 }
 
 // 載入詞語庫文件
 void loadWordPhrases(GlobalState& state, const char* filename) {
-    state.wordPhrases.clear();
-    state.phraseDictSize = 0;
-    
-    std::ifstream fin(filename, std::ios::in | std::ios::binary);
-    if (!fin.is_open()) {
-        // 文件不存在，嘗試從GitHub自動下載（靜默下載，不顯示提示）
-        const char* downloadUrl = 
-            "https://raw.githubusercontent.com/Yamazaki427858/ChineseStrokeIME/ChineseStrokeIME/SourceCode/%E8%81%AF%E6%83%B3%E8%A9%9E%E5%BA%AB/word_phrases.txt";
-        
-        DictUpdater::DownloadResult downloadResult = DictUpdater::downloadFromGitHub(
-            downloadUrl, 
-            filename,  // 直接下載到目標文件
-            30  // 30秒超時
-        );
-        
-        if (downloadResult.status == DictUpdater::DownloadStatus::Success) {
-            // 下載成功，重新嘗試打開文件
-            fin.close();
-            fin.open(filename, std::ios::in | std::ios::binary);
-            if (!fin.is_open()) {
-                // 下載成功但無法打開文件（不應該發生）
-                return;
-            }
-        } else {
-            // 下載失敗，靜默返回（不顯示錯誤）
-            return;
-        }
-    }
-    
-    std::string content((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-    fin.close();
-    
-    // 處理 UTF-8 BOM
-    if (content.length() >= 3 && 
-        content[0] == static_cast<char>(0xEF) &&
-        content[1] == static_cast<char>(0xBB) &&
-        content[2] == static_cast<char>(0xBF)) {
-        content = content.substr(3);
+    if (g_queryClient.connected()) {
+        // 詞語庫由共用字典服務提供（服務啟動時載入）
+        trackResource(ResourceRefresh::RES_WORD_PHRASES);
+        return;
     }
+    state.wordPhrases.clear();
+    trackResource(ResourceRefresh::RES_WORD_PHRASES);
     
-    // 按行分割處理
-    std::stringstream ss(content);
-    std::string line;
-    int count = 0;
-    
-    while (std::getline(ss, line)) {
-        // 移除行尾的 \r（Windows 換行符）
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        
-        // 移除前後空格
-        line.erase(0, line.find_first_not_of(" \t"));
-        line.erase(line.find_last_not_of(" \t") + 1);
-        
-        // 跳過空行和註解行
-        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
-        
-        // 轉換為寬字符
-        try {
-            std::wstring phrase = Utils::utf8ToWstr(line);
-            // 支持2字以上的詞語（不限制最大長度，但建議不超過10字以保持性能）
-            if (phrase.length() >= 2 && phrase.length() <= 10) {
-                // 為詞語中的每個字（除了最後一個）建立到下一個字的映射
-                // 例如「電腦系統管理」會建立：
-                // 「電」 → 「腦」
-                // 「腦」 → 「系」
-                // 「系」 → 「統」
-                // 「統」 → 「管」
-                // 「管」 → 「理」
-                // 這樣可以支持連續聯想：電→腦→系→統→管→理
-                for (size_t i = 0; i < phrase.length() - 1; i++) {
-                    std::wstring currentChar = phrase.substr(i, 1);
-                    std::wstring nextChar = phrase.substr(i + 1, 1);
-                    
-                    // 檢查是否已存在
-                    bool exists = false;
-                    if (state.wordPhrases.find(currentChar) != state.wordPhrases.end()) {
-                        const auto& existing = state.wordPhrases[currentChar];
-                        if (std::find(existing.begin(), existing.end(), nextChar) != existing.end()) {
-                            exists = true;
-                        }
-                    }
-                    if (!exists) {
-                        state.wordPhrases[currentChar].push_back(nextChar);
-                        count++;
-                    }
-                }
-            }
-        } catch (...) {
-            // 轉換失敗，跳過這行
-            continue;
-        }
+    std::string content;
+    if (!DictFiles::readFile(filename, content)) {
+        // 文件不存在：在背景從GitHub下載並解析（靜默下載，失敗時不顯示錯誤），完成後由 onUpdateFinished 換上
+        DictUpdater::queueWordPhrasesDownload(filename);
+        return;
     }
     
-    state.phraseDictSize = count;
+    // 每個字對應到詞語中的下一個字，支援連續聯想（電→腦→系→統）
+    state.wordPhrases = DictModel::loadSharedPhrases(filename, content);
+    int count = state.wordPhrases.entryCount();
     if (count > 0) {
         Utils::updateStatus(state, L"載入詞語庫：" + std::to_wstring(count) + L" 個詞語組合");
     }
@@ -942,159 +702,9 @@ void loadWordPhrases(GlobalState& state, const char* filename) {
 
 // 獲取聯想字候選列表
 void getWordPredictions(GlobalState& state, const std::wstring& word) {
-    state.candidates.clear();
-    state.candidateCodes.clear();
-    
-    if (word.empty()) return;
-    
-    // 0. 從詞語庫中獲取聯想字（最高優先級，如果詞語庫存在）
-    if (state.phraseDictSize > 0 && state.wordPhrases.find(word) != state.wordPhrases.end()) {
-        const auto& phrases = state.wordPhrases.at(word);
-        for (const auto& phraseChar : phrases) {
-            if (std::find(state.candidates.begin(), state.candidates.end(), phraseChar) == state.candidates.end()) {
-                state.candidates.push_back(phraseChar);
-                // 查找該字的字碼
-                std::wstring code = L"";
-                for (const auto& pair : state.dict) {
-                    if (std::find(pair.second.begin(), pair.second.end(), phraseChar) != pair.second.end()) {
-                        code = pair.first;
-                        break;
-                    }
-                }
-                state.candidateCodes.push_back(code.empty() ? L"詞語" : code);
-            }
-        }
-    }
-    
-    // 1. 從上下文學習中獲取聯想字（優先級次高）
-    if (state.contextLearning.find(word) != state.contextLearning.end()) {
-        const auto& contextWords = state.contextLearning.at(word);
-        for (const auto& contextWord : contextWords) {
-            if (std::find(state.candidates.begin(), state.candidates.end(), contextWord) == state.candidates.end()) {
-                state.candidates.push_back(contextWord);
-                // 查找該字的字碼（如果有的話）
-                std::wstring code = L"";
-                for (const auto& pair : state.dict) {
-                    if (std::find(pair.second.begin(), pair.second.end(), contextWord) != pair.second.end()) {
-                        code = pair.first;
-                        break;
-                    }
-                }
-                state.candidateCodes.push_back(code.empty() ? L"聯想" : code);
-            }
-        }
-    }
-    
-    // 2. 從字典中查找常見的詞語組合（優化版：支持2字詞和3字詞）
-    // 查找以該字開頭的常見詞語
-    std::map<std::wstring, int> wordScores;  // 字 -> 分數
-    
-    for (const auto& pair : state.dict) {
-        for (const auto& dictWord : pair.second) {
-            // 如果字典中的字以選中的字開頭（形成詞語）
-            if (dictWord.length() > 1 && dictWord[0] == word[0]) {
-                // 提取後續字（支持2字詞和3字詞）
-                for (size_t i = 1; i < dictWord.length() && i <= 2; i++) {
-                    std::wstring nextChar = dictWord.substr(i, 1);
-                    if (nextChar.length() == 1) {
-                        // 計算分數（基於詞頻和詞語長度）
-                        int score = 0;
-                        if (state.wordFreq.find(dictWord) != state.wordFreq.end()) {
-                            score = state.wordFreq.at(dictWord).frequency * 2;  // 詞語頻率加權
-                        } else {
-                            score = 1;  // 基礎分數
-                        }
-                        // 2字詞優先於3字詞
-                        if (dictWord.length() == 2) {
-                            score += 5;
-                        }
-                        if (wordScores.find(nextChar) == wordScores.end() || wordScores[nextChar] < score) {
-                            wordScores[nextChar] = score;
-                        }
-                    }
-                }
-            }
-            // 如果字典中的字以選中的字結尾（形成詞語）
-            if (dictWord.length() > 1 && dictWord.back() == word[0]) {
-                // 提取前面的字（支持2字詞和3字詞）
-                for (size_t i = 0; i < dictWord.length() - 1 && i < 2; i++) {
-                    std::wstring prevChar = dictWord.substr(i, 1);
-                    if (prevChar.length() == 1) {
-                        int score = 0;
-                        if (state.wordFreq.find(dictWord) != state.wordFreq.end()) {
-                            score = state.wordFreq.at(dictWord).frequency * 2;  // 詞語頻率加權
-                        } else {
-                            score = 1;  // 基礎分數
-                        }
-                        // 2字詞優先於3字詞
-                        if (dictWord.length() == 2) {
-                            score += 5;
-                        }
-                        if (wordScores.find(prevChar) == wordScores.end() || wordScores[prevChar] < score) {
-                            wordScores[prevChar] = score;
-                        }
-                    }
-                }
-            }
-        }
-    }
-    
-    // 按分數排序並添加到候選列表
-    std::vector<std::pair<std::wstring, int>> sortedWords;
-    for (const auto& pair : wordScores) {
-        if (std::find(state.candidates.begin(), state.candidates.end(), pair.first) == state.candidates.end()) {
-            sortedWords.push_back(std::make_pair(pair.first, pair.second));
-        }
-    }
-    std::sort(sortedWords.begin(), sortedWords.end(), 
-        [](const std::pair<std::wstring, int>& a, const std::pair<std::wstring, int>& b) {
-            return a.second > b.second;
-        });
-    
-    // 限制聯想字數量（最多20個）
-    size_t maxPredictions = 20;
-    for (size_t i = 0; i < sortedWords.size() && state.candidates.size() < maxPredictions; i++) {
-        state.candidates.push_back(sortedWords[i].first);
-        // 查找該字的字碼
-        std::wstring code = L"";
-        for (const auto& pair : state.dict) {
-            if (std::find(pair.second.begin(), pair.second.end(), sortedWords[i].first) != pair.second.end()) {
-                code = pair.first;
-                break;
-            }
-        }
-        state.candidateCodes.push_back(code.empty() ? L"聯想" : code);
-    }
-    
-    // 3. 如果候選字太少，從字典中隨機選擇一些常見字
-    if (state.candidates.size() < 5) {
-        // 選擇詞頻較高的字作為補充
-        std::vector<std::pair<std::wstring, int>> freqWords;
-        for (const auto& pair : state.wordFreq) {
-            if (pair.first.length() == 1 && 
-                std::find(state.candidates.begin(), state.candidates.end(), pair.first) == state.candidates.end()) {
-                freqWords.push_back(std::make_pair(pair.first, pair.second.frequency));
-            }
-        }
-        std::sort(freqWords.begin(), freqWords.end(), 
-            [](const std::pair<std::wstring, int>& a, const std::pair<std::wstring, int>& b) {
-                return a.second > b.second;
-            });
-        
-        // maxPredictions 已在上面定義為 size_t，這裡直接使用
-        for (size_t i = 0; i < freqWords.size() && state.candidates.size() < maxPredictions; i++) {
-            state.candidates.push_back(freqWords[i].first);
-            // 查找該字的字碼
-            std::wstring code = L"";
-            for (const auto& pair : state.dict) {
-                if (std::find(pair.second.begin(), pair.second.end(), freqWords[i].first) != pair.second.end()) {
-                    code = pair.first;
-                    break;
-                }
-            }
-            state.candidateCodes.push_back(code.empty() ? L"常用" : code);
-        }
-    }
+    if (g_queryClient.predict(state, word)) return;
+    ensureLocalDicts(state);
+    EngineCore::predict(state, state, state, word);
 }
 
 // 選擇字後顯示聯想字
@@ -1176,4 +786,88 @@ void showPredictionsAfterSelection(GlobalState& state, const std::wstring& selec
     // if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
 }
 
+// 重新載入字典檔案：在背景比對檔案並重建有變更的部分，介面執行緒不等待
+void refreshChangedResources(GlobalState& state) {
+    ResourceRefresh::Refresher* refresher = resourceRefresher();
+    if (!refresher) return;
+    g_refreshNotifyWnd = state.hWnd;
+    refresher->refresh();
+    Utils::updateStatus(state, L"正在檢查字典檔案變更...");
+}
+
+void onResourcesRefreshed(GlobalState& state) {
+    if (!g_refresher) return;
+    ResourceRefresh::Result result;
+    while (g_refresher->take(result)) {
+        // 一次換上所有重建完成的資料（只交換容器或快照指標，與字典大小無關）
+        std::wstring updated;
+        if ((result.rebuilt & ResourceRefresh::RES_MAIN_DICT) && g_queryClient.connected()) {
+            // 共用字典服務：請服務重新載入，背景建好的字典直接釋放
+            loadMainDict("Zi-Ma-Biao.txt", state);
+            updated += L"字碼表（共用字典服務）、";
+        } else if (result.rebuilt & ResourceRefresh::RES_MAIN_DICT) {
+            int entries = result.mainDict->entryCount();
+            result.mainDict = state.dict.publish(result.mainDict);
+            updated += L"字碼表（" + std::to_wstring(entries) + L" 個字）、";
+        }
+        if (result.rebuilt & ResourceRefresh::RES_PUNCT_MENU) {
+            applyPunctMenu(state, result.punctMenu);
+            updated += L"標點選單、";
+        }
+        if (result.rebuilt & ResourceRefresh::RES_USER_DICT) {
+            mergeUserDict(state, result.userDict);
+            updated += L"用戶字典、";
+        }
+        // 共用字典服務的詞語庫在服務重新啟動時載入
+        if ((result.rebuilt & ResourceRefresh::RES_WORD_PHRASES) && !g_queryClient.connected()) {
+            state.wordPhrases.swap(result.wordPhrases);
+            updated += L"詞語庫、";
+        }
+        // 換下來的舊字典由背景執行緒釋放
+        g_refresher->retire(result);
+        
+        if (result.rebuilt & (ResourceRefresh::RES_MAIN_DICT | ResourceRefresh::RES_USER_DICT)) {
+            updateCandidates(state);
+        }
+        
+        std::wstring status;
+        if (updated.empty()) {
+            status = L"字典檔案沒有變更";
+        } else {
+            updated.pop_back();
+            status = L"已重新載入：" + updated;
+        }
+        if (result.missing & ResourceRefresh::RES_MAIN_DICT) {
+            status += L"（找不到 Zi-Ma-Biao.txt，沿用目前的字碼表）";
+        }
+        Utils::updateStatus(state, status);
+    }
+    
+    if (state.hCandWnd) InvalidateRect(state.hCandWnd, nullptr, TRUE);
+    if (state.hInputWnd) InvalidateRect(state.hInputWnd, nullptr, TRUE);
+}
+
+bool connectQueryServer(GlobalState& state) {
+    // 先找自己的服務，再找管理員提供的全機服務
+    std::vector<std::string> addresses = QueryChannel::clientAddresses();
+    for (size_t i = 0; i < addresses.size(); i++) {
+        if (g_queryClient.connect(addresses[i])) {
+            Utils::updateStatus(state, L"使用共用字典服務");
+            return true;
+        }
+    }
+    return false;
+}
+
+void syncQueryLearning(const GlobalState& state) {
+    g_queryClient.syncLearning(state);
+}
+
+void shutdownResourceRefresh() {
+    g_refreshNotifyWnd = nullptr;
+    g_refresherShutdown = true;
+    delete g_refresher;
+    g_refresher = nullptr;
+}
+
 } // namespace Dictionary
\ No newline at end of file
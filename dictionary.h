@@ -3,6 +3,7 @@
 #define DICTIONARY_H
 
 #include "ime_core.h"
+#include "update_service.h"
 
 namespace Dictionary {
     // 字典載入函數
@@ -12,8 +13,25 @@ namespace Dictionary {
     void loadUserDict(GlobalState& state);
     void saveUserDict(const GlobalState& state);
     
+    // 共用字典服務（strokeime-server）：連線成功時查詢與聯想由服務完成，不在本機載入字碼表與詞語庫
+    // 在載入字典之前呼叫；服務中斷時自動改用本機字典
+    bool connectQueryServer(GlobalState& state);
+    // 以 state 的學習取代服務上的學習（暫存狀態經由服務重播之後，恢復使用中的學習）
+    void syncQueryLearning(const GlobalState& state);
+    
+    // 重新載入字典檔案：只在背景重建內容有變更的檔案（用戶字典與記憶體中的學習合併）
+    // 完成後以 WM_USER+105 通知主視窗，由 onResourcesRefreshed 一次換上
+    void refreshChangedResources(GlobalState& state);
+    void onResourcesRefreshed(GlobalState& state);
+    // 結束背景執行緒（程式結束前、保存用戶字典之後呼叫）
+    void shutdownResourceRefresh();
+    
     // 字典更新函數（從GitHub下載）
+    // 在背景更新執行緒下載，不阻塞輸入；已在下載中時詢問是否取消（showProgress 時）
+    // showProgress: 失敗時顯示對話框；回傳是否已開始下載
     bool updateDictFromGitHub(GlobalState& state, bool showProgress = true);
+    // 背景更新完成（WM_USER+107）：換上下載好的字碼表或詞語庫（只交換容器）
+    void onUpdateFinished(GlobalState& state, UpdateService::Result& result);
     
     // 候選字處理
     void updateCandidates(GlobalState& state);
@@ -45,7 +63,7 @@ namespace Dictionary {
     void getWordPredictions(GlobalState& state, const std::wstring& word);
     void showPredictionsAfterSelection(GlobalState& state, const std::wstring& selected);
     
-    // 詞語庫功能
+    // 詞語庫功能（檔案不存在時在背景下載，完成後由 onUpdateFinished 換上）
     void loadWordPhrases(GlobalState& state, const char* filename = "word_phrases.txt");
 }
 
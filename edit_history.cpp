@@ -0,0 +1,201 @@
+// edit_history.cpp - 暫放區復原/重做實作
+#include "edit_history.h"
+#include <utility>
+
+const size_t EditHistory::DEFAULT_BUDGET_BYTES;
+const size_t EditHistory::MAX_COALESCE_LENGTH;
+
+EditHistory::EditHistory(size_t budgetBytes)
+    : budget_(budgetBytes), bytes_(0), sealed_(true), grouping_(false), groupOpen_(false) {}
+
+void EditHistory::setBudget(size_t budgetBytes) {
+    budget_ = budgetBytes;
+    enforceBudget();
+}
+
+size_t EditHistory::opBytes(const EditOp& op) {
+    return sizeof(EditOp) + op.text.size() * sizeof(wchar_t);
+}
+
+size_t EditHistory::groupBytes(const Group& group) {
+    size_t bytes = sizeof(Group);
+    for (size_t i = 0; i < group.ops.size(); i++) bytes += opBytes(group.ops[i]);
+    return bytes;
+}
+
+bool EditHistory::isSeparator(wchar_t ch) {
+    if (ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n' || ch == 0x3000) return true;
+    // ASCII 標點與全形標點（、。，！？；：「」等）
+    if ((ch >= L'!' && ch <= L'/') || (ch >= L':' && ch <= L'@') ||
+        (ch >= L'[' && ch <= L'`') || (ch >= L'{' && ch <= L'~')) return true;
+    if (ch >= 0x3001 && ch <= 0x303F) return true;
+    if (ch >= 0xFF01 && ch <= 0xFF0F) return true;
+    if (ch >= 0xFF1A && ch <= 0xFF20) return true;
+    return false;
+}
+
+void EditHistory::recordInsert(size_t pos, const std::wstring& text, int cursorBefore, int cursorAfter) {
+    if (text.empty()) return;
+    record(EditOp::INSERT, pos, text, cursorBefore, cursorAfter);
+}
+
+void EditHistory::recordErase(size_t pos, const std::wstring& removed, int cursorBefore, int cursorAfter) {
+    if (removed.empty()) return;
+    record(EditOp::ERASE, pos, removed, cursorBefore, cursorAfter);
+}
+
+void EditHistory::record(EditOp::Kind kind, size_t pos, const std::wstring& text, int cursorBefore, int cursorAfter) {
+    if (grouping_ && groupOpen_ && !undo_.empty()) {
+        // 附加到這次 beginGroup 建立的群組
+        EditOp op;
+        op.kind = kind;
+        op.pos = pos;
+        op.text = text;
+        bytes_ += opBytes(op);
+        Group& group = undo_.back();
+        group.ops.push_back(std::move(op));
+        group.cursorAfter = cursorAfter;
+        enforceBudget();
+        return;
+    }
+    if (grouping_ || !tryCoalesce(kind, pos, text, cursorAfter)) {
+        push(kind, pos, text, cursorBefore, cursorAfter);
+        if (grouping_) groupOpen_ = true;
+    }
+}
+
+void EditHistory::beginGroup() {
+    sealed_ = true;
+    grouping_ = true;
+    groupOpen_ = false;
+}
+
+void EditHistory::endGroup() {
+    grouping_ = false;
+    groupOpen_ = false;
+    sealed_ = true;
+}
+
+bool EditHistory::tryCoalesce(EditOp::Kind kind, size_t pos, const std::wstring& text, int cursorAfter) {
+    if (sealed_ || undo_.empty()) return false;
+    Group& group = undo_.back();
+    if (group.ops.size() != 1) return false;
+    EditOp& last = group.ops[0];
+    if (last.kind != kind) return false;
+    if (last.text.size() + text.size() > MAX_COALESCE_LENGTH) return false;
+
+    if (kind == EditOp::INSERT) {
+        if (pos != last.pos + last.text.size()) return false;
+        // 詞的邊界：分隔字元之後再輸入一般文字時開始新群組
+        if (isSeparator(last.text[last.text.size() - 1]) && !isSeparator(text[0])) return false;
+        last.text += text;
+    } else if (pos + text.size() == last.pos) {
+        // Backspace：刪除的文字在前一次刪除位置之前
+        last.text.insert(0, text);
+        last.pos = pos;
+    } else if (pos == last.pos) {
+        // Delete：在同一位置持續向後刪除
+        last.text += text;
+    } else {
+        return false;
+    }
+
+    group.cursorAfter = cursorAfter;
+    bytes_ += text.size() * sizeof(wchar_t);
+    enforceBudget();
+    return true;
+}
+
+void EditHistory::push(EditOp::Kind kind, size_t pos, const std::wstring& text, int cursorBefore, int cursorAfter) {
+    // 新的編輯使重做歷史失效
+    for (size_t i = 0; i < redo_.size(); i++) bytes_ -= groupBytes(redo_[i]);
+    redo_.clear();
+
+    Group group;
+    EditOp op;
+    op.kind = kind;
+    op.pos = pos;
+    op.text = text;
+    group.ops.push_back(op);
+    group.cursorBefore = cursorBefore;
+    group.cursorAfter = cursorAfter;
+
+    bytes_ += groupBytes(group);
+    undo_.push_back(std::move(group));
+    sealed_ = false;
+    enforceBudget();
+}
+
+void EditHistory::enforceBudget() {
+    // 至少保留最新一組，單一超大編輯仍可復原
+    while (bytes_ > budget_ && undo_.size() > 1) {
+        bytes_ -= groupBytes(undo_.front());
+        undo_.pop_front();
+    }
+}
+
+bool EditHistory::apply(const EditOp& op, bool inverse, TextModel& text) {
+    bool insert = (op.kind == EditOp::INSERT) != inverse;
+    if (insert) {
+        if (op.pos > text.length()) return false;
+        text.insert(op.pos, op.text);
+        return true;
+    }
+    // 刪除前確認內容相符，避免歷史與文字不同步時破壞內容
+    if (op.pos + op.text.size() > text.length()) return false;
+    if (text.substr(op.pos, op.text.size()) != op.text) return false;
+    text.erase(op.pos, op.text.size());
+    return true;
+}
+
+// 復原時由後往前套用反向操作，重做時由前往後；
+// 中途有一筆不相符時撤回已套用的操作，不會留下只套用一半的群組
+bool EditHistory::applyGroup(const Group& group, bool inverse, TextModel& text) {
+    size_t count = group.ops.size();
+    for (size_t n = 0; n < count; n++) {
+        if (apply(group.ops[inverse ? count - 1 - n : n], inverse, text)) continue;
+        // 剛套用的操作反向必定成功
+        while (n-- > 0) apply(group.ops[inverse ? count - 1 - n : n], !inverse, text);
+        return false;
+    }
+    return true;
+}
+
+bool EditHistory::undo(TextModel& text, int& cursor) {
+    if (undo_.empty()) return false;
+    Group group = std::move(undo_.back());
+    undo_.pop_back();
+
+    if (!applyGroup(group, true, text)) {
+        clear();
+        return false;
+    }
+    cursor = group.cursorBefore;
+    redo_.push_back(std::move(group));
+    sealed_ = true;
+    return true;
+}
+
+bool EditHistory::redo(TextModel& text, int& cursor) {
+    if (redo_.empty()) return false;
+    Group group = std::move(redo_.back());
+    redo_.pop_back();
+
+    if (!applyGroup(group, false, text)) {
+        clear();
+        return false;
+    }
+    cursor = group.cursorAfter;
+    undo_.push_back(std::move(group));
+    sealed_ = true;
+    enforceBudget();
+    return true;
+}
+
+void EditHistory::clear() {
+    undo_.clear();
+    redo_.clear();
+    bytes_ = 0;
+    sealed_ = true;
+    groupOpen_ = false;
+}
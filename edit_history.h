@@ -0,0 +1,83 @@
+// edit_history.h - 暫放區復原/重做：記錄編輯操作而非整份文字快照（可攜式，不依賴 Windows API）
+#ifndef EDIT_HISTORY_H
+#define EDIT_HISTORY_H
+
+#include "text_model.h"
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+// 每筆記錄只保存被插入或刪除的文字，成本與編輯大小成正比，與文件長度無關
+// - 連續輸入（位置相接）合併成以詞為單位的群組：遇到空白、換行或標點後重新開始一組
+// - 連續的 Backspace / Delete 同樣合併
+// - 以位元組預算限制總大小，超過時丟棄最舊的群組（不再限制步數）
+class EditHistory {
+public:
+    struct EditOp {
+        enum Kind { INSERT = 0, ERASE = 1 };
+        Kind kind;
+        size_t pos;
+        std::wstring text;     // 插入或被刪除的文字
+    };
+
+    static const size_t DEFAULT_BUDGET_BYTES = 4 * 1024 * 1024;
+    static const size_t MAX_COALESCE_LENGTH = 32;   // 單一群組合併的最大字數
+
+    explicit EditHistory(size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+    void setBudget(size_t budgetBytes);
+    size_t budget() const { return budget_; }
+
+    // 記錄已套用到文字上的編輯；cursorBefore/cursorAfter 為編輯前後的游標位置
+    void recordInsert(size_t pos, const std::wstring& text, int cursorBefore, int cursorAfter);
+    void recordErase(size_t pos, const std::wstring& removed, int cursorBefore, int cursorAfter);
+
+    // 之後的編輯開始新群組（游標移動、貼上、取代選取等）
+    void breakGroup() { sealed_ = true; }
+
+    // beginGroup 與 endGroup 之間的所有記錄合併成一組，一次復原（例如全部取代）
+    void beginGroup();
+    void endGroup();
+
+    bool canUndo() const { return !undo_.empty(); }
+    bool canRedo() const { return !redo_.empty(); }
+
+    // 套用反向操作；歷史與文字不一致時文字維持原狀，清空歷史並回傳 false
+    bool undo(TextModel& text, int& cursor);
+    bool redo(TextModel& text, int& cursor);
+
+    void clear();
+
+    size_t undoDepth() const { return undo_.size(); }
+    size_t redoDepth() const { return redo_.size(); }
+    size_t bytesUsed() const { return bytes_; }
+
+private:
+    struct Group {
+        std::vector<EditOp> ops;
+        int cursorBefore;
+        int cursorAfter;
+    };
+
+    static size_t opBytes(const EditOp& op);
+    static size_t groupBytes(const Group& group);
+    static bool isSeparator(wchar_t ch);
+
+    bool tryCoalesce(EditOp::Kind kind, size_t pos, const std::wstring& text, int cursorAfter);
+    void record(EditOp::Kind kind, size_t pos, const std::wstring& text, int cursorBefore, int cursorAfter);
+    void push(EditOp::Kind kind, size_t pos, const std::wstring& text, int cursorBefore, int cursorAfter);
+    void enforceBudget();
+    static bool apply(const EditOp& op, bool inverse, TextModel& text);
+    static bool applyGroup(const Group& group, bool inverse, TextModel& text);
+
+    std::deque<Group> undo_;
+    std::vector<Group> redo_;
+    size_t budget_;
+    size_t bytes_;        // undo_ 與 redo_ 合計
+    bool sealed_;         // 最後一組是否已封閉（不再合併）
+    bool grouping_;       // 位於 beginGroup/endGroup 之間
+    bool groupOpen_;      // 這次 beginGroup 已建立群組
+};
+
+#endif // EDIT_HISTORY_H
@@ -0,0 +1,383 @@
+// edit_journal.cpp - 暫放區編輯日誌與檢查點實作
+#include "edit_journal.h"
+#include "file_io.h"
+#include <algorithm>
+#include <cstring>
+
+const size_t EditJournal::DEFAULT_MIN_CHECKPOINT_BYTES;
+
+// 日誌檔頭："SBJ1"、wchar_t 位元組數、保留 3 位元組、檢查點大小（u64）、檢查點雜湊（u64）
+static const char JOURNAL_MAGIC[4] = {'S', 'B', 'J', '1'};
+static const size_t JOURNAL_HEADER_SIZE = 24;
+// 記錄：種類（u8）、位置（u32）、字數（u32）、文字（字數 × wchar_t）、校驗碼（u32）
+static const size_t RECORD_HEAD_SIZE = 9;
+static const size_t RECORD_CHECK_SIZE = 4;
+
+static uint32_t fnv32(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+static void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+}
+
+static uint64_t getLE(const char* data, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) value |= (uint64_t)(uint8_t)data[i] << (8 * i);
+    return value;
+}
+
+static bool readFile(const std::string& path, std::string& content) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    content.clear();
+    char block[65536];
+    size_t n;
+    while ((n = std::fread(block, 1, sizeof(block), file)) > 0) content.append(block, n);
+    std::fclose(file);
+    return true;
+}
+
+EditJournal::EditJournal(const std::string& checkpointPath, const std::string& journalPath,
+                         size_t minCheckpointBytes)
+    : checkpointPath_(checkpointPath), journalPath_(journalPath),
+      minCheckpointBytes_(minCheckpointBytes), baseBytes_(0), baseHash_(FileIO::FNV64_OFFSET),
+      enqueued_(0), written_(0), checkpointRequested_(false), checkpointsDone_(0),
+      checkpointCount_(0), stopping_(false), running_(false),
+      journal_(nullptr), journalBytes_(0), bytesWritten_(0) {}
+
+EditJournal::~EditJournal() {
+    stop();
+}
+
+// ===== 恢復 =====
+
+void EditJournal::recover(Recovery& result, const BufferFile::Progress& progress) const {
+    result = Recovery();
+
+    // 檢查點分段讀取，同時計算大小與雜湊（與日誌檔頭比對）
+    uint64_t checkpointBytes = 0;
+    uint64_t checkpointHash = FileIO::FNV64_OFFSET;
+    std::wstring decoded;
+    BufferFile::Status status = BufferFile::load(checkpointPath_, decoded, progress,
+        [&](const char* data, size_t size) {
+            checkpointBytes += size;
+            checkpointHash = FileIO::fnv64(data, size, checkpointHash);
+        });
+    bool hasCheckpoint = (status == BufferFile::OK);
+    if (status == BufferFile::IO_FAILED || status == BufferFile::CANCELLED) {
+        result.unreadable = true;
+        return;
+    }
+    TextModel& text = result.text;
+    if (hasCheckpoint) {
+        result.found = true;
+        text = std::move(decoded);
+    }
+
+    std::string journal;
+    if (!readFile(journalPath_, journal) || journal.size() < JOURNAL_HEADER_SIZE ||
+        std::memcmp(journal.data(), JOURNAL_MAGIC, 4) != 0 ||
+        (uint8_t)journal[4] != sizeof(wchar_t) ||
+        getLE(journal.data() + 8, 8) != checkpointBytes ||
+        getLE(journal.data() + 16, 8) != checkpointHash) {
+        // 沒有日誌、日誌損壞，或屬於較舊的檢查點（檢查點已包含其內容）
+        return;
+    }
+
+    size_t pos = JOURNAL_HEADER_SIZE;
+    while (pos < journal.size()) {
+        size_t remaining = journal.size() - pos;
+        if (remaining < RECORD_HEAD_SIZE + RECORD_CHECK_SIZE) break;
+
+        const char* record = journal.data() + pos;
+        Op op;
+        op.kind = (Op::Kind)(uint8_t)record[0];
+        op.pos = (size_t)getLE(record + 1, 4);
+        op.count = (size_t)getLE(record + 5, 4);
+
+        bool hasText = (op.kind == Op::INSERT || op.kind == Op::RESET);
+        size_t textBytes = hasText ? op.count * sizeof(wchar_t) : 0;
+        if (hasText && op.count > (remaining - RECORD_HEAD_SIZE - RECORD_CHECK_SIZE) / sizeof(wchar_t)) break;
+
+        size_t bodySize = RECORD_HEAD_SIZE + textBytes;
+        if (getLE(record + bodySize, 4) != fnv32(record, bodySize)) break;
+
+        if (hasText) {
+            op.text.resize(op.count);
+            for (size_t i = 0; i < op.count; i++) {
+                op.text[i] = (wchar_t)getLE(record + RECORD_HEAD_SIZE + i * sizeof(wchar_t), sizeof(wchar_t));
+            }
+        }
+        if (!applyOp(text, op)) break;
+
+        result.replayed++;
+        pos += bodySize + RECORD_CHECK_SIZE;
+    }
+
+    result.found = result.found || result.replayed > 0;
+    result.truncated = pos < journal.size();
+    result.clean = hasCheckpoint && result.replayed == 0 && !result.truncated;
+}
+
+bool EditJournal::applyOp(TextModel& text, const Op& op) const {
+    switch (op.kind) {
+        case Op::INSERT:
+            if (op.pos > text.length()) return false;
+            text.insert(op.pos, op.text);
+            return true;
+        case Op::ERASE:
+            if (op.pos > text.length() || op.count > text.length() - op.pos) return false;
+            text.erase(op.pos, op.count);
+            return true;
+        case Op::RESET:
+            text = op.text;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void EditJournal::encodeOp(std::string& out, const Op& op) const {
+    size_t start = out.size();
+    out.push_back((char)op.kind);
+    putU32(out, (uint32_t)op.pos);
+    putU32(out, (uint32_t)op.count);
+    if (op.kind == Op::INSERT || op.kind == Op::RESET) {
+        for (size_t i = 0; i < op.text.size(); i++) {
+            uint32_t unit = (uint32_t)op.text[i];
+            for (size_t b = 0; b < sizeof(wchar_t); b++) out.push_back((char)((unit >> (8 * b)) & 0xFF));
+        }
+    }
+    putU32(out, fnv32(out.data() + start, out.size() - start));
+}
+
+// ===== 檢查點 =====
+
+bool EditJournal::writeCheckpointFile(const TextModel& text) {
+    std::string tempPath = checkpointPath_ + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+
+    uint64_t hash = FileIO::FNV64_OFFSET;
+    uint64_t size = 0;
+    bool ok = BufferFile::write(file, text, true, BufferFile::Progress(),
+        [&](const char* data, size_t count) {
+            hash = FileIO::fnv64(data, count, hash);
+            size += count;
+        }) == BufferFile::OK;
+
+    // 確保資料已寫到磁碟，並以原子方式取代檔案
+    if (!FileIO::commitFile(file, tempPath, checkpointPath_, ok)) return false;
+
+    baseBytes_ = size;
+    baseHash_ = hash;
+    bytesWritten_ += size;
+    checkpointCount_++;
+    return true;
+}
+
+// 檢查點已取代後才重設日誌：中途中斷時舊日誌的檔頭與新檢查點不符，恢復時會被忽略
+bool EditJournal::resetJournal() {
+    if (journal_) std::fclose(journal_);
+    journal_ = std::fopen(journalPath_.c_str(), "wb");
+    if (!journal_) return false;
+
+    std::string header(JOURNAL_MAGIC, 4);
+    header.push_back((char)sizeof(wchar_t));
+    header.append(3, '\0');
+    putU64(header, baseBytes_);
+    putU64(header, baseHash_);
+    std::fwrite(header.data(), 1, header.size(), journal_);
+    std::fflush(journal_);
+
+    journalBytes_ = header.size();
+    bytesWritten_ += header.size();
+    return true;
+}
+
+// ===== 啟動與停止 =====
+
+bool EditJournal::start(const TextModel& text, bool writeCheckpoint) {
+    stop();
+    shadow_ = text;
+
+    bool ready = false;
+    if (!writeCheckpoint) {
+        journal_ = std::fopen(journalPath_.c_str(), "ab");
+        if (journal_) {
+            std::fseek(journal_, 0, SEEK_END);
+            journalBytes_ = (uint64_t)std::ftell(journal_);
+            ready = true;
+        }
+    }
+    if (!ready) {
+        ready = writeCheckpointFile(shadow_) && resetJournal();
+    }
+    if (!ready) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    enqueued_ = written_ = 0;
+    checkpointRequested_ = false;
+    stopping_ = false;
+    running_ = true;
+    worker_ = std::thread(&EditJournal::workerLoop, this);
+    return true;
+}
+
+void EditJournal::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+
+    if (journal_) {
+        std::fclose(journal_);
+        journal_ = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    stopping_ = false;
+    pending_.clear();
+    exports_.clear();
+    done_.notify_all();
+}
+
+void EditJournal::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = enqueued_;
+    done_.wait(lock, [&] { return written_ >= target || !running_ || stopping_; });
+}
+
+void EditJournal::checkpoint() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) return;
+    uint64_t target = checkpointsDone_ + 1;
+    checkpointRequested_ = true;
+    wake_.notify_all();
+    done_.wait(lock, [&] { return checkpointsDone_ >= target || !running_ || stopping_; });
+}
+
+bool EditJournal::exportCopy(const std::string& path, const BufferFile::Progress& progress, const ExportDone& done) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || stopping_) return false;
+        ExportRequest request;
+        request.path = path;
+        request.progress = progress;
+        request.done = done;
+        exports_.push_back(std::move(request));
+    }
+    wake_.notify_all();
+    return true;
+}
+
+// ===== 記錄 =====
+
+void EditJournal::enqueue(Op& op) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || stopping_) return;
+        pending_.push_back(std::move(op));
+        enqueued_++;
+    }
+    wake_.notify_all();
+}
+
+void EditJournal::onInsert(size_t pos, const wchar_t* data, size_t count) {
+    Op op;
+    op.kind = Op::INSERT;
+    op.pos = pos;
+    op.count = count;
+    op.text.assign(data, count);
+    enqueue(op);
+}
+
+void EditJournal::onErase(size_t pos, size_t count) {
+    Op op;
+    op.kind = Op::ERASE;
+    op.pos = pos;
+    op.count = count;
+    enqueue(op);
+}
+
+void EditJournal::onReset(const TextModel& model) {
+    Op op;
+    op.kind = Op::RESET;
+    op.pos = 0;
+    op.text = model.str();
+    op.count = op.text.size();
+    enqueue(op);
+}
+
+void EditJournal::workerLoop() {
+    std::deque<Op> batch;
+    std::deque<ExportRequest> exports;
+    std::string buffer;
+
+    for (;;) {
+        uint64_t target;
+        bool stop;
+        bool requested;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] {
+                return !pending_.empty() || !exports_.empty() || checkpointRequested_ || stopping_;
+            });
+            batch.swap(pending_);
+            exports.swap(exports_);
+            target = enqueued_;
+            stop = stopping_;
+            requested = checkpointRequested_;
+            checkpointRequested_ = false;
+        }
+
+        // 影子文字與日誌同步前進；記錄在呼叫端修改完成後才送來，順序與實際編輯相同
+        buffer.clear();
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (applyOp(shadow_, batch[i])) encodeOp(buffer, batch[i]);
+        }
+        batch.clear();
+
+        if (!buffer.empty() && journal_) {
+            std::fwrite(buffer.data(), 1, buffer.size(), journal_);
+            std::fflush(journal_);
+            journalBytes_ += buffer.size();
+            bytesWritten_ += buffer.size();
+        }
+
+        // 另存：要求之前送出的編輯都已套用到影子文字
+        for (size_t i = 0; i < exports.size(); i++) {
+            BufferFile::Status status = BufferFile::save(exports[i].path, shadow_, exports[i].progress);
+            if (exports[i].done) exports[i].done(status);
+        }
+        exports.clear();
+
+        // 日誌累積到與文件大小相當時寫出檢查點，使每次編輯攤提的寫入量維持 O(編輯大小)
+        uint64_t records = journalBytes_ > JOURNAL_HEADER_SIZE ? journalBytes_ - JOURNAL_HEADER_SIZE : 0;
+        uint64_t threshold = std::max<uint64_t>(minCheckpointBytes_, shadow_.length() * sizeof(wchar_t));
+        if (requested || records >= threshold || (stop && records > 0) || !journal_) {
+            if (writeCheckpointFile(shadow_)) resetJournal();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            written_ = target;
+            if (requested) checkpointsDone_++;
+            done_.notify_all();
+            if (stop && pending_.empty()) break;
+        }
+    }
+}
@@ -0,0 +1,131 @@
+// edit_journal.h - 暫放區的編輯日誌與檢查點：當機後可恢復到最後一次按鍵（可攜式）
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include "text_model.h"
+#include "buffer_file.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 存檔分成兩部分：
+// - 檢查點：完整文字（UTF-8 含 BOM，與原本的 text_buffer.txt 格式相同）
+// - 日誌：檢查點之後的每筆編輯，以二進位記錄附加在檔尾，寫入量與編輯大小成正比
+// 日誌檔頭記錄對應檢查點的大小與雜湊；檢查點換新後舊日誌自動失效，不會重複套用
+// 每筆記錄帶校驗碼，寫到一半被中斷的記錄在恢復時捨棄
+//
+// 背景執行緒負責寫入：它維護一份影子文字並依序套用記錄，
+// 日誌累積到與文件大小相當時由影子文字寫出新檢查點（先寫暫存檔再取代），
+// 因此檢查點的成本攤提到每次編輯仍為 O(編輯大小)，且不需在介面執行緒複製整份文字
+class EditJournal : public TextModel::Observer {
+public:
+    // 恢復結果
+    struct Recovery {
+        bool found;             // 找到檢查點或可用的日誌
+        TextModel text;
+        size_t replayed;        // 套用的日誌記錄數
+        bool truncated;         // 日誌結尾有不完整或損壞的記錄（已捨棄）
+        bool clean;             // 日誌屬於此檢查點且沒有任何記錄，可直接繼續附加
+        bool unreadable;        // 檢查點存在但讀取失敗或被取消（不可以空白內容覆寫）
+        Recovery() : found(false), replayed(0), truncated(false), clean(false), unreadable(false) {}
+    };
+
+    static const size_t DEFAULT_MIN_CHECKPOINT_BYTES = 256 * 1024;
+
+    EditJournal(const std::string& checkpointPath, const std::string& journalPath,
+                size_t minCheckpointBytes = DEFAULT_MIN_CHECKPOINT_BYTES);
+    ~EditJournal();
+
+    // 由檢查點加日誌恢復文字（不需先 start）；檢查點分段讀取，progress 回報讀取進度
+    // 結果以參數傳回，大份文字不經過複製
+    void recover(Recovery& result, const BufferFile::Progress& progress = BufferFile::Progress()) const;
+
+    // 以 text 為起點開始記錄；writeCheckpoint 為 true 時先同步寫出檢查點並重設日誌
+    // （恢復時套用過日誌或日誌不可用時需要），否則沿用現有日誌繼續附加
+    bool start(const TextModel& text, bool writeCheckpoint);
+    // 寫完所有待寫記錄並寫出最終檢查點後停止
+    void stop();
+    bool running() const { return running_; }
+
+    // 等待目前為止的記錄都已寫入檔案
+    void flush();
+    // 要求背景執行緒寫出檢查點（寫完才返回）
+    void checkpoint();
+
+    // 由背景執行緒把目前文字（含之前送出的所有編輯）另存到 path，不佔用介面執行緒也不複製文字
+    // progress 與 done 都在背景執行緒呼叫；未啟動時回傳 false
+    typedef std::function<void(BufferFile::Status status)> ExportDone;
+    bool exportCopy(const std::string& path, const BufferFile::Progress& progress, const ExportDone& done);
+
+    // TextModel::Observer
+    void onInsert(size_t pos, const wchar_t* data, size_t count) override;
+    void onErase(size_t pos, size_t count) override;
+    void onReset(const TextModel& model) override;
+
+    // 統計用
+    uint64_t bytesWritten() const { return bytesWritten_; }    // 日誌與檢查點合計寫入的位元組
+    uint64_t journalBytes() const { return journalBytes_; }    // 目前日誌大小
+    unsigned checkpointCount() const { return checkpointCount_; }
+
+private:
+    struct ExportRequest {
+        std::string path;
+        BufferFile::Progress progress;
+        ExportDone done;
+    };
+
+    struct Op {
+        enum Kind { INSERT = 1, ERASE = 2, RESET = 3 };
+        Kind kind;
+        size_t pos;
+        size_t count;
+        std::wstring text;
+    };
+
+    EditJournal(const EditJournal&);
+    EditJournal& operator=(const EditJournal&);
+
+    void enqueue(Op& op);
+    void workerLoop();
+    bool writeCheckpointFile(const TextModel& text);
+    bool resetJournal();
+    bool applyOp(TextModel& text, const Op& op) const;
+    void encodeOp(std::string& out, const Op& op) const;
+
+    std::string checkpointPath_;
+    std::string journalPath_;
+    size_t minCheckpointBytes_;
+
+    // 檢查點檔案的大小與雜湊（寫入日誌檔頭）
+    uint64_t baseBytes_;
+    uint64_t baseHash_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::deque<Op> pending_;
+    std::deque<ExportRequest> exports_;
+    uint64_t enqueued_;
+    uint64_t written_;
+    bool checkpointRequested_;
+    uint64_t checkpointsDone_;      // 已完成的要求檢查點次數
+    std::atomic<unsigned> checkpointCount_;
+    bool stopping_;
+    bool running_;
+    std::thread worker_;
+
+    // 以下只由背景執行緒存取（啟動前與結束後由呼叫端存取）
+    TextModel shadow_;
+    FILE* journal_;
+    std::atomic<uint64_t> journalBytes_;
+    std::atomic<uint64_t> bytesWritten_;
+};
+
+#endif // EDIT_JOURNAL_H
@@ -0,0 +1,410 @@
+// engine_core.cpp - 輸入法引擎核心實作
+#include "engine_core.h"
+#include <algorithm>
+
+namespace EngineCore {
+
+static bool isCodeChar(wchar_t ch) {
+    return ch == L'u' || ch == L'i' || ch == L'o' || ch == L'j' || ch == L'k' || ch == L'*';
+}
+
+bool validateInput(const std::wstring& input) {
+    for (wchar_t ch : input) {
+        if (!isCodeChar(ch)) return false;
+    }
+    return true;
+}
+
+bool enhancedValidateInput(const std::wstring& input) {
+    if (input.empty()) return true;
+    if (input.length() > 30) return false;  // 防止過長輸入
+    for (wchar_t ch : input) {
+        if (isCodeChar(ch)) return true;
+    }
+    return false;
+}
+
+std::wstring filterValidChars(const std::wstring& input) {
+    std::wstring filtered;
+    for (wchar_t ch : input) {
+        if (isCodeChar(ch)) filtered += ch;
+    }
+    return filtered;
+}
+
+bool wildcardMatch(const std::wstring& pattern, const std::wstring& text) {
+    int pLen = pattern.length();
+    int tLen = text.length();
+
+    std::vector<std::vector<bool>> dp(tLen + 1, std::vector<bool>(pLen + 1, false));
+
+    dp[0][0] = true;
+
+    for (int j = 1; j <= pLen; j++) {
+        if (pattern[j-1] == L'*') {
+            dp[0][j] = dp[0][j-1];
+        }
+    }
+
+    for (int i = 1; i <= tLen; i++) {
+        for (int j = 1; j <= pLen; j++) {
+            if (pattern[j-1] == L'*') {
+                dp[i][j] = dp[i-1][j] || dp[i][j-1];
+            } else if (pattern[j-1] == text[i-1]) {
+                dp[i][j] = dp[i-1][j-1];
+            }
+        }
+    }
+
+    return dp[tLen][pLen];
+}
+
+bool isPunctuation(const std::wstring& word) {
+    if (word.empty()) return false;
+
+    std::wstring punctuations = L"，。？！：；（）「」『』《》〈〉【】：—……\"\"''｜＼－～＿￥％＃＄［］"
+                               L",.?!:;()[]{}\\'\"'<>/\\-_@#$%^&*+=|`~"
+                               L"　";
+
+    for (wchar_t ch : word) {
+        if (ch == L' ' || ch == L'\t' || ch == L'\n' || ch == L'\r' || ch == L'　') {
+            continue;
+        }
+        if (punctuations.find(ch) == std::wstring::npos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double timeWeight(time_t lastUsed, time_t now) {
+    double daysDiff = difftime(now, lastUsed) / (24 * 3600);
+    if (daysDiff <= 1) return 1.0;
+    if (daysDiff <= 7) return 0.8;
+    if (daysDiff <= 30) return 0.6;
+    if (daysDiff <= 90) return 0.4;
+    return 0.2;
+}
+
+// 上一個選擇的字之後常接的字；沒有時回傳空指標
+static const std::vector<std::wstring>* lastContext(const Learning& learning) {
+    if (learning.lastSelected.empty()) return nullptr;
+    std::map<std::wstring, std::vector<std::wstring>>::const_iterator context =
+        learning.contextLearning.find(learning.lastSelected);
+    return context == learning.contextLearning.end() ? nullptr : &context->second;
+}
+
+static double scoreWith(const Learning& learning, const std::vector<std::wstring>* context,
+                        const std::wstring& word, const std::wstring& code, time_t now) {
+    double score = (10.0 - code.length()) * 2.0;
+    std::map<std::wstring, WordInfo>::const_iterator freq = learning.wordFreq.find(word);
+    if (freq != learning.wordFreq.end()) {
+        const WordInfo& info = freq->second;
+        double freqScore = info.frequency * 1.0;
+        double permanentBonus = info.isPermanent ? 5.0 : 0.0;
+        score += (freqScore * timeWeight(info.lastUsed, now)) + permanentBonus;
+    }
+    if (context && std::find(context->begin(), context->end(), word) != context->end()) {
+        score += 3.0;
+    }
+    return score;
+}
+
+double wordScore(const Learning& learning, const std::wstring& word, const std::wstring& code, time_t now) {
+    return scoreWith(learning, lastContext(learning), word, code, now);
+}
+
+void rankCandidates(const Learning& learning, Session& session, time_t now) {
+    struct Scored {
+        double score;
+        size_t index;
+    };
+    const std::vector<std::wstring>* context = lastContext(learning);
+    std::vector<Scored> order(session.candidates.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i].score = scoreWith(learning, context, session.candidates[i], session.candidateCodes[i], now);
+        order[i].index = i;
+    }
+    std::sort(order.begin(), order.end(), [](const Scored& a, const Scored& b) {
+        return a.score > b.score;
+    });
+
+    std::vector<std::wstring> candidates, codes;
+    candidates.reserve(order.size());
+    codes.reserve(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        candidates.push_back(std::move(session.candidates[order[i].index]));
+        codes.push_back(std::move(session.candidateCodes[order[i].index]));
+    }
+    session.candidates.swap(candidates);
+    session.candidateCodes.swap(codes);
+}
+
+// 萬用字元查詢：所有符合 pattern 的字碼
+static void addWildcardMatches(const DictImage::Table& table, const std::wstring& pattern, Session& session) {
+    std::wstring code;  // 重複使用同一個緩衝區，掃描時不配置記憶體
+    for (size_t i = 0; i < table.size(); i++) {
+        DictImage::Text key = table.key(i);
+        code.assign(key.data, key.size);
+        if (wildcardMatch(pattern, code)) {
+            for (size_t j = 0; j < table.valueCount(i); j++) {
+                session.candidates.push_back(table.value(i, j).str());
+                session.candidateCodes.push_back(code);
+            }
+        }
+    }
+}
+
+Lookup lookup(const Model& model, const Learning& learning, Session& session) {
+    Lookup result;
+    session.candidates.clear();
+    session.candidateCodes.clear();
+    if (session.input.empty()) {
+        finishLookup(session, result);
+        return result;
+    }
+
+    result.code = filterValidChars(session.input);
+    if (!enhancedValidateInput(session.input) || result.code.empty()) {
+        result.status = enhancedValidateInput(session.input) ? LOOKUP_NO_CODE : LOOKUP_INVALID;
+        finishLookup(session, result);
+        return result;
+    }
+
+    // 整次查詢使用同一個快照：字典在查詢中被換上新版也不影響這次的結果
+    DictModel::SnapshotPtr dict = model.dict.pin();
+    const DictImage::Table& table = dict->table();
+    const std::wstring& code = result.code;
+    result.status = LOOKUP_OK;
+    result.wildcard = code.find(L'*') != std::wstring::npos;
+    if (result.wildcard) {
+        addWildcardMatches(table, code, session);
+    } else {
+        size_t exact = dict->find(code);
+        if (exact != DictImage::NOT_FOUND) {
+            for (size_t j = 0; j < table.valueCount(exact); j++) {
+                session.candidates.push_back(table.value(exact, j).str());
+                session.candidateCodes.push_back(code);
+            }
+        }
+
+        // 前綴匹配：字碼表依字碼排序，以該字碼開頭的字碼緊接在它之後
+        int prefixMatchCount = 0;
+        const int MAX_PREFIX_MATCHES = 50;
+        for (size_t i = table.upperBound(code); i < table.size() && prefixMatchCount < MAX_PREFIX_MATCHES; i++) {
+            DictImage::Text key = table.key(i);
+            if (!key.startsWith(code)) break;
+            for (size_t j = 0; j < table.valueCount(i); j++) {
+                std::wstring character = table.value(i, j).str();
+                if (std::find(session.candidates.begin(), session.candidates.end(), character) == session.candidates.end()) {
+                    session.candidates.push_back(character);
+                    session.candidateCodes.push_back(key.str());
+                    prefixMatchCount++;
+                    if (prefixMatchCount >= MAX_PREFIX_MATCHES) break;
+                }
+            }
+        }
+
+        // 自動(3+3)搜尋
+        if (code.length() > 8 && session.candidates.empty()) {
+            std::wstring first3 = code.substr(0, 3);
+            std::wstring last3 = code.substr(code.length() - 3);
+            addWildcardMatches(table, first3 + L"*" + last3, session);
+        }
+    }
+
+    rankCandidates(learning, session, time(nullptr));
+    finishLookup(session, result);
+    return result;
+}
+
+void finishLookup(Session& session, const Lookup& lookup) {
+    session.selected = 0;
+    session.currentPage = 0;
+    // 沒有輸入時結束輸入狀態；字碼無效或沒有候選字時都保持輸入狀態，讓使用者修改
+    session.isInputting = lookup.status != LOOKUP_EMPTY;
+    session.inputError = lookup.status == LOOKUP_INVALID || lookup.status == LOOKUP_NO_CODE;
+    session.showCand = lookup.status == LOOKUP_OK && !session.candidates.empty();
+    if (lookup.status == LOOKUP_OK) {
+        session.totalPages = (session.candidates.size() + CANDIDATES_PER_PAGE - 1) / CANDIDATES_PER_PAGE;
+    }
+}
+
+bool changePage(Session& session, int direction) {
+    if (direction > 0 && session.currentPage < session.totalPages - 1) {
+        session.currentPage++;
+    } else if (direction < 0 && session.currentPage > 0) {
+        session.currentPage--;
+    } else {
+        return false;
+    }
+    session.selected = 0;
+    return true;
+}
+
+void endInput(Session& session) {
+    session.input.clear();
+    session.candidates.clear();
+    session.candidateCodes.clear();
+    session.showCand = false;
+    session.isInputting = false;
+    session.inputError = false;
+    session.showPunctMenu = false;
+}
+
+LearnOutcome learn(Learning& learning, const std::wstring& word, time_t now) {
+    if (word.empty() || isPunctuation(word)) return LEARN_IGNORED;
+
+    LearnOutcome outcome = LEARN_REPEAT;
+    learning.learnedWords.insert(word);
+    std::map<std::wstring, WordInfo>::iterator freq = learning.wordFreq.find(word);
+    if (freq == learning.wordFreq.end()) {
+        WordInfo info = {1, now, 1, false};
+        learning.wordFreq[word] = info;
+        outcome = LEARN_NEW;
+    } else {
+        WordInfo& info = freq->second;
+        info.frequency++;
+        info.lastUsed = now;
+        if (!info.isPermanent) {
+            info.tempCount++;
+            if (info.tempCount >= 3) {
+                info.isPermanent = true;
+                outcome = LEARN_PERMANENT;
+            } else {
+                outcome = LEARN_PROGRESS;
+            }
+        }
+    }
+
+    if (!learning.lastSelected.empty() && learning.lastSelected != word) {
+        std::vector<std::wstring>& context = learning.contextLearning[learning.lastSelected];
+        context.push_back(word);
+        if (context.size() > 10) context.erase(context.begin());
+    }
+    learning.lastSelected = word;
+    return outcome;
+}
+
+void loadLearning(Learning& learning, const DictFiles::UserEntries& entries, time_t now) {
+    learning.wordFreq.clear();
+    learning.learnedWords.clear();
+    for (size_t i = 0; i < entries.size(); i++) {
+        int freq = entries[i].frequency;
+        WordInfo info = {freq, now, std::max(3, freq), freq >= 3};
+        learning.wordFreq[entries[i].word] = info;
+    }
+}
+
+// 加入聯想字：字典中有這個字時以字碼標示，沒有時以 label 標示
+static void addPrediction(Session& session, const DictModel::Snapshot& dict, const std::wstring& word,
+                          const wchar_t* label) {
+    session.candidates.push_back(word);
+    DictImage::Text code = dict.codeOf(word);
+    session.candidateCodes.push_back(code.data ? code.str() : std::wstring(label));
+}
+
+static bool hasCandidate(const Session& session, const std::wstring& word) {
+    return std::find(session.candidates.begin(), session.candidates.end(), word) != session.candidates.end();
+}
+
+void predict(const Model& model, const Learning& learning, Session& session, const std::wstring& word) {
+    session.candidates.clear();
+    session.candidateCodes.clear();
+
+    if (word.empty()) return;
+    DictModel::SnapshotPtr dict = model.dict.pin();
+
+    // 0. 從詞語庫中獲取聯想字（最高優先級，如果詞語庫存在）
+    if (model.wordPhrases.entryCount() > 0) {
+        const DictImage::Table& phrases = model.wordPhrases.table();
+        size_t index = phrases.find(word);
+        if (index != DictImage::NOT_FOUND) {
+            for (size_t j = 0; j < phrases.valueCount(index); j++) {
+                std::wstring phraseChar = phrases.value(index, j).str();
+                if (!hasCandidate(session, phraseChar)) addPrediction(session, *dict, phraseChar, L"詞語");
+            }
+        }
+    }
+
+    // 1. 從上下文學習中獲取聯想字（優先級次高）
+    std::map<std::wstring, std::vector<std::wstring>>::const_iterator context = learning.contextLearning.find(word);
+    if (context != learning.contextLearning.end()) {
+        for (const auto& contextWord : context->second) {
+            if (!hasCandidate(session, contextWord)) addPrediction(session, *dict, contextWord, L"聯想");
+        }
+    }
+
+    // 2. 從字典中查找常見的詞語組合（支持2字詞和3字詞）
+    std::map<std::wstring, int> wordScores;  // 字 -> 分數
+    // 詞頻加權：2字詞優先於3字詞
+    auto phraseScore = [&learning](const std::wstring& dictWord) {
+        std::map<std::wstring, WordInfo>::const_iterator freq = learning.wordFreq.find(dictWord);
+        int score = freq != learning.wordFreq.end() ? freq->second.frequency * 2 : 1;
+        if (dictWord.length() == 2) score += 5;
+        return score;
+    };
+    auto addScore = [&wordScores](const std::wstring& ch, int score) {
+        std::map<std::wstring, int>::iterator it = wordScores.find(ch);
+        if (it == wordScores.end() || it->second < score) wordScores[ch] = score;
+    };
+
+    const DictImage::Table& table = dict->table();
+    for (size_t k = 0; k < table.size(); k++) {
+        for (size_t j = 0; j < table.valueCount(k); j++) {
+            DictImage::Text text = table.value(k, j);
+            if (text.size <= 1) continue;
+            bool starts = text.data[0] == word[0];
+            bool ends = text.data[text.size - 1] == word[0];
+            if (!starts && !ends) continue;
+            std::wstring dictWord = text.str();
+            // 字典中的詞以選中的字開頭：提取後續字
+            if (starts) {
+                for (size_t i = 1; i < dictWord.length() && i <= 2; i++) {
+                    addScore(dictWord.substr(i, 1), phraseScore(dictWord));
+                }
+            }
+            // 字典中的詞以選中的字結尾：提取前面的字
+            if (ends) {
+                for (size_t i = 0; i < dictWord.length() - 1 && i < 2; i++) {
+                    addScore(dictWord.substr(i, 1), phraseScore(dictWord));
+                }
+            }
+        }
+    }
+
+    // 按分數排序並添加到候選列表
+    std::vector<std::pair<std::wstring, int>> sortedWords;
+    for (const auto& pair : wordScores) {
+        if (!hasCandidate(session, pair.first)) sortedWords.push_back(pair);
+    }
+    std::sort(sortedWords.begin(), sortedWords.end(),
+        [](const std::pair<std::wstring, int>& a, const std::pair<std::wstring, int>& b) {
+            return a.second > b.second;
+        });
+
+    // 限制聯想字數量（最多20個）
+    const size_t maxPredictions = 20;
+    for (size_t i = 0; i < sortedWords.size() && session.candidates.size() < maxPredictions; i++) {
+        addPrediction(session, *dict, sortedWords[i].first, L"聯想");
+    }
+
+    // 3. 如果候選字太少，補上詞頻較高的常用字
+    if (session.candidates.size() < 5) {
+        std::vector<std::pair<std::wstring, int>> freqWords;
+        for (const auto& pair : learning.wordFreq) {
+            if (pair.first.length() == 1 && !hasCandidate(session, pair.first)) {
+                freqWords.push_back(std::make_pair(pair.first, pair.second.frequency));
+            }
+        }
+        std::sort(freqWords.begin(), freqWords.end(),
+            [](const std::pair<std::wstring, int>& a, const std::pair<std::wstring, int>& b) {
+                return a.second > b.second;
+            });
+        for (size_t i = 0; i < freqWords.size() && session.candidates.size() < maxPredictions; i++) {
+            addPrediction(session, *dict, freqWords[i].first, L"常用");
+        }
+    }
+}
+
+}
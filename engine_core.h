@@ -0,0 +1,111 @@
+// engine_core.h - 輸入法引擎核心：字典模型、排序、學習、聯想與輸入狀態（可攜式，不依賴 Windows API）
+#ifndef ENGINE_CORE_H
+#define ENGINE_CORE_H
+
+#include "dict_files.h"
+#include "dict_model.h"
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// 引擎的狀態分成三部分，介面程式（Win32 前端、命令列工具）只負責顯示與送出文字：
+// - Model：字典資料，多個輸入工作階段共用，查詢時只讀取
+// - Learning：使用者的詞頻與上下文學習（每位使用者一份）
+// - Session：一次輸入的字碼與候選字（每個工作階段一份）
+// 函式只接收需要的部分；Model 的字碼表以快照查詢，可在任何執行緒換上新版，
+// 其餘欄位只在沒有查詢進行時修改（例如介面執行緒換上重新載入的資料）
+namespace EngineCore {
+    const int CANDIDATES_PER_PAGE = 9;
+
+    // 詞頻資訊
+    struct WordInfo {
+        int frequency;
+        time_t lastUsed;
+        int tempCount;
+        bool isPermanent;
+    };
+
+    struct Model {
+        DictModel::Model dict;  // 字碼表：以 dict.pin() 取得快照查詢（字數為快照的 entryCount）
+        std::map<std::wstring, std::vector<std::wstring>> punct;
+        std::vector<std::wstring> punctCandidates;  // 標點選單
+        // 詞語庫資料（用於聯想字功能，大小為 wordPhrases.entryCount()）
+        // 格式：第一個字 -> 後續可能的字列表（按頻率排序）
+        DictModel::Phrases wordPhrases;
+    };
+
+    struct Learning {
+        std::map<std::wstring, WordInfo> wordFreq;
+        std::set<std::wstring> learnedWords;  // 上次載入用戶字典後學習過的詞（重新載入時保留）
+        std::map<std::wstring, std::vector<std::wstring>> contextLearning;
+        std::wstring lastSelected = L"";
+    };
+
+    struct Session {
+        std::wstring input = L"";
+        std::vector<std::wstring> candidates;
+        std::vector<std::wstring> candidateCodes;
+        int selected = 0;
+        int currentPage = 0;
+        int totalPages = 0;
+        bool showCand = false;
+        bool isInputting = false;
+        bool inputError = false;
+        bool showPunctMenu = false;
+    };
+
+    // 輸入驗證
+    bool validateInput(const std::wstring& input);
+    bool enhancedValidateInput(const std::wstring& input);
+    std::wstring filterValidChars(const std::wstring& input);
+    // 萬用字元匹配（* 可代表任意多個字碼）
+    bool wildcardMatch(const std::wstring& pattern, const std::wstring& text);
+    bool isPunctuation(const std::wstring& word);
+
+    // 排序
+    double timeWeight(time_t lastUsed, time_t now);
+    double wordScore(const Learning& learning, const std::wstring& word, const std::wstring& code, time_t now);
+    // 依分數排序候選字（分數只計算一次）
+    void rankCandidates(const Learning& learning, Session& session, time_t now);
+
+    // 依 session.input 查詢並排序候選字
+    enum LookupStatus {
+        LOOKUP_EMPTY,           // 沒有輸入：結束輸入狀態
+        LOOKUP_INVALID,         // 字碼過長或沒有有效字元
+        LOOKUP_NO_CODE,         // 過濾後沒有有效字碼
+        LOOKUP_OK               // 已查詢（候選字可能為空）
+    };
+    struct Lookup {
+        LookupStatus status;
+        std::wstring code;      // 過濾後的字碼
+        bool wildcard;
+        Lookup() : status(LOOKUP_EMPTY), wildcard(false) {}
+    };
+    Lookup lookup(const Model& model, const Learning& learning, Session& session);
+    // 候選字已放入 session 之後，依查詢結果設定選擇、頁數與輸入狀態（lookup 最後也呼叫這裡）
+    void finishLookup(Session& session, const Lookup& lookup);
+
+    // 候選字翻頁；頁數有變更時回傳 true
+    bool changePage(Session& session, int direction);
+    // 結束輸入：清除字碼與候選字
+    void endInput(Session& session);
+
+    // 學習選擇的字詞
+    enum LearnOutcome {
+        LEARN_IGNORED,          // 空字串或標點符號
+        LEARN_NEW,              // 第一次選擇（暫存）
+        LEARN_PROGRESS,         // 暫存詞再次選擇（次數見 wordFreq 的 tempCount）
+        LEARN_PERMANENT,        // 這次選擇後成為永久詞
+        LEARN_REPEAT            // 已是永久詞
+    };
+    LearnOutcome learn(Learning& learning, const std::wstring& word, time_t now);
+    // 以用戶字典的記錄取代詞頻（頻率 3 以上為永久詞）
+    void loadLearning(Learning& learning, const DictFiles::UserEntries& entries, time_t now);
+
+    // 選擇 word 之後的聯想字（詞語庫、上下文學習、字典中的詞語、常用字），放入 session 的候選字
+    void predict(const Model& model, const Learning& learning, Session& session, const std::wstring& word);
+}
+
+#endif // ENGINE_CORE_H
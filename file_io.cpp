@@ -0,0 +1,50 @@
+// file_io.cpp - 共用檔案工具實作
+#include "file_io.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace FileIO {
+
+static const uint64_t FNV64_PRIME = 1099511628211ull;
+
+uint64_t fnv64(const void* data, size_t size, uint64_t hash) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+#ifdef _WIN32
+static bool syncFile(FILE* file) {
+    return _commit(_fileno(file)) == 0;
+}
+
+static bool replaceFile(const std::string& from, const std::string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+#else
+static bool syncFile(FILE* file) {
+    return fsync(fileno(file)) == 0;
+}
+
+static bool replaceFile(const std::string& from, const std::string& to) {
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+#endif
+
+bool commitFile(FILE* file, const std::string& tempPath, const std::string& path, bool ok) {
+    if (ok && (std::fflush(file) != 0 || !syncFile(file))) ok = false;
+    if (std::fclose(file) != 0) ok = false;
+    if (ok && replaceFile(tempPath, path)) return true;
+    std::remove(tempPath.c_str());
+    return false;
+}
+
+}
@@ -0,0 +1,25 @@
+// file_io.h - 共用的檔案工具：以暫存檔原子取代檔案、FNV-1a 雜湊（可攜式，不依賴 Windows API 的介面）
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace FileIO {
+    // FNV-1a 64 位元：用於校驗碼與內容變更的偵測（不是密碼學雜湊）
+    const uint64_t FNV64_OFFSET = 14695981039346656037ull;
+
+    // 以 hash 為起始值累加 data 的位元組；分段呼叫的結果與一次計算相同
+    uint64_t fnv64(const void* data, size_t size, uint64_t hash = FNV64_OFFSET);
+    inline uint64_t fnv64(const std::string& data) { return fnv64(data.data(), data.size()); }
+
+    // 完成以暫存檔取代 path 的寫入：fflush 並確保資料已寫到磁碟（fsync / _commit）、關閉 file，
+    // 再以 rename（Windows 為 MoveFileEx 加 MOVEFILE_WRITE_THROUGH）取代 path。
+    // ok 為 false（呼叫端寫入失敗）或任一步失敗時刪除暫存檔並回傳 false；file 一律被關閉。
+    // 取代只換目錄項目：已開啟或對映舊檔的程序繼續讀到舊的內容（Windows 上舊檔被對映時取代會失敗）
+    bool commitFile(FILE* file, const std::string& tempPath, const std::string& path, bool ok = true);
+}
+
+#endif // FILE_IO_H
@@ -0,0 +1,91 @@
+// focus_tracker.cpp - 文字輸出前的焦點/可見性狀態機實作
+#include "focus_tracker.h"
+
+namespace FocusTracker {
+
+FocusStateMachine::FocusStateMachine(FocusEnvironment& env, unsigned timeoutMs)
+    : env_(env), timeoutMs_(timeoutMs), state_(STATE_IDLE),
+      hidBuffer_(false), timeoutArmed_(false), timeouts_(0) {}
+
+const char* FocusStateMachine::stateName(State state) {
+    switch (state) {
+        case STATE_IDLE: return "IDLE";
+        case STATE_WAIT_HIDDEN: return "WAIT_HIDDEN";
+        case STATE_WAIT_FOCUS: return "WAIT_FOCUS";
+        case STATE_OUTPUT: return "OUTPUT";
+        default: return "UNKNOWN";
+    }
+}
+
+void FocusStateMachine::requestOutput(bool hideBuffer) {
+    // 已在送出或等待中：新的文字直接排在後面，不需重新判斷
+    if (state_ != STATE_IDLE) return;
+
+    if (hideBuffer && env_.bufferVisible()) {
+        env_.hideBuffer();
+        hidBuffer_ = true;
+    }
+    advance();
+}
+
+void FocusStateMachine::advance() {
+    if (hidBuffer_ && env_.bufferVisible()) {
+        enterWait(STATE_WAIT_HIDDEN);
+        return;
+    }
+    if (!env_.targetHasFocus()) {
+        enterWait(STATE_WAIT_FOCUS);
+        return;
+    }
+    enterOutput(false);
+}
+
+void FocusStateMachine::enterWait(State state) {
+    state_ = state;
+    // 逾時從第一次進入等待開始計算，狀態間移動不重新計時
+    if (!timeoutArmed_) {
+        timeoutArmed_ = true;
+        env_.scheduleTimeout(timeoutMs_);
+    }
+}
+
+void FocusStateMachine::enterOutput(bool timedOut) {
+    if (timeoutArmed_) {
+        timeoutArmed_ = false;
+        env_.cancelTimeout();
+    }
+    state_ = STATE_OUTPUT;
+    env_.releaseOutput(timedOut);
+}
+
+void FocusStateMachine::onBufferHidden() {
+    if (state_ == STATE_WAIT_HIDDEN) advance();
+}
+
+void FocusStateMachine::onForegroundChanged() {
+    if (state_ == STATE_WAIT_HIDDEN || state_ == STATE_WAIT_FOCUS) advance();
+}
+
+void FocusStateMachine::onTimeout() {
+    timeoutArmed_ = false;
+    if (state_ != STATE_WAIT_HIDDEN && state_ != STATE_WAIT_FOCUS) return;
+    // 逾時仍照常送出（與過去固定等待後直接送出的行為一致）
+    timeouts_++;
+    enterOutput(true);
+}
+
+void FocusStateMachine::onOutputFinished() {
+    if (state_ == STATE_IDLE) return;
+    if (timeoutArmed_) {
+        timeoutArmed_ = false;
+        env_.cancelTimeout();
+    }
+    state_ = STATE_IDLE;
+    env_.holdOutput();
+    if (hidBuffer_) {
+        hidBuffer_ = false;
+        env_.restoreBuffer();
+    }
+}
+
+} // namespace FocusTracker
@@ -0,0 +1,79 @@
+// focus_tracker.h - 文字輸出前的焦點/可見性狀態機（可攜式，不依賴 Windows API）
+#ifndef FOCUS_TRACKER_H
+#define FOCUS_TRACKER_H
+
+namespace FocusTracker {
+    // 狀態機所需的外部環境：Windows 上由視窗事件驅動，測試時可替換成假環境
+    class FocusEnvironment {
+    public:
+        virtual ~FocusEnvironment() {}
+
+        virtual bool bufferVisible() = 0;      // 暫放視窗是否可見
+        virtual void hideBuffer() = 0;         // 隱藏暫放視窗（送出期間）
+        virtual void restoreBuffer() = 0;      // 送出完成後恢復暫放視窗
+        virtual bool targetHasFocus() = 0;     // 前景是否為外部目標程式（不是輸入法自己的視窗）
+
+        // 允許輸出佇列開始送出；timedOut 表示等待逾時仍照常送出
+        virtual void releaseOutput(bool timedOut) = 0;
+        // 暫停輸出佇列（送完後關閉，下一次送出重新等待目標就緒）
+        virtual void holdOutput() = 0;
+
+        // 請求在 ms 毫秒後呼叫 onTimeout（重複呼叫會覆蓋前一次）
+        virtual void scheduleTimeout(unsigned ms) = 0;
+        virtual void cancelTimeout() = 0;
+    };
+
+    // 狀態轉換：
+    //   IDLE --requestOutput--> WAIT_HIDDEN（暫放視窗尚未隱藏）
+    //                        \-> WAIT_FOCUS（目標尚未取得焦點）
+    //                        \-> OUTPUT（已就緒，立即送出）
+    //   WAIT_* --事件滿足--> OUTPUT；WAIT_* --逾時--> OUTPUT（timedOut）
+    //   OUTPUT --onOutputFinished--> IDLE（恢復暫放視窗）
+    class FocusStateMachine {
+    public:
+        enum State {
+            STATE_IDLE = 0,
+            STATE_WAIT_HIDDEN,
+            STATE_WAIT_FOCUS,
+            STATE_OUTPUT
+        };
+
+        static const unsigned DEFAULT_TIMEOUT_MS = 250;
+
+        explicit FocusStateMachine(FocusEnvironment& env, unsigned timeoutMs = DEFAULT_TIMEOUT_MS);
+
+        // 有文字要送出；hideBuffer 為 true 時先隱藏可見的暫放視窗
+        void requestOutput(bool hideBuffer);
+
+        // 視窗事件
+        void onBufferHidden();
+        void onForegroundChanged();
+        void onTimeout();
+
+        // 輸出佇列已清空
+        void onOutputFinished();
+
+        State state() const { return state_; }
+        bool bufferHidden() const { return hidBuffer_; }
+        unsigned timeoutCount() const { return timeouts_; }
+
+        static const char* stateName(State state);
+
+    private:
+        FocusStateMachine(const FocusStateMachine&);
+        FocusStateMachine& operator=(const FocusStateMachine&);
+
+        void advance();
+        void enterWait(State state);
+        void enterOutput(bool timedOut);
+
+        FocusEnvironment& env_;
+        unsigned timeoutMs_;
+        State state_;
+        bool hidBuffer_;        // 是否由狀態機隱藏了暫放視窗（完成後需恢復）
+        bool timeoutArmed_;
+        unsigned timeouts_;     // 累計逾時次數（統計用）
+    };
+}
+
+#endif // FOCUS_TRACKER_H
@@ -0,0 +1,426 @@
+// gzip_stream.cpp - gzip 分段解壓縮實作
+#include "gzip_stream.h"
+#include <cstring>
+
+namespace GzipStream {
+
+static const int FAST_BITS = 10;
+static const size_t WINDOW_SIZE = 32768;
+
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// 動態表頭中碼長碼的排列順序
+static const uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+uint32_t crc32(uint32_t crc, const void* data, size_t size) {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        ready = true;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+Decoder::Decoder() : window_(WINDOW_SIZE), out_(nullptr) {
+    reset();
+}
+
+void Decoder::reset() {
+    state_ = ST_MEMBER_HEADER;
+    status_ = GZ_NEED_INPUT;
+    finalBlock_ = false;
+    storedLeft_ = 0;
+    input_.clear();
+    pos_ = 0;
+    bitBuffer_ = 0;
+    bitCount_ = 0;
+    windowPos_ = 0;
+    memberOut_ = 0;
+    totalOut_ = 0;
+    crc_ = 0;
+    flushedPos_ = 0;
+}
+
+Status Decoder::feed(const char* data, size_t size, const Output& out) {
+    if (status_ == GZ_ERROR) return status_;
+    // 丟掉已讀入位元緩衝區的部分，只保留未處理的輸入
+    input_.erase(0, pos_);
+    pos_ = 0;
+    input_.append(data, size);
+
+    out_ = &out;
+    bool ok = run();
+    flushOutput();
+    out_ = nullptr;
+
+    if (!ok) {
+        status_ = GZ_ERROR;
+    } else if (state_ == ST_MEMBER_END && pos_ == input_.size() && bitCount_ == 0) {
+        status_ = GZ_DONE;
+    } else {
+        status_ = GZ_NEED_INPUT;
+    }
+    return status_;
+}
+
+bool Decoder::needBits(int count) {
+    while (bitCount_ < count) {
+        if (pos_ == input_.size()) return false;
+        bitBuffer_ |= (uint64_t)(uint8_t)input_[pos_++] << bitCount_;
+        bitCount_ += 8;
+    }
+    return true;
+}
+
+uint32_t Decoder::takeBits(int count) {
+    uint32_t value = (uint32_t)(bitBuffer_ & ((1ull << count) - 1));
+    bitBuffer_ >>= count;
+    bitCount_ -= count;
+    return value;
+}
+
+bool Decoder::buildHuffman(Huffman& table, const uint8_t* lengths, int count) {
+    memset(table.count, 0, sizeof(table.count));
+    memset(table.fast, 0, sizeof(table.fast));
+    for (int i = 0; i < count; i++) table.count[lengths[i]]++;
+    table.count[0] = 0;
+
+    // 超額配置的碼無效；不完整的碼可以接受（只有一個距離碼時）
+    int left = 1;
+    for (int length = 1; length < 16; length++) {
+        left <<= 1;
+        left -= table.count[length];
+        if (left < 0) return false;
+    }
+
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (int length = 1; length < 15; length++) offsets[length + 1] = offsets[length] + table.count[length];
+    for (int i = 0; i < count; i++) {
+        if (lengths[i]) table.symbol[offsets[lengths[i]]++] = (uint16_t)i;
+    }
+
+    // 正規霍夫曼碼依碼長、符號順序遞增；位元串流中碼是由高位到低位，查表要反轉
+    uint32_t code = 0;
+    int index = 0;
+    for (int length = 1; length <= FAST_BITS; length++) {
+        for (int n = 0; n < table.count[length]; n++, index++, code++) {
+            uint32_t reversed = 0;
+            for (int b = 0; b < length; b++) reversed |= ((code >> b) & 1) << (length - 1 - b);
+            for (uint32_t i = reversed; i < (1u << FAST_BITS); i += 1u << length) {
+                table.fast[i] = (uint16_t)(length << 9 | table.symbol[index]);
+            }
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+int Decoder::decodeSymbol(const Huffman& table) {
+    needBits(FAST_BITS);
+    uint16_t entry = table.fast[bitBuffer_ & ((1u << FAST_BITS) - 1)];
+    if (entry) {
+        int length = entry >> 9;
+        if (length > bitCount_) return -1;
+        takeBits(length);
+        return entry & 0x1FF;
+    }
+
+    // 碼長超過查表範圍：逐位元比對
+    int code = 0, first = 0, index = 0;
+    for (int length = 1; length < 16; length++) {
+        if (!needBits(length)) return -1;
+        code |= (int)(bitBuffer_ >> (length - 1)) & 1;
+        int count = table.count[length];
+        if (code - count < first) {
+            takeBits(length);
+            return table.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -2;
+}
+
+void Decoder::putByte(uint8_t byte) {
+    window_[windowPos_++] = byte;
+    if (windowPos_ == WINDOW_SIZE) {
+        flushOutput();
+        windowPos_ = 0;
+        flushedPos_ = 0;
+    }
+}
+
+void Decoder::flushOutput() {
+    if (windowPos_ == flushedPos_) return;
+    const uint8_t* data = window_.data() + flushedPos_;
+    size_t size = windowPos_ - flushedPos_;
+    crc_ = crc32(crc_, data, size);
+    memberOut_ += size;
+    totalOut_ += size;
+    (*out_)((const char*)data, size);
+    flushedPos_ = windowPos_;
+}
+
+bool Decoder::readMemberHeader(bool& needInput) {
+    // 固定 10 位元組，之後依旗標有額外欄位、檔名、註解與表頭 CRC
+    size_t p = pos_;
+    needInput = true;
+    if (input_.size() - p < 10) return true;
+    const uint8_t* h = (const uint8_t*)input_.data() + p;
+    if (h[0] != 0x1F || h[1] != 0x8B || h[2] != 8) return false;
+    uint8_t flags = h[3];
+    if (flags & 0xE0) return false;
+    p += 10;
+    if (flags & 4) {
+        if (input_.size() - p < 2) return true;
+        size_t extra = (uint8_t)input_[p] | (size_t)(uint8_t)input_[p + 1] << 8;
+        p += 2;
+        if (input_.size() - p < extra) return true;
+        p += extra;
+    }
+    for (int field = 8; field <= 16; field <<= 1) {
+        if (!(flags & field)) continue;
+        size_t zero = input_.find('\0', p);
+        if (zero == std::string::npos) return true;
+        p = zero + 1;
+    }
+    if (flags & 2) {
+        if (input_.size() - p < 2) return true;
+        p += 2;
+    }
+    needInput = false;
+    pos_ = p;
+    memberOut_ = 0;
+    crc_ = 0;
+    return true;
+}
+
+bool Decoder::readDynamicTables(bool& needInput) {
+    needInput = true;
+    if (!needBits(14)) return true;
+    int literalCount = (int)takeBits(5) + 257;
+    int distanceCount = (int)takeBits(5) + 1;
+    int codeLengthCount = (int)takeBits(4) + 4;
+    if (literalCount > 286 || distanceCount > 30) return false;
+
+    uint8_t lengths[320];
+    memset(lengths, 0, sizeof(lengths));
+    for (int i = 0; i < codeLengthCount; i++) {
+        if (!needBits(3)) return true;
+        lengths[CODE_LENGTH_ORDER[i]] = (uint8_t)takeBits(3);
+    }
+    Huffman codeLengths;
+    if (!buildHuffman(codeLengths, lengths, 19)) return false;
+
+    memset(lengths, 0, sizeof(lengths));
+    int index = 0;
+    while (index < literalCount + distanceCount) {
+        int symbol = decodeSymbol(codeLengths);
+        if (symbol == -1) return true;
+        if (symbol < 0) return false;
+        if (symbol < 16) {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+        int repeat;
+        uint8_t value = 0;
+        if (symbol == 16) {
+            if (index == 0) return false;
+            if (!needBits(2)) return true;
+            value = lengths[index - 1];
+            repeat = 3 + (int)takeBits(2);
+        } else if (symbol == 17) {
+            if (!needBits(3)) return true;
+            repeat = 3 + (int)takeBits(3);
+        } else {
+            if (!needBits(7)) return true;
+            repeat = 11 + (int)takeBits(7);
+        }
+        if (index + repeat > literalCount + distanceCount) return false;
+        while (repeat--) lengths[index++] = value;
+    }
+    if (lengths[256] == 0) return false;    // 沒有區塊結束碼
+
+    if (!buildHuffman(literals_, lengths, literalCount)) return false;
+    if (!buildHuffman(distances_, lengths + literalCount, distanceCount)) return false;
+    needInput = false;
+    return true;
+}
+
+bool Decoder::decodeCodes(bool& needInput) {
+    needInput = false;
+    for (;;) {
+        // 每個符號（含額外位元與距離）是一個單位：輸入不足時整個退回，等更多資料再重來
+        size_t savedPos = pos_;
+        uint64_t savedBits = bitBuffer_;
+        int savedCount = bitCount_;
+
+        int symbol = decodeSymbol(literals_);
+        if (symbol >= 0 && symbol < 256) {
+            putByte((uint8_t)symbol);
+            continue;
+        }
+        if (symbol == 256) {
+            state_ = finalBlock_ ? ST_TRAILER : ST_BLOCK_HEADER;
+            return true;
+        }
+        if (symbol == -2 || symbol > 285) return false;
+
+        if (symbol >= 0) {
+            symbol -= 257;
+            int length = -1, distance = -1;
+            if (needBits(LENGTH_EXTRA[symbol])) {
+                length = LENGTH_BASE[symbol] + (int)takeBits(LENGTH_EXTRA[symbol]);
+                int distanceSymbol = decodeSymbol(distances_);
+                if (distanceSymbol == -2 || distanceSymbol >= 30) return false;
+                if (distanceSymbol >= 0 && needBits(DISTANCE_EXTRA[distanceSymbol])) {
+                    distance = DISTANCE_BASE[distanceSymbol] + (int)takeBits(DISTANCE_EXTRA[distanceSymbol]);
+                }
+            }
+            if (distance > 0) {
+                // 不能參照這個成員開始之前的內容
+                if ((uint64_t)distance > memberOut_ + (windowPos_ - flushedPos_)) return false;
+                while (length--) putByte(window_[(windowPos_ - distance) & (WINDOW_SIZE - 1)]);
+                continue;
+            }
+        }
+
+        pos_ = savedPos;
+        bitBuffer_ = savedBits;
+        bitCount_ = savedCount;
+        needInput = true;
+        return true;
+    }
+}
+
+bool Decoder::copyStored() {
+    // 對齊後位元緩衝區中可能還有整數個位元組
+    while (storedLeft_ > 0 && bitCount_ >= 8) {
+        putByte((uint8_t)takeBits(8));
+        storedLeft_--;
+    }
+    while (storedLeft_ > 0 && pos_ < input_.size()) {
+        putByte((uint8_t)input_[pos_++]);
+        storedLeft_--;
+    }
+    if (storedLeft_ == 0) state_ = finalBlock_ ? ST_TRAILER : ST_BLOCK_HEADER;
+    return true;
+}
+
+bool Decoder::readTrailer(bool& needInput) {
+    needInput = true;
+    takeBits(bitCount_ % 8);
+    if (!needBits(64)) return true;
+    flushOutput();
+    uint32_t crc = takeBits(32);
+    uint32_t size = takeBits(32);
+    if (crc != crc_ || size != (uint32_t)memberOut_) return false;
+    needInput = false;
+    state_ = ST_MEMBER_END;
+    return true;
+}
+
+bool Decoder::run() {
+    for (;;) {
+        bool needInput = false;
+        switch (state_) {
+            case ST_MEMBER_END:
+                // 串接的下一個成員
+                if (pos_ == input_.size() && bitCount_ == 0) return true;
+                state_ = ST_MEMBER_HEADER;
+                break;
+
+            case ST_MEMBER_HEADER:
+                if (!readMemberHeader(needInput)) return false;
+                if (needInput) return true;
+                state_ = ST_BLOCK_HEADER;
+                break;
+
+            case ST_BLOCK_HEADER: {
+                size_t savedPos = pos_;
+                uint64_t savedBits = bitBuffer_;
+                int savedCount = bitCount_;
+                if (!needBits(3)) return true;
+                finalBlock_ = takeBits(1) != 0;
+                uint32_t type = takeBits(2);
+                if (type == 0) {
+                    takeBits(bitCount_ % 8);
+                    if (needBits(32)) {
+                        uint32_t length = takeBits(16);
+                        uint32_t check = takeBits(16);
+                        if ((length ^ 0xFFFF) != check) return false;
+                        storedLeft_ = length;
+                        state_ = ST_STORED;
+                        break;
+                    }
+                } else if (type == 1) {
+                    uint8_t lengths[320];
+                    memset(lengths, 8, 144);
+                    memset(lengths + 144, 9, 112);
+                    memset(lengths + 256, 7, 24);
+                    memset(lengths + 280, 8, 8);
+                    buildHuffman(literals_, lengths, 288);
+                    memset(lengths, 5, 30);
+                    buildHuffman(distances_, lengths, 30);
+                    state_ = ST_CODES;
+                    break;
+                } else if (type == 2) {
+                    if (!readDynamicTables(needInput)) return false;
+                    if (!needInput) {
+                        state_ = ST_CODES;
+                        break;
+                    }
+                } else {
+                    return false;
+                }
+                // 區塊表頭不完整：退回到表頭開頭
+                pos_ = savedPos;
+                bitBuffer_ = savedBits;
+                bitCount_ = savedCount;
+                return true;
+            }
+
+            case ST_STORED:
+                copyStored();
+                if (state_ == ST_STORED) return true;
+                break;
+
+            case ST_CODES:
+                if (!decodeCodes(needInput)) return false;
+                if (needInput) return true;
+                break;
+
+            case ST_TRAILER:
+                if (!readTrailer(needInput)) return false;
+                if (needInput) return true;
+                break;
+        }
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+// gzip_stream.h - 分段解壓縮 gzip（可攜式，不依賴 Windows API）
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 下載時邊收邊解壓縮：壓縮資料可任意切段餵入，解出的內容每次最多 32 KB 交給回呼，
+// 記憶體用量固定（32 KB 視窗加上一個符號以內的未處理輸入），與檔案大小無關
+// 支援 RFC 1952 gzip（含多個成員串接）與 RFC 1951 deflate 的三種區塊
+namespace GzipStream {
+    enum Status {
+        GZ_NEED_INPUT,      // 已處理完目前的輸入，等待更多資料
+        GZ_DONE,            // 已解完最後一個成員且 CRC 與長度相符
+        GZ_ERROR            // 資料錯誤（之後的輸入都會被拒絕）
+    };
+
+    // 標準 CRC-32（gzip 檔尾使用），可分段計算：crc = crc32(crc, ...)，初始值為 0
+    uint32_t crc32(uint32_t crc, const void* data, size_t size);
+
+    class Decoder {
+    public:
+        typedef std::function<void(const char* data, size_t size)> Output;
+
+        Decoder();
+        void reset();
+
+        // 餵入壓縮資料；解出的內容以 out 回呼
+        Status feed(const char* data, size_t size, const Output& out);
+
+        Status status() const { return status_; }
+        // 已解出的位元組數
+        uint64_t outputSize() const { return totalOut_; }
+
+    private:
+        struct Huffman {
+            uint16_t count[16];
+            uint16_t symbol[320];
+            uint16_t fast[1 << 10];     // 低位元查表：(碼長 << 9) | 符號；0 表示碼長超過 10
+        };
+
+        enum State {
+            ST_MEMBER_HEADER,
+            ST_BLOCK_HEADER,
+            ST_STORED,
+            ST_CODES,
+            ST_TRAILER,
+            ST_MEMBER_END
+        };
+
+        // 處理到輸入不足或出錯為止；回傳 false 表示資料錯誤
+        bool run();
+        bool readMemberHeader(bool& needInput);
+        bool readDynamicTables(bool& needInput);
+        bool decodeCodes(bool& needInput);
+        bool copyStored();
+        bool readTrailer(bool& needInput);
+
+        bool needBits(int count);
+        uint32_t takeBits(int count);
+        int decodeSymbol(const Huffman& table);     // -1：輸入不足，-2：無效的碼
+        static bool buildHuffman(Huffman& table, const uint8_t* lengths, int count);
+
+        void putByte(uint8_t byte);
+        void flushOutput();
+
+        State state_;
+        Status status_;
+        bool finalBlock_;
+        uint32_t storedLeft_;
+
+        // 未處理的輸入；pos_ 之前的已讀入位元緩衝區
+        std::string input_;
+        size_t pos_;
+        uint64_t bitBuffer_;
+        int bitCount_;
+
+        Huffman literals_;
+        Huffman distances_;
+
+        // 32 KB 滑動視窗（距離複製的來源）
+        std::vector<uint8_t> window_;
+        size_t windowPos_;
+        uint64_t memberOut_;    // 目前成員已解出的長度（檔尾比對用）
+        uint64_t totalOut_;
+        uint32_t crc_;
+        size_t flushedPos_;     // 視窗中已交給回呼的位置
+        const Output* out_;
+    };
+}
+
+#endif // GZIP_STREAM_H
@@ -0,0 +1,326 @@
+// http_transfer.cpp - 條件式與可續傳下載實作
+#include "http_transfer.h"
+#include "gzip_stream.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace HttpTransfer {
+
+// 每個鍵一行；值不含換行
+bool loadMetadata(const std::string& path, Metadata& meta) {
+    meta = Metadata();
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        std::string text(line);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+        size_t eq = text.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = text.substr(0, eq);
+        std::string value = text.substr(eq + 1);
+        if (key == "url") meta.url = value;
+        else if (key == "etag") meta.complete.etag = value;
+        else if (key == "last_modified") meta.complete.lastModified = value;
+        else if (key == "size") meta.completeSize = strtoull(value.c_str(), nullptr, 10);
+        else if (key == "partial_etag") meta.partial.etag = value;
+        else if (key == "partial_last_modified") meta.partial.lastModified = value;
+    }
+    fclose(file);
+    return true;
+}
+
+bool saveMetadata(const std::string& path, const Metadata& meta) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    fprintf(file, "url=%s\n", meta.url.c_str());
+    fprintf(file, "etag=%s\n", meta.complete.etag.c_str());
+    fprintf(file, "last_modified=%s\n", meta.complete.lastModified.c_str());
+    fprintf(file, "size=%llu\n", (unsigned long long)meta.completeSize);
+    fprintf(file, "partial_etag=%s\n", meta.partial.etag.c_str());
+    fprintf(file, "partial_last_modified=%s\n", meta.partial.lastModified.c_str());
+    bool ok = fflush(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+// 檔案大小；不存在時回傳 -1
+static long long fileSize(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return -1;
+    long long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static bool isWeakEtag(const std::string& etag) {
+    return etag.compare(0, 2, "W/") == 0;
+}
+
+// If-Range 只接受強 ETag 或日期；都沒有時無法安全續傳
+static std::string ifRangeValue(const Validators& v) {
+    if (!v.etag.empty() && !isWeakEtag(v.etag)) return v.etag;
+    return v.lastModified;
+}
+
+// 206 回應的版本是否與暫存檔相同：伺服器不一定遵守 If-Range，版本不同時不可接到暫存檔後面
+static bool sameVersion(const Validators& partial, const Validators& received) {
+    if (!partial.etag.empty() && !received.etag.empty()) return partial.etag == received.etag;
+    if (!partial.lastModified.empty() && !received.lastModified.empty()) {
+        return partial.lastModified == received.lastModified;
+    }
+    return true;
+}
+
+// 未提供時回傳 -1
+static long long parseLength(const std::string& value) {
+    if (value.empty()) return -1;
+    char* end = nullptr;
+    long long length = strtoll(value.c_str(), &end, 10);
+    return end == value.c_str() || length < 0 ? -1 : length;
+}
+
+// Content-Range: bytes 起點-終點/總長（總長可能是 *）
+static bool parseContentRange(const std::string& value, long long& start, long long& total) {
+    const char* p = value.c_str();
+    if (strncmp(p, "bytes ", 6) != 0) return false;
+    p += 6;
+    char* end = nullptr;
+    start = strtoll(p, &end, 10);
+    if (end == p || *end != '-') return false;
+    const char* slash = strchr(end, '/');
+    if (!slash) return false;
+    total = slash[1] == '*' ? -1 : strtoll(slash + 1, nullptr, 10);
+    return true;
+}
+
+// 暫存檔中已有的部分交給 sink（續傳時只讀已下載的部分）
+static bool replayPartial(const std::string& path, BodySink& sink, std::vector<char>& buffer) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    size_t got;
+    while ((got = fread(buffer.data(), 1, buffer.size(), file)) > 0) sink.append(buffer.data(), got);
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+FetchResult fetch(Transport& transport, const std::string& url, const Target& target, BodySink* sink,
+                  Monitor* monitor) {
+    FetchResult result;
+    Metadata meta;
+    loadMetadata(target.metaPath, meta);
+    if (meta.url != url) {
+        meta = Metadata();
+        meta.url = url;
+    }
+
+    // 第一次可能續傳；續傳的範圍不被接受時改從頭下載一次
+    for (int attempt = 0; attempt < 2; attempt++) {
+        long long offset = fileSize(target.tempPath);
+        std::string ifRange = ifRangeValue(meta.partial);
+        bool resume = attempt == 0 && offset > 0 && !ifRange.empty();
+        if (!resume) offset = 0;
+
+        Headers headers;
+        if (resume) {
+            // 續傳的範圍以未壓縮的內容計算
+            headers.push_back(std::make_pair(std::string("Range"), "bytes=" + std::to_string(offset) + "-"));
+            headers.push_back(std::make_pair(std::string("If-Range"), ifRange));
+        } else {
+            headers.push_back(std::make_pair(std::string("Accept-Encoding"), std::string("gzip")));
+            long long localSize = fileSize(target.path);
+            if (localSize >= 0 && (uint64_t)localSize == meta.completeSize && !meta.complete.empty()) {
+                if (!meta.complete.etag.empty()) {
+                    headers.push_back(std::make_pair(std::string("If-None-Match"), meta.complete.etag));
+                }
+                if (!meta.complete.lastModified.empty()) {
+                    headers.push_back(std::make_pair(std::string("If-Modified-Since"), meta.complete.lastModified));
+                }
+            }
+        }
+
+        std::unique_ptr<Response> response = transport.get(url, headers, result.error);
+        if (!response) {
+            result.outcome = FETCH_NETWORK_ERROR;
+            return result;
+        }
+        result.httpCode = response->status();
+        if (result.httpCode == 304) {
+            result.outcome = FETCH_NOT_MODIFIED;
+            return result;
+        }
+
+        long long total = -1;
+        bool append = false;
+        if (result.httpCode == 206 && resume) {
+            long long start = -1;
+            if (!parseContentRange(response->header("Content-Range"), start, total) || start != offset) {
+                discardPartial(target);
+                meta.partial = Validators();
+                continue;
+            }
+            append = true;
+        } else if (result.httpCode == 416 && resume) {
+            // 暫存檔已不符合伺服器上的內容（例如檔案變短）
+            discardPartial(target);
+            meta.partial = Validators();
+            continue;
+        } else if (result.httpCode == 200) {
+            total = parseLength(response->header("Content-Length"));
+        } else {
+            // 其他狀態保留暫存檔，暫時性的錯誤不會浪費已下載的部分
+            result.outcome = FETCH_HTTP_ERROR;
+            result.error = L"HTTP錯誤：" + std::to_wstring(result.httpCode);
+            return result;
+        }
+
+        // 壓縮傳輸：邊收邊解壓縮，暫存檔與 sink 收到的都是未壓縮的內容
+        std::string encoding = response->header("Content-Encoding");
+        bool compressed = encoding == "gzip" || encoding == "x-gzip";
+        if (!compressed && !encoding.empty() && encoding != "identity") {
+            result.outcome = FETCH_HTTP_ERROR;
+            result.error = L"不支援的內容編碼：" + std::wstring(encoding.begin(), encoding.end());
+            return result;
+        }
+        if (compressed && append) {
+            // 續傳的部分被壓縮了：無法接到暫存檔後面，從頭下載
+            discardPartial(target);
+            meta.partial = Validators();
+            continue;
+        }
+
+        Validators received;
+        received.etag = response->header("ETag");
+        received.lastModified = response->header("Last-Modified");
+        if (append && !sameVersion(meta.partial, received)) {
+            discardPartial(target);
+            meta.partial = Validators();
+            continue;
+        }
+        if (append) {
+            if (received.empty()) received = meta.partial;
+        } else {
+            offset = 0;
+        }
+
+        // 開始寫入前記下版本，寫到一半中斷時才能續傳
+        // 壓縮傳輸的 ETag 代表壓縮後的內容，續傳（未壓縮）時只能以 Last-Modified 比對
+        meta.partial = received;
+        if (compressed) meta.partial.etag.clear();
+        saveMetadata(target.metaPath, meta);
+
+        std::vector<char> buffer(BLOCK_SIZE);
+        if (sink) {
+            sink->restart();
+            if (append && !replayPartial(target.tempPath, *sink, buffer)) {
+                result.outcome = FETCH_FILE_ERROR;
+                result.error = L"無法讀取臨時文件";
+                return result;
+            }
+        }
+
+        FILE* out = fopen(target.tempPath.c_str(), append ? "ab" : "wb");
+        if (!out) {
+            result.outcome = FETCH_FILE_ERROR;
+            result.error = L"無法建立臨時文件";
+            return result;
+        }
+
+        result.resumed = append;
+        result.compressed = compressed;
+        result.validators = received;
+        bool broken = false;
+        bool writeFailed = false;
+        uint64_t written = 0;
+        GzipStream::Decoder::Output emit = [&](const char* data, size_t size) {
+            if (writeFailed) return;
+            if (fwrite(data, 1, size, out) != size) {
+                writeFailed = true;
+                return;
+            }
+            if (sink) sink->append(data, size);
+            written += size;
+        };
+        std::unique_ptr<GzipStream::Decoder> decoder(compressed ? new GzipStream::Decoder() : nullptr);
+        bool corrupt = false;
+        // 進度以傳輸的位元組計算，才能與 Content-Length / Content-Range 的總長比較
+        uint64_t base = compressed ? 0 : (uint64_t)offset;
+        bool cancelled = monitor && !monitor->progress(base, total);
+        while (!cancelled) {
+            long got = response->read(buffer.data(), buffer.size());
+            if (got < 0) {
+                broken = true;
+                break;
+            }
+            if (got == 0) break;
+            result.received += (uint64_t)got;
+            if (decoder) {
+                corrupt = decoder->feed(buffer.data(), (size_t)got, emit) == GzipStream::GZ_ERROR;
+            } else {
+                emit(buffer.data(), (size_t)got);
+            }
+            if (writeFailed || corrupt) break;
+            cancelled = monitor && !monitor->progress(base + result.received, total);
+        }
+        if (fclose(out) != 0) writeFailed = true;
+        result.fileSize = (uint64_t)offset + written;
+
+        if (writeFailed) {
+            discardPartial(target);
+            result.outcome = FETCH_FILE_ERROR;
+            result.error = L"文件寫入失敗";
+            return result;
+        }
+        if (corrupt) {
+            discardPartial(target);
+            result.outcome = FETCH_NETWORK_ERROR;
+            result.error = L"壓縮資料錯誤";
+            return result;
+        }
+        // Content-Length 是傳輸的長度（壓縮時為壓縮後的大小）；壓縮串流還要解到結尾
+        uint64_t transferred = compressed ? result.received : result.fileSize;
+        if (cancelled) {
+            if (ifRangeValue(meta.partial).empty()) discardPartial(target);
+            result.outcome = FETCH_CANCELLED;
+            result.error = L"下載已取消";
+            return result;
+        }
+        if (broken || (total >= 0 && transferred < (uint64_t)total) ||
+            (decoder && decoder->status() != GzipStream::GZ_DONE)) {
+            if (ifRangeValue(meta.partial).empty()) discardPartial(target);   // 沒有可比對的版本，無法續傳
+            result.outcome = FETCH_INCOMPLETE;
+            result.error = L"下載中斷：已收到 " + std::to_wstring(result.fileSize) + L" 字節，下次將從中斷處繼續";
+            return result;
+        }
+
+        result.outcome = FETCH_COMPLETE;
+        return result;
+    }
+
+    result.outcome = FETCH_HTTP_ERROR;
+    result.error = L"無法續傳，重新下載失敗";
+    return result;
+}
+
+void markComplete(const Target& target, const std::string& url, const Validators& validators) {
+    Metadata meta;
+    meta.url = url;
+    meta.complete = validators;
+    long long size = fileSize(target.path);
+    meta.completeSize = size > 0 ? (uint64_t)size : 0;
+    saveMetadata(target.metaPath, meta);
+}
+
+void discardPartial(const Target& target) {
+    remove(target.tempPath.c_str());
+    Metadata meta;
+    if (loadMetadata(target.metaPath, meta) && !meta.partial.empty()) {
+        meta.partial = Validators();
+        saveMetadata(target.metaPath, meta);
+    }
+}
+
+}
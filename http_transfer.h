@@ -0,0 +1,119 @@
+// http_transfer.h - 條件式與可續傳的 HTTP 下載（可攜式，不依賴 Windows API）
+#ifndef HTTP_TRANSFER_H
+#define HTTP_TRANSFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 下載流程與傳輸分開：Windows 上以 WinInet 實作 Transport，其他平台可接本機的測試伺服器
+// - 記住檔案的 ETag / Last-Modified，之後以 If-None-Match / If-Modified-Since 詢問，
+//   未變更時伺服器回 304，只花一次往返
+// - 內容先寫到暫存檔；中斷時保留已收到的部分，下次以 Range 從中斷處繼續，
+//   並以 If-Range 確認仍是同一版本（版本已變更時伺服器改回完整內容）
+// - 完整下載時接受 gzip 傳輸，邊收邊解壓縮到暫存檔；續傳一律以未壓縮的內容計算範圍
+namespace HttpTransfer {
+    typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+    class Response {
+    public:
+        virtual ~Response() {}
+        virtual int status() const = 0;
+        // 回應標頭（名稱不分大小寫）；沒有時回傳空字串
+        virtual std::string header(const std::string& name) const = 0;
+        // 讀取本文；回傳讀到的位元組數，0 表示結束，負值表示連線中斷
+        virtual long read(char* buffer, size_t size) = 0;
+    };
+
+    class Transport {
+    public:
+        virtual ~Transport() {}
+        // 送出 GET 請求並取得回應標頭；失敗時回傳空指標並把原因寫入 error
+        virtual std::unique_ptr<Response> get(const std::string& url, const Headers& headers,
+                                              std::wstring& error) = 0;
+    };
+
+    // 下載內容的旁觀者（例如邊下載邊計算雜湊、解析內容），不必下載完再讀一次檔案
+    class BodySink {
+    public:
+        virtual ~BodySink() {}
+        // 暫存檔從頭開始寫
+        virtual void restart() = 0;
+        // 依序收到暫存檔的內容（續傳時先收到暫存檔中已有的部分）
+        virtual void append(const char* data, size_t size) = 0;
+    };
+
+    // 下載進度與取消：每收到一段本文呼叫一次（開始接收前先以 0 呼叫一次）
+    class Monitor {
+    public:
+        virtual ~Monitor() {}
+        // done 與 total 以傳輸的位元組計算（壓縮時為壓縮後的大小，續傳時包含已下載的部分）；
+        // total 未知時為 -1；回傳 false 表示取消，已收到的部分保留在暫存檔，下次續傳
+        virtual bool progress(uint64_t done, long long total) = 0;
+    };
+
+    // 伺服器提供的版本識別
+    struct Validators {
+        std::string etag;
+        std::string lastModified;
+        bool empty() const { return etag.empty() && lastModified.empty(); }
+    };
+
+    // 下載狀態，存在 metaPath（每行「鍵=值」）
+    struct Metadata {
+        std::string url;
+        Validators complete;        // 目前本機檔案的版本
+        uint64_t completeSize;      // 當時的檔案大小（本機檔案被替換過時不送條件式請求）
+        Validators partial;         // 暫存檔中部分內容的版本
+        Metadata() : completeSize(0) {}
+    };
+    bool loadMetadata(const std::string& path, Metadata& meta);
+    bool saveMetadata(const std::string& path, const Metadata& meta);
+
+    // 下載目標：最終檔案、暫存檔與狀態檔
+    struct Target {
+        std::string path;
+        std::string tempPath;
+        std::string metaPath;
+    };
+
+    enum Outcome {
+        FETCH_COMPLETE,         // 暫存檔已是完整內容（尚未取代目標檔案）
+        FETCH_NOT_MODIFIED,     // 伺服器回 304，本機檔案已是最新
+        FETCH_INCOMPLETE,       // 傳輸中斷，已收到的部分保留在暫存檔，下次續傳
+        FETCH_CANCELLED,        // monitor 要求取消（已收到的部分同樣保留）
+        FETCH_HTTP_ERROR,
+        FETCH_NETWORK_ERROR,
+        FETCH_FILE_ERROR
+    };
+
+    struct FetchResult {
+        Outcome outcome;
+        int httpCode;
+        uint64_t received;      // 這次收到的本文位元組數（壓縮傳輸時為壓縮後的大小）
+        uint64_t fileSize;      // 暫存檔目前的大小（未壓縮）
+        bool resumed;           // 這次是從中斷處續傳
+        bool compressed;        // 這次以 gzip 傳輸
+        Validators validators;  // 下載內容的版本（成功取代目標檔案後以 markComplete 記錄）
+        std::wstring error;
+        FetchResult() : outcome(FETCH_NETWORK_ERROR), httpCode(0), received(0), fileSize(0), resumed(false),
+                        compressed(false) {}
+    };
+
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    // 下載 url 到 target.tempPath：依狀態檔決定送出條件式請求或續傳
+    // sink 不為空時，FETCH_COMPLETE 表示 sink 已依序收到暫存檔的完整內容
+    FetchResult fetch(Transport& transport, const std::string& url, const Target& target,
+                      BodySink* sink = nullptr, Monitor* monitor = nullptr);
+
+    // 暫存檔已取代目標檔案：記錄目標檔案的版本，之後可送條件式請求
+    void markComplete(const Target& target, const std::string& url, const Validators& validators);
+    // 暫存檔內容無效：刪除暫存檔與續傳資訊
+    void discardPartial(const Target& target);
+}
+
+#endif // HTTP_TRANSFER_H
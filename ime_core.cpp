@@ -27,21 +27,7 @@ namespace Utils {
     }
 
     bool isPunctuation(const std::wstring& word) {
-        if (word.empty()) return false;
-        
-        std::wstring punctuations = L"，。？！：；（）「」『』《》〈〉【】：—……\"\"''｜＼－～＿￥％＃＄［］"
-                                   L",.?!:;()[]{}\\'\"'<>/\\-_@#$%^&*+=|`~"
-                                   L"　";
-        
-        for (wchar_t ch : word) {
-            if (ch == L' ' || ch == L'\t' || ch == L'\n' || ch == L'\r' || ch == L'　') {
-                continue;
-            }
-            if (punctuations.find(ch) == std::wstring::npos) {
-                return false;
-            }
-        }
-        return true;
+        return EngineCore::isPunctuation(word);
     }
 
     COLORREF parseColorFromString(const std::string& colorStr) {
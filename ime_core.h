@@ -6,7 +6,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <ctime>
+#include "edit_history.h"
+#include "text_layout.h"
+#include "text_search.h"
+#include "engine_core.h"
 
 // ========== 【重要：更新版本號請修改此處】 ==========
 // 當前版本號 - 此版本號會顯示在「關於」對話框中，並用於版本更新檢查
@@ -20,7 +25,7 @@
 // ========== 【版本號定義結束】 ==========
 
 // 常數定義
-const int CANDIDATES_PER_PAGE = 9;
+const int CANDIDATES_PER_PAGE = EngineCore::CANDIDATES_PER_PAGE;
 const int FIXED_WIDTH = 380;
 const int CHARS_PER_LINE = 10;
 const int MIN_HEIGHT = 80;
@@ -54,12 +59,7 @@ struct ScreenModePositions {
 };
 
 // 詞頻資訊結構
-struct WordInfo {
-    int frequency;
-    time_t lastUsed;
-    int tempCount;
-    bool isPermanent;
-};
+typedef EngineCore::WordInfo WordInfo;
 
 // UI元素位置結構
 struct ToolbarElements {
@@ -106,7 +106,8 @@ struct UIColors {
 };
 
 // 全域狀態結構
-struct GlobalState {
+// 字典、學習資料與輸入狀態是引擎核心的三個部分（見 engine_core.h），其餘為 Win32 前端的視窗與外觀狀態
+struct GlobalState : EngineCore::Model, EngineCore::Learning, EngineCore::Session {
     // 視窗控制代碼
     HWND hWnd = NULL;
     HWND hCandWnd = NULL;
@@ -121,18 +122,8 @@ struct GlobalState {
     bool prevPageButtonHover = false;
     bool nextPageButtonHover = false;
     
-    // 輸入狀態
-    std::wstring input = L"";
-    std::vector<std::wstring> candidates;
-    std::vector<std::wstring> candidateCodes;
-    int selected = 0;
-    int currentPage = 0;
-    int totalPages = 0;
-    bool showCand = false;
+    // 輸入狀態（字碼與候選字在 EngineCore::Session）
     bool chineseMode = true;
-    bool isInputting = false;
-    bool inputError = false;
-    bool showPunctMenu = false;
 	
 	// 文字選取狀態
     bool isSelecting = false;           // 是否正在選取
@@ -147,27 +138,24 @@ struct GlobalState {
     RECT contextMenuRect = {0};        // 右鍵選單位置
 
     
-    // 字典資料
-    std::map<std::wstring, std::vector<std::wstring>> dict;
-    std::map<std::wstring, std::vector<std::wstring>> punct;
-    std::map<std::wstring, WordInfo> wordFreq;
-    std::map<std::wstring, std::vector<std::wstring>> contextLearning;
-    std::wstring lastSelected = L"";
-    std::vector<std::wstring> punctCandidates;
-    int dictSize = 0;
-    
-    // 詞語庫資料（用於聯想字功能）
-    // 格式：第一個字 -> 後續可能的字列表（按頻率排序）
-    std::map<std::wstring, std::vector<std::wstring>> wordPhrases;
-    int phraseDictSize = 0;  // 詞語庫大小
-    
     // 暫放視窗模式
     bool bufferMode = false;
-    std::wstring bufferText = L"";
+    TextModel bufferText;             // 片段表，插入/刪除為 O(log n)
+    mutable TextLayout bufferLayout;  // 暫放區換行排版（查詢時延遲排版，因此可在 const 狀態下更新）
     int bufferCursorPos = 0;
     bool bufferShowCursor = true;
     DWORD bufferCursorBlinkTime = 0;
     bool bufferHasFocus = false;
+    // 暫放區搜尋/取代（Ctrl+F / Ctrl+H，輸入的文字進入搜尋列而非暫放區）
+    bool findActive = false;
+    bool findReplaceMode = false;      // 顯示取代欄位
+    int findField = 0;                 // 0 = 搜尋字串, 1 = 取代字串
+    std::wstring findQuery;
+    std::wstring findReplaceText;
+    int findAnchor = 0;                // 開始搜尋時的游標位置（增量搜尋由此往後找）
+    int findMatchCount = 0;            // 全文相符數
+    int findMatchIndex = 0;            // 目前相符是第幾個（1 起算，0 表示沒有）
+    TextSearch::MatchIndex findIndex;  // 相符的稀疏索引（文字或搜尋字串改變後於下次使用時重建）
     bool clipboardMode = false;  // 剪貼簿模式開關
     bool clipboardInputting = false;  // 剪貼簿模式：是否正在輸入中
     bool clipboardCopied = false;  // 剪貼簿模式：文字是否已複製到剪貼簿
@@ -177,20 +165,18 @@ struct GlobalState {
     bool enableWordPrediction = true;  // 是否啟用聯想字功能
 	
 	
-	// 歷史記錄
-	struct TextSnapshot {
-    std::wstring text;
-    int cursorPos;
-};
-std::vector<TextSnapshot> undoHistory;
-std::vector<TextSnapshot> redoHistory;
-int maxHistorySize = 50;  // 最多保存50步歷史
+	// 歷史記錄（記錄編輯操作並合併連續輸入，以位元組預算限制大小）
+    EditHistory editHistory;
 	
     // 視窗行為設定
     int topmostCheckInterval = 5000;  // 前置檢查間隔
     bool forceStayOnTop = true;       // 是否強制前置
     int refocusDelay = 50;            // 重新聚焦延遲	
     
+    // 文字輸出節奏（SendInput 分批送出）
+    int outputMaxChunk = 64;          // 每批最多字元數
+    int outputChunkDelay = 4;         // 批次間延遲（毫秒），目標回應不佳時會自動加長
+    
     // 半透明設定
     bool enableTransparency = false;  // 是否啟用半透明顯示
     int transparencyAlpha = 220;      // 透明度值 (0-255, 255=完全不透明, 0=完全透明)
@@ -1,5 +1,6 @@
 // ime_manager.cpp - Windows 輸入法衝突管理實作
 #include "ime_manager.h"
+#include "trace_recorder.h"
 #include <imm.h>
 
 namespace IMEManager {
@@ -141,6 +142,7 @@ namespace IMEManager {
     
     void restoreWindowsIME() {
         if (!g_imeDisabled) return;
+        if (TraceRecorder::isReplaying()) return;  // 重播不可影響前景視窗的輸入法
         
         HWND hForeground = GetForegroundWindow();
         if (!hForeground) return;
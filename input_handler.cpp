@@ -4,6 +4,14 @@
 #include "dictionary.h"
 #include "window_manager.h"
 #include "ime_manager.h"
+#include "key_event_queue.h"
+#include "latency_stats.h"
+#include "trace_recorder.h"
+#include "trace_replay.h"
+#include "output_sink.h"
+#include "focus_tracker.h"
+#include <algorithm>
+#include <mutex>
 #include <windows.h>
 
 extern GlobalState g_state;
@@ -11,6 +19,51 @@ extern HHOOK g_hKeyboardHook;
 
 namespace InputHandler {
 
+// 鉤子 → 引擎的按鍵佇列（鉤子只負責入列，主視窗在 WM_USER+101 中取出處理）
+static KeyEventQueue g_keyEventQueue;
+// 是否已投遞喚醒訊息，避免每個按鍵都投遞一次
+static std::atomic<bool> g_keyDrainPending(false);
+
+// 將攔截的按鍵交給引擎：常數時間、不配置記憶體、不加鎖
+static void postKeyToEngine(DWORD key, const KBDLLHOOKSTRUCT* pKeyboard) {
+    KeyEvent ev;
+    ev.vkCode = key;
+    ev.modifiers = KEYMOD_NONE;
+    if (g_state.shiftPressed) ev.modifiers |= KEYMOD_SHIFT;
+    if (GetKeyState(VK_CONTROL) & 0x8000) ev.modifiers |= KEYMOD_CTRL;
+    if (GetKeyState(VK_CAPITAL) & 0x0001) ev.modifiers |= KEYMOD_CAPSLOCK;
+    ev.timestamp = pKeyboard ? pKeyboard->time : GetTickCount();
+    
+    if (!g_keyEventQueue.push(ev)) {
+        // 佇列已滿（引擎長時間未回應）或還有未處理的逐鍵訊息：退回逐鍵訊息，
+        // 處理前會先清空佇列；逐鍵訊息處理完之前之後的按鍵也走這裡，保持輸入順序
+        if (!PostMessage(g_state.hWnd, WM_USER+100, key, ev.modifiers)) g_keyEventQueue.cancelPosted();
+        return;
+    }
+    if (!g_keyDrainPending.exchange(true, std::memory_order_acq_rel)) {
+        PostMessage(g_state.hWnd, WM_USER+101, 0, 0);
+    }
+}
+
+void drainKeyEvents(HWND hwnd) {
+    // 先清除旗標再取出，確保之後入列的按鍵會再投遞一次喚醒訊息
+    g_keyDrainPending.store(false, std::memory_order_release);
+    
+    KeyEvent ev;
+    while (g_keyEventQueue.pop(ev)) {
+        DWORD waited = GetTickCount() - ev.timestamp;
+        LatencyStats::record(LatencyStats::STAGE_KEY_QUEUE, (uint64_t)waited * 1000000);
+        WindowManager::handleKeyboardInput(hwnd, ev.vkCode, ev.modifiers);
+    }
+}
+
+void handlePostedKey(HWND hwnd, WPARAM key, LPARAM modifiers) {
+    // 先處理已入列的按鍵（都比這個按鍵早）
+    drainKeyEvents(hwnd);
+    WindowManager::handleKeyboardInput(hwnd, key, (uint32_t)modifiers);
+    g_keyEventQueue.postedHandled();
+}
+
 // 確保目標視窗有焦點
 void ensureTargetWindowFocused() {
     HWND hForeground = GetForegroundWindow();
@@ -41,65 +94,266 @@ void ensureTargetWindowFocused() {
     if (attached) {
         AttachThreadInput(currentThread, targetThread, FALSE);
     }
+    // 不再固定等待：焦點實際轉移由 sendTextDirectUnicode 的焦點狀態機以視窗事件確認
+}
+
+// ========== 文字輸出 ==========
+
+// 以 SendInput 實作的輸出端：每批只呼叫一次 SendInput（每個 UTF-16 單元一組按下/放開）
+class SendInputSink : public TextOutput::OutputSink {
+public:
+    size_t send(const wchar_t* units, size_t count) {
+        inputs_.resize(count * 2);
+        for (size_t i = 0; i < count; i++) {
+            INPUT& down = inputs_[i * 2];
+            ZeroMemory(&down, sizeof(INPUT));
+            down.type = INPUT_KEYBOARD;
+            down.ki.wScan = units[i];
+            down.ki.dwFlags = KEYEVENTF_UNICODE;
+            
+            INPUT& up = inputs_[i * 2 + 1];
+            up = down;
+            up.ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
+        }
+        
+        UINT inserted = SendInput((UINT)inputs_.size(), inputs_.data(), sizeof(INPUT));
+        if (inserted % 2) {
+            // 只插入了按下事件：補送放開，避免目標程式認為按鍵卡住
+            SendInput(1, &inputs_[inserted], sizeof(INPUT));
+            inserted++;
+        }
+        return inserted / 2;
+    }
+    
+    // 以前景視窗類別區分目標，各自記住適合的節奏
+    std::wstring targetId() {
+        wchar_t className[128] = {0};
+        HWND hForeground = GetForegroundWindow();
+        if (hForeground) GetClassNameW(hForeground, className, 128);
+        return className;
+    }
     
-    Sleep(50);
+private:
+    std::vector<INPUT> inputs_;   // 重複使用，避免每批重新配置
+};
+
+static SendInputSink g_sendInputSink;
+static TextOutput::OutputQueue* g_outputQueue = nullptr;
+static int g_appliedOutputChunk = -1;
+static int g_appliedOutputDelay = -1;
+
+// 工作執行緒回報的最新進度（UI 執行緒在 WM_USER+102 中讀取）
+static std::mutex g_outputProgressMutex;
+static TextOutput::Progress g_outputProgress;
+static std::atomic<bool> g_outputNotifyPending(false);
+
+// 送出期間隱藏的暫放視窗，全部送完後恢復
+static bool g_restoreBufferFocus = false;
+static RECT g_restoreBufferRect = {0};
+
+static void onOutputProgress(const TextOutput::Progress& progress) {
+    {
+        std::lock_guard<std::mutex> lock(g_outputProgressMutex);
+        g_outputProgress = progress;
+    }
+    if (!g_outputNotifyPending.exchange(true, std::memory_order_acq_rel)) {
+        PostMessage(g_state.hWnd, WM_USER+102, 0, 0);
+    }
 }
 
-void sendTextDirectUnicode(const std::wstring& text) {
-    if (text.empty()) return;
+static TextOutput::OutputQueue& outputQueue() {
+    if (!g_outputQueue) {
+        g_outputQueue = new TextOutput::OutputQueue(g_sendInputSink, onOutputProgress);
+    }
+    // 設定檔重新載入後套用新的節奏
+    if (g_appliedOutputChunk != g_state.outputMaxChunk || g_appliedOutputDelay != g_state.outputChunkDelay) {
+        TextOutput::PacingConfig config;
+        config.maxChunk = (size_t)std::max(1, g_state.outputMaxChunk);
+        config.chunkDelayMs = (unsigned)std::max(0, g_state.outputChunkDelay);
+        g_outputQueue->setConfig(config);
+        g_appliedOutputChunk = g_state.outputMaxChunk;
+        g_appliedOutputDelay = g_state.outputChunkDelay;
+    }
+    return *g_outputQueue;
+}
+
+static bool isOutputBusy() {
+    return g_outputQueue && !g_outputQueue->idle();
+}
+
+// ========== 輸出前的焦點等待 ==========
+// 過去以固定 Sleep 等待暫放視窗隱藏、焦點回到目標程式；
+// 現在由視窗事件（前景切換、視窗隱藏）推動狀態機，目標就緒即送出，逾時仍照常送出
+
+static const UINT_PTR FOCUS_TIMEOUT_TIMER_ID = 993;
+
+static bool isImeWindow(HWND hwnd) {
+    return hwnd == g_state.hWnd || hwnd == g_state.hCandWnd ||
+           hwnd == g_state.hInputWnd || hwnd == g_state.hBufferWnd;
+}
+
+static void restoreBufferWindow(GlobalState& state) {
+    if (!state.bufferMode || !state.hBufferWnd) return;
+    
+    // 送出期間暫放內容可能已改變（例如已清空），依目前內容重新計算高度
+    if (state.useOptimizedUI) {
+        WindowManager::updateBufferWindowPosition(state);
+    } else {
+        SetWindowPos(state.hBufferWnd, HWND_TOPMOST, 
+                    g_restoreBufferRect.left, g_restoreBufferRect.top,
+                    FIXED_WIDTH, BufferManager::calculateBufferWindowHeight(state),
+                    SWP_SHOWWINDOW | SWP_NOACTIVATE);
+    }
+    InvalidateRect(state.hBufferWnd, nullptr, TRUE);
     
-    bool wasBufferFocused = g_state.bufferHasFocus;
-    bool wasBufferVisible = g_state.bufferMode && g_state.hBufferWnd && IsWindowVisible(g_state.hBufferWnd);
-    RECT originalRect = {0};
+    if (g_restoreBufferFocus) {
+        state.bufferHasFocus = true;
+        SetTimer(state.hBufferWnd, 1, 500, NULL);
+    }
+}
+
+class WindowFocusEnvironment : public FocusTracker::FocusEnvironment {
+public:
+    bool bufferVisible() {
+        return g_state.hBufferWnd && IsWindowVisible(g_state.hBufferWnd);
+    }
     
-    if (g_state.bufferMode && g_state.hBufferWnd && wasBufferVisible) {
-        GetWindowRect(g_state.hBufferWnd, &originalRect);
+    void hideBuffer() {
+        GetWindowRect(g_state.hBufferWnd, &g_restoreBufferRect);
+        g_restoreBufferFocus = g_state.bufferHasFocus;
         g_state.bufferHasFocus = false;
         ShowWindow(g_state.hBufferWnd, SW_HIDE);
-        Sleep(50);
     }
     
+    void restoreBuffer() {
+        restoreBufferWindow(g_state);
+    }
     
-    for (wchar_t ch : text) {
-        INPUT input = {0};
-        input.type = INPUT_KEYBOARD;
-        input.ki.wVk = 0;
-        input.ki.wScan = ch;
-        input.ki.dwFlags = KEYEVENTF_UNICODE;
-        input.ki.time = 0;
-        input.ki.dwExtraInfo = 0;
-        SendInput(1, &input, sizeof(INPUT));
-        
-        input.ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
-        SendInput(1, &input, sizeof(INPUT));
-        
-        
-        INPUT flushInput = {0};
-        flushInput.type = INPUT_KEYBOARD;
-        flushInput.ki.wVk = VK_PACKET;
-        flushInput.ki.dwFlags = KEYEVENTF_KEYUP;
-        SendInput(1, &flushInput, sizeof(INPUT));
-        
-        Sleep(8);
+    bool targetHasFocus() {
+        HWND hForeground = GetForegroundWindow();
+        return hForeground && !isImeWindow(hForeground);
     }
     
-    if (g_state.bufferMode && g_state.hBufferWnd && wasBufferVisible) {
-        Sleep(100);
-        
-        SetWindowPos(g_state.hBufferWnd, HWND_TOPMOST, 
-                    originalRect.left, originalRect.top,
-                    originalRect.right - originalRect.left, 
-                    originalRect.bottom - originalRect.top,
-                    SWP_SHOWWINDOW | SWP_NOACTIVATE);
-        
-        if (wasBufferFocused) {
-            g_state.bufferHasFocus = true;
-            SetTimer(g_state.hBufferWnd, 1, 500, NULL);
-        }
+    void releaseOutput(bool timedOut) {
+        (void)timedOut;
+        outputQueue().openGate();
+    }
+    
+    void holdOutput() {
+        if (g_outputQueue) g_outputQueue->closeGate();
+    }
+    
+    void scheduleTimeout(unsigned ms) {
+        SetTimer(g_state.hWnd, FOCUS_TIMEOUT_TIMER_ID, ms, NULL);
+    }
+    
+    void cancelTimeout() {
+        KillTimer(g_state.hWnd, FOCUS_TIMEOUT_TIMER_ID);
+    }
+};
+
+static WindowFocusEnvironment g_focusEnvironment;
+static FocusTracker::FocusStateMachine g_focusMachine(g_focusEnvironment);
+static HWINEVENTHOOK g_foregroundHook = NULL;
+static HWINEVENTHOOK g_hideHook = NULL;
+
+// WINEVENT_OUTOFCONTEXT：回呼在安裝鉤子的執行緒（UI 執行緒）的訊息迴圈中執行
+static void CALLBACK FocusWinEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                       LONG idObject, LONG idChild, DWORD, DWORD) {
+    (void)hook;
+    if (event == EVENT_SYSTEM_FOREGROUND) {
+        g_focusMachine.onForegroundChanged();
+    } else if (event == EVENT_OBJECT_HIDE && hwnd == g_state.hBufferWnd &&
+               idObject == OBJID_WINDOW && idChild == CHILDID_SELF) {
+        g_focusMachine.onBufferHidden();
+    }
+}
+
+static void installFocusHooks() {
+    if (!g_foregroundHook) {
+        g_foregroundHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND,
+                                           NULL, FocusWinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
     }
+    if (!g_hideHook) {
+        // 只需要自己程序的暫放視窗隱藏事件
+        g_hideHook = SetWinEventHook(EVENT_OBJECT_HIDE, EVENT_OBJECT_HIDE,
+                                     NULL, FocusWinEventProc, GetCurrentProcessId(), 0,
+                                     WINEVENT_OUTOFCONTEXT);
+    }
+}
+
+void onFocusWaitTimeout() {
+    KillTimer(g_state.hWnd, FOCUS_TIMEOUT_TIMER_ID);
+    g_focusMachine.onTimeout();
+}
+
+void sendTextDirectUnicode(const std::wstring& text) {
+    if (text.empty()) return;
+    // 軌跡重播只量測引擎本身，不實際送出文字
+    if (TraceRecorder::isReplaying()) return;
+    LatencyStats::ScopedTimer timer(LatencyStats::STAGE_SEND_TEXT);
+    
+    TextOutput::OutputQueue& queue = outputQueue();
+    queue.setGated(true);
+    installFocusHooks();
+    
+    // 先排入再請求：目標已就緒時狀態機會立即開啟閘門
+    queue.enqueue(text);
+    g_focusMachine.requestOutput(g_state.bufferMode);
+}
+
+void handleOutputProgress(GlobalState& state) {
+    g_outputNotifyPending.store(false, std::memory_order_release);
+    
+    TextOutput::Progress progress;
+    {
+        std::lock_guard<std::mutex> lock(g_outputProgressMutex);
+        progress = g_outputProgress;
+    }
+    
+    if (!progress.done) {
+        Utils::updateStatus(state, L"發送中：" + std::to_wstring(progress.sent) + L"/" +
+                            std::to_wstring(progress.total) + L"（按Esc取消）");
+        return;
+    }
+    
+    if (progress.cancelled) {
+        Utils::updateStatus(state, L"已取消發送（已送出 " + std::to_wstring(progress.sent) + L"/" +
+                            std::to_wstring(progress.total) + L" 字）");
+    } else if (progress.sent < progress.total) {
+        Utils::updateStatus(state, L"部分文字未送出（" + std::to_wstring(progress.sent) + L"/" +
+                            std::to_wstring(progress.total) + L"），目標程式可能拒絕輸入");
+    }
+    
+    // 還有排隊中的文字時先不恢復暫放視窗
+    if (progress.queued > 0 || isOutputBusy()) return;
+    
+    // 關閉閘門並恢復暫放視窗（若送出前曾隱藏）
+    g_focusMachine.onOutputFinished();
+}
+
+void cancelPendingOutput() {
+    if (g_outputQueue) g_outputQueue->cancelAll();
+}
+
+void shutdownOutput() {
+    if (g_foregroundHook) {
+        UnhookWinEvent(g_foregroundHook);
+        g_foregroundHook = NULL;
+    }
+    if (g_hideHook) {
+        UnhookWinEvent(g_hideHook);
+        g_hideHook = NULL;
+    }
+    KillTimer(g_state.hWnd, FOCUS_TIMEOUT_TIMER_ID);
+    if (!g_outputQueue) return;
+    g_outputQueue->shutdown();
+    delete g_outputQueue;
+    g_outputQueue = nullptr;
 }
 
 void toggleInputMode(GlobalState& state) {
+    TraceRecorder::Scope trace(TraceRecorder::EVT_TOGGLE_MODE);
     state.chineseMode = !state.chineseMode;
     state.input.clear();
     state.candidates.clear();
@@ -155,6 +409,8 @@ std::wstring convertEnglishChar(wchar_t ch, bool toFullWidth) {
 
 void processStroke(GlobalState& state, DWORD key) {
     if (!state.chineseMode) return;
+    LatencyStats::ScopedTimer timer(LatencyStats::STAGE_PROCESS_STROKE);
+    TraceRecorder::Scope trace(TraceRecorder::EVT_STROKE, (int)key);
     if (key == 'P') {
         showPunctMenu(state);
         return;
@@ -181,6 +437,31 @@ void processStroke(GlobalState& state, DWORD key) {
     }
 }
 
+void backspaceInput(GlobalState& state) {
+    if (state.input.empty()) return;
+    TraceRecorder::Scope trace(TraceRecorder::EVT_INPUT_BACK);
+    state.input.pop_back();
+    Dictionary::updateCandidates(state);
+    if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
+}
+
+void cancelInput(GlobalState& state) {
+    TraceRecorder::Scope trace(TraceRecorder::EVT_CANCEL);
+    state.input.clear();
+    state.candidates.clear();
+    state.candidateCodes.clear();
+    state.showCand = false;
+    state.isInputting = false;
+    state.inputError = false;
+    state.showPunctMenu = false;
+    if (state.hCandWnd) ShowWindow(state.hCandWnd, SW_HIDE);
+    if (state.hInputWnd) ShowWindow(state.hInputWnd, SW_HIDE);
+    // 🔥 恢復 Windows 輸入法狀態（取消輸入後）
+    IMEManager::restoreWindowsIME();
+    Utils::updateStatus(state, L"輸入已取消");
+    if (state.hWnd) InvalidateRect(state.hWnd, nullptr, TRUE);
+}
+
 void showPunctMenu(GlobalState& state) {
     state.showPunctMenu = true;
     state.candidates = state.punctCandidates;
@@ -203,9 +484,8 @@ void showPunctMenu(GlobalState& state) {
     Utils::updateStatus(state, L"全形標點符號選單（按ESC關閉）");
 }
 
-void processPunctuator(GlobalState& state, DWORD key) {
+void processPunctuator(GlobalState& state, DWORD key, bool isShiftPressed) {
     std::wstring punctChar = L"";
-    bool isShiftPressed = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
     
     switch (key) {
         case VK_OEM_COMMA: punctChar = isShiftPressed ? L"<" : L","; break;
@@ -271,6 +551,9 @@ void processPunctuator(GlobalState& state, DWORD key) {
 }
 
 LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    // 低階鉤子逾時會被系統移除，常駐計時以便觀察每鍵耗時
+    LatencyStats::ScopedTimer hookTimer(LatencyStats::STAGE_HOOK_PROC);
+    
     if (nCode >= 0) {
         KBDLLHOOKSTRUCT* pKeyboard = (KBDLLHOOKSTRUCT*)lParam;
         DWORD key = pKeyboard->vkCode;
@@ -301,6 +584,33 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
             }
         }
         
+        // 暫放區搜尋/取代：鉤子只判斷按鍵，實際搜尋在主視窗 WM_USER+103 中執行
+        if (wParam == WM_KEYDOWN && g_state.bufferMode) {
+            int findCommand = -1;
+            if (ctrl && g_state.bufferHasFocus && (key == 'F' || key == 'H')) {
+                findCommand = key == 'F' ? BufferManager::FIND_OPEN : BufferManager::FIND_OPEN_REPLACE;
+            } else if (g_state.findActive && !g_state.isInputting && !g_state.showCand && !g_state.showPunctMenu) {
+                bool shift = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
+                if (key == VK_ESCAPE) {
+                    findCommand = BufferManager::FIND_CLOSE;
+                } else if (key == VK_RETURN && ctrl) {
+                    findCommand = BufferManager::FIND_REPLACE_ALL;
+                } else if (key == VK_RETURN) {
+                    findCommand = g_state.findField == 1 ? BufferManager::FIND_REPLACE
+                                : shift ? BufferManager::FIND_PREV : BufferManager::FIND_NEXT;
+                } else if (key == VK_F3) {
+                    findCommand = shift ? BufferManager::FIND_PREV : BufferManager::FIND_NEXT;
+                } else if (key == VK_TAB && !ctrl) {
+                    findCommand = BufferManager::FIND_SWITCH_FIELD;
+                }
+            }
+            if (findCommand >= 0) {
+                if (g_state.shiftPressed) g_state.shiftUsedForCombo = true;
+                PostMessage(g_state.hWnd, WM_USER+103, (WPARAM)findCommand, 0);
+                return 1;
+            }
+        }
+        
         if (ctrl) {
             // Ctrl+其他鍵都直接放行，不攔截
             return CallNextHookEx(g_hKeyboardHook, nCode, wParam, lParam);
@@ -394,10 +704,16 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
             }
 
             if (key == VK_ESCAPE) {
+    // 背景輸出進行中：Esc 取消尚未送出的文字
+    if (isOutputBusy()) {
+        cancelPendingOutput();
+        return 1;
+    }
+    
     // 只有當輸入法真的需要處理ESC時才攔截
     if (g_state.showCand || g_state.showPunctMenu || g_state.isInputting) {
         // 有候選字、標點選單或正在輸入時，由輸入法處理
-        PostMessage(g_state.hWnd, WM_USER+100, VK_ESCAPE, 0);
+        postKeyToEngine(VK_ESCAPE, pKeyboard);
         return 1;
     }
     
@@ -414,7 +730,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
             // 數字鍵優先用於選字
             if (key >= '1' && key <= '9') {
                 if (g_state.showCand && g_state.isInputting) {
-                    PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                    postKeyToEngine(key, pKeyboard);
                     return 1;
                 }
             }
@@ -462,7 +778,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
             if (isBufferWindowActive) {
                 // 如果有候選字或標點符號選單打開，數字鍵應該用於選擇候選項
                 if ((g_state.showCand || g_state.showPunctMenu) && (key >= '1' && key <= '9')) {
-                    PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                    postKeyToEngine(key, pKeyboard);
                     return 1;
                 }
                 
@@ -473,10 +789,12 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                         case VK_RIGHT: BufferManager::moveCursor(g_state, 1); break;
                         case VK_HOME: 
                             g_state.bufferCursorPos = 0;
+                            TraceRecorder::record(TraceRecorder::EVT_BUFFER_CURSOR, g_state.bufferCursorPos);
                             if (g_state.hBufferWnd) InvalidateRect(g_state.hBufferWnd, nullptr, TRUE);
                             break;
                         case VK_END: 
                             g_state.bufferCursorPos = g_state.bufferText.length();
+                            TraceRecorder::record(TraceRecorder::EVT_BUFFER_CURSOR, g_state.bufferCursorPos);
                             if (g_state.hBufferWnd) InvalidateRect(g_state.hBufferWnd, nullptr, TRUE);
                             break;
                     }
@@ -489,7 +807,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                         BufferManager::deleteCharAtCursor(g_state, false);
                         return 1;
                     } else if (g_state.isInputting && !g_state.input.empty()) {
-                        PostMessage(g_state.hWnd, WM_USER+100, VK_BACK, 0);
+                        postKeyToEngine(VK_BACK, pKeyboard);
                         return 1;
                     } else if (!g_state.bufferText.empty()) {
                         BufferManager::deleteCharAtCursor(g_state, false);
@@ -511,7 +829,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                 bool isNumpadStrokeKey = (key == VK_NUMPAD7 || key == VK_NUMPAD8 || key == VK_NUMPAD9 || 
                                          key == VK_NUMPAD4 || key == VK_NUMPAD5 || key == VK_NUMPAD0);
                 if (isNumpadStrokeKey && g_state.chineseMode) {
-                    PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                    postKeyToEngine(key, pKeyboard);
                     return 1;
                 }
 				
@@ -523,7 +841,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                            key == VK_NUMPAD9 || key == VK_NUMPAD4 || 
                            key == VK_NUMPAD5 || key == VK_NUMPAD0);
         if (isStrokeKey) {
-            PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+            postKeyToEngine(key, pKeyboard);
             return 1;
         }
     }
@@ -559,7 +877,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                 // 普通筆劃輸入（包含P鍵用於標點選單）
                 bool isStrokeKey = (key == 'U' || key == 'I' || key == 'O' || key == 'J' || key == 'K' || key == 'L' || key == 'P');
                 if (isStrokeKey && g_state.chineseMode) {
-                    PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                    postKeyToEngine(key, pKeyboard);
                     return 1;
                 }
                 
@@ -599,7 +917,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                 if (key >= 'A' && key <= 'Z') {
                     // 中文模式下P鍵用於標點符號選單，不當作普通字母處理
                     if (key == 'P' && g_state.chineseMode) {
-                        PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                        postKeyToEngine(key, pKeyboard);
                         return 1;
                     }
                     
@@ -675,7 +993,7 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
             // Enter鍵處理
             if (key == VK_RETURN) {
                 if (isBufferWindowActive && !g_state.showCand && !g_state.isInputting && !g_state.bufferText.empty()) {
-                    PostMessage(g_state.hWnd, WM_USER+100, VK_RETURN, 0);
+                    postKeyToEngine(VK_RETURN, pKeyboard);
                     return 1;
                 }
             }
@@ -704,14 +1022,14 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
                     // 中文模式：攔截筆劃鍵、標點符號和功能鍵
                     // 注意：Windows IME 已在函數開頭統一禁用，這裡不需要重複調用
                     if (isStrokeKey || isPunctKey || (key == VK_SPACE && g_state.isInputting) || isFunctionKey) {
-                        PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                        postKeyToEngine(key, pKeyboard);
                         return 1;
                     }
                 } else {
                     // 英文模式：只在有候選字或輸入狀態時才攔截功能鍵
                     // 標點符號直接放行，讓系統處理
                     if (isFunctionKey) {
-                         PostMessage(g_state.hWnd, WM_USER+100, key, 0);
+                         postKeyToEngine(key, pKeyboard);
                          return 1;
                     }
                     // 英文模式下標點符號直接放行，不攔截
@@ -728,4 +1046,106 @@ LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
     return CallNextHookEx(g_hKeyboardHook, nCode, wParam, lParam);
 }
 
+// ========== 按鍵軌跡錄製與重播 ==========
+
+void recordTraceSync(const GlobalState& state) {
+    if (!TraceRecorder::isRecording()) return;
+    int flags = 0;
+    if (state.chineseMode) flags |= TraceRecorder::SYNC_CHINESE_MODE;
+    if (state.bufferMode) flags |= TraceRecorder::SYNC_BUFFER_MODE;
+    TraceRecorder::record(TraceRecorder::EVT_SYNC, flags, state.bufferCursorPos, state.bufferText.str());
+}
+
+void toggleTraceRecording(GlobalState& state) {
+    if (TraceRecorder::isRecording()) {
+        uint32_t count = TraceRecorder::recordedCount();
+        TraceRecorder::stop();
+        Utils::updateStatus(state, L"軌跡錄製已停止（" + std::to_wstring(count) + L" 個事件）");
+        return;
+    }
+    if (!TraceRecorder::start("keystroke_trace.txt")) {
+        Utils::updateStatus(state, L"無法建立 keystroke_trace.txt");
+        return;
+    }
+    // 第一個事件記錄起始狀態，重播時從相同狀態開始
+    recordTraceSync(state);
+    Utils::updateStatus(state, L"開始錄製按鍵軌跡");
+}
+
+// 把軌跡事件對應到引擎函式；暫存狀態沒有視窗，繪製與定位都會被略過
+class EngineReplayTarget : public TraceRecorder::ReplayTarget {
+public:
+    explicit EngineReplayTarget(GlobalState& state) : state_(state) {}
+
+    void apply(const TraceRecorder::TraceEvent& ev) {
+        switch (ev.type) {
+            case TraceRecorder::EVT_SYNC:
+                state_.chineseMode = (ev.arg1 & TraceRecorder::SYNC_CHINESE_MODE) != 0;
+                state_.bufferMode = (ev.arg1 & TraceRecorder::SYNC_BUFFER_MODE) != 0;
+                state_.bufferText = ev.text;
+                state_.bufferLayout.invalidate();
+                state_.editHistory.clear();
+                state_.hasSelection = false;
+                setCursor(ev.arg2);
+                break;
+            case TraceRecorder::EVT_STROKE: processStroke(state_, (DWORD)ev.arg1); break;
+            case TraceRecorder::EVT_SELECT: Dictionary::selectCandidate(state_, ev.arg1); break;
+            case TraceRecorder::EVT_PAGE: Dictionary::changePage(state_, ev.arg1); break;
+            case TraceRecorder::EVT_TOGGLE_MODE: toggleInputMode(state_); break;
+            case TraceRecorder::EVT_INPUT_BACK: backspaceInput(state_); break;
+            case TraceRecorder::EVT_CANCEL: cancelInput(state_); break;
+            case TraceRecorder::EVT_BUFFER_INSERT: BufferManager::insertTextAtCursor(state_, ev.text); break;
+            case TraceRecorder::EVT_BUFFER_DELETE: BufferManager::deleteCharAtCursor(state_, ev.arg1 != 0); break;
+            case TraceRecorder::EVT_BUFFER_DELETE_SELECTION:
+                state_.selectionStart = ev.arg1;
+                state_.selectionEnd = ev.arg2;
+                state_.hasSelection = true;
+                BufferManager::deleteSelection(state_);
+                break;
+            case TraceRecorder::EVT_BUFFER_MOVE: BufferManager::moveCursor(state_, ev.arg1); break;
+            case TraceRecorder::EVT_BUFFER_CURSOR: setCursor(ev.arg1); break;
+            default: break;
+        }
+    }
+
+private:
+    void setCursor(int pos) {
+        if (pos < 0) pos = 0;
+        if (pos > (int)state_.bufferText.length()) pos = state_.bufferText.length();
+        state_.bufferCursorPos = pos;
+    }
+
+    GlobalState& state_;
+};
+
+// 與 Linux 的 make replay-bench（TraceReplay::Frontend）相同的重播與報表，但經過實際的前端函式
+bool replayTraceBenchmark(const GlobalState& source, const char* path, std::string& report) {
+    // 複製字典與設定到暫存狀態，不影響正在使用中的輸入法
+    GlobalState scratch = source;
+    scratch.hWnd = NULL;
+    scratch.hCandWnd = NULL;
+    scratch.hBufferWnd = NULL;
+    scratch.hInputWnd = NULL;
+    scratch.clipboardMode = false;
+    scratch.bufferHasFocus = false;
+    scratch.findActive = false;
+    scratch.input.clear();
+    scratch.candidates.clear();
+    scratch.candidateCodes.clear();
+    scratch.showCand = false;
+    scratch.isInputting = false;
+    scratch.showPunctMenu = false;
+    scratch.hasSelection = false;
+    scratch.editHistory.clear();
+
+    EngineReplayTarget target(scratch);
+    TraceRecorder::ReplayResult result;
+    if (!TraceReplay::replayFile(path, target, result)) return false;
+    // 重播的選擇也送到了共用字典服務：恢復使用中的學習
+    Dictionary::syncQueryLearning(source);
+
+    report = TraceRecorder::formatResult(result);
+    return true;
+}
+
 } // namespace InputHandler
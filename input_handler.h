@@ -8,6 +8,11 @@ namespace InputHandler {
     // 鍵盤鉤子程序
     LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
     
+    // 取出鉤子佇列中的按鍵並交由引擎處理（WM_USER+101）
+    void drainKeyEvents(HWND hwnd);
+    // 佇列滿時的逐鍵訊息（WM_USER+100，lParam 為 KeyModifier）：先取出佇列中較早的按鍵再處理
+    void handlePostedKey(HWND hwnd, WPARAM key, LPARAM modifiers);
+    
     // 輸入模式切換
     void toggleInputMode(GlobalState& state);
     
@@ -17,20 +22,44 @@ namespace InputHandler {
     // 筆劃輸入處理
     void processStroke(GlobalState& state, DWORD key);
     
+    // 字碼退格（Backspace）與取消輸入（Esc）
+    void backspaceInput(GlobalState& state);
+    void cancelInput(GlobalState& state);
+    
     // 標點符號處理
-    void processPunctuator(GlobalState& state, DWORD key);
+    // isShiftPressed 為按鍵當下的 Shift 狀態（見 KeyEvent::modifiers）
+    void processPunctuator(GlobalState& state, DWORD key, bool isShiftPressed);
     
     // 顯示標點選單
     void showPunctMenu(GlobalState& state);
     
-    // 文字發送
+    // 文字發送（排入背景輸出佇列，分批以 SendInput 送出，不阻塞 UI 執行緒）
     void sendTextDirectUnicode(const std::wstring& text);
     
+    // 背景輸出進度（WM_USER+102）：更新狀態列，全部送完後恢復暫放視窗
+    void handleOutputProgress(GlobalState& state);
+    
+    // 取消尚未送出的文字
+    void cancelPendingOutput();
+    
+    // 等待目標取得焦點逾時（計時器 993）：不再等待，直接送出
+    void onFocusWaitTimeout();
+    
+    // 結束背景輸出執行緒並移除視窗事件鉤子（程式結束前呼叫）
+    void shutdownOutput();
+    
     // 確保目標視窗有焦點（用於文字發送前）
     void ensureTargetWindowFocused();
     
     // 英文字元轉換（全形/半形）
     std::wstring convertEnglishChar(wchar_t ch, bool toFullWidth);
+    
+    // 按鍵軌跡錄製（檔案：keystroke_trace.txt）
+    void toggleTraceRecording(GlobalState& state);
+    // 記錄目前模式與暫放內容，供重播時對齊狀態（未錄製時不做任何事）
+    void recordTraceSync(const GlobalState& state);
+    // 以暫存狀態重播軌跡檔（不操作視窗、不送出文字），成功時回傳報表
+    bool replayTraceBenchmark(const GlobalState& source, const char* path, std::string& report);
 }
 
 #endif // INPUT_HANDLER_H
\ No newline at end of file
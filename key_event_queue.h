@@ -0,0 +1,115 @@
+// key_event_queue.h - 鍵盤鉤子與引擎之間的無鎖單生產者/單消費者佇列
+#ifndef KEY_EVENT_QUEUE_H
+#define KEY_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 修飾鍵狀態（按鍵發生當下由鉤子記錄）
+enum KeyModifier : uint32_t {
+    KEYMOD_NONE     = 0,
+    KEYMOD_SHIFT    = 1u << 0,
+    KEYMOD_CTRL     = 1u << 1,
+    KEYMOD_CAPSLOCK = 1u << 2
+};
+
+// 按鍵事件：由 KeyboardHookProc 產生，由引擎（主視窗訊息迴圈）取出處理
+struct KeyEvent {
+    uint32_t vkCode;      // 虛擬鍵碼
+    uint32_t modifiers;   // KeyModifier 組合：引擎依按鍵當下的 Shift 判斷標點，不讀取處理時的鍵盤狀態
+    uint32_t timestamp;   // 鉤子提供的時間戳（毫秒，與 GetTickCount 同基準），用於統計排隊時間
+};
+
+// 固定容量的環形緩衝區
+// - 只允許一個執行緒 push、一個執行緒 pop
+// - push/pop 皆為常數時間，不配置記憶體、不加鎖（wait-free）
+// - Capacity 必須為 2 的冪
+template <typename T, size_t Capacity>
+class SpscRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRingBuffer capacity must be a power of two");
+
+public:
+    SpscRingBuffer() : head_(0), tail_(0), cachedHead_(0), cachedTail_(0) {}
+
+    // 生產者端：佇列已滿時回傳 false（不會阻塞）
+    bool push(const T& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == Capacity) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == Capacity) return false;
+        }
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消費者端：佇列為空時回傳 false
+    bool pop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) return false;
+        }
+        item = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似值：僅供統計或判斷是否需要喚醒，不可作為同步依據
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static size_t capacity() { return Capacity; }
+
+private:
+    SpscRingBuffer(const SpscRingBuffer&);
+    SpscRingBuffer& operator=(const SpscRingBuffer&);
+
+    // head/tail 分開放在不同快取行，避免生產者與消費者互相干擾
+    alignas(64) std::atomic<size_t> head_;   // 消費者寫入
+    alignas(64) std::atomic<size_t> tail_;   // 生產者寫入
+    alignas(64) size_t cachedHead_;          // 生產者私有：最後看到的 head
+    alignas(64) size_t cachedTail_;          // 消費者私有：最後看到的 tail
+    alignas(64) T slots_[Capacity];
+};
+
+// 環形佇列加上佇列滿時的退回路徑，並保持按鍵順序：
+// - push 失敗時生產者改以逐鍵訊息送出（例如 PostMessage），消費者處理該訊息前先取出佇列中較早的按鍵
+// - 逐鍵訊息都處理完之前，之後的按鍵也走逐鍵訊息而不入列：
+//   否則較晚入列的按鍵會在消費者處理逐鍵訊息前先被取出，順序顛倒
+// - 逐鍵訊息之間的順序由訊息佇列保證（先投遞先處理）
+template <typename T, size_t Capacity>
+class SpscHandoff {
+public:
+    SpscHandoff() : posted_(0) {}
+
+    // 生產者端：回傳 true 表示已入列；false 表示呼叫端要以逐鍵訊息送出這個項目
+    bool push(const T& item) {
+        // 只有生產者增加 posted_：讀到 0 之後不會在入列前變成非 0
+        if (posted_.load(std::memory_order_acquire) == 0 && queue_.push(item)) return true;
+        posted_.fetch_add(1, std::memory_order_acq_rel);
+        return false;
+    }
+    // 生產者端：逐鍵訊息投遞失敗（不會被處理）
+    void cancelPosted() { posted_.fetch_sub(1, std::memory_order_acq_rel); }
+
+    // 消費者端
+    bool pop(T& item) { return queue_.pop(item); }
+    // 消費者端：一個逐鍵訊息處理完畢（處理前已以 pop 取出佇列中較早的項目）
+    void postedHandled() { posted_.fetch_sub(1, std::memory_order_acq_rel); }
+
+    size_t size() const { return queue_.size(); }
+    size_t postedCount() const { return (size_t)posted_.load(std::memory_order_acquire); }
+
+private:
+    SpscRingBuffer<T, Capacity> queue_;
+    std::atomic<int> posted_;   // 已投遞、尚未處理的逐鍵訊息數
+};
+
+// 鍵盤鉤子使用的按鍵佇列（256 筆遠高於人類打字速度所需）
+typedef SpscHandoff<KeyEvent, 256> KeyEventQueue;
+
+#endif // KEY_EVENT_QUEUE_H
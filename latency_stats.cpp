@@ -0,0 +1,177 @@
+// latency_stats.cpp - 按鍵處理延遲統計實作
+#include "latency_stats.h"
+#include <cstdio>
+#include <fstream>
+
+namespace LatencyStats {
+
+Histogram::Histogram() : count_(0), max_(0) {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int Histogram::bucketIndex(uint64_t nanos) {
+    if (nanos < (uint64_t)SUB_BUCKETS) return (int)nanos;
+
+    int exponent = 63;
+    while (!(nanos & (1ULL << exponent))) exponent--;
+    if (exponent > MAX_EXPONENT) return BUCKET_COUNT - 1;
+
+    int sub = (int)((nanos >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) return (uint64_t)index;
+
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t sub = (uint64_t)(index % SUB_BUCKETS);
+    uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+    return ((SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS)) + width - 1;
+}
+
+void Histogram::record(uint64_t nanos) {
+    buckets_[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t prevMax = max_.load(std::memory_order_relaxed);
+    while (nanos > prevMax &&
+           !max_.compare_exchange_weak(prevMax, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::reset() {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::bucketCount(int index) const {
+    if (index < 0 || index >= BUCKET_COUNT) return 0;
+    return buckets_[index].load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::maxValue() const {
+    return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::percentile(double p) const {
+    // 以各格實際加總為準（count_ 可能與各格累加存在瞬間差異）
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    if (total == 0) return 0;
+
+    if (p < 0.0) p = 0.0;
+    if (p > 100.0) p = 100.0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // 區間上界不超過實際觀測到的最大值
+            uint64_t upper = bucketUpperBound(i);
+            uint64_t observedMax = maxValue();
+            return (observedMax > 0 && upper > observedMax) ? observedMax : upper;
+        }
+    }
+    return maxValue();
+}
+
+static Histogram g_histograms[STAGE_COUNT];
+static std::atomic<bool> g_enabled(true);
+
+void record(Stage stage, uint64_t nanos) {
+    if (stage < 0 || stage >= STAGE_COUNT) return;
+    if (!g_enabled.load(std::memory_order_relaxed)) return;
+    g_histograms[stage].record(nanos);
+}
+
+const Histogram& histogram(Stage stage) {
+    if (stage < 0 || stage >= STAGE_COUNT) stage = STAGE_HOOK_PROC;
+    return g_histograms[stage];
+}
+
+void resetAll() {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        g_histograms[i].reset();
+    }
+}
+
+void setEnabled(bool enabled) {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case STAGE_HOOK_PROC: return "KeyboardHookProc";
+        case STAGE_PROCESS_STROKE: return "processStroke";
+        case STAGE_UPDATE_CANDIDATES: return "updateCandidates";
+        case STAGE_SEND_TEXT: return "sendTextDirectUnicode";
+        case STAGE_KEY_QUEUE: return "keyQueueWait";
+        default: return "unknown";
+    }
+}
+
+std::string formatReport() {
+    std::string report;
+    char line[256];
+
+    snprintf(line, sizeof(line), "%-24s %10s %10s %10s %10s %10s\n",
+             "stage", "count", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+    report += line;
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const Histogram& h = g_histograms[i];
+        snprintf(line, sizeof(line), "%-24s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+                 stageName((Stage)i),
+                 (unsigned long long)h.count(),
+                 h.percentile(50.0) / 1000.0,
+                 h.percentile(99.0) / 1000.0,
+                 h.percentile(99.9) / 1000.0,
+                 h.maxValue() / 1000.0);
+        report += line;
+    }
+    return report;
+}
+
+bool dumpToFile(const char* path) {
+    try {
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        if (!file.is_open()) return false;
+
+        std::string report = formatReport();
+        file.write(report.c_str(), report.length());
+
+        // 附上各階段的非空區間，方便離線分析
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            const Histogram& h = g_histograms[i];
+            if (h.count() == 0) continue;
+
+            file << "\n# " << stageName((Stage)i) << " buckets (upper_ns count)\n";
+            for (int b = 0; b < Histogram::BUCKET_COUNT; b++) {
+                uint64_t n = h.bucketCount(b);
+                if (n == 0) continue;
+                file << (unsigned long long)Histogram::bucketUpperBound(b) << " "
+                     << (unsigned long long)n << "\n";
+            }
+        }
+        file.close();
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace LatencyStats
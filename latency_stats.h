@@ -0,0 +1,94 @@
+// latency_stats.h - 按鍵處理延遲統計（常駐、低開銷的分段計時與直方圖）
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace LatencyStats {
+    // 計時階段
+    enum Stage {
+        STAGE_HOOK_PROC = 0,        // KeyboardHookProc 整體
+        STAGE_PROCESS_STROKE,       // InputHandler::processStroke
+        STAGE_UPDATE_CANDIDATES,    // Dictionary::updateCandidates
+        STAGE_SEND_TEXT,            // InputHandler::sendTextDirectUnicode
+        STAGE_KEY_QUEUE,            // 按鍵從鉤子入列到引擎取出（鉤子時間戳為毫秒精度）
+        STAGE_COUNT
+    };
+
+    // HDR 風格的對數-線性直方圖（單位：奈秒）
+    // 每個 2 的冪區間再分成 16 格，相對誤差不超過 1/16
+    // record 只做原子累加，可在鉤子或工作執行緒中呼叫
+    class Histogram {
+    public:
+        static const int SUB_BUCKET_BITS = 4;
+        static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static const int MAX_EXPONENT = 40;   // 約 18 分鐘，超過者計入最後一格
+        static const int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+        Histogram();
+
+        void record(uint64_t nanos);
+        void reset();
+
+        uint64_t count() const;
+        uint64_t maxValue() const;
+        uint64_t bucketCount(int index) const;
+        // 回傳第 p 百分位（0-100）所在區間的上界，無資料時回傳 0
+        uint64_t percentile(double p) const;
+
+        static int bucketIndex(uint64_t nanos);
+        static uint64_t bucketUpperBound(int index);
+
+    private:
+        Histogram(const Histogram&);
+        Histogram& operator=(const Histogram&);
+
+        std::atomic<uint64_t> buckets_[BUCKET_COUNT];
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> max_;
+    };
+
+    // 記錄一次耗時
+    void record(Stage stage, uint64_t nanos);
+
+    // 取得指定階段的直方圖
+    const Histogram& histogram(Stage stage);
+
+    // 清除所有統計
+    void resetAll();
+
+    // 暫停/恢復記錄（軌跡重播期間暫停，避免混入實際使用的統計）
+    void setEnabled(bool enabled);
+
+    // 階段名稱（ASCII，方便寫入檔案）
+    const char* stageName(Stage stage);
+
+    // 產生文字報表（每個階段一行：次數、p50、p99、p999、最大值，單位微秒）
+    std::string formatReport();
+
+    // 將報表寫入檔案，成功回傳 true
+    bool dumpToFile(const char* path);
+
+    // 作用域計時器：建構時開始計時，解構時記錄
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Stage stage)
+            : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start_;
+            record(stage_, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        ScopedTimer(const ScopedTimer&);
+        ScopedTimer& operator=(const ScopedTimer&);
+
+        Stage stage_;
+        std::chrono::steady_clock::time_point start_;
+    };
+}
+
+#endif // LATENCY_STATS_H
@@ -3,6 +3,7 @@
 #include "window_manager.h"
 #include "input_handler.h"
 #include "dictionary.h"
+#include "dict_updater.h"
 #include "buffer_manager.h"
 #include "config_loader.h"
 #include "screen_manager.h"
@@ -25,12 +26,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         ScreenManager::updateMonitorInfo();
         
         // 載入設定
+        // 字碼表或詞語庫缺檔時在背景下載（先以內建字碼表啟動），視窗建立後才換上
+        // 有共用字典服務時由服務查詢，不在本機載入字碼表與詞語庫
         ConfigLoader::loadInterfaceConfig(g_state);
-        Dictionary::loadMainDict("Zi-Ma-Biao.txt", g_state);
+        bool sharedDicts = Dictionary::connectQueryServer(g_state);
+        if (!sharedDicts) Dictionary::loadMainDict("Zi-Ma-Biao.txt", g_state);
         Dictionary::loadPunctuator(g_state);
         Dictionary::loadPunctMenu(g_state);
         Dictionary::loadUserDict(g_state);
-        Dictionary::loadWordPhrases(g_state);  // 載入詞語庫（可選）
+        if (!sharedDicts) Dictionary::loadWordPhrases(g_state);  // 載入詞語庫（可選）
         
         // 載入位置記憶
         PositionManager::loadPositions(g_state);
@@ -51,6 +55,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
             return 1;
         }
 		
+        // 背景更新的進度與結果改由主視窗接收（建立視窗前就完成的也會補送）
+        DictUpdater::setUpdateNotifyWindow(g_state.hWnd);
+		
         // 字碼視窗初始化
         if (g_state.hInputWnd) {
             ShowWindow(g_state.hInputWnd, SW_HIDE);  // 初始隱藏
@@ -91,6 +98,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         // 啟動時自動檢查版本更新（延遲3秒，不阻塞啟動）
         SetTimer(g_state.hWnd, 994, 3000, NULL);
         
+        // 每秒檢查設定檔是否被修改（只比較修改時間與大小）
+        SetTimer(g_state.hWnd, 991, 1000, NULL);
+        
         // 訊息迴圈
         MSG msg;
         while (GetMessage(&msg, NULL, 0, 0)) {
@@ -102,9 +112,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         if (g_hKeyboardHook) {
             UnhookWindowsHookEx(g_hKeyboardHook);
         }
+        InputHandler::shutdownOutput();
+        BufferManager::shutdownJournal(g_state);
+        
+        // 取消進行中的下載（已下載的部分下次啟動時續傳）
+        DictUpdater::shutdownUpdateService();
         
         // 儲存用戶設定和學習記錄
         Dictionary::saveUserDict(g_state);
+        Dictionary::shutdownResourceRefresh();
         PositionManager::savePositions(g_state);
         
         // 移除系統托盤圖示
@@ -122,6 +138,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         if (g_hKeyboardHook) {
             UnhookWindowsHookEx(g_hKeyboardHook);
         }
+        InputHandler::shutdownOutput();
+        BufferManager::shutdownJournal(g_state);
         TrayManager::removeTrayIcon(&g_trayIcon);
         IMEManager::cleanup();
         
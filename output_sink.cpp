@@ -0,0 +1,245 @@
+// output_sink.cpp - 文字輸出：分批、節奏調整與背景送出實作
+#include "output_sink.h"
+#include <chrono>
+
+namespace TextOutput {
+
+// 連續幾批完全沒有被接受就放棄（目標程式可能已關閉或權限較高）
+static const int MAX_STALLED_CHUNKS = 5;
+
+void OutputSink::wait(unsigned ms) {
+    if (ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static bool isHighSurrogate(wchar_t ch) {
+    return (unsigned)ch >= 0xD800 && (unsigned)ch <= 0xDBFF;
+}
+
+size_t chunkEnd(const std::wstring& text, size_t pos, size_t maxUnits) {
+    if (pos >= text.size()) return text.size();
+    if (maxUnits == 0) maxUnits = 1;
+
+    size_t end = pos + maxUnits;
+    if (end >= text.size()) return text.size();
+
+    // 批次最後一個單元是高代理時，整個代理對移到下一批
+    // （4 位元組 wchar_t 不會出現代理單元，不需另外判斷寬度）
+    if (isHighSurrogate(text[end - 1])) {
+        if (end - 1 > pos) {
+            end--;
+        } else {
+            end++;   // 批次上限為 1 時，代理對仍需一起送出
+        }
+    }
+    return end;
+}
+
+std::vector<std::pair<size_t, size_t>> planChunks(const std::wstring& text, size_t maxUnits) {
+    std::vector<std::pair<size_t, size_t>> chunks;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = chunkEnd(text, pos, maxUnits);
+        chunks.push_back(std::make_pair(pos, end));
+        pos = end;
+    }
+    return chunks;
+}
+
+AdaptivePacer::AdaptivePacer(const PacingConfig& config)
+    : config_(config), chunk_(config.maxChunk ? config.maxChunk : 1), delay_(config.chunkDelayMs) {
+    if (config_.maxChunk == 0) config_.maxChunk = 1;
+    if (config_.maxDelayMs < config_.chunkDelayMs) config_.maxDelayMs = config_.chunkDelayMs;
+}
+
+void AdaptivePacer::onAccepted() {
+    // 每次放大約 1/4，避免剛恢復就立刻再被拒絕
+    if (chunk_ < config_.maxChunk) {
+        size_t grow = chunk_ / 4;
+        chunk_ += grow ? grow : 1;
+        if (chunk_ > config_.maxChunk) chunk_ = config_.maxChunk;
+    }
+    if (delay_ > config_.chunkDelayMs) {
+        delay_ -= (delay_ - config_.chunkDelayMs + 3) / 4;
+    }
+}
+
+void AdaptivePacer::onRejected() {
+    chunk_ = chunk_ > 1 ? chunk_ / 2 : 1;
+    unsigned next = delay_ ? delay_ * 2 : 10;
+    delay_ = next > config_.maxDelayMs ? config_.maxDelayMs : next;
+}
+
+void AdaptivePacer::restore(size_t chunk, unsigned delay) {
+    chunk_ = chunk < 1 ? 1 : (chunk > config_.maxChunk ? config_.maxChunk : chunk);
+    if (delay < config_.chunkDelayMs) delay = config_.chunkDelayMs;
+    delay_ = delay > config_.maxDelayMs ? config_.maxDelayMs : delay;
+}
+
+SendResult sendChunked(OutputSink& sink, AdaptivePacer& pacer, const std::wstring& text,
+                       const std::atomic<bool>* cancel,
+                       const std::function<void(size_t, size_t)>& progress) {
+    SendResult result;
+    result.total = text.size();
+
+    size_t pos = 0;
+    int stalled = 0;
+    while (pos < text.size()) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            result.cancelled = true;
+            break;
+        }
+
+        size_t end = chunkEnd(text, pos, pacer.chunkSize());
+        size_t requested = end - pos;
+        size_t accepted = sink.send(text.data() + pos, requested);
+        if (accepted > requested) accepted = requested;
+        pos += accepted;
+        result.sent = pos;
+
+        if (accepted == requested) {
+            pacer.onAccepted();
+            stalled = 0;
+        } else {
+            pacer.onRejected();
+            if (accepted == 0 && ++stalled >= MAX_STALLED_CHUNKS) break;
+            if (accepted > 0) stalled = 0;
+        }
+
+        if (progress) progress(result.sent, result.total);
+        if (pos < text.size()) sink.wait(pacer.delayMs());
+    }
+    return result;
+}
+
+// ===== 背景輸出佇列 =====
+
+OutputQueue::OutputQueue(OutputSink& sink, const ProgressCallback& callback)
+    : sink_(sink), callback_(callback), busy_(false), stopping_(false),
+      gated_(false), gateOpen_(false), nextId_(1), cancel_(false) {
+    worker_ = std::thread(&OutputQueue::workerLoop, this);
+}
+
+OutputQueue::~OutputQueue() {
+    shutdown();
+}
+
+void OutputQueue::setConfig(const PacingConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    learned_.clear();   // 設定改變後重新學習
+}
+
+void OutputQueue::setGated(bool gated) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gated_ = gated;
+    cond_.notify_all();
+}
+
+void OutputQueue::openGate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gateOpen_ = true;
+    cond_.notify_all();
+}
+
+void OutputQueue::closeGate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gateOpen_ = false;
+}
+
+uint64_t OutputQueue::enqueue(const std::wstring& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Job job;
+    job.id = nextId_++;
+    job.text = text;
+    jobs_.push_back(job);
+    cond_.notify_all();
+    return job.id;
+}
+
+void OutputQueue::cancelAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.clear();
+    cancel_.store(true, std::memory_order_relaxed);
+    cond_.notify_all();   // 喚醒等待閘門中的工作
+}
+
+bool OutputQueue::idle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.empty() && !busy_;
+}
+
+void OutputQueue::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+        jobs_.clear();
+        cancel_.store(true, std::memory_order_relaxed);
+        cond_.notify_all();
+    }
+    if (worker_.joinable()) worker_.join();
+}
+
+void OutputQueue::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (jobs_.empty() && !stopping_) cond_.wait(lock);
+            if (stopping_) return;
+            job = jobs_.front();
+            jobs_.pop_front();
+            busy_ = true;
+            cancel_.store(false, std::memory_order_relaxed);
+
+            // 等待閘門開啟；等待期間被取消時仍走完 runJob，讓接收端收到完成通知
+            while (gated_ && !gateOpen_ && !stopping_ && !cancel_.load(std::memory_order_relaxed)) {
+                cond_.wait(lock);
+            }
+            if (stopping_) return;
+        }
+        runJob(job);
+    }
+}
+
+void OutputQueue::runJob(const Job& job) {
+    // 取出這個目標先前學到的節奏
+    std::wstring target = sink_.targetId();
+    AdaptivePacer pacer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pacer = AdaptivePacer(config_);
+        std::map<std::wstring, std::pair<size_t, unsigned>>::const_iterator it = learned_.find(target);
+        if (it != learned_.end()) pacer.restore(it->second.first, it->second.second);
+    }
+
+    Progress progress;
+    progress.jobId = job.id;
+    progress.total = job.text.size();
+    progress.done = false;
+    progress.cancelled = false;
+
+    SendResult result = sendChunked(sink_, pacer, job.text, &cancel_,
+        [&](size_t sent, size_t total) {
+            if (!callback_ || sent == total) return;   // 最後一批在完成時一併通知
+            progress.sent = sent;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                progress.queued = jobs_.size();
+            }
+            callback_(progress);
+        });
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        learned_[target] = std::make_pair(pacer.chunkSize(), pacer.delayMs());
+        progress.queued = jobs_.size();
+        busy_ = false;   // 完成通知送出前先標記，讓接收端看到的 idle() 與通知一致
+    }
+    progress.sent = result.sent;
+    progress.done = true;
+    progress.cancelled = result.cancelled;
+    if (callback_) callback_(progress);
+}
+
+} // namespace TextOutput
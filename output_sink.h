@@ -0,0 +1,155 @@
+// output_sink.h - 文字輸出：分批、節奏調整與背景送出（可攜式，不依賴 Windows API）
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace TextOutput {
+    // 輸出端介面：Windows 上以 SendInput 實作，測試時可替換成記錄用的假輸出端
+    class OutputSink {
+    public:
+        virtual ~OutputSink() {}
+
+        // 送出 count 個 UTF-16 單元，回傳實際被接受的數量
+        // 少於 count 表示目標暫時無法接收（例如被 UIPI 擋下或輸入佇列已滿）
+        virtual size_t send(const wchar_t* units, size_t count) = 0;
+
+        // 目前輸出目標的識別字串（例如前景視窗類別），用來記住各程式適合的節奏
+        virtual std::wstring targetId() { return std::wstring(); }
+
+        // 批次之間的等待，預設為實際休眠
+        virtual void wait(unsigned ms);
+    };
+
+    // 節奏設定
+    struct PacingConfig {
+        size_t maxChunk;         // 每批最多 UTF-16 單元數
+        unsigned chunkDelayMs;   // 批次間的基本延遲
+        unsigned maxDelayMs;     // 目標回應不佳時延遲的上限
+        PacingConfig() : maxChunk(64), chunkDelayMs(4), maxDelayMs(200) {}
+    };
+
+    // 從 pos 開始切出最多 maxUnits 個單元的批次，回傳批次結尾（不含）
+    // 不會把代理對（surrogate pair）切在兩批之間
+    size_t chunkEnd(const std::wstring& text, size_t pos, size_t maxUnits);
+
+    // 切出整段文字的所有批次 [開始, 結尾)
+    std::vector<std::pair<size_t, size_t>> planChunks(const std::wstring& text, size_t maxUnits);
+
+    // 依輸出端回饋調整批次大小與延遲
+    // - 整批被接受：批次逐步放大回上限，延遲逐步降回基本值
+    // - 只被接受一部分：批次減半、延遲加倍（不超過上限）
+    class AdaptivePacer {
+    public:
+        explicit AdaptivePacer(const PacingConfig& config = PacingConfig());
+
+        size_t chunkSize() const { return chunk_; }
+        unsigned delayMs() const { return delay_; }
+
+        void onAccepted();
+        void onRejected();
+
+        // 套用先前為同一目標學到的狀態
+        void restore(size_t chunk, unsigned delay);
+
+    private:
+        PacingConfig config_;
+        size_t chunk_;
+        unsigned delay_;
+    };
+
+    // 送出結果
+    struct SendResult {
+        size_t sent;        // 已被接受的單元數
+        size_t total;       // 總單元數
+        bool cancelled;
+        SendResult() : sent(0), total(0), cancelled(false) {}
+        bool complete() const { return sent == total; }
+    };
+
+    // 同步分批送出（背景佇列與測試共用）
+    // cancel 可為 nullptr；progress 每送出一批呼叫一次 (sent, total)
+    SendResult sendChunked(OutputSink& sink, AdaptivePacer& pacer, const std::wstring& text,
+                           const std::atomic<bool>* cancel,
+                           const std::function<void(size_t, size_t)>& progress);
+
+    // 進度通知（在工作執行緒中呼叫，實作端應只投遞訊息、不可直接操作視窗）
+    struct Progress {
+        uint64_t jobId;
+        size_t sent;
+        size_t total;
+        bool done;          // 此工作已結束（成功、失敗或取消）
+        bool cancelled;     // 此工作被取消
+        size_t queued;      // 尚未開始的工作數
+    };
+
+    // 背景輸出佇列：依序送出文字，UI 執行緒不會因送出而阻塞
+    class OutputQueue {
+    public:
+        typedef std::function<void(const Progress&)> ProgressCallback;
+
+        OutputQueue(OutputSink& sink, const ProgressCallback& callback);
+        ~OutputQueue();
+
+        void setConfig(const PacingConfig& config);
+
+        // 啟用閘門後，工作會等到 openGate() 才開始送出（例如等待目標程式取得焦點）
+        void setGated(bool gated);
+        void openGate();
+        void closeGate();
+
+        // 排入一段文字
+        uint64_t enqueue(const std::wstring& text);
+
+        // 取消目前與排隊中的所有工作
+        void cancelAll();
+
+        // 是否沒有執行中或排隊中的工作
+        bool idle();
+
+        // 停止工作執行緒（會取消未完成的工作）
+        void shutdown();
+
+    private:
+        struct Job {
+            uint64_t id;
+            std::wstring text;
+        };
+
+        OutputQueue(const OutputQueue&);
+        OutputQueue& operator=(const OutputQueue&);
+
+        void workerLoop();
+        void runJob(const Job& job);
+
+        OutputSink& sink_;
+        ProgressCallback callback_;
+        PacingConfig config_;
+        // 各目標學到的節奏：目標識別 -> (批次大小, 延遲)
+        std::map<std::wstring, std::pair<size_t, unsigned>> learned_;
+
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::deque<Job> jobs_;
+        bool busy_;
+        bool stopping_;
+        bool gated_;
+        bool gateOpen_;
+        uint64_t nextId_;
+        std::atomic<bool> cancel_;
+        std::thread worker_;
+    };
+}
+
+#endif // OUTPUT_SINK_H
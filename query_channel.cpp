@@ -0,0 +1,400 @@
+// query_channel.cpp - 共用字典服務的本機連線實作
+#include "query_channel.h"
+#include "query_protocol.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600     // CancelIoEx、PIPE_REJECT_REMOTE_CLIENTS
+#endif
+#include <windows.h>
+#include <sddl.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace QueryChannel {
+
+std::string defaultAddress() {
+    const char* configured = getenv("STROKEIME_SERVER");
+    if (configured && *configured) return configured;
+#ifdef _WIN32
+    const char* user = getenv("USERNAME");
+    return std::string("\\\\.\\pipe\\strokeime-") + (user && *user ? user : "default");
+#else
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir) return std::string(runtimeDir) + "/strokeime.sock";
+    return "/tmp/strokeime-" + std::to_string((unsigned long)getuid()) + ".sock";
+#endif
+}
+
+std::string machineAddress() {
+#ifdef _WIN32
+    return "\\\\.\\pipe\\strokeime";
+#else
+    return "/run/strokeime/strokeime.sock";
+#endif
+}
+
+std::vector<std::string> clientAddresses() {
+    std::vector<std::string> addresses(1, defaultAddress());
+    const char* configured = getenv("STROKEIME_SERVER");
+    if (!configured || !*configured) addresses.push_back(machineAddress());
+    return addresses;
+}
+
+Stream::Stream() : handle_(-1), timeout_(0) {}
+
+Stream::~Stream() {
+    close();
+}
+
+#ifdef _WIN32
+
+// 管道以重疊 I/O 開啟：等待可以逾時，也可以被其他執行緒以 CancelIoEx 中斷
+static bool transfer(HANDLE handle, bool write, char* data, DWORD size, unsigned timeout, DWORD& done) {
+    OVERLAPPED ov = {};
+    ov.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!ov.hEvent) return false;
+    BOOL started = write ? WriteFile(handle, data, size, NULL, &ov) : ReadFile(handle, data, size, NULL, &ov);
+    bool ok = started || GetLastError() == ERROR_IO_PENDING;
+    if (ok && !started && WaitForSingleObject(ov.hEvent, timeout ? timeout : INFINITE) != WAIT_OBJECT_0) {
+        CancelIoEx(handle, &ov);
+    }
+    // 取消後仍要等待操作結束，ov 與緩衝區才可以釋放
+    if (ok) ok = GetOverlappedResult(handle, &ov, &done, TRUE) != 0;
+    CloseHandle(ov.hEvent);
+    return ok;
+}
+
+void Stream::setTimeout(unsigned milliseconds) {
+    timeout_ = milliseconds;
+}
+
+bool Stream::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        DWORD done = 0;
+        DWORD chunk = size > (1u << 20) ? (1u << 20) : (DWORD)size;
+        if (!transfer((HANDLE)handle_, true, const_cast<char*>(data), chunk, timeout_, done) || done == 0) return false;
+        data += done;
+        size -= done;
+    }
+    return true;
+}
+
+bool Stream::readAll(char* data, size_t size) {
+    while (size > 0) {
+        DWORD done = 0;
+        DWORD chunk = size > (1u << 20) ? (1u << 20) : (DWORD)size;
+        if (!transfer((HANDLE)handle_, false, data, chunk, timeout_, done) || done == 0) return false;
+        data += done;
+        size -= done;
+    }
+    return true;
+}
+
+void Stream::shutdown() {
+    if (handle_ == -1) return;
+    // 服務端的管道：中斷連線後讀寫都失敗；再取消正在等待的操作
+    DisconnectNamedPipe((HANDLE)handle_);
+    CancelIoEx((HANDLE)handle_, NULL);
+}
+
+void Stream::close() {
+    if (handle_ == -1) return;
+    CloseHandle((HANDLE)handle_);
+    handle_ = -1;
+}
+
+bool connect(const std::string& address, Stream& stream) {
+    stream.close();
+    for (int attempt = 0; attempt < 2; attempt++) {
+        // 只要求讀寫資料：GENERIC_WRITE 含建立管道的權限，全機共用的服務不會給一般使用者
+        HANDLE pipe = CreateFileA(address.c_str(), GENERIC_READ | FILE_WRITE_DATA, 0, NULL, OPEN_EXISTING,
+                                  FILE_FLAG_OVERLAPPED, NULL);
+        if (pipe != INVALID_HANDLE_VALUE) {
+            stream.handle_ = (intptr_t)pipe;
+            return true;
+        }
+        // 所有管道都在使用中：服務正在建立下一個，稍等一次
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(address.c_str(), 500)) return false;
+    }
+    return false;
+}
+
+Listener::Listener() : access_(ACCESS_USER), handle_(-1), stopEvent_(-1), interrupted_(false) {}
+
+Listener::~Listener() {
+    close();
+}
+
+// 目前使用者的 SID（字串形式）
+static std::string currentUserSid() {
+    HANDLE token = NULL;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) return std::string();
+    std::string sid;
+    DWORD size = 0;
+    GetTokenInformation(token, TokenUser, NULL, 0, &size);
+    std::vector<char> buffer(size);
+    char* text = NULL;
+    if (size && GetTokenInformation(token, TokenUser, buffer.data(), size, &size) &&
+        ConvertSidToStringSidA(((TOKEN_USER*)buffer.data())->User.Sid, &text)) {
+        sid = text;
+        LocalFree(text);
+    }
+    CloseHandle(token);
+    return sid;
+}
+
+// 明確的 DACL：預設的安全描述元讓 Everyone 可以讀取管道
+// SYSTEM 與執行服務的使用者完全控制；ACCESS_GROUP 再讓已登入的使用者讀寫資料
+// （0x12008B = FILE_GENERIC_READ | FILE_WRITE_DATA，不含建立管道的 FILE_CREATE_PIPE_INSTANCE）
+static PSECURITY_DESCRIPTOR pipeSecurity(Access access) {
+    std::string sid = currentUserSid();
+    if (sid.empty()) return NULL;
+    std::string sddl = "D:P(A;;GA;;;SY)(A;;GA;;;" + sid + ")";
+    if (access == ACCESS_GROUP) sddl += "(A;;0x12008B;;;AU)";
+    PSECURITY_DESCRIPTOR descriptor = NULL;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorA(sddl.c_str(), SDDL_REVISION_1, &descriptor, NULL)) {
+        return NULL;
+    }
+    return descriptor;
+}
+
+static HANDLE createPipe(const std::string& address, Access access, bool first) {
+    // 無法建立安全描述元時不建立管道，不退回預設的權限
+    PSECURITY_DESCRIPTOR descriptor = pipeSecurity(access);
+    if (!descriptor) return INVALID_HANDLE_VALUE;
+    SECURITY_ATTRIBUTES security = {};
+    security.nLength = sizeof(security);
+    security.lpSecurityDescriptor = descriptor;
+    security.bInheritHandle = FALSE;
+    DWORD openMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0);
+    HANDLE pipe = CreateNamedPipeA(address.c_str(), openMode,
+                                   PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                   PIPE_UNLIMITED_INSTANCES, 1 << 16, 1 << 16, 0, &security);
+    LocalFree(descriptor);
+    return pipe;
+}
+
+bool Listener::open(const std::string& address, Access access) {
+    close();
+    address_ = address;
+    access_ = access;
+    interrupted_ = false;
+    // FILE_FLAG_FIRST_PIPE_INSTANCE：已有服務建立這個管道時失敗
+    HANDLE pipe = createPipe(address, access, true);
+    if (pipe == INVALID_HANDLE_VALUE) return false;
+    HANDLE stop = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!stop) {
+        CloseHandle(pipe);
+        return false;
+    }
+    handle_ = (intptr_t)pipe;
+    stopEvent_ = (intptr_t)stop;
+    return true;
+}
+
+bool Listener::accept(Stream& stream) {
+    while (handle_ != -1 && !interrupted_) {
+        HANDLE pipe = (HANDLE)handle_;
+        OVERLAPPED ov = {};
+        ov.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        if (!ov.hEvent) return false;
+        bool connected = ConnectNamedPipe(pipe, &ov) != 0;
+        if (!connected) {
+            DWORD error = GetLastError();
+            if (error == ERROR_PIPE_CONNECTED) {
+                connected = true;
+            } else if (error == ERROR_IO_PENDING) {
+                HANDLE waits[2] = {ov.hEvent, (HANDLE)stopEvent_};
+                if (WaitForMultipleObjects(2, waits, FALSE, INFINITE) != WAIT_OBJECT_0) CancelIoEx(pipe, &ov);
+                DWORD unused = 0;
+                connected = GetOverlappedResult(pipe, &ov, &unused, TRUE) != 0;
+            }
+        }
+        CloseHandle(ov.hEvent);
+        if (interrupted_) return false;
+        if (!connected) {
+            // 對方在等待期間放棄連線（ERROR_NO_DATA 等）：重設這個管道後繼續等待
+            DisconnectNamedPipe(pipe);
+            continue;
+        }
+
+        // 連線交給 stream，再建立下一個等待連線的管道
+        stream.close();
+        stream.handle_ = handle_;
+        HANDLE next = createPipe(address_, access_, false);
+        handle_ = next == INVALID_HANDLE_VALUE ? -1 : (intptr_t)next;
+        return true;
+    }
+    return false;
+}
+
+void Listener::interrupt() {
+    interrupted_ = true;
+    if (stopEvent_ != -1) SetEvent((HANDLE)stopEvent_);
+}
+
+void Listener::close() {
+    if (handle_ != -1) CloseHandle((HANDLE)handle_);
+    if (stopEvent_ != -1) CloseHandle((HANDLE)stopEvent_);
+    handle_ = -1;
+    stopEvent_ = -1;
+}
+
+#else
+
+void Stream::setTimeout(unsigned milliseconds) {
+    timeout_ = milliseconds;
+    if (handle_ == -1) return;
+    struct timeval tv;
+    tv.tv_sec = milliseconds / 1000;
+    tv.tv_usec = (milliseconds % 1000) * 1000;
+    setsockopt((int)handle_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt((int)handle_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool Stream::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL：對方已關閉時回傳錯誤，不產生 SIGPIPE
+        ssize_t done = send((int)handle_, data, size, MSG_NOSIGNAL);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        data += done;
+        size -= (size_t)done;
+    }
+    return true;
+}
+
+bool Stream::readAll(char* data, size_t size) {
+    while (size > 0) {
+        ssize_t done = recv((int)handle_, data, size, 0);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        data += done;
+        size -= (size_t)done;
+    }
+    return true;
+}
+
+void Stream::shutdown() {
+    if (handle_ != -1) ::shutdown((int)handle_, SHUT_RDWR);
+}
+
+void Stream::close() {
+    if (handle_ == -1) return;
+    ::close((int)handle_);
+    handle_ = -1;
+}
+
+static bool socketAddress(const std::string& address, sockaddr_un& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (address.empty() || address.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, address.c_str(), address.size());
+    return true;
+}
+
+bool connect(const std::string& address, Stream& stream) {
+    stream.close();
+    sockaddr_un addr;
+    if (!socketAddress(address, addr)) return false;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    stream.handle_ = fd;
+    if (stream.timeout_) stream.setTimeout(stream.timeout_);
+    return true;
+}
+
+Listener::Listener() : access_(ACCESS_USER), handle_(-1), stopEvent_(-1), interrupted_(false) {}
+
+Listener::~Listener() {
+    close();
+}
+
+bool Listener::open(const std::string& address, Access access) {
+    close();
+    access_ = access;
+    interrupted_ = false;
+    sockaddr_un addr;
+    if (!socketAddress(address, addr)) return false;
+    // 已有服務在這個位址回應時不取代；連不上的是上次留下的檔案，可以移除
+    Stream probe;
+    if (connect(address, probe)) return false;
+    unlink(address.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    // 只有自己（ACCESS_GROUP 時加上 socket 的群組）可以連線；
+    // bind 時以 umask 建立，之後再明確設定一次，不受呼叫端的 umask 影響
+    mode_t mode = access == ACCESS_GROUP ? 0660 : 0600;
+    mode_t mask = umask(0777 & ~mode);
+    bool bound = bind(fd, (const sockaddr*)&addr, sizeof(addr)) == 0;
+    umask(mask);
+    if (bound && chmod(address.c_str(), mode) != 0) {
+        unlink(address.c_str());
+        bound = false;
+    }
+    if (!bound || listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        return false;
+    }
+    address_ = address;
+    handle_ = fd;
+    return true;
+}
+
+bool Listener::accept(Stream& stream) {
+    while (handle_ != -1 && !interrupted_) {
+        int fd = ::accept4((int)handle_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            stream.close();
+            stream.handle_ = fd;
+            return true;
+        }
+        // 對方在排隊時放棄連線等暫時性錯誤：繼續等待
+        if (errno != EINTR && errno != ECONNABORTED && errno != EPROTO) return false;
+    }
+    return false;
+}
+
+void Listener::interrupt() {
+    interrupted_ = true;
+    // 監聽的 socket shutdown 後，阻塞中的 accept 立即返回
+    if (handle_ != -1) ::shutdown((int)handle_, SHUT_RDWR);
+}
+
+void Listener::close() {
+    if (handle_ == -1) return;
+    ::close((int)handle_);
+    handle_ = -1;
+    unlink(address_.c_str());
+}
+
+#endif
+
+bool readFrame(Stream& stream, std::string& payload) {
+    char header[QueryProtocol::HEADER_SIZE];
+    if (!stream.readAll(header, sizeof(header))) return false;
+    uint32_t length = QueryProtocol::frameLength(header);
+    if (length > QueryProtocol::MAX_FRAME) return false;
+    payload.resize(length);
+    return length == 0 || stream.readAll(&payload[0], length);
+}
+
+bool writeFrame(Stream& stream, const std::string& frame) {
+    return stream.writeAll(frame.data(), frame.size());
+}
+
+}
@@ -0,0 +1,90 @@
+// query_channel.h - 共用字典服務的本機連線：Linux 為 Unix socket，Windows 為具名管道（可攜式介面）
+#ifndef QUERY_CHANNEL_H
+#define QUERY_CHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 只接受本機連線；位址預設依使用者區分（見 defaultAddress），只有同一個使用者可以連線。
+// 學習資料屬於連線（見 query_server.h），多個使用者共用一個服務時也不會共用學習
+//
+// 管理員為所有工作階段執行一個服務：以 strokeime-server -m 在 machineAddress 提供服務（ACCESS_GROUP），
+// 輸入法找不到自己的服務時連線到它（見 clientAddresses）
+// - Linux：先建立 /run/strokeime，擁有者為執行服務的帳號、群組為可使用的使用者群組、權限 2750
+//   （setgid：socket 屬於該群組）；socket 的權限為 0660，只有群組中的使用者可以連線
+// - Windows：以服務帳號執行；管道的 DACL 讓已登入的使用者讀寫，但不能建立同名的管道取代服務
+namespace QueryChannel {
+    // 環境變數 STROKEIME_SERVER 有設定時使用它，
+    // 否則 Linux 為 $XDG_RUNTIME_DIR/strokeime.sock（或 /tmp/strokeime-<uid>.sock），
+    // Windows 為 \\.\pipe\strokeime-<使用者名稱>
+    std::string defaultAddress();
+    // 全機共用的位址：Linux 為 /run/strokeime/strokeime.sock，Windows 為 \\.\pipe\strokeime
+    std::string machineAddress();
+    // 輸入法依序嘗試的位址：STROKEIME_SERVER 有設定時只有它，否則為 defaultAddress 與 machineAddress
+    std::vector<std::string> clientAddresses();
+
+    // 誰可以連線到服務
+    enum Access {
+        ACCESS_USER,        // 只有執行服務的使用者
+        ACCESS_GROUP        // Linux：socket 的群組（0660）；Windows：已登入的使用者（只能連線，不能建立管道）
+    };
+
+    class Stream {
+    public:
+        Stream();
+        ~Stream();
+        bool valid() const { return handle_ != -1; }
+        // 之後每次讀寫的逾時（毫秒，0 為不限）
+        void setTimeout(unsigned milliseconds);
+        bool writeAll(const char* data, size_t size);
+        bool readAll(char* data, size_t size);
+        // 中斷進行中的讀寫（可在其他執行緒呼叫，之後的讀寫都失敗）；close 仍由擁有者呼叫
+        void shutdown();
+        void close();
+
+    private:
+        Stream(const Stream&);
+        Stream& operator=(const Stream&);
+        friend bool connect(const std::string& address, Stream& stream);
+        friend class Listener;
+
+        intptr_t handle_;       // socket 或管道 HANDLE；-1 為未連線
+        unsigned timeout_;
+    };
+
+    // 連線到服務；沒有服務時立即回傳 false
+    bool connect(const std::string& address, Stream& stream);
+
+    class Listener {
+    public:
+        Listener();
+        ~Listener();
+        // 已有服務在這個位址時失敗（不取代執行中的服務）
+        bool open(const std::string& address, Access access = ACCESS_USER);
+        // 等待下一條連線；interrupt 之後回傳 false
+        bool accept(Stream& stream);
+        // 讓 accept 返回（可在其他執行緒呼叫）
+        void interrupt();
+        // 等 accept 的執行緒結束後呼叫
+        void close();
+
+    private:
+        Listener(const Listener&);
+        Listener& operator=(const Listener&);
+
+        std::string address_;
+        Access access_;
+        intptr_t handle_;       // Linux：監聽的 socket；Windows：等待連線的管道
+        intptr_t stopEvent_;    // Windows：interrupt 的事件
+        std::atomic<bool> interrupted_;
+    };
+
+    // 讀取一個訊框的內容（不含長度）；長度超過上限或連線中斷時回傳 false
+    bool readFrame(Stream& stream, std::string& payload);
+    bool writeFrame(Stream& stream, const std::string& frame);
+}
+
+#endif // QUERY_CHANNEL_H
@@ -0,0 +1,163 @@
+// query_client.cpp - 共用字典服務的客戶端實作
+#include "query_client.h"
+#include <functional>
+
+namespace QueryClient {
+
+using QueryProtocol::Request;
+using QueryProtocol::Reply;
+
+const unsigned Client::TIMEOUT_MS;
+
+namespace {
+
+bool sameWord(const EngineCore::WordInfo& a, const EngineCore::WordInfo& b) {
+    return a.frequency == b.frequency && a.lastUsed == b.lastUsed && a.tempCount == b.tempCount &&
+           a.isPermanent == b.isPermanent;
+}
+
+// 把 from 與 to 之中不同、或 touched 中的項目放入 patch：to 有的取代，to 沒有的刪除
+template <typename Value, typename Same>
+void diff(const std::map<std::wstring, Value>& from, const std::map<std::wstring, Value>& to,
+          const std::set<std::wstring>& touched, Same same,
+          std::map<std::wstring, Value>& changed, std::vector<std::wstring>& removed) {
+    for (const auto& pair : to) {
+        auto old = from.find(pair.first);
+        if (old == from.end() || !same(old->second, pair.second) || touched.count(pair.first)) {
+            changed.insert(pair);
+        }
+    }
+    for (const auto& pair : from) {
+        if (!to.count(pair.first)) removed.push_back(pair.first);
+    }
+    for (const auto& key : touched) {
+        if (!to.count(key) && !from.count(key)) removed.push_back(key);
+    }
+}
+
+}
+
+bool Client::connect(const std::string& address) {
+    disconnect();
+    if (!QueryChannel::connect(address, stream_)) return false;
+    stream_.setTimeout(TIMEOUT_MS);
+    Request hello;
+    Reply reply;
+    if (roundTrip(hello, reply) && reply.ok && reply.version == QueryProtocol::VERSION) return true;
+    disconnect();
+    return false;
+}
+
+void Client::disconnect() {
+    stream_.close();
+    pending_.clear();
+    synced_ = false;
+    syncedLearning_ = EngineCore::Learning();
+    touchedWords_.clear();
+    touchedContexts_.clear();
+    serverLastSelected_.clear();
+}
+
+void Client::syncLearning(const EngineCore::Learning& learning) {
+    if (!connected()) return;
+    Request request;
+    if (!synced_) {
+        // 整份取代：佇列中尚未送出的學習不再需要
+        pending_.clear();
+        request.op = QueryProtocol::OP_SYNC_LEARNING;
+        request.learning = learning;
+    } else {
+        request.op = QueryProtocol::OP_PATCH_LEARNING;
+        diff(syncedLearning_.wordFreq, learning.wordFreq, touchedWords_, sameWord,
+             request.learning.wordFreq, request.removedWords);
+        diff(syncedLearning_.contextLearning, learning.contextLearning, touchedContexts_,
+             std::equal_to<std::vector<std::wstring>>(), request.learning.contextLearning, request.removedContexts);
+        request.learning.lastSelected = learning.lastSelected;
+    }
+    synced_ = true;
+    syncedLearning_.wordFreq = learning.wordFreq;
+    syncedLearning_.contextLearning = learning.contextLearning;
+    touchedWords_.clear();
+    touchedContexts_.clear();
+    serverLastSelected_ = learning.lastSelected;
+    // 送出失敗時 disconnect 清除上面的狀態，下次連線重新整份同步
+    queue(request);
+}
+
+void Client::learn(const std::wstring& word) {
+    if (!connected()) return;
+    // 記錄服務上會改變的項目（與 EngineCore::learn 相同），下次同步時送出客戶端的版本
+    touchedWords_.insert(word);
+    if (!serverLastSelected_.empty() && serverLastSelected_ != word) touchedContexts_.insert(serverLastSelected_);
+    serverLastSelected_ = word;
+    Request request;
+    request.op = QueryProtocol::OP_LEARN;
+    request.text = word;
+    queue(request);
+}
+
+void Client::queue(const Request& request) {
+    if (pending_.size() + 2 > QueryProtocol::MAX_REQUESTS) {
+        Request hello;
+        Reply reply;
+        if (!roundTrip(hello, reply)) return;
+    }
+    pending_.push_back(request);
+}
+
+bool Client::roundTrip(const Request& request, Reply& reply) {
+    if (!connected()) return false;
+    pending_.push_back(request);
+
+    QueryProtocol::encodeRequests(pending_, frame_);
+    size_t sent = pending_.size();
+    pending_.clear();
+    bool ok = QueryChannel::writeFrame(stream_, frame_) && QueryChannel::readFrame(stream_, payload_) &&
+              QueryProtocol::decodeReplies(payload_.data(), payload_.size(), replies_) &&
+              replies_.size() == sent;
+    for (size_t i = 0; ok && i + 1 < replies_.size(); i++) ok = replies_[i].ok;
+    if (!ok || replies_.back().op != request.op) {
+        disconnect();
+        return false;
+    }
+    reply.op = request.op;
+    reply.ok = replies_.back().ok;
+    reply.version = replies_.back().version;
+    reply.lookup = replies_.back().lookup;
+    reply.candidates.swap(replies_.back().candidates);
+    reply.codes.swap(replies_.back().codes);
+    return true;
+}
+
+bool Client::lookup(EngineCore::Session& session, EngineCore::Lookup& result) {
+    Request request;
+    request.op = QueryProtocol::OP_LOOKUP;
+    request.text = session.input;
+    Reply reply;
+    if (!roundTrip(request, reply)) return false;
+    result = reply.lookup;
+    session.candidates.swap(reply.candidates);
+    session.candidateCodes.swap(reply.codes);
+    EngineCore::finishLookup(session, result);
+    return true;
+}
+
+bool Client::predict(EngineCore::Session& session, const std::wstring& word) {
+    Request request;
+    request.op = QueryProtocol::OP_PREDICT;
+    request.text = word;
+    Reply reply;
+    if (!roundTrip(request, reply)) return false;
+    session.candidates.swap(reply.candidates);
+    session.candidateCodes.swap(reply.codes);
+    return true;
+}
+
+bool Client::reloadMainDict() {
+    Request request;
+    request.op = QueryProtocol::OP_RELOAD;
+    Reply reply;
+    return roundTrip(request, reply) && reply.ok;
+}
+
+}
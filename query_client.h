@@ -0,0 +1,63 @@
+// query_client.h - 共用字典服務的客戶端（可攜式，不依賴 Windows API）
+#ifndef QUERY_CLIENT_H
+#define QUERY_CLIENT_H
+
+#include "engine_core.h"
+#include "query_channel.h"
+#include "query_protocol.h"
+#include <set>
+#include <string>
+#include <vector>
+
+// 學習與同步請求先排入佇列，與下一次查詢放在同一個訊框送出（一次往返）；
+// 任何請求失敗（服務結束、逾時、回覆錯誤）都中斷連線並回傳 false，由呼叫端改用本機字典
+namespace QueryClient {
+    class Client {
+    public:
+        // 每次往返的逾時：服務沒有回應時不讓介面一直等待
+        static const unsigned TIMEOUT_MS = 2000;
+
+        Client() : synced_(false) {}
+        // 連線並確認協定版本
+        bool connect(const std::string& address);
+        bool connected() const { return stream_.valid(); }
+        void disconnect();
+
+        // 讓服務上這條連線的學習資料與 learning 相同。連線後第一次送出整份（OP_SYNC_LEARNING）；
+        // 之後只送出與上次同步不同、或之後以 learn 學習過的項目（OP_PATCH_LEARNING）。
+        // 客戶端為此保留上次同步的複本（與用戶字典同大小）；服務端每條連線也保存一份學習資料
+        void syncLearning(const EngineCore::Learning& learning);
+        void learn(const std::wstring& word);
+
+        // 依 session.input 查詢：候選字放入 session，再依結果設定選擇與頁數（與 EngineCore::lookup 相同）
+        bool lookup(EngineCore::Session& session, EngineCore::Lookup& result);
+        // word 之後的聯想字放入 session 的候選字
+        bool predict(EngineCore::Session& session, const std::wstring& word);
+        // 請服務重新載入字碼表
+        bool reloadMainDict();
+
+    private:
+        Client(const Client&);
+        Client& operator=(const Client&);
+
+        // 送出佇列中的請求與 request，回覆放在 reply（reply.ok 為這個請求的結果）；
+        // 連線失敗或佇列中的請求失敗時中斷連線並回傳 false
+        bool roundTrip(const QueryProtocol::Request& request, QueryProtocol::Reply& reply);
+        // 排入佇列；佇列將超過一個訊框的筆數上限時先以 OP_HELLO 送出
+        void queue(const QueryProtocol::Request& request);
+
+        QueryChannel::Stream stream_;
+        std::vector<QueryProtocol::Request> pending_;
+        // 服務上的學習資料 = synced_ 再依序套用之後的 OP_LEARN（改變 touchedWords_、touchedContexts_ 的項目）
+        bool synced_;
+        EngineCore::Learning syncedLearning_;
+        std::set<std::wstring> touchedWords_;
+        std::set<std::wstring> touchedContexts_;
+        std::wstring serverLastSelected_;
+        std::vector<QueryProtocol::Reply> replies_;
+        std::string frame_;
+        std::string payload_;
+    };
+}
+
+#endif // QUERY_CLIENT_H
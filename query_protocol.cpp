@@ -0,0 +1,265 @@
+// query_protocol.cpp - 共用字典服務的二進位協定實作
+#include "query_protocol.h"
+#include "utf8_codec.h"
+
+namespace QueryProtocol {
+
+namespace {
+
+class Writer {
+public:
+    explicit Writer(std::string& out) : out_(out) {}
+    void u8(uint8_t value) { out_.push_back((char)value); }
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            out_.push_back((char)(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back((char)value);
+    }
+    void text(const std::wstring& value) {
+        scratch_.clear();
+        Utf8Codec::appendEncoded(scratch_, value.data(), value.size());
+        varint(scratch_.size());
+        out_.append(scratch_);
+    }
+    void words(const std::vector<std::wstring>& values) {
+        varint(values.size());
+        for (size_t i = 0; i < values.size(); i++) text(values[i]);
+    }
+
+private:
+    std::string& out_;
+    std::string scratch_;
+};
+
+class Reader {
+public:
+    Reader(const char* data, size_t size) : p_(data), end_(data + size), ok_(true) {}
+    bool ok() const { return ok_; }
+    bool done() const { return p_ == end_; }
+    uint8_t u8() {
+        if (p_ >= end_) return fail();
+        return (uint8_t)*p_++;
+    }
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p_ >= end_) return fail();
+            uint8_t byte = (uint8_t)*p_++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        return fail();
+    }
+    // 筆數不可能超過剩餘的位元組數（每筆至少一個位元組）
+    size_t count() {
+        uint64_t n = varint();
+        if (n > (uint64_t)(end_ - p_)) return fail();
+        return (size_t)n;
+    }
+    std::wstring text() {
+        size_t size = count();
+        std::wstring value;
+        if (!ok_) return value;
+        Utf8Codec::appendDecoded(value, p_, size);
+        p_ += size;
+        return value;
+    }
+    // 筆數來自對方：邊解碼邊加入，不先依筆數配置
+    void words(std::vector<std::wstring>& values) {
+        size_t n = count();
+        values.clear();
+        for (size_t i = 0; i < n && ok_; i++) values.push_back(text());
+    }
+
+private:
+    uint8_t fail() {
+        ok_ = false;
+        p_ = end_;
+        return 0;
+    }
+
+    const char* p_;
+    const char* end_;
+    bool ok_;
+};
+
+// 先保留長度欄位，內容寫完後補上
+void beginFrame(std::string& frame) {
+    frame.assign(HEADER_SIZE, '\0');
+}
+
+void endFrame(std::string& frame) {
+    uint32_t length = (uint32_t)(frame.size() - HEADER_SIZE);
+    for (size_t i = 0; i < HEADER_SIZE; i++) frame[i] = (char)(length >> (8 * i));
+}
+
+// 排序只需要詞頻、上下文與上一個選擇的字
+void writeLearning(Writer& out, const EngineCore::Learning& learning) {
+    out.varint(learning.wordFreq.size());
+    for (const auto& pair : learning.wordFreq) {
+        out.text(pair.first);
+        out.varint((uint32_t)pair.second.frequency);
+        out.varint((uint64_t)(int64_t)pair.second.lastUsed);
+        out.varint((uint32_t)pair.second.tempCount);
+        out.u8(pair.second.isPermanent ? 1 : 0);
+    }
+    out.varint(learning.contextLearning.size());
+    for (const auto& pair : learning.contextLearning) {
+        out.text(pair.first);
+        out.words(pair.second);
+    }
+    out.text(learning.lastSelected);
+}
+
+void readLearning(Reader& in, EngineCore::Learning& learning) {
+    learning = EngineCore::Learning();
+    size_t words = in.count();
+    for (size_t i = 0; i < words && in.ok(); i++) {
+        std::wstring word = in.text();
+        EngineCore::WordInfo info;
+        info.frequency = (int)(uint32_t)in.varint();
+        info.lastUsed = (time_t)(int64_t)in.varint();
+        info.tempCount = (int)(uint32_t)in.varint();
+        info.isPermanent = in.u8() != 0;
+        learning.wordFreq[word] = info;
+    }
+    size_t contexts = in.count();
+    for (size_t i = 0; i < contexts && in.ok(); i++) {
+        std::wstring word = in.text();
+        in.words(learning.contextLearning[word]);
+    }
+    learning.lastSelected = in.text();
+}
+
+}
+
+void encodeRequests(const std::vector<Request>& requests, std::string& frame) {
+    beginFrame(frame);
+    Writer out(frame);
+    out.varint(requests.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        const Request& request = requests[i];
+        out.u8((uint8_t)request.op);
+        switch (request.op) {
+            case OP_HELLO: out.varint(request.version); break;
+            case OP_SYNC_LEARNING: writeLearning(out, request.learning); break;
+            case OP_PATCH_LEARNING:
+                writeLearning(out, request.learning);
+                out.words(request.removedWords);
+                out.words(request.removedContexts);
+                break;
+            case OP_LOOKUP:
+            case OP_PREDICT:
+            case OP_LEARN: out.text(request.text); break;
+            case OP_RELOAD: break;
+        }
+    }
+    endFrame(frame);
+}
+
+bool decodeRequests(const char* data, size_t size, std::vector<Request>& requests) {
+    Reader in(data, size);
+    size_t n = in.count();
+    requests.clear();
+    if (n > MAX_REQUESTS) return false;
+    for (size_t i = 0; i < n && in.ok(); i++) {
+        requests.push_back(Request());
+        Request& request = requests.back();
+        request.op = (Op)in.u8();
+        switch (request.op) {
+            case OP_HELLO: request.version = (uint32_t)in.varint(); break;
+            case OP_SYNC_LEARNING: readLearning(in, request.learning); break;
+            case OP_PATCH_LEARNING:
+                readLearning(in, request.learning);
+                in.words(request.removedWords);
+                in.words(request.removedContexts);
+                break;
+            case OP_LOOKUP:
+            case OP_PREDICT:
+            case OP_LEARN: request.text = in.text(); break;
+            case OP_RELOAD: break;
+            default: return false;
+        }
+    }
+    return in.ok() && in.done();
+}
+
+void encodeReplies(const std::vector<Reply>& replies, std::string& frame) {
+    beginFrame(frame);
+    Writer out(frame);
+    out.varint(replies.size());
+    for (size_t i = 0; i < replies.size(); i++) {
+        const Reply& reply = replies[i];
+        out.u8((uint8_t)reply.op);
+        out.u8(reply.ok ? 1 : 0);
+        if (!reply.ok) continue;
+        switch (reply.op) {
+            case OP_HELLO: out.varint(reply.version); break;
+            case OP_LOOKUP:
+                out.u8((uint8_t)reply.lookup.status);
+                out.u8(reply.lookup.wildcard ? 1 : 0);
+                out.text(reply.lookup.code);
+                // fallthrough
+            case OP_PREDICT:
+                out.words(reply.candidates);
+                out.words(reply.codes);
+                break;
+            default: break;
+        }
+    }
+    endFrame(frame);
+}
+
+bool decodeReplies(const char* data, size_t size, std::vector<Reply>& replies) {
+    Reader in(data, size);
+    size_t n = in.count();
+    replies.clear();
+    if (n > MAX_REQUESTS) return false;
+    for (size_t i = 0; i < n && in.ok(); i++) {
+        replies.push_back(Reply());
+        Reply& reply = replies.back();
+        reply.op = (Op)in.u8();
+        reply.ok = in.u8() != 0;
+        if (!reply.ok) continue;
+        switch (reply.op) {
+            case OP_HELLO: reply.version = (uint32_t)in.varint(); break;
+            case OP_LOOKUP: {
+                uint8_t status = in.u8();
+                if (status > EngineCore::LOOKUP_OK) return false;
+                reply.lookup.status = (EngineCore::LookupStatus)status;
+                reply.lookup.wildcard = in.u8() != 0;
+                reply.lookup.code = in.text();
+            }
+                // fallthrough
+            case OP_PREDICT:
+                in.words(reply.candidates);
+                in.words(reply.codes);
+                if (reply.candidates.size() != reply.codes.size()) return false;
+                break;
+            case OP_SYNC_LEARNING:
+            case OP_PATCH_LEARNING:
+            case OP_LEARN:
+            case OP_RELOAD: break;
+            default: return false;
+        }
+    }
+    return in.ok() && in.done();
+}
+
+void applyPatch(const Request& patch, EngineCore::Learning& learning) {
+    for (size_t i = 0; i < patch.removedWords.size(); i++) learning.wordFreq.erase(patch.removedWords[i]);
+    for (size_t i = 0; i < patch.removedContexts.size(); i++) learning.contextLearning.erase(patch.removedContexts[i]);
+    for (const auto& pair : patch.learning.wordFreq) learning.wordFreq[pair.first] = pair.second;
+    for (const auto& pair : patch.learning.contextLearning) learning.contextLearning[pair.first] = pair.second;
+    learning.lastSelected = patch.learning.lastSelected;
+}
+
+uint32_t frameLength(const char* header) {
+    uint32_t length = 0;
+    for (size_t i = 0; i < HEADER_SIZE; i++) length |= (uint32_t)(uint8_t)header[i] << (8 * i);
+    return length;
+}
+
+}
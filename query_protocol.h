@@ -0,0 +1,69 @@
+// query_protocol.h - 共用字典服務的二進位協定（可攜式，不依賴 Windows API）
+#ifndef QUERY_PROTOCOL_H
+#define QUERY_PROTOCOL_H
+
+#include "engine_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 每個工作階段（輸入法程序）以一條本機連線向服務查詢，服務只保存一份字典：
+// - 訊框：4 位元組小端長度 + 內容；內容為 varint 筆數與依序的請求（或回覆）
+// - 一個訊框可放多筆請求（例如「學習」與下一次「聯想」一起送出），回覆的筆數與順序相同
+// - 整數為 varint，字串為 varint 位元組數 + UTF-8
+// 學習資料屬於連線：連線後以 OP_SYNC_LEARNING 送上用戶字典，之後以 OP_LEARN 同步每次選擇；
+// 重新載入或合併用戶字典時只以 OP_PATCH_LEARNING 送出與服務上不同的項目（見 QueryClient::Client::syncLearning）
+namespace QueryProtocol {
+    const uint32_t VERSION = 2;
+    // 訊框內容的上限（防止錯誤的長度讓對方配置過多記憶體）
+    const uint32_t MAX_FRAME = 16u << 20;
+    // 每個訊框的請求（與回覆）筆數上限；超過時解碼失敗
+    const size_t MAX_REQUESTS = 256;
+
+    enum Op {
+        OP_HELLO = 1,           // 確認協定版本；回覆 version
+        OP_SYNC_LEARNING = 2,   // 以 learning 取代這條連線的學習資料
+        OP_LOOKUP = 3,          // 查詢 text（字碼）的候選字
+        OP_PREDICT = 4,         // text（選擇的字）之後的聯想字
+        OP_LEARN = 5,           // 學習選擇的 text
+        OP_RELOAD = 6,          // 服務重新載入字碼表（所有連線之後都使用新字典；服務可以拒絕，見 QueryServer）
+        OP_PATCH_LEARNING = 7   // 以 learning 的項目取代同名的項目、刪除 removed 的詞與上下文，再設定 lastSelected
+    };
+
+    struct Request {
+        Op op;
+        std::wstring text;
+        uint32_t version;
+        EngineCore::Learning learning;
+        std::vector<std::wstring> removedWords;     // OP_PATCH_LEARNING
+        std::vector<std::wstring> removedContexts;
+        Request() : op(OP_HELLO), version(VERSION) {}
+    };
+
+    // 把 OP_PATCH_LEARNING 套用到 learning（服務端）
+    void applyPatch(const Request& patch, EngineCore::Learning& learning);
+
+    struct Reply {
+        Op op;
+        bool ok;
+        uint32_t version;
+        EngineCore::Lookup lookup;              // OP_LOOKUP
+        std::vector<std::wstring> candidates;   // OP_LOOKUP、OP_PREDICT（已排序）
+        std::vector<std::wstring> codes;
+        Reply() : op(OP_HELLO), ok(false), version(VERSION) {}
+    };
+
+    // 編碼成完整的訊框（含長度）
+    void encodeRequests(const std::vector<Request>& requests, std::string& frame);
+    void encodeReplies(const std::vector<Reply>& replies, std::string& frame);
+    // 解碼訊框內容（不含長度）；格式錯誤時回傳 false
+    bool decodeRequests(const char* data, size_t size, std::vector<Request>& requests);
+    bool decodeReplies(const char* data, size_t size, std::vector<Reply>& replies);
+
+    // 訊框長度欄位
+    const size_t HEADER_SIZE = 4;
+    uint32_t frameLength(const char* header);
+}
+
+#endif // QUERY_PROTOCOL_H
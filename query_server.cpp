@@ -0,0 +1,191 @@
+// query_server.cpp - 共用字典服務實作
+#include "query_server.h"
+#include <ctime>
+
+namespace QueryServer {
+
+using QueryProtocol::Request;
+using QueryProtocol::Reply;
+
+Handler::Handler(const EngineCore::Model& model, const ReloadCallback& reload)
+    : model_(model), reload_(reload) {}
+
+void Handler::handle(const std::vector<Request>& requests, std::vector<Reply>& replies) {
+    replies.resize(requests.size());
+    time_t now = time(nullptr);
+    for (size_t i = 0; i < requests.size(); i++) {
+        const Request& request = requests[i];
+        Reply& reply = replies[i];
+        reply = Reply();
+        reply.op = request.op;
+        reply.ok = true;
+        switch (request.op) {
+            case QueryProtocol::OP_HELLO:
+                reply.ok = request.version == QueryProtocol::VERSION;
+                break;
+            case QueryProtocol::OP_SYNC_LEARNING:
+                learning_ = request.learning;
+                break;
+            case QueryProtocol::OP_PATCH_LEARNING:
+                QueryProtocol::applyPatch(request, learning_);
+                break;
+            case QueryProtocol::OP_LOOKUP:
+                session_.input = request.text;
+                reply.lookup = EngineCore::lookup(model_, learning_, session_);
+                reply.candidates.swap(session_.candidates);
+                reply.codes.swap(session_.candidateCodes);
+                break;
+            case QueryProtocol::OP_PREDICT:
+                EngineCore::predict(model_, learning_, session_, request.text);
+                reply.candidates.swap(session_.candidates);
+                reply.codes.swap(session_.candidateCodes);
+                break;
+            case QueryProtocol::OP_LEARN:
+                EngineCore::learn(learning_, request.text, now);
+                break;
+            case QueryProtocol::OP_RELOAD:
+                reply.ok = reload_();
+                break;
+        }
+    }
+}
+
+Server::Server(const EngineCore::Model& model, const ReloadCallback& reload)
+    : model_(model), reload_(reload), reloaded_(false), access_(QueryChannel::ACCESS_USER),
+      running_(false), stopping_(false),
+      connectionCount_(0), frameCount_(0), requestCount_(0), reloadCount_(0), rejectedReloadCount_(0) {
+    serializedReload_ = [this]() { return requestReload(); };
+}
+
+Server::~Server() {
+    stop();
+}
+
+bool Server::start(const std::string& address, QueryChannel::Access access) {
+    if (running_ || !listener_.open(address, access)) return false;
+    access_ = access;
+    stopping_ = false;
+    running_ = true;
+    acceptThread_ = std::thread(&Server::acceptLoop, this);
+    return true;
+}
+
+void Server::stop() {
+    if (!running_) return;
+    listener_.interrupt();
+    acceptThread_.join();
+    listener_.close();
+
+    std::list<Connection*> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (Connection* connection : connections_) connection->stream.shutdown();
+        remaining.swap(connections_);
+    }
+    for (Connection* connection : remaining) {
+        connection->thread.join();
+        delete connection;
+    }
+    running_ = false;
+}
+
+bool Server::reload() {
+    std::lock_guard<std::mutex> lock(reloadMutex_);
+    return reloadLocked();
+}
+
+bool Server::requestReload() {
+    std::lock_guard<std::mutex> lock(reloadMutex_);
+    bool tooSoon = reloaded_ && std::chrono::steady_clock::now() - lastReload_ <
+                                std::chrono::milliseconds(RELOAD_INTERVAL_MS);
+    if (access_ == QueryChannel::ACCESS_GROUP || tooSoon) {
+        rejectedReloadCount_++;
+        return false;
+    }
+    return reloadLocked();
+}
+
+bool Server::reloadLocked() {
+    reloadCount_++;
+    // 失敗也算一次：不讓連線以失敗的重新載入繞過間隔
+    reloaded_ = true;
+    lastReload_ = std::chrono::steady_clock::now();
+    return reload_ && reload_();
+}
+
+Stats Server::stats() const {
+    Stats stats;
+    stats.connections = connectionCount_;
+    stats.frames = frameCount_;
+    stats.requests = requestCount_;
+    stats.reloads = reloadCount_;
+    stats.rejectedReloads = rejectedReloadCount_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.active = 0;
+    for (const Connection* connection : connections_) {
+        if (!connection->finished) stats.active++;
+    }
+    return stats;
+}
+
+void Server::acceptLoop() {
+    for (;;) {
+        Connection* connection = new Connection();
+        if (!listener_.accept(connection->stream)) {
+            delete connection;
+            return;
+        }
+        connectionCount_++;
+        reapFinished();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            delete connection;
+            return;
+        }
+        connections_.push_back(connection);
+        connection->thread = std::thread(&Server::serve, this, connection);
+    }
+}
+
+void Server::reapFinished() {
+    std::list<Connection*> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::list<Connection*>::iterator it = connections_.begin(); it != connections_.end();) {
+            if ((*it)->finished) {
+                finished.push_back(*it);
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (Connection* connection : finished) {
+        connection->thread.join();
+        delete connection;
+    }
+}
+
+void Server::serve(Connection* connection) {
+    Handler handler(model_, serializedReload_);
+    std::string payload;
+    std::string frame;
+    std::vector<Request> requests;
+    std::vector<Reply> replies;
+    while (QueryChannel::readFrame(connection->stream, payload)) {
+        // 格式錯誤時中斷這條連線（客戶端會改用本機字典）
+        if (!QueryProtocol::decodeRequests(payload.data(), payload.size(), requests)) break;
+        handler.handle(requests, replies);
+        QueryProtocol::encodeReplies(replies, frame);
+        if (!QueryChannel::writeFrame(connection->stream, frame)) break;
+        frameCount_++;
+        requestCount_ += requests.size();
+    }
+    // 串流在 stop 時可能正被 shutdown，關閉與標記都在鎖內
+    std::lock_guard<std::mutex> lock(mutex_);
+    connection->stream.close();
+    connection->finished = true;
+}
+
+}
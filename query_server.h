@@ -0,0 +1,103 @@
+// query_server.h - 共用字典服務：多個輸入工作階段查詢同一份字典（可攜式，不依賴 Windows API）
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include "engine_core.h"
+#include "query_channel.h"
+#include "query_protocol.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 每條連線一個執行緒；字碼表以快照查詢（重新載入時換上新快照，查詢中的連線不受影響），
+// 詞語庫與標點在服務啟動後只讀取。學習資料與輸入狀態屬於連線，由 Handler 保存
+// （每條連線一份學習資料，大小與該工作階段的用戶字典相同；連線時整份送上，之後只送變更）
+namespace QueryServer {
+    // 重新載入字碼表並發佈到 model.dict；回傳是否成功（由服務序列化呼叫）
+    typedef std::function<bool()> ReloadCallback;
+
+    // 處理一條連線的請求
+    class Handler {
+    public:
+        Handler(const EngineCore::Model& model, const ReloadCallback& reload);
+        // replies 與 requests 的筆數與順序相同
+        void handle(const std::vector<QueryProtocol::Request>& requests, std::vector<QueryProtocol::Reply>& replies);
+
+    private:
+        const EngineCore::Model& model_;
+        const ReloadCallback& reload_;
+        EngineCore::Learning learning_;
+        EngineCore::Session session_;
+    };
+
+    struct Stats {
+        unsigned long long connections;     // 累計連線數
+        unsigned long long frames;          // 處理的訊框（往返）數
+        unsigned long long requests;        // 訊框中的請求總數
+        unsigned long long reloads;
+        unsigned long long rejectedReloads; // 拒絕的 OP_RELOAD（見 Server::RELOAD_INTERVAL_MS）
+        unsigned active;                    // 目前的連線數
+    };
+
+    // 連線送來的 OP_RELOAD 由所有連線共同承擔（重新解析整份字碼表），因此受限：
+    // ACCESS_GROUP 的服務（其他使用者也能連線）一律拒絕，由管理員以 Server::reload（SIGHUP）重新載入；
+    // ACCESS_USER 時距上次重新載入不足 RELOAD_INTERVAL_MS 也拒絕
+    class Server {
+    public:
+        static const unsigned RELOAD_INTERVAL_MS = 10000;
+
+        Server(const EngineCore::Model& model, const ReloadCallback& reload);
+        ~Server();
+        // 開始接受連線（access 見 QueryChannel::Access）；位址已有服務或無法建立時回傳 false
+        bool start(const std::string& address, QueryChannel::Access access = QueryChannel::ACCESS_USER);
+        // 中斷所有連線並等待執行緒結束
+        void stop();
+        // 重新載入字碼表（不受 OP_RELOAD 的限制）
+        bool reload();
+        Stats stats() const;
+
+    private:
+        struct Connection {
+            QueryChannel::Stream stream;
+            std::thread thread;
+            bool finished = false;
+        };
+
+        // 連線的 OP_RELOAD
+        bool requestReload();
+        // 已持有 reloadMutex_
+        bool reloadLocked();
+        void acceptLoop();
+        void serve(Connection* connection);
+        // 結束的連線在接受下一條連線時回收
+        void reapFinished();
+
+        const EngineCore::Model& model_;
+        ReloadCallback reload_;
+        ReloadCallback serializedReload_;
+        std::mutex reloadMutex_;            // 序列化重新載入，並保護 reloaded_、lastReload_
+        bool reloaded_;
+        std::chrono::steady_clock::time_point lastReload_;
+        QueryChannel::Access access_;
+        QueryChannel::Listener listener_;
+        std::thread acceptThread_;
+        bool running_;
+
+        mutable std::mutex mutex_;          // 保護 connections_ 與 stopping_
+        std::list<Connection*> connections_;
+        bool stopping_;
+
+        std::atomic<unsigned long long> connectionCount_;
+        std::atomic<unsigned long long> frameCount_;
+        std::atomic<unsigned long long> requestCount_;
+        std::atomic<unsigned long long> reloadCount_;
+        std::atomic<unsigned long long> rejectedReloadCount_;
+    };
+}
+
+#endif // QUERY_SERVER_H
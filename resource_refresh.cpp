@@ -0,0 +1,190 @@
+// resource_refresh.cpp - 字典檔案變更偵測與背景重建實作
+#include "resource_refresh.h"
+#include "file_io.h"
+#include <ctime>
+#include <sys/stat.h>
+#include <utility>
+
+namespace ResourceRefresh {
+
+Fingerprint statFile(const std::string& path) {
+    Fingerprint fp;
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) return fp;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return fp;
+#endif
+    fp.exists = true;
+    fp.size = (int64_t)st.st_size;
+    fp.mtime = (int64_t)st.st_mtime;
+    return fp;
+}
+
+uint64_t contentHash(const std::string& content) {
+    return FileIO::fnv64(content);
+}
+
+Refresher::Refresher(const Paths& paths, const ReadyCallback& ready)
+    : ready_(ready), trackRequested_(0), refreshRequested_(false), stopping_(false),
+      hashed_(0), rebuiltTotal_(0) {
+    paths_[0] = paths.mainDict;
+    paths_[1] = paths.punctMenu;
+    paths_[2] = paths.userDict;
+    paths_[3] = paths.wordPhrases;
+    for (int i = 0; i < RESOURCE_COUNT; i++) racy_[i] = false;
+    worker_ = std::thread(&Refresher::workerLoop, this);
+}
+
+Refresher::~Refresher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void Refresher::track(unsigned resources) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trackRequested_ |= resources & RES_ALL;
+    }
+    wake_.notify_all();
+}
+
+void Refresher::refresh() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshRequested_ = true;
+    }
+    wake_.notify_all();
+}
+
+bool Refresher::take(Result& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (results_.empty()) return false;
+    result = std::move(results_.front());
+    results_.pop_front();
+    return true;
+}
+
+void Refresher::retire(Result& old) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_.push_back(Result());
+        std::swap(retired_.back().mainDict, old.mainDict);
+        std::swap(retired_.back().userDict, old.userDict);
+        retired_.back().wordPhrases.swap(old.wordPhrases);
+        std::swap(retired_.back().punctMenu, old.punctMenu);
+    }
+    wake_.notify_all();
+}
+
+void Refresher::workerLoop() {
+    for (;;) {
+        unsigned track;
+        bool refresh;
+        std::deque<Result> retired;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] {
+                return trackRequested_ || refreshRequested_ || !retired_.empty() || stopping_;
+            });
+            if (stopping_) return;
+            track = trackRequested_;
+            trackRequested_ = 0;
+            refresh = refreshRequested_;
+            refreshRequested_ = false;
+            retired.swap(retired_);
+        }
+        retired.clear();
+
+        for (int i = 0; i < RESOURCE_COUNT; i++) {
+            if (track & (1u << i)) capture(i);
+        }
+        if (!refresh) continue;
+
+        Result result;
+        rebuild(result);
+        rebuiltTotal_ += (unsigned)__builtin_popcount(result.rebuilt);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_.push_back(std::move(result));
+        }
+        if (ready_) ready_();
+    }
+}
+
+// 檔案時間只到秒：記錄時若檔案在這一秒內才修改過，之後同一秒內的修改看不出來
+static bool isRacy(const Fingerprint& fp) {
+    return fp.exists && fp.mtime >= (int64_t)time(nullptr) - 1;
+}
+
+void Refresher::capture(int index) {
+    Fingerprint fp = statFile(paths_[index]);
+    std::string content;
+    if (fp.exists && DictFiles::readFile(paths_[index], content)) {
+        fp.size = (int64_t)content.size();
+        fp.hash = contentHash(content);
+        hashed_++;
+    } else {
+        fp = Fingerprint();
+    }
+    known_[index] = fp;
+    racy_[index] = isRacy(fp);
+}
+
+bool Refresher::readIfChanged(int index, std::string& content, bool& missing) {
+    Fingerprint now = statFile(paths_[index]);
+    Fingerprint& known = known_[index];
+    missing = false;
+    if (!now.exists) {
+        missing = true;
+        known = Fingerprint();
+        return false;
+    }
+    if (known.exists && !racy_[index] && now.size == known.size && now.mtime == known.mtime) return false;
+
+    if (!DictFiles::readFile(paths_[index], content)) {
+        missing = true;
+        return false;
+    }
+    now.size = (int64_t)content.size();
+    now.hash = contentHash(content);
+    hashed_++;
+    bool same = known.exists && known.size == now.size && known.hash == now.hash;
+    known = now;
+    racy_[index] = isRacy(now);
+    return !same;
+}
+
+void Refresher::rebuild(Result& result) {
+    for (int i = 0; i < RESOURCE_COUNT; i++) {
+        std::string content;
+        bool missing = false;
+        bool changed = readIfChanged(i, content, missing);
+        unsigned bit = 1u << i;
+        if (missing) result.missing |= bit;
+        if (!changed) continue;
+
+        switch (bit) {
+            case RES_MAIN_DICT:
+                result.mainDict = DictModel::loadShared(paths_[i], content);
+                break;
+            case RES_PUNCT_MENU:
+                DictFiles::parsePunctMenu(content, result.punctMenu);
+                break;
+            case RES_USER_DICT:
+                DictFiles::parseUserDict(content, result.userDict);
+                break;
+            case RES_WORD_PHRASES:
+                result.wordPhrases = DictModel::loadSharedPhrases(paths_[i], content);
+                break;
+        }
+        result.rebuilt |= bit;
+    }
+}
+
+}
@@ -0,0 +1,116 @@
+// resource_refresh.h - 字典檔案的變更偵測與背景重建（可攜式，不依賴 Windows API）
+#ifndef RESOURCE_REFRESH_H
+#define RESOURCE_REFRESH_H
+
+#include "dict_files.h"
+#include "dict_model.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ResourceRefresh {
+    // 可個別重建的資源（位元旗標）
+    enum Resource {
+        RES_MAIN_DICT = 1,      // 字碼表
+        RES_PUNCT_MENU = 2,     // 標點選單
+        RES_USER_DICT = 4,      // 用戶字典
+        RES_WORD_PHRASES = 8,   // 詞語庫
+        RES_ALL = 15
+    };
+    static const int RESOURCE_COUNT = 4;
+
+    // 檔案的識別資訊：大小與修改時間相同時視為未變更；
+    // 不同時再比較內容雜湊，只被更新修改時間的檔案不重建
+    struct Fingerprint {
+        bool exists;
+        int64_t size;
+        int64_t mtime;
+        uint64_t hash;
+        Fingerprint() : exists(false), size(0), mtime(0), hash(0) {}
+    };
+
+    // 各資源的檔案路徑
+    struct Paths {
+        std::string mainDict;
+        std::string punctMenu;
+        std::string userDict;
+        std::string wordPhrases;
+    };
+
+    // 一次重建的結果：只有 rebuilt 中的資源有資料，其餘沿用目前的資料
+    struct Result {
+        unsigned rebuilt;       // 內容有變更、已重新解析
+        unsigned missing;       // 檔案不存在或無法讀取（沿用目前的資料）
+        DictModel::SnapshotPtr mainDict;    // 在背景建好索引的快照，介面執行緒只需發佈
+        std::vector<std::wstring> punctMenu;
+        DictFiles::UserEntries userDict;
+        DictModel::Phrases wordPhrases;
+        Result() : rebuilt(0), missing(0) {}
+    };
+
+    // 背景執行緒負責讀檔、比對與解析；介面執行緒只取走結果並以 swap 換上，
+    // 因此換上的動作與資料大小無關，也不會有讀到一半的狀態
+    class Refresher {
+    public:
+        // ready 在背景執行緒呼叫，表示有結果可以取走（通常只負責通知介面執行緒）
+        typedef std::function<void()> ReadyCallback;
+
+        Refresher(const Paths& paths, const ReadyCallback& ready);
+        ~Refresher();
+
+        // 記錄檔案目前的識別資訊，不重建（剛由檔案載入或寫出檔案後呼叫）
+        void track(unsigned resources);
+        // 檢查所有資源，重建有變更的；完成後呼叫 ready（沒有變更時也會產生結果）
+        void refresh();
+        // 取走一個完成的結果；沒有時回傳 false
+        bool take(Result& result);
+        // 換下來的舊資料交給背景執行緒釋放（大型字典的釋放也要花時間）
+        // 字碼表快照在這裡只放開一個引用，仍有讀者持有時由最後一個讀者釋放
+        void retire(Result& old);
+
+        // 統計用：讀取並計算雜湊的檔案數、重建的資源數
+        unsigned hashedCount() const { return hashed_; }
+        unsigned rebuiltCount() const { return rebuiltTotal_; }
+
+    private:
+        Refresher(const Refresher&);
+        Refresher& operator=(const Refresher&);
+
+        void workerLoop();
+        void capture(int index);
+        void rebuild(Result& result);
+        bool readIfChanged(int index, std::string& content, bool& missing);
+
+        std::string paths_[RESOURCE_COUNT];
+        ReadyCallback ready_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        unsigned trackRequested_;
+        bool refreshRequested_;
+        std::deque<Result> results_;
+        std::deque<Result> retired_;
+        bool stopping_;
+        std::atomic<unsigned> hashed_;
+        std::atomic<unsigned> rebuiltTotal_;
+        std::thread worker_;
+
+        // 只由背景執行緒存取
+        Fingerprint known_[RESOURCE_COUNT];
+        // 記錄時檔案才剛修改過：同一秒內可能再被修改而大小與時間都不變，下次一定比較內容
+        bool racy_[RESOURCE_COUNT];
+    };
+
+    // 只取大小與修改時間（不讀內容）
+    Fingerprint statFile(const std::string& path);
+    // 內容雜湊（FNV-1a 64 位元）
+    uint64_t contentHash(const std::string& content);
+}
+
+#endif // RESOURCE_REFRESH_H
@@ -0,0 +1,34 @@
+// sha256.h - SHA-256 雜湊（可攜式，不依賴 Windows API）
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Sha256 {
+    static const size_t DIGEST_SIZE = 32;
+
+    // 分段計算：可在下載時逐區塊餵入，不必保留整個檔案
+    class Hasher {
+    public:
+        Hasher();
+        void reset();
+        void update(const void* data, size_t size);
+        // 結束計算並回傳小寫十六進位字串（64 字元）；之後需 reset 才能再使用
+        std::string finishHex();
+
+    private:
+        void compress(const uint8_t* block);
+
+        uint32_t state_[8];
+        uint8_t buffer_[64];
+        size_t buffered_;
+        uint64_t length_;
+    };
+
+    // 一次計算整段資料
+    std::string digestHex(const std::string& data);
+}
+
+#endif // SHA256_H
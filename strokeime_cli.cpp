@@ -0,0 +1,371 @@
+// strokeime_cli.cpp - 命令列批次轉換：字碼與選擇轉成文字（可攜式，不依賴 Windows API）
+//
+// 以引擎核心查詢、排序與聯想，與輸入法選字的結果相同；用於大量輸入、排序變更的回歸比對與效能量測
+#include "engine_core.h"
+#include "utf8_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+static const char* USAGE =
+    "用法：strokeime-cli [選項] [輸入檔...]（沒有輸入檔時讀取標準輸入）\n"
+    "  -d 檔案   字碼表（預設 Zi-Ma-Biao.txt）\n"
+    "  -u 檔案   用戶字典：詞頻影響排序\n"
+    "  -p 檔案   詞語庫：聯想字\n"
+    "  -l        依選擇學習（與輸入法相同，之後的排序會隨選擇改變）\n"
+    "  -c        列出候選字而不輸出文字：每個記號一行「記號<TAB>候選字...」\n"
+    "  -n 次數   重複處理輸入（效能量測）\n"
+    "  -q        不顯示個別的選擇錯誤\n"
+    "  -s        結束時在標準錯誤輸出統計\n"
+    "\n"
+    "輸入為 UTF-8，每行的記號以空白分隔，每行結束時輸出換行：\n"
+    "  字碼      選擇第一個候選字（字碼為 u i o j k，* 為萬用字元）\n"
+    "  字碼:n    選擇第 n 個候選字（從 1 起算，不分頁）\n"
+    "  >n        選擇上一個字的第 n 個聯想字（省略 n 時為第一個）\n"
+    "  \"文字     原樣輸出引號之後的文字\n"
+    "  #         之後到行尾為註解\n"
+    "有選擇不到的候選字時結束碼為 1\n";
+
+namespace {
+
+struct Options {
+    std::string dictPath = "Zi-Ma-Biao.txt";
+    std::string userDictPath;
+    std::string phrasesPath;
+    std::vector<std::string> inputs;
+    bool learn = false;
+    bool list = false;
+    bool quiet = false;
+    bool stats = false;
+    long repeat = 1;
+};
+
+struct Stats {
+    unsigned long long lines = 0;
+    unsigned long long tokens = 0;
+    unsigned long long lookups = 0;
+    unsigned long long cacheHits = 0;
+    unsigned long long misses = 0;
+};
+
+// 緩衝輸出：累積到一定大小才寫出
+class Output {
+public:
+    explicit Output(FILE* file) : file_(file) { buffer_.reserve(FLUSH_SIZE * 2); }
+    ~Output() { flush(); }
+    void text(const std::wstring& ws) {
+        Utf8Codec::appendEncoded(buffer_, ws.data(), ws.size());
+        if (buffer_.size() >= FLUSH_SIZE) flush();
+    }
+    void raw(const char* data, size_t size) {
+        buffer_.append(data, size);
+        if (buffer_.size() >= FLUSH_SIZE) flush();
+    }
+    void flush() {
+        if (!buffer_.empty()) fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+
+private:
+    static const size_t FLUSH_SIZE = 1 << 16;
+    FILE* file_;
+    std::string buffer_;
+};
+
+class Converter {
+public:
+    Converter(const Options& options, EngineCore::Model& model, EngineCore::Learning& learning, Output& out)
+        : options_(options), model_(model), learning_(learning), out_(out), now_(time(nullptr)) {}
+
+    void processLine(const std::wstring& line, unsigned long long lineNumber);
+    const Stats& stats() const { return stats_; }
+
+private:
+    // 不學習時排序結果只取決於字碼，查詢過的字碼與聯想直接重用；學習時每次選擇都會改變排序，不使用
+    typedef std::unordered_map<std::wstring, std::vector<std::wstring>> Cache;
+
+    const std::vector<std::wstring>& candidates(const std::wstring& code);
+    const std::vector<std::wstring>& predictions(const std::wstring& word);
+    void choose(const std::wstring& token, const std::vector<std::wstring>& list, long index,
+                unsigned long long lineNumber);
+    void commit(const std::wstring& word);
+
+    const Options& options_;
+    EngineCore::Model& model_;
+    EngineCore::Learning& learning_;
+    Output& out_;
+    time_t now_;
+    EngineCore::Session session_;
+    Cache lookups_;
+    Cache predictions_;
+    std::wstring lastWord_;
+    Stats stats_;
+};
+
+const std::vector<std::wstring>& Converter::candidates(const std::wstring& code) {
+    stats_.lookups++;
+    session_.input = code;
+    if (options_.learn) {
+        EngineCore::lookup(model_, learning_, session_);
+        return session_.candidates;
+    }
+    Cache::iterator cached = lookups_.find(code);
+    if (cached != lookups_.end()) {
+        stats_.cacheHits++;
+        return cached->second;
+    }
+    EngineCore::lookup(model_, learning_, session_);
+    std::vector<std::wstring>& entry = lookups_[code];
+    entry.swap(session_.candidates);
+    return entry;
+}
+
+const std::vector<std::wstring>& Converter::predictions(const std::wstring& word) {
+    stats_.lookups++;
+    if (options_.learn) {
+        EngineCore::predict(model_, learning_, session_, word);
+        return session_.candidates;
+    }
+    Cache::iterator cached = predictions_.find(word);
+    if (cached != predictions_.end()) {
+        stats_.cacheHits++;
+        return cached->second;
+    }
+    EngineCore::predict(model_, learning_, session_, word);
+    std::vector<std::wstring>& entry = predictions_[word];
+    entry.swap(session_.candidates);
+    return entry;
+}
+
+void Converter::choose(const std::wstring& token, const std::vector<std::wstring>& list, long index,
+                       unsigned long long lineNumber) {
+    if (options_.list) {
+        out_.text(token);
+        out_.raw("\t", 1);
+        for (size_t i = 0; i < list.size(); i++) {
+            if (i) out_.raw(" ", 1);
+            out_.text(list[i]);
+        }
+        out_.raw("\n", 1);
+    }
+    if (index < 1 || (size_t)index > list.size()) {
+        stats_.misses++;
+        if (!options_.quiet) {
+            fprintf(stderr, "第 %llu 行：%s 沒有第 %ld 個候選字（共 %lu 個）\n", lineNumber,
+                    Utf8Codec::encode(token).c_str(), index, (unsigned long)list.size());
+        }
+        return;
+    }
+    commit(list[index - 1]);
+}
+
+void Converter::commit(const std::wstring& word) {
+    if (!options_.list) out_.text(word);
+    lastWord_ = word;
+    if (options_.learn) EngineCore::learn(learning_, word, now_);
+}
+
+void Converter::processLine(const std::wstring& line, unsigned long long lineNumber) {
+    stats_.lines++;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        while (pos < line.size() && (line[pos] == L' ' || line[pos] == L'\t' || line[pos] == L'\r')) pos++;
+        if (pos >= line.size() || line[pos] == L'#') break;
+        size_t end = pos;
+        while (end < line.size() && line[end] != L' ' && line[end] != L'\t' && line[end] != L'\r') end++;
+        std::wstring token = line.substr(pos, end - pos);
+        pos = end;
+        stats_.tokens++;
+
+        if (token[0] == L'"') {
+            commit(token.substr(1));
+            continue;
+        }
+        if (token[0] == L'>') {
+            long index = token.size() > 1 ? wcstol(token.c_str() + 1, nullptr, 10) : 1;
+            if (lastWord_.empty()) {
+                stats_.misses++;
+                if (!options_.quiet) fprintf(stderr, "第 %llu 行：%s 之前沒有選擇的字\n", lineNumber,
+                                             Utf8Codec::encode(token).c_str());
+                continue;
+            }
+            choose(token, predictions(lastWord_), index, lineNumber);
+            continue;
+        }
+        size_t colon = token.find(L':');
+        long index = colon == std::wstring::npos ? 1 : wcstol(token.c_str() + colon + 1, nullptr, 10);
+        std::wstring code = token.substr(0, colon);
+        choose(token, candidates(code), index, lineNumber);
+    }
+    if (!options_.list) out_.raw("\n", 1);
+}
+
+// 轉換一行（不含換行）；第一行的 UTF-8 BOM 略過
+void convertLine(Converter& converter, const char* data, size_t size, unsigned long long lineNumber,
+                 std::wstring& line) {
+    if (lineNumber == 1 && size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        data += 3;
+        size -= 3;
+    }
+    line.clear();
+    Utf8Codec::appendDecoded(line, data, size);
+    converter.processLine(line, lineNumber);
+}
+
+// 逐塊讀入並轉換：每塊最多到一行的結尾，超過一塊的行接到下一塊再轉換，記憶體只需要一塊加上最長的一行。
+// lineFlush 時每行轉換後立即寫出（輸入來自管道或終端機時，不等到輸入結束）；
+// keep 不為空指標時保留讀入的內容（-n 重複處理時使用）
+bool convertStream(FILE* file, Converter& converter, Output& out, bool lineFlush, std::string* keep) {
+    char block[1 << 12];
+    std::string pending;
+    std::wstring line;
+    unsigned long long lineNumber = 0;
+    while (fgets(block, sizeof(block), file)) {
+        size_t size = strlen(block);
+        if (keep) keep->append(block, size);
+        bool complete = size > 0 && block[size - 1] == '\n';
+        if (!complete && !feof(file)) {
+            pending.append(block, size);
+            continue;
+        }
+        size_t length = complete ? size - 1 : size;
+        if (pending.empty()) {
+            convertLine(converter, block, length, ++lineNumber, line);
+        } else {
+            pending.append(block, length);
+            convertLine(converter, pending.data(), pending.size(), ++lineNumber, line);
+            pending.clear();
+        }
+        if (lineFlush) {
+            out.flush();
+            fflush(stdout);
+        }
+    }
+    // 輸入剛好在一塊的結尾結束、最後一行沒有換行：讀到結尾前 feof 尚未設定，剩下的內容是最後一行
+    if (!pending.empty()) convertLine(converter, pending.data(), pending.size(), ++lineNumber, line);
+    return !ferror(file);
+}
+
+// 已保留在記憶體中的輸入（-n 的第二次之後）
+void convertContent(const std::string& content, Converter& converter) {
+    std::wstring line;
+    unsigned long long lineNumber = 0;
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) end = content.size();
+        convertLine(converter, content.data() + pos, end - pos, ++lineNumber, line);
+        pos = end + 1;
+    }
+}
+
+bool isRegularFile(FILE* file) {
+    struct stat info;
+    return fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((arg == "-d" || arg == "-u" || arg == "-p" || arg == "-n") && !hasValue) return false;
+        if (arg == "-d") options.dictPath = argv[++i];
+        else if (arg == "-u") options.userDictPath = argv[++i];
+        else if (arg == "-p") options.phrasesPath = argv[++i];
+        else if (arg == "-n") options.repeat = strtol(argv[++i], nullptr, 10);
+        else if (arg == "-l") options.learn = true;
+        else if (arg == "-c") options.list = true;
+        else if (arg == "-q") options.quiet = true;
+        else if (arg == "-s") options.stats = true;
+        else if (arg.size() > 1 && arg[0] == '-') return false;
+        else options.inputs.push_back(arg);
+    }
+    if (options.inputs.empty()) options.inputs.push_back("-");
+    return options.repeat >= 1;
+}
+
+bool loadModel(const Options& options, EngineCore::Model& model, EngineCore::Learning& learning) {
+    std::string content;
+    if (!DictFiles::readFile(options.dictPath, content)) {
+        fprintf(stderr, "無法讀取字碼表：%s\n", options.dictPath.c_str());
+        return false;
+    }
+    // 與輸入法共用字碼表的映像檔（見 dict_model.h）
+    model.dict.publish(DictModel::loadShared(options.dictPath, content));
+
+    if (!options.userDictPath.empty()) {
+        if (!DictFiles::readFile(options.userDictPath, content)) {
+            fprintf(stderr, "無法讀取用戶字典：%s\n", options.userDictPath.c_str());
+            return false;
+        }
+        DictFiles::UserEntries entries;
+        DictFiles::parseUserDict(content, entries);
+        EngineCore::loadLearning(learning, entries, time(nullptr));
+    }
+    if (!options.phrasesPath.empty()) {
+        if (!DictFiles::readFile(options.phrasesPath, content)) {
+            fprintf(stderr, "無法讀取詞語庫：%s\n", options.phrasesPath.c_str());
+            return false;
+        }
+        model.wordPhrases = DictModel::loadSharedPhrases(options.phrasesPath, content);
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+
+    EngineCore::Model model;
+    EngineCore::Learning learning;
+    if (!loadModel(options, model, learning)) return 2;
+
+    // 先開啟所有輸入：有無法開啟的檔案時不輸出任何內容
+    std::vector<FILE*> files(options.inputs.size());
+    for (size_t i = 0; i < options.inputs.size(); i++) {
+        files[i] = options.inputs[i] == "-" ? stdin : fopen(options.inputs[i].c_str(), "rb");
+        if (!files[i]) {
+            fprintf(stderr, "無法讀取輸入：%s\n", options.inputs[i].c_str());
+            return 2;
+        }
+    }
+
+    Output out(stdout);
+    Converter converter(options, model, learning, out);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // 第一次邊讀邊轉換；只有 -n 大於 1 時才把輸入留在記憶體中重複處理
+    std::vector<std::string> kept(options.repeat > 1 ? files.size() : 0);
+    bool readOk = true;
+    for (size_t i = 0; i < files.size(); i++) {
+        bool lineFlush = !isRegularFile(files[i]);
+        if (!convertStream(files[i], converter, out, lineFlush, kept.empty() ? nullptr : &kept[i])) {
+            fprintf(stderr, "無法讀取輸入：%s\n", options.inputs[i].c_str());
+            readOk = false;
+        }
+        if (files[i] != stdin) fclose(files[i]);
+    }
+    for (long round = 1; readOk && round < options.repeat; round++) {
+        for (size_t i = 0; i < kept.size(); i++) convertContent(kept[i], converter);
+    }
+    out.flush();
+    if (!readOk) return 2;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const Stats& stats = converter.stats();
+    if (options.stats) {
+        fprintf(stderr, "行數 %llu、記號 %llu、查詢 %llu（重用 %llu）、選擇錯誤 %llu\n",
+                stats.lines, stats.tokens, stats.lookups, stats.cacheHits, stats.misses);
+        fprintf(stderr, "耗時 %.3f 秒、每秒 %.0f 次查詢\n", seconds, seconds > 0 ? stats.lookups / seconds : 0.0);
+    }
+    return stats.misses ? 1 : 0;
+}
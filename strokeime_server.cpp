@@ -0,0 +1,148 @@
+// strokeime_server.cpp - 共用字典服務：所有輸入法工作階段查詢同一份字典（可攜式，不依賴 Windows API）
+//
+// 輸入法啟動時連線到這個服務（位址見 QueryChannel::clientAddresses），沒有服務時使用本機字典
+#include "query_server.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <pthread.h>
+#endif
+
+static const char* USAGE =
+    "用法：strokeime-server [選項]\n"
+    "  -d 檔案   字碼表（預設 Zi-Ma-Biao.txt）\n"
+    "  -p 檔案   詞語庫：聯想字（預設 word_phrases.txt，不存在時不使用）\n"
+    "  -a 位址   連線位址（預設為 STROKEIME_SERVER 或依使用者的預設位址）\n"
+    "  -g        允許其他使用者連線：Linux 為 socket 的群組，Windows 為已登入的使用者\n"
+    "  -m        全機共用的服務：在全機位址提供服務並允許其他使用者連線（-g）\n"
+    "  -s        結束時在標準錯誤輸出統計\n"
+    "\n"
+    "所有工作階段共用一個服務（管理員設定）：\n"
+    "  Linux：建立 /run/strokeime（擁有者為服務帳號、群組為輸入法使用者，權限 2750），\n"
+    "         以服務帳號執行 strokeime-server -m\n"
+    "  Windows：以服務帳號執行 strokeime-server -m（管道 \\\\.\\pipe\\strokeime）\n"
+    "  輸入法找不到自己的服務時連線到全機位址；學習資料仍屬於各自的連線\n"
+    "\n"
+    "結束：Ctrl+C；重新載入字碼表：SIGHUP（Linux）或由輸入法送出重新載入\n"
+    "（輸入法的重新載入每 10 秒最多一次；-g、-m 時不接受，只能以 SIGHUP 或重新啟動服務重新載入）\n";
+
+namespace {
+
+struct Options {
+    std::string dictPath = "Zi-Ma-Biao.txt";
+    std::string phrasesPath = "word_phrases.txt";
+    std::string address;
+    QueryChannel::Access access = QueryChannel::ACCESS_USER;
+    bool machine = false;
+    bool stats = false;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((arg == "-d" || arg == "-p" || arg == "-a") && !hasValue) return false;
+        if (arg == "-d") options.dictPath = argv[++i];
+        else if (arg == "-p") options.phrasesPath = argv[++i];
+        else if (arg == "-a") options.address = argv[++i];
+        else if (arg == "-g") options.access = QueryChannel::ACCESS_GROUP;
+        else if (arg == "-m") options.machine = true;
+        else if (arg == "-s") options.stats = true;
+        else return false;
+    }
+    if (options.machine) {
+        options.access = QueryChannel::ACCESS_GROUP;
+        if (options.address.empty()) options.address = QueryChannel::machineAddress();
+    }
+    if (options.address.empty()) options.address = QueryChannel::defaultAddress();
+    return true;
+}
+
+// 解析成新的快照後才換上：查詢中的連線繼續使用舊字典
+bool loadMainDict(const std::string& path, EngineCore::Model& model) {
+    std::string content;
+    if (!DictFiles::readFile(path, content)) return false;
+    DictModel::SnapshotPtr snapshot = DictModel::loadShared(path, content);
+    model.dict.publish(snapshot);
+    fprintf(stderr, "字碼表：%s，%d 個字%s\n", path.c_str(), snapshot->entryCount(),
+            snapshot->shared() ? "（共用映像檔）" : "");
+    return true;
+}
+
+#ifdef _WIN32
+std::atomic<bool> g_quit(false);
+
+BOOL WINAPI onConsoleEvent(DWORD) {
+    g_quit = true;
+    return TRUE;
+}
+#endif
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+
+    EngineCore::Model model;
+    if (!loadMainDict(options.dictPath, model)) {
+        fprintf(stderr, "無法讀取字碼表：%s\n", options.dictPath.c_str());
+        return 2;
+    }
+    // 詞語庫在服務執行期間不變（連線同時讀取）；檔案變更後重新啟動服務
+    std::string content;
+    if (DictFiles::readFile(options.phrasesPath, content)) {
+        model.wordPhrases = DictModel::loadSharedPhrases(options.phrasesPath, content);
+        fprintf(stderr, "詞語庫：%s，%d 個詞語組合\n", options.phrasesPath.c_str(), model.wordPhrases.entryCount());
+    }
+
+#ifndef _WIN32
+    // 信號只由主執行緒以 sigwait 接收（在建立連線執行緒之前設定，讓它們繼承）
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+    QueryServer::Server server(model, [&]() { return loadMainDict(options.dictPath, model); });
+    if (!server.start(options.address, options.access)) {
+        fprintf(stderr, "無法在 %s 提供服務（已有服務執行中或無法建立）\n", options.address.c_str());
+        return 2;
+    }
+    fprintf(stderr, "服務位址：%s%s\n", options.address.c_str(),
+            options.access == QueryChannel::ACCESS_GROUP ? "（允許其他使用者）" : "");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef _WIN32
+    SetConsoleCtrlHandler(onConsoleEvent, TRUE);
+    while (!g_quit) Sleep(200);
+#else
+    for (;;) {
+        int received = 0;
+        if (sigwait(&signals, &received) != 0) break;
+        if (received != SIGHUP) break;
+        if (!server.reload()) fprintf(stderr, "無法重新載入字碼表：%s\n", options.dictPath.c_str());
+    }
+#endif
+    server.stop();
+
+    if (options.stats) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        QueryServer::Stats stats = server.stats();
+        fprintf(stderr, "連線 %llu、往返 %llu、請求 %llu、重新載入 %llu（拒絕 %llu）\n",
+                stats.connections, stats.frames, stats.requests, stats.reloads, stats.rejectedReloads);
+        fprintf(stderr, "執行 %.1f 秒、每秒 %.0f 個請求\n", seconds, seconds > 0 ? stats.requests / seconds : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+// bench_data.h - 效能量測用的字碼表與詞語庫：沒有指定實際的檔案時寫出內容固定的合成資料
+#ifndef BENCH_DATA_H
+#define BENCH_DATA_H
+
+#include "utf8_codec.h"
+#include <fstream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+
+namespace BenchData {
+    // 合成資料的大小：與下載的字碼表、詞語庫同一個數量級
+    const int WORDS = 30000;
+    const int PHRASES = 60000;
+
+    // 在 dir 寫出 dict.txt（WORDS 個字，字碼為 1 到 5 個 u i o j k）與 phrases.txt（PHRASES 個 2 到 4 字的詞語）；
+    // 內容只由常數決定，每次量測相同。路徑放在 dictPath、phrasesPath
+    inline bool writeSynthetic(const std::string& dir, std::string& dictPath, std::string& phrasesPath) {
+        mkdir(dir.c_str(), 0755);
+        dictPath = dir + "/dict.txt";
+        phrasesPath = dir + "/phrases.txt";
+        std::mt19937 rng(20240601);
+        const wchar_t codeChars[] = L"uiojk";
+        std::wstring dict = L"# 合成字碼表\n";
+        for (int i = 0; i < WORDS; i++) {
+            // 多數字碼為 2 到 4 碼，與實際字碼表的分布相近
+            size_t length = 2 + rng() % 3;
+            if (i % 10 == 0) length = 1 + (rng() % 2) * 4;
+            std::wstring code;
+            for (size_t k = 0; k < length; k++) code += codeChars[rng() % 5];
+            dict += (wchar_t)(0x4E00 + i % 20000);
+            dict += L'\t';
+            dict += code;
+            dict += L'\n';
+        }
+        std::wstring phrases;
+        for (int i = 0; i < PHRASES; i++) {
+            size_t length = 2 + rng() % 3;
+            for (size_t k = 0; k < length; k++) phrases += (wchar_t)(0x4E00 + rng() % 20000);
+            phrases += L'\n';
+        }
+        std::ofstream dictFile(dictPath.c_str(), std::ios::binary);
+        std::ofstream phrasesFile(phrasesPath.c_str(), std::ios::binary);
+        dictFile << Utf8Codec::encode(dict);
+        phrasesFile << Utf8Codec::encode(phrases);
+        return dictFile.good() && phrasesFile.good();
+    }
+}
+
+#endif // BENCH_DATA_H
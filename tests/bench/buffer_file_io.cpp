@@ -0,0 +1,196 @@
+// buffer_file_io.cpp - 暫放文字檔的讀寫：10 MB 到 100 MB 的檔案以 BufferFile 讀入與寫出的吞吐量與記憶體峰值
+//
+// 每次讀取或寫入在一個子程序中執行，峰值取自子程序的 getrusage：讀取的增加量包含文字本身
+// （每個字元一個 wchar_t），寫入的增加量只有編碼用的區塊。寫出的檔案須與讀入的檔案逐位元組相同
+#include "buffer_file.h"
+#include "file_io.h"
+#include "utf8_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const char* USAGE =
+    "用法：buffer_file_io [選項]\n"
+    "  -m MB     檔案大小，以逗號分隔（預設 10,100）\n"
+    "  -r 次數   每個大小的量測次數（預設 3）\n"
+    "檔案為中英文混合的 UTF-8（含 BOM），寫在 core/tests/bench/\n";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::vector<int> megabytes = {10, 100};
+    int rounds = 3;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "-m") {
+            options.megabytes.clear();
+            std::stringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (atoi(item.c_str()) > 0) options.megabytes.push_back(atoi(item.c_str()));
+            }
+            if (options.megabytes.empty()) return false;
+        } else if (arg == "-r") {
+            options.rounds = atoi(value.c_str());
+        } else {
+            return false;
+        }
+    }
+    return options.rounds >= 1;
+}
+
+// 寫出約 megabytes MB 的檔案：每行是一段中文（3 位元組的字）與一段 ASCII 單字，內容只由大小決定
+bool writeText(const std::string& path, int megabytes) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::mt19937 rng(20240601);
+    uint64_t target = (uint64_t)megabytes * 1024 * 1024;
+    uint64_t written = 0;
+    bool ok = fwrite("\xEF\xBB\xBF", 1, 3, file) == 3;
+    std::wstring lines;
+    while (ok && written < target) {
+        lines.clear();
+        while (lines.size() < 16 * 1024) {
+            size_t hanzi = 4 + rng() % 30;
+            for (size_t k = 0; k < hanzi; k++) lines += (wchar_t)(0x4E00 + rng() % 20000);
+            lines += L' ';
+            size_t ascii = rng() % 24;
+            for (size_t k = 0; k < ascii; k++) lines += (wchar_t)(k % 6 == 5 ? L' ' : L'a' + rng() % 26);
+            lines += L'\n';
+        }
+        std::string bytes = Utf8Codec::encode(lines);
+        ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        written += bytes.size();
+    }
+    return fclose(file) == 0 && ok;
+}
+
+// 以區塊讀取整個檔案的雜湊（比對寫出的檔案，不把兩個檔案放進記憶體）
+bool hashFile(const std::string& path, uint64_t& hash) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::vector<char> block(BufferFile::BLOCK_SIZE);
+    hash = FileIO::FNV64_OFFSET;
+    size_t n;
+    while ((n = fread(block.data(), 1, block.size(), file)) > 0) hash = FileIO::fnv64(block.data(), n, hash);
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+long maxRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct Report {
+    int ok;
+    double ms;
+    uint64_t chars;
+    long startKb;
+    long peakKb;
+};
+
+// 在子程序中讀取（save 為 true 時讀取後寫出到 savePath，只計寫出的時間與記憶體）
+bool run(const std::string& path, const std::string& savePath, bool save, Report& report) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Report child = {0, 0, 0, 0, 0};
+        std::wstring text;
+        TextModel model;
+        bool ok = true;
+        if (save) {
+            // 與載入暫放區相同：讀入後由文字模型接管記憶體
+            ok = BufferFile::load(path, text) == BufferFile::OK;
+            model = std::move(text);
+        }
+        child.startKb = maxRssKb();
+        Clock::time_point begin = Clock::now();
+        if (save) {
+            ok = ok && BufferFile::save(savePath, model) == BufferFile::OK;
+            child.chars = model.length();
+        } else {
+            ok = BufferFile::load(path, text) == BufferFile::OK;
+            model = std::move(text);
+            child.chars = model.length();
+        }
+        child.ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        child.peakKb = maxRssKb();
+        child.ok = ok ? 1 : 0;
+        _exit(write(fds[1], &child, sizeof(child)) == (ssize_t)sizeof(child) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = read(fds[0], &report, sizeof(report)) == (ssize_t)sizeof(report);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 && report.ok;
+}
+
+void print(const char* name, int round, uint64_t bytes, const Report& report) {
+    printf("  第 %d 次%s：%8.1f ms，%6.1f MB/s；%9llu 字；峰值增加 %6.1f MB\n", round, name, report.ms,
+           bytes / 1048576.0 / (report.ms / 1000), (unsigned long long)report.chars,
+           (report.peakKb - report.startKb) / 1024.0);
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    mkdir("core/tests/bench", 0755);
+    for (size_t i = 0; i < options.megabytes.size(); i++) {
+        int megabytes = options.megabytes[i];
+        std::string path = "core/tests/bench/buffer_" + std::to_string(megabytes) + "mb.txt";
+        std::string savePath = path + ".saved";
+        struct stat info;
+        if (!writeText(path, megabytes) || stat(path.c_str(), &info) != 0) {
+            fprintf(stderr, "無法寫出：%s\n", path.c_str());
+            return 2;
+        }
+        uint64_t bytes = (uint64_t)info.st_size;
+        printf("%s（%.1f MB）\n", path.c_str(), bytes / 1048576.0);
+
+        uint64_t expected = 0, saved = 0;
+        if (!hashFile(path, expected)) return 2;
+        for (int round = 1; round <= options.rounds; round++) {
+            Report load, save;
+            if (!run(path, savePath, false, load) || !run(path, savePath, true, save)) {
+                printf("  失敗（讀取或寫出錯誤）\n");
+                return 1;
+            }
+            print("讀取", round, bytes, load);
+            print("寫出", round, bytes, save);
+            if (!hashFile(savePath, saved) || saved != expected) {
+                printf("  寫出的檔案與讀入的檔案不同\n");
+                return 1;
+            }
+        }
+        std::remove(path.c_str());
+        std::remove(savePath.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+// dict_image_procs.cpp - 多個輸入法程序的字典記憶體：各自解析（private）與對映共用的映像檔（shared）
+//
+// 每個子程序如同一個輸入法程序載入字碼表與詞語庫並走訪所有頁面，全部載入後讀取 /proc/<pid>/smaps_rollup：
+// RSS 把共用的頁面算進每個程序，PSS 依共用的程序數平分，總 PSS 才是實際使用的記憶體
+#include "bench_data.h"
+#include "engine_core.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const char* USAGE =
+    "用法：dict_image_procs [選項]\n"
+    "  -d 檔案   字碼表（預設為合成的字碼表）\n"
+    "  -p 檔案   詞語庫（預設為合成的詞語庫）\n"
+    "  -n 數量   程序數，以逗號分隔（預設 1,4,16）\n"
+    "共用的映像檔寫在字碼表與詞語庫旁（與輸入法相同）\n";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string dictPath;
+    std::string phrasesPath;
+    std::vector<int> processes = {1, 4, 16};
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "-d") options.dictPath = value;
+        else if (arg == "-p") options.phrasesPath = value;
+        else if (arg == "-n") {
+            options.processes.clear();
+            std::stringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (atoi(item.c_str()) > 0) options.processes.push_back(atoi(item.c_str()));
+            }
+            if (options.processes.empty()) return false;
+        } else return false;
+    }
+    return true;
+}
+
+// 程序的 RSS 與 PSS（KB）；讀不到時回傳 false
+bool memoryOf(pid_t pid, long& rss, long& pss) {
+    std::ifstream file(("/proc/" + std::to_string((long)pid) + "/smaps_rollup").c_str());
+    std::string line;
+    rss = pss = -1;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 4, "Rss:") == 0) rss = atol(line.c_str() + 4);
+        if (line.compare(0, 4, "Pss:") == 0) pss = atol(line.c_str() + 4);
+    }
+    return rss >= 0 && pss >= 0;
+}
+
+// 子程序：載入並走訪字典，回報載入時間後等待父程序量測
+void child(const Options& options, bool shared, int readyFd, int goFd) {
+    Clock::time_point begin = Clock::now();
+    EngineCore::Model model;
+    std::string content;
+    bool ok = DictFiles::readFile(options.dictPath, content);
+    if (shared) {
+        model.dict.publish(DictModel::loadShared(options.dictPath, content));
+    } else {
+        DictFiles::CodeTable table;
+        int count = DictFiles::parseMainDict(content, table);
+        model.dict.publish(DictModel::build(table, count));
+    }
+    ok = DictFiles::readFile(options.phrasesPath, content) && ok;
+    if (shared) {
+        model.wordPhrases = DictModel::loadSharedPhrases(options.phrasesPath, content);
+    } else {
+        DictFiles::CodeTable phrases;
+        int count = DictFiles::parseWordPhrases(content, phrases);
+        model.wordPhrases = DictModel::buildPhrases(phrases, count);
+    }
+    std::string().swap(content);
+    double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    // 觸及所有頁面：聯想會掃描整個字碼表，詞語庫逐一查詢
+    EngineCore::Learning learning;
+    EngineCore::Session session;
+    DictModel::SnapshotPtr snapshot = model.dict.pin();
+    if (snapshot->codeCount() > 0) EngineCore::predict(model, learning, session, snapshot->table().value(0, 0).str());
+    const DictImage::Table& phrases = model.wordPhrases.table();
+    size_t touched = 0;
+    for (size_t i = 0; i < phrases.size(); i++) touched += phrases.find(phrases.key(i).str()) + phrases.valueCount(i);
+
+    char message[64];
+    int length = snprintf(message, sizeof(message), "%d %.3f %zu\n", ok && snapshot->shared() == shared ? 1 : 0,
+                          loadMs, touched & 1);
+    if (write(readyFd, message, length) != length) _exit(1);
+    char go;
+    if (read(goFd, &go, 1) < 0) _exit(1);
+    _exit(0);
+}
+
+// 啟動 count 個子程序，全部載入後量測；回傳是否成功
+bool run(const Options& options, bool shared, int count) {
+    int ready[2], go[2];
+    if (pipe(ready) != 0 || pipe(go) != 0) return false;
+    std::vector<pid_t> children;
+    for (int i = 0; i < count; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(ready[0]);
+            close(go[1]);
+            child(options, shared, ready[1], go[0]);
+        }
+        if (pid < 0) break;
+        children.push_back(pid);
+    }
+    close(ready[1]);
+    close(go[0]);
+
+    FILE* reports = fdopen(ready[0], "r");
+    double loadMs = 0;
+    bool ok = (int)children.size() == count;
+    for (size_t i = 0; i < children.size(); i++) {
+        int childOk = 0;
+        double ms = 0;
+        size_t unused = 0;
+        ok = fscanf(reports, "%d %lf %zu", &childOk, &ms, &unused) == 3 && childOk && ok;
+        loadMs += ms;
+    }
+    long rssSum = 0, pssSum = 0;
+    for (size_t i = 0; ok && i < children.size(); i++) {
+        long rss = 0, pss = 0;
+        ok = memoryOf(children[i], rss, pss);
+        rssSum += rss;
+        pssSum += pss;
+    }
+    // 關閉 go 讓所有子程序結束
+    close(go[1]);
+    for (size_t i = 0; i < children.size(); i++) waitpid(children[i], nullptr, 0);
+    fclose(reports);
+    if (!ok) {
+        printf("%-7s %3d 個程序：失敗（載入錯誤、未使用映像檔或無法讀取 smaps_rollup）\n",
+               shared ? "shared" : "private", count);
+        return false;
+    }
+    printf("%-7s %3d 個程序：載入 %7.1f ms；每個程序 RSS %7ld KB、PSS %7ld KB；總 PSS %7.1f MB\n",
+           shared ? "shared" : "private", count, loadMs / count, rssSum / count, pssSum / count, pssSum / 1024.0);
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    std::string syntheticDict, syntheticPhrases;
+    if (options.dictPath.empty() || options.phrasesPath.empty()) {
+        if (!BenchData::writeSynthetic("core/tests/bench", syntheticDict, syntheticPhrases)) {
+            fprintf(stderr, "無法寫出合成資料：core/tests/bench\n");
+            return 2;
+        }
+        if (options.dictPath.empty()) options.dictPath = syntheticDict;
+        if (options.phrasesPath.empty()) options.phrasesPath = syntheticPhrases;
+    }
+    printf("字碼表：%s；詞語庫：%s\n", options.dictPath.c_str(), options.phrasesPath.c_str());
+
+    // 先以一個程序建立映像檔：量測的都是已有映像檔時的啟動（與第一個之後的輸入法程序相同）
+    puts("建立映像檔：");
+    bool ok = run(options, true, 1);
+    if (ok) puts("量測：");
+    for (size_t i = 0; ok && i < options.processes.size(); i++) {
+        ok = run(options, false, options.processes[i]) && run(options, true, options.processes[i]);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// dict_patch.cpp - 字碼表的差異更新：完整解析新版本與解析差異檔、規劃、就地更新字典、改寫檔案的時間
+//
+// 以字碼表為第 41 版，隨機修改產生連續的幾個版本（調整候選字順序、刪除字碼、新增字碼），
+// 以 DictDelta::diff 產生差異檔；套用的結果須與完整解析新版本的字典相同
+#include "bench_data.h"
+#include "dict_delta.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* USAGE =
+    "用法：dict_patch [選項]\n"
+    "  -d 檔案   字碼表（預設為合成的字碼表）\n"
+    "  -s 數量   差異檔的步驟數（預設 3）\n"
+    "  -c 數量   每個步驟變更的字碼數（預設 100）\n"
+    "  -r 次數   量測次數（預設 3）\n";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string dictPath;
+    int steps = 3;
+    int changes = 100;
+    int rounds = 3;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "-d") options.dictPath = value;
+        else if (arg == "-s") options.steps = atoi(value.c_str());
+        else if (arg == "-c") options.changes = atoi(value.c_str());
+        else if (arg == "-r") options.rounds = atoi(value.c_str());
+        else return false;
+    }
+    return options.steps >= 1 && options.changes >= 1 && options.rounds >= 1;
+}
+
+// 下一個版本：changes 個字碼中約一半調整候選字順序，四分之一刪除，四分之一新增
+DictFiles::CodeTable nextVersion(const DictFiles::CodeTable& table, int changes, std::mt19937& rng) {
+    DictFiles::CodeTable next = table;
+    std::vector<std::wstring> codes;
+    for (DictFiles::CodeTable::const_iterator it = table.begin(); it != table.end(); ++it) codes.push_back(it->first);
+    const wchar_t codeChars[] = L"uiojk";
+    for (int i = 0; i < changes; i++) {
+        int action = rng() % 4;
+        if (action == 3 || codes.empty()) {
+            std::wstring code;
+            do {
+                code.clear();
+                for (int k = 0; k < 6; k++) code += codeChars[rng() % 5];
+            } while (next.count(code));
+            size_t count = 1 + rng() % 3;
+            for (size_t k = 0; k < count; k++) next[code].push_back(std::wstring(1, (wchar_t)(0x4E00 + rng() % 20000)));
+            continue;
+        }
+        const std::wstring& code = codes[rng() % codes.size()];
+        if (!next.count(code)) continue;
+        if (action == 2) {
+            next.erase(code);
+        } else {
+            std::vector<std::wstring>& words = next[code];
+            std::shuffle(words.begin(), words.end(), rng);
+            words.push_back(std::wstring(1, (wchar_t)(0x4E00 + rng() % 20000)));
+        }
+    }
+    return next;
+}
+
+double since(Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    if (options.dictPath.empty()) {
+        std::string phrasesPath;
+        if (!BenchData::writeSynthetic("core/tests/bench", options.dictPath, phrasesPath)) {
+            fprintf(stderr, "無法寫出合成資料：core/tests/bench\n");
+            return 2;
+        }
+    }
+    std::string content;
+    if (!DictFiles::readFile(options.dictPath, content)) {
+        fprintf(stderr, "無法讀取字碼表：%s\n", options.dictPath.c_str());
+        return 2;
+    }
+    // 沒有版本行的字碼表視為第 41 版
+    if (DictDelta::readVersion(content) == 0) content = "# version: 41\n" + content;
+    uint32_t version = DictDelta::readVersion(content);
+
+    DictFiles::CodeTable base;
+    int baseCount = DictFiles::parseMainDict(content, base);
+    std::mt19937 rng(20240601);
+    std::vector<DictDelta::Step> chain;
+    DictFiles::CodeTable target = base;
+    for (int i = 0; i < options.steps; i++) {
+        DictFiles::CodeTable next = nextVersion(target, options.changes, rng);
+        chain.push_back(DictDelta::diff(target, next, version + i, version + i + 1));
+        target.swap(next);
+    }
+    std::string delta = DictDelta::formatDelta(chain);
+    std::string patched;
+    DictDelta::Step applied;
+    if (DictDelta::update(content, delta, patched, applied) != DictDelta::UPDATE_APPLIED) {
+        printf("無法套用產生的差異檔\n");
+        return 1;
+    }
+    printf("字碼表：%s（第 %u 版，%d 筆，%.2f MB）；差異檔：%d 個步驟、%zu 個字碼（%.1f KB）\n",
+           options.dictPath.c_str(), version, baseCount, content.size() / 1048576.0, options.steps,
+           applied.changes.size(), delta.size() / 1024.0);
+
+    for (int round = 1; round <= options.rounds; round++) {
+        // 完整下載後的解析
+        DictFiles::CodeTable full;
+        Clock::time_point begin = Clock::now();
+        int fullCount = DictFiles::parseMainDict(patched, full);
+        double fullMs = since(begin);
+
+        begin = Clock::now();
+        std::vector<DictDelta::Step> steps;
+        bool parsed = DictDelta::parseDelta(delta, steps);
+        double parseMs = since(begin);
+
+        begin = Clock::now();
+        DictDelta::Step merged;
+        DictDelta::Plan plan = DictDelta::plan(steps, version, merged);
+        double planMs = since(begin);
+
+        // 就地更新（複製字典不計入）
+        DictFiles::CodeTable table = base;
+        begin = Clock::now();
+        int count = DictDelta::countAfter(table, baseCount, merged);
+        DictDelta::applyToTable(table, merged);
+        double applyMs = since(begin);
+
+        begin = Clock::now();
+        int fileCount = 0;
+        std::string rewritten = DictDelta::applyToFile(content, merged, fileCount);
+        double rewriteMs = since(begin);
+
+        if (!parsed || plan != DictDelta::PLAN_APPLY || table != full || table != target || count != fullCount ||
+            fileCount != fullCount || count != merged.entryCount || rewritten != patched) {
+            printf("第 %d 次：套用的結果與完整解析不同\n", round);
+            return 1;
+        }
+        printf("第 %d 次：完整解析 %7.2f ms；差異檔解析 %6.3f ms、規劃 %6.3f ms、就地更新 %6.3f ms、改寫檔案 %6.2f ms\n",
+               round, fullMs, parseMs, planMs, applyMs, rewriteMs);
+    }
+    return 0;
+}
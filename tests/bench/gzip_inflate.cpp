@@ -0,0 +1,179 @@
+// gzip_inflate.cpp - gzip 下載的解壓縮：邊收邊解（與 HttpTransfer::fetch 相同）與先收完整個檔案再解的吞吐量與記憶體峰值
+//
+// 兩種方式各在一個子程序中執行，解出的內容都寫到檔案；峰值 RSS 取自子程序的 getrusage，
+// 開始時的 RSS 是 fork 時繼承的部分，兩者的差才是解壓縮本身使用的記憶體
+#include "bench_data.h"
+#include "dict_files.h"
+#include "gzip_stream.h"
+#include "http_transfer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static const char* USAGE =
+    "用法：gzip_inflate [選項]\n"
+    "  -f 檔案   gzip 檔（預設以合成的字碼表與詞語庫重複到 -m 的大小，再以系統的 gzip 壓縮）\n"
+    "  -m MB     合成資料解壓縮後的大小（預設 40）\n"
+    "  -r 次數   每種方式的量測次數（預設 3）\n";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string gzipPath;
+    int megabytes = 40;
+    int rounds = 3;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "-f") options.gzipPath = value;
+        else if (arg == "-m") options.megabytes = atoi(value.c_str());
+        else if (arg == "-r") options.rounds = atoi(value.c_str());
+        else return false;
+    }
+    return options.megabytes >= 1 && options.rounds >= 1;
+}
+
+// 合成資料：字碼表與詞語庫交替重複（重複的間隔大於 32 KB 視窗，壓縮率與實際的字碼表相近）
+bool writeSynthetic(const Options& options, std::string& gzipPath) {
+    std::string dictPath, phrasesPath, dict, phrases;
+    if (!BenchData::writeSynthetic("core/tests/bench", dictPath, phrasesPath) ||
+        !DictFiles::readFile(dictPath, dict) || !DictFiles::readFile(phrasesPath, phrases)) {
+        return false;
+    }
+    std::string textPath = "core/tests/bench/inflate.txt";
+    FILE* file = fopen(textPath.c_str(), "wb");
+    if (!file) return false;
+    size_t target = (size_t)options.megabytes * 1024 * 1024;
+    bool ok = true;
+    for (size_t written = 0; ok && written < target; written += dict.size() + phrases.size()) {
+        ok = fwrite(dict.data(), 1, dict.size(), file) == dict.size() &&
+             fwrite(phrases.data(), 1, phrases.size(), file) == phrases.size();
+    }
+    ok = fclose(file) == 0 && ok;
+    gzipPath = textPath + ".gz";
+    return ok && system(("gzip -6 -c " + textPath + " > " + gzipPath).c_str()) == 0;
+}
+
+long maxRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 邊收邊解：每次讀入一個傳輸區塊就餵給解碼器，解出的內容直接寫入
+bool inflateStreaming(const std::string& path, FILE* out, uint64_t& size) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) return false;
+    GzipStream::Decoder decoder;
+    bool writeFailed = false;
+    GzipStream::Decoder::Output emit = [&](const char* data, size_t length) {
+        writeFailed = writeFailed || fwrite(data, 1, length, out) != length;
+    };
+    std::vector<char> buffer(HttpTransfer::BLOCK_SIZE);
+    size_t got;
+    GzipStream::Status status = GzipStream::GZ_NEED_INPUT;
+    while (status != GzipStream::GZ_ERROR && (got = fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+        status = decoder.feed(buffer.data(), got, emit);
+    }
+    fclose(in);
+    size = decoder.outputSize();
+    return status == GzipStream::GZ_DONE && !writeFailed;
+}
+
+// 先收完整個壓縮檔，解壓縮到記憶體後再寫出
+bool inflateBuffered(const std::string& path, FILE* out, uint64_t& size) {
+    std::string compressed;
+    if (!DictFiles::readFile(path, compressed)) return false;
+    std::string text;
+    GzipStream::Decoder decoder;
+    GzipStream::Status status = decoder.feed(compressed.data(), compressed.size(),
+                                             [&](const char* data, size_t length) { text.append(data, length); });
+    size = text.size();
+    return status == GzipStream::GZ_DONE && fwrite(text.data(), 1, text.size(), out) == text.size();
+}
+
+struct Report {
+    int ok;
+    double ms;
+    uint64_t size;
+    long startKb;
+    long peakKb;
+};
+
+// 在子程序中解壓縮一次並回報結果
+bool run(const std::string& path, bool streaming, Report& report) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Report child = {0, 0, 0, maxRssKb(), 0};
+        FILE* out = fopen("core/tests/bench/inflate.out", "wb");
+        Clock::time_point begin = Clock::now();
+        bool ok = out && (streaming ? inflateStreaming(path, out, child.size) : inflateBuffered(path, out, child.size));
+        ok = out && fclose(out) == 0 && ok;
+        child.ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+        child.ok = ok ? 1 : 0;
+        child.peakKb = maxRssKb();
+        _exit(write(fds[1], &child, sizeof(child)) == (ssize_t)sizeof(child) ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = read(fds[0], &report, sizeof(report)) == (ssize_t)sizeof(report);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 && report.ok;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    if (options.gzipPath.empty() && !writeSynthetic(options, options.gzipPath)) {
+        fprintf(stderr, "無法寫出合成資料：core/tests/bench\n");
+        return 2;
+    }
+    FILE* file = fopen(options.gzipPath.c_str(), "rb");
+    if (!file) {
+        fprintf(stderr, "無法讀取：%s\n", options.gzipPath.c_str());
+        return 2;
+    }
+    fseek(file, 0, SEEK_END);
+    long compressedSize = ftell(file);
+    fclose(file);
+    printf("gzip 檔：%s（%.1f MB）\n", options.gzipPath.c_str(), compressedSize / 1048576.0);
+
+    uint64_t expected = 0;
+    for (int round = 1; round <= options.rounds; round++) {
+        for (int mode = 0; mode < 2; mode++) {
+            bool streaming = mode == 0;
+            Report report;
+            if (!run(options.gzipPath, streaming, report) || (expected && report.size != expected)) {
+                printf("%s：失敗（資料錯誤或無法寫出）\n", streaming ? "邊收邊解" : "收完再解");
+                return 1;
+            }
+            expected = report.size;
+            printf("第 %d 次 %s：解出 %.1f MB，%7.1f ms，%6.1f MB/s；峰值 RSS %7.1f MB（開始時 %.1f MB）\n", round,
+                   streaming ? "邊收邊解" : "收完再解", report.size / 1048576.0, report.ms,
+                   report.size / 1048576.0 / (report.ms / 1000), report.peakKb / 1024.0, report.startKb / 1024.0);
+        }
+    }
+    std::remove("core/tests/bench/inflate.out");
+    return 0;
+}
@@ -0,0 +1,305 @@
+// query_load.cpp - 共用字典服務的負載量測：多個工作階段同時逐鍵查詢、選字、學習與聯想
+//
+// 先確認服務的結果與本機引擎相同，再依序以不同的工作階段數量測吞吐量與延遲，最後量測沒有服務時的連線時間
+#include "bench_data.h"
+#include "query_client.h"
+#include "query_server.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const char* USAGE =
+    "用法：query_load [選項]\n"
+    "  -d 檔案   字碼表（預設為合成的字碼表）\n"
+    "  -p 檔案   詞語庫（預設為合成的詞語庫）\n"
+    "  -u 檔案   用戶字典（預設以字碼表的前 500 個字合成）\n"
+    "  -a 位址   量測執行中的服務（須使用同一個字碼表）；預設在這個程序啟動服務\n"
+    "  -n 數量   工作階段數，以逗號分隔（預設 1,8,32）\n"
+    "  -t 秒     每個工作階段數的量測時間（預設 3）\n"
+    "  -w 毫秒   每次按鍵前的平均思考時間（預設 0：收到回覆立即送出下一個）\n";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string dictPath;
+    std::string phrasesPath;
+    std::string userDictPath;
+    std::string address;
+    std::vector<int> sessions = {1, 8, 32};
+    double seconds = 3;
+    double thinkMs = 0;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "-d") options.dictPath = value;
+        else if (arg == "-p") options.phrasesPath = value;
+        else if (arg == "-u") options.userDictPath = value;
+        else if (arg == "-a") options.address = value;
+        else if (arg == "-t") options.seconds = atof(value.c_str());
+        else if (arg == "-w") options.thinkMs = atof(value.c_str());
+        else if (arg == "-n") {
+            options.sessions.clear();
+            std::stringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (atoi(item.c_str()) > 0) options.sessions.push_back(atoi(item.c_str()));
+            }
+            if (options.sessions.empty()) return false;
+        } else return false;
+    }
+    return options.seconds > 0;
+}
+
+double elapsedUs(Clock::time_point begin) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+}
+
+// 本機引擎的結果與服務的結果是否相同（查詢狀態與候選字）
+bool sameLookup(const EngineCore::Lookup& a, const EngineCore::Session& as,
+                const EngineCore::Lookup& b, const EngineCore::Session& bs) {
+    return a.status == b.status && a.code == b.code && as.candidates == bs.candidates &&
+           as.candidateCodes == bs.candidateCodes && as.totalPages == bs.totalPages &&
+           as.showCand == bs.showCand && as.isInputting == bs.isInputting && as.inputError == bs.inputError;
+}
+
+// 隨機查詢、選字、學習與聯想，逐一與本機引擎比對；中途改變用戶字典後重新同步（只送出變更）
+bool verify(const std::string& address, const EngineCore::Model& model, const DictFiles::UserEntries& user,
+            const std::vector<std::wstring>& codes) {
+    EngineCore::Learning local;
+    EngineCore::loadLearning(local, user, time(nullptr));
+    QueryClient::Client client;
+    if (!client.connect(address)) {
+        puts("驗證：無法連線");
+        return false;
+    }
+    client.syncLearning(local);
+    std::mt19937 rng(1);
+    EngineCore::Session localSession, remoteSession;
+    const int ROUNDS = 3000;
+    for (int i = 0; i < ROUNDS; i++) {
+        if (i == ROUNDS / 2) {
+            // 用戶字典被修改：刪除一半、其餘頻率加一，再同步
+            for (auto it = local.wordFreq.begin(); it != local.wordFreq.end();) {
+                if (rng() % 2) {
+                    it = local.wordFreq.erase(it);
+                } else {
+                    it->second.frequency++;
+                    ++it;
+                }
+            }
+            client.syncLearning(local);
+        }
+        std::wstring code = codes[rng() % codes.size()];
+        if (i % 7 == 0) code = code.substr(0, 1) + L"*";
+        localSession.input = remoteSession.input = code;
+        EngineCore::Lookup localResult = EngineCore::lookup(model, local, localSession);
+        EngineCore::Lookup remoteResult;
+        if (!client.lookup(remoteSession, remoteResult) ||
+            !sameLookup(localResult, localSession, remoteResult, remoteSession)) {
+            printf("驗證：第 %d 次查詢的結果不同\n", i + 1);
+            return false;
+        }
+        if (localSession.candidates.empty()) continue;
+        std::wstring word = localSession.candidates[rng() % localSession.candidates.size()];
+        // 學習時間以秒計：同一秒內本機與服務的結果相同
+        EngineCore::learn(local, word, time(nullptr));
+        client.learn(word);
+        EngineCore::predict(model, local, localSession, word);
+        if (!client.predict(remoteSession, word) || localSession.candidates != remoteSession.candidates ||
+            localSession.candidateCodes != remoteSession.candidateCodes) {
+            printf("驗證：第 %d 次聯想的結果不同\n", i + 1);
+            return false;
+        }
+    }
+    printf("驗證：%d 次查詢、學習與聯想的結果都與本機引擎相同\n", ROUNDS);
+    return true;
+}
+
+struct SessionResult {
+    std::vector<float> latencyUs;
+    unsigned long long frames = 0;
+    unsigned long long requests = 0;
+    bool failed = false;
+};
+
+// 一個工作階段：逐鍵查詢字碼（1 到 n 碼），選第一個候選字後學習並聯想
+void runSession(const std::string& address, const DictFiles::UserEntries& user, const std::vector<std::wstring>& codes,
+                double thinkMs, unsigned seed, std::atomic<int>& ready, const std::atomic<bool>& stop,
+                SessionResult& result) {
+    QueryClient::Client client;
+    bool connected = client.connect(address);
+    ready++;
+    if (!connected) {
+        result.failed = true;
+        return;
+    }
+    EngineCore::Learning learning;
+    EngineCore::loadLearning(learning, user, time(nullptr));
+    client.syncLearning(learning);
+    EngineCore::Session session;
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> think(thinkMs > 0 ? 1.0 / thinkMs : 1.0);
+    while (!stop) {
+        std::wstring code = codes[rng() % codes.size()];
+        for (size_t k = 1; k <= code.size() && !stop; k++) {
+            if (thinkMs > 0) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(think(rng)));
+            session.input = code.substr(0, k);
+            EngineCore::Lookup lookup;
+            Clock::time_point begin = Clock::now();
+            if (!client.lookup(session, lookup)) {
+                result.failed = true;
+                return;
+            }
+            result.latencyUs.push_back((float)elapsedUs(begin));
+            result.frames++;
+            result.requests++;
+        }
+        if (session.candidates.empty()) continue;
+        // 學習與聯想在同一個訊框送出
+        std::wstring word = session.candidates[0];
+        client.learn(word);
+        Clock::time_point begin = Clock::now();
+        if (!client.predict(session, word)) {
+            result.failed = true;
+            return;
+        }
+        result.latencyUs.push_back((float)elapsedUs(begin));
+        result.frames++;
+        result.requests += 2;
+    }
+}
+
+bool measure(const std::string& address, const DictFiles::UserEntries& user, const std::vector<std::wstring>& codes,
+             int sessions, double seconds, double thinkMs) {
+    std::vector<SessionResult> results(sessions);
+    std::atomic<int> ready(0);
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (int s = 0; s < sessions; s++) {
+        threads.push_back(std::thread(runSession, std::cref(address), std::cref(user), std::cref(codes), thinkMs,
+                                      (unsigned)s, std::ref(ready), std::cref(stop), std::ref(results[s])));
+    }
+    // 全部連線並同步學習資料後才開始計時
+    while (ready.load() < sessions) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    Clock::time_point begin = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    double elapsed = elapsedUs(begin) / 1e6;
+
+    std::vector<float> latency;
+    unsigned long long frames = 0, requests = 0;
+    int failures = 0;
+    for (int s = 0; s < sessions; s++) {
+        latency.insert(latency.end(), results[s].latencyUs.begin(), results[s].latencyUs.end());
+        frames += results[s].frames;
+        requests += results[s].requests;
+        failures += results[s].failed ? 1 : 0;
+    }
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&latency](double p) {
+        return latency.empty() ? 0.0 : (double)latency[(size_t)(p * (latency.size() - 1))];
+    };
+    printf("%3d 個工作階段：每秒 %8.0f 次往返、%8.0f 個請求；延遲 p50 %6.0f us、p99 %6.0f us、最大 %7.0f us；失敗 %d\n",
+           sessions, frames / elapsed, requests / elapsed, percentile(0.5), percentile(0.99), percentile(1.0), failures);
+    return failures == 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    std::string dir = "core/tests/bench";
+    if (options.dictPath.empty()) {
+        std::string syntheticPhrases;
+        if (!BenchData::writeSynthetic(dir, options.dictPath, syntheticPhrases)) {
+            fprintf(stderr, "無法寫出合成資料：%s\n", dir.c_str());
+            return 2;
+        }
+        if (options.phrasesPath.empty()) options.phrasesPath = syntheticPhrases;
+    }
+
+    // 在這個程序建立模型：本機引擎的比對基準，未指定 -a 時也由它提供服務
+    EngineCore::Model model;
+    std::string content;
+    DictFiles::CodeTable table;
+    if (!DictFiles::readFile(options.dictPath, content)) {
+        fprintf(stderr, "無法讀取字碼表：%s\n", options.dictPath.c_str());
+        return 2;
+    }
+    int count = DictFiles::parseMainDict(content, table);
+    std::vector<std::wstring> codes;
+    for (const auto& pair : table) codes.push_back(pair.first);
+    std::vector<std::wstring> firstWords;
+    for (auto it = table.begin(); it != table.end() && firstWords.size() < 500; ++it) firstWords.push_back(it->second[0]);
+    model.dict.publish(DictModel::build(table, count));
+    if (!options.phrasesPath.empty() && DictFiles::readFile(options.phrasesPath, content)) {
+        DictFiles::CodeTable phrases;
+        int phraseCount = DictFiles::parseWordPhrases(content, phrases);
+        model.wordPhrases = DictModel::buildPhrases(phrases, phraseCount);
+    }
+    if (codes.empty()) {
+        fprintf(stderr, "字碼表沒有內容：%s\n", options.dictPath.c_str());
+        return 2;
+    }
+
+    DictFiles::UserEntries user;
+    if (!options.userDictPath.empty() && DictFiles::readFile(options.userDictPath, content)) {
+        DictFiles::parseUserDict(content, user);
+    } else {
+        std::mt19937 rng(7);
+        for (size_t i = 0; i < firstWords.size(); i++) {
+            DictFiles::UserEntry entry;
+            entry.word = firstWords[i];
+            entry.frequency = 1 + rng() % 10;
+            user.push_back(entry);
+        }
+    }
+    printf("字碼表：%s，%d 個字、%zu 個字碼；詞語庫：%d 個詞語組合；用戶字典：%zu 個記錄\n",
+           options.dictPath.c_str(), count, codes.size(), model.wordPhrases.entryCount(), user.size());
+
+    QueryServer::Server server(model, QueryServer::ReloadCallback());
+    std::string address = options.address;
+    if (address.empty()) {
+        address = dir + "/query_load-" + std::to_string((long)getpid()) + ".sock";
+        if (!server.start(address)) {
+            fprintf(stderr, "無法在 %s 啟動服務\n", address.c_str());
+            return 2;
+        }
+    }
+
+    bool ok = options.address.empty() ? verify(address, model, user, codes) : true;
+    for (size_t i = 0; ok && i < options.sessions.size(); i++) {
+        ok = measure(address, user, codes, options.sessions[i], options.seconds, options.thinkMs);
+    }
+    if (options.address.empty()) {
+        QueryServer::Stats stats = server.stats();
+        server.stop();
+        printf("服務：%llu 條連線、%llu 次往返、%llu 個請求\n", stats.connections, stats.frames, stats.requests);
+    }
+
+    // 沒有服務時輸入法改用本機字典：連線失敗要立即返回
+    QueryClient::Client absent;
+    Clock::time_point begin = Clock::now();
+    bool connected = absent.connect(dir + "/absent.sock");
+    printf("沒有服務時連線：%s，%.0f us\n", connected ? "竟然成功" : "失敗", elapsedUs(begin));
+    return ok && !connected ? 0 : 1;
+}
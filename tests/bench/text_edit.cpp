@@ -0,0 +1,203 @@
+// text_edit.cpp - 暫放區的編輯量測：在 10 萬字的文件上連續輸入、隨機插入刪除與逐字讀取
+//
+// 同一組操作分別套用到 std::wstring（原本的暫放區）、TextModel（片段表），以及加上排版與復原記錄的
+// 無視窗前端（trace_replay.h，與輸入法的暫放區相同的路徑）；每組操作結束後三者的內容須相同
+#include "trace_replay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* USAGE =
+    "用法：text_edit [選項]\n"
+    "  -n 字數   文件的起始長度（預設 100000）\n"
+    "  -e 次數   每組的編輯次數（預設 100000）\n"
+    "  -r 次數   量測次數（預設 3）\n";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    size_t chars = 100000;
+    size_t edits = 100000;
+    int rounds = 3;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "-n") options.chars = (size_t)atol(value.c_str());
+        else if (arg == "-e") options.edits = (size_t)atol(value.c_str());
+        else if (arg == "-r") options.rounds = atoi(value.c_str());
+        else return false;
+    }
+    return options.chars >= 1 && options.rounds >= 1;
+}
+
+// 一次編輯：erase 個字從 pos 刪除，之後在 pos 插入 text
+struct Edit {
+    size_t pos;
+    size_t erase;
+    std::wstring text;
+};
+
+std::wstring document(size_t chars) {
+    std::mt19937 rng(20240601);
+    std::wstring text;
+    text.reserve(chars);
+    while (text.size() < chars) text += (text.size() % 40 == 39) ? L'\n' : (wchar_t)(0x4E00 + rng() % 20000);
+    return text;
+}
+
+// 連續輸入：在文件中間逐字輸入，每 8 個字退格一次，每 2000 字移到另一個位置
+std::vector<Edit> typing(const Options& options) {
+    std::mt19937 rng(1);
+    std::vector<Edit> edits;
+    size_t length = options.chars;
+    size_t cursor = length / 2;
+    for (size_t i = 0; i < options.edits; i++) {
+        if (i % 2000 == 1999) cursor = rng() % (length + 1);
+        Edit edit;
+        if (i % 8 == 7 && cursor > 0) {
+            edit.pos = --cursor;
+            edit.erase = 1;
+            length--;
+        } else {
+            edit.pos = cursor++;
+            edit.erase = 0;
+            edit.text = std::wstring(1, (wchar_t)(0x4E00 + rng() % 20000));
+            length++;
+        }
+        edits.push_back(edit);
+    }
+    return edits;
+}
+
+// 隨機插入刪除：位置平均分布，插入 1 到 4 字（選字、詞語），刪除 1 到 4 字（退格或選取後刪除）；文件長度大致不變
+std::vector<Edit> scattered(const Options& options) {
+    std::mt19937 rng(2);
+    std::vector<Edit> edits;
+    size_t length = options.chars;
+    for (size_t i = 0; i < options.edits; i++) {
+        Edit edit;
+        edit.pos = rng() % (length + 1);
+        edit.erase = 0;
+        if (rng() % 2 && edit.pos < length) {
+            edit.erase = std::min<size_t>(1 + rng() % 4, length - edit.pos);
+            length -= edit.erase;
+        } else {
+            size_t count = 1 + rng() % 4;
+            for (size_t k = 0; k < count; k++) edit.text += (wchar_t)(0x4E00 + rng() % 20000);
+            length += count;
+        }
+        edits.push_back(edit);
+    }
+    return edits;
+}
+
+template <typename Text>
+void apply(Text& text, const std::vector<Edit>& edits) {
+    for (size_t i = 0; i < edits.size(); i++) {
+        if (edits[i].erase) text.erase(edits[i].pos, edits[i].erase);
+        if (!edits[i].text.empty()) text.insert(edits[i].pos, edits[i].text);
+    }
+}
+
+// 無視窗前端：與暫放區相同，刪除為選取後刪除（單字為退格），插入為移動游標後輸入
+void apply(TraceReplay::Frontend& frontend, const std::vector<Edit>& edits) {
+    for (size_t i = 0; i < edits.size(); i++) {
+        const Edit& edit = edits[i];
+        if (edit.erase == 1) {
+            frontend.setCursor((int)edit.pos + 1);
+            frontend.deleteCharAtCursor(false);
+        } else if (edit.erase) {
+            frontend.deleteSelection((int)edit.pos, (int)(edit.pos + edit.erase));
+        }
+        if (!edit.text.empty()) {
+            frontend.setCursor((int)edit.pos);
+            frontend.insertTextAtCursor(edit.text);
+        }
+    }
+}
+
+// 逐字讀取整份文件（繪製、搜尋與存檔的存取方式）
+uint64_t readAll(const std::wstring& text) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < text.size(); i++) sum += text[i];
+    return sum;
+}
+
+uint64_t readAll(const TextModel& text) {
+    uint64_t sum = 0;
+    TextModel::Reader reader(text);
+    wchar_t ch;
+    while (reader.next(ch)) sum += ch;
+    return sum;
+}
+
+double since(Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+// 以三種方式套用同一組編輯並比較結果；回傳是否相同
+bool measure(const char* name, const std::wstring& initial, const std::vector<Edit>& edits,
+             const EngineCore::Model& model) {
+    std::wstring flat = initial;
+    Clock::time_point begin = Clock::now();
+    apply(flat, edits);
+    double flatMs = since(begin);
+
+    TextModel pieces(initial);
+    begin = Clock::now();
+    apply(pieces, edits);
+    double piecesMs = since(begin);
+
+    TraceReplay::Frontend frontend(model, 0);
+    frontend.sync(TraceRecorder::SYNC_BUFFER_MODE, 0, initial);
+    begin = Clock::now();
+    apply(frontend, edits);
+    double frontendMs = since(begin);
+
+    uint64_t flatSum = 0, piecesSum = 0;
+    begin = Clock::now();
+    for (int i = 0; i < 10; i++) flatSum += readAll(flat);
+    double flatReadMs = since(begin) / 10;
+    begin = Clock::now();
+    for (int i = 0; i < 10; i++) piecesSum += readAll(pieces);
+    double piecesReadMs = since(begin) / 10;
+
+    printf("  %s：wstring %8.1f ms；片段表 %7.1f ms；加上排版與復原記錄 %7.1f ms\n", name, flatMs, piecesMs,
+           frontendMs);
+    printf("  %s後逐字讀取 %zu 字：wstring %6.2f ms；片段表 %6.2f ms\n", name, flat.size(), flatReadMs,
+           piecesReadMs);
+    return flatSum == piecesSum && pieces.str() == flat && frontend.buffer().str() == flat;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    std::wstring initial = document(options.chars);
+    std::vector<Edit> typed = typing(options);
+    std::vector<Edit> random = scattered(options);
+    EngineCore::Model model;
+    printf("文件 %zu 字，每組 %zu 次編輯\n", options.chars, options.edits);
+    for (int round = 1; round <= options.rounds; round++) {
+        printf("第 %d 次：\n", round);
+        if (!measure("連續輸入", initial, typed, model) || !measure("隨機插入刪除", initial, random, model)) {
+            printf("  三種方式的結果不同\n");
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+// trace_replay.cpp - 在 Linux 重播輸入法錄下的按鍵軌跡（keystroke_trace.txt），量測每個事件的延遲與記憶體配置
+//
+// 軌跡交給與測試相同的無視窗前端（trace_replay.h）：引擎核心查詢、選字、學習、聯想，以及暫放區的文字模型、
+// 排版與復原記錄；輸出與 Windows 上的重播量測相同（事件數、p50、p99、最大值、operator new 次數與位元組）
+#include "bench_data.h"
+#include "trace_replay.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+static const char* USAGE =
+    "用法：trace_replay [選項] 軌跡檔\n"
+    "  -d 檔案   字碼表（預設為合成的字碼表；重播錄製時的候選字須使用錄製時的字碼表）\n"
+    "  -p 檔案   詞語庫（預設為合成的詞語庫）\n"
+    "  -u 檔案   用戶字典（預設為空）\n"
+    "  -r 次數   重播次數，每次從同一個起始狀態開始（預設 3）\n";
+
+namespace {
+
+struct Options {
+    std::string dictPath;
+    std::string phrasesPath;
+    std::string userDictPath;
+    std::string tracePath;
+    int rounds = 3;
+};
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() > 1 && arg[0] == '-') {
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            if (arg == "-d") options.dictPath = value;
+            else if (arg == "-p") options.phrasesPath = value;
+            else if (arg == "-u") options.userDictPath = value;
+            else if (arg == "-r") options.rounds = atoi(value.c_str());
+            else return false;
+        } else if (options.tracePath.empty()) {
+            options.tracePath = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.tracePath.empty() && options.rounds >= 1;
+}
+
+bool loadModel(const Options& options, EngineCore::Model& model, DictFiles::UserEntries& user) {
+    std::string content;
+    if (!DictFiles::readFile(options.dictPath, content)) {
+        fprintf(stderr, "無法讀取字碼表：%s\n", options.dictPath.c_str());
+        return false;
+    }
+    model.dict.publish(DictModel::loadShared(options.dictPath, content));
+    if (!DictFiles::readFile(options.phrasesPath, content)) {
+        fprintf(stderr, "無法讀取詞語庫：%s\n", options.phrasesPath.c_str());
+        return false;
+    }
+    model.wordPhrases = DictModel::loadSharedPhrases(options.phrasesPath, content);
+    if (!options.userDictPath.empty()) {
+        if (!DictFiles::readFile(options.userDictPath, content)) {
+            fprintf(stderr, "無法讀取用戶字典：%s\n", options.userDictPath.c_str());
+            return false;
+        }
+        DictFiles::parseUserDict(content, user);
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    std::string syntheticDict, syntheticPhrases;
+    if (options.dictPath.empty() || options.phrasesPath.empty()) {
+        if (!BenchData::writeSynthetic("core/tests/bench", syntheticDict, syntheticPhrases)) {
+            fprintf(stderr, "無法寫出合成資料：core/tests/bench\n");
+            return 2;
+        }
+        if (options.dictPath.empty()) options.dictPath = syntheticDict;
+        if (options.phrasesPath.empty()) options.phrasesPath = syntheticPhrases;
+    }
+
+    EngineCore::Model model;
+    DictFiles::UserEntries user;
+    if (!loadModel(options, model, user)) return 2;
+    printf("字碼表：%s；詞語庫：%s；軌跡：%s\n", options.dictPath.c_str(), options.phrasesPath.c_str(),
+           options.tracePath.c_str());
+
+    // 每次重播使用新的前端與相同的時間：學習與聯想的結果每次相同，第一次之後的數據不含首次觸及頁面的成本
+    time_t now = time(nullptr);
+    for (int round = 1; round <= options.rounds; round++) {
+        TraceReplay::Frontend frontend(model, now);
+        frontend.loadLearning(user);
+        TraceRecorder::ReplayResult result;
+        if (!TraceReplay::replayFile(options.tracePath.c_str(), frontend, result)) {
+            fprintf(stderr, "無法讀取軌跡或軌跡沒有事件：%s\n", options.tracePath.c_str());
+            return 2;
+        }
+        printf("第 %d 次重播：暫放區 %zu 字\n%s", round, frontend.buffer().length(),
+               TraceRecorder::formatResult(result).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+// buffer_file_test.cpp - 暫放檔分段讀寫：區塊邊界切開的多位元組字元、BOM 與中斷的存檔
+#include "buffer_file.h"
+#include "utf8_codec.h"
+#include "test_check.h"
+#include "test_files.h"
+
+using namespace TestFiles;
+
+namespace {
+
+const char* FILE_PATH = "core/tests/buffer_file_test.txt";
+const char* TEMP_PATH = "core/tests/buffer_file_test.txt.tmp";
+const std::string BOM = "\xEF\xBB\xBF";
+
+// 2、3、4 位元組的 UTF-8 字元（4 位元組者在 UTF-16 為代理對）
+const std::string TWO = "\xC3\xA9";
+const std::string THREE = "\xE5\xAD\x97";
+const std::string FOUR = "\xF0\xA0\x80\x8B";
+
+}
+
+TEST(multibyteCharsSplitAcrossBlocks) {
+    const size_t block = BufferFile::BLOCK_SIZE;
+    const std::string chars[] = {TWO, THREE, FOUR};
+    bool same = true;
+    for (size_t c = 0; c < 3; c++) {
+        // 讓字元的每一個位元組位置都落在第一個區塊的結尾
+        for (size_t cut = 1; cut < chars[c].size() && same; cut++) {
+            for (int bom = 0; bom < 2 && same; bom++) {
+                std::string bytes = bom ? BOM : std::string();
+                bytes += std::string(block - bytes.size() - cut, 'a');
+                bytes += chars[c] + "尾";
+                bytes += std::string(block, 'b') + chars[c];
+                writeBytes(FILE_PATH, bytes);
+                std::wstring text;
+                same = BufferFile::load(FILE_PATH, text) == BufferFile::OK &&
+                       text == Utf8Codec::decode(bom ? bytes.substr(3) : bytes);
+            }
+        }
+    }
+    CHECK(same);
+    std::remove(FILE_PATH);
+}
+
+TEST(bomHandling) {
+    std::wstring text;
+    // 只有開頭的 BOM 被略過
+    writeBytes(FILE_PATH, BOM + "字" + BOM);
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK);
+    CHECK(text == L"字\xFEFF");
+    // 沒有 BOM、只有 BOM、空檔與不完整的 BOM
+    writeBytes(FILE_PATH, "abc");
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK && text == L"abc");
+    writeBytes(FILE_PATH, BOM);
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK && text.empty());
+    writeBytes(FILE_PATH, "");
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK && text.empty());
+    writeBytes(FILE_PATH, "\xEF\xBB");
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK && text == L"\xFFFD\xFFFD");
+    // 第二個區塊開頭的 BOM 位元組是內容
+    std::string bytes = std::string(BufferFile::BLOCK_SIZE, 'a') + BOM;
+    writeBytes(FILE_PATH, bytes);
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK);
+    CHECK(text.size() == BufferFile::BLOCK_SIZE + 1 && text[BufferFile::BLOCK_SIZE] == 0xFEFF);
+
+    // 存檔一律加上 BOM；讀回後與原文相同
+    TextModel model(L"é字");
+    model.append(Utf8Codec::decode(FOUR));
+    CHECK(BufferFile::save(FILE_PATH, model) == BufferFile::OK);
+    CHECK(readBytes(FILE_PATH) == BOM + TWO + THREE + FOUR);
+    CHECK(BufferFile::load(FILE_PATH, text) == BufferFile::OK && text == model.str());
+    CHECK(BufferFile::load("core/tests/no_such_file.txt", text) == BufferFile::OPEN_FAILED);
+    std::remove(FILE_PATH);
+}
+
+TEST(writeSplitsPiecesAndSteps) {
+    // 多片段、每段都以多位元組字元切開；超過一次編碼的字元數與一個區塊
+    std::wstring big;
+    std::wstring four = Utf8Codec::decode(FOUR);
+    for (int i = 0; i < 30000; i++) big += (i % 3 == 0) ? four : (i % 3 == 1 ? L"字" : L"a");
+    TextModel model(big);
+    for (size_t pos = 7; pos < big.size(); pos += 4099) model.insert(pos, L"é");
+    std::wstring expected = model.str();
+
+    std::string streamed;
+    uint64_t lastDone = 0;
+    bool increasing = true;
+    FILE* file = std::fopen(FILE_PATH, "wb");
+    CHECK(BufferFile::write(file, model, false,
+        [&](uint64_t done, uint64_t total) {
+            increasing = increasing && done >= lastDone && done <= total;
+            lastDone = done;
+            return true;
+        },
+        [&](const char* data, size_t size) { streamed.append(data, size); }) == BufferFile::OK);
+    std::fclose(file);
+    CHECK(increasing && lastDone == expected.size());
+    CHECK(streamed == Utf8Codec::encode(expected));
+    CHECK(readBytes(FILE_PATH) == streamed);
+
+    std::wstring text;
+    uint64_t bytesSeen = 0;
+    CHECK(BufferFile::load(FILE_PATH, text, BufferFile::Progress(),
+        [&](const char*, size_t size) { bytesSeen += size; }) == BufferFile::OK);
+    CHECK(text == expected && bytesSeen == streamed.size());
+    std::remove(FILE_PATH);
+}
+
+TEST(interruptedSaveKeepsOldFile) {
+    TextModel original(L"舊的內容");
+    CHECK(BufferFile::save(FILE_PATH, original) == BufferFile::OK);
+    std::string before = readBytes(FILE_PATH);
+    CHECK(!exists(TEMP_PATH));
+
+    // 寫到一半取消：原檔不變，暫存檔已移除
+    TextModel big(std::wstring(BufferFile::BLOCK_SIZE * 2, L'字'));
+    int calls = 0;
+    CHECK(BufferFile::save(FILE_PATH, big, [&calls](uint64_t, uint64_t) { return ++calls < 2; }) ==
+          BufferFile::CANCELLED);
+    CHECK(calls == 2);
+    CHECK(readBytes(FILE_PATH) == before && !exists(TEMP_PATH));
+
+    // 寫入失敗（唯讀開啟的檔案）
+    FILE* readOnly = std::fopen(FILE_PATH, "rb");
+    CHECK(BufferFile::write(readOnly, big, true) == BufferFile::IO_FAILED);
+    std::fclose(readOnly);
+    CHECK(readBytes(FILE_PATH) == before);
+
+    // 讀取時取消：輸出不變
+    CHECK(BufferFile::save(FILE_PATH, big) == BufferFile::OK);
+    std::wstring text = L"保留";
+    CHECK(BufferFile::load(FILE_PATH, text, [](uint64_t, uint64_t) { return false; }) == BufferFile::CANCELLED);
+    CHECK(text == L"保留");
+
+    // 無法建立暫存檔：原檔不變
+    CHECK(BufferFile::save("core/tests/no_such_dir/x.txt", original) == BufferFile::OPEN_FAILED);
+    std::remove(FILE_PATH);
+}
+
+int main() {
+    return TestCheck::runAll("buffer_file");
+}
@@ -0,0 +1,204 @@
+// clipboard_sync_test.cpp - 剪貼簿同步：合併連續編輯、最長延遲、內容比對與延遲產生
+#include "clipboard_sync.h"
+#include "test_check.h"
+
+using namespace ClipboardSync;
+
+namespace {
+
+// 假剪貼簿與時鐘：計時器到期時由 advance 觸發 onTimer
+class FakeClipboard : public ClipboardEnvironment {
+public:
+    uint32_t clock;
+    bool timerArmed;
+    uint32_t timerDue;
+    std::vector<unsigned> scheduled;
+    bool canAnnounce;
+    bool canPublish;
+    bool announced;          // 已登記延遲產生，資料尚未放入
+    std::wstring contents;
+    unsigned publishes;
+
+    FakeClipboard()
+        : clock(1000), timerArmed(false), timerDue(0), canAnnounce(false), canPublish(true),
+          announced(false), publishes(0) {}
+
+    uint32_t now() { return clock; }
+    bool announce() {
+        if (!canAnnounce) return false;
+        announced = true;
+        contents.clear();
+        return true;
+    }
+    bool publish(const TextModel& text) {
+        if (!canPublish) return false;
+        announced = false;
+        contents = text.str();
+        publishes++;
+        return true;
+    }
+    bool render(const TextModel& text) {
+        if (!announced) return false;
+        announced = false;
+        contents = text.str();
+        return true;
+    }
+    void scheduleFlush(unsigned ms) {
+        timerArmed = true;
+        timerDue = clock + ms;
+        scheduled.push_back(ms);
+    }
+    void cancelFlush() { timerArmed = false; }
+
+    // 前進 ms 毫秒，途中到期的計時器依序觸發
+    void advance(ClipboardSyncer& syncer, const TextModel& text, uint32_t ms) {
+        uint32_t target = clock + ms;
+        while (timerArmed && (int32_t)(timerDue - target) <= 0) {
+            clock = timerDue;
+            timerArmed = false;
+            syncer.onTimer(text);
+        }
+        clock = target;
+    }
+};
+
+void edit(ClipboardSyncer& syncer, TextModel& text, const std::wstring& s) {
+    text.append(s);
+    syncer.onEdit();
+}
+
+}
+
+TEST(debounceCoalescesTyping) {
+    FakeClipboard env;
+    ClipboardSyncer syncer(env, 150, 1000);
+    syncer.setDelayedRendering(false);
+    TextModel text;
+    for (int i = 0; i < 5; i++) {
+        edit(syncer, text, L"字");
+        env.advance(syncer, text, 100);
+    }
+    // 每次編輯都重新計時：打字期間不寫入
+    CHECK(env.publishes == 0 && syncer.pending());
+    CHECK(env.scheduled.size() == 5 && env.scheduled[4] == 150);
+    env.advance(syncer, text, 100);
+    CHECK(env.publishes == 1 && env.contents == L"字字字字字");
+    CHECK(!syncer.pending() && syncer.owned() && syncer.rendered());
+    CHECK(syncer.writeCount() == 1);
+
+    // 立即同步會取消計時器
+    edit(syncer, text, L"詞");
+    syncer.flush(text);
+    CHECK(!env.timerArmed && env.publishes == 2 && env.contents == L"字字字字字詞");
+    env.advance(syncer, text, 500);
+    CHECK(env.publishes == 2);
+}
+
+TEST(continuousTypingFlushesWithinMaxDelay) {
+    FakeClipboard env;
+    env.clock = 0xFFFFFF00u;   // 時鐘在批次中途回繞
+    ClipboardSyncer syncer(env, 150, 1000);
+    syncer.setDelayedRendering(false);
+    TextModel text;
+    uint32_t start = env.clock;
+    uint32_t firstWrite = 0;
+    for (int i = 0; i < 30; i++) {
+        edit(syncer, text, L"a");
+        env.advance(syncer, text, 100);
+        if (env.publishes == 1 && firstWrite == 0) firstWrite = env.clock - start;
+    }
+    // 從第一次編輯起最多延遲 1000 毫秒；3 秒的連續輸入寫入約 3 次
+    CHECK(firstWrite > 0 && firstWrite <= 1100);
+    CHECK(env.publishes >= 2 && env.publishes <= 3);
+    env.advance(syncer, text, 1000);
+    CHECK(env.contents == text.str() && !syncer.pending());
+}
+
+TEST(unchangedContentIsNotRewritten) {
+    FakeClipboard env;
+    ClipboardSyncer syncer(env);
+    syncer.setDelayedRendering(false);
+    TextModel text(L"內容");
+    syncer.onEdit();
+    syncer.flush(text);
+    CHECK(env.publishes == 1);
+    // 編輯後又改回原樣：雜湊相同，略過
+    text.append(L"x");
+    syncer.onEdit();
+    text.erase(text.length() - 1);
+    env.advance(syncer, text, 200);
+    CHECK(env.publishes == 1 && syncer.skipCount() == 1);
+    // 剪貼簿被其他程式取代後，相同內容也要重寫
+    syncer.onOwnershipLost();
+    env.contents = L"別人的";
+    syncer.onEdit();
+    env.advance(syncer, text, 200);
+    CHECK(env.publishes == 2 && env.contents == L"內容");
+    // 空白暫放區不清除剪貼簿
+    TextModel empty;
+    syncer.onOwnershipLost();
+    syncer.flush(empty);
+    CHECK(env.publishes == 2 && env.contents == L"內容");
+    // 剪貼簿無法開啟：下次同步再試
+    env.canPublish = false;
+    text.append(L"二");
+    syncer.flush(text);
+    CHECK(!syncer.owned());
+    env.canPublish = true;
+    syncer.flush(text);
+    CHECK(env.contents == L"內容二");
+    CHECK(ClipboardSyncer::contentHash(text) == ClipboardSyncer::contentHash(TextModel(L"內容二")));
+    CHECK(ClipboardSyncer::contentHash(text) != ClipboardSyncer::contentHash(TextModel(L"內容三")));
+}
+
+TEST(delayedRenderingUsesCurrentText) {
+    FakeClipboard env;
+    env.canAnnounce = true;
+    ClipboardSyncer syncer(env);
+    TextModel text(L"甲");
+    syncer.onEdit();
+    env.advance(syncer, text, 200);
+    CHECK(env.announced && syncer.owned() && !syncer.rendered());
+    CHECK(env.publishes == 0 && syncer.writeCount() == 1);
+    // 登記後的編輯不需重新計時或重寫
+    size_t scheduled = env.scheduled.size();
+    edit(syncer, text, L"乙");
+    CHECK(env.scheduled.size() == scheduled && !syncer.pending());
+    syncer.flush(text);
+    CHECK(syncer.skipCount() == 1);
+    // 貼上時才產生資料，取目前的文字
+    syncer.onRenderRequest(text);
+    CHECK(env.contents == L"甲乙" && syncer.rendered() && syncer.renderCount() == 1);
+    // 已產生後再編輯：重新登記
+    edit(syncer, text, L"丙");
+    env.advance(syncer, text, 200);
+    CHECK(env.announced && syncer.writeCount() == 2);
+}
+
+TEST(materializeBeforeTextIsCleared) {
+    FakeClipboard env;
+    env.canAnnounce = true;
+    ClipboardSyncer syncer(env);
+    TextModel text(L"保留");
+    syncer.flush(text);
+    CHECK(env.announced);
+    // 暫放區即將清空：先放入實際資料
+    syncer.materialize(text);
+    CHECK(env.publishes == 1 && env.contents == L"保留" && syncer.rendered());
+    syncer.materialize(text);
+    CHECK(env.publishes == 1);
+
+    // 剪貼簿暫時無法開啟：保留當時的文字，貼上時使用
+    text = std::wstring(L"新");
+    syncer.onOwnershipLost();
+    syncer.flush(text);
+    env.canPublish = false;
+    syncer.materialize(text);
+    text.clear();
+    syncer.onRenderRequest(text);
+    CHECK(env.contents == L"新" && syncer.rendered());
+}
+
+int main() {
+    return TestCheck::runAll("clipboard_sync");
+}
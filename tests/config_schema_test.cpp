@@ -0,0 +1,152 @@
+// config_schema_test.cpp - 設定檔結構描述：解析、無效值、熱重新載入只套用變更的鍵與就地修改
+#include "config_schema.h"
+#include "test_check.h"
+
+using namespace ConfigSchema;
+
+namespace {
+
+const KeyDef DEFS[] = {
+    {"Window", "width", TYPE_INT, 100, 2000},
+    {"Window", "topmost", TYPE_BOOL, 0, 1},
+    {"Colors", "text_color", TYPE_COLOR, 0, 0},
+    {"Font", "font_name", TYPE_STRING, 0, 0},
+    {"Window", "opacity", TYPE_INT, 0, 255},
+};
+enum { WIDTH, TOPMOST, TEXT_COLOR, FONT_NAME, OPACITY, KEY_COUNT };
+
+const char* CONFIG =
+    "# 註解\n"
+    "[Window]\n"
+    "width = 640\n"
+    "topmost=true\n"
+    "opacity=200\n"
+    "\n"
+    "[Colors]\n"
+    "text_color=#102030\n"
+    "\n"
+    "[Font]\n"
+    "font_name = 微軟正黑體 \n";
+
+}
+
+TEST(parseAllTypes) {
+    Schema schema(DEFS, KEY_COUNT);
+    CHECK(schema.size() == KEY_COUNT && schema.tableSize() >= 2 * KEY_COUNT);
+    for (size_t i = 0; i < KEY_COUNT; i++) CHECK(schema.find(DEFS[i].key) == (int)i);
+    CHECK(schema.find("widt") == -1 && schema.find("width2") == -1 && schema.find("") == -1);
+
+    Values values;
+    schema.parse(CONFIG, values);
+    CHECK(values.size() == KEY_COUNT);
+    CHECK(values[WIDTH].present && values[WIDTH].number == 640);
+    CHECK(values[TOPMOST].present && values[TOPMOST].number == 1);
+    CHECK(values[TEXT_COLOR].number == 0x302010);
+    CHECK(values[FONT_NAME].text == "微軟正黑體");
+    CHECK(values[OPACITY].number == 200);
+    CHECK(schema.format(TEXT_COLOR, values[TEXT_COLOR]) == "#102030");
+    CHECK(schema.format(TOPMOST, values[TOPMOST]) == "1");
+    CHECK(schema.format(WIDTH, values[WIDTH]) == "640");
+}
+
+TEST(invalidValuesKeepCurrentSetting) {
+    Schema schema(DEFS, KEY_COUNT);
+    Values values;
+    // 超出範圍、不是數字與溢位的整數都視為沒有設定
+    schema.parse("[Window]\nwidth=99\nopacity=abc\n", values);
+    CHECK(!values[WIDTH].present && !values[OPACITY].present);
+    schema.parse("[Window]\nwidth=99999999999999999999\nopacity=-1\n", values);
+    CHECK(!values[WIDTH].present && !values[OPACITY].present);
+    // 與 std::stoi 相同：前導空白與尾端多餘字元可接受
+    schema.parse("[Window]\nwidth=800px\n", values);
+    CHECK(values[WIDTH].present && values[WIDTH].number == 800);
+    // 同一鍵多次：以最後一個有效值為準，之後的無效值不覆蓋
+    schema.parse("[Window]\nwidth=300\nwidth=400\nwidth=5\n", values);
+    CHECK(values[WIDTH].number == 400);
+    // 區段不符、沒有等號與未知的鍵都忽略
+    schema.parse("[Colors]\nwidth=500\n[Window]\nwidth\nheight=3\n", values);
+    CHECK(!values[WIDTH].present);
+    schema.parse("width=500\n", values);
+    CHECK(!values[WIDTH].present);
+    // 格式錯誤的顏色為黑色；布林值只認 1 與 true
+    schema.parse("[Colors]\ntext_color=#12345\n[Window]\ntopmost=yes\n", values);
+    CHECK(values[TEXT_COLOR].present && values[TEXT_COLOR].number == 0);
+    CHECK(values[TOPMOST].present && values[TOPMOST].number == 0);
+    Value value;
+    CHECK(schema.convert(TEXT_COLOR, "ABCDEF", value) && value.number == 0xEFCDAB);
+    CHECK(schema.convert(TEXT_COLOR, "GHIJKL", value) && value.number == 0);
+    CHECK(!schema.convert(WIDTH, "", value) && !value.present);
+}
+
+TEST(reloadAppliesOnlyChangedKeys) {
+    Schema schema(DEFS, KEY_COUNT);
+    Values applied;
+    schema.parse(CONFIG, applied);
+    std::vector<size_t> changed;
+
+    // 內容相同（只有空白與註解不同）：沒有需要套用的鍵
+    Values loaded;
+    std::string text = std::string("; 新的註解\n") + CONFIG + "\n";
+    schema.parse(text, loaded);
+    schema.reload(applied, loaded, changed);
+    CHECK(changed.empty());
+
+    // 只改一個鍵
+    text = CONFIG;
+    CHECK(schema.update(text, OPACITY, "180"));
+    schema.parse(text, loaded);
+    schema.reload(applied, loaded, changed);
+    CHECK(changed.size() == 1 && changed[0] == OPACITY);
+    CHECK(applied[OPACITY].number == 180 && applied[WIDTH].number == 640);
+
+    // 移除的鍵與無效的值維持原本的設定，不算變更；其他鍵照常套用
+    text = "[Window]\nwidth=5000\ntopmost=0\n[Font]\nfont_name=標楷體\n";
+    schema.parse(text, loaded);
+    schema.reload(applied, loaded, changed);
+    CHECK(changed.size() == 2 && changed[0] == TOPMOST && changed[1] == FONT_NAME);
+    CHECK(applied[WIDTH].number == 640 && applied[OPACITY].number == 180);
+    CHECK(applied[TEXT_COLOR].number == 0x302010);
+    CHECK(applied[TOPMOST].number == 0 && applied[FONT_NAME].text == "標楷體");
+
+    // 再次載入同一份：已套用，不再變更
+    schema.reload(applied, loaded, changed);
+    CHECK(changed.empty());
+
+    // 尚未載入過：檔案中所有有值的鍵都要套用
+    Values empty;
+    schema.parse(CONFIG, loaded);
+    schema.reload(empty, loaded, changed);
+    CHECK(changed.size() == KEY_COUNT && empty.size() == KEY_COUNT && empty[WIDTH].number == 640);
+}
+
+TEST(updateKeepsFormatting) {
+    Schema schema(DEFS, KEY_COUNT);
+    // CRLF 與註解保留；只改值的部分
+    std::string text = "[Window]\r\n; 寬度\r\nwidth = 640 \r\n[Font]\r\nfont_name=a\r\n";
+    CHECK(schema.update(text, WIDTH, "800"));
+    CHECK(text == "[Window]\r\n; 寬度\r\nwidth = 800 \r\n[Font]\r\nfont_name=a\r\n");
+    CHECK(!schema.update(text, WIDTH, "800"));
+
+    // 鍵不存在：加在區段最後一個設定之後
+    CHECK(schema.update(text, TOPMOST, "1"));
+    CHECK(text == "[Window]\r\n; 寬度\r\nwidth = 800 \r\ntopmost=1\r\n[Font]\r\nfont_name=a\r\n");
+    // 區段最後一行沒有換行
+    text = "[Window]\nwidth=640";
+    CHECK(schema.update(text, OPACITY, "10"));
+    CHECK(text == "[Window]\nwidth=640\nopacity=10\n");
+    // 區段不存在：加在檔尾
+    CHECK(schema.update(text, TEXT_COLOR, "#FFFFFF"));
+    CHECK(text == "[Window]\nwidth=640\nopacity=10\n\n[Colors]\ntext_color=#FFFFFF\n");
+    // 其他區段的同名鍵不受影響
+    text = "[Colors]\nwidth=100\n[Window]\nwidth=200\n";
+    CHECK(schema.update(text, WIDTH, "300"));
+    CHECK(text == "[Colors]\nwidth=100\n[Window]\nwidth=300\n");
+
+    Values values;
+    schema.parse(text, values);
+    CHECK(values[WIDTH].number == 300);
+}
+
+int main() {
+    return TestCheck::runAll("config_schema");
+}
@@ -0,0 +1,195 @@
+// dict_delta_test.cpp - 字碼表差異更新：套用差異、拒絕版本不符與改為下載完整字碼表
+#include "dict_delta.h"
+#include "dict_model.h"
+#include "test_check.h"
+
+using namespace DictDelta;
+
+namespace {
+
+const char* V41 =
+    "# 字碼表\n"
+    "# version: 41\n"
+    "一\tu\n"
+    "二\tuu\n"
+    "十\tui\n"
+    "木\tuio\n"
+    "林\tuiouio\n"
+    "森\tuiouio\n";
+
+DictFiles::CodeTable parse(const std::string& content) {
+    DictFiles::CodeTable table;
+    DictFiles::parseMainDict(content, table);
+    return table;
+}
+
+// 第 42 版：調整 uiouio 的順序、刪除 uio、新增 uj；第 43 版：新增 ujk、修改 u
+std::vector<Step> publishedSteps() {
+    DictFiles::CodeTable v41 = parse(V41);
+    DictFiles::CodeTable v42 = v41;
+    v42[L"uiouio"] = {L"森", L"林"};
+    v42.erase(L"uio");
+    v42[L"uj"] = {L"下"};
+    DictFiles::CodeTable v43 = v42;
+    v43[L"ujk"] = {L"天"};
+    v43[L"u"] = {L"一", L"丁"};
+    std::vector<Step> steps;
+    steps.push_back(diff(v41, v42, 41, 42));
+    steps.push_back(diff(v42, v43, 42, 43));
+    return steps;
+}
+
+DictFiles::CodeTable expected43() {
+    DictFiles::CodeTable table = parse(V41);
+    std::vector<Step> steps = publishedSteps();
+    applyToTable(table, steps[0]);
+    applyToTable(table, steps[1]);
+    return table;
+}
+
+}
+
+TEST(applyDeltaToFile) {
+    std::vector<Step> steps = publishedSteps();
+    CHECK(steps[0].changes.size() == 3 && steps[1].changes.size() == 2);
+    CHECK(steps[0].entryCount == 6 && steps[1].entryCount == 8);
+    std::string delta = formatDelta(steps);
+
+    // 格式化後再解析得到相同的步驟
+    std::vector<Step> parsed;
+    CHECK(parseDelta(delta, parsed) && parsed.size() == 2);
+    CHECK(parsed[1].changes[L"u"].words == (std::vector<std::wstring>{L"一", L"丁"}));
+    CHECK(parsed[0].changes[L"uio"].remove);
+
+    // 從第 41 版：兩步合併後套用
+    std::string patched;
+    Step applied;
+    CHECK(update(V41, delta, patched, applied) == UPDATE_APPLIED);
+    CHECK(applied.from == 41 && applied.to == 43 && applied.changes.size() == 5);
+    CHECK(readVersion(patched) == 43);
+    CHECK(parse(patched) == expected43());
+    // 未受影響的行與註解保持原樣
+    std::string head = "# 字碼表\n# version: 43\n一\tu\n丁\tu\n";
+    CHECK(patched.compare(0, head.size(), head) == 0);
+    CHECK(patched.find("二\tuu\n十\tui\n") != std::string::npos);
+    DictFiles::CodeTable table = parse(V41);
+    CHECK(countAfter(table, 6, applied) == 8);
+
+    // 從第 42 版只套用第二步；已是第 43 版時不需更新
+    std::string v42;
+    int count = 0;
+    v42 = applyToFile(V41, steps[0], count);
+    CHECK(count == 6 && readVersion(v42) == 42);
+    CHECK(update(v42, delta, patched, applied) == UPDATE_APPLIED && applied.from == 42);
+    CHECK(parse(patched) == expected43());
+    std::string v43 = patched;
+    CHECK(update(v43, delta, patched, applied) == UPDATE_UP_TO_DATE && patched.empty());
+
+    // CRLF 與 BOM 保留；沒有版本行時視為第 0 版並加上版本行
+    std::string crlf = "\xEF\xBB\xBF# version: 41\r\n一\tu\r\n";
+    Step step;
+    step.from = 41;
+    step.to = 42;
+    step.entryCount = 2;
+    step.changes[L"u"].words = {L"一", L"丁"};
+    std::string out = applyToFile(crlf, step, count);
+    CHECK(out == "\xEF\xBB\xBF# version: 42\r\n一\tu\r\n丁\tu\r\n" && count == 2);
+    step.from = 0;
+    out = applyToFile("一\tu", step, count);
+    CHECK(out == "# version: 42\n一\tu\n丁\tu\n");
+}
+
+// 與更新執行緒相同：把變更套用在目前快照的內容上，以更新後檔案的識別寫出映像檔，不重新解析檔案
+TEST(patchSnapshotInMemory) {
+    const std::string path = "core/tests/dict_delta_test.txt";
+    std::string delta = formatDelta(publishedSteps());
+    std::string patched;
+    Step applied;
+    CHECK(update(V41, delta, patched, applied) == UPDATE_APPLIED);
+
+    DictFiles::CodeTable v41 = parse(V41);
+    DictModel::SnapshotPtr base = DictModel::build(v41, 6);
+    DictFiles::CodeTable table;
+    base->table().copyTo(table);
+    int count = countAfter(table, base->entryCount(), applied);
+    CHECK(count == applied.entryCount);
+    applyToTable(table, applied);
+    DictModel::SnapshotPtr snapshot = DictModel::share(path, DictImage::identify(patched), table, count);
+    CHECK(snapshot->shared() && snapshot->entryCount() == 8 && table.empty());
+    DictFiles::CodeTable contents;
+    snapshot->table().copyTo(contents);
+    CHECK(contents == expected43());
+
+    // 其他程序載入更新後的檔案時直接對映同一個映像檔
+    DictModel::SnapshotPtr loaded = DictModel::loadShared(path, patched);
+    CHECK(loaded->shared() && loaded->entryCount() == 8);
+    DictImage::removeStale(path, DictImage::Source());
+
+    // 記憶體中的字典與差異檔的基準不同：筆數不符，不建立快照
+    DictFiles::CodeTable edited = parse(std::string(V41) + "本\tuiu\n");
+    base = DictModel::build(edited, 7);
+    base->table().copyTo(table);
+    CHECK(countAfter(table, base->entryCount(), applied) != applied.entryCount);
+}
+
+TEST(rejectVersionMismatch) {
+    std::string delta = formatDelta(publishedSteps());
+    std::string patched;
+    Step applied;
+
+    // 本機版本不在差異檔的範圍內（太舊或比差異檔還新）
+    std::string v40 = V41;
+    v40.replace(v40.find("41"), 2, "40");
+    CHECK(update(v40, delta, patched, applied) == UPDATE_TOO_FAR);
+    std::string v50 = V41;
+    v50.replace(v50.find("41"), 2, "50");
+    CHECK(update(v50, delta, patched, applied) == UPDATE_TOO_FAR);
+
+    // 版本號相符但本機內容被修改過：套用後的筆數與差異檔不符，不寫出結果
+    std::string edited = V41;
+    edited += "本\tuiu\n";
+    CHECK(update(edited, delta, patched, applied) == UPDATE_MISMATCH);
+    CHECK(patched.empty() && applied.changes.empty());
+
+    // 步驟不連續或版本沒有前進
+    CHECK(update(V41, "# ZMB-DELTA 1\n@ 41 42 7\n= u\t一\n@ 43 44 7\n= u\t二\n", patched, applied) ==
+          UPDATE_BAD_DELTA);
+    CHECK(update(V41, "# ZMB-DELTA 1\n@ 41 41 7\n= u\t一\n", patched, applied) == UPDATE_BAD_DELTA);
+    std::vector<Step> steps;
+    CHECK(!parseDelta("# ZMB-DELTA 1\n@ 42 43 7\n@ 41 42 7\n", steps));
+}
+
+TEST(fallBackToFullDownload) {
+    std::string patched;
+    Step applied;
+    // 不是差異檔（例如錯誤頁面）、格式錯誤、同一步驟中重複的字碼
+    CHECK(update(V41, "<html>404</html>", patched, applied) == UPDATE_BAD_DELTA);
+    CHECK(update(V41, "", patched, applied) == UPDATE_BAD_DELTA);
+    CHECK(update(V41, "# ZMB-DELTA 1\n= u\t一\n", patched, applied) == UPDATE_BAD_DELTA);
+    CHECK(update(V41, "# ZMB-DELTA 1\n@ 41 42 7\n= u\n", patched, applied) == UPDATE_BAD_DELTA);
+    CHECK(update(V41, "# ZMB-DELTA 1\n@ 41 42 7\n- u\t一\n", patched, applied) == UPDATE_BAD_DELTA);
+    CHECK(update(V41, "# ZMB-DELTA 1\n@ 41 42 7\n= u\t一\n- u\n", patched, applied) == UPDATE_BAD_DELTA);
+    // 空的差異檔：無法判斷，交給完整下載
+    CHECK(update(V41, "# ZMB-DELTA 1\n", patched, applied) == UPDATE_TOO_FAR);
+
+    // 步驟太多：下載完整字碼表比較省
+    std::vector<Step> steps;
+    for (uint32_t v = 41; v < 41 + 5; v++) {
+        Step step;
+        step.from = v;
+        step.to = v + 1;
+        step.entryCount = 6;
+        step.changes[L"u"].words = {v % 2 ? L"丁" : L"一"};
+        steps.push_back(step);
+    }
+    std::string delta = formatDelta(steps);
+    CHECK(update(V41, delta, patched, applied, 4) == UPDATE_TOO_FAR);
+    CHECK(update(V41, delta, patched, applied, 5) == UPDATE_APPLIED);
+    CHECK(readVersion(patched) == 46 && parse(patched)[L"u"] == std::vector<std::wstring>{L"丁"});
+    Step merged;
+    CHECK(plan(steps, 43, merged, 3) == PLAN_APPLY && merged.from == 43 && merged.to == 46);
+}
+
+int main() {
+    return TestCheck::runAll("dict_delta");
+}
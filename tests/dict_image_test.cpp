@@ -0,0 +1,112 @@
+// dict_image_test.cpp - 編譯映像的檢查：正確的映像可以查詢，鍵順序錯誤或位移越界的映像即使校驗碼正確也不接受
+#include "dict_image.h"
+#include "file_io.h"
+#include "test_check.h"
+#include <cstring>
+
+using namespace DictImage;
+
+namespace {
+
+// 映像檔格式（見 dict_image.cpp）：72 位元組的檔頭，校驗碼在位移 40，之後是 16 位元組的鍵記錄
+const size_t HEADER_SIZE = 72;
+const size_t CHECKSUM_OFFSET = 40;
+const size_t KEY_RECORD_SIZE = 16;
+
+DictFiles::CodeTable sampleTable() {
+    DictFiles::CodeTable table;
+    table[L"u"] = {L"一"};
+    table[L"ui"] = {L"十", L"丁"};
+    table[L"uu"] = {L"二"};
+    table[L"uuu"] = {L"三"};
+    return table;
+}
+
+std::string imageBytes(Kind kind, const Source& source) {
+    ImagePtr image = build(sampleTable(), 5, kind, source);
+    return std::string(image->data(), image->size());
+}
+
+// 修改內容後重算校驗碼（FNV-1a），讓檢查只能依靠結構
+void reseal(std::string& bytes) {
+    uint64_t hash = FileIO::fnv64(bytes.data() + HEADER_SIZE, bytes.size() - HEADER_SIZE);
+    memcpy(&bytes[CHECKSUM_OFFSET], &hash, sizeof(hash));
+}
+
+bool valid(const std::string& bytes, Kind kind, const Source& source) {
+    // 以 uint64_t 存放：與映像相同的對齊
+    std::vector<uint64_t> aligned((bytes.size() + 7) / 8);
+    memcpy(aligned.data(), bytes.data(), bytes.size());
+    return validate((const char*)aligned.data(), bytes.size(), kind, source);
+}
+
+}
+
+TEST(builtImageValidatesAndLooksUp) {
+    Source source = identify("字碼表");
+    ImagePtr image = build(sampleTable(), 5, KIND_MAIN_DICT, source);
+    CHECK(validate(image->data(), image->size(), KIND_MAIN_DICT, source));
+    CHECK(!validate(image->data(), image->size(), KIND_PHRASES, source));
+    CHECK(!validate(image->data(), image->size(), KIND_MAIN_DICT, identify("其他")));
+
+    Table table(*image);
+    CHECK(table.size() == 4 && table.entryCount() == 5);
+    CHECK(table.find(L"ui") == 1 && table.valueCount(1) == 2 && table.value(1, 1).str() == L"丁");
+    CHECK(table.find(L"uo") == NOT_FOUND && table.upperBound(L"uu") == 3);
+    CHECK(table.firstKeyOf(L"丁") == 1 && table.firstKeyOf(L"四") == NOT_FOUND);
+    CHECK(table.key(0).compare(table.key(1)) < 0 && table.key(1).compare(L"ui") == 0);
+
+    // 重算校驗碼但內容不變：仍然接受（確認下面的測試只因結構而失敗）
+    std::string bytes = imageBytes(KIND_MAIN_DICT, source);
+    reseal(bytes);
+    CHECK(valid(bytes, KIND_MAIN_DICT, source));
+    // 截斷
+    CHECK(!valid(bytes.substr(0, bytes.size() - 4), KIND_MAIN_DICT, source));
+    CHECK(!valid(bytes.substr(0, HEADER_SIZE - 1), KIND_MAIN_DICT, source));
+}
+
+TEST(unsortedKeysAreRejected) {
+    Source source = identify("字碼表");
+    // 交換兩個鍵記錄：每個記錄本身都在範圍內，但二分搜尋會找不到鍵
+    std::string bytes = imageBytes(KIND_MAIN_DICT, source);
+    std::string first = bytes.substr(HEADER_SIZE, KEY_RECORD_SIZE);
+    bytes.replace(HEADER_SIZE, KEY_RECORD_SIZE, bytes, HEADER_SIZE + KEY_RECORD_SIZE, KEY_RECORD_SIZE);
+    bytes.replace(HEADER_SIZE + KEY_RECORD_SIZE, KEY_RECORD_SIZE, first);
+    reseal(bytes);
+    CHECK(!valid(bytes, KIND_MAIN_DICT, source));
+
+    // 重複的鍵：第二個鍵記錄指向第一個鍵的字串
+    bytes = imageBytes(KIND_MAIN_DICT, source);
+    bytes.replace(HEADER_SIZE + KEY_RECORD_SIZE, 8, bytes, HEADER_SIZE, 8);
+    reseal(bytes);
+    CHECK(!valid(bytes, KIND_MAIN_DICT, source));
+
+    // 只有一個鍵、沒有鍵：沒有順序可檢查
+    DictFiles::CodeTable single;
+    single[L"u"] = {L"一"};
+    ImagePtr image = build(single, 1, KIND_PHRASES, source);
+    CHECK(validate(image->data(), image->size(), KIND_PHRASES, source));
+    DictFiles::CodeTable empty;
+    image = build(empty, 0, KIND_PHRASES, source);
+    CHECK(validate(image->data(), image->size(), KIND_PHRASES, source) && Table(*image).find(L"u") == NOT_FOUND);
+}
+
+TEST(outOfRangeOffsetsAreRejected) {
+    Source source = identify("字碼表");
+    // 鍵的字串位移超出字串池
+    std::string bytes = imageBytes(KIND_MAIN_DICT, source);
+    uint32_t huge = 0x7fffffff;
+    memcpy(&bytes[HEADER_SIZE], &huge, sizeof(huge));
+    reseal(bytes);
+    CHECK(!valid(bytes, KIND_MAIN_DICT, source));
+
+    // 值的範圍超出值陣列
+    bytes = imageBytes(KIND_MAIN_DICT, source);
+    memcpy(&bytes[HEADER_SIZE + 12], &huge, sizeof(huge));
+    reseal(bytes);
+    CHECK(!valid(bytes, KIND_MAIN_DICT, source));
+}
+
+int main() {
+    return TestCheck::runAll("dict_image");
+}
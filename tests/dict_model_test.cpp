@@ -0,0 +1,221 @@
+// dict_model_test.cpp - 字典快照的多執行緒壓力測試：讀者持有的快照不會被釋放或改變，發佈不會遺失
+#include "dict_model.h"
+#include "test_check.h"
+#include "test_files.h"
+#include <atomic>
+#include <set>
+#include <thread>
+
+using namespace DictModel;
+
+namespace {
+
+const int CODES = 16;
+
+// 第 version 版：每個字碼的字都是版本號，讀者可以檢查看到的是同一版的完整內容
+SnapshotPtr makeVersion(int version) {
+    DictFiles::CodeTable table;
+    std::wstring word = std::to_wstring(version);
+    for (int i = 0; i < CODES; i++) table[L"c" + std::to_wstring(i)] = {word};
+    return build(table, CODES);
+}
+
+// 快照的版本；內容不一致時回傳 -1
+int versionOf(const Snapshot& snapshot) {
+    if (snapshot.codeCount() != CODES || snapshot.entryCount() != CODES) return -1;
+    std::wstring word = snapshot.table().value(0, 0).str();
+    for (size_t i = 1; i < CODES; i++) {
+        if (snapshot.table().valueCount(i) != 1 || snapshot.table().value(i, 0).str() != word) return -1;
+    }
+    return std::stoi(word);
+}
+
+// 讀者：不斷 pin，同時保留上一個快照；確認持有中的快照內容不變，ordered 時也確認版本不倒退
+struct Reader {
+    const Model& model;
+    std::atomic<bool>& stop;
+    bool ordered;
+    bool ok;
+    long pins;
+
+    Reader(const Model& m, std::atomic<bool>& s, bool o) : model(m), stop(s), ordered(o), ok(true), pins(0) {}
+
+    void operator()() {
+        SnapshotPtr held = model.pin();
+        int heldVersion = versionOf(*held);
+        ok = heldVersion >= 0;
+        while (ok && !stop.load()) {
+            SnapshotPtr current = model.pin();
+            int version = versionOf(*current);
+            pins++;
+            // 持有的舊快照在新版發佈後仍完整可讀
+            ok = version >= (ordered ? heldVersion : 0) && versionOf(*held) == heldVersion;
+            if (pins % 8 == 0) {
+                held = current;
+                heldVersion = version;
+            }
+        }
+    }
+};
+
+}
+
+TEST(publishIfLosesNoUpdates) {
+    const int PUBLISHERS = 3;
+    const int PER_PUBLISHER = 2000;
+    // 先建好每一版，發佈者之間只競爭交換，衝突才夠多
+    std::vector<SnapshotPtr> versions;
+    std::vector<std::weak_ptr<const Snapshot>> published;
+    for (int v = 0; v <= PUBLISHERS * PER_PUBLISHER; v++) {
+        versions.push_back(makeVersion(v));
+        published.push_back(versions.back());
+    }
+
+    Model model;
+    model.publish(versions[0]);
+    std::atomic<bool> stop(false);
+    std::vector<Reader> readers(4, Reader(model, stop, true));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < readers.size(); i++) threads.push_back(std::thread(std::ref(readers[i])));
+
+    // 多個發佈者以 publishIf 各自把版本加一：失敗時以最新的快照重做，沒有任何一次被覆蓋
+    std::atomic<int> retries(0), started(0);
+    std::vector<std::thread> publishers;
+    for (int p = 0; p < PUBLISHERS; p++) {
+        publishers.push_back(std::thread([&model, &retries, &started, &versions] {
+            // 全部就緒後才開始，發佈才會真的同時進行
+            started++;
+            while (started.load() < PUBLISHERS) std::this_thread::yield();
+            for (int n = 0; n < PER_PUBLISHER; n++) {
+                SnapshotPtr expected = model.pin();
+                // 讓出執行緒：單核心時也有其他發佈者插進 pin 與 publishIf 之間
+                std::this_thread::yield();
+                while (!model.publishIf(expected, versions[versionOf(*expected) + 1])) retries++;
+            }
+        }));
+    }
+    for (size_t i = 0; i < publishers.size(); i++) publishers[i].join();
+    stop = true;
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+    versions.clear();
+
+    CHECK(versionOf(*model.pin()) == PUBLISHERS * PER_PUBLISHER);
+    bool readersOk = true;
+    for (size_t i = 0; i < readers.size(); i++) readersOk = readersOk && readers[i].ok && readers[i].pins > 0;
+    CHECK(readersOk);
+
+    // 讀者都放開後，只有目前的快照還活著（舊快照在最後一個讀者放開時釋放）
+    int alive = 0;
+    for (size_t i = 0; i < published.size(); i++) alive += published[i].expired() ? 0 : 1;
+    CHECK(alive == 1 && !published.back().expired());
+    printf("  publishIf 重試 %d 次\n", retries.load());
+}
+
+TEST(publishReturnsEachSnapshotOnce) {
+    Model model;
+    SnapshotPtr initial = makeVersion(0);
+    model.publish(initial);
+    std::atomic<bool> stop(false);
+    // publish 之間沒有先後，版本可能倒退：讀者只檢查內容完整
+    std::vector<Reader> readers(2, Reader(model, stop, false));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < readers.size(); i++) threads.push_back(std::thread(std::ref(readers[i])));
+
+    // 多個執行緒同時 publish：每個快照（含最初的）恰好被換下一次，由換下它的執行緒放開
+    const int PUBLISHERS = 3;
+    const int PER_PUBLISHER = 300;
+    std::vector<std::vector<const Snapshot*>> returned(PUBLISHERS);
+    std::vector<std::vector<const Snapshot*>> sent(PUBLISHERS);
+    std::vector<std::thread> publishers;
+    for (int p = 0; p < PUBLISHERS; p++) {
+        publishers.push_back(std::thread([&model, &returned, &sent, p] {
+            std::vector<SnapshotPtr> keep;   // 保留到比較完，位址不會被重複使用
+            for (int n = 0; n < PER_PUBLISHER; n++) {
+                SnapshotPtr next = makeVersion(p * PER_PUBLISHER + n + 1);
+                sent[p].push_back(next.get());
+                SnapshotPtr old = model.publish(next);
+                returned[p].push_back(old.get());
+                keep.push_back(next);
+                keep.push_back(old);
+            }
+        }));
+    }
+    for (size_t i = 0; i < publishers.size(); i++) publishers[i].join();
+    stop = true;
+    for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+    std::multiset<const Snapshot*> expected, actual;
+    expected.insert(initial.get());
+    for (int p = 0; p < PUBLISHERS; p++) {
+        expected.insert(sent[p].begin(), sent[p].end());
+        actual.insert(returned[p].begin(), returned[p].end());
+    }
+    SnapshotPtr last = model.pin();
+    actual.insert(last.get());
+    CHECK(expected == actual);
+    CHECK(versionOf(*last) > 0);
+    bool readersOk = true;
+    for (size_t i = 0; i < readers.size(); i++) readersOk = readersOk && readers[i].ok && readers[i].pins > 0;
+    CHECK(readersOk);
+
+    // 空指標不發佈
+    CHECK(!model.publish(SnapshotPtr()) && model.pin() == last);
+    SnapshotPtr current = last;
+    CHECK(!model.publishIf(current, SnapshotPtr()) && model.pin() == last);
+}
+
+TEST(publishIfReportsCurrentOnConflict) {
+    Model model;
+    SnapshotPtr first = makeVersion(1);
+    SnapshotPtr second = makeVersion(2);
+    model.publish(first);
+    SnapshotPtr expected = model.pin();
+    // 基準快照在差異更新期間被換掉：不發佈，並告知目前的快照
+    model.publish(second);
+    CHECK(!model.publishIf(expected, makeVersion(3)));
+    CHECK(expected == second && versionOf(*model.pin()) == 2);
+    CHECK(model.publishIf(expected, makeVersion(3)) && expected == second);
+    CHECK(versionOf(*model.pin()) == 3);
+
+    // 複製只共用同一個快照；之後各自發佈
+    Model copy(model);
+    CHECK(copy.pin() == model.pin());
+    copy.publish(first);
+    CHECK(versionOf(*model.pin()) == 3 && versionOf(*copy.pin()) == 1);
+    Model empty;
+    CHECK(empty.pin() && empty.pin()->entryCount() == 0);
+}
+
+TEST(sharedImagesAreNamedByContent) {
+    const std::string path = "core/tests/dict_model_test.txt";
+    const std::string first = "一\tu\n十\tui\n";
+    const std::string second = "一\tu\n二\tuu\n";
+    DictImage::Source firstSource = DictImage::identify(first);
+    DictImage::Source secondSource = DictImage::identify(second);
+    // 舊版的固定檔名與名稱相近但不是映像檔的檔案
+    TestFiles::writeBytes(path + ".img", "舊版映像");
+    TestFiles::writeBytes(path + ".bak.img", "其他");
+
+    SnapshotPtr held = loadShared(path, first);
+    CHECK(held->shared() && held->find(L"ui") != DictImage::NOT_FOUND);
+    CHECK(TestFiles::exists(DictImage::imagePath(path, firstSource)));
+    CHECK(!TestFiles::exists(path + ".img") && TestFiles::exists(path + ".bak.img"));
+
+    // 內容改變：寫出另一個映像檔，不取代仍被對映的舊映像；持有中的快照仍可讀
+    SnapshotPtr current = loadShared(path, second);
+    CHECK(current->shared() && current->find(L"uu") != DictImage::NOT_FOUND);
+    CHECK(DictImage::imagePath(path, secondSource) != DictImage::imagePath(path, firstSource));
+    CHECK(TestFiles::exists(DictImage::imagePath(path, secondSource)));
+    CHECK(!TestFiles::exists(DictImage::imagePath(path, firstSource)));
+    CHECK(held->find(L"ui") != DictImage::NOT_FOUND && held->table().value(held->find(L"ui"), 0).str() == L"十");
+
+    // 已有目前內容的映像：直接對映，沒有可刪除的舊映像
+    CHECK(loadShared(path, second)->shared());
+    CHECK(DictImage::removeStale(path, secondSource) == 0);
+    CHECK(DictImage::removeStale(path, DictImage::Source()) == 1);
+    std::remove((path + ".bak.img").c_str());
+}
+
+int main() {
+    return TestCheck::runAll("dict_model");
+}
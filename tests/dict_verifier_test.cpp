@@ -0,0 +1,140 @@
+// dict_verifier_test.cpp - 下載字碼表的驗證：校驗清單解析、雜湊比對、沒有清單時的格式檢查
+#include "dict_verifier.h"
+#include "test_check.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace DictVerifier;
+
+namespace {
+
+const char* DICT = "\xEF\xBB\xBF# 字碼表\r\n一\tu\r\n二\tuu\r\n十\tui\r\n";
+// 格式正確但不是 DICT 的雜湊（空字串的雜湊）
+const char* WRONG_SHA256 = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+
+// 200 行中有 bad 行格式錯誤
+std::string dictWithMalformed(int bad) {
+    std::string content;
+    for (int i = 0; i < 200; i++) {
+        if (i % 50 == 7 && bad-- > 0) {
+            content += "沒有欄位\n";
+        } else {
+            content += "字\tu" + std::to_string(i) + "\n";
+        }
+    }
+    return content;
+}
+
+Report verify(StreamVerifier& verifier, const std::string& content, const std::string& expected, size_t chunk) {
+    verifier.restart();
+    for (size_t pos = 0; pos < content.size(); pos += chunk) {
+        verifier.append(content.data() + pos, std::min(chunk, content.size() - pos));
+    }
+    return verifier.finish(expected);
+}
+
+}
+
+TEST(parseManifestLines) {
+    std::string hash(64, 'a');
+    std::string upper(64, 'B');
+    std::string sha;
+    std::string manifest = hash + "  dict-old.txt\n" + upper + " *dict.txt\r\n" + std::string(64, 'c') + "  other.txt\n";
+    CHECK(parseManifest(manifest, "dict.txt", sha) && sha == std::string(64, 'b'));
+    CHECK(parseManifest(manifest, "dict-old.txt", sha) && sha == hash);
+    CHECK(parseManifest(manifest, "other.txt", sha) && sha == std::string(64, 'c'));
+    // 檔名要完全相同；沒有列出的檔案
+    CHECK(!parseManifest(manifest, "dict", sha));
+    CHECK(!parseManifest(manifest, "missing.txt", sha));
+    // 雜湊長度不對或含非十六進位字元
+    CHECK(!parseManifest(std::string(63, 'a') + "  dict.txt\n", "dict.txt", sha));
+    CHECK(!parseManifest(std::string(63, 'a') + "g  dict.txt\n", "dict.txt", sha));
+    CHECK(!parseManifest("", "dict.txt", sha));
+    CHECK(!parseManifest("<html>404</html>", "dict.txt", sha));
+}
+
+TEST(hashMatchesManifest) {
+    std::string content = DICT;
+    std::string actual = Sha256::digestHex(content);
+    CHECK(actual != WRONG_SHA256);
+
+    StreamVerifier verifier;
+    // 任意的區塊大小都得到相同的雜湊與解析結果（BOM 與 CRLF 被切開也一樣）
+    size_t chunks[] = {1, 2, 3, 7, 64, 1 << 16};
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        Report report = verify(verifier, content, actual, chunks[i]);
+        CHECK(report.ok && report.hashChecked && report.sha256 == actual);
+        CHECK(report.size == content.size() && report.entryCount == 3 && report.malformedLines == 0);
+        CHECK(verifier.table().size() == 3 && verifier.table()[L"u"] == std::vector<std::wstring>{L"一"});
+        verifier.table().clear();
+    }
+
+    // 內容被截斷或修改：雜湊不符
+    Report truncated = verify(verifier, content.substr(0, content.size() - 4), actual, 5);
+    CHECK(!truncated.ok && truncated.hashChecked && truncated.sha256 != actual);
+    verifier.table().clear();
+    Report wrong = verify(verifier, content, WRONG_SHA256, 64);
+    CHECK(!wrong.ok && wrong.hashChecked && !wrong.error.empty());
+}
+
+TEST(formatCheckWithoutManifest) {
+    StreamVerifier verifier;
+    // 格式錯誤的行不超過 1% 時通過
+    Report report = verify(verifier, dictWithMalformed(2), "", 100);
+    CHECK(report.ok && !report.hashChecked && report.entryCount == 198 && report.malformedLines == 2);
+    verifier.table().clear();
+    report = verify(verifier, dictWithMalformed(3), "", 100);
+    CHECK(!report.ok && report.malformedLines == 3 && !report.error.empty());
+    verifier.table().clear();
+
+    // 沒有任何記錄：錯誤頁面、空白檔案；有清單也不通過
+    report = verify(verifier, "<html><body>404 Not Found</body></html>\n", "", 16);
+    CHECK(!report.ok && report.entryCount == 0);
+    report = verify(verifier, "", Sha256::digestHex(""), 16);
+    CHECK(!report.ok && report.size == 0);
+
+    // 二進位內容：NUL 與無效的 UTF-8 都算格式錯誤
+    std::string binary = "一\tu\n";
+    for (int i = 0; i < 10; i++) binary += std::string("\x89PNG\t\xff\xfe\0", 8) + "\n";
+    report = verify(verifier, binary, "", 3);
+    CHECK(!report.ok && report.malformedLines == 10);
+}
+
+TEST(restartDropsPreviousAttempt) {
+    StreamVerifier verifier;
+    std::string content = DICT;
+    // 下載中斷後重新開始：先前收到的內容不能留在雜湊與計數中
+    verifier.append("垃圾\tzz\n", 8);
+    verifier.append(content.data(), 10);
+    Report report = verify(verifier, content, Sha256::digestHex(content), 4);
+    CHECK(report.ok && report.entryCount == 3 && report.size == content.size());
+}
+
+TEST(verifyFileOnDisk) {
+    const char* path = "core/tests/verifier_dict.txt";
+    std::string content = DICT;
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+    }
+    DictFiles::CodeTable table;
+    Report report = verifyFile(path, Sha256::digestHex(content), &table);
+    CHECK(report.ok && report.hashChecked && table.size() == 3);
+
+    // 不通過時不交出解析結果
+    DictFiles::CodeTable untouched;
+    untouched[L"x"].push_back(L"舊");
+    report = verifyFile(path, WRONG_SHA256, &untouched);
+    CHECK(!report.ok && untouched.size() == 1 && untouched.count(L"x"));
+
+    report = verifyFile(path, "", nullptr);
+    CHECK(report.ok && !report.hashChecked);
+    std::remove(path);
+    report = verifyFile(path, "", &table);
+    CHECK(!report.ok && !report.error.empty());
+}
+
+int main() {
+    return TestCheck::runAll("dict_verifier");
+}
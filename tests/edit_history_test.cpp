@@ -0,0 +1,116 @@
+// edit_history_test.cpp - 復原/重做：合併、群組與歷史不一致時的撤回
+#include "edit_history.h"
+#include "test_check.h"
+
+namespace {
+
+// 同時修改文字與記錄歷史（相當於 BufferManager 的插入與刪除）
+void type(TextModel& text, EditHistory& history, size_t pos, const std::wstring& s) {
+    text.insert(pos, s);
+    history.recordInsert(pos, s, (int)pos, (int)(pos + s.size()));
+}
+
+void remove(TextModel& text, EditHistory& history, size_t pos, size_t count) {
+    std::wstring removed = text.substr(pos, count);
+    text.erase(pos, count);
+    history.recordErase(pos, removed, (int)(pos + count), (int)pos);
+}
+
+}
+
+TEST(typingCoalescesByWord) {
+    TextModel text;
+    EditHistory history;
+    int cursor = 0;
+    const wchar_t* keys[] = {L"h", L"i", L" ", L"t", L"h", L"e", L"r", L"e"};
+    for (size_t i = 0; i < 8; i++) type(text, history, text.length(), keys[i]);
+    CHECK(text.str() == L"hi there");
+    // 分隔字元之後開始新群組
+    CHECK(history.undoDepth() == 2);
+    CHECK(history.undo(text, cursor) && text.str() == L"hi " && cursor == 3);
+    CHECK(history.undo(text, cursor) && text.str() == L"" && cursor == 0);
+    CHECK(!history.undo(text, cursor));
+    CHECK(history.redo(text, cursor) && history.redo(text, cursor));
+    CHECK(text.str() == L"hi there" && cursor == 8);
+
+    // 連續 Backspace 合併成一組
+    remove(text, history, 7, 1);
+    remove(text, history, 6, 1);
+    remove(text, history, 5, 1);
+    CHECK(history.undoDepth() == 3 && !history.canRedo());
+    CHECK(history.undo(text, cursor) && text.str() == L"hi there" && cursor == 8);
+}
+
+TEST(undoRollsBackGroupWhenFirstOpDoesNotMatch) {
+    TextModel text(L"0123456789");
+    EditHistory history;
+    history.beginGroup();
+    type(text, history, 0, L"ab");
+    type(text, history, 12, L"cd");
+    history.endGroup();
+    CHECK(text.str() == L"ab0123456789cd" && history.undoDepth() == 1);
+
+    // 文字在歷史之外被改動：復原時最後才處理的第一筆操作不相符
+    text.erase(0, 2);
+    text.insert(0, L"zz");
+    int cursor = 5;
+    CHECK(!history.undo(text, cursor));
+    // 已復原的 "cd" 被撤回：文字與游標維持原狀，歷史清空
+    CHECK(text.str() == L"zz0123456789cd");
+    CHECK(cursor == 5);
+    CHECK(!history.canUndo() && !history.canRedo() && history.bytesUsed() == 0);
+}
+
+TEST(redoRollsBackGroupWhenLastOpDoesNotMatch) {
+    TextModel text(L"0123456789");
+    EditHistory history;
+    history.beginGroup();
+    remove(text, history, 0, 2);
+    remove(text, history, 6, 2);
+    type(text, history, 3, L"中");
+    history.endGroup();
+    CHECK(text.str() == L"234中567");
+    int cursor = 0;
+    CHECK(history.undo(text, cursor) && text.str() == L"0123456789");
+
+    // 重做時第二筆刪除（"89"）不相符：已重做的第一筆被撤回
+    text.erase(9, 1);
+    text.insert(9, L"8");
+    cursor = 4;
+    CHECK(!history.redo(text, cursor));
+    CHECK(text.str() == L"0123456788");
+    CHECK(cursor == 4);
+    CHECK(!history.canUndo() && !history.canRedo());
+
+    // 群組只有最後一筆不相符：前面的刪除與插入都被撤回
+    history.beginGroup();
+    remove(text, history, 0, 1);
+    type(text, history, 0, L"甲乙");
+    remove(text, history, 9, 2);
+    history.endGroup();
+    CHECK(text.str() == L"甲乙1234567");
+    CHECK(history.undo(text, cursor) && text.str() == L"0123456788");
+    text.insert(1, L"x");
+    CHECK(!history.redo(text, cursor));
+    CHECK(text.str() == L"0x123456788");
+}
+
+TEST(budgetDropsOldestGroups) {
+    TextModel text;
+    EditHistory history(1024);
+    for (int i = 0; i < 100; i++) {
+        history.breakGroup();
+        type(text, history, text.length(), L"字");
+    }
+    CHECK(history.bytesUsed() <= 1024);
+    CHECK(history.undoDepth() > 1 && history.undoDepth() < 100);
+    // 單一超大編輯仍保留
+    type(text, history, 0, std::wstring(2000, L'x'));
+    CHECK(history.undoDepth() == 1);
+    int cursor = 0;
+    CHECK(history.undo(text, cursor) && text.length() == 100);
+}
+
+int main() {
+    return TestCheck::runAll("edit_history");
+}
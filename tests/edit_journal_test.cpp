@@ -0,0 +1,181 @@
+// edit_journal_test.cpp - 編輯日誌恢復：檢查點加日誌、寫到一半的記錄、校驗碼錯誤與舊日誌
+#include "edit_journal.h"
+#include "test_check.h"
+#include "test_files.h"
+#include <cstdio>
+
+using namespace TestFiles;
+
+namespace {
+
+const char* CHECKPOINT_PATH = "core/tests/edit_journal_test.txt";
+const char* JOURNAL_PATH = "core/tests/edit_journal_test.journal";
+
+void removeFiles() {
+    std::remove(CHECKPOINT_PATH);
+    std::remove(JOURNAL_PATH);
+}
+
+// 當機時的狀態：檢查點、日誌檔，以及每筆記錄之後的文字
+struct Crash {
+    std::string checkpoint;
+    std::string journal;
+    std::vector<size_t> recordEnds;     // 每筆記錄結束時的日誌大小
+    std::vector<std::wstring> texts;    // texts[i]：套用前 i 筆記錄後的文字
+};
+
+// 從檢查點文字開始編輯，每次編輯後等待寫入，記下日誌大小；最後在停止前複製檔案
+Crash editAndCrash() {
+    removeFiles();
+    Crash crash;
+    TextModel text(L"檢查點內容");
+    EditJournal journal(CHECKPOINT_PATH, JOURNAL_PATH);
+    journal.start(text, true);
+    text.setObserver(&journal);
+    crash.texts.push_back(text.str());
+
+    for (int i = 0; i < 6; i++) {
+        switch (i) {
+            case 0: text.insert(0, L"前"); break;
+            case 1: text.append(L"後面的字"); break;
+            case 2: text.erase(2, 3); break;
+            case 3: text = std::wstring(L"整份取代"); break;
+            case 4: text.insert(2, L"\n換行\t"); break;
+            default: text.erase(0, 1); break;
+        }
+        journal.flush();
+        crash.recordEnds.push_back(readBytes(JOURNAL_PATH).size());
+        crash.texts.push_back(text.str());
+    }
+    crash.checkpoint = readBytes(CHECKPOINT_PATH);
+    crash.journal = readBytes(JOURNAL_PATH);
+    text.setObserver(nullptr);
+    journal.stop();
+    return crash;
+}
+
+void restore(const Crash& crash, const std::string& journal) {
+    writeBytes(CHECKPOINT_PATH, crash.checkpoint);
+    writeBytes(JOURNAL_PATH, journal);
+}
+
+}
+
+TEST(checkpointWithJournalTail) {
+    Crash crash = editAndCrash();
+    CHECK(crash.recordEnds.size() == 6 && crash.journal.size() == crash.recordEnds.back());
+    // 停止時寫出最終檢查點並重設日誌
+    EditJournal::Recovery stopped;
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(stopped);
+    CHECK(stopped.found && stopped.clean && stopped.replayed == 0);
+    CHECK(stopped.text.str() == crash.texts.back());
+
+    // 當機前的檔案：檢查點加上 6 筆日誌
+    restore(crash, crash.journal);
+    EditJournal::Recovery result;
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.found && !result.truncated && !result.clean && !result.unreadable);
+    CHECK(result.replayed == 6);
+    CHECK(result.text.str() == crash.texts.back());
+    removeFiles();
+}
+
+TEST(tornLastRecordIsDropped) {
+    Crash crash = editAndCrash();
+    // 最後一筆只寫了一部分：逐位元組截斷都必須恢復到前一筆
+    size_t lastStart = crash.recordEnds[4];
+    bool dropped = true;
+    for (size_t cut = lastStart + 1; cut < crash.recordEnds[5]; cut++) {
+        restore(crash, crash.journal.substr(0, cut));
+        EditJournal::Recovery result;
+        EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+        dropped = dropped && result.replayed == 5 && result.truncated && result.text.str() == crash.texts[5];
+    }
+    CHECK(dropped);
+    // 剛好在記錄邊界結束：不算截斷
+    restore(crash, crash.journal.substr(0, lastStart));
+    EditJournal::Recovery result;
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.replayed == 5 && !result.truncated && result.text.str() == crash.texts[5]);
+    removeFiles();
+}
+
+TEST(badChecksumStopsReplay) {
+    Crash crash = editAndCrash();
+    // 第 4 筆（整份取代）的文字被改動：從這筆起捨棄
+    std::string journal = crash.journal;
+    journal[crash.recordEnds[2] + 12] ^= 0x01;
+    restore(crash, journal);
+    EditJournal::Recovery result;
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.replayed == 3 && result.truncated);
+    CHECK(result.text.str() == crash.texts[3]);
+
+    // 校驗碼本身損壞
+    journal = crash.journal;
+    journal[crash.recordEnds[0] - 1] ^= 0x80;
+    restore(crash, journal);
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.replayed == 0 && result.truncated && !result.clean);
+    CHECK(result.text.str() == crash.texts[0]);
+    removeFiles();
+}
+
+TEST(journalOfOlderCheckpointIsIgnored) {
+    Crash crash = editAndCrash();
+    // 新檢查點已取代，但日誌重設前中斷：檔頭的大小與雜湊不符，日誌不套用
+    std::string newer = crash.checkpoint;
+    newer += "x";
+    writeBytes(CHECKPOINT_PATH, newer);
+    writeBytes(JOURNAL_PATH, crash.journal);
+    EditJournal::Recovery result;
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.found && result.replayed == 0 && !result.clean);
+    CHECK(result.text.str() == crash.texts[0] + L"x");
+
+    // 日誌檔頭不完整
+    restore(crash, crash.journal.substr(0, 10));
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.found && result.replayed == 0 && result.text.str() == crash.texts[0]);
+
+    // 沒有任何檔案
+    removeFiles();
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(!result.found && !result.unreadable && result.text.empty());
+}
+
+TEST(automaticCheckpointKeepsRecoveryExact) {
+    removeFiles();
+    TextModel text;
+    EditJournal journal(CHECKPOINT_PATH, JOURNAL_PATH, 256);
+    CHECK(journal.start(text, true));
+    text.setObserver(&journal);
+    // 每次編輯後等待寫入，檢查點的時機不受批次大小影響
+    for (int i = 0; i < 200; i++) {
+        text.insert(text.length() / 2, L"字詞");
+        if (i % 3 == 0) text.erase(0, 1);
+        journal.flush();
+    }
+    CHECK(journal.checkpointCount() > 2);
+    EditJournal::Recovery result;
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.found && !result.truncated);
+    CHECK(result.text.str() == text.str());
+
+    // 沿用現有日誌繼續附加
+    text.setObserver(nullptr);
+    journal.stop();
+    CHECK(journal.start(text, false));
+    text.setObserver(&journal);
+    text.append(L"續");
+    journal.flush();
+    EditJournal(CHECKPOINT_PATH, JOURNAL_PATH).recover(result);
+    CHECK(result.replayed == 1 && result.text.str() == text.str());
+    text.setObserver(nullptr);
+    journal.stop();
+    removeFiles();
+}
+
+int main() {
+    return TestCheck::runAll("edit_journal");
+}
@@ -0,0 +1,270 @@
+// engine_core_test.cpp - 引擎核心的查詢、排序、學習、聯想與翻頁測試
+#include "engine_core.h"
+#include "test_check.h"
+#include <algorithm>
+#include <set>
+
+using namespace EngineCore;
+
+namespace {
+
+// 小型字碼表：u 開頭的字碼依字碼排序為 u、ui、uio、uj、uk...，i 與 o 在 u 之前
+void loadModel(Model& model) {
+    DictFiles::CodeTable table;
+    table[L"i"] = {L"丨"};
+    table[L"o"] = {L"丿"};
+    table[L"u"] = {L"一", L"二"};
+    table[L"ui"] = {L"十", L"一"};
+    table[L"uio"] = {L"木"};
+    table[L"uj"] = {L"下"};
+    table[L"ujk"] = {L"天"};
+    table[L"uuu"] = {L"三", L"三角"};
+    table[L"uiouio"] = {L"森"};
+    model.dict.publish(DictModel::build(table, 12));
+}
+
+std::set<std::wstring> asSet(const std::vector<std::wstring>& words) {
+    return std::set<std::wstring>(words.begin(), words.end());
+}
+
+Lookup run(const Model& model, const Learning& learning, Session& session, const std::wstring& input) {
+    session.input = input;
+    return lookup(model, learning, session);
+}
+
+}
+
+TEST(exactAndPrefixLookup) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    Lookup result = run(model, learning, session, L"ui");
+    CHECK(result.status == LOOKUP_OK);
+    CHECK(!result.wildcard);
+    // 完全符合的字碼分數最高（字碼越短越前面），前綴符合的字接在後面
+    CHECK(session.candidates.size() == 4);
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"十", L"一", L"木", L"森"}));
+    CHECK(session.candidateCodes[0] == L"ui" && session.candidateCodes[1] == L"ui");
+    CHECK(session.candidateCodes[2] == L"uio");
+    CHECK(session.candidateCodes[3] == L"uiouio");
+    CHECK(session.showCand && session.isInputting && !session.inputError);
+}
+
+TEST(prefixWalkStopsAtFirstNonMatchingKey) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    // uj 之後的 ujk 是前綴，uuu 不是：走訪在 uuu 停止
+    run(model, learning, session, L"uj");
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"下", L"天"}));
+    // 最後一個字碼：upperBound 在表尾，沒有前綴符合
+    run(model, learning, session, L"uuu");
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"三", L"三角"}));
+    // 沒有完全符合、只有前綴符合的字碼
+    run(model, learning, session, L"uu");
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"三", L"三角"}));
+    // 比所有字碼都小或都大：沒有候選字但保持輸入狀態
+    run(model, learning, session, L"ii");
+    CHECK(session.candidates.empty());
+    CHECK(session.isInputting && !session.showCand);
+    run(model, learning, session, L"uuuu");
+    CHECK(session.candidates.empty());
+}
+
+TEST(prefixMatchesSkipDuplicatesAndAreCapped) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    // ui 的「一」已是 u 的完全符合候選字：不重複
+    run(model, learning, session, L"u");
+    std::vector<std::wstring> sorted = session.candidates;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(std::unique(sorted.begin(), sorted.end()) == sorted.end());
+    CHECK(std::count(session.candidates.begin(), session.candidates.end(), L"一") == 1);
+
+    DictFiles::CodeTable table;
+    for (int i = 0; i < 80; i++) {
+        std::wstring code = L"k";
+        for (int n = i; n > 0 || code.size() == 1; n /= 5) code += L"uiojk"[n % 5];
+        table[code].push_back(std::wstring(1, (wchar_t)(0x4E00 + i)));
+    }
+    Model big;
+    big.dict.publish(DictModel::build(table, 80));
+    run(big, learning, session, L"k");
+    CHECK(session.candidates.size() == 50);
+}
+
+TEST(wildcardLookup) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    Lookup result = run(model, learning, session, L"u*o");
+    CHECK(result.wildcard);
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"木", L"森"}));
+    run(model, learning, session, L"*k");
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"天"}));
+    run(model, learning, session, L"*");
+    CHECK(session.candidates.size() == 12);
+    run(model, learning, session, L"k*");
+    CHECK(session.candidates.empty() && session.isInputting);
+}
+
+TEST(longCodeFallsBackToFirstAndLastThree) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    // 超過 8 碼且沒有候選字：以前三碼*後三碼搜尋
+    run(model, learning, session, L"uiojjjuio");
+    CHECK(asSet(session.candidates) == (std::set<std::wstring>{L"森"}));
+    CHECK(session.candidateCodes[0] == L"uiouio");
+}
+
+TEST(invalidAndEmptyInput) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    Lookup result = run(model, learning, session, L"abc");
+    CHECK(result.status == LOOKUP_INVALID);
+    CHECK(session.isInputting && session.inputError && !session.showCand);
+    result = run(model, learning, session, std::wstring(31, L'u'));
+    CHECK(result.status == LOOKUP_INVALID);
+    // 無效字元被過濾後查詢
+    result = run(model, learning, session, L"uxi");
+    CHECK(result.status == LOOKUP_OK && result.code == L"ui");
+    result = run(model, learning, session, L"");
+    CHECK(result.status == LOOKUP_EMPTY);
+    CHECK(!session.isInputting && !session.inputError && session.candidates.empty());
+}
+
+TEST(rankingUsesFrequencyAndContext) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    Session session;
+    time_t now = 1700000000;
+    // 「二」的詞頻讓它排在「一」之前
+    WordInfo info = {20, now, 3, true};
+    learning.wordFreq[L"二"] = info;
+    run(model, learning, session, L"u");
+    CHECK(session.candidates[0] == L"二");
+
+    // 上下文：上一個字之後常接的字加分
+    Learning context;
+    context.lastSelected = L"丨";
+    context.contextLearning[L"丨"] = {L"下"};
+    session.candidates = {L"木", L"下"};
+    session.candidateCodes = {L"uj", L"uj"};
+    rankCandidates(context, session, now);
+    CHECK(session.candidates[0] == L"下");
+    CHECK(session.candidateCodes.size() == 2);
+}
+
+TEST(learnOutcomes) {
+    Learning learning;
+    time_t now = 1700000000;
+    CHECK(learn(learning, L"", now) == LEARN_IGNORED);
+    CHECK(learn(learning, L"，", now) == LEARN_IGNORED);
+    CHECK(learn(learning, L"木", now) == LEARN_NEW);
+    CHECK(learn(learning, L"木", now) == LEARN_PROGRESS);
+    CHECK(learning.wordFreq[L"木"].tempCount == 2);
+    CHECK(learn(learning, L"木", now) == LEARN_PERMANENT);
+    CHECK(learn(learning, L"木", now) == LEARN_REPEAT);
+    CHECK(learning.wordFreq[L"木"].frequency == 4);
+    CHECK(learning.learnedWords.count(L"木") == 1);
+
+    // 上下文只記不同的字，每個字最多保留最近 10 個
+    for (int i = 0; i < 12; i++) {
+        learn(learning, L"森", now);
+        learn(learning, std::wstring(1, (wchar_t)(L'A' + i)), now);
+    }
+    CHECK(learning.contextLearning[L"森"].size() == 10);
+    CHECK(learning.contextLearning[L"森"].front() == L"C");
+    CHECK(learning.contextLearning[L"木"].size() == 1);
+
+    DictFiles::UserEntries entries;
+    entries.push_back(DictFiles::UserEntry{L"木", 2});
+    entries.push_back(DictFiles::UserEntry{L"森", 5});
+    loadLearning(learning, entries, now);
+    CHECK(learning.wordFreq.size() == 2 && learning.learnedWords.empty());
+    CHECK(!learning.wordFreq[L"木"].isPermanent && learning.wordFreq[L"森"].isPermanent);
+}
+
+TEST(predictOrder) {
+    Model model;
+    loadModel(model);
+    DictFiles::CodeTable phrases;
+    phrases[L"三"] = {L"角", L"木"};
+    model.wordPhrases = DictModel::buildPhrases(phrases, 2);
+    Learning learning;
+    learning.contextLearning[L"三"] = {L"天", L"木"};
+    Session session;
+    predict(model, learning, session, L"三");
+    // 詞語庫、上下文、字典中的詞語（三角 → 角已在前面）依序，不重複
+    CHECK(session.candidates.size() >= 3);
+    CHECK(session.candidates[0] == L"角" && session.candidateCodes[0] == L"詞語");
+    CHECK(session.candidates[1] == L"木" && session.candidateCodes[1] == L"uio");
+    CHECK(session.candidates[2] == L"天" && session.candidateCodes[2] == L"ujk");
+    CHECK(asSet(session.candidates).size() == session.candidates.size());
+
+    predict(model, learning, session, L"");
+    CHECK(session.candidates.empty());
+}
+
+TEST(predictFillsWithFrequentWords) {
+    Model model;
+    loadModel(model);
+    Learning learning;
+    WordInfo info = {9, 0, 3, true};
+    learning.wordFreq[L"丿"] = info;
+    learning.wordFreq[L"三角"] = info;
+    Session session;
+    predict(model, learning, session, L"森");
+    // 沒有任何聯想時補上常用的單字（不含詞）
+    CHECK(session.candidates.size() == 1);
+    CHECK(session.candidates[0] == L"丿" && session.candidateCodes[0] == L"o");
+}
+
+TEST(finishLookupPaging) {
+    Session session;
+    for (int i = 0; i < 19; i++) {
+        session.candidates.push_back(std::wstring(1, (wchar_t)(0x4E00 + i)));
+        session.candidateCodes.push_back(L"u");
+    }
+    session.selected = 4;
+    session.currentPage = 2;
+    Lookup ok;
+    ok.status = LOOKUP_OK;
+    finishLookup(session, ok);
+    CHECK(session.totalPages == 3);
+    CHECK(session.selected == 0 && session.currentPage == 0);
+    CHECK(session.showCand && session.isInputting);
+
+    CHECK(!changePage(session, -1));
+    CHECK(changePage(session, 1) && session.currentPage == 1);
+    CHECK(changePage(session, 1) && session.currentPage == 2);
+    CHECK(!changePage(session, 1) && session.currentPage == 2);
+
+    // 整頁：9 個候選字剛好一頁
+    session.candidates.resize(9);
+    session.candidateCodes.resize(9);
+    finishLookup(session, ok);
+    CHECK(session.totalPages == 1);
+
+    Lookup invalid;
+    invalid.status = LOOKUP_INVALID;
+    finishLookup(session, invalid);
+    CHECK(session.inputError && session.isInputting && !session.showCand);
+
+    endInput(session);
+    CHECK(session.input.empty() && session.candidates.empty() && !session.isInputting);
+}
+
+int main() {
+    return TestCheck::runAll("engine_core");
+}
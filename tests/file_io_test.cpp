@@ -0,0 +1,50 @@
+// file_io_test.cpp - 共用檔案工具：FNV-1a 的已知值與分段計算、暫存檔取代成功與失敗
+#include "file_io.h"
+#include "test_check.h"
+#include "test_files.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace TestFiles;
+
+namespace {
+
+const char* FILE_PATH = "core/tests/file_io_test.txt";
+const char* TEMP_PATH = "core/tests/file_io_test.txt.tmp";
+
+bool writeTemp(const std::string& content, bool ok) {
+    FILE* file = std::fopen(TEMP_PATH, "wb");
+    if (!file) return false;
+    std::fwrite(content.data(), 1, content.size(), file);
+    return FileIO::commitFile(file, TEMP_PATH, FILE_PATH, ok);
+}
+
+}
+
+TEST(fnv64MatchesKnownValuesAndChunks) {
+    CHECK(FileIO::fnv64("", 0) == FileIO::FNV64_OFFSET);
+    CHECK(FileIO::fnv64(std::string("a")) == 0xaf63dc4c8601ec8cull);
+    CHECK(FileIO::fnv64(std::string("foobar")) == 0x85944171f73967e8ull);
+
+    std::string text = "暫放區的內容 abc";
+    uint64_t chunked = FileIO::FNV64_OFFSET;
+    for (size_t i = 0; i < text.size(); i += 5) {
+        chunked = FileIO::fnv64(text.data() + i, std::min<size_t>(5, text.size() - i), chunked);
+    }
+    CHECK(chunked == FileIO::fnv64(text));
+}
+
+TEST(commitReplacesOrLeavesOldFile) {
+    writeBytes(FILE_PATH, "舊內容");
+    CHECK(writeTemp("新內容", true));
+    CHECK(readBytes(FILE_PATH) == "新內容" && !exists(TEMP_PATH));
+
+    // 呼叫端寫入失敗：不取代，暫存檔被刪除
+    CHECK(!writeTemp("寫到一半", false));
+    CHECK(readBytes(FILE_PATH) == "新內容" && !exists(TEMP_PATH));
+    std::remove(FILE_PATH);
+}
+
+int main() {
+    return TestCheck::runAll("file_io");
+}
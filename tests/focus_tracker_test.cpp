@@ -0,0 +1,169 @@
+// focus_tracker_test.cpp - 焦點狀態機：等待、逾時與恢復暫放視窗時的競爭
+#include "focus_tracker.h"
+#include "test_check.h"
+#include <string>
+
+using namespace FocusTracker;
+
+namespace {
+
+// 假環境：視窗狀態由測試設定，呼叫依序記在 log；逾時計時器（Windows 上為 993）只記錄不觸發
+class FakeEnvironment : public FocusEnvironment {
+public:
+    bool visible;
+    bool focus;
+    bool timerArmed;
+    unsigned timerMs;
+    std::string log;
+
+    FakeEnvironment() : visible(false), focus(true), timerArmed(false), timerMs(0) {}
+
+    bool bufferVisible() { return visible; }
+    void hideBuffer() { log += "hide;"; }   // 隱藏是非同步的：要等測試送出 onBufferHidden
+    void restoreBuffer() { visible = true; log += "restore;"; }
+    bool targetHasFocus() { return focus; }
+    void releaseOutput(bool timedOut) { log += timedOut ? "release(timeout);" : "release;"; }
+    void holdOutput() { log += "hold;"; }
+    void scheduleTimeout(unsigned ms) { timerArmed = true; timerMs = ms; log += "timer;"; }
+    void cancelTimeout() { timerArmed = false; log += "kill;"; }
+};
+
+}
+
+TEST(readyTargetOutputsImmediately) {
+    FakeEnvironment env;
+    FocusStateMachine fsm(env);
+    fsm.requestOutput(true);
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT);
+    CHECK(env.log == "release;");
+    // 送出中再有文字：排在後面，不重新判斷
+    fsm.requestOutput(true);
+    CHECK(env.log == "release;");
+    fsm.onOutputFinished();
+    CHECK(fsm.state() == FocusStateMachine::STATE_IDLE);
+    CHECK(env.log == "release;hold;");
+    fsm.onOutputFinished();
+    CHECK(env.log == "release;hold;");
+}
+
+TEST(waitsForHideThenFocus) {
+    FakeEnvironment env;
+    env.visible = true;
+    env.focus = false;
+    FocusStateMachine fsm(env, 300);
+    fsm.requestOutput(true);
+    CHECK(fsm.state() == FocusStateMachine::STATE_WAIT_HIDDEN && fsm.bufferHidden());
+    CHECK(env.timerArmed && env.timerMs == 300);
+    // 暫放視窗尚未隱藏時的前景變化不算就緒
+    fsm.onForegroundChanged();
+    CHECK(fsm.state() == FocusStateMachine::STATE_WAIT_HIDDEN);
+    env.visible = false;
+    fsm.onBufferHidden();
+    CHECK(fsm.state() == FocusStateMachine::STATE_WAIT_FOCUS);
+    // 狀態間移動不重新計時
+    CHECK(env.log == "hide;timer;");
+    env.focus = true;
+    fsm.onForegroundChanged();
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT);
+    CHECK(env.log == "hide;timer;kill;release;");
+    CHECK(!env.timerArmed && fsm.timeoutCount() == 0);
+    fsm.onOutputFinished();
+    CHECK(env.log == "hide;timer;kill;release;hold;restore;");
+    CHECK(!fsm.bufferHidden() && env.visible);
+
+    // 不要求隱藏時，可見的暫放視窗不影響
+    env.log.clear();
+    fsm.requestOutput(false);
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT && env.log == "release;");
+}
+
+TEST(timeoutReleasesOutput) {
+    FakeEnvironment env;
+    env.focus = false;
+    FocusStateMachine fsm(env);
+    fsm.requestOutput(true);
+    CHECK(fsm.state() == FocusStateMachine::STATE_WAIT_FOCUS);
+    CHECK(env.timerMs == FocusStateMachine::DEFAULT_TIMEOUT_MS);
+    fsm.onTimeout();
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT);
+    CHECK(env.log == "timer;release(timeout);");
+    CHECK(fsm.timeoutCount() == 1);
+    // 逾時後取得焦點：已在送出，不再重複釋放
+    env.focus = true;
+    fsm.onForegroundChanged();
+    CHECK(env.log == "timer;release(timeout);");
+    fsm.onOutputFinished();
+    CHECK(env.log == "timer;release(timeout);hold;");
+
+    // 下一次送出重新計時
+    env.focus = false;
+    env.log.clear();
+    fsm.requestOutput(true);
+    CHECK(env.log == "timer;");
+    fsm.onTimeout();
+    CHECK(fsm.timeoutCount() == 2);
+}
+
+TEST(staleTimeoutIsIgnored) {
+    FakeEnvironment env;
+    env.focus = false;
+    FocusStateMachine fsm(env);
+    fsm.requestOutput(true);
+    env.focus = true;
+    fsm.onForegroundChanged();
+    // KillTimer 之前已排入的 WM_TIMER 仍可能送達：送出中與閒置時都不影響
+    fsm.onTimeout();
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT && fsm.timeoutCount() == 0);
+    fsm.onOutputFinished();
+    fsm.onTimeout();
+    CHECK(fsm.state() == FocusStateMachine::STATE_IDLE && fsm.timeoutCount() == 0);
+    CHECK(env.log == "timer;kill;release;hold;");
+}
+
+TEST(foregroundChangeRacingRestore) {
+    FakeEnvironment env;
+    env.visible = true;
+    FocusStateMachine fsm(env);
+    fsm.requestOutput(true);
+    env.visible = false;
+    fsm.onBufferHidden();
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT);
+
+    // 送完後恢復暫放視窗，恢復造成的前景與隱藏事件晚一步才送達：閒置狀態下忽略
+    fsm.onOutputFinished();
+    CHECK(env.visible && env.log == "hide;timer;kill;release;hold;restore;");
+    fsm.onForegroundChanged();
+    fsm.onBufferHidden();
+    CHECK(fsm.state() == FocusStateMachine::STATE_IDLE);
+    CHECK(env.log == "hide;timer;kill;release;hold;restore;");
+
+    // 恢復後立刻又有文字：重新隱藏並等待，而不是沿用舊的隱藏狀態直接送出
+    env.log.clear();
+    fsm.requestOutput(true);
+    CHECK(fsm.state() == FocusStateMachine::STATE_WAIT_HIDDEN && fsm.bufferHidden());
+    CHECK(env.log == "hide;timer;");
+    // 晚到的前景事件（來自上一次恢復）不能讓等待提前結束
+    fsm.onForegroundChanged();
+    CHECK(fsm.state() == FocusStateMachine::STATE_WAIT_HIDDEN);
+    env.visible = false;
+    fsm.onBufferHidden();
+    CHECK(fsm.state() == FocusStateMachine::STATE_OUTPUT);
+
+    // 送出途中被取消（輸出佇列清空）也要恢復暫放視窗並取消計時
+    env.log.clear();
+    fsm.onOutputFinished();
+    env.focus = false;
+    fsm.requestOutput(true);
+    fsm.onOutputFinished();
+    CHECK(fsm.state() == FocusStateMachine::STATE_IDLE && !env.timerArmed);
+    CHECK(env.log == "hold;restore;hide;timer;kill;hold;restore;");
+}
+
+TEST(stateNames) {
+    CHECK(std::string(FocusStateMachine::stateName(FocusStateMachine::STATE_WAIT_FOCUS)) == "WAIT_FOCUS");
+    CHECK(std::string(FocusStateMachine::stateName((FocusStateMachine::State)9)) == "UNKNOWN");
+}
+
+int main() {
+    return TestCheck::runAll("focus_tracker");
+}
@@ -0,0 +1,315 @@
+// gzip_stream_test.cpp - gzip 分段解壓縮：三種區塊、表頭欄位、多個成員、截斷的輸入與檔尾不符
+#include "gzip_stream.h"
+#include "test_check.h"
+#include <algorithm>
+
+using namespace GzipStream;
+
+namespace {
+
+// 以 zlib（gzip 格式、mtime 0）產生的檔案，內容都是 LINES 重複：
+// STORED 為 level 0 的儲存區塊；FIXED 強制使用固定霍夫曼碼；
+// MIXED 為同一成員中的固定碼區塊、同步清除產生的空儲存區塊，以及內容 2000 份的動態碼區塊
+// （解出 106 KB，距離複製會跨過 32 KB 視窗的邊界）
+const char LINES[] = "一\tu\n二\tuu\n十\tui\n木\tuio\n林\tuiouio\n森\tuiouiouio\n";
+
+const unsigned char STORED[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x35, 0x00, 0xca, 0xff, 0xe4,
+    0xb8, 0x80, 0x09, 0x75, 0x0a, 0xe4, 0xba, 0x8c, 0x09, 0x75, 0x75, 0x0a, 0xe5, 0x8d, 0x81, 0x09,
+    0x75, 0x69, 0x0a, 0xe6, 0x9c, 0xa8, 0x09, 0x75, 0x69, 0x6f, 0x0a, 0xe6, 0x9e, 0x97, 0x09, 0x75,
+    0x69, 0x6f, 0x75, 0x69, 0x6f, 0x0a, 0xe6, 0xa3, 0xae, 0x09, 0x75, 0x69, 0x6f, 0x75, 0x69, 0x6f,
+    0x75, 0x69, 0x6f, 0x0a, 0x24, 0x22, 0x88, 0x3e, 0x35, 0x00, 0x00, 0x00,
+};
+const unsigned char FIXED[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7b, 0xb2, 0xa3, 0x81, 0xb3, 0x94,
+    0xeb, 0xc9, 0xae, 0x1e, 0xce, 0xd2, 0x52, 0xae, 0xa7, 0xbd, 0x8d, 0x9c, 0xa5, 0x99, 0x5c, 0xcf,
+    0xe6, 0xac, 0x00, 0x52, 0xf9, 0x5c, 0xcf, 0xe6, 0x4d, 0x07, 0xd1, 0x60, 0xe6, 0xe2, 0x75, 0x50,
+    0x26, 0x88, 0x07, 0x00, 0x24, 0x22, 0x88, 0x3e, 0x35, 0x00, 0x00, 0x00,
+};
+const unsigned char MIXED[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7a, 0xb2, 0xa3, 0x81, 0xb3, 0x94,
+    0xeb, 0xc9, 0xae, 0x1e, 0xce, 0xd2, 0x52, 0xae, 0xa7, 0xbd, 0x8d, 0x9c, 0xa5, 0x99, 0x5c, 0xcf,
+    0xe6, 0xac, 0x00, 0x52, 0xf9, 0x5c, 0xcf, 0xe6, 0x4d, 0x07, 0xd1, 0x60, 0xe6, 0xe2, 0x75, 0x50,
+    0x26, 0x88, 0x07, 0x00, 0x00, 0x00, 0xff, 0xff, 0xed, 0xcb, 0x31, 0x0d, 0x00, 0x00, 0x00, 0xc3,
+    0x20, 0xff, 0x3e, 0x27, 0xa4, 0x3e, 0x16, 0xf8, 0x99, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49,
+    0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+    0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49,
+    0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+    0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49,
+    0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+    0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49,
+    0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+    0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49,
+    0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+    0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49,
+    0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+    0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+    0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x1d, 0xa7, 0x00, 0x0f,
+    0x74, 0x56, 0x2f, 0x45, 0x9e, 0x01, 0x00,
+};
+
+std::string bytes(const unsigned char* data, size_t size) {
+    return std::string((const char*)data, size);
+}
+
+std::string repeatLines(int count) {
+    std::string text;
+    for (int i = 0; i < count; i++) text += LINES;
+    return text;
+}
+
+struct Result {
+    Status status;
+    std::string output;
+    size_t largestCallback;
+};
+
+// 每次餵入 chunk 位元組；回傳最後的狀態與解出的內容
+Result decode(Decoder& decoder, const std::string& data, size_t chunk) {
+    Result result;
+    result.status = GZ_NEED_INPUT;
+    result.largestCallback = 0;
+    Decoder::Output out = [&](const char* text, size_t size) {
+        result.output.append(text, size);
+        result.largestCallback = std::max(result.largestCallback, size);
+    };
+    decoder.reset();
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+        result.status = decoder.feed(data.data() + pos, std::min(chunk, data.size() - pos), out);
+    }
+    return result;
+}
+
+// 在 cut 處切成兩段餵入
+Result decodeSplit(Decoder& decoder, const std::string& data, size_t cut) {
+    Result result;
+    result.largestCallback = 0;
+    Decoder::Output out = [&](const char* text, size_t size) { result.output.append(text, size); };
+    decoder.reset();
+    decoder.feed(data.data(), cut, out);
+    result.status = decoder.feed(data.data() + cut, data.size() - cut, out);
+    return result;
+}
+
+// deflate 的位元串流：一般欄位由低位開始，霍夫曼碼由高位開始
+class BitWriter {
+public:
+    BitWriter() : bits_(0), count_(0) {}
+    void put(uint32_t value, int count) {
+        for (int i = 0; i < count; i++) putBit((value >> i) & 1);
+    }
+    void putCode(uint32_t code, int length) {
+        for (int i = length - 1; i >= 0; i--) putBit((code >> i) & 1);
+    }
+    std::string finish() {
+        if (count_) data_ += (char)bits_;
+        bits_ = 0;
+        count_ = 0;
+        return data_;
+    }
+
+private:
+    void putBit(uint32_t bit) {
+        bits_ |= bit << count_;
+        if (++count_ == 8) {
+            data_ += (char)bits_;
+            bits_ = 0;
+            count_ = 0;
+        }
+    }
+    std::string data_;
+    uint32_t bits_;
+    int count_;
+};
+
+const char HEADER[] = "\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff";
+
+std::string trailer(const std::string& content) {
+    uint32_t values[2] = {crc32(0, content.data(), content.size()), (uint32_t)content.size()};
+    std::string out;
+    for (int v = 0; v < 2; v++) {
+        for (int i = 0; i < 4; i++) out += (char)(values[v] >> (8 * i));
+    }
+    return out;
+}
+
+// 固定碼區塊：兩個字元後接長度 3、距離 distance 的複製
+std::string fixedBlockWithCopy(const char* literals, int distanceCode) {
+    BitWriter writer;
+    writer.put(1, 1);       // 最後一個區塊
+    writer.put(1, 2);       // 固定霍夫曼碼
+    for (const char* p = literals; *p; p++) writer.putCode(0x30 + (uint8_t)*p, 8);
+    writer.putCode(1, 7);   // 長度符號 257：長度 3
+    writer.putCode((uint32_t)distanceCode, 5);
+    writer.putCode(0, 7);   // 區塊結束
+    return writer.finish();
+}
+
+}
+
+TEST(crcKnownValues) {
+    CHECK(crc32(0, "123456789", 9) == 0xCBF43926u);
+    CHECK(crc32(0, "", 0) == 0);
+    CHECK(crc32(0, LINES, sizeof(LINES) - 1) == 0x3E882224u);
+    // 分段計算
+    uint32_t crc = crc32(0, "1234", 4);
+    CHECK(crc32(crc, "56789", 5) == 0xCBF43926u);
+}
+
+TEST(storedFixedAndDynamicBlocks) {
+    struct Fixture {
+        std::string data;
+        std::string expected;
+    } fixtures[] = {
+        {bytes(STORED, sizeof(STORED)), repeatLines(1)},
+        {bytes(FIXED, sizeof(FIXED)), repeatLines(1)},
+        {bytes(MIXED, sizeof(MIXED)), repeatLines(2001)},
+    };
+    Decoder decoder;
+    size_t chunks[] = {1, 2, 3, 7, 64, 1 << 20};
+    for (size_t f = 0; f < 3; f++) {
+        for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+            Result result = decode(decoder, fixtures[f].data, chunks[c]);
+            if (result.status != GZ_DONE || result.output != fixtures[f].expected) {
+                printf("  第 %u 個檔案以 %u 位元組分段解壓縮失敗\n", (unsigned)f, (unsigned)chunks[c]);
+                CHECK(false);
+            }
+            CHECK(decoder.outputSize() == fixtures[f].expected.size());
+            // 每次回呼不超過視窗大小
+            CHECK(result.largestCallback <= 32768);
+        }
+        // 切在每個位置
+        bool ok = true;
+        for (size_t cut = 0; cut <= fixtures[f].data.size() && ok; cut++) {
+            Result result = decodeSplit(decoder, fixtures[f].data, cut);
+            ok = result.status == GZ_DONE && result.output == fixtures[f].expected;
+            if (!ok) printf("  第 %u 個檔案切在 %u 時失敗\n", (unsigned)f, (unsigned)cut);
+        }
+        CHECK(ok);
+    }
+
+    // 自行編碼的固定碼區塊：距離 2 的重疊複製
+    std::string crafted = std::string(HEADER, 10) + fixedBlockWithCopy("ab", 1) + trailer("ababa");
+    Result result = decode(decoder, crafted, 1);
+    CHECK(result.status == GZ_DONE && result.output == "ababa");
+}
+
+TEST(headerOptionalFields) {
+    // FEXTRA、FNAME、FCOMMENT、FHCRC 都要略過
+    std::string fixed = bytes(FIXED, sizeof(FIXED));
+    std::string data = fixed.substr(0, 10);
+    data[3] = 4 | 8 | 16 | 2;
+    data += std::string("\x05\x00" "extra", 7);
+    data += std::string("dict.txt\0", 9);
+    data += std::string("字碼表\0", 10);
+    data += "\x12\x34";
+    data += fixed.substr(10);
+    Decoder decoder;
+    for (size_t cut = 0; cut <= data.size(); cut++) {
+        Result result = decodeSplit(decoder, data, cut);
+        if (result.status != GZ_DONE || result.output != LINES) {
+            printf("  切在 %u 時失敗\n", (unsigned)cut);
+            CHECK(false);
+            break;
+        }
+    }
+
+    // 保留的旗標位元、不是 gzip、不是 deflate
+    std::string reserved = fixed;
+    reserved[3] = 0x20;
+    CHECK(decode(decoder, reserved, 64).status == GZ_ERROR);
+    CHECK(decode(decoder, "<html>404</html>", 64).status == GZ_ERROR);
+    std::string method = fixed;
+    method[2] = 7;
+    CHECK(decode(decoder, method, 64).status == GZ_ERROR);
+}
+
+TEST(multiMemberFiles) {
+    std::string first = bytes(STORED, sizeof(STORED));
+    std::string second = bytes(MIXED, sizeof(MIXED));
+    std::string third = bytes(FIXED, sizeof(FIXED));
+    std::string data = first + second + third;
+    std::string expected = repeatLines(1 + 2001 + 1);
+    Decoder decoder;
+    size_t chunks[] = {1, 5, 100, 1 << 20};
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        Result result = decode(decoder, data, chunks[c]);
+        CHECK(result.status == GZ_DONE && result.output == expected);
+    }
+
+    // 每個成員結束時都是完整的；下一個成員開始後又需要更多輸入
+    Result result;
+    Decoder::Output out = [&](const char* text, size_t size) { result.output.append(text, size); };
+    decoder.reset();
+    CHECK(decoder.feed(first.data(), first.size(), out) == GZ_DONE);
+    CHECK(decoder.feed(second.data(), 20, out) == GZ_NEED_INPUT);
+    CHECK(decoder.feed(second.data() + 20, second.size() - 20, out) == GZ_DONE);
+    CHECK(result.output == repeatLines(2002) && decoder.outputSize() == result.output.size());
+
+    // 成員各自計算 CRC 與長度；距離不能參照前一個成員的內容
+    std::string crafted = std::string(HEADER, 10) + fixedBlockWithCopy("a", 1) + trailer("aaaa");
+    CHECK(decode(decoder, crafted, 64).status == GZ_ERROR);
+    CHECK(decode(decoder, first + crafted, 64).status == GZ_ERROR);
+    std::string tooFar = std::string(HEADER, 10) + fixedBlockWithCopy("ab", 2) + trailer("ababa");
+    CHECK(decode(decoder, first + tooFar, 64).status == GZ_ERROR);
+}
+
+TEST(truncatedInput) {
+    std::string data = bytes(FIXED, sizeof(FIXED)) + bytes(MIXED, sizeof(MIXED));
+    std::string expected = repeatLines(2002);
+    Decoder decoder;
+    // 任何位置截斷：不是錯誤也不是完成（除了剛好在成員結尾），已解出的是正確內容的開頭
+    bool ok = true;
+    for (size_t length = 0; length < data.size() && ok; length++) {
+        Result result = decode(decoder, data.substr(0, length), 1 << 20);
+        Status wanted = length == sizeof(FIXED) ? GZ_DONE : GZ_NEED_INPUT;
+        ok = result.status == wanted && expected.compare(0, result.output.size(), result.output) == 0;
+        if (!ok) printf("  截斷在 %u 時狀態或內容不符\n", (unsigned)length);
+    }
+    CHECK(ok);
+
+    // 截斷後 reset 可以重新開始
+    decode(decoder, data.substr(0, 100), 7);
+    Result result = decode(decoder, data, 7);
+    CHECK(result.status == GZ_DONE && result.output == expected);
+}
+
+TEST(trailerMismatch) {
+    std::string fixed = bytes(FIXED, sizeof(FIXED));
+    Decoder decoder;
+    // CRC 或長度（ISIZE）的任何一個位元組不符
+    for (size_t i = fixed.size() - 8; i < fixed.size(); i++) {
+        std::string damaged = fixed;
+        damaged[i] ^= 0x01;
+        CHECK(decode(decoder, damaged, 3).status == GZ_ERROR);
+    }
+    // 內容損壞（檔尾不變）
+    std::string stored = bytes(STORED, sizeof(STORED));
+    stored[20] ^= 0x40;
+    Result result = decode(decoder, stored, 64);
+    CHECK(result.status == GZ_ERROR);
+
+    // 錯誤之後的輸入都被拒絕，直到 reset
+    Decoder::Output out = [](const char*, size_t) {};
+    CHECK(decoder.feed(fixed.data(), fixed.size(), out) == GZ_ERROR);
+    CHECK(decoder.status() == GZ_ERROR);
+
+    // 儲存區塊的長度與補數不符、保留的區塊類型
+    std::string length = bytes(STORED, sizeof(STORED));
+    length[13] ^= 0x01;
+    CHECK(decode(decoder, length, 64).status == GZ_ERROR);
+    BitWriter writer;
+    writer.put(1, 1);
+    writer.put(3, 2);
+    CHECK(decode(decoder, std::string(HEADER, 10) + writer.finish() + trailer(""), 64).status == GZ_ERROR);
+}
+
+int main() {
+    return TestCheck::runAll("gzip_stream");
+}
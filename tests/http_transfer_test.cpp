@@ -0,0 +1,374 @@
+// http_transfer_test.cpp - 條件式與可續傳下載：以假的傳輸模擬 304、206 續傳、應續傳卻回 200、續傳時版本改變與 gzip 傳輸
+#include "gzip_stream.h"
+#include "http_transfer.h"
+#include "test_check.h"
+#include "test_files.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace HttpTransfer;
+using namespace TestFiles;
+
+namespace {
+
+const char* URL = "https://example.com/Zi-Ma-Biao.txt";
+
+Target testTarget() {
+    Target target;
+    target.path = "core/tests/http_transfer_test.txt";
+    target.tempPath = "core/tests/http_transfer_test.txt.tmp";
+    target.metaPath = "core/tests/http_transfer_test.txt.meta";
+    return target;
+}
+
+void removeFiles(const Target& target) {
+    std::remove(target.path.c_str());
+    std::remove(target.tempPath.c_str());
+    std::remove(target.metaPath.c_str());
+}
+
+std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+
+std::string headerValue(const Headers& headers, const std::string& name) {
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (lower(headers[i].first) == lower(name)) return headers[i].second;
+    }
+    return std::string();
+}
+
+// 以儲存區塊（不壓縮）包成 gzip：每 blockSize 位元組一個區塊，解壓縮時跨過多次讀取
+std::string gzipStored(const std::string& data, size_t blockSize) {
+    std::string out("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03", 10);
+    size_t pos = 0;
+    do {
+        size_t size = std::min(blockSize, data.size() - pos);
+        bool last = pos + size == data.size();
+        unsigned char header[5] = {(unsigned char)(last ? 1 : 0), (unsigned char)size, (unsigned char)(size >> 8),
+                                   (unsigned char)~size, (unsigned char)(~size >> 8)};
+        out.append((const char*)header, sizeof(header));
+        out.append(data, pos, size);
+        pos += size;
+    } while (pos < data.size());
+    uint32_t trailer[2] = {GzipStream::crc32(0, data.data(), data.size()), (uint32_t)data.size()};
+    for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < 4; k++) out += (char)(trailer[i] >> (8 * k));
+    }
+    return out;
+}
+
+// 分段送出本文；breakAfter 位元組後連線中斷
+class FakeResponse : public Response {
+public:
+    FakeResponse(int status, const Headers& headers, const std::string& body, long breakAfter)
+        : status_(status), headers_(headers), body_(body), pos_(0), breakAfter_(breakAfter) {}
+
+    int status() const { return status_; }
+    std::string header(const std::string& name) const { return headerValue(headers_, name); }
+    long read(char* buffer, size_t size) {
+        if (breakAfter_ >= 0 && pos_ >= (size_t)breakAfter_) return -1;
+        size_t limit = breakAfter_ >= 0 ? (size_t)breakAfter_ : body_.size();
+        size_t n = std::min(std::min(size, (size_t)700), std::min(limit, body_.size()) - pos_);
+        std::memcpy(buffer, body_.data() + pos_, n);
+        pos_ += n;
+        return (long)n;
+    }
+
+private:
+    int status_;
+    Headers headers_;
+    std::string body_;
+    size_t pos_;
+    long breakAfter_;
+};
+
+// 模擬伺服器：依條件式標頭與 Range 回應；可設定不遵守 Range、在 206 時送出不同的版本，
+// 或對接受 gzip 的完整請求以 gzip 傳輸（與常見的伺服器相同，壓縮後的內容使用另一個 ETag）
+class FakeServer : public Transport {
+public:
+    std::string body;
+    std::string etag;
+    std::string lastModified;
+    long breakAfter;            // 下一次回應在這麼多位元組後中斷（-1：不中斷）
+    bool honorRange;            // false：忽略 Range，一律回完整內容
+    std::string etagOn206;      // 不為空時 206 回應帶這個 ETag（版本已變更卻仍回部分內容）
+    bool offline;
+    bool gzip;
+    std::vector<Headers> requests;
+
+    FakeServer() : etag("\"v1\""), lastModified("Mon, 01 Jan 2024 00:00:00 GMT"), breakAfter(-1),
+                   honorRange(true), offline(false), gzip(false) {
+        for (int i = 0; i < 5000; i++) body += (char)('a' + i % 26);
+    }
+
+    std::unique_ptr<Response> get(const std::string&, const Headers& headers, std::wstring& error) {
+        requests.push_back(headers);
+        if (offline) {
+            error = L"無法連線";
+            return std::unique_ptr<Response>();
+        }
+        long cut = breakAfter;
+        breakAfter = -1;
+        Headers out;
+        if (!etag.empty()) out.push_back(std::make_pair(std::string("ETag"), etag));
+        out.push_back(std::make_pair(std::string("Last-Modified"), lastModified));
+
+        std::string inm = headerValue(headers, "If-None-Match");
+        std::string ims = headerValue(headers, "If-Modified-Since");
+        if ((!inm.empty() && (inm == etag || inm == gzipEtag())) ||
+            (inm.empty() && !ims.empty() && ims == lastModified)) {
+            return std::unique_ptr<Response>(new FakeResponse(304, out, std::string(), -1));
+        }
+
+        std::string range = headerValue(headers, "Range");
+        std::string ifRange = headerValue(headers, "If-Range");
+        if (honorRange && !range.empty() && (ifRange == etag || ifRange == lastModified || !etagOn206.empty())) {
+            size_t start = (size_t)std::strtoull(range.c_str() + 6, nullptr, 10);
+            if (start >= body.size()) return std::unique_ptr<Response>(new FakeResponse(416, out, "", -1));
+            if (!etagOn206.empty()) out[0].second = etagOn206;
+            out.push_back(std::make_pair(std::string("Content-Range"),
+                "bytes " + std::to_string(start) + "-" + std::to_string(body.size() - 1) + "/" +
+                std::to_string(body.size())));
+            return std::unique_ptr<Response>(new FakeResponse(206, out, body.substr(start), cut));
+        }
+        if (gzip && headerValue(headers, "Accept-Encoding") == "gzip") {
+            std::string compressed = gzipStored(body, 1024);
+            if (!etag.empty()) out[0].second = gzipEtag();
+            out.push_back(std::make_pair(std::string("Content-Encoding"), std::string("gzip")));
+            out.push_back(std::make_pair(std::string("Content-Length"), std::to_string(compressed.size())));
+            return std::unique_ptr<Response>(new FakeResponse(200, out, compressed, cut));
+        }
+        out.push_back(std::make_pair(std::string("Content-Length"), std::to_string(body.size())));
+        return std::unique_ptr<Response>(new FakeResponse(200, out, body, cut));
+    }
+
+    std::string gzipEtag() const {
+        return etag.empty() ? std::string() : etag.substr(0, etag.size() - 1) + "-gzip\"";
+    }
+};
+
+// 記錄 sink 收到的內容：每次 restart 從頭開始
+class RecordingSink : public BodySink {
+public:
+    std::string data;
+    int restarts;
+    RecordingSink() : restarts(0) {}
+    void restart() { data.clear(); restarts++; }
+    void append(const char* bytes, size_t size) { data.append(bytes, size); }
+};
+
+// 中斷下載，讓暫存檔留下前 size 位元組
+FetchResult interrupt(FakeServer& server, const Target& target, long size) {
+    server.breakAfter = size;
+    return fetch(server, URL, target);
+}
+
+}
+
+TEST(notModifiedAfterCompleteDownload) {
+    Target target = testTarget();
+    removeFiles(target);
+    FakeServer server;
+    RecordingSink sink;
+    FetchResult first = fetch(server, URL, target, &sink);
+    CHECK(first.outcome == FETCH_COMPLETE && first.httpCode == 200 && !first.resumed);
+    CHECK(first.received == 5000 && first.fileSize == 5000);
+    CHECK(readBytes(target.tempPath) == server.body && sink.data == server.body);
+    CHECK(first.validators.etag == server.etag && first.validators.lastModified == server.lastModified);
+    // 沒有記錄版本：不送條件式標頭
+    CHECK(headerValue(server.requests[0], "If-None-Match").empty());
+    CHECK(headerValue(server.requests[0], "Accept-Encoding") == "gzip");
+
+    // 取代目標檔案後記下版本：下次以 If-None-Match / If-Modified-Since 詢問
+    std::rename(target.tempPath.c_str(), target.path.c_str());
+    markComplete(target, URL, first.validators);
+    FetchResult second = fetch(server, URL, target);
+    CHECK(second.outcome == FETCH_NOT_MODIFIED && second.httpCode == 304 && second.received == 0);
+    CHECK(headerValue(server.requests[1], "If-None-Match") == "\"v1\"");
+    CHECK(headerValue(server.requests[1], "If-Modified-Since") == server.lastModified);
+    CHECK(!exists(target.tempPath));
+
+    // 本機檔案被替換過（大小不同）：不送條件式請求，重新下載
+    std::ofstream(target.path.c_str(), std::ios::app) << "x";
+    FetchResult third = fetch(server, URL, target);
+    CHECK(third.outcome == FETCH_COMPLETE && headerValue(server.requests[2], "If-None-Match").empty());
+
+    // 網址改變：舊的版本不適用
+    markComplete(target, URL, first.validators);
+    std::remove(target.tempPath.c_str());
+    FetchResult other = fetch(server, "https://example.com/other.txt", target);
+    CHECK(other.outcome == FETCH_COMPLETE && headerValue(server.requests[3], "If-None-Match").empty());
+    removeFiles(target);
+}
+
+TEST(resumeWith206) {
+    Target target = testTarget();
+    removeFiles(target);
+    FakeServer server;
+    FetchResult broken = interrupt(server, target, 1800);
+    CHECK(broken.outcome == FETCH_INCOMPLETE && broken.fileSize == 1800);
+    CHECK(readBytes(target.tempPath) == server.body.substr(0, 1800));
+    Metadata meta;
+    CHECK(loadMetadata(target.metaPath, meta) && meta.partial.etag == "\"v1\"");
+
+    RecordingSink sink;
+    FetchResult resumed = fetch(server, URL, target, &sink);
+    CHECK(resumed.outcome == FETCH_COMPLETE && resumed.httpCode == 206 && resumed.resumed);
+    CHECK(resumed.received == 3200 && resumed.fileSize == 5000);
+    CHECK(headerValue(server.requests[1], "Range") == "bytes=1800-");
+    CHECK(headerValue(server.requests[1], "If-Range") == "\"v1\"");
+    CHECK(headerValue(server.requests[1], "Accept-Encoding").empty());
+    // sink 先收到暫存檔中已有的部分，再收到續傳的部分
+    CHECK(readBytes(target.tempPath) == server.body && sink.data == server.body && sink.restarts == 1);
+
+    // 弱 ETag 且沒有日期：無法安全續傳，中斷時丟棄已收到的部分
+    removeFiles(target);
+    server.etag = "W/\"weak\"";
+    server.lastModified.clear();
+    FetchResult weak = interrupt(server, target, 1000);
+    CHECK(weak.outcome == FETCH_INCOMPLETE && !exists(target.tempPath));
+    removeFiles(target);
+}
+
+TEST(fullResponseWhereRangeWasExpected) {
+    Target target = testTarget();
+    removeFiles(target);
+    FakeServer server;
+    interrupt(server, target, 2100);
+
+    // 伺服器不支援 Range：回 200 完整內容，暫存檔從頭寫
+    server.honorRange = false;
+    RecordingSink sink;
+    FetchResult full = fetch(server, URL, target, &sink);
+    CHECK(full.outcome == FETCH_COMPLETE && full.httpCode == 200 && !full.resumed);
+    CHECK(server.requests.size() == 2 && !headerValue(server.requests[1], "Range").empty());
+    CHECK(full.received == 5000 && readBytes(target.tempPath) == server.body);
+    CHECK(sink.data == server.body && sink.restarts == 1);
+
+    // 內容已更新（If-Range 不符）：伺服器依規定回 200 新版本
+    removeFiles(target);
+    server.honorRange = true;
+    interrupt(server, target, 2100);
+    server.etag = "\"v2\"";
+    server.body = std::string(3000, 'z');
+    FetchResult updated = fetch(server, URL, target);
+    CHECK(updated.outcome == FETCH_COMPLETE && updated.httpCode == 200 && !updated.resumed);
+    CHECK(readBytes(target.tempPath) == server.body && updated.validators.etag == "\"v2\"");
+
+    // 暫存檔比新版本長：416，丟棄後重新下載
+    removeFiles(target);
+    server.body = std::string(5000, 'y');
+    interrupt(server, target, 4000);
+    server.body = std::string(3000, 'w');
+    FetchResult shorter = fetch(server, URL, target);
+    CHECK(shorter.outcome == FETCH_COMPLETE && shorter.httpCode == 200);
+    CHECK(readBytes(target.tempPath) == server.body);
+    removeFiles(target);
+}
+
+TEST(etagChangedDuringResume) {
+    Target target = testTarget();
+    removeFiles(target);
+    FakeServer server;
+    interrupt(server, target, 1500);
+
+    // 內容已更新，但伺服器不理會 If-Range 仍回 206：版本不同，不可接在舊的部分後面
+    server.body = std::string(5000, 'n');
+    server.etag = "\"v2\"";
+    server.etagOn206 = "\"v2\"";
+    FetchResult result = fetch(server, URL, target);
+    CHECK(result.outcome == FETCH_COMPLETE && !result.resumed && result.httpCode == 200);
+    CHECK(server.requests.size() == 3 && headerValue(server.requests[2], "Range").empty());
+    CHECK(readBytes(target.tempPath) == server.body && result.validators.etag == "\"v2\"");
+
+    // 續傳中途再次中斷：保留已收到的部分，版本仍是中斷時的版本
+    removeFiles(target);
+    server.etagOn206.clear();
+    interrupt(server, target, 1000);
+    server.breakAfter = 1500;
+    FetchResult again = fetch(server, URL, target);
+    CHECK(again.outcome == FETCH_INCOMPLETE && again.resumed && again.fileSize == 2500);
+    FetchResult finished = fetch(server, URL, target);
+    CHECK(finished.outcome == FETCH_COMPLETE && finished.resumed && readBytes(target.tempPath) == server.body);
+    removeFiles(target);
+}
+
+TEST(errorsKeepPartialDownload) {
+    Target target = testTarget();
+    removeFiles(target);
+    FakeServer server;
+    interrupt(server, target, 1200);
+
+    server.offline = true;
+    FetchResult offline = fetch(server, URL, target);
+    CHECK(offline.outcome == FETCH_NETWORK_ERROR && offline.error == L"無法連線");
+    CHECK(readBytes(target.tempPath).size() == 1200);
+
+    // 取消：已收到的部分保留，下次續傳
+    server.offline = false;
+    class CancelAfter : public Monitor {
+    public:
+        int calls;
+        CancelAfter() : calls(0) {}
+        bool progress(uint64_t, long long total) { return total == 5000 && ++calls < 3; }
+    } monitor;
+    FetchResult cancelled = fetch(server, URL, target, nullptr, &monitor);
+    CHECK(cancelled.outcome == FETCH_CANCELLED && cancelled.fileSize == 1200 + 2 * 700);
+    FetchResult finished = fetch(server, URL, target);
+    CHECK(finished.outcome == FETCH_COMPLETE && finished.resumed && readBytes(target.tempPath) == server.body);
+    removeFiles(target);
+}
+
+TEST(gzipTransfers) {
+    Target target = testTarget();
+    removeFiles(target);
+    FakeServer server;
+    server.gzip = true;
+    std::string compressed = gzipStored(server.body, 1024);
+
+    // 200 gzip：傳輸的是壓縮後的大小，暫存檔與 sink 收到解壓縮後的內容
+    RecordingSink sink;
+    FetchResult first = fetch(server, URL, target, &sink);
+    CHECK(first.outcome == FETCH_COMPLETE && first.httpCode == 200 && first.compressed && !first.resumed);
+    CHECK(first.received == compressed.size() && first.fileSize == 5000);
+    CHECK(readBytes(target.tempPath) == server.body && sink.data == server.body && sink.restarts == 1);
+    CHECK(first.validators.etag == "\"v1-gzip\"");
+
+    // 304：以壓縮內容的 ETag 詢問
+    std::rename(target.tempPath.c_str(), target.path.c_str());
+    markComplete(target, URL, first.validators);
+    FetchResult second = fetch(server, URL, target);
+    CHECK(second.outcome == FETCH_NOT_MODIFIED && second.httpCode == 304);
+    CHECK(headerValue(server.requests[1], "If-None-Match") == "\"v1-gzip\"");
+    CHECK(headerValue(server.requests[1], "Accept-Encoding") == "gzip");
+
+    // gzip 傳輸中斷：暫存檔留下已解出的部分，版本只記 Last-Modified（ETag 代表壓縮後的內容）
+    removeFiles(target);
+    FetchResult broken = interrupt(server, target, 2000);
+    CHECK(broken.outcome == FETCH_INCOMPLETE && broken.compressed && broken.received == 2000);
+    CHECK(broken.fileSize > 0 && broken.fileSize < 2000);
+    CHECK(readBytes(target.tempPath) == server.body.substr(0, (size_t)broken.fileSize));
+    Metadata meta;
+    CHECK(loadMetadata(target.metaPath, meta) && meta.partial.etag.empty());
+    CHECK(meta.partial.lastModified == server.lastModified);
+
+    // 續傳不接受 gzip：以 Last-Modified 比對，伺服器回未壓縮的 206
+    RecordingSink resumedSink;
+    FetchResult resumed = fetch(server, URL, target, &resumedSink);
+    CHECK(resumed.outcome == FETCH_COMPLETE && resumed.httpCode == 206 && resumed.resumed && !resumed.compressed);
+    CHECK(resumed.received == 5000 - broken.fileSize && resumed.fileSize == 5000);
+    CHECK(headerValue(server.requests[3], "Range") == "bytes=" + std::to_string(broken.fileSize) + "-");
+    CHECK(headerValue(server.requests[3], "If-Range") == server.lastModified);
+    CHECK(headerValue(server.requests[3], "Accept-Encoding").empty());
+    CHECK(readBytes(target.tempPath) == server.body && resumedSink.data == server.body);
+    removeFiles(target);
+}
+
+int main() {
+    return TestCheck::runAll("http_transfer");
+}
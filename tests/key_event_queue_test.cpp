@@ -0,0 +1,203 @@
+// key_event_queue_test.cpp - 鉤子按鍵佇列：先進先出、佇列滿、跨執行緒順序與退回路徑的順序
+#include "key_event_queue.h"
+#include "test_check.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(fifoAndFullRing) {
+    SpscRingBuffer<int, 8> ring;
+    int item = 0;
+    CHECK(ring.empty() && !ring.pop(item));
+    for (int i = 0; i < 8; i++) CHECK(ring.push(i));
+    // 已滿：push 失敗且不覆蓋既有項目
+    CHECK(!ring.push(100));
+    CHECK(ring.size() == 8);
+    CHECK(ring.pop(item) && item == 0);
+    CHECK(ring.push(8));
+    CHECK(!ring.push(101));
+    for (int i = 1; i <= 8; i++) CHECK(ring.pop(item) && item == i);
+    CHECK(!ring.pop(item) && ring.empty());
+
+    // 多次繞回：位置以遮罩取餘數
+    int next = 0, expected = 0;
+    bool ordered = true;
+    for (int round = 0; round < 1000; round++) {
+        for (int i = 0; i < 5; i++) ring.push(next++);
+        for (int i = 0; i < 5; i++) ordered = ring.pop(item) && item == expected++ && ordered;
+    }
+    CHECK(ordered);
+}
+
+TEST(producerConsumerOrderAcrossThreads) {
+    static SpscRingBuffer<uint32_t, 256> ring;
+    const uint32_t COUNT = 2000000;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < COUNT; i++) {
+            while (!ring.push(i)) std::this_thread::yield();
+        }
+    });
+    uint32_t expected = 0, item = 0;
+    bool ordered = true;
+    while (expected < COUNT) {
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item != expected) ordered = false;
+        expected++;
+    }
+    producer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CHECK(ordered);
+    CHECK(ring.empty());
+    printf("  跨執行緒傳遞 %u 筆：%.1f 百萬筆/秒\n", COUNT, COUNT / seconds / 1e6);
+}
+
+namespace {
+
+// 模擬主視窗的訊息佇列：WAKE 為 WM_USER+101，KEY 為 WM_USER+100（攜帶按鍵）
+struct Message {
+    bool wake;
+    int key;
+};
+
+struct Simulation {
+    SpscHandoff<int, 4> handoff;
+    std::deque<Message> messages;
+    bool drainPending = false;
+    std::vector<int> handled;
+
+    void produce(int key) {
+        if (!handoff.push(key)) {
+            Message message = {false, key};
+            messages.push_back(message);
+        } else if (!drainPending) {
+            drainPending = true;
+            Message message = {true, 0};
+            messages.push_back(message);
+        }
+    }
+
+    void drain() {
+        drainPending = false;
+        int key;
+        while (handoff.pop(key)) handled.push_back(key);
+    }
+
+    bool consumeOne() {
+        if (messages.empty()) return false;
+        Message message = messages.front();
+        messages.pop_front();
+        if (message.wake) {
+            drain();
+        } else {
+            drain();
+            handled.push_back(message.key);
+            handoff.postedHandled();
+        }
+        return true;
+    }
+};
+
+bool isSequence(const std::vector<int>& keys, int count) {
+    if ((int)keys.size() != count) return false;
+    for (int i = 0; i < count; i++) {
+        if (keys[i] != i) return false;
+    }
+    return true;
+}
+
+}
+
+TEST(fallbackPathKeepsOrder) {
+    // 佇列滿後：已有 WAKE 在訊息佇列中，接著的按鍵不能在逐鍵訊息之前被取出
+    Simulation sim;
+    for (int i = 0; i < 6; i++) sim.produce(i);     // 0-3 入列，4、5 為逐鍵訊息
+    CHECK(sim.handoff.postedCount() == 2);
+    sim.consumeOne();                               // WAKE：取出 0-3
+    sim.produce(6);                                 // 佇列有空位，但 4、5 尚未處理：也走逐鍵訊息
+    CHECK(sim.handoff.size() == 0);
+    while (sim.consumeOne()) {}
+    CHECK(isSequence(sim.handled, 7));
+    CHECK(sim.handoff.postedCount() == 0);
+    // 逐鍵訊息都處理完後回到佇列
+    sim.produce(7);
+    CHECK(sim.handoff.size() == 1);
+    while (sim.consumeOne()) {}
+    CHECK(isSequence(sim.handled, 8));
+
+    // 隨機交錯生產與消費（消費者常落後，反覆進出退回路徑）
+    std::mt19937 rng(7);
+    for (int round = 0; round < 200; round++) {
+        Simulation random;
+        int produced = 0;
+        while (produced < 300 || !random.messages.empty()) {
+            if (produced < 300 && rng() % 3 != 0) {
+                random.produce(produced++);
+            } else {
+                random.consumeOne();
+            }
+        }
+        if (!isSequence(random.handled, 300)) {
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+TEST(fallbackPathKeepsOrderAcrossThreads) {
+    // 生產者與消費者在不同執行緒，訊息佇列以鎖保護（相當於 PostMessage）
+    static SpscHandoff<int, 8> handoff;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Message> messages;
+    std::atomic<bool> drainPending(false);
+    const int COUNT = 200000;
+
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; i++) {
+            if (!handoff.push(i)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                Message message = {false, i};
+                messages.push_back(message);
+                wake.notify_one();
+            } else if (!drainPending.exchange(true)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                Message message = {true, 0};
+                messages.push_back(message);
+                wake.notify_one();
+            }
+        }
+    });
+
+    std::vector<int> handled;
+    handled.reserve(COUNT);
+    while ((int)handled.size() < COUNT) {
+        Message message;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return !messages.empty(); });
+            message = messages.front();
+            messages.pop_front();
+        }
+        drainPending.store(false);
+        int key;
+        while (handoff.pop(key)) handled.push_back(key);
+        if (!message.wake) {
+            handled.push_back(message.key);
+            handoff.postedHandled();
+        }
+    }
+    producer.join();
+    CHECK(isSequence(handled, COUNT));
+}
+
+int main() {
+    return TestCheck::runAll("key_event_queue");
+}
@@ -0,0 +1,135 @@
+// latency_stats_test.cpp - 延遲直方圖：分格、百分位與報表
+#include "latency_stats.h"
+#include "test_check.h"
+#include <thread>
+#include <vector>
+
+using LatencyStats::Histogram;
+
+namespace {
+
+// 值所在區間的下界（前一格的上界加一）
+uint64_t lowerBound(int index) {
+    return index == 0 ? 0 : Histogram::bucketUpperBound(index - 1) + 1;
+}
+
+std::vector<uint64_t> sampleValues() {
+    std::vector<uint64_t> values;
+    for (uint64_t v = 0; v < 300; v++) values.push_back(v);
+    for (int bit = 4; bit <= 42; bit++) {
+        uint64_t power = 1ULL << bit;
+        values.push_back(power - 1);
+        values.push_back(power);
+        values.push_back(power + 1);
+        values.push_back(power + power / 3);
+    }
+    return values;
+}
+
+}
+
+TEST(bucketsCoverEveryValue) {
+    std::vector<uint64_t> values = sampleValues();
+    bool inRange = true, bounded = true, precise = true;
+    for (size_t i = 0; i < values.size(); i++) {
+        uint64_t v = values[i];
+        int index = Histogram::bucketIndex(v);
+        if (index < 0 || index >= Histogram::BUCKET_COUNT) {
+            inRange = false;
+            continue;
+        }
+        if (v >= (1ULL << (Histogram::MAX_EXPONENT + 1))) {
+            // 超過範圍：計入最後一格
+            if (index != Histogram::BUCKET_COUNT - 1) inRange = false;
+            continue;
+        }
+        if (v < lowerBound(index) || v > Histogram::bucketUpperBound(index)) bounded = false;
+        // 區間寬度不超過下界的 1/16（小於 16 的值精確）
+        uint64_t width = Histogram::bucketUpperBound(index) - lowerBound(index) + 1;
+        if (v < (uint64_t)Histogram::SUB_BUCKETS ? width != 1 : width * Histogram::SUB_BUCKETS > lowerBound(index)) {
+            precise = false;
+        }
+    }
+    CHECK(inRange);
+    CHECK(bounded);
+    CHECK(precise);
+}
+
+TEST(bucketIndexIsMonotonic) {
+    bool monotonic = true, contiguous = true;
+    int previous = Histogram::bucketIndex(0);
+    for (uint64_t v = 1; v < (1 << 16); v++) {
+        int index = Histogram::bucketIndex(v);
+        if (index < previous) monotonic = false;
+        if (index > previous + 1) contiguous = false;
+        previous = index;
+    }
+    CHECK(monotonic);
+    CHECK(contiguous);
+    for (int i = 1; i < Histogram::BUCKET_COUNT; i++) {
+        if (Histogram::bucketUpperBound(i) <= Histogram::bucketUpperBound(i - 1)) monotonic = false;
+    }
+    CHECK(monotonic);
+}
+
+TEST(percentiles) {
+    Histogram h;
+    CHECK(h.percentile(50) == 0 && h.count() == 0);
+    for (uint64_t v = 1; v <= 1000; v++) h.record(v * 1000);
+    CHECK(h.count() == 1000);
+    CHECK(h.maxValue() == 1000000);
+    // 百分位回傳區間上界：不小於真實值，誤差不超過 1/16
+    uint64_t p50 = h.percentile(50);
+    CHECK(p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+    uint64_t p99 = h.percentile(99);
+    CHECK(p99 >= 990000 && p99 <= 990000 + 990000 / 16);
+    // 最後一格的上界以觀測到的最大值為限
+    CHECK(h.percentile(100) == 1000000);
+    CHECK(h.percentile(250) == 1000000);
+    uint64_t p0 = h.percentile(0);
+    CHECK(p0 >= 1000 && p0 <= 1000 + 1000 / 16);
+
+    h.reset();
+    CHECK(h.count() == 0 && h.maxValue() == 0 && h.percentile(99) == 0);
+    h.record(7);
+    CHECK(h.percentile(50) == 7 && h.bucketCount(7) == 1);
+}
+
+TEST(concurrentRecording) {
+    static Histogram h;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([t] {
+            for (uint64_t i = 0; i < 100000; i++) h.record(i * (t + 1));
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+    uint64_t total = 0;
+    for (int i = 0; i < Histogram::BUCKET_COUNT; i++) total += h.bucketCount(i);
+    CHECK(h.count() == 400000);
+    CHECK(total == 400000);
+    CHECK(h.maxValue() == 99999 * 4);
+}
+
+TEST(stagesAndReport) {
+    LatencyStats::resetAll();
+    LatencyStats::record(LatencyStats::STAGE_PROCESS_STROKE, 2500);
+    LatencyStats::setEnabled(false);
+    LatencyStats::record(LatencyStats::STAGE_PROCESS_STROKE, 9000000);
+    LatencyStats::setEnabled(true);
+    LatencyStats::record(LatencyStats::STAGE_COUNT, 100);  // 無效階段：忽略
+    const Histogram& h = LatencyStats::histogram(LatencyStats::STAGE_PROCESS_STROKE);
+    CHECK(h.count() == 1 && h.maxValue() == 2500);
+
+    std::string report = LatencyStats::formatReport();
+    for (int i = 0; i < LatencyStats::STAGE_COUNT; i++) {
+        CHECK(report.find(LatencyStats::stageName((LatencyStats::Stage)i)) != std::string::npos);
+    }
+    CHECK(report.find("2.5") != std::string::npos);
+    LatencyStats::resetAll();
+    CHECK(h.count() == 0);
+}
+
+int main() {
+    return TestCheck::runAll("latency_stats");
+}
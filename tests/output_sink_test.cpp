@@ -0,0 +1,227 @@
+// output_sink_test.cpp - 文字輸出：代理對批次邊界、批次上限、部分接受與背景佇列
+#include "output_sink.h"
+#include "test_check.h"
+#include <chrono>
+
+using namespace TextOutput;
+
+namespace {
+
+// 假輸出端：依 limits 決定每次接受的數量（用完後全部接受），等待只記錄不休眠
+class FakeSink : public OutputSink {
+public:
+    std::wstring received;
+    std::vector<size_t> requests;
+    std::vector<size_t> limits;
+    std::vector<unsigned> waits;
+    std::wstring target;
+
+    size_t send(const wchar_t* units, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(count);
+        size_t accepted = count;
+        if (requests.size() <= limits.size() && limits[requests.size() - 1] < count) {
+            accepted = limits[requests.size() - 1];
+        }
+        received.append(units, accepted);
+        return accepted;
+    }
+
+    std::wstring targetId() { return target; }
+
+    void wait(unsigned ms) { waits.push_back(ms); }
+
+    std::mutex mutex;
+};
+
+// 含代理對的文字（以 UTF-16 單元表示，與 Windows 上的 wchar_t 相同）
+std::wstring surrogateText(int pairs, const std::wstring& prefix) {
+    std::wstring text = prefix;
+    for (int i = 0; i < pairs; i++) {
+        text += (wchar_t)0xD840;
+        text += (wchar_t)(0xDC00 + i);
+    }
+    return text;
+}
+
+bool splitsPair(const std::wstring& text, size_t end) {
+    return end > 0 && end < text.size() && (unsigned)text[end - 1] >= 0xD800 && (unsigned)text[end - 1] <= 0xDBFF;
+}
+
+}
+
+TEST(chunksNeverSplitSurrogatePairs) {
+    for (size_t prefix = 0; prefix < 3; prefix++) {
+        std::wstring text = surrogateText(10, std::wstring(prefix, L'a'));
+        for (size_t maxUnits = 1; maxUnits <= 7; maxUnits++) {
+            std::vector<std::pair<size_t, size_t>> chunks = planChunks(text, maxUnits);
+            bool contiguous = true, bounded = true, whole = true;
+            size_t pos = 0;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                if (chunks[i].first != pos || chunks[i].second <= pos) contiguous = false;
+                // 上限為 1 時代理對仍整組送出
+                if (chunks[i].second - chunks[i].first > (maxUnits == 1 ? 2 : maxUnits)) bounded = false;
+                if (splitsPair(text, chunks[i].second)) whole = false;
+                pos = chunks[i].second;
+            }
+            CHECK(contiguous && pos == text.size());
+            CHECK(bounded);
+            CHECK(whole);
+        }
+    }
+    std::wstring text = surrogateText(1, L"ab");
+    CHECK(chunkEnd(text, 0, 3) == 2);      // 高代理在第 3 個單元：整組移到下一批
+    CHECK(chunkEnd(text, 2, 1) == 4);
+    CHECK(chunkEnd(text, 0, 0) == 1);      // 上限 0 視為 1
+    CHECK(chunkEnd(text, 4, 8) == 4);
+    CHECK(planChunks(L"", 4).empty());
+}
+
+TEST(maxChunkLimitsEveryRequest) {
+    FakeSink sink;
+    PacingConfig config;
+    config.maxChunk = 5;
+    AdaptivePacer pacer(config);
+    std::wstring text(23, L'字');
+    SendResult result = sendChunked(sink, pacer, text, nullptr, nullptr);
+    CHECK(result.complete() && !result.cancelled);
+    CHECK(sink.received == text);
+    CHECK(sink.requests.size() == 5);
+    bool bounded = true;
+    for (size_t i = 0; i < sink.requests.size(); i++) bounded = bounded && sink.requests[i] <= 5;
+    CHECK(bounded);
+    // 最後一批之後不等待
+    CHECK(sink.waits.size() == 4 && sink.waits[0] == config.chunkDelayMs);
+
+    PacingConfig zero;
+    zero.maxChunk = 0;
+    AdaptivePacer single(zero);
+    CHECK(single.chunkSize() == 1);
+}
+
+TEST(partialAcceptanceIsAccounted) {
+    FakeSink sink;
+    PacingConfig config;
+    config.maxChunk = 8;
+    config.chunkDelayMs = 4;
+    config.maxDelayMs = 20;
+    AdaptivePacer pacer(config);
+    sink.limits = {3, 0, 8};
+    std::wstring text = surrogateText(4, L"0123456789");
+    std::vector<size_t> progress;
+    SendResult result = sendChunked(sink, pacer, text, nullptr,
+        [&](size_t sent, size_t total) { progress.push_back(sent); CHECK(total == 18); });
+    // 沒被接受的部分從下一個單元重送，文字不重複也不遺漏
+    CHECK(result.complete());
+    CHECK(sink.received == text);
+    CHECK(sink.requests[0] == 8 && sink.requests[1] == 4 && sink.requests[2] == 2);
+    CHECK(progress.size() == sink.requests.size());
+    CHECK(progress[0] == 3 && progress[1] == 3 && progress[2] == 5);
+    CHECK(progress.back() == 18);
+    // 被拒絕時延遲加倍（不超過上限），之後逐步降回
+    CHECK(sink.waits[0] == 8 && sink.waits[1] == 16);
+    CHECK(sink.waits[2] < 16);
+
+    // 連續 5 批完全沒被接受：放棄並回報已送出的數量
+    FakeSink stalled;
+    stalled.limits = {2, 0, 0, 0, 0, 0, 0};
+    AdaptivePacer again(config);
+    result = sendChunked(stalled, again, std::wstring(10, L'x'), nullptr, nullptr);
+    CHECK(!result.complete() && !result.cancelled);
+    CHECK(result.sent == 2 && stalled.requests.size() == 6);
+    CHECK(again.chunkSize() == 1 && again.delayMs() == 20);
+
+    std::atomic<bool> cancel(true);
+    FakeSink cancelled;
+    result = sendChunked(cancelled, again, L"abc", &cancel, nullptr);
+    CHECK(result.cancelled && result.sent == 0 && cancelled.requests.empty());
+}
+
+TEST(pacerRecovers) {
+    PacingConfig config;
+    config.maxChunk = 64;
+    config.chunkDelayMs = 4;
+    config.maxDelayMs = 200;
+    AdaptivePacer pacer(config);
+    for (int i = 0; i < 10; i++) pacer.onRejected();
+    CHECK(pacer.chunkSize() == 1 && pacer.delayMs() == 200);
+    for (int i = 0; i < 100; i++) pacer.onAccepted();
+    CHECK(pacer.chunkSize() == 64 && pacer.delayMs() == 4);
+    pacer.restore(1000, 1);
+    CHECK(pacer.chunkSize() == 64 && pacer.delayMs() == 4);
+    pacer.restore(0, 1000);
+    CHECK(pacer.chunkSize() == 1 && pacer.delayMs() == 200);
+}
+
+TEST(queueSendsInOrderBehindGate) {
+    FakeSink sink;
+    sink.target = L"Notepad";
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Progress> events;
+    OutputQueue queue(sink, [&](const Progress& p) {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(p);
+        changed.notify_all();
+    });
+    PacingConfig config;
+    config.maxChunk = 4;
+    queue.setConfig(config);
+    {
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        sink.limits = {1};
+    }
+    queue.setGated(true);
+    uint64_t first = queue.enqueue(L"abcdefgh");
+    uint64_t second = queue.enqueue(L"ijkl");
+    CHECK(second == first + 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // 閘門關閉時不送出
+    {
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        CHECK(sink.requests.empty());
+    }
+    queue.openGate();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    bool finished = changed.wait_for(lock, std::chrono::seconds(5), [&] {
+        return !events.empty() && events.back().done && events.back().jobId == second;
+    });
+    CHECK(finished);
+    CHECK(sink.received == L"abcdefghijkl");
+    CHECK(events.front().jobId == first && !events.front().done && events.front().sent == 1);
+    int doneCount = 0;
+    for (size_t i = 0; i < events.size(); i++) doneCount += events[i].done ? 1 : 0;
+    CHECK(doneCount == 2);
+    lock.unlock();
+    CHECK(queue.idle());
+    queue.shutdown();
+}
+
+TEST(queueCancelWhileGated) {
+    FakeSink sink;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Progress> events;
+    OutputQueue queue(sink, [&](const Progress& p) {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(p);
+        changed.notify_all();
+    });
+    queue.setGated(true);
+    queue.enqueue(L"waiting");
+    queue.enqueue(L"queued");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.cancelAll();
+    // 等待閘門中的工作收到取消通知，排隊中的工作直接移除
+    std::unique_lock<std::mutex> lock(mutex);
+    CHECK(changed.wait_for(lock, std::chrono::seconds(5), [&] { return !events.empty(); }));
+    CHECK(events.size() == 1 && events[0].done && events[0].cancelled && events[0].sent == 0);
+    lock.unlock();
+    CHECK(sink.received.empty());
+    CHECK(queue.idle());
+}
+
+int main() {
+    return TestCheck::runAll("output_sink");
+}
@@ -0,0 +1,227 @@
+// resource_refresh_test.cpp - 字典檔案變更偵測：只重建內容有變更的資源，只改時間的檔案不重建
+#include "resource_refresh.h"
+#include "dict_image.h"
+#include "test_check.h"
+#include "utf8_codec.h"
+#include <chrono>
+#include <fstream>
+#include <utime.h>
+
+using namespace ResourceRefresh;
+
+namespace {
+
+const char* MAIN_PATH = "core/tests/refresh_main.txt";
+const char* PUNCT_PATH = "core/tests/refresh_punct.txt";
+const char* USER_PATH = "core/tests/refresh_user.txt";
+const char* PHRASES_PATH = "core/tests/refresh_phrases.txt";
+
+// 寫出檔案並把修改時間設為 mtime（過去的時間：之後只比較大小與時間）
+void writeFile(const char* path, const std::string& content, time_t mtime) {
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+    }
+    struct utimbuf times;
+    times.actime = mtime;
+    times.modtime = mtime;
+    utime(path, &times);
+}
+
+void removeFiles() {
+    const char* paths[] = {MAIN_PATH, PUNCT_PATH, USER_PATH, PHRASES_PATH};
+    for (int i = 0; i < 4; i++) {
+        std::remove(paths[i]);
+        // 沒有內容符合空的來源：刪除所有映像檔
+        DictImage::removeStale(paths[i], DictImage::Source());
+    }
+}
+
+// 背景執行緒完成時通知；refresh 後等待並取走結果
+class Harness {
+public:
+    Harness() : ready_(0), refresher_(paths(), [this] {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_++;
+        wake_.notify_all();
+    }) {}
+
+    static Paths paths() {
+        Paths paths;
+        paths.mainDict = MAIN_PATH;
+        paths.punctMenu = PUNCT_PATH;
+        paths.userDict = USER_PATH;
+        paths.wordPhrases = PHRASES_PATH;
+        return paths;
+    }
+
+    Refresher& refresher() { return refresher_; }
+
+    bool refresh(Result& result) {
+        refresher_.refresh();
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!wake_.wait_for(lock, std::chrono::seconds(10), [this] { return ready_ > 0; })) return false;
+        ready_--;
+        return refresher_.take(result);
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    int ready_;
+    Refresher refresher_;
+};
+
+const time_t PAST = 1500000000;
+
+void writeAll() {
+    writeFile(MAIN_PATH, "一\tu\n二\tuu\n十\tui\n", PAST);
+    writeFile(PUNCT_PATH, "# 標點\n，\n。\n", PAST);
+    writeFile(USER_PATH, "詞語\t\t5\t1\n", PAST);
+    writeFile(PHRASES_PATH, "一二\n十一\n", PAST);
+}
+
+}
+
+TEST(firstRefreshRebuildsEverything) {
+    removeFiles();
+    writeAll();
+    Harness harness;
+    Result result;
+    CHECK(harness.refresh(result));
+    CHECK(result.rebuilt == RES_ALL && result.missing == 0);
+    CHECK(result.mainDict && result.mainDict->entryCount() == 3);
+    CHECK(result.mainDict->find(L"ui") != DictImage::NOT_FOUND);
+    CHECK(result.punctMenu.size() == 2 && result.punctMenu[1] == L"。");
+    CHECK(result.userDict.size() == 1 && result.userDict[0].word == L"詞語" && result.userDict[0].frequency == 5);
+    CHECK(result.wordPhrases.entryCount() == 2);
+    CHECK(harness.refresher().hashedCount() == 4 && harness.refresher().rebuiltCount() == 4);
+
+    // 沒有變更：只比較大小與時間，不讀內容
+    Result again;
+    CHECK(harness.refresh(again));
+    CHECK(again.rebuilt == 0 && again.missing == 0 && !again.mainDict);
+    CHECK(harness.refresher().hashedCount() == 4);
+    harness.refresher().retire(result);
+    removeFiles();
+}
+
+TEST(onlyChangedResourcesAreRebuilt) {
+    removeFiles();
+    writeAll();
+    Harness harness;
+    // 剛載入：記錄目前的檔案，不重建
+    harness.refresher().track(RES_ALL);
+    Result result;
+    CHECK(harness.refresh(result));
+    CHECK(result.rebuilt == 0);
+
+    // 每一種組合：只改寫 mask 中的檔案（內容依 mask 而不同），只重建這些資源，其餘沒有資料
+    const std::wstring chars = L"一二三四五六七八九十木林森火水土金";
+    unsigned rebuiltTotal = 0;
+    for (unsigned mask = 0; mask <= RES_ALL; mask++) {
+        time_t mtime = PAST + 10 * (mask + 1);
+        // 字碼表：mask + 2 個字，第 i 個字的字碼為 i + 1 個 u
+        std::wstring main;
+        for (unsigned i = 0; i < mask + 2; i++) main += chars.substr(i, 1) + L"\t" + std::wstring(i + 1, L'u') + L"\n";
+        std::string mark = std::to_string(mask);
+        // 詞語庫：「一」之後接 mask + 1 個不同的字
+        std::wstring phrases;
+        for (unsigned i = 1; i <= mask + 1; i++) phrases += L"一" + chars.substr(i, 1) + L"\n";
+        if (mask & RES_MAIN_DICT) writeFile(MAIN_PATH, Utf8Codec::encode(main), mtime);
+        if (mask & RES_PUNCT_MENU) writeFile(PUNCT_PATH, "# 標點\n，\n「" + mark + "」\n", mtime);
+        if (mask & RES_USER_DICT) writeFile(USER_PATH, "詞語\t\t" + mark + "\t1\n", mtime);
+        if (mask & RES_WORD_PHRASES) writeFile(PHRASES_PATH, Utf8Codec::encode(phrases), mtime);
+
+        CHECK(harness.refresh(result));
+        CHECK(result.rebuilt == mask && result.missing == 0);
+        if (mask & RES_MAIN_DICT) {
+            CHECK(result.mainDict && result.mainDict->entryCount() == (int)mask + 2);
+            const DictImage::Table& table = result.mainDict->table();
+            size_t last = table.find(std::wstring(mask + 2, L'u'));
+            CHECK(last != DictImage::NOT_FOUND && table.value(last, 0).str() == chars.substr(mask + 1, 1));
+        } else {
+            CHECK(!result.mainDict);
+        }
+        if (mask & RES_PUNCT_MENU) {
+            CHECK(result.punctMenu.size() == 2 && result.punctMenu[0] == L"，");
+            CHECK(result.punctMenu[1] == L"「" + std::to_wstring(mask) + L"」");
+        } else {
+            CHECK(result.punctMenu.empty());
+        }
+        if (mask & RES_USER_DICT) {
+            CHECK(result.userDict.size() == 1 && result.userDict[0].word == L"詞語");
+            CHECK(result.userDict[0].frequency == (int)mask);
+        } else {
+            CHECK(result.userDict.empty());
+        }
+        if (mask & RES_WORD_PHRASES) {
+            CHECK(result.wordPhrases.entryCount() == (int)mask + 1);
+            const DictImage::Table& table = result.wordPhrases.table();
+            size_t first = table.find(L"一");
+            CHECK(first != DictImage::NOT_FOUND && table.valueCount(first) == mask + 1);
+        } else {
+            CHECK(result.wordPhrases.entryCount() == 0);
+        }
+        for (unsigned bits = mask; bits; bits &= bits - 1) rebuiltTotal++;
+    }
+    CHECK(harness.refresher().rebuiltCount() == rebuiltTotal);
+
+    // 只改修改時間：比較內容雜湊後不重建
+    unsigned hashed = harness.refresher().hashedCount();
+    writeFile(PUNCT_PATH, "# 標點\n，\n「15」\n", PAST + 1000);
+    CHECK(harness.refresh(result));
+    CHECK(result.rebuilt == 0 && harness.refresher().hashedCount() == hashed + 1);
+    removeFiles();
+}
+
+TEST(missingFilesKeepCurrentData) {
+    removeFiles();
+    writeAll();
+    Harness harness;
+    harness.refresher().track(RES_ALL);
+    Result result;
+    CHECK(harness.refresh(result));
+
+    // 檔案被刪除：回報缺少，不重建（介面沿用目前的資料）
+    std::remove(PHRASES_PATH);
+    CHECK(harness.refresh(result));
+    CHECK(result.missing == RES_WORD_PHRASES && result.rebuilt == 0);
+    // 重新出現：即使內容與之前相同也要重建
+    writeFile(PHRASES_PATH, "一二\n十一\n", PAST);
+    CHECK(harness.refresh(result));
+    CHECK(result.missing == 0 && result.rebuilt == RES_WORD_PHRASES && result.wordPhrases.entryCount() == 2);
+
+    // 記錄時檔案不存在：之後出現就重建
+    std::remove(PUNCT_PATH);
+    harness.refresher().track(RES_PUNCT_MENU);
+    CHECK(harness.refresh(result));
+    CHECK(result.missing == RES_PUNCT_MENU && result.rebuilt == 0);
+    writeFile(PUNCT_PATH, "、\n", PAST);
+    CHECK(harness.refresh(result));
+    CHECK(result.rebuilt == RES_PUNCT_MENU && result.punctMenu.size() == 1);
+    removeFiles();
+}
+
+TEST(recentlyModifiedFileIsAlwaysCompared) {
+    removeFiles();
+    writeAll();
+    // 修改時間在記錄的那一秒之後：同一秒內可能再被修改，大小與時間相同也要比較內容
+    time_t recent = time(nullptr) + 60;
+    writeFile(USER_PATH, "甲\t\t1\t1\n", recent);
+    Harness harness;
+    harness.refresher().track(RES_USER_DICT);
+    Result result;
+    CHECK(harness.refresh(result));
+    CHECK((result.rebuilt & RES_USER_DICT) == 0);
+
+    writeFile(USER_PATH, "乙\t\t1\t1\n", recent);
+    CHECK(harness.refresh(result));
+    CHECK((result.rebuilt & RES_USER_DICT) != 0);
+    CHECK(result.userDict.size() == 1 && result.userDict[0].word == L"乙");
+    removeFiles();
+}
+
+int main() {
+    return TestCheck::runAll("resource_refresh");
+}
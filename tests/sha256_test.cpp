@@ -0,0 +1,146 @@
+// sha256_test.cpp - SHA-256：NIST 已知答案，以及資料被切在任意位置（含 64 位元組區塊邊界）時的分段計算
+#include "sha256.h"
+#include "test_check.h"
+#include <cstdlib>
+
+namespace {
+
+struct Vector {
+    std::string message;
+    const char* digest;
+};
+
+// FIPS 180-2 附錄與 NIST SHAVS 的範例
+std::vector<Vector> nistVectors() {
+    std::vector<Vector> vectors;
+    vectors.push_back({"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"});
+    vectors.push_back({"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"});
+    vectors.push_back({"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+                       "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"});
+    vectors.push_back({"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+                       "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"});
+    return vectors;
+}
+
+// 長度落在補位邊界附近的訊息：55 位元組還能放下長度，56 起需要多一個區塊
+std::string pattern(size_t length) {
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; i++) data[i] = (char)(i % 251);
+    return data;
+}
+
+std::vector<Vector> boundaryVectors() {
+    std::vector<Vector> vectors;
+    vectors.push_back({pattern(55), "463eb28e72f82e0a96c0a4cc53690c571281131f672aa229e0d45ae59b598b59"});
+    vectors.push_back({pattern(56), "da2ae4d6b36748f2a318f23e7ab1dfdf45acdc9d049bd80e59de82a60895f562"});
+    vectors.push_back({pattern(63), "29af2686fd53374a36b0846694cc342177e428d1647515f078784d69cdb9e488"});
+    vectors.push_back({pattern(64), "fdeab9acf3710362bd2658cdc9a29e8f9c757fcf9811603a8c447cd1d9151108"});
+    vectors.push_back({pattern(65), "4bfd2c8b6f1eec7a2afeb48b934ee4b2694182027e6d0fc075074f2fabb31781"});
+    vectors.push_back({pattern(119), "da18797ed7c3a777f0847f429724a2d8cd5138e6ed2895c3fa1a6d39d18f7ec6"});
+    vectors.push_back({pattern(120), "f52b23db1fbb6ded89ef42a23ce0c8922c45f25c50b568a93bf1c075420bbb7c"});
+    vectors.push_back({pattern(128), "471fb943aa23c511f6f72f8d1652d9c880cfa392ad80503120547703e56a2be5"});
+    vectors.push_back({pattern(1000), "4e4c294b331f7a2099a379bec34b9f9fc03dc46ab465d998f4d683da53487e6d"});
+    return vectors;
+}
+
+std::string hashInChunks(Sha256::Hasher& hasher, const std::string& data, const std::vector<size_t>& cuts) {
+    hasher.reset();
+    size_t pos = 0;
+    for (size_t i = 0; i <= cuts.size(); i++) {
+        size_t end = i < cuts.size() ? cuts[i] : data.size();
+        hasher.update(data.data() + pos, end - pos);
+        pos = end;
+    }
+    return hasher.finishHex();
+}
+
+}
+
+TEST(nistKnownAnswers) {
+    std::vector<Vector> vectors = nistVectors();
+    for (size_t i = 0; i < vectors.size(); i++) {
+        CHECK(Sha256::digestHex(vectors[i].message) == vectors[i].digest);
+    }
+    // 一百萬個 'a'
+    CHECK(Sha256::digestHex(std::string(1000000, 'a')) ==
+          "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    std::vector<Vector> boundary = boundaryVectors();
+    for (size_t i = 0; i < boundary.size(); i++) {
+        CHECK(Sha256::digestHex(boundary[i].message) == boundary[i].digest);
+    }
+}
+
+TEST(everySplitPointGivesSameDigest) {
+    std::vector<Vector> vectors = nistVectors();
+    std::vector<Vector> boundary = boundaryVectors();
+    vectors.insert(vectors.end(), boundary.begin(), boundary.end());
+
+    Sha256::Hasher hasher;
+    for (size_t v = 0; v < vectors.size(); v++) {
+        const std::string& data = vectors[v].message;
+        bool ok = true;
+        // 切成兩段：每個位置，含 0 與結尾（空的 update）
+        for (size_t cut = 0; cut <= data.size() && ok; cut++) {
+            ok = hashInChunks(hasher, data, std::vector<size_t>(1, cut)) == vectors[v].digest;
+        }
+        // 切成三段：第一段跨過區塊邊界附近的每個位置
+        for (size_t a = 0; a <= data.size() && a <= 70 && ok; a++) {
+            for (size_t b = a; b <= data.size() && b <= a + 70 && ok; b++) {
+                std::vector<size_t> cuts;
+                cuts.push_back(a);
+                cuts.push_back(b);
+                ok = hashInChunks(hasher, data, cuts) == vectors[v].digest;
+            }
+        }
+        // 每次一個位元組
+        std::vector<size_t> bytes;
+        for (size_t i = 1; i < data.size(); i++) bytes.push_back(i);
+        ok = ok && hashInChunks(hasher, data, bytes) == vectors[v].digest;
+        if (!ok) {
+            printf("  第 %u 組（%u 位元組）分段結果不一致\n", (unsigned)v, (unsigned)data.size());
+            CHECK(false);
+        }
+    }
+}
+
+TEST(randomChunksOfLongMessage) {
+    std::string data(1000000, 'a');
+    Sha256::Hasher hasher;
+    for (unsigned seed = 1; seed <= 20; seed++) {
+        srand(seed);
+        std::vector<size_t> cuts;
+        size_t pos = 0;
+        for (;;) {
+            // 下載的區塊大小不固定：小塊、剛好一個區塊、大塊都會出現
+            size_t step = rand() % 3 == 0 ? 64 : (size_t)(rand() % (seed * 5000)) + 1;
+            pos += step;
+            if (pos >= data.size()) break;
+            cuts.push_back(pos);
+        }
+        if (hashInChunks(hasher, data, cuts) != "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0") {
+            printf("  種子 %u 不一致\n", seed);
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+TEST(resetAllowsReuse) {
+    Sha256::Hasher hasher;
+    hasher.update("ab", 2);
+    hasher.update("c", 1);
+    CHECK(hasher.finishHex() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    // reset 清除先前的內容與長度
+    hasher.reset();
+    CHECK(hasher.finishHex() == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    hasher.reset();
+    hasher.update("xyz", 3);
+    hasher.reset();
+    hasher.update("abc", 3);
+    CHECK(hasher.finishHex() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+int main() {
+    return TestCheck::runAll("sha256");
+}
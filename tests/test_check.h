@@ -0,0 +1,67 @@
+// test_check.h - 單元測試的檢查巨集與執行（可攜式，不依賴 Windows API）
+//
+// 每個測試檔是一個程式：以 TEST 定義測試，main 呼叫 TestCheck::runAll；
+// 檢查失敗時印出位置並繼續，最後有任何失敗時回傳 1（make test 依此停止）
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <cstdio>
+#include <vector>
+
+namespace TestCheck {
+    typedef void (*TestFunc)();
+
+    struct Entry {
+        const char* name;
+        TestFunc func;
+    };
+
+    inline std::vector<Entry>& registry() {
+        static std::vector<Entry> tests;
+        return tests;
+    }
+
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline int& checks() {
+        static int count = 0;
+        return count;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, TestFunc func) {
+            Entry entry = {name, func};
+            registry().push_back(entry);
+        }
+    };
+
+    inline void check(bool ok, const char* expr, const char* file, int line) {
+        checks()++;
+        if (ok) return;
+        failures()++;
+        fprintf(stderr, "%s:%d: 檢查失敗：%s\n", file, line, expr);
+    }
+
+    // 依定義的順序執行所有測試
+    inline int runAll(const char* suite) {
+        for (size_t i = 0; i < registry().size(); i++) {
+            int before = failures();
+            registry()[i].func();
+            if (failures() != before) fprintf(stderr, "  %s：%s 失敗\n", suite, registry()[i].name);
+        }
+        printf("%s：%zu 個測試、%d 項檢查、%d 項失敗\n", suite, registry().size(), checks(), failures());
+        return failures() ? 1 : 0;
+    }
+}
+
+#define TEST(name) \
+    static void name(); \
+    static TestCheck::Registrar name##_registrar(#name, name); \
+    static void name()
+
+#define CHECK(expr) TestCheck::check((expr), #expr, __FILE__, __LINE__)
+
+#endif // TEST_CHECK_H
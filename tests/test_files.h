@@ -0,0 +1,28 @@
+// test_files.h - 單元測試共用的檔案讀寫：以二進位讀出、寫入與檢查 core/tests/ 下的暫存檔
+#ifndef TEST_FILES_H
+#define TEST_FILES_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace TestFiles {
+    // 讀出整個檔案；不存在時回傳空字串
+    inline std::string readBytes(const std::string& path) {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        std::ostringstream out;
+        out << file.rdbuf();
+        return out.str();
+    }
+
+    inline void writeBytes(const std::string& path, const std::string& bytes) {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), (std::streamsize)bytes.size());
+    }
+
+    inline bool exists(const std::string& path) {
+        return std::ifstream(path.c_str()).good();
+    }
+}
+
+#endif // TEST_FILES_H
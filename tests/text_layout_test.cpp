@@ -0,0 +1,181 @@
+// text_layout_test.cpp - 排版：寬度快取失效與增量換行索引必須與整份重排一致
+#include "text_layout.h"
+#include "test_check.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+// 固定寬度的假度量：ASCII 為 scale 像素，其餘為兩倍，零寬字元為 0
+class FixedMetrics : public TextMetrics {
+public:
+    explicit FixedMetrics(int scale) : scale(scale), queries(0) {}
+    int advance(wchar_t ch) {
+        queries++;
+        if (ch == 0x200B) return 0;
+        return ch < 0x80 ? scale : scale * 2;
+    }
+    int lineHeight() { return scale * 2; }
+    int scale;
+    int queries;
+};
+
+// 以貪婪規則直接算出的行起點
+std::vector<size_t> greedyLines(const std::wstring& text, FixedMetrics& metrics, int width) {
+    std::vector<size_t> starts(1, 0);
+    int x = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        int w = metrics.advance(text[i]);
+        if (x > 0 && x + w > width) {
+            starts.push_back(i);
+            x = 0;
+        }
+        x += w;
+    }
+    return starts;
+}
+
+std::vector<size_t> allLines(TextLayout& layout, const TextModel& text) {
+    std::vector<size_t> starts;
+    size_t count = layout.lineCount(text);
+    for (size_t i = 0; i < count; i++) starts.push_back(layout.lineStart(text, i));
+    return starts;
+}
+
+std::wstring randomText(std::mt19937& rng, size_t maxLen) {
+    static const wchar_t ALPHABET[] = L"ab字詞\x200B ";
+    std::wstring text;
+    size_t len = rng() % (maxLen + 1);
+    for (size_t i = 0; i < len; i++) text += ALPHABET[rng() % 6];
+    return text;
+}
+
+// 比對增量排版與全新排版的行起點、位置與座標換算
+bool sameAsFullLayout(TextLayout& layout, const TextModel& text, FixedMetrics& metrics, int width,
+                      std::mt19937& rng) {
+    TextLayout full;
+    full.setMetrics(&metrics);
+    full.setWidth(width);
+    std::vector<size_t> expected = allLines(full, text);
+    if (expected != greedyLines(text.str(), metrics, width)) return false;
+
+    // 先做部分查詢（延遲排版只排到需要的位置），再比對整份
+    for (int i = 0; i < 3; i++) {
+        size_t pos = rng() % (text.length() + 1);
+        if (layout.lineForPosition(text, pos) != full.lineForPosition(text, pos)) return false;
+        LayoutPoint a = layout.pointFromPosition(text, pos);
+        LayoutPoint b = full.pointFromPosition(text, pos);
+        if (a.x != b.x || a.y != b.y) return false;
+        int x = (int)(rng() % (width + 20)) - 10;
+        int y = (int)(rng() % (expected.size() * metrics.lineHeight() + 20)) - 10;
+        if (layout.positionFromPoint(text, x, y) != full.positionFromPoint(text, x, y)) return false;
+    }
+    if (layout.hasLines(text, 3) != (expected.size() >= 3)) return false;
+    return allLines(layout, text) == expected;
+}
+
+}
+
+TEST(incrementalEditsMatchFullRelayout) {
+    FixedMetrics metrics(8);
+    const int width = 100;
+    for (uint32_t seed = 1; seed <= 30; seed++) {
+        std::mt19937 rng(seed);
+        TextModel text(randomText(rng, 600));
+        TextLayout layout;
+        layout.setMetrics(&metrics);
+        layout.setWidth(width);
+        bool same = true;
+        for (int step = 0; step < 150 && same; step++) {
+            // 編輯前只排一部分，讓編輯有時落在尚未排版的區域
+            if (rng() % 2) layout.lineStart(text, rng() % 8);
+            size_t pos = rng() % (text.length() + 1);
+            size_t removed = rng() % 3 == 0 ? 0 : std::min<size_t>(rng() % 12, text.length() - pos);
+            std::wstring inserted = rng() % 3 == 0 ? std::wstring() : randomText(rng, 40);
+            text.erase(pos, removed);
+            text.insert(pos, inserted);
+            layout.onEdit(text, pos, removed, inserted.size());
+            if (rng() % 3 == 0) same = sameAsFullLayout(layout, text, metrics, width, rng);
+        }
+        same = same && sameAsFullLayout(layout, text, metrics, width, rng);
+        if (!same) {
+            printf("  種子 %u 不一致\n", seed);
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+TEST(editReusesOldLines) {
+    FixedMetrics metrics(10);
+    TextLayout layout;
+    layout.setMetrics(&metrics);
+    layout.setWidth(100);
+    TextModel text(std::wstring(5000, L'a'));
+    CHECK(layout.lineCount(text) == 500);
+    size_t before = layout.charsLaidOut();
+    // 同長度的取代：行起點不變，只重排附近幾行
+    text.erase(2500, 1);
+    text.insert(2500, L"b");
+    layout.onEdit(text, 2500, 1, 1);
+    CHECK(layout.charsLaidOut() - before <= 40);
+    CHECK(layout.lineCount(text) == 500);
+    // 插入讓其後各行位移：立即只重排一小段，其餘延遲到需要時
+    before = layout.charsLaidOut();
+    text.insert(10, L"x");
+    layout.onEdit(text, 10, 0, 1);
+    CHECK(layout.charsLaidOut() - before <= 400);
+    CHECK(layout.lineStart(text, 1) == 10 && layout.lineStart(text, 2) == 20);
+    CHECK(layout.lineCount(text) == 501);
+
+    // 與文字不一致的通知：捨棄排版，下次使用時整份重排
+    layout.onEdit(text, 0, 0, 5);
+    CHECK(!layout.valid());
+    CHECK(layout.lineCount(text) == 501);
+    // 長度在排版之外改變：ensure 發現不一致而重排
+    text.append(L"aaaaaaaaaa");
+    CHECK(layout.lineCount(text) == 502);
+}
+
+TEST(advanceCacheInvalidation) {
+    FixedMetrics narrow(8);
+    FixedMetrics wide(12);
+    TextLayout layout;
+    layout.setMetrics(&narrow);
+    layout.setWidth(96);
+    TextModel text(L"abab字字ab\x200B字");
+    std::vector<size_t> lines = allLines(layout, text);
+    CHECK(lines == greedyLines(text.str(), narrow, 96));
+    // 每個不同的字元只查詢一次
+    CHECK(layout.metricsQueries() == 4);
+    narrow.queries = 0;
+    allLines(layout, text);
+    layout.pointFromPosition(text, text.length());
+    CHECK(narrow.queries == 0);
+
+    // 更換度量：快取清除，寬度改用新的度量
+    layout.setMetrics(&wide);
+    CHECK(!layout.valid() && layout.lineHeight() == 24);
+    lines = allLines(layout, text);
+    CHECK(layout.advance(L'a') == 12 && layout.advance(L'字') == 24);
+    CHECK(wide.queries == 4);
+    CHECK(lines == greedyLines(text.str(), wide, 96));
+    LayoutPoint second = layout.pointFromPosition(text, 7);
+    CHECK(second.x == 12 && second.y == 24);
+
+    // 寬度改變：需要重排
+    layout.setWidth(1000);
+    CHECK(!layout.valid());
+    CHECK(layout.lineCount(text) == 1);
+    layout.setWidth(1000);
+    CHECK(layout.valid());
+
+    // 單一字元比可用寬度還寬時仍自成一行；行首的零寬字元與下一個字同行
+    layout.setWidth(10);
+    CHECK(allLines(layout, text) == greedyLines(text.str(), wide, 10));
+    CHECK(layout.lineCount(text) == 9);
+}
+
+int main() {
+    return TestCheck::runAll("text_layout");
+}
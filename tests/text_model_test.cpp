@@ -0,0 +1,182 @@
+// text_model_test.cpp - 片段表與 std::wstring 的隨機差異測試
+#include "text_model.h"
+#include "test_check.h"
+#include <random>
+
+namespace {
+
+// 依修改通知重建內容：必須與模型本身一致
+class MirrorObserver : public TextModel::Observer {
+public:
+    std::wstring text;
+    void onInsert(size_t pos, const wchar_t* data, size_t count) { text.insert(pos, data, count); }
+    void onErase(size_t pos, size_t count) { text.erase(pos, count); }
+    void onReset(const TextModel& model) { text = model.str(); }
+};
+
+std::wstring randomText(std::mt19937& rng, size_t maxLen) {
+    static const wchar_t ALPHABET[] = L"abc字詞語\n\t ";
+    std::wstring text;
+    size_t len = rng() % (maxLen + 1);
+    for (size_t i = 0; i < len; i++) text += ALPHABET[rng() % (sizeof(ALPHABET) / sizeof(wchar_t) - 1)];
+    return text;
+}
+
+std::wstring readAll(const TextModel& model, size_t pos, size_t count) {
+    std::wstring out;
+    TextModel::Reader reader(model, pos, count);
+    wchar_t ch;
+    while (reader.next(ch)) out += ch;
+    return out;
+}
+
+std::wstring visitAll(const TextModel& model, size_t pos, size_t count) {
+    std::wstring out;
+    model.forEachChunk(pos, count, [&out](const wchar_t* data, size_t n) { out.append(data, n); });
+    return out;
+}
+
+// 比對模型與參考字串的所有讀取方式；不一致時回傳 false
+bool sameContent(const TextModel& model, const std::wstring& expected, std::mt19937& rng) {
+    if (model.length() != expected.size() || model.empty() != expected.empty()) return false;
+    if (model.str() != expected) return false;
+    for (int i = 0; i < 4; i++) {
+        size_t pos = rng() % (expected.size() + 2);
+        size_t count = (rng() % 3 == 0) ? TextModel::npos : rng() % (expected.size() + 2);
+        std::wstring want = pos <= expected.size() ? expected.substr(pos, count) : std::wstring();
+        if (model.substr(pos, count) != want) return false;
+        if (readAll(model, pos, count) != want) return false;
+        if (visitAll(model, pos, count) != want) return false;
+        if (pos < expected.size() && model[pos] != expected[pos]) return false;
+    }
+    return true;
+}
+
+}
+
+TEST(randomEditsMatchWstring) {
+    for (uint32_t seed = 1; seed <= 40; seed++) {
+        std::mt19937 rng(seed);
+        TextModel model;
+        MirrorObserver mirror;
+        model.setObserver(&mirror);
+        std::wstring expected;
+        bool same = true;
+        for (int step = 0; step < 400 && same; step++) {
+            unsigned op = rng() % 100;
+            if (op < 45) {
+                // 插入（位置可超出結尾：視為附加）
+                size_t pos = rng() % (expected.size() + 3);
+                std::wstring text = randomText(rng, 6);
+                model.insert(pos, text);
+                expected.insert(pos > expected.size() ? expected.size() : pos, text);
+            } else if (op < 80) {
+                size_t pos = rng() % (expected.size() + 2);
+                size_t count = (rng() % 8 == 0) ? TextModel::npos : rng() % 10;
+                model.erase(pos, count);
+                if (pos < expected.size()) expected.erase(pos, count);
+            } else if (op < 90) {
+                // 連續輸入：在上一次插入的結尾繼續
+                size_t pos = rng() % (expected.size() + 1);
+                for (int i = 0; i < 5; i++) {
+                    std::wstring text = randomText(rng, 2);
+                    model.insert(pos, text);
+                    expected.insert(pos, text);
+                    pos += text.size();
+                }
+            } else if (op < 94) {
+                std::wstring text = randomText(rng, 30);
+                if (rng() % 2) {
+                    model = text;
+                } else {
+                    std::wstring moved = text;
+                    model = std::move(moved);
+                }
+                expected = text;
+            } else if (op < 97) {
+                // 複製與交換：副本獨立，修改副本不影響原模型
+                TextModel copy(model);
+                copy.insert(0, L"副本");
+                copy.erase(copy.length() / 2, 3);
+                TextModel other(randomText(rng, 10));
+                std::wstring otherText = other.str();
+                other.swap(copy);
+                copy.swap(other);
+                same = same && other.str() == otherText && copy.observer() == nullptr;
+            } else if (op < 98) {
+                model.clear();
+                expected.clear();
+            } else {
+                model.append(L"尾");
+                expected += L"尾";
+            }
+            same = same && sameContent(model, expected, rng) && mirror.text == expected;
+        }
+        if (!same) {
+            printf("  種子 %u 不一致\n", seed);
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+TEST(typingExtendsLastPiece) {
+    TextModel model(L"原始文字");
+    CHECK(model.pieceCount() == 1);
+    model.insert(2, L"a");
+    CHECK(model.pieceCount() == 3);
+    for (int i = 0; i < 100; i++) model.insert(3 + i, L"b");
+    CHECK(model.pieceCount() == 3);
+    CHECK(model.length() == 105);
+    CHECK(model.substr(0, 4) == L"原始ab");
+    model.erase(0);
+    CHECK(model.empty() && model.pieceCount() == 0);
+    CHECK(model.substr(0) == L"");
+    model.insert(10, L"x");
+    CHECK(model.str() == L"x");
+}
+
+TEST(largeDocument) {
+    std::mt19937 rng(99);
+    std::wstring expected;
+    for (int i = 0; i < 20000; i++) expected += (wchar_t)(L'一' + i % 500);
+    TextModel model;
+    std::wstring source = expected;
+    model = std::move(source);
+    for (int i = 0; i < 5000; i++) {
+        size_t pos = rng() % (expected.size() + 1);
+        if (rng() % 2) {
+            model.insert(pos, L"插");
+            expected.insert(pos, L"插");
+        } else if (pos < expected.size()) {
+            model.erase(pos, 2);
+            expected.erase(pos, 2);
+        }
+    }
+    CHECK(model.str() == expected);
+    CHECK(readAll(model, 0, TextModel::npos) == expected);
+    bool indexed = true;
+    for (int i = 0; i < 1000; i++) {
+        size_t pos = rng() % expected.size();
+        indexed = indexed && model[pos] == expected[pos];
+    }
+    CHECK(indexed);
+
+    // 排版以小段讀取（每段只查詢重疊的片段）：在數千個片段中任意位置讀取都與參考字串相同
+    CHECK(model.pieceCount() > 1000);
+    bool blocks = true;
+    for (int i = 0; i < 200; i++) {
+        size_t pos = rng() % expected.size();
+        blocks = blocks && readAll(model, pos, 256) == expected.substr(pos, 256);
+    }
+    CHECK(blocks);
+    TextModel::Reader reader(model, expected.size() - 1, 5);
+    wchar_t ch;
+    CHECK(!reader.atEnd() && reader.next(ch) && ch == expected.back());
+    CHECK(reader.atEnd() && !reader.next(ch));
+    CHECK(TextModel::Reader(model, expected.size()).atEnd());
+}
+
+int main() {
+    return TestCheck::runAll("text_model");
+}
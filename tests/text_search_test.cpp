@@ -0,0 +1,186 @@
+// text_search_test.cpp - 搜尋與逐字元暴力比對的隨機差異測試（跨片段邊界、重疊相符、稀疏索引）
+#include "text_search.h"
+#include "test_check.h"
+#include <random>
+
+using namespace TextSearch;
+
+namespace {
+
+// 暴力搜尋：[from, to) 內所有相符起點（可重疊）
+std::vector<size_t> bruteAll(const std::wstring& text, const std::wstring& needle, size_t from, size_t to) {
+    std::vector<size_t> out;
+    if (to > text.size()) to = text.size();
+    if (needle.empty()) return out;
+    for (size_t i = from; i + needle.size() <= to; i++) {
+        if (text.compare(i, needle.size(), needle) == 0) out.push_back(i);
+    }
+    return out;
+}
+
+// 由左至右取不重疊的相符
+std::vector<size_t> greedy(const std::vector<size_t>& all, size_t m) {
+    std::vector<size_t> out;
+    for (size_t i = 0; i < all.size(); i++) {
+        if (out.empty() || all[i] >= out.back() + m) out.push_back(all[i]);
+    }
+    return out;
+}
+
+// 字母很少，重疊與跨片段的相符經常出現
+std::wstring randomText(std::mt19937& rng, size_t maxLen) {
+    static const wchar_t ALPHABET[] = L"aab字字詞";
+    std::wstring text;
+    size_t len = rng() % (maxLen + 1);
+    for (size_t i = 0; i < len; i++) text += ALPHABET[rng() % 6];
+    return text;
+}
+
+// 以隨機插入與刪除產生多片段的模型
+void randomEdits(std::mt19937& rng, TextModel& model, std::wstring& expected, int steps) {
+    for (int i = 0; i < steps; i++) {
+        size_t pos = rng() % (expected.size() + 1);
+        if (rng() % 3 == 0 && pos < expected.size()) {
+            size_t count = rng() % 5;
+            model.erase(pos, count);
+            expected.erase(pos, count);
+        } else {
+            std::wstring text = randomText(rng, 8);
+            model.insert(pos, text);
+            expected.insert(pos, text);
+        }
+    }
+}
+
+bool sameSearch(const TextModel& model, const std::wstring& text, const std::wstring& needle, std::mt19937& rng) {
+    Pattern pattern(needle);
+    size_t n = text.size();
+    std::vector<size_t> all = bruteAll(text, needle, 0, n);
+    std::vector<size_t> nonOverlapping = greedy(all, needle.size());
+    if (countMatches(model, pattern) != nonOverlapping.size()) return false;
+
+    for (int i = 0; i < 6; i++) {
+        size_t from = rng() % (n + 2);
+        size_t to = from + rng() % (n + 2);
+        // 可重疊的全部相符
+        std::vector<size_t> visited;
+        forEachMatch(model, pattern, from, to, [&visited](size_t pos) {
+            visited.push_back(pos);
+            return true;
+        });
+        if (visited != bruteAll(text, needle, std::min(from, n), to)) return false;
+
+        std::vector<size_t> found;
+        findAll(model, pattern, from, to, found);
+        if (found != greedy(bruteAll(text, needle, std::min(from, n), to), needle.size())) return false;
+
+        // 往後與往前搜尋
+        size_t next = TextModel::npos;
+        for (size_t k = 0; k < all.size(); k++) {
+            if (all[k] >= from) { next = all[k]; break; }
+        }
+        if (findNext(model, pattern, from) != next) return false;
+        size_t prev = TextModel::npos;
+        for (size_t k = 0; k < all.size() && all[k] < from; k++) prev = all[k];
+        if (findPrev(model, pattern, from) != (needle.empty() ? TextModel::npos : prev)) return false;
+    }
+    return true;
+}
+
+}
+
+TEST(randomSearchesMatchBruteForce) {
+    static const wchar_t* NEEDLES[] = {L"a", L"字", L"aa", L"ab字", L"字字", L"a字詞b", L"aabaab", L"字字字字字", L""};
+    for (uint32_t seed = 1; seed <= 30; seed++) {
+        std::mt19937 rng(seed);
+        TextModel model;
+        std::wstring expected;
+        bool same = true;
+        for (int round = 0; round < 20 && same; round++) {
+            randomEdits(rng, model, expected, 10);
+            same = model.str() == expected;
+            for (size_t k = 0; k < sizeof(NEEDLES) / sizeof(NEEDLES[0]) && same; k++) {
+                same = sameSearch(model, expected, NEEDLES[k], rng);
+            }
+            // 文字中取出的片段（長度可達數十字，走 Horspool 路徑）
+            if (same && !expected.empty()) {
+                size_t pos = rng() % expected.size();
+                same = sameSearch(model, expected, expected.substr(pos, 4 + rng() % 40), rng);
+            }
+        }
+        if (!same) {
+            printf("  種子 %u 不一致\n", seed);
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+TEST(findPrevBeyondBackwardWindow) {
+    // 唯一的相符在游標前很遠處：需要放大搜尋範圍
+    std::wstring text = L"目標" + std::wstring(50000, L'a');
+    TextModel model(text);
+    model.insert(30000, L"b");
+    Pattern pattern(L"目標");
+    CHECK(findPrev(model, pattern, model.length()) == 0);
+    CHECK(findPrev(model, pattern, 1) == 0);
+    CHECK(findPrev(model, pattern, 0) == TextModel::npos);
+    CHECK(findNext(model, pattern, 1) == TextModel::npos);
+    std::vector<size_t> limited;
+    findAll(model, Pattern(L"aa"), 0, model.length(), limited, 3);
+    CHECK(limited.size() == 3 && limited[2] == 6);
+}
+
+TEST(matchIndexCountsMatchFindAll) {
+    for (uint32_t seed = 1; seed <= 10; seed++) {
+        std::mt19937 rng(seed);
+        TextModel model;
+        std::wstring expected;
+        randomEdits(rng, model, expected, 600);
+        bool same = true;
+        static const wchar_t* NEEDLES[] = {L"a", L"aa", L"字", L"a字"};
+        for (size_t k = 0; k < 4 && same; k++) {
+            Pattern pattern(NEEDLES[k]);
+            MatchIndex index;
+            same = !index.current(model, pattern);
+            index.build(model, pattern);
+            same = same && index.current(model, pattern) && index.count() == countMatches(model, pattern);
+            // 每個位置之前的相符數（包含落在記錄位置與相符中間的位置）
+            std::vector<size_t> prefix;
+            for (size_t to = 0; to <= expected.size() + 1 && same; to += 1 + rng() % 7) {
+                findAll(model, pattern, 0, to, prefix);
+                same = index.countBefore(model, pattern, to) == prefix.size();
+            }
+            same = same && index.countBefore(model, pattern, expected.size()) == index.count();
+        }
+        if (!same) {
+            printf("  種子 %u 不一致\n", seed);
+            CHECK(false);
+            break;
+        }
+    }
+}
+
+TEST(matchIndexGoesStaleOnEdit) {
+    TextModel model(std::wstring(1000, L'a'));
+    Pattern pattern(L"aa");
+    MatchIndex index;
+    index.build(model, pattern);
+    CHECK(index.count() == 500);
+    CHECK(index.countBefore(model, pattern, 200) == 100);
+    // 修改文字、換搜尋字串或清除後都需要重建
+    model.insert(1, L"b");
+    CHECK(!index.current(model, pattern));
+    index.build(model, pattern);
+    CHECK(index.current(model, pattern) && index.count() == 499);
+    CHECK(index.countBefore(model, pattern, 201) == 99);
+    CHECK(!index.current(model, Pattern(L"a")));
+    model = std::wstring(L"aaaa");
+    CHECK(!index.current(model, pattern));
+    index.clear();
+    CHECK(!index.current(model, pattern) && index.count() == 0);
+}
+
+int main() {
+    return TestCheck::runAll("text_search");
+}
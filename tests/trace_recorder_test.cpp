@@ -0,0 +1,175 @@
+// trace_recorder_test.cpp - 錄製按鍵軌跡、重播到引擎核心並比對輸出
+#include "trace_recorder.h"
+#include "trace_replay.h"
+#include "engine_core.h"
+#include "test_check.h"
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+using namespace TraceRecorder;
+
+namespace {
+
+const char* TRACE_PATH = "core/tests/trace_recorder_test.txt";
+
+void loadModel(EngineCore::Model& model) {
+    DictFiles::CodeTable table;
+    table[L"u"] = {L"一", L"二"};
+    table[L"ui"] = {L"十", L"一"};
+    table[L"uio"] = {L"木"};
+    table[L"uj"] = {L"下"};
+    table[L"ujk"] = {L"天"};
+    table[L"uuu"] = {L"三", L"三角"};
+    // 以 k 結尾的字碼超過一頁：「*k」的候選字可以翻頁
+    const wchar_t* pageCodes[] = {L"ik", L"ok", L"jk", L"kk", L"uk", L"iik", L"iok", L"ijk", L"ikk", L"uok"};
+    for (int i = 0; i < 10; i++) table[pageCodes[i]] = {std::wstring(1, (wchar_t)(L'甲' + i))};
+    model.dict.publish(DictModel::build(table, 19));
+    DictFiles::CodeTable phrases;
+    phrases[L"木"] = {L"頭", L"材"};
+    model.wordPhrases = DictModel::buildPhrases(phrases, 2);
+}
+
+// 共用的無視窗前端：每次查詢或聯想後的候選字依序記在 log，用來比對兩次執行
+class LoggingFrontend : public TraceReplay::Frontend {
+public:
+    LoggingFrontend(const EngineCore::Model& model, time_t now) : Frontend(model, now) {}
+
+    std::wstring log;
+
+    std::wstring text() const { return buffer().str(); }
+
+    std::wstring learned() const {
+        std::wstring out;
+        std::map<std::wstring, EngineCore::WordInfo>::const_iterator it;
+        for (it = learning().wordFreq.begin(); it != learning().wordFreq.end(); ++it) {
+            out += it->first + L"=" + std::to_wstring(it->second.frequency) + L";";
+        }
+        return out;
+    }
+
+protected:
+    void candidatesChanged() {
+        log += session().input + L":";
+        for (size_t i = 0; i < session().candidates.size(); i++) log += session().candidates[i] + L",";
+        log += L"\n";
+    }
+};
+
+void session(LoggingFrontend& ime) {
+    ime.sync(SYNC_CHINESE_MODE | SYNC_BUFFER_MODE, 1, L"前\t後\\行\n");
+    ime.processStroke('U');
+    ime.processStroke('I');
+    ime.processStroke('O');
+    ime.selectCandidate(0);         // 木，接著聯想「頭」「材」
+    ime.selectCandidate(1);         // 材（聯想選字）
+    ime.processStroke('U');
+    ime.processStroke('J');
+    ime.backspaceInput();
+    ime.processStroke('U');
+    ime.processStroke('U');
+    ime.selectCandidate(1);         // 三角
+    ime.cancelInput();
+    ime.processStroke('L');
+    ime.processStroke('K');
+    ime.changePage(1);
+    ime.selectCandidate(0);         // 第二頁的第一個
+    ime.deleteCharAtCursor(false);
+    ime.moveCursor(-2);
+    ime.deleteCharAtCursor(true);
+    ime.toggleInputMode();
+    ime.processStroke('U');         // 英文模式：忽略，不記錄
+    ime.toggleInputMode();
+    for (int i = 0; i < 5; i++) {
+        ime.processStroke('U');
+        ime.selectCandidate(0);
+    }
+}
+
+}
+
+TEST(recordThenReplayMatchesLiveRun) {
+    EngineCore::Model model;
+    loadModel(model);
+    time_t now = time(nullptr);
+
+    LoggingFrontend live(model, now);
+    CHECK(start(TRACE_PATH));
+    CHECK(isRecording());
+    session(live);
+    uint32_t recorded = recordedCount();
+    stop();
+    CHECK(!isRecording());
+    // 巢狀操作（選字內的插入）只記外層；英文模式下的筆劃不記錄
+    CHECK(recorded == 32);
+
+    std::vector<TraceEvent> events;
+    CHECK(loadTrace(TRACE_PATH, events));
+    CHECK(events.size() == recorded);
+    CHECK(events[0].type == EVT_SYNC && events[0].text == L"前\t後\\行\n");
+    CHECK(events[1].type == EVT_STROKE && events[1].arg1 == 'U');
+
+    LoggingFrontend first(model, now);
+    ReplayResult result;
+    replay(events, first, result);
+    CHECK(result.eventCount == recorded);
+    CHECK(result.latency.count() == recorded);
+    CHECK(result.allocCount > 0);
+    CHECK(!isReplaying());
+    CHECK(first.text() == live.text() && first.cursor() == live.cursor());
+    CHECK(first.log == live.log);
+    CHECK(first.learned() == live.learned());
+    CHECK(first.text().find(L"木材") != std::wstring::npos);
+
+    // 重播是確定性的：從同一份軌跡再重播一次得到相同的輸出
+    LoggingFrontend second(model, now);
+    replay(events, second, result);
+    CHECK(second.text() == first.text() && second.log == first.log);
+    CHECK(second.learned() == first.learned());
+    CHECK(formatResult(result).find("events") != std::string::npos);
+}
+
+TEST(replayDoesNotRecord) {
+    EngineCore::Model model;
+    loadModel(model);
+    std::vector<TraceEvent> events;
+    TraceEvent ev;
+    ev.type = EVT_STROKE;
+    ev.arg1 = 'U';
+    events.push_back(ev);
+
+    CHECK(start(TRACE_PATH));
+    LoggingFrontend ime(model, 0);
+    ReplayResult result;
+    replay(events, ime, result);
+    CHECK(recordedCount() == 0);
+    ime.processStroke('I');
+    CHECK(recordedCount() == 1);
+    stop();
+    CHECK(ime.session().input == L"ui");
+}
+
+TEST(loadSkipsMalformedLines) {
+    {
+        std::ofstream file(TRACE_PATH, std::ios::binary);
+        file << "# stroke-ime trace v1\r\n"
+             << "5\tSTROKE\t85\t0\t\r\n"
+             << "6\tNO_SUCH_EVENT\t1\t2\t\n"
+             << "garbage\n"
+             << "\n"
+             << "7\tBUFFER_INSERT\t0\t0\ta\\tb\n"
+             << "8\tPAGE\t-1\t0\n";
+    }
+    std::vector<TraceEvent> events;
+    CHECK(loadTrace(TRACE_PATH, events));
+    CHECK(events.size() == 3);
+    CHECK(events[0].timeMs == 5 && events[0].type == EVT_STROKE && events[0].arg1 == 85);
+    CHECK(events[1].type == EVT_BUFFER_INSERT && events[1].text == L"a\tb");
+    CHECK(events[2].type == EVT_PAGE && events[2].arg1 == -1 && events[2].text.empty());
+    std::remove(TRACE_PATH);
+    CHECK(!loadTrace(TRACE_PATH, events));
+}
+
+int main() {
+    return TestCheck::runAll("trace_recorder");
+}
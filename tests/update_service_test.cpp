@@ -0,0 +1,278 @@
+// update_service_test.cpp - 背景更新工作：重試、取消、執行中結束服務，以及回呼在哪個執行緒、何時呼叫
+#include "update_service.h"
+#include "test_check.h"
+#include <memory>
+
+using namespace UpdateService;
+
+namespace {
+
+RetryPolicy quickRetry(int maxAttempts, int delayMs) {
+    RetryPolicy policy;
+    policy.maxAttempts = maxAttempts;
+    policy.initialDelayMs = delayMs;
+    policy.maxDelayMs = delayMs * 4;
+    return policy;
+}
+
+// 記錄回呼：呼叫的執行緒、進度，以及通知時結果是否已可取走
+class Harness {
+public:
+    Harness() : readyCount_(0), takenInCallback_(0), callbackService_(nullptr), service_(new Service(
+        [this](const Progress& progress) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            progress_.push_back(progress);
+            threads_.push_back(std::this_thread::get_id());
+            wake_.notify_all();
+        },
+        [this] {
+            // 通知時結果已在佇列中：介面執行緒收到通知後一定取得到
+            Result result;
+            bool taken = callbackService_->take(result);
+            std::lock_guard<std::mutex> lock(mutex_);
+            readyCount_++;
+            if (taken) {
+                takenInCallback_++;
+                results_.push_back(std::move(result));
+            }
+            threads_.push_back(std::this_thread::get_id());
+            wake_.notify_all();
+        })) {
+        // 結束服務時 service_ 先被清空，回呼改用這個指標
+        callbackService_ = service_.get();
+    }
+
+    Service& service() { return *service_; }
+    void shutdown() { service_.reset(); }
+
+    // 等到收到 count 個結果
+    bool waitResults(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return wake_.wait_for(lock, std::chrono::seconds(10), [&] { return results_.size() >= count; });
+    }
+
+    bool waitProgress(const std::function<bool(const Progress&)>& match) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return wake_.wait_for(lock, std::chrono::seconds(10), [&] {
+            for (size_t i = 0; i < progress_.size(); i++) {
+                if (match(progress_[i])) return true;
+            }
+            return false;
+        });
+    }
+
+    std::vector<Result> results() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return results_;
+    }
+    std::vector<Progress> progress() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return progress_;
+    }
+    std::vector<std::thread::id> threads() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return threads_;
+    }
+    int readyCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return readyCount_;
+    }
+    int takenInCallback() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return takenInCallback_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Progress> progress_;
+    std::vector<Result> results_;
+    std::vector<std::thread::id> threads_;
+    int readyCount_;
+    int takenInCallback_;
+    Service* callbackService_;
+    std::unique_ptr<Service> service_;
+};
+
+// 執行到被取消為止的工作；started 在開始時設定
+Work untilCancelled(std::atomic<int>& started, std::atomic<int>& finished) {
+    return [&started, &finished](Context& context) {
+        started++;
+        context.stage(L"執行中");
+        while (!context.cancelled()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        finished++;
+        return ATTEMPT_RETRY;
+    };
+}
+
+bool waitFor(const std::atomic<int>& value, int wanted) {
+    for (int i = 0; i < 10000 && value.load() < wanted; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return value.load() >= wanted;
+}
+
+}
+
+TEST(backoffAndRetry) {
+    RetryPolicy policy;
+    CHECK(backoffDelay(policy, 1) == 2000 && backoffDelay(policy, 2) == 4000 && backoffDelay(policy, 3) == 8000);
+    CHECK(backoffDelay(policy, 10) == 60000 && backoffDelay(policy, 100) == 60000);
+
+    Harness harness;
+    // 前兩次暫時性錯誤，第三次完成；每次嘗試都從空白的結果開始
+    int calls = 0;
+    harness.service().submit(JOB_MAIN_DICT, [&calls](Context& context) {
+        calls++;
+        CHECK(context.result().message.empty() && context.attempt() == calls);
+        context.result().message = L"第 " + std::to_wstring(calls) + L" 次";
+        return calls < 3 ? ATTEMPT_RETRY : ATTEMPT_DONE;
+    }, quickRetry(4, 5));
+    // 重試次數用完
+    harness.service().submit(JOB_WORD_PHRASES, [](Context&) { return ATTEMPT_RETRY; }, quickRetry(2, 5));
+    // 例外視為無法重試的失敗
+    harness.service().submit(JOB_VERSION, [](Context&) -> Attempt { throw 1; }, quickRetry(4, 5));
+    CHECK(harness.waitResults(3));
+
+    std::vector<Result> results = harness.results();
+    CHECK(results.size() == 3);
+    CHECK(results[0].status == STATUS_SUCCEEDED && results[0].attempts == 3 && results[0].message == L"第 3 次");
+    CHECK(results[1].status == STATUS_FAILED && results[1].attempts == 2 && results[1].kind == JOB_WORD_PHRASES);
+    CHECK(results[2].status == STATUS_FAILED && results[2].attempts == 1 && !results[2].message.empty());
+
+    // 等待重試前通知：第幾次嘗試失敗、等待多久
+    int waits = 0;
+    std::vector<Progress> progress = harness.progress();
+    for (size_t i = 0; i < progress.size(); i++) {
+        if (progress[i].kind == JOB_MAIN_DICT && progress[i].retryDelayMs > 0) {
+            waits++;
+            CHECK(progress[i].attempt == waits && progress[i].retryDelayMs == 5 * waits);
+        }
+    }
+    CHECK(waits == 2);
+}
+
+TEST(cancelQueuedRunningAndWaiting) {
+    Harness harness;
+    std::atomic<int> started(0), finished(0);
+    int running = harness.service().submit(JOB_MAIN_DICT, untilCancelled(started, finished));
+    CHECK(waitFor(started, 1));
+    bool queuedRan = false;
+    int queued = harness.service().submit(JOB_WORD_PHRASES, [&queuedRan](Context&) {
+        queuedRan = true;
+        return ATTEMPT_DONE;
+    });
+    // 同種類的工作不重複加入
+    CHECK(harness.service().submit(JOB_MAIN_DICT, [](Context&) { return ATTEMPT_DONE; }) == running);
+    CHECK(harness.service().submit(JOB_WORD_PHRASES, [](Context&) { return ATTEMPT_DONE; }) == queued);
+    CHECK(harness.service().pendingJob(JOB_MAIN_DICT) == running && harness.service().pendingJob(JOB_VERSION) == 0);
+
+    // 佇列中的工作直接移除，不會執行
+    CHECK(harness.service().cancel(queued));
+    CHECK(harness.waitResults(1));
+    CHECK(!harness.service().cancel(queued) && !harness.service().cancel(999));
+    // 執行中的工作在下一次檢查時結束
+    CHECK(harness.service().cancel(running));
+    CHECK(harness.waitResults(2));
+    std::vector<Result> results = harness.results();
+    CHECK(results[0].jobId == queued && results[0].status == STATUS_CANCELLED && results[0].attempts == 0);
+    CHECK(results[1].jobId == running && results[1].status == STATUS_CANCELLED && results[1].attempts == 1);
+    CHECK(!queuedRan && finished == 1 && harness.service().pendingJob(JOB_MAIN_DICT) == 0);
+
+    // 等待重試（一分鐘）時取消：立刻結束，不等到時間到
+    int waiting = harness.service().submit(JOB_VERSION, [](Context&) { return ATTEMPT_RETRY; }, quickRetry(4, 60000));
+    CHECK(harness.waitProgress([waiting](const Progress& p) { return p.jobId == waiting && p.retryDelayMs > 0; }));
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    harness.service().cancelAll();
+    CHECK(harness.waitResults(3));
+    CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+    results = harness.results();
+    CHECK(results[2].jobId == waiting && results[2].status == STATUS_CANCELLED && results[2].attempts == 1);
+
+    // 取消之後的工作照常執行
+    harness.service().submit(JOB_MAIN_DICT, [](Context&) { return ATTEMPT_DONE; });
+    CHECK(harness.waitResults(4));
+    CHECK(harness.results()[3].status == STATUS_SUCCEEDED);
+}
+
+TEST(shutdownWhileJobIsRunning) {
+    std::atomic<int> started(0), finished(0);
+    bool queuedRan = false;
+    {
+        Harness harness;
+        harness.service().submit(JOB_MAIN_DICT, untilCancelled(started, finished));
+        harness.service().submit(JOB_VERSION, [&queuedRan](Context&) {
+            queuedRan = true;
+            return ATTEMPT_DONE;
+        });
+        CHECK(waitFor(started, 1));
+        int ready = harness.readyCount();
+        // 結束服務：執行中的工作看到取消後結束，解構等待它結束；佇列中的工作不執行，也不產生結果
+        harness.shutdown();
+        CHECK(finished == 1 && !queuedRan);
+        CHECK(harness.readyCount() == ready && harness.results().empty());
+    }
+
+    // 等待重試時結束服務：不等到重試的時間
+    {
+        Harness harness;
+        harness.service().submit(JOB_MAIN_DICT, [](Context&) { return ATTEMPT_RETRY; }, quickRetry(4, 60000));
+        CHECK(harness.waitProgress([](const Progress& p) { return p.retryDelayMs > 0; }));
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        harness.shutdown();
+        CHECK(std::chrono::steady_clock::now() - begin < std::chrono::seconds(5));
+        CHECK(harness.readyCount() == 0);
+    }
+
+    // 沒有工作時結束服務
+    {
+        Harness harness;
+        harness.shutdown();
+        CHECK(harness.readyCount() == 0 && harness.progress().empty());
+    }
+}
+
+TEST(callbacksAreMarshalledFromWorker) {
+    Harness harness;
+    std::thread::id worker;
+    harness.service().submit(JOB_MAIN_DICT, [&worker](Context& context) {
+        worker = std::this_thread::get_id();
+        context.stage(L"下載中");
+        // 每一段都回報：同一個工作的通知有頻率限制，最後一段一定通知
+        for (uint64_t done = 0; done <= 100000; done += 100) context.progress(done, 100000);
+        context.result().size = 100000;
+        return ATTEMPT_DONE;
+    });
+    CHECK(harness.waitResults(1));
+    // 完成通知時結果已可取走，每個結果通知一次
+    CHECK(harness.readyCount() == 1 && harness.takenInCallback() == 1);
+    CHECK(harness.results()[0].size == 100000);
+
+    // 進度與完成都在更新執行緒呼叫，介面執行緒自行決定如何轉送
+    std::vector<std::thread::id> threads = harness.threads();
+    bool allOnWorker = !threads.empty();
+    for (size_t i = 0; i < threads.size(); i++) allOnWorker = allOnWorker && threads[i] == worker;
+    CHECK(allOnWorker && worker != std::this_thread::get_id());
+
+    std::vector<Progress> progress = harness.progress();
+    CHECK(progress.size() >= 2 && progress.size() < 100);
+    CHECK(progress[0].message == L"下載中" && progress[0].total == -1);
+    CHECK(progress.back().done == 100000 && progress.back().total == 100000);
+    CHECK(progress.back().attempt == 1 && progress.back().retryDelayMs == 0);
+
+    // 取消佇列中的工作時在呼叫的執行緒通知（工作不會開始執行）
+    std::atomic<int> started(0), finished(0);
+    int running = harness.service().submit(JOB_MAIN_DICT, untilCancelled(started, finished));
+    CHECK(harness.waitProgress([running](const Progress& p) { return p.jobId == running; }));
+    int queued = harness.service().submit(JOB_VERSION, [](Context&) { return ATTEMPT_DONE; });
+    size_t before = harness.threads().size();
+    harness.service().cancel(queued);
+    threads = harness.threads();
+    CHECK(threads.size() == before + 1 && threads.back() == std::this_thread::get_id());
+    harness.service().cancelAll();
+    CHECK(harness.waitResults(3));
+}
+
+int main() {
+    return TestCheck::runAll("update_service");
+}
@@ -0,0 +1,235 @@
+// text_layout.cpp - 暫放區文字排版實作
+#include "text_layout.h"
+#include <algorithm>
+
+// 重排時每次讀取的字元數（避免為整份文字建立讀取器）
+static const size_t LAYOUT_READ_BLOCK = 256;
+// 編輯後最多立即重排的字元數；未能與舊排版對齊的其餘部分延遲到需要時再排
+static const size_t RELAYOUT_LIMIT = 256;
+
+TextLayout::TextLayout()
+    : metrics_(nullptr), width_(0), lineHeight_(0), valid_(false), length_(0),
+      complete_(true), charsLaidOut_(0), metricsQueries_(0) {
+    lineStarts_.push_back(0);
+}
+
+void TextLayout::setMetrics(TextMetrics* metrics) {
+    metrics_ = metrics;
+    lineHeight_ = metrics ? metrics->lineHeight() : 0;
+    pages_.clear();
+    wideCache_.clear();
+    valid_ = false;
+}
+
+void TextLayout::setWidth(int width) {
+    if (width == width_) return;
+    width_ = width;
+    valid_ = false;
+}
+
+int TextLayout::advance(wchar_t ch) {
+    uint32_t code = (uint32_t)ch;
+    if (code < 0x10000) {
+        if (pages_.empty()) pages_.resize(256);
+        std::vector<int16_t>& page = pages_[code >> 8];
+        if (page.empty()) page.assign(256, (int16_t)-1);
+        int16_t& cached = page[code & 0xFF];
+        if (cached < 0) {
+            metricsQueries_++;
+            int value = metrics_ ? metrics_->advance(ch) : 0;
+            cached = (int16_t)std::max(0, std::min(value, 0x7FFF));
+        }
+        return cached;
+    }
+
+    std::map<uint32_t, int>::const_iterator it = wideCache_.find(code);
+    if (it != wideCache_.end()) return it->second;
+    metricsQueries_++;
+    int value = metrics_ ? std::max(0, metrics_->advance(ch)) : 0;
+    wideCache_[code] = value;
+    return value;
+}
+
+void TextLayout::ensure(const TextModel& text) {
+    if (!valid_ || length_ != text.length()) reset(text);
+}
+
+void TextLayout::reset(const TextModel& text) {
+    length_ = text.length();
+    lineStarts_.assign(1, 0);
+    complete_ = (length_ == 0);
+    valid_ = true;
+}
+
+size_t TextLayout::layoutLine(const TextModel& text, size_t start) {
+    size_t pos = start;
+    int x = 0;
+    while (pos < length_) {
+        TextModel::Reader reader(text, pos, LAYOUT_READ_BLOCK);
+        wchar_t ch;
+        while (reader.next(ch)) {
+            int w = advance(ch);
+            if (x > 0 && x + w > width_) return pos;
+            x += w;
+            pos++;
+            charsLaidOut_++;
+        }
+    }
+    return TextModel::npos;
+}
+
+void TextLayout::extend(const TextModel& text, size_t pos, size_t lines) {
+    while (!complete_ && (lineStarts_.back() <= pos || lineStarts_.size() <= lines)) {
+        size_t next = layoutLine(text, lineStarts_.back());
+        if (next == TextModel::npos) {
+            complete_ = true;
+        } else {
+            lineStarts_.push_back(next);
+        }
+    }
+}
+
+void TextLayout::onEdit(const TextModel& text, size_t pos, size_t removed, size_t inserted) {
+    // 排版已無效或與文字不一致時等下次使用再重排
+    if (!valid_ || length_ < removed || length_ - removed + inserted != text.length()) {
+        valid_ = false;
+        return;
+    }
+
+    // 編輯位於尚未排版的部分：已知的行都不受影響
+    if (!complete_ && pos > lineStarts_.back()) {
+        length_ = text.length();
+        return;
+    }
+
+    // 刪除可能讓下一行的字元移上前一行，因此從編輯所在行的前一行開始
+    size_t line = (size_t)(std::upper_bound(lineStarts_.begin(), lineStarts_.end(), pos) - lineStarts_.begin()) - 1;
+    if (line > 0) line--;
+
+    // 編輯範圍之後的舊行起點換算成新位置，作為重新對齊的候選
+    size_t oldEditEnd = pos + removed;
+    std::vector<size_t> mapped;
+    for (size_t i = line + 1; i < lineStarts_.size(); i++) {
+        if (lineStarts_[i] >= oldEditEnd) mapped.push_back(lineStarts_[i] - removed + inserted);
+    }
+
+    length_ = text.length();
+    relayoutFrom(text, line, pos + inserted, mapped, complete_, RELAYOUT_LIMIT);
+}
+
+void TextLayout::relayoutFrom(const TextModel& text, size_t line, size_t editEnd,
+                              const std::vector<size_t>& oldStarts, bool oldComplete, size_t limit) {
+    lineStarts_.resize(line + 1);
+    complete_ = false;
+    size_t candidate = 0;   // oldStarts 中下一個候選
+
+    for (;;) {
+        size_t next = layoutLine(text, lineStarts_.back());
+        if (next == TextModel::npos) {
+            complete_ = true;
+            return;
+        }
+        // 編輯範圍之後的行起點與舊排版相同時，其後各行都不會改變
+        if (next >= editEnd) {
+            while (candidate < oldStarts.size() && oldStarts[candidate] < next) candidate++;
+            if (candidate < oldStarts.size() && oldStarts[candidate] == next) {
+                lineStarts_.insert(lineStarts_.end(), oldStarts.begin() + candidate, oldStarts.end());
+                complete_ = oldComplete;
+                return;
+            }
+        }
+        lineStarts_.push_back(next);
+        if (next > editEnd + limit) return;   // 其餘行延遲到需要時再排
+    }
+}
+
+size_t TextLayout::lineCount(const TextModel& text) {
+    ensure(text);
+    extend(text, TextModel::npos, 0);
+    return lineStarts_.size();
+}
+
+bool TextLayout::hasLines(const TextModel& text, size_t count) {
+    if (count == 0) return true;
+    ensure(text);
+    extend(text, 0, count - 1);
+    return lineStarts_.size() >= count;
+}
+
+size_t TextLayout::lineStart(const TextModel& text, size_t line) {
+    ensure(text);
+    extend(text, 0, line);
+    return line < lineStarts_.size() ? lineStarts_[line] : length_;
+}
+
+size_t TextLayout::lineEnd(const TextModel& text, size_t line) {
+    ensure(text);
+    extend(text, 0, line + 1);
+    return line + 1 < lineStarts_.size() ? lineStarts_[line + 1] : length_;
+}
+
+size_t TextLayout::lineForPosition(const TextModel& text, size_t pos) {
+    ensure(text);
+    if (pos > length_) pos = length_;
+    extend(text, pos, 0);
+    std::vector<size_t>::const_iterator it =
+        std::upper_bound(lineStarts_.begin(), lineStarts_.end(), pos);
+    return (size_t)(it - lineStarts_.begin()) - 1;
+}
+
+void TextLayout::lineOffsets(const TextModel& text, size_t line, std::vector<int>& xs) {
+    size_t start = lineStarts_[line];
+    size_t end = lineEnd(text, line);
+    xs.assign(1, 0);
+    xs.reserve(end - start + 1);
+
+    TextModel::Reader reader(text, start, end - start);
+    wchar_t ch;
+    int x = 0;
+    while (reader.next(ch)) {
+        x += advance(ch);
+        xs.push_back(x);
+    }
+}
+
+LayoutPoint TextLayout::pointFromPosition(const TextModel& text, size_t pos) {
+    ensure(text);
+    if (pos > length_) pos = length_;
+
+    size_t line = lineForPosition(text, pos);
+    LayoutPoint pt;
+    pt.x = 0;
+    pt.y = (int)line * lineHeight_;
+
+    TextModel::Reader reader(text, lineStarts_[line], pos - lineStarts_[line]);
+    wchar_t ch;
+    while (reader.next(ch)) pt.x += advance(ch);
+    return pt;
+}
+
+size_t TextLayout::positionFromPoint(const TextModel& text, int x, int y) {
+    ensure(text);
+
+    size_t line = 0;
+    if (y > 0 && lineHeight_ > 0) {
+        line = (size_t)(y / lineHeight_);
+        extend(text, 0, line + 1);
+        line = std::min(line, lineStarts_.size() - 1);
+    }
+
+    std::vector<int> xs;
+    lineOffsets(text, line, xs);
+
+    // 行內二分搜尋最接近的字元邊界
+    std::vector<int>::const_iterator it = std::lower_bound(xs.begin(), xs.end(), x);
+    size_t index;
+    if (it == xs.end()) {
+        index = xs.size() - 1;
+    } else if (it == xs.begin()) {
+        index = 0;
+    } else {
+        index = (size_t)(it - xs.begin());
+        if (x - *(it - 1) <= *it - x) index--;
+    }
+    return lineStarts_[line] + index;
+}
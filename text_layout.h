@@ -0,0 +1,108 @@
+// text_layout.h - 暫放區文字排版：字元寬度快取與自動換行索引（可攜式，不依賴 Windows API）
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include "text_model.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// 字型度量介面：Windows 上以 GDI 實作，測試時可替換成固定寬度的假度量
+class TextMetrics {
+public:
+    virtual ~TextMetrics() {}
+    virtual int advance(wchar_t ch) = 0;    // 單一字元的前進寬度（像素）
+    virtual int lineHeight() = 0;           // 行高（像素）
+};
+
+// 排版座標：相對於文字區左上角
+struct LayoutPoint {
+    int x;
+    int y;
+};
+
+// 自動換行排版
+// - 每個字元的寬度只向度量介面查詢一次，之後從快取取得
+// - 只保存每行的起點；行內位置需要時再由快取的寬度累加
+// - 以貪婪方式換行：字元放不下時移到下一行（與暫放視窗繪製規則相同）
+// - 編輯後只重排受影響的行：從編輯所在行的前一行開始，直到行起點與舊排版重新對齊為止
+// - 排版是延遲進行的：只排到查詢需要的位置；沒有換行符號的長文中間插字時，
+//   其後各行都會位移，此時只重排一小段，其餘等需要時再排
+class TextLayout {
+public:
+    TextLayout();
+
+    // 更換度量（例如字型改變）：清除寬度快取並標記需要重排
+    void setMetrics(TextMetrics* metrics);
+    // 設定可用寬度；改變時標記需要重排
+    void setWidth(int width);
+
+    TextMetrics* metrics() const { return metrics_; }
+    int width() const { return width_; }
+    int lineHeight() const { return lineHeight_; }
+    bool valid() const { return valid_; }
+
+    // 標記需要整份重排（內容被整段取代、復原等）
+    void invalidate() { valid_ = false; }
+
+    // 確保排版與文字一致；無效或長度不符時捨棄排版（之後依需要重新排）
+    void ensure(const TextModel& text);
+
+    // 文字已在 pos 處刪除 removed 個字元並插入 inserted 個字元後呼叫
+    void onEdit(const TextModel& text, size_t pos, size_t removed, size_t inserted);
+
+    // 總行數（需要排完整份文字）
+    size_t lineCount(const TextModel& text);
+    // 行數是否至少為 count（只排到足以判斷為止，用於視窗高度有上限時）
+    bool hasLines(const TextModel& text, size_t count);
+
+    // 行的起點與結尾（line 超出總行數時回傳文字結尾）
+    size_t lineStart(const TextModel& text, size_t line);
+    size_t lineEnd(const TextModel& text, size_t line);
+
+    // 位置所在的行（二分搜尋）；位於行首的位置屬於該行
+    size_t lineForPosition(const TextModel& text, size_t pos);
+
+    // 游標位置 → 座標（行首的位置顯示在該行開頭）
+    LayoutPoint pointFromPosition(const TextModel& text, size_t pos);
+    // 座標 → 最接近的游標位置：先依 y 二分找行，再在行內找最近的字元邊界
+    size_t positionFromPoint(const TextModel& text, int x, int y);
+
+    // 字元寬度（經由快取）
+    int advance(wchar_t ch);
+
+    // 統計用：重排過的字元數與向度量介面查詢的次數
+    size_t charsLaidOut() const { return charsLaidOut_; }
+    size_t metricsQueries() const { return metricsQueries_; }
+
+private:
+    void reset(const TextModel& text);
+    // 從 start 排一行，回傳下一行起點；排到文字結尾時回傳 npos
+    size_t layoutLine(const TextModel& text, size_t start);
+    // 從最後一個已知行起點繼續排，直到 pos 所在的行結束或已知行數超過 lines
+    void extend(const TextModel& text, size_t pos, size_t lines);
+    // 從 line 行開始重排；遇到與 oldStarts（已換算成新位置）相同的行起點即接回舊排版，
+    // 超過 limit 個字元仍未對齊時停止，其餘留待之後延遲排版
+    void relayoutFrom(const TextModel& text, size_t line, size_t editEnd,
+                      const std::vector<size_t>& oldStarts, bool oldComplete, size_t limit);
+    // 行內各字元邊界的 x 座標（xs[0] = 0）
+    void lineOffsets(const TextModel& text, size_t line, std::vector<int>& xs);
+
+    TextMetrics* metrics_;
+    int width_;
+    int lineHeight_;
+    bool valid_;
+    size_t length_;                       // 排版時的文字長度
+    std::vector<size_t> lineStarts_;      // 已知的行起點，lineStarts_[0] 恆為 0
+    bool complete_;                       // 是否已排到文字結尾（否則最後一行尚未排完）
+
+    // 寬度快取：基本多文種平面以分頁表存放，其餘以 map 存放
+    std::vector<std::vector<int16_t>> pages_;
+    std::map<uint32_t, int> wideCache_;
+
+    size_t charsLaidOut_;
+    size_t metricsQueries_;
+};
+
+#endif // TEXT_LAYOUT_H
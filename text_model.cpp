@@ -0,0 +1,313 @@
+// text_model.cpp - 暫放區文字模型（片段表）實作
+#include "text_model.h"
+
+const size_t TextModel::npos;
+
+TextModel::TextModel() : root_(-1), pieces_(0), seed_(2463534242u), version_(0), observer_(nullptr) {}
+
+TextModel::TextModel(const std::wstring& text)
+    : root_(-1), pieces_(0), seed_(2463534242u), version_(0), observer_(nullptr) {
+    *this = text;
+}
+
+TextModel::TextModel(const TextModel& other)
+    : original_(other.original_), add_(other.add_), nodes_(other.nodes_),
+      freeNodes_(other.freeNodes_), root_(other.root_), pieces_(other.pieces_),
+      seed_(other.seed_), version_(0), observer_(nullptr) {}
+
+TextModel& TextModel::operator=(const TextModel& other) {
+    if (this == &other) return *this;
+    original_ = other.original_;
+    add_ = other.add_;
+    nodes_ = other.nodes_;
+    freeNodes_ = other.freeNodes_;
+    root_ = other.root_;
+    pieces_ = other.pieces_;
+    seed_ = other.seed_;
+    version_++;
+    if (observer_) observer_->onReset(*this);
+    return *this;
+}
+
+TextModel& TextModel::operator=(const std::wstring& text) {
+    release();
+    original_ = text;
+    if (!original_.empty()) root_ = newNode(BUF_ORIGINAL, 0, original_.size());
+    version_++;
+    if (observer_) observer_->onReset(*this);
+    return *this;
+}
+
+TextModel& TextModel::operator=(std::wstring&& text) {
+    release();
+    original_ = std::move(text);
+    if (!original_.empty()) root_ = newNode(BUF_ORIGINAL, 0, original_.size());
+    version_++;
+    if (observer_) observer_->onReset(*this);
+    return *this;
+}
+
+void TextModel::swap(TextModel& other) {
+    if (this == &other) return;
+    original_.swap(other.original_);
+    add_.swap(other.add_);
+    nodes_.swap(other.nodes_);
+    freeNodes_.swap(other.freeNodes_);
+    std::swap(root_, other.root_);
+    std::swap(pieces_, other.pieces_);
+    std::swap(seed_, other.seed_);
+    version_++;
+    other.version_++;
+    if (observer_) observer_->onReset(*this);
+    if (other.observer_) other.observer_->onReset(other);
+}
+
+void TextModel::clear() {
+    release();
+    version_++;
+    if (observer_) observer_->onReset(*this);
+}
+
+void TextModel::release() {
+    // 釋放記憶體而非只清空長度（清空大份文字後不保留原本的容量）
+    std::wstring().swap(original_);
+    std::wstring().swap(add_);
+    nodes_.clear();
+    freeNodes_.clear();
+    root_ = -1;
+    pieces_ = 0;
+}
+
+const wchar_t* TextModel::pieceData(const Node& node) const {
+    return (node.buffer == BUF_ORIGINAL ? original_.data() : add_.data()) + node.start;
+}
+
+void TextModel::update(int node) {
+    Node& n = nodes_[node];
+    n.total = n.len + subtreeLength(n.left) + subtreeLength(n.right);
+}
+
+uint32_t TextModel::nextPriority() {
+    // xorshift32：只需要分布均勻，不需要密碼學強度
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
+int TextModel::newNode(uint8_t buffer, size_t start, size_t len) {
+    Node node;
+    node.left = -1;
+    node.right = -1;
+    node.priority = nextPriority();
+    node.buffer = buffer;
+    node.start = start;
+    node.len = len;
+    node.total = len;
+
+    int index;
+    if (!freeNodes_.empty()) {
+        index = freeNodes_.back();
+        freeNodes_.pop_back();
+        nodes_[index] = node;
+    } else {
+        index = (int)nodes_.size();
+        nodes_.push_back(node);
+    }
+    pieces_++;
+    return index;
+}
+
+void TextModel::freeTree(int node) {
+    if (node < 0) return;
+    freeTree(nodes_[node].left);
+    freeTree(nodes_[node].right);
+    freeNodes_.push_back(node);
+    pieces_--;
+}
+
+// 將 node 子樹分成前 pos 個字元（left）與其餘（right）；切點落在片段中間時將片段一分為二
+void TextModel::split(int node, size_t pos, int& left, int& right) {
+    if (node < 0) {
+        left = right = -1;
+        return;
+    }
+
+    size_t leftLen = subtreeLength(nodes_[node].left);
+    size_t nodeLen = nodes_[node].len;
+
+    if (pos <= leftLen) {
+        int l, r;
+        split(nodes_[node].left, pos, l, r);
+        nodes_[node].left = r;
+        update(node);
+        left = l;
+        right = node;
+    } else if (pos >= leftLen + nodeLen) {
+        int l, r;
+        split(nodes_[node].right, pos - leftLen - nodeLen, l, r);
+        nodes_[node].right = l;
+        update(node);
+        left = node;
+        right = r;
+    } else {
+        size_t offset = pos - leftLen;
+        // newNode 可能使 nodes_ 重新配置，先取出需要的欄位
+        uint8_t buffer = nodes_[node].buffer;
+        size_t start = nodes_[node].start;
+        int oldRight = nodes_[node].right;
+        int tail = newNode(buffer, start + offset, nodeLen - offset);
+
+        nodes_[node].len = offset;
+        nodes_[node].right = -1;
+        update(node);
+        left = node;
+        right = merge(tail, oldRight);
+    }
+}
+
+int TextModel::merge(int left, int right) {
+    if (left < 0) return right;
+    if (right < 0) return left;
+    if (nodes_[left].priority > nodes_[right].priority) {
+        int merged = merge(nodes_[left].right, right);
+        nodes_[left].right = merged;
+        update(left);
+        return left;
+    }
+    int merged = merge(left, nodes_[right].left);
+    nodes_[right].left = merged;
+    update(right);
+    return right;
+}
+
+// 最後一個片段剛好結束在附加緩衝區的 addStart 時直接延長（連續輸入不增加片段）
+bool TextModel::extendRightmost(int node, size_t addStart, size_t count) {
+    if (node < 0) return false;
+    Node& n = nodes_[node];
+    bool extended;
+    if (n.right >= 0) {
+        extended = extendRightmost(n.right, addStart, count);
+    } else {
+        extended = n.buffer == BUF_ADD && n.start + n.len == addStart;
+        if (extended) n.len += count;
+    }
+    if (extended) update(node);
+    return extended;
+}
+
+void TextModel::insert(size_t pos, const std::wstring& text) {
+    insert(pos, text.data(), text.size());
+}
+
+void TextModel::insert(size_t pos, const wchar_t* data, size_t count) {
+    if (count == 0) return;
+    if (pos > length()) pos = length();
+
+    size_t addStart = add_.size();
+    add_.append(data, count);
+
+    int left, right;
+    split(root_, pos, left, right);
+    if (!extendRightmost(left, addStart, count)) {
+        left = merge(left, newNode(BUF_ADD, addStart, count));
+    }
+    root_ = merge(left, right);
+    version_++;
+    if (observer_) observer_->onInsert(pos, data, count);
+}
+
+void TextModel::erase(size_t pos, size_t count) {
+    size_t len = length();
+    if (pos >= len || count == 0) return;
+    if (count > len - pos) count = len - pos;
+
+    int left, middle, right;
+    split(root_, pos, left, middle);
+    split(middle, count, middle, right);
+    freeTree(middle);
+    root_ = merge(left, right);
+
+    // 全部刪除時順便釋放緩衝區
+    if (root_ < 0) release();
+    version_++;
+    if (observer_) observer_->onErase(pos, count);
+}
+
+const wchar_t* TextModel::chunkAt(size_t pos, size_t& available) const {
+    int node = root_;
+    while (node >= 0) {
+        const Node& n = nodes_[node];
+        size_t leftLen = subtreeLength(n.left);
+        if (pos < leftLen) {
+            node = n.left;
+        } else if (pos < leftLen + n.len) {
+            available = leftLen + n.len - pos;
+            return pieceData(n) + (pos - leftLen);
+        } else {
+            pos -= leftLen + n.len;
+            node = n.right;
+        }
+    }
+    available = 0;
+    return nullptr;
+}
+
+wchar_t TextModel::operator[](size_t pos) const {
+    size_t available;
+    const wchar_t* data = chunkAt(pos, available);
+    return data ? *data : L'\0';
+}
+
+void TextModel::visitRange(int node, size_t base, size_t from, size_t to,
+                           const ChunkVisitor& visit) const {
+    if (node < 0) return;
+    const Node& n = nodes_[node];
+    size_t leftLen = subtreeLength(n.left);
+    size_t nodeStart = base + leftLen;
+    size_t nodeEnd = nodeStart + n.len;
+
+    // 只走與 [from, to) 重疊的子樹
+    if (from < nodeStart) visitRange(n.left, base, from, to, visit);
+    if (from < nodeEnd && to > nodeStart) {
+        size_t begin = from > nodeStart ? from : nodeStart;
+        size_t end = to < nodeEnd ? to : nodeEnd;
+        visit(pieceData(n) + (begin - nodeStart), end - begin);
+    }
+    if (to > nodeEnd) visitRange(n.right, nodeEnd, from, to, visit);
+}
+
+void TextModel::forEachChunk(size_t pos, size_t count, const ChunkVisitor& visit) const {
+    size_t len = length();
+    if (pos >= len || count == 0) return;
+    size_t end = (count > len - pos) ? len : pos + count;
+    visitRange(root_, 0, pos, end, visit);
+}
+
+std::wstring TextModel::substr(size_t pos, size_t count) const {
+    std::wstring result;
+    size_t len = length();
+    if (pos >= len) return result;
+    result.reserve(count > len - pos ? len - pos : count);
+    forEachChunk(pos, count, [&result](const wchar_t* data, size_t n) {
+        result.append(data, n);
+    });
+    return result;
+}
+
+// ===== Reader =====
+
+TextModel::Reader::Reader(const TextModel& model, size_t pos, size_t count)
+    : model_(&model), pos_(pos), end_(pos), data_(nullptr), available_(0) {
+    size_t len = model.length();
+    if (pos < len) end_ = (count > len - pos) ? len : pos + count;
+}
+
+bool TextModel::Reader::next(wchar_t& ch) {
+    if (pos_ >= end_) return false;
+    if (available_ == 0) data_ = model_->chunkAt(pos_, available_);
+    ch = *data_++;
+    available_--;
+    pos_++;
+    return true;
+}
@@ -0,0 +1,128 @@
+// text_model.h - 暫放區文字模型：以平衡樹（treap）管理的片段表（可攜式，不依賴 Windows API）
+#ifndef TEXT_MODEL_H
+#define TEXT_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 片段表（piece table）：
+// - 文字由「原始緩衝區」（載入或指定的內容）與「附加緩衝區」（之後插入的內容）的片段組成
+// - 片段存放在以位置為鍵的 treap 中，插入、刪除、取字元皆為 O(log n)，不需搬移游標後的文字
+// - 在上一次插入的結尾繼續輸入時直接延長該片段，不會產生新片段
+// 介面刻意與 std::wstring 相近（length/empty/insert/erase/substr/operator[]），方便替換
+class TextModel {
+public:
+    static const size_t npos = (size_t)-1;
+
+    // 依序讀取字元：讀完一個片段時才向模型查詢下一個（不配置記憶體，成本與讀取的範圍成正比），
+    // 讀取期間不可修改模型
+    class Reader {
+    public:
+        explicit Reader(const TextModel& model, size_t pos = 0, size_t count = npos);
+
+        // 取出下一個字元；已讀完時回傳 false
+        bool next(wchar_t& ch);
+        bool atEnd() const { return pos_ >= end_; }
+
+    private:
+        const TextModel* model_;
+        size_t pos_;
+        size_t end_;
+        const wchar_t* data_;   // 目前片段中下一個字元
+        size_t available_;      // 目前片段中剩下的字元數
+    };
+
+    // 修改通知（例如寫入編輯日誌）：在修改完成後呼叫
+    class Observer {
+    public:
+        virtual ~Observer() {}
+        virtual void onInsert(size_t pos, const wchar_t* data, size_t count) = 0;
+        virtual void onErase(size_t pos, size_t count) = 0;
+        // 整份內容被取代（指定新內容或清空）
+        virtual void onReset(const TextModel& model) = 0;
+    };
+
+    TextModel();
+    TextModel(const std::wstring& text);
+    // 複製時不複製觀察者（例如軌跡重播的暫存狀態不可寫入日誌）
+    TextModel(const TextModel& other);
+    TextModel& operator=(const TextModel& other);
+    TextModel& operator=(const std::wstring& text);
+    // 接管 text 的記憶體作為原始緩衝區（載入大檔時不再複製一份）
+    TextModel& operator=(std::wstring&& text);
+    // 交換內容（觀察者不交換，兩邊的觀察者都會收到整份取代的通知）
+    void swap(TextModel& other);
+
+    void setObserver(Observer* observer) { observer_ = observer; }
+    Observer* observer() const { return observer_; }
+
+    size_t length() const { return root_ < 0 ? 0 : nodes_[root_].total; }
+    size_t size() const { return length(); }
+    bool empty() const { return length() == 0; }
+
+    void clear();
+    void insert(size_t pos, const std::wstring& text);
+    void insert(size_t pos, const wchar_t* data, size_t count);
+    void erase(size_t pos, size_t count = npos);
+    void append(const std::wstring& text) { insert(length(), text); }
+
+    // 取單一字元：O(log n)；連續讀取請用 Reader
+    wchar_t operator[](size_t pos) const;
+
+    std::wstring substr(size_t pos, size_t count = npos) const;
+    std::wstring str() const { return substr(0); }
+
+    // 串流讀取：依序以連續記憶體區段回呼 [pos, pos+count) 的內容（存檔、送出時不需先組成完整字串）
+    typedef std::function<void(const wchar_t*, size_t)> ChunkVisitor;
+    void forEachChunk(size_t pos, size_t count, const ChunkVisitor& visit) const;
+    void forEachChunk(const ChunkVisitor& visit) const { forEachChunk(0, npos, visit); }
+
+    // 目前的片段數（統計與測試用）
+    size_t pieceCount() const { return pieces_; }
+
+    // 修改次數：每次插入、刪除或取代內容都會遞增，用來判斷由文字衍生的快取是否過期
+    uint64_t version() const { return version_; }
+
+private:
+    enum BufferId { BUF_ORIGINAL = 0, BUF_ADD = 1 };
+
+    struct Node {
+        int left;
+        int right;
+        uint32_t priority;
+        uint8_t buffer;      // BufferId
+        size_t start;        // 片段在緩衝區中的起點
+        size_t len;          // 片段長度
+        size_t total;        // 子樹總長度
+    };
+
+    const wchar_t* pieceData(const Node& node) const;
+    // pos 所在片段中從 pos 開始的字元與其後（同一片段內）的字元數；pos 超出範圍時回傳空指標
+    const wchar_t* chunkAt(size_t pos, size_t& available) const;
+    size_t subtreeLength(int node) const { return node < 0 ? 0 : nodes_[node].total; }
+    void update(int node);
+    int newNode(uint8_t buffer, size_t start, size_t len);
+    void freeTree(int node);
+    uint32_t nextPriority();
+
+    void release();
+    void split(int node, size_t pos, int& left, int& right);
+    int merge(int left, int right);
+    bool extendRightmost(int node, size_t addStart, size_t count);
+    void visitRange(int node, size_t base, size_t from, size_t to, const ChunkVisitor& visit) const;
+
+    std::wstring original_;
+    std::wstring add_;
+    std::vector<Node> nodes_;
+    std::vector<int> freeNodes_;
+    int root_;
+    size_t pieces_;
+    uint32_t seed_;
+    uint64_t version_;
+    Observer* observer_;
+};
+
+#endif // TEXT_MODEL_H
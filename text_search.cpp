@@ -0,0 +1,228 @@
+// text_search.cpp - 暫放區文字搜尋實作
+#include "text_search.h"
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace TextSearch {
+
+// 往前搜尋時第一次檢查的範圍，找不到再逐步放大
+static const size_t BACKWARD_WINDOW = 4096;
+// 搜尋字串不超過此長度時以首字元篩選；Horspool 的位移最多只有字串長度，短字串時效益不大
+static const size_t FIRST_CHAR_FILTER_MAX = 3;
+
+// 找 ch 在 data[from, size) 中第一次出現的位置；SSE2 一次比對 16 位元組
+static size_t findChar(const wchar_t* data, size_t size, size_t from, wchar_t ch) {
+    size_t i = from;
+#if defined(__SSE2__)
+    if (sizeof(wchar_t) == 2) {
+        __m128i target = _mm_set1_epi16((short)ch);
+        for (; i + 8 <= size; i += 8) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(block, target));
+            if (mask) return i + __builtin_ctz(mask) / 2;
+        }
+    } else if (sizeof(wchar_t) == 4) {
+        __m128i target = _mm_set1_epi32((int)ch);
+        for (; i + 4 <= size; i += 4) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(block, target));
+            if (mask) return i + __builtin_ctz(mask) / 4;
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (data[i] == ch) return i;
+    }
+    return TextModel::npos;
+}
+
+Pattern::Pattern(const std::wstring& needle) : needle_(needle) {
+    size_t m = needle_.size();
+    for (size_t i = 0; i < 256; i++) skip_[i] = m;
+    // 最後一個字元之外，每個字元到結尾的距離；同一格取最小值
+    for (size_t i = 0; i + 1 < m; i++) skip_[bucket(needle_[i])] = m - 1 - i;
+}
+
+size_t Pattern::find(const wchar_t* data, size_t size, size_t from) const {
+    size_t m = needle_.size();
+    if (m == 0 || size < m || from > size - m) return TextModel::npos;
+
+    const wchar_t* needle = needle_.data();
+    if (m <= FIRST_CHAR_FILTER_MAX) {
+        size_t limit = size - m + 1;
+        for (size_t i = from; (i = findChar(data, limit, i, needle[0])) != TextModel::npos; i++) {
+            if (std::char_traits<wchar_t>::compare(data + i + 1, needle + 1, m - 1) == 0) return i;
+        }
+        return TextModel::npos;
+    }
+
+    wchar_t last = needle[m - 1];
+    size_t limit = size - m;
+    for (size_t i = from; i <= limit; ) {
+        wchar_t ch = data[i + m - 1];
+        if (ch == last && std::char_traits<wchar_t>::compare(data + i, needle, m - 1) == 0) return i;
+        i += skip_[bucket(ch)];
+    }
+    return TextModel::npos;
+}
+
+void forEachMatch(const TextModel& text, const Pattern& pattern, size_t from, size_t to,
+                  const MatchVisitor& visit) {
+    size_t m = pattern.length();
+    size_t len = text.length();
+    if (to > len) to = len;
+    if (m == 0 || from >= to || to - from < m) return;
+
+    const wchar_t* needle = pattern.text().data();
+    std::wstring carry;        // 前面各片段的最後 m-1 個字元
+    size_t carryStart = from;
+    size_t base = from;
+    bool stopped = false;
+
+    text.forEachChunk(from, to - from, [&](const wchar_t* data, size_t count) {
+        if (stopped) return;
+
+        // 跨片段的相符：起點在 carry 內，其餘部分接續到本片段（不需另外組成字串）
+        for (size_t i = 0; i < carry.size(); i++) {
+            if (carry[i] != needle[0]) continue;
+            size_t inCarry = carry.size() - i;
+            if (m - inCarry > count) continue;
+            if (std::char_traits<wchar_t>::compare(carry.data() + i, needle, inCarry) != 0) continue;
+            if (std::char_traits<wchar_t>::compare(data, needle + inCarry, m - inCarry) != 0) continue;
+            if (!visit(carryStart + i)) {
+                stopped = true;
+                return;
+            }
+        }
+
+        // 完全在本片段內的相符：直接在片段記憶體上搜尋
+        size_t pos = 0;
+        while ((pos = pattern.find(data, count, pos)) != TextModel::npos) {
+            if (!visit(base + pos)) {
+                stopped = true;
+                return;
+            }
+            pos++;
+        }
+
+        if (m > 1) {
+            if (count >= m - 1) {
+                carry.assign(data + count - (m - 1), m - 1);
+            } else {
+                carry.append(data, count);
+                if (carry.size() > m - 1) carry.erase(0, carry.size() - (m - 1));
+            }
+            carryStart = base + count - carry.size();
+        }
+        base += count;
+    });
+}
+
+size_t findNext(const TextModel& text, const Pattern& pattern, size_t from) {
+    size_t found = TextModel::npos;
+    forEachMatch(text, pattern, from, text.length(), [&found](size_t pos) {
+        found = pos;
+        return false;
+    });
+    return found;
+}
+
+size_t findPrev(const TextModel& text, const Pattern& pattern, size_t before) {
+    size_t m = pattern.length();
+    size_t len = text.length();
+    if (m == 0 || before == 0) return TextModel::npos;
+    if (before > len) before = len;
+
+    // 只搜尋游標前的一段，找不到再放大範圍
+    size_t end = std::min(len, before + m - 1);
+    for (size_t window = BACKWARD_WINDOW; ; window *= 4) {
+        size_t start = before > window ? before - window : 0;
+        size_t found = TextModel::npos;
+        forEachMatch(text, pattern, start, end, [&found, before](size_t pos) {
+            if (pos >= before) return false;
+            found = pos;
+            return true;
+        });
+        if (found != TextModel::npos || start == 0) return found;
+    }
+}
+
+void findAll(const TextModel& text, const Pattern& pattern, size_t from, size_t to,
+             std::vector<size_t>& matches, size_t limit) {
+    matches.clear();
+    if (limit == 0) return;
+    size_t m = pattern.length();
+    size_t nextFree = 0;
+    forEachMatch(text, pattern, from, to, [&](size_t pos) {
+        if (!matches.empty() && pos < nextFree) return true;   // 與前一個重疊
+        matches.push_back(pos);
+        nextFree = pos + m;
+        return matches.size() < limit;
+    });
+}
+
+size_t countMatches(const TextModel& text, const Pattern& pattern) {
+    size_t m = pattern.length();
+    size_t count = 0;
+    size_t nextFree = 0;
+    forEachMatch(text, pattern, 0, text.length(), [&](size_t pos) {
+        if (count > 0 && pos < nextFree) return true;
+        count++;
+        nextFree = pos + m;
+        return true;
+    });
+    return count;
+}
+
+const size_t MatchIndex::STRIDE;
+
+void MatchIndex::build(const TextModel& text, const Pattern& pattern) {
+    needle_ = pattern.text();
+    version_ = text.version();
+    built_ = true;
+    marks_.clear();
+    count_ = 0;
+
+    size_t m = pattern.length();
+    size_t nextFree = 0;
+    forEachMatch(text, pattern, 0, text.length(), [&](size_t pos) {
+        if (count_ > 0 && pos < nextFree) return true;
+        count_++;
+        nextFree = pos + m;
+        if (count_ % STRIDE == 0) marks_.push_back(nextFree);
+        return true;
+    });
+}
+
+bool MatchIndex::current(const TextModel& text, const Pattern& pattern) const {
+    return built_ && version_ == text.version() && needle_ == pattern.text();
+}
+
+void MatchIndex::clear() {
+    std::vector<size_t>().swap(marks_);
+    needle_.clear();
+    count_ = 0;
+    built_ = false;
+}
+
+size_t MatchIndex::countBefore(const TextModel& text, const Pattern& pattern, size_t to) const {
+    // 結尾不超過 to 的最後一個記錄；之後的相符從該記錄的結尾開始不重疊地往後數
+    std::vector<size_t>::const_iterator it = std::upper_bound(marks_.begin(), marks_.end(), to);
+    size_t index = (size_t)(it - marks_.begin());
+    size_t from = index > 0 ? marks_[index - 1] : 0;
+    size_t m = pattern.length();
+    size_t count = index * STRIDE;
+    size_t nextFree = from;
+    forEachMatch(text, pattern, from, to, [&](size_t pos) {
+        if (pos < nextFree) return true;
+        count++;
+        nextFree = pos + m;
+        return true;
+    });
+    return count;
+}
+
+}
@@ -0,0 +1,82 @@
+// text_search.h - 暫放區文字搜尋：Horspool 演算法，跳躍表以雜湊索引（可攜式，不依賴 Windows API）
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include "text_model.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace TextSearch {
+    // 搜尋字串的預處理結果
+    // - 中日韓文字的字元範圍很大，無法像 ASCII 一樣以字元直接索引跳躍表，
+    //   因此以雜湊把字元分到 256 格；同一格取最小位移，仍保證不會跳過任何相符位置
+    // - 單一字元時直接逐一比對第一個字元
+    // 比對區分大小寫，不做任何正規化
+    class Pattern {
+    public:
+        explicit Pattern(const std::wstring& needle);
+
+        const std::wstring& text() const { return needle_; }
+        size_t length() const { return needle_.size(); }
+        bool empty() const { return needle_.empty(); }
+
+        // 在連續記憶體 data[from, size) 中找第一個相符位置；找不到時回傳 TextModel::npos
+        size_t find(const wchar_t* data, size_t size, size_t from = 0) const;
+
+    private:
+        static size_t bucket(wchar_t ch) { return ((uint32_t)ch * 2654435761u) >> 24; }
+
+        std::wstring needle_;
+        size_t skip_[256];
+    };
+
+    // 依序回呼 [from, to) 內所有相符的起點（可重疊）；回呼回傳 false 時停止
+    // 直接在片段表的各片段上搜尋，只有跨片段邊界的少數字元需要另外複製
+    typedef std::function<bool(size_t)> MatchVisitor;
+    void forEachMatch(const TextModel& text, const Pattern& pattern, size_t from, size_t to,
+                      const MatchVisitor& visit);
+
+    // 從 from（含）往後第一個相符位置；找不到回傳 npos
+    size_t findNext(const TextModel& text, const Pattern& pattern, size_t from);
+    // 起點在 before 之前的最後一個相符位置；找不到回傳 npos
+    size_t findPrev(const TextModel& text, const Pattern& pattern, size_t before);
+
+    // [from, to) 內不重疊的相符位置（由左至右取），最多 limit 個
+    void findAll(const TextModel& text, const Pattern& pattern, size_t from, size_t to,
+                 std::vector<size_t>& matches, size_t limit = TextModel::npos);
+    // 全文不重疊的相符數量
+    size_t countMatches(const TextModel& text, const Pattern& pattern);
+
+    // 全文不重疊相符的稀疏索引：每 STRIDE 個相符記下結尾位置
+    // - 建立一次為 O(n)，之後「某位置之前有幾個相符」只需從最近的記錄往後搜尋一小段
+    // - 記住建立時的搜尋字串與文字修改次數，文字或搜尋字串改變後需要重新建立
+    // 記憶體約為相符數 / STRIDE 個位置
+    class MatchIndex {
+    public:
+        static const size_t STRIDE = 64;
+
+        MatchIndex() : count_(0), version_(0), built_(false) {}
+
+        void build(const TextModel& text, const Pattern& pattern);
+        // 是否為 text 目前內容與 pattern 建立的索引
+        bool current(const TextModel& text, const Pattern& pattern) const;
+        void clear();
+
+        // 全文不重疊的相符數量（與 countMatches 相同）
+        size_t count() const { return count_; }
+        // 完全位於 [0, to) 內的不重疊相符數量（與 findAll(0, to) 的數量相同）
+        size_t countBefore(const TextModel& text, const Pattern& pattern, size_t to) const;
+
+    private:
+        std::wstring needle_;
+        std::vector<size_t> marks_;   // marks_[i]：第 (i + 1) * STRIDE 個相符的結尾
+        size_t count_;
+        uint64_t version_;
+        bool built_;
+    };
+}
+
+#endif // TEXT_SEARCH_H
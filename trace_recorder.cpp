@@ -0,0 +1,244 @@
+// trace_recorder.cpp - 按鍵軌跡錄製與無視窗重播實作
+#include "trace_recorder.h"
+#include "utf8_codec.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+// ===== 記憶體配置計數 =====
+// 取代全域 operator new/delete：平時只多一次旗標讀取，重播時才累計次數與大小
+static std::atomic<bool> g_countAllocations(false);
+static std::atomic<uint64_t> g_allocCount(0);
+static std::atomic<uint64_t> g_allocBytes(0);
+
+static void* countedAlloc(size_t size) {
+    if (g_countAllocations.load(std::memory_order_relaxed)) {
+        g_allocCount.fetch_add(1, std::memory_order_relaxed);
+        g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (size == 0) size = 1;
+    for (;;) {
+        void* p = std::malloc(size);
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+
+namespace TraceRecorder {
+
+static const char* TRACE_HEADER = "# stroke-ime trace v1";
+
+static std::ofstream g_traceFile;
+static bool g_recording = false;
+static bool g_replaying = false;
+static uint32_t g_recordedCount = 0;
+static int g_scopeDepth = 0;
+static std::chrono::steady_clock::time_point g_recordStart;
+
+static const char* EVENT_NAMES[EVT_TYPE_COUNT] = {
+    "SYNC", "STROKE", "SELECT", "PAGE", "TOGGLE_MODE", "INPUT_BACK", "CANCEL",
+    "BUFFER_INSERT", "BUFFER_DELETE", "BUFFER_DELETE_SELECTION", "BUFFER_MOVE", "BUFFER_CURSOR"
+};
+
+const char* eventName(EventType type) {
+    if (type < 0 || type >= EVT_TYPE_COUNT) return "UNKNOWN";
+    return EVENT_NAMES[type];
+}
+
+static bool parseEventName(const std::string& name, EventType& type) {
+    for (int i = 0; i < EVT_TYPE_COUNT; i++) {
+        if (name == EVENT_NAMES[i]) {
+            type = (EventType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 文字欄位以 \\、\t、\n、\r 跳脫，確保一行一個事件
+static std::string escapeText(const std::wstring& text) {
+    std::string utf8 = Utf8Codec::encode(text);
+    std::string out;
+    out.reserve(utf8.size());
+    for (char c : utf8) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '\t': out += "\\t"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            default: out += c; break;
+        }
+    }
+    return out;
+}
+
+static std::wstring unescapeText(const std::string& field) {
+    std::string utf8;
+    utf8.reserve(field.size());
+    for (size_t i = 0; i < field.size(); i++) {
+        if (field[i] == '\\' && i + 1 < field.size()) {
+            char next = field[++i];
+            switch (next) {
+                case 't': utf8 += '\t'; break;
+                case 'n': utf8 += '\n'; break;
+                case 'r': utf8 += '\r'; break;
+                default: utf8 += next; break;
+            }
+        } else {
+            utf8 += field[i];
+        }
+    }
+    return Utf8Codec::decode(utf8);
+}
+
+bool start(const char* path) {
+    if (g_recording) stop();
+
+    g_traceFile.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!g_traceFile.is_open()) return false;
+
+    g_traceFile << TRACE_HEADER << "\n";
+    g_recording = true;
+    g_recordedCount = 0;
+    g_recordStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+void stop() {
+    if (!g_recording) return;
+    g_recording = false;
+    g_traceFile.flush();
+    g_traceFile.close();
+}
+
+bool isRecording() {
+    return g_recording;
+}
+
+uint32_t recordedCount() {
+    return g_recordedCount;
+}
+
+void record(EventType type, int arg1, int arg2, const std::wstring& text) {
+    if (!g_recording || g_replaying) return;
+
+    uint32_t elapsedMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - g_recordStart).count();
+
+    // 時間\t類型\targ1\targ2\t文字
+    g_traceFile << elapsedMs << '\t' << eventName(type) << '\t'
+                << arg1 << '\t' << arg2 << '\t' << escapeText(text) << '\n';
+    g_recordedCount++;
+
+    // 定期寫出，避免程式異常結束時遺失整段軌跡
+    if ((g_recordedCount & 63) == 0) g_traceFile.flush();
+}
+
+Scope::Scope(EventType type, int arg1, int arg2, const std::wstring& text) {
+    if (g_scopeDepth++ == 0) record(type, arg1, arg2, text);
+}
+
+Scope::~Scope() {
+    g_scopeDepth--;
+}
+
+bool loadTrace(const char* path, std::vector<TraceEvent>& events) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    events.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (line.empty() || line[0] == '#') continue;
+
+        // 依 tab 切成五個欄位（文字欄位可為空）
+        std::string fields[5];
+        size_t fieldCount = 0;
+        size_t begin = 0;
+        while (fieldCount < 5) {
+            size_t tab = (fieldCount < 4) ? line.find('\t', begin) : std::string::npos;
+            fields[fieldCount++] = line.substr(begin, tab == std::string::npos ? std::string::npos : tab - begin);
+            if (tab == std::string::npos) break;
+            begin = tab + 1;
+        }
+        if (fieldCount < 4) continue;
+
+        TraceEvent ev;
+        if (!parseEventName(fields[1], ev.type)) continue;
+        ev.timeMs = (uint32_t)strtoul(fields[0].c_str(), nullptr, 10);
+        ev.arg1 = (int)strtol(fields[2].c_str(), nullptr, 10);
+        ev.arg2 = (int)strtol(fields[3].c_str(), nullptr, 10);
+        if (fieldCount == 5) ev.text = unescapeText(fields[4]);
+        events.push_back(ev);
+    }
+    return true;
+}
+
+void replay(const std::vector<TraceEvent>& events, ReplayTarget& target, ReplayResult& result) {
+    result.latency.reset();
+    result.eventCount = 0;
+
+    g_replaying = true;
+    g_allocCount.store(0, std::memory_order_relaxed);
+    g_allocBytes.store(0, std::memory_order_relaxed);
+    g_countAllocations.store(true, std::memory_order_relaxed);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < events.size(); i++) {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        target.apply(events[i]);
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - t0;
+        result.latency.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        result.eventCount++;
+    }
+    result.totalNanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    g_countAllocations.store(false, std::memory_order_relaxed);
+    result.allocCount = g_allocCount.load(std::memory_order_relaxed);
+    result.allocBytes = g_allocBytes.load(std::memory_order_relaxed);
+    g_replaying = false;
+}
+
+bool isReplaying() {
+    return g_replaying;
+}
+
+std::string formatResult(const ReplayResult& result) {
+    std::string report;
+    char line[256];
+
+    double totalMs = result.totalNanos / 1000000.0;
+    double perEvent = result.eventCount ? (double)result.allocCount / result.eventCount : 0.0;
+
+    snprintf(line, sizeof(line), "events          %10u\n", result.eventCount);
+    report += line;
+    snprintf(line, sizeof(line), "total(ms)       %10.2f\n", totalMs);
+    report += line;
+    snprintf(line, sizeof(line), "p50(us)         %10.1f\n", result.latency.percentile(50.0) / 1000.0);
+    report += line;
+    snprintf(line, sizeof(line), "p99(us)         %10.1f\n", result.latency.percentile(99.0) / 1000.0);
+    report += line;
+    snprintf(line, sizeof(line), "max(us)         %10.1f\n", result.latency.maxValue() / 1000.0);
+    report += line;
+    snprintf(line, sizeof(line), "allocs          %10llu\n", (unsigned long long)result.allocCount);
+    report += line;
+    snprintf(line, sizeof(line), "alloc bytes     %10llu\n", (unsigned long long)result.allocBytes);
+    report += line;
+    snprintf(line, sizeof(line), "allocs/event    %10.1f\n", perEvent);
+    report += line;
+    return report;
+}
+
+} // namespace TraceRecorder
@@ -0,0 +1,97 @@
+// trace_recorder.h - 按鍵軌跡錄製與無視窗重播（可攜式，不依賴 Windows API）
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "latency_stats.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 錄製到達引擎的語意事件（筆劃、選字、翻頁、模式切換、暫放區編輯），
+// 重播時依序交給 ReplayTarget 執行，得到可重現的延遲與記憶體配置數據。
+// 錄製與重播都只在主執行緒（鍵盤鉤子所在的訊息迴圈）進行。
+namespace TraceRecorder {
+    enum EventType {
+        EVT_SYNC = 0,              // 狀態同步：arg1=模式旗標，arg2=游標位置，text=暫放文字
+        EVT_STROKE,                // 筆劃鍵：arg1=虛擬鍵碼
+        EVT_SELECT,                // 選字：arg1=頁內索引
+        EVT_PAGE,                  // 翻頁：arg1=方向
+        EVT_TOGGLE_MODE,           // 中英切換
+        EVT_INPUT_BACK,            // 字碼退格
+        EVT_CANCEL,                // 取消輸入（Esc）
+        EVT_BUFFER_INSERT,         // 暫放區插入：text=插入文字
+        EVT_BUFFER_DELETE,         // 暫放區刪除字元：arg1=1 表示向後刪除（Delete）
+        EVT_BUFFER_DELETE_SELECTION, // 刪除選取：arg1=起點，arg2=終點
+        EVT_BUFFER_MOVE,           // 游標移動：arg1=方向
+        EVT_BUFFER_CURSOR,         // 游標定位：arg1=位置
+        EVT_TYPE_COUNT
+    };
+
+    // EVT_SYNC 的模式旗標
+    enum SyncFlag {
+        SYNC_CHINESE_MODE = 1 << 0,
+        SYNC_BUFFER_MODE  = 1 << 1
+    };
+
+    struct TraceEvent {
+        uint32_t timeMs;     // 相對於錄製開始的毫秒數（重播時不等待，只供參考）
+        EventType type;
+        int arg1;
+        int arg2;
+        std::wstring text;
+        TraceEvent() : timeMs(0), type(EVT_SYNC), arg1(0), arg2(0) {}
+    };
+
+    // ===== 錄製 =====
+    // 開始錄製到指定檔案（覆寫），失敗回傳 false
+    bool start(const char* path);
+    void stop();
+    bool isRecording();
+    uint32_t recordedCount();
+
+    // 記錄一個事件（未錄製或重播中時忽略）
+    void record(EventType type, int arg1 = 0, int arg2 = 0, const std::wstring& text = std::wstring());
+
+    // 巢狀作用域：外層已記錄時內層不再記錄
+    // 例如 selectCandidate 內部呼叫 insertTextAtCursor，只記錄 EVT_SELECT
+    class Scope {
+    public:
+        Scope(EventType type, int arg1 = 0, int arg2 = 0, const std::wstring& text = std::wstring());
+        ~Scope();
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+
+    // ===== 載入與重播 =====
+    // 讀取軌跡檔，格式錯誤的行會被略過；無法開啟檔案時回傳 false
+    bool loadTrace(const char* path, std::vector<TraceEvent>& events);
+
+    const char* eventName(EventType type);
+
+    // 重播目標：由呼叫端把事件對應到實際的引擎函式
+    class ReplayTarget {
+    public:
+        virtual ~ReplayTarget() {}
+        virtual void apply(const TraceEvent& ev) = 0;
+    };
+
+    struct ReplayResult {
+        uint32_t eventCount;
+        uint64_t totalNanos;
+        uint64_t allocCount;       // 重播期間 operator new 呼叫次數
+        uint64_t allocBytes;       // 重播期間配置的位元組總數
+        LatencyStats::Histogram latency;    // 每個事件的處理時間（奈秒）
+        ReplayResult() : eventCount(0), totalNanos(0), allocCount(0), allocBytes(0) {}
+    };
+
+    // 依序重播所有事件（不依錄製時間等待），重播期間 isReplaying() 為 true
+    void replay(const std::vector<TraceEvent>& events, ReplayTarget& target, ReplayResult& result);
+    bool isReplaying();
+
+    // 產生重播報表（ASCII）
+    std::string formatResult(const ReplayResult& result);
+}
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,223 @@
+// trace_replay.cpp - 無視窗前端：與 Win32 前端相同的輸入與暫放區操作，用於錄製測試與重播量測
+#include "trace_replay.h"
+#include <algorithm>
+
+using namespace TraceRecorder;
+
+namespace TraceReplay {
+
+Frontend::Frontend(const EngineCore::Model& model, time_t now)
+    : model_(model), now_(now), wordPrediction_(true), chineseMode_(true), bufferMode_(true), cursor_(0) {}
+
+void Frontend::sync(int flags, int cursor, const std::wstring& text) {
+    Scope trace(EVT_SYNC, flags, cursor, text);
+    chineseMode_ = (flags & SYNC_CHINESE_MODE) != 0;
+    bufferMode_ = (flags & SYNC_BUFFER_MODE) != 0;
+    buffer_.clear();
+    buffer_.append(text);
+    layout_.invalidate();
+    history_.clear();
+    setCursor(cursor);
+}
+
+// 對應 InputHandler::processStroke（數字鍵台的虛擬鍵碼：0x60 為 VK_NUMPAD0）
+void Frontend::processStroke(int key) {
+    if (!chineseMode_) return;
+    Scope trace(EVT_STROKE, key);
+    if (key == 'P') {
+        // 標點選單（InputHandler::showPunctMenu）
+        session_.showPunctMenu = true;
+        session_.candidates = model_.punctCandidates;
+        session_.candidateCodes.assign(session_.candidates.size(), L"P");
+        session_.selected = 0;
+        session_.currentPage = 0;
+        session_.totalPages = ((int)session_.candidates.size() + EngineCore::CANDIDATES_PER_PAGE - 1) /
+                              EngineCore::CANDIDATES_PER_PAGE;
+        session_.showCand = true;
+        candidatesChanged();
+        return;
+    }
+    wchar_t inputChar = 0;
+    switch (key) {
+        case 'U': case 0x67: inputChar = L'u'; break;
+        case 'I': case 0x68: inputChar = L'i'; break;
+        case 'O': case 0x69: inputChar = L'o'; break;
+        case 'J': case 0x64: inputChar = L'j'; break;
+        case 'K': case 0x65: inputChar = L'k'; break;
+        case 'L': case 0x60: inputChar = L'*'; break;
+    }
+    if (inputChar) {
+        session_.input += inputChar;
+        updateCandidates();
+    }
+}
+
+// 對應 Dictionary::selectCandidate
+void Frontend::selectCandidate(int idx) {
+    int actualIndex = session_.currentPage * EngineCore::CANDIDATES_PER_PAGE + idx;
+    if (actualIndex < 0 || actualIndex >= (int)session_.candidates.size()) return;
+    Scope trace(EVT_SELECT, idx);
+    std::wstring selected = session_.candidates[actualIndex];
+
+    bool isPredictionMode = (actualIndex < (int)session_.candidateCodes.size() &&
+                             (session_.candidateCodes[actualIndex] == L"聯想" ||
+                              session_.candidateCodes[actualIndex] == L"常用" ||
+                              session_.candidateCodes[actualIndex] == L"詞語"));
+
+    // 非暫放模式的文字送到目標程式：重播時沒有目標，只保留學習
+    if (bufferMode_) insertTextAtCursor(selected);
+    if (!session_.showPunctMenu) EngineCore::learn(learning_, selected, now_);
+
+    if (session_.showPunctMenu) {
+        EngineCore::endInput(session_);
+        return;
+    }
+    if ((isPredictionMode || !EngineCore::isPunctuation(selected)) && wordPrediction_) {
+        session_.input.clear();
+        session_.inputError = false;
+        showPredictions(selected);
+        return;
+    }
+    EngineCore::endInput(session_);
+}
+
+// 對應 Dictionary::changePage
+void Frontend::changePage(int direction) {
+    if (!session_.showCand || session_.totalPages <= 1) return;
+    Scope trace(EVT_PAGE, direction);
+    EngineCore::changePage(session_, direction);
+}
+
+void Frontend::toggleInputMode() {
+    Scope trace(EVT_TOGGLE_MODE);
+    chineseMode_ = !chineseMode_;
+    EngineCore::endInput(session_);
+}
+
+void Frontend::backspaceInput() {
+    if (session_.input.empty()) return;
+    Scope trace(EVT_INPUT_BACK);
+    session_.input.erase(session_.input.size() - 1);
+    updateCandidates();
+}
+
+void Frontend::cancelInput() {
+    Scope trace(EVT_CANCEL);
+    EngineCore::endInput(session_);
+}
+
+// 對應 BufferManager::insertTextAtCursor
+void Frontend::insertTextAtCursor(const std::wstring& text) {
+    Scope trace(EVT_BUFFER_INSERT, 0, 0, text);
+    clampCursor();
+    int insertPos = cursor_;
+    buffer_.insert(insertPos, text);
+    cursor_ += (int)text.length();
+    layout_.onEdit(buffer_, insertPos, 0, text.length());
+    history_.recordInsert(insertPos, text, insertPos, cursor_);
+}
+
+// 對應 BufferManager::deleteCharAtCursor（沒有選取狀態：刪除選取以 deleteSelection 重播）
+void Frontend::deleteCharAtCursor(bool forward) {
+    if (buffer_.empty()) return;
+    Scope trace(EVT_BUFFER_DELETE, forward ? 1 : 0);
+    int cursorBefore = cursor_;
+    if (forward) {
+        if (cursor_ < (int)buffer_.length()) {
+            std::wstring removed(1, buffer_[cursor_]);
+            buffer_.erase(cursor_, 1);
+            layout_.onEdit(buffer_, cursor_, 1, 0);
+            history_.recordErase(cursor_, removed, cursorBefore, cursor_);
+        }
+    } else if (cursor_ > 0) {
+        std::wstring removed(1, buffer_[cursor_ - 1]);
+        buffer_.erase(cursor_ - 1, 1);
+        cursor_--;
+        layout_.onEdit(buffer_, cursor_, 1, 0);
+        history_.recordErase(cursor_, removed, cursorBefore, cursor_);
+    }
+}
+
+// 對應 BufferManager::deleteSelection
+void Frontend::deleteSelection(int start, int end) {
+    Scope trace(EVT_BUFFER_DELETE_SELECTION, start, end);
+    int from = std::min(start, end);
+    int to = std::max(start, end);
+    if (from < 0 || to > (int)buffer_.length()) return;
+    std::wstring removed = buffer_.substr(from, to - from);
+    int cursorBefore = cursor_;
+    buffer_.erase(from, to - from);
+    cursor_ = from;
+    layout_.onEdit(buffer_, from, to - from, 0);
+    history_.breakGroup();
+    history_.recordErase(from, removed, cursorBefore, from);
+    history_.breakGroup();
+}
+
+void Frontend::moveCursor(int direction) {
+    Scope trace(EVT_BUFFER_MOVE, direction);
+    history_.breakGroup();
+    setCursor(cursor_ + direction);
+}
+
+void Frontend::setCursor(int pos) {
+    cursor_ = pos;
+    clampCursor();
+}
+
+void Frontend::apply(const TraceEvent& ev) {
+    switch (ev.type) {
+        case EVT_SYNC: sync(ev.arg1, ev.arg2, ev.text); break;
+        case EVT_STROKE: processStroke(ev.arg1); break;
+        case EVT_SELECT: selectCandidate(ev.arg1); break;
+        case EVT_PAGE: changePage(ev.arg1); break;
+        case EVT_TOGGLE_MODE: toggleInputMode(); break;
+        case EVT_INPUT_BACK: backspaceInput(); break;
+        case EVT_CANCEL: cancelInput(); break;
+        case EVT_BUFFER_INSERT: insertTextAtCursor(ev.text); break;
+        case EVT_BUFFER_DELETE: deleteCharAtCursor(ev.arg1 != 0); break;
+        case EVT_BUFFER_DELETE_SELECTION: deleteSelection(ev.arg1, ev.arg2); break;
+        case EVT_BUFFER_MOVE: moveCursor(ev.arg1); break;
+        case EVT_BUFFER_CURSOR: setCursor(ev.arg1); break;
+        default: break;
+    }
+}
+
+void Frontend::updateCandidates() {
+    EngineCore::lookup(model_, learning_, session_);
+    candidatesChanged();
+}
+
+// 對應 Dictionary::showPredictionsAfterSelection
+void Frontend::showPredictions(const std::wstring& selected) {
+    if (selected.empty() || EngineCore::isPunctuation(selected)) return;
+    EngineCore::predict(model_, learning_, session_, selected);
+    if (session_.candidates.empty()) {
+        session_.showCand = false;
+        session_.isInputting = false;
+    } else {
+        session_.selected = 0;
+        session_.currentPage = 0;
+        session_.totalPages = ((int)session_.candidates.size() + EngineCore::CANDIDATES_PER_PAGE - 1) /
+                              EngineCore::CANDIDATES_PER_PAGE;
+        session_.showCand = true;
+        session_.isInputting = true;
+    }
+    candidatesChanged();
+}
+
+void Frontend::clampCursor() {
+    if (cursor_ < 0) cursor_ = 0;
+    if (cursor_ > (int)buffer_.length()) cursor_ = (int)buffer_.length();
+}
+
+bool replayFile(const char* path, ReplayTarget& target, ReplayResult& result) {
+    std::vector<TraceEvent> events;
+    if (!loadTrace(path, events) || events.empty()) return false;
+    LatencyStats::setEnabled(false);
+    replay(events, target, result);
+    LatencyStats::setEnabled(true);
+    return true;
+}
+
+} // namespace TraceReplay
@@ -0,0 +1,83 @@
+// trace_replay.h - 以引擎核心與暫放區文字模型重播按鍵軌跡的無視窗前端（可攜式，不依賴 Windows API）
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include "edit_history.h"
+#include "engine_core.h"
+#include "text_layout.h"
+#include "text_model.h"
+#include "trace_recorder.h"
+#include <ctime>
+#include <string>
+#include <vector>
+
+// 與 Win32 前端（InputHandler、Dictionary、BufferManager）相同的操作與條件，但沒有視窗、
+// 剪貼簿與共用字典服務：非暫放模式的選字不送出，暫放區的編輯同樣更新排版與復原記錄。
+// 每個操作以 TraceRecorder::Scope 記錄（只記外層），因此可用來錄製，也可作為重播目標；
+// 學習使用建構時的時間，同一份軌跡重播兩次得到相同的結果
+namespace TraceReplay {
+    class Frontend : public TraceRecorder::ReplayTarget {
+    public:
+        Frontend(const EngineCore::Model& model, time_t now);
+        virtual ~Frontend() {}
+
+        // 選字後顯示聯想字（預設開啟，與設定檔的預設相同）
+        void setWordPrediction(bool enabled) { wordPrediction_ = enabled; }
+        // 以用戶字典的記錄作為起始的學習狀態
+        void loadLearning(const DictFiles::UserEntries& entries) { EngineCore::loadLearning(learning_, entries, now_); }
+
+        // 輸入（InputHandler、Dictionary）
+        void sync(int flags, int cursor, const std::wstring& text);
+        void processStroke(int key);
+        void selectCandidate(int idx);
+        void changePage(int direction);
+        void toggleInputMode();
+        void backspaceInput();
+        void cancelInput();
+
+        // 暫放區（BufferManager）
+        void insertTextAtCursor(const std::wstring& text);
+        void deleteCharAtCursor(bool forward);
+        void deleteSelection(int start, int end);
+        void moveCursor(int direction);
+        void setCursor(int pos);
+
+        void apply(const TraceRecorder::TraceEvent& ev);
+
+        const EngineCore::Session& session() const { return session_; }
+        const EngineCore::Learning& learning() const { return learning_; }
+        bool chineseMode() const { return chineseMode_; }
+        bool bufferMode() const { return bufferMode_; }
+        const TextModel& buffer() const { return buffer_; }
+        int cursor() const { return cursor_; }
+        const EditHistory& history() const { return history_; }
+
+    protected:
+        // 候選字更新後（查詢、聯想、標點選單）呼叫；測試以此記錄每次的候選字
+        virtual void candidatesChanged() {}
+
+    private:
+        void updateCandidates();
+        void showPredictions(const std::wstring& selected);
+        void clampCursor();
+
+        const EngineCore::Model& model_;
+        time_t now_;
+        bool wordPrediction_;
+        bool chineseMode_;
+        bool bufferMode_;
+        EngineCore::Learning learning_;
+        EngineCore::Session session_;
+        TextModel buffer_;
+        TextLayout layout_;
+        EditHistory history_;
+        int cursor_;
+    };
+
+    // 載入軌跡並重播到 target；重播期間停用延遲統計，不混入正常輸入的數據
+    // 軌跡無法讀取或沒有事件時回傳 false
+    bool replayFile(const char* path, TraceRecorder::ReplayTarget& target,
+                    TraceRecorder::ReplayResult& result);
+}
+
+#endif // TRACE_REPLAY_H
@@ -6,6 +6,7 @@
 #include "position_manager.h"
 #include "screen_manager.h"
 #include "dictionary.h"
+#include "trace_recorder.h"
 
 // 前向宣告
 extern TrayManager::TrayIconData g_trayIcon;
@@ -94,6 +95,9 @@ void showTrayMenu(HWND hwnd, GlobalState& state) {
     
     AppendMenu(hMenu, MF_STRING, 2006, L"🔄 重新載入配置");
     AppendMenu(hMenu, MF_STRING, 2013, L"⬇️ 從GitHub更新字碼表");
+    AppendMenu(hMenu, MF_STRING, 2014, L"📊 按鍵延遲統計");
+    AppendMenu(hMenu, MF_STRING, 2015, TraceRecorder::isRecording() ? L"⏹️ 停止錄製按鍵軌跡" : L"⏺️ 錄製按鍵軌跡");
+    AppendMenu(hMenu, MF_STRING, 2016, L"⏱️ 重播按鍵軌跡");
     
     AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
     
@@ -0,0 +1,214 @@
+// update_service.cpp - 背景更新工作的佇列、重試與取消實作
+#include "update_service.h"
+#include <utility>
+#include <vector>
+
+namespace UpdateService {
+
+int backoffDelay(const RetryPolicy& policy, int failures) {
+    long long delay = policy.initialDelayMs;
+    for (int i = 1; i < failures && delay < policy.maxDelayMs; i++) delay *= 2;
+    return (int)(delay < policy.maxDelayMs ? delay : policy.maxDelayMs);
+}
+
+Context::Context(Service& service, Result& result, const Progress& start)
+    : service_(service), result_(result), progress_(start), notified_(false) {}
+
+bool Context::cancelled() const {
+    return service_.cancelRequested();
+}
+
+void Context::progress(uint64_t done, long long total) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    bool complete = total >= 0 && done >= (uint64_t)total;
+    // 下載每收到一段就會呼叫：限制通知的頻率，避免介面執行緒忙著更新狀態列
+    if (notified_ && !complete && now - lastNotify_ < std::chrono::milliseconds(PROGRESS_INTERVAL_MS)) return;
+    notified_ = true;
+    lastNotify_ = now;
+    progress_.done = done;
+    progress_.total = total;
+    if (service_.progress_) service_.progress_(progress_);
+}
+
+void Context::stage(const std::wstring& message) {
+    progress_.message = message;
+    progress_.done = 0;
+    progress_.total = -1;
+    notified_ = false;
+    if (service_.progress_) service_.progress_(progress_);
+}
+
+Service::Service(const ProgressCallback& progress, const ReadyCallback& ready)
+    : progress_(progress), ready_(ready), nextId_(1), currentId_(0), currentKind_(JOB_MAIN_DICT),
+      stopping_(false), cancelCurrent_(false) {
+    worker_ = std::thread(&Service::workerLoop, this);
+}
+
+Service::~Service() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        cancelCurrent_ = true;
+        queue_.clear();
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+int Service::submit(JobKind kind, const Work& work, const RetryPolicy& policy) {
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (currentId_ && currentKind_ == kind) return currentId_;
+        for (size_t i = 0; i < queue_.size(); i++) {
+            if (queue_[i].kind == kind) return queue_[i].id;
+        }
+        Job job;
+        id = nextId_++;
+        job.id = id;
+        job.kind = kind;
+        job.work = work;
+        job.policy = policy;
+        queue_.push_back(job);
+    }
+    wake_.notify_all();
+    return id;
+}
+
+bool Service::cancel(int jobId) {
+    if (jobId <= 0) return false;
+    Result cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (jobId == currentId_) {
+            // 執行中：工作自行檢查旗標結束；等待重試時立刻叫醒
+            cancelCurrent_ = true;
+            wake_.notify_all();
+            return true;
+        }
+        std::deque<Job>::iterator it = queue_.begin();
+        while (it != queue_.end() && it->id != jobId) ++it;
+        if (it == queue_.end()) return false;
+        cancelled.jobId = it->id;
+        cancelled.kind = it->kind;
+        cancelled.status = STATUS_CANCELLED;
+        queue_.erase(it);
+        results_.push_back(std::move(cancelled));
+    }
+    if (ready_) ready_();
+    return true;
+}
+
+void Service::cancelAll() {
+    std::vector<int> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (currentId_) ids.push_back(currentId_);
+        for (size_t i = 0; i < queue_.size(); i++) ids.push_back(queue_[i].id);
+    }
+    for (size_t i = 0; i < ids.size(); i++) cancel(ids[i]);
+}
+
+int Service::pendingJob(JobKind kind) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (currentId_ && currentKind_ == kind) return currentId_;
+    for (size_t i = 0; i < queue_.size(); i++) {
+        if (queue_[i].kind == kind) return queue_[i].id;
+    }
+    return 0;
+}
+
+bool Service::take(Result& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (results_.empty()) return false;
+    result = std::move(results_.front());
+    results_.pop_front();
+    return true;
+}
+
+bool Service::cancelRequested() const {
+    return cancelCurrent_.load();
+}
+
+void Service::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+            if (stopping_) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+            currentId_ = job.id;
+            currentKind_ = job.kind;
+            cancelCurrent_ = false;
+        }
+        runJob(job);
+    }
+}
+
+void Service::runJob(Job& job) {
+    Result result;
+    for (int attempt = 1; ; attempt++) {
+        // 每次嘗試都從空白的結果開始，失敗的嘗試留下的部分資料不會混進來
+        Result current;
+        current.jobId = job.id;
+        current.kind = job.kind;
+        Progress start;
+        start.jobId = job.id;
+        start.kind = job.kind;
+        start.attempt = attempt;
+
+        Attempt outcome;
+        {
+            Context context(*this, current, start);
+            try {
+                outcome = job.work(context);
+            } catch (...) {
+                outcome = ATTEMPT_FAILED;
+                current.message = L"更新工作發生例外";
+            }
+        }
+        result = std::move(current);
+        result.attempts = attempt;
+
+        if (cancelRequested()) {
+            result.status = STATUS_CANCELLED;
+            break;
+        }
+        if (outcome == ATTEMPT_DONE) {
+            result.status = STATUS_SUCCEEDED;
+            break;
+        }
+        if (outcome == ATTEMPT_FAILED || attempt >= job.policy.maxAttempts) {
+            result.status = STATUS_FAILED;
+            break;
+        }
+
+        // 暫時性錯誤：等待後重試，等待中可被取消或結束
+        int delay = backoffDelay(job.policy, attempt);
+        Progress waiting = start;
+        waiting.retryDelayMs = delay;
+        waiting.message = result.message;
+        if (progress_) progress_(waiting);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wake_.wait_for(lock, std::chrono::milliseconds(delay), [this] { return cancelCurrent_.load(); })) {
+            result.status = STATUS_CANCELLED;
+            break;
+        }
+    }
+    finish(result);
+}
+
+void Service::finish(Result& result) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        currentId_ = 0;
+        if (stopping_) return;
+        results_.push_back(std::move(result));
+    }
+    if (ready_) ready_();
+}
+
+}
@@ -0,0 +1,167 @@
+// update_service.h - 背景更新工作的佇列、重試與取消（可攜式，不依賴 Windows API）
+#ifndef UPDATE_SERVICE_H
+#define UPDATE_SERVICE_H
+
+#include "dict_delta.h"
+#include "dict_files.h"
+#include "dict_model.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 下載字碼表、詞語庫與檢查版本都在一個更新執行緒依序進行，介面執行緒只送出工作、取走結果：
+// - 工作回報暫時性錯誤時依指數退避等待後重試，等待中可隨時取消
+// - 執行中的工作以 Context::cancelled() 得知取消（下載時每收到一段資料檢查一次）
+// - 進度與完成都以回呼通知（在更新執行緒呼叫，通常只負責通知介面執行緒），結果以 take 取走
+namespace UpdateService {
+    enum JobKind {
+        JOB_MAIN_DICT,          // 字碼表
+        JOB_WORD_PHRASES,       // 詞語庫
+        JOB_VERSION,            // 版本檢查
+        JOB_KIND_COUNT
+    };
+
+    // 一次嘗試的結果
+    enum Attempt {
+        ATTEMPT_DONE,           // 完成
+        ATTEMPT_RETRY,          // 暫時性錯誤（網路中斷、伺服器忙碌），稍後重試
+        ATTEMPT_FAILED          // 重試也不會成功的錯誤
+    };
+
+    enum Status {
+        STATUS_SUCCEEDED,
+        STATUS_FAILED,
+        STATUS_CANCELLED
+    };
+
+    struct RetryPolicy {
+        int maxAttempts;        // 包含第一次
+        int initialDelayMs;     // 第一次失敗後的等待時間，之後每次加倍
+        int maxDelayMs;
+        RetryPolicy() : maxAttempts(4), initialDelayMs(2000), maxDelayMs(60000) {}
+    };
+    // 第 failures 次失敗後的等待時間（failures 從 1 起算）
+    int backoffDelay(const RetryPolicy& policy, int failures);
+
+    // 工作的產出：依工作種類使用其中的欄位
+    struct Result {
+        int jobId;
+        JobKind kind;
+        Status status;
+        int attempts;
+        int detail;                     // 工作自訂的狀態碼（例如下載狀態）
+        int httpCode;
+        uint64_t size;
+        std::wstring message;
+        DictFiles::CodeTable table;     // 下載時驗證並解析好的字碼表（建立快照後清空）
+        DictModel::Phrases phrases;     // 建好的詞語庫，介面執行緒以 swap 換上
+        int entryCount;
+        DictDelta::Step patch;          // 差異更新套用的變更
+        DictModel::SnapshotPtr snapshot;    // 在更新執行緒建好的字碼表快照，介面執行緒只需發佈
+        DictModel::SnapshotPtr base;        // 差異更新時套用的基準快照（發佈前確認字典沒有被換過）
+        std::string version;
+        Result() : jobId(0), kind(JOB_MAIN_DICT), status(STATUS_FAILED), attempts(0), detail(0),
+                   httpCode(0), size(0), entryCount(0) {}
+    };
+
+    struct Progress {
+        int jobId;
+        JobKind kind;
+        int attempt;            // 第幾次嘗試（從 1 起算）
+        uint64_t done;          // 已傳輸的位元組數
+        long long total;        // 總長度；未知時為 -1
+        int retryDelayMs;       // 大於 0：這次嘗試失敗，等待後重試
+        std::wstring message;   // 目前的步驟或失敗原因
+        Progress() : jobId(0), kind(JOB_MAIN_DICT), attempt(0), done(0), total(-1), retryDelayMs(0) {}
+    };
+
+    class Service;
+
+    // 交給工作函式：回報進度、檢查是否已取消、寫入結果
+    class Context {
+    public:
+        bool cancelled() const;
+        // 傳輸進度（同一個工作最多每 PROGRESS_INTERVAL_MS 通知一次，完成時一定通知）
+        void progress(uint64_t done, long long total);
+        // 目前的步驟（一定通知）
+        void stage(const std::wstring& message);
+        int attempt() const { return progress_.attempt; }
+        Result& result() { return result_; }
+
+    private:
+        friend class Service;
+        Context(Service& service, Result& result, const Progress& start);
+        Context(const Context&);
+        Context& operator=(const Context&);
+
+        Service& service_;
+        Result& result_;
+        Progress progress_;
+        std::chrono::steady_clock::time_point lastNotify_;
+        bool notified_;
+    };
+
+    typedef std::function<Attempt(Context&)> Work;
+
+    static const int PROGRESS_INTERVAL_MS = 200;
+
+    class Service {
+    public:
+        typedef std::function<void(const Progress&)> ProgressCallback;
+        // 有結果可以取走
+        typedef std::function<void()> ReadyCallback;
+
+        Service(const ProgressCallback& progress, const ReadyCallback& ready);
+        // 取消所有工作並等待執行中的工作結束（佇列中的工作不產生結果）
+        ~Service();
+
+        // 加入工作並回傳編號；同種類的工作已在佇列中或執行中時不重複加入，回傳既有的編號
+        int submit(JobKind kind, const Work& work, const RetryPolicy& policy = RetryPolicy());
+        // 取消工作：佇列中的直接移除，執行中或等待重試的盡快結束；都產生 STATUS_CANCELLED 的結果
+        bool cancel(int jobId);
+        void cancelAll();
+        // 同種類在佇列中或執行中的工作編號；沒有時回傳 0
+        int pendingJob(JobKind kind) const;
+        // 取走一個完成的結果；沒有時回傳 false
+        bool take(Result& result);
+
+    private:
+        friend class Context;
+        Service(const Service&);
+        Service& operator=(const Service&);
+
+        struct Job {
+            int id;
+            JobKind kind;
+            Work work;
+            RetryPolicy policy;
+        };
+
+        void workerLoop();
+        void runJob(Job& job);
+        void finish(Result& result);
+        bool cancelRequested() const;
+
+        ProgressCallback progress_;
+        ReadyCallback ready_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        std::deque<Job> queue_;
+        std::deque<Result> results_;
+        int nextId_;
+        int currentId_;
+        JobKind currentKind_;
+        bool stopping_;
+        std::atomic<bool> cancelCurrent_;
+        std::thread worker_;
+    };
+}
+
+#endif // UPDATE_SERVICE_H
@@ -0,0 +1,197 @@
+// utf8_codec.cpp - 可攜式 UTF-8 與寬字串轉換實作
+#include "utf8_codec.h"
+
+namespace Utf8Codec {
+
+static const unsigned int REPLACEMENT_CHAR = 0xFFFD;
+
+static void appendCodePoint(std::string& out, unsigned int cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+static void appendWide(std::wstring& out, unsigned int cp) {
+    if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+        cp -= 0x10000;
+        out += (wchar_t)(0xD800 + (cp >> 10));
+        out += (wchar_t)(0xDC00 + (cp & 0x3FF));
+    } else {
+        out += (wchar_t)cp;
+    }
+}
+
+void appendEncoded(std::string& out, const wchar_t* data, size_t length) {
+    out.reserve(out.size() + length * 3);
+    for (size_t i = 0; i < length; i++) {
+        unsigned int cp = (unsigned int)data[i];
+        if (sizeof(wchar_t) == 2 && cp >= 0xD800 && cp <= 0xDBFF) {
+            if (i + 1 < length) {
+                unsigned int low = (unsigned int)data[i + 1];
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i++;
+                } else {
+                    cp = REPLACEMENT_CHAR;
+                }
+            } else {
+                cp = REPLACEMENT_CHAR;
+            }
+        } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = REPLACEMENT_CHAR;
+        } else if (cp > 0x10FFFF) {
+            cp = REPLACEMENT_CHAR;
+        }
+        appendCodePoint(out, cp);
+    }
+}
+
+void appendDecoded(std::wstring& out, const char* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    size_t i = 0;
+    while (i < length) {
+        unsigned int c = p[i];
+        unsigned int cp;
+        size_t extra;
+        if (c < 0x80) { cp = c; extra = 0; }
+        else if ((c & 0xE0) == 0xC0) { cp = c & 0x1F; extra = 1; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; extra = 2; }
+        else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; extra = 3; }
+        else { appendWide(out, REPLACEMENT_CHAR); i++; continue; }
+
+        // 後續位元組不足或格式錯誤時只跳過前導位元組
+        bool valid = true;
+        for (size_t k = 1; k <= extra; k++) {
+            if (i + k >= length || (p[i + k] & 0xC0) != 0x80) { valid = false; break; }
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        // 拒絕過長編碼與代理區
+        if (valid && ((extra == 1 && cp < 0x80) || (extra == 2 && cp < 0x800) ||
+                      (extra == 3 && (cp < 0x10000 || cp > 0x10FFFF)) ||
+                      (cp >= 0xD800 && cp <= 0xDFFF))) {
+            valid = false;
+        }
+        if (!valid) {
+            appendWide(out, REPLACEMENT_CHAR);
+            i++;
+            continue;
+        }
+        appendWide(out, cp);
+        i += extra + 1;
+    }
+}
+
+// 前導位元組對應的序列長度；0 表示不是有效的前導位元組
+static size_t sequenceLength(unsigned char c) {
+    if (c < 0x80) return 1;
+    if ((c & 0xE0) == 0xC0) return 2;
+    if ((c & 0xF0) == 0xE0) return 3;
+    if ((c & 0xF8) == 0xF0) return 4;
+    return 0;
+}
+
+static bool isContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+void StreamEncoder::feed(std::string& out, const wchar_t* data, size_t length) {
+    if (length == 0) return;
+    if (high_) {
+        wchar_t pair[2] = {high_, data[0]};
+        high_ = 0;
+        bool paired = sizeof(wchar_t) == 2 && (unsigned int)data[0] >= 0xDC00 && (unsigned int)data[0] <= 0xDFFF;
+        appendEncoded(out, pair, paired ? 2 : 1);
+        if (paired) {
+            data++;
+            length--;
+        }
+    }
+    if (length > 0) {
+        unsigned int last = (unsigned int)data[length - 1];
+        if (sizeof(wchar_t) == 2 && last >= 0xD800 && last <= 0xDBFF) {
+            high_ = data[length - 1];
+            length--;
+        }
+    }
+    appendEncoded(out, data, length);
+}
+
+void StreamEncoder::finish(std::string& out) {
+    if (high_) {
+        appendEncoded(out, &high_, 1);
+        high_ = 0;
+    }
+}
+
+void StreamDecoder::feed(std::wstring& out, const char* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    // 先補齊上一段留下的序列
+    if (pendingSize_ > 0) {
+        size_t need = sequenceLength((unsigned char)pending_[0]);
+        while (pendingSize_ < need && length > 0 && isContinuation(*p)) {
+            pending_[pendingSize_++] = (char)*p++;
+            data++;
+            length--;
+        }
+        if (pendingSize_ < need && length == 0) return;
+        appendDecoded(out, pending_, pendingSize_);
+        pendingSize_ = 0;
+    }
+
+    // 結尾不完整的序列留到下一段：往回最多找 3 個位元組內的前導位元組
+    size_t keep = 0;
+    for (size_t back = 1; back <= 3 && back <= length; back++) {
+        unsigned char c = p[length - back];
+        if (isContinuation(c)) continue;
+        if (sequenceLength(c) > back) keep = back;
+        break;
+    }
+    appendDecoded(out, data, length - keep);
+    for (size_t i = 0; i < keep; i++) pending_[i] = data[length - keep + i];
+    pendingSize_ = keep;
+}
+
+void StreamDecoder::finish(std::wstring& out) {
+    if (pendingSize_ > 0) {
+        appendDecoded(out, pending_, pendingSize_);
+        pendingSize_ = 0;
+    }
+}
+
+size_t decodedLength(const char* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isContinuation(p[i])) count++;
+        // UTF-16 中 4 位元組序列解碼為代理對
+        if (sizeof(wchar_t) == 2 && (p[i] & 0xF8) == 0xF0) count++;
+    }
+    return count;
+}
+
+std::string encode(const std::wstring& ws) {
+    std::string out;
+    if (!ws.empty()) appendEncoded(out, ws.data(), ws.size());
+    return out;
+}
+
+std::wstring decode(const std::string& str) {
+    std::wstring out;
+    out.reserve(str.size());
+    if (!str.empty()) appendDecoded(out, str.data(), str.size());
+    return out;
+}
+
+} // namespace Utf8Codec
@@ -0,0 +1,45 @@
+// utf8_codec.h - 可攜式 UTF-8 與寬字串轉換（不依賴 Windows API）
+#ifndef UTF8_CODEC_H
+#define UTF8_CODEC_H
+
+#include <string>
+
+// Windows 上 wchar_t 為 UTF-16，其他平台為 UTF-32，兩者皆支援
+// 無效序列以 U+FFFD 取代
+namespace Utf8Codec {
+    std::string encode(const std::wstring& ws);
+    std::wstring decode(const std::string& str);
+
+    // 附加到既有字串（避免重複配置；解碼時由呼叫端預先配置）
+    void appendEncoded(std::string& out, const wchar_t* data, size_t length);
+    void appendDecoded(std::wstring& out, const char* data, size_t length);
+
+    // 分段編碼：代理對被切在兩段之間時，高位代理留到下一段再編碼
+    class StreamEncoder {
+    public:
+        StreamEncoder() : high_(0) {}
+        void feed(std::string& out, const wchar_t* data, size_t length);
+        // 輸入結束：落單的高位代理以 U+FFFD 取代
+        void finish(std::string& out);
+    private:
+        wchar_t high_;
+    };
+
+    // 分段解碼：多位元組序列被切在兩段之間時，不完整的部分留到下一段再解碼
+    // 任意切段的結果都與一次 decode 相同
+    class StreamDecoder {
+    public:
+        StreamDecoder() : pendingSize_(0) {}
+        void feed(std::wstring& out, const char* data, size_t length);
+        // 輸入結束：不完整的序列以 U+FFFD 取代
+        void finish(std::wstring& out);
+    private:
+        char pending_[4];
+        size_t pendingSize_;
+    };
+
+    // 解碼後的寬字元數（有效 UTF-8 時為精確值，可用來預先配置）
+    size_t decodedLength(const char* data, size_t length);
+}
+
+#endif // UTF8_CODEC_H
@@ -9,6 +9,10 @@
 #include "position_manager.h"
 #include "tray_manager.h"
 #include "ime_manager.h"
+#include "latency_stats.h"
+#include "trace_recorder.h"
+#include "text_search.h"
+#include "key_event_queue.h"
 #include <algorithm>
 #include <fstream>
 
@@ -18,6 +22,8 @@ extern HHOOK g_hKeyboardHook;
 
 namespace WindowManager {
 
+// 版本檢查由關於對話框手動發起（結果要顯示失敗與已是最新版本）
+static bool g_versionCheckInteractive = false;
 
 // ========== 【日後修改關於對話框內容請修改此函數】 ==========
 // 此函數用於顯示「關於」對話框，所有入口（主菜單、托盤菜單、主窗口按鈕）都調用此函數
@@ -57,41 +63,88 @@ void showAboutDialog(HWND hwnd) {
         L"是否檢查版本更新？",
         L"檢查更新", MB_YESNO | MB_ICONQUESTION);
     
-    // 如果用户选择检查更新
+    // 如果用户选择检查更新：在背景更新執行緒檢查（强制检查，忽略缓存），結果由 showVersionCheckResult 顯示
     if (checkResult == IDYES) {
-        // 手动检查更新（强制检查，忽略缓存，获取最新版本）
-        std::string remoteVersion = DictUpdater::getRemoteVersion(nullptr, true);
-        
-        if (remoteVersion.empty()) {
-            // 无法获取远程版本（网络错误或缓存过期且网络不可用）
-            MessageBoxW(hwnd, 
-                L"無法檢查更新，請檢查網路連接。\n\n可稍後再試或直接訪問 GitHub 查看最新版本。",
-                L"檢查更新失敗", MB_OK | MB_ICONWARNING);
-        } else if (remoteVersion != currentVersion) {
-            // 发现新版本
-            std::wstring remoteVersionW = Utils::utf8ToWstr(remoteVersion);
-            std::wstring updateMsg = L"發現新版本可用！\n\n";
-            updateMsg += L"當前版本：V" + currentVersionW + L"\n";
-            updateMsg += L"最新版本：V" + remoteVersionW + L"\n\n";
-            updateMsg += L"是否前往 GitHub 下載最新版本？\n\n";
-            updateMsg += L"https://github.com/Yamazaki427858/ChineseStrokeIME";
-            
-            int result = MessageBoxW(hwnd, updateMsg.c_str(), 
-                L"版本更新通知", MB_YESNO | MB_ICONINFORMATION);
-            
-            if (result == IDYES) {
-                ShellExecuteW(NULL, L"open", L"https://github.com/Yamazaki427858/ChineseStrokeIME", NULL, NULL, SW_SHOWNORMAL);
-            }
-        } else {
-            // 已是最新版本
-            std::wstring latestMsg = L"✓ 您已使用最新版本！\n\n當前版本：V" + currentVersionW;
-            MessageBoxW(hwnd, latestMsg.c_str(), 
-                L"版本檢查", MB_OK | MB_ICONINFORMATION);
+        g_versionCheckInteractive = true;
+        DictUpdater::queueVersionCheck(true);
+        Utils::updateStatus(g_state, L"正在檢查版本更新...");
+    }
+}
+
+// 版本檢查完成（WM_USER+107）
+// 自動檢查只在發現新版本時通知；從關於對話框手動檢查時也顯示失敗與已是最新版本
+void showVersionCheckResult(HWND hwnd, const UpdateService::Result& result) {
+    bool interactive = g_versionCheckInteractive;
+    g_versionCheckInteractive = false;
+    
+    std::string currentVersion = APP_VERSION;
+    std::wstring currentVersionW = Utils::utf8ToWstr(currentVersion);
+    const std::string& remoteVersion = result.version;
+    
+    if (result.status != UpdateService::STATUS_SUCCEEDED || remoteVersion.empty()) {
+        if (!interactive) return;
+        if (result.status == UpdateService::STATUS_CANCELLED) return;
+        // 无法获取远程版本（网络错误或缓存过期且网络不可用）
+        MessageBoxW(hwnd, 
+            L"無法檢查更新，請檢查網路連接。\n\n可稍後再試或直接訪問 GitHub 查看最新版本。",
+            L"檢查更新失敗", MB_OK | MB_ICONWARNING);
+    } else if (remoteVersion != currentVersion) {
+        // 发现新版本
+        std::wstring remoteVersionW = Utils::utf8ToWstr(remoteVersion);
+        std::wstring updateMsg = L"發現新版本可用！\n\n";
+        updateMsg += L"當前版本：V" + currentVersionW + L"\n";
+        updateMsg += L"最新版本：V" + remoteVersionW + L"\n\n";
+        updateMsg += L"是否前往 GitHub 下載最新版本？\n\n";
+        updateMsg += L"https://github.com/Yamazaki427858/ChineseStrokeIME";
+        
+        int answer = MessageBoxW(hwnd, updateMsg.c_str(), 
+            L"版本更新通知", MB_YESNO | MB_ICONINFORMATION);
+        
+        if (answer == IDYES) {
+            ShellExecuteW(NULL, L"open", L"https://github.com/Yamazaki427858/ChineseStrokeIME", NULL, NULL, SW_SHOWNORMAL);
         }
+    } else if (interactive) {
+        // 已是最新版本
+        std::wstring latestMsg = L"✓ 您已使用最新版本！\n\n當前版本：V" + currentVersionW;
+        MessageBoxW(hwnd, latestMsg.c_str(), 
+            L"版本檢查", MB_OK | MB_ICONINFORMATION);
     }
 }
 // ========== 【關於對話框內容修改結束】 ==========
 
+// 顯示按鍵延遲統計（托盤選單），可選擇匯出到檔案
+void showLatencyStatsDialog(HWND hwnd) {
+    std::wstring report = Utils::utf8ToWstr(LatencyStats::formatReport());
+    std::wstring msg = L"各階段每鍵耗時（微秒）：\n\n" + report;
+    msg += L"\n是否匯出到 latency_stats.txt？";
+    
+    int result = MessageBoxW(hwnd, msg.c_str(), L"按鍵延遲統計", MB_YESNO | MB_ICONINFORMATION);
+    if (result == IDYES) {
+        if (LatencyStats::dumpToFile("latency_stats.txt")) {
+            Utils::updateStatus(g_state, L"延遲統計已匯出到 latency_stats.txt");
+        } else {
+            Utils::updateStatus(g_state, L"延遲統計匯出失敗");
+        }
+    }
+}
+
+// 以暫存狀態重播 keystroke_trace.txt，顯示端到端延遲與記憶體配置
+void showTraceReplayDialog(HWND hwnd) {
+    if (TraceRecorder::isRecording()) {
+        MessageBoxW(hwnd, L"請先停止錄製按鍵軌跡再進行重播。", L"軌跡重播", MB_OK | MB_ICONWARNING);
+        return;
+    }
+    
+    std::string report;
+    if (!InputHandler::replayTraceBenchmark(g_state, "keystroke_trace.txt", report)) {
+        MessageBoxW(hwnd, L"找不到或無法讀取 keystroke_trace.txt", L"軌跡重播", MB_OK | MB_ICONERROR);
+        return;
+    }
+    
+    std::wstring msg = L"重播 keystroke_trace.txt 結果：\n\n" + Utils::utf8ToWstr(report);
+    MessageBoxW(hwnd, msg.c_str(), L"軌跡重播", MB_OK | MB_ICONINFORMATION);
+}
+
 
 
 
@@ -292,6 +345,7 @@ int calculateCandidateWindowHeight(const GlobalState& state) {
 void positionWindowsOptimized(GlobalState& state) {
     // 修復：標點選單模式下也需要調整視窗
     if (!state.isInputting && !state.showPunctMenu) return; // 不在輸入狀態且非標點選單時直接返回
+    if (!state.hCandWnd && !state.hInputWnd) return; // 沒有視窗（軌跡重播的暫存狀態）時不需定位
     
     ScreenManager::updateMonitorInfo();
     
@@ -412,9 +466,10 @@ bool isPointInNextPageButton(int x, int y, const GlobalState& state) {
 }
 
 
-// 處理鍵盤輸入消息 (WM_USER+100)
-LRESULT handleKeyboardInput(HWND hwnd, WPARAM wp) {
+// 處理鉤子送來的按鍵（WM_USER+101 取出的佇列或 WM_USER+100 的逐鍵訊息）
+LRESULT handleKeyboardInput(HWND hwnd, WPARAM wp, uint32_t modifiers) {
     DWORD key = (DWORD)wp;
+    bool shift = (modifiers & KEYMOD_SHIFT) != 0;
     if (g_state.chineseMode) {
         if (key == 'U' || key == 'I' || key == 'O' || key == 'J' || key == 'K' || key == 'L' || key == 'P' ||
             key == VK_NUMPAD7 || key == VK_NUMPAD8 || key == VK_NUMPAD9 || key == VK_NUMPAD4 || key == VK_NUMPAD5 || key == VK_NUMPAD0) {
@@ -424,12 +479,8 @@ LRESULT handleKeyboardInput(HWND hwnd, WPARAM wp) {
         if (key == VK_OEM_COMMA || key == VK_OEM_PERIOD || key == VK_OEM_2 ||
             key == VK_OEM_1 || key == VK_OEM_4 || key == VK_OEM_6 || key == VK_OEM_7 ||
             key == VK_SPACE || key == VK_OEM_MINUS || key == VK_OEM_PLUS || key == VK_OEM_5 || key == VK_OEM_3 ||
-            (key == '1' && (GetKeyState(VK_SHIFT) & 0x8000)) || (key == '2' && (GetKeyState(VK_SHIFT) & 0x8000)) ||
-            (key == '3' && (GetKeyState(VK_SHIFT) & 0x8000)) || (key == '4' && (GetKeyState(VK_SHIFT) & 0x8000)) ||
-            (key == '5' && (GetKeyState(VK_SHIFT) & 0x8000)) || (key == '6' && (GetKeyState(VK_SHIFT) & 0x8000)) ||
-            (key == '7' && (GetKeyState(VK_SHIFT) & 0x8000)) || (key == '8' && (GetKeyState(VK_SHIFT) & 0x8000)) ||
-            (key == '9' && (GetKeyState(VK_SHIFT) & 0x8000)) || (key == '0' && (GetKeyState(VK_SHIFT) & 0x8000))) {
-            InputHandler::processPunctuator(g_state, key);
+            (key >= '0' && key <= '9' && shift)) {
+            InputHandler::processPunctuator(g_state, key, shift);
             return 0;
         }
     }
@@ -438,32 +489,10 @@ LRESULT handleKeyboardInput(HWND hwnd, WPARAM wp) {
     if (key == VK_DOWN) { Dictionary::changePage(g_state, 1); return 0; }
     if (key == VK_UP) { Dictionary::changePage(g_state, -1); return 0; }
     if (key >= '1' && key <= '9') { Dictionary::selectCandidate(g_state, key - '1'); return 0; }
-    if (key == VK_BACK) {
-        if (!g_state.input.empty()) {
-            g_state.input.pop_back();
-            Dictionary::updateCandidates(g_state);
-            InvalidateRect(hwnd, nullptr, TRUE);
-        }
-        return 0;
-    }
+    if (key == VK_BACK) { InputHandler::backspaceInput(g_state); return 0; }
     if (key == VK_SPACE) { Dictionary::selectCandidate(g_state, 0); return 0; }
     if (key == VK_RETURN) { InputHandler::handleEnterKeySmartly(g_state); return 0; }
-    if (key == VK_ESCAPE) {
-        g_state.input.clear();
-        g_state.candidates.clear();
-        g_state.candidateCodes.clear();
-        g_state.showCand = false;
-        g_state.isInputting = false;
-        g_state.inputError = false;
-        g_state.showPunctMenu = false;
-        if (g_state.hCandWnd) ShowWindow(g_state.hCandWnd, SW_HIDE);
-        if (g_state.hInputWnd) ShowWindow(g_state.hInputWnd, SW_HIDE);
-        // 🔥 恢復 Windows 輸入法狀態（取消輸入後）
-        IMEManager::restoreWindowsIME();
-        Utils::updateStatus(g_state, L"輸入已取消");
-        InvalidateRect(hwnd, nullptr, TRUE);
-        return 0;
-    }
+    if (key == VK_ESCAPE) { InputHandler::cancelInput(g_state); return 0; }
     return 0;
 }
 
@@ -486,7 +515,7 @@ LRESULT handleCommand(HWND hwnd, WPARAM wp) {
             break;
         case 1005:
             ConfigLoader::refreshConfigs(g_state);
-            MessageBoxW(hwnd, L"配置已重新載入！", L"提示", MB_OK | MB_ICONINFORMATION);
+            MessageBoxW(hwnd, L"配置已重新載入！\n有變更的字典檔案會在背景更新。", L"提示", MB_OK | MB_ICONINFORMATION);
             break;
         case 1008: // 從GitHub更新字碼表
         {
@@ -681,6 +710,9 @@ LRESULT handleCommand(HWND hwnd, WPARAM wp) {
                 }
             }
             break;
+        case 2014: showLatencyStatsDialog(hwnd); break;
+        case 2015: InputHandler::toggleTraceRecording(g_state); break;
+        case 2016: showTraceReplayDialog(hwnd); break;
         case 2010: BufferManager::sendBufferContent(g_state); break;
         case 2011: BufferManager::clearBufferWithConfirm(g_state); break;
         case 2012: BufferManager::toggleBufferMode(g_state); break;
@@ -882,63 +914,116 @@ LRESULT CALLBACK CandProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     return DefWindowProc(hwnd, msg, wp, lp);
 }
 
+// 繪製一段同色文字：以排版快取的字元寬度指定每個字元的位置，與命中測試完全一致
+static void drawTextRun(HDC hdc, int x, int y, int height, const wchar_t* text, const std::vector<int>& dx,
+                        size_t from, size_t to, bool selected, const GlobalState& state) {
+    if (from >= to) return;
+    if (selected) {
+        int width = 0;
+        for (size_t i = from; i < to; i++) width += dx[i];
+        RECT runRect = {x, y, x + width, y + height};
+        HBRUSH hSelBrush = CreateSolidBrush(RGB(51, 153, 255)); // 藍色選取背景
+        FillRect(hdc, &runRect, hSelBrush);
+        DeleteObject(hSelBrush);
+        SetTextColor(hdc, RGB(255, 255, 255));   // 選取文字使用白色
+    } else {
+        SetTextColor(hdc, state.bufferTextColor);
+    }
+    ExtTextOutW(hdc, x, y, 0, NULL, text + from, (UINT)(to - from), &dx[from]);
+}
+
 // 新增函數：繪製帶選取高亮的文字
+// 行的起點取自暫放區換行排版，只處理顯示區域內（且與重繪區域相交）的行
 void drawTextWithSelection(HDC hdc, RECT textArea, GlobalState& state) {
     if (state.bufferText.empty()) return;
     
-    // 設定字體
-    HFONT hFont = CreateFontW(state.bufferFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-        DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, state.bufferFontName.c_str());
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
+    TextLayout& layout = BufferManager::getBufferLayout(state);
+    int lineHeight = layout.lineHeight();
+    if (lineHeight <= 0) return;
+    
+    // 設定字體（與排版共用，不在這裡刪除）
+    HFONT hOldFont = (HFONT)SelectObject(hdc, BufferManager::getBufferFont(state));
     
     SetBkMode(hdc, TRANSPARENT);
     
-    int currentX = textArea.left;
-    int currentY = textArea.top;
-    int lineHeight = state.bufferFontSize + 2;
+    size_t selStart = 0, selEnd = 0;
+    if (state.hasSelection) {
+        selStart = (size_t)std::max(0, std::min(state.selectionStart, state.selectionEnd));
+        selEnd = (size_t)std::max(0, std::max(state.selectionStart, state.selectionEnd));
+    }
     
-    int selStart = state.hasSelection ? std::min(state.selectionStart, state.selectionEnd) : -1;
-    int selEnd = state.hasSelection ? std::max(state.selectionStart, state.selectionEnd) : -1;
+    RECT clip;
+    if (GetClipBox(hdc, &clip) == ERROR) clip = textArea;
+    
+    // 先找出要繪製的行
+    struct VisibleLine { size_t start, end; int y; };
+    std::vector<VisibleLine> lines;
+    for (size_t line = 0; ; line++) {
+        int y = textArea.top + (int)line * lineHeight;
+        // 第一行之外，放不下的行不再繪製
+        if (line > 0 && y + state.bufferFontSize > textArea.bottom) break;
+        if (y >= clip.bottom) break;
+        if (!layout.hasLines(state.bufferText, line + 1)) break;
+        if (y + lineHeight <= clip.top) continue;
+        VisibleLine visible = {layout.lineStart(state.bufferText, line), layout.lineEnd(state.bufferText, line), y};
+        lines.push_back(visible);
+    }
+    if (lines.empty()) {
+        SelectObject(hdc, hOldFont);
+        return;
+    }
     
-    for (int i = 0; i < (int)state.bufferText.length(); i++) {
-        wchar_t ch = state.bufferText[i];
-        SIZE charSize;
-        GetTextExtentPoint32W(hdc, &ch, 1, &charSize);
-        
-        // 檢查是否需要換行
-        if (currentX + charSize.cx > textArea.right) {
-            currentX = textArea.left;
-            currentY += lineHeight;
-            
-            // 檢查是否超出顯示區域
-            if (currentY + state.bufferFontSize > textArea.bottom) {
-                break; // 不再繪製
+    // 搜尋中：只在可見範圍內找相符（含跨越範圍邊界的相符），以黃色底標示
+    std::vector<size_t> matches;
+    size_t matchLength = state.findActive ? state.findQuery.length() : 0;
+    if (matchLength > 0) {
+        size_t from = lines.front().start > matchLength - 1 ? lines.front().start - (matchLength - 1) : 0;
+        size_t to = lines.back().end + matchLength - 1;
+        TextSearch::findAll(state.bufferText, TextSearch::Pattern(state.findQuery), from, to, matches);
+    }
+    
+    std::wstring lineText;
+    std::vector<int> dx;
+    size_t nextMatch = 0;
+    for (size_t l = 0; l < lines.size(); l++) {
+        size_t start = lines[l].start;
+        size_t end = lines[l].end;
+        int y = lines[l].y;
+        lineText = state.bufferText.substr(start, end - start);
+        dx.resize(lineText.size());
+        for (size_t i = 0; i < lineText.size(); i++) dx[i] = layout.advance(lineText[i]);
+        size_t count = lineText.size();
+        
+        if (!matches.empty()) {
+            HBRUSH hMatchBrush = CreateSolidBrush(RGB(255, 230, 100));
+            while (nextMatch < matches.size() && matches[nextMatch] + matchLength <= start) nextMatch++;
+            for (size_t k = nextMatch; k < matches.size() && matches[k] < end; k++) {
+                size_t a = matches[k] > start ? matches[k] - start : 0;
+                size_t b = std::min(count, matches[k] + matchLength - start);
+                int left = textArea.left;
+                for (size_t i = 0; i < a; i++) left += dx[i];
+                int right = left;
+                for (size_t i = a; i < b; i++) right += dx[i];
+                RECT matchRect = {left, y, right, y + state.bufferFontSize};
+                FillRect(hdc, &matchRect, hMatchBrush);
             }
+            DeleteObject(hMatchBrush);
         }
         
-        // 繪製選取背景
-        if (state.hasSelection && i >= selStart && i < selEnd) {
-            RECT charRect = {currentX, currentY, currentX + charSize.cx, currentY + state.bufferFontSize};
-            HBRUSH hSelBrush = CreateSolidBrush(RGB(51, 153, 255)); // 藍色選取背景
-            FillRect(hdc, &charRect, hSelBrush);
-            DeleteObject(hSelBrush);
-            
-            // 選取文字使用白色
-            SetTextColor(hdc, RGB(255, 255, 255));
-        } else {
-            // 正常文字顏色
-            SetTextColor(hdc, state.bufferTextColor);
-        }
-        
-        // 繪製字符
-        TextOutW(hdc, currentX, currentY, &ch, 1);
-        
-        currentX += charSize.cx;
+        // 依選取範圍切成最多三段：選取前、選取中、選取後
+        size_t a = std::min(count, selStart > start ? selStart - start : 0);
+        size_t b = std::min(count, selEnd > start ? selEnd - start : 0);
+        if (b < a) b = a;
+        
+        int x = textArea.left;
+        drawTextRun(hdc, x, y, state.bufferFontSize, lineText.c_str(), dx, 0, a, false, state);
+        for (size_t i = 0; i < a; i++) x += dx[i];
+        drawTextRun(hdc, x, y, state.bufferFontSize, lineText.c_str(), dx, a, b, true, state);
+        for (size_t i = a; i < b; i++) x += dx[i];
+        drawTextRun(hdc, x, y, state.bufferFontSize, lineText.c_str(), dx, b, count, false, state);
     }
     
     SelectObject(hdc, hOldFont);
-    DeleteObject(hFont);
 }
 
 // 暫放視窗的繪製和處理
@@ -957,10 +1042,7 @@ void drawBufferWindow(HDC hdc, RECT rc, GlobalState& state) {
     
     RECT textArea = {10, 10, rc.right - 10, rc.bottom - CONTROL_BAR_HEIGHT - 2};
     
-    HFONT hFont = CreateFontW(state.bufferFontSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-        DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-        DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, state.bufferFontName.c_str());
-    HFONT hOldFont = (HFONT)SelectObject(hdc, hFont);
+    HFONT hOldFont = (HFONT)SelectObject(hdc, BufferManager::getBufferFont(state));
     
     SetTextColor(hdc, state.bufferTextColor);
     SetBkMode(hdc, TRANSPARENT);
@@ -983,7 +1065,6 @@ void drawBufferWindow(HDC hdc, RECT rc, GlobalState& state) {
     }
     
     SelectObject(hdc, hOldFont);
-    DeleteObject(hFont);
     
     int controlY = rc.bottom - CONTROL_BAR_HEIGHT;
     RECT controlRect = {0, controlY, rc.right, rc.bottom};
@@ -992,6 +1073,17 @@ void drawBufferWindow(HDC hdc, RECT rc, GlobalState& state) {
     DeleteObject(hControlBg);
     
     std::wstring statsText = L"字數: " + std::to_wstring(state.bufferText.length()) + L" | 位置: " + std::to_wstring(state.bufferCursorPos);
+    if (state.findActive) {
+        // 搜尋列：目前輸入的欄位以 ▸ 標示
+        statsText = (state.findField == 0 ? L"▸搜尋: " : L"搜尋: ") + state.findQuery;
+        if (!state.findQuery.empty()) {
+            statsText += state.findMatchCount == 0 ? std::wstring(L" (無)")
+                : L" (" + std::to_wstring(state.findMatchIndex) + L"/" + std::to_wstring(state.findMatchCount) + L")";
+        }
+        if (state.findReplaceMode) {
+            statsText += (state.findField == 1 ? L" | ▸取代: " : L" | 取代: ") + state.findReplaceText;
+        }
+    }
     SetTextColor(hdc, RGB(100, 100, 100));
     TextOutW(hdc, 10, controlY + 2, statsText.c_str(), statsText.length());
     
@@ -1179,9 +1271,13 @@ LRESULT CALLBACK BufferProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
             HBITMAP memBitmap = CreateCompatibleBitmap(hdc, rc.right, rc.bottom);
             HBITMAP oldBitmap = (HBITMAP)SelectObject(memDC, memBitmap);
             
+            // 只重繪失效區域（游標閃爍時只有游標所在的小矩形）
+            RECT& dirty = ps.rcPaint;
+            IntersectClipRect(memDC, dirty.left, dirty.top, dirty.right, dirty.bottom);
             drawBufferWindow(memDC, rc, g_state);
             
-            BitBlt(hdc, 0, 0, rc.right, rc.bottom, memDC, 0, 0, SRCCOPY);
+            BitBlt(hdc, dirty.left, dirty.top, dirty.right - dirty.left, dirty.bottom - dirty.top,
+                   memDC, dirty.left, dirty.top, SRCCOPY);
             
             SelectObject(memDC, oldBitmap);
             DeleteObject(memBitmap);
@@ -1231,6 +1327,8 @@ LRESULT CALLBACK BufferProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
             g_state.clipboardInputting = false;
             g_state.clipboardCopied = true;
         } else {
+            // 關閉時把仍在延遲產生的內容實際放上剪貼簿，之後的編輯不再影響剪貼簿
+            BufferManager::finalizeClipboard(g_state);
             // 關閉時重置狀態
             g_state.clipboardInputting = false;
             g_state.clipboardCopied = false;
@@ -1486,21 +1584,51 @@ case WM_KEYDOWN: {
                 Dictionary::saveUserDict(g_state);
                 return 0;
             }
+            if (wp == 2) {
+                // 剪貼簿模式：連續編輯結束，同步剪貼簿
+                BufferManager::onClipboardSyncTimer(g_state);
+                return 0;
+            }
             if (wp == 1) {
                 g_state.bufferShowCursor = !g_state.bufferShowCursor;
                 // 檢查輸入結束（剪貼簿模式）
                 bool wasInputting = g_state.clipboardInputting;
                 BufferManager::checkInputEnd(g_state);
-                // 如果狀態改變，需要重繪以更新指示器
+                // 如果狀態改變，需要重繪以更新指示器；否則只重繪游標所在的矩形
                 if (wasInputting != g_state.clipboardInputting) {
                     InvalidateRect(hwnd, nullptr, TRUE);
-                } else {
-                    InvalidateRect(hwnd, nullptr, TRUE);  // 總是重繪以更新游標和指示器
+                } else if (g_state.bufferHasFocus && !g_state.hasSelection) {
+                    RECT cursorRect = BufferManager::getCursorRect(g_state);
+                    InvalidateRect(hwnd, &cursorRect, FALSE);
                 }
             }
             return 0;
         }
         
+        case WM_RENDERFORMAT: {
+            // 其他程式貼上：此時才把暫放文字放上剪貼簿（延遲產生）
+            if (wp == CF_UNICODETEXT) {
+                BufferManager::renderClipboard(g_state);
+            }
+            return 0;
+        }
+        
+        case WM_RENDERALLFORMATS: {
+            // 程式結束前仍擁有剪貼簿：把尚未產生的資料放上，結束後仍可貼上
+            if (OpenClipboard(hwnd)) {
+                if (GetClipboardOwner() == hwnd) {
+                    BufferManager::renderClipboard(g_state);
+                }
+                CloseClipboard();
+            }
+            return 0;
+        }
+        
+        case WM_DESTROYCLIPBOARD: {
+            BufferManager::onClipboardDestroyed(g_state);
+            return 0;
+        }
+        
         case WM_SETFOCUS: {
             g_state.bufferHasFocus = true;
             SetTimer(hwnd, 1, 500, NULL);
@@ -2039,30 +2167,26 @@ LRESULT CALLBACK OptimizedWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
 				// 啟動時自動檢查版本更新（僅在程序啟動時執行一次）
 				KillTimer(hwnd, 994);
 				
-				// 檢查版本（使用緩存，但如果緩存過期會自動從 GitHub 獲取）
-				// 注意：首次啟動或緩存過期（24小時）後會重新檢查
-				std::string currentVersion = APP_VERSION;
-				std::string remoteVersion = DictUpdater::getRemoteVersion();
-				
-				// 如果發現新版本，顯示通知
-				if (!remoteVersion.empty() && remoteVersion != currentVersion) {
-					std::wstring currentVersionW = Utils::utf8ToWstr(currentVersion);
-					std::wstring remoteVersionW = Utils::utf8ToWstr(remoteVersion);
-					
-					std::wstring updateMsg = L"發現新版本可用！\n\n";
-					updateMsg += L"當前版本：V" + currentVersionW + L"\n";
-					updateMsg += L"最新版本：V" + remoteVersionW + L"\n\n";
-					updateMsg += L"是否前往 GitHub 下載最新版本？\n\n";
-					updateMsg += L"https://github.com/Yamazaki427858/ChineseStrokeIME";
-					
-					int result = MessageBoxW(hwnd, updateMsg.c_str(), 
-						L"版本更新通知", MB_YESNO | MB_ICONINFORMATION);
-					
-					if (result == IDYES) {
-						ShellExecuteW(NULL, L"open", L"https://github.com/Yamazaki427858/ChineseStrokeIME", NULL, NULL, SW_SHOWNORMAL);
-					}
-				}
-				
+				// 在背景更新執行緒檢查（使用緩存，緩存過期（24小時）後才從 GitHub 獲取），不阻塞訊息迴圈
+				// 發現新版本時由 showVersionCheckResult 顯示通知
+				DictUpdater::queueVersionCheck(false);
+				return 0;
+			}
+			else if (wp == 993) {
+				// 輸出前等待目標取得焦點逾時
+				InputHandler::onFocusWaitTimeout();
+				return 0;
+			}
+			else if (wp == 991) {
+				// 設定檔監看：檔案修改後只套用有變更的設定
+				ConfigLoader::reloadChangedConfig(g_state);
+				return 0;
+			}
+			else if (wp == 992) {
+				// 延遲重新置頂（WM_USER+300 排定）
+				KillTimer(hwnd, 992);
+				SetWindowPos(hwnd, HWND_TOPMOST, 0, 0, 0, 0,
+							SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
 				return 0;
 			}
 			else if (wp == 996) {
@@ -2119,7 +2243,53 @@ LRESULT CALLBACK OptimizedWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
         // 注意：WM_USER + 500 已移除（自動檢查更新功能已禁用，避免 GitHub API 訪問次數限制）
 
         case WM_USER+100:
-            return handleKeyboardInput(hwnd, wp);
+            // 佇列滿時的退回路徑：先處理已入列的按鍵以保持輸入順序
+            InputHandler::handlePostedKey(hwnd, wp, lp);
+            return 0;
+        
+        case WM_USER+101:
+            InputHandler::drainKeyEvents(hwnd);
+            return 0;
+        
+        case WM_USER+102:
+            // 背景文字輸出的進度通知
+            InputHandler::handleOutputProgress(g_state);
+            return 0;
+        
+        case WM_USER+103:
+            // 暫放區搜尋/取代指令（由鍵盤鉤子送出）
+            BufferManager::handleFindCommand(g_state, (BufferManager::FindCommand)wp);
+            return 0;
+        
+        case WM_USER+104:
+            // 背景另存暫放內容的進度與結果
+            BufferManager::onExportProgress(g_state, wp, lp);
+            return 0;
+        
+        case WM_USER+105:
+            // 背景重建的字典已完成，換上新資料
+            Dictionary::onResourcesRefreshed(g_state);
+            return 0;
+        
+        case WM_USER+106: {
+            // 背景更新的進度（只取最新的一次）
+            std::wstring status;
+            if (DictUpdater::takeUpdateProgress(status)) Utils::updateStatus(g_state, status);
+            return 0;
+        }
+        
+        case WM_USER+107: {
+            // 背景更新完成：換上下載好的字典或顯示版本檢查結果
+            UpdateService::Result result;
+            while (DictUpdater::takeUpdateResult(result)) {
+                if (result.kind == UpdateService::JOB_VERSION) {
+                    showVersionCheckResult(hwnd, result);
+                } else {
+                    Dictionary::onUpdateFinished(g_state, result);
+                }
+            }
+            return 0;
+        }
 		
 		case WM_USER+200:
 			return handleTrayMessage(hwnd, lp);
@@ -2351,10 +2521,13 @@ LRESULT CALLBACK OptimizedWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
             return handleCommand(hwnd, wp);
         
         case WM_USER + 300: {
-            // 使用配置檔案中的延遲設定
-            Sleep(g_state.refocusDelay);
-            SetWindowPos(hwnd, HWND_TOPMOST, 0, 0, 0, 0,
-                        SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+            // 使用配置檔案中的延遲設定；以計時器延遲，不阻塞訊息迴圈
+            if (g_state.refocusDelay > 0) {
+                SetTimer(hwnd, 992, g_state.refocusDelay, NULL);
+            } else {
+                SetWindowPos(hwnd, HWND_TOPMOST, 0, 0, 0, 0,
+                            SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+            }
             return 0;
         }
         
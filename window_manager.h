@@ -3,6 +3,7 @@
 #define WINDOW_MANAGER_H
 
 #include "ime_core.h"
+#include <cstdint>
 
 namespace WindowManager {
     // OptimizedUI視窗註冊與建立
@@ -67,7 +68,8 @@ namespace WindowManager {
     void applyTransparency(GlobalState& state);
     
     // 公共消息處理函數（用於消除重複代碼）
-    LRESULT handleKeyboardInput(HWND hwnd, WPARAM wp);
+    // modifiers 為按鍵當下的 KeyModifier 組合（由鍵盤鉤子記錄）
+    LRESULT handleKeyboardInput(HWND hwnd, WPARAM wp, uint32_t modifiers);
     LRESULT handleTrayMessage(HWND hwnd, LPARAM lp);
     LRESULT handleCommand(HWND hwnd, WPARAM wp);
     LRESULT handleDisplayChange(HWND hwnd);